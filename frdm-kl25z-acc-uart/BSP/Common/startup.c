@@ -5,6 +5,7 @@
 */
 
 extern void *_sidata, *_sdata, *_edata;
+extern void *_siramfunc, *_sramfunc, *_eramfunc;
 extern void *_sbss, *_ebss;
 
 void __init_hardware(void);
@@ -23,6 +24,9 @@ void __attribute__((naked, noreturn)) Reset_Handler()
 	for (pSource = &_sidata, pDest = &_sdata; pDest != &_edata; pSource++, pDest++)
 		*pDest = *pSource;
 
+	for (pSource = &_siramfunc, pDest = &_sramfunc; pDest != &_eramfunc; pSource++, pDest++)
+		*pDest = *pSource;
+
 	for (pDest = &_sbss; pDest != &_ebss; pDest++)
 		*pDest = 0;
 
@@ -0,0 +1,90 @@
+/*
+ * batch.h
+ *
+ * Multi-sample telemetry frames with sequence number and CRC
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <stdint.h>
+
+/**
+ * @brief The maximum number of sample payload bytes per batch
+ */
+#define BATCH_MAX_PAYLOAD	(128)
+
+/**
+ * @brief The batch header length: type, sequence (2 bytes), sample count, sample size
+ */
+#define BATCH_HEADER_LENGTH	(5)
+
+/**
+ * @brief The batch trailer length: CRC-16
+ */
+#define BATCH_TRAILER_LENGTH	(2)
+
+/**
+ * @brief A batch of equally sized samples sent in a single frame
+ *
+ * The frame payload is laid out in native (little) endianness as
+ * <code>type, sequence (uint16), count, sampleSize, samples[count], crc16</code>,
+ * with the CRC calculated over all bytes preceding it.
+ */
+typedef struct {
+	uint8_t capacity;		/*< The number of samples per batch */
+	uint8_t count;			/*< The number of samples currently in the batch */
+	uint16_t sequence;		/*< The sequence number of the next frame */
+	uint32_t firstSampleTime;	/*< The time of the first sample in the batch */
+	uint8_t frame[BATCH_HEADER_LENGTH + BATCH_MAX_PAYLOAD + BATCH_TRAILER_LENGTH];	/*< The frame under construction */
+} batch_t;
+
+/**
+ * @brief Initializes a batch
+ * @param[in] batch The batch instance
+ * @param[in] type The frame type
+ * @param[in] sampleSize The size of a single sample in bytes
+ * @param[in] capacity The number of samples per batch; capacity*sampleSize must not exceed {@see BATCH_MAX_PAYLOAD}
+ * @return Zero on success, nonzero if the configuration is invalid
+ */
+uint8_t Batch_Init(batch_t *const batch, uint8_t type, uint8_t sampleSize, uint8_t capacity);
+
+/**
+ * @brief Appends a sample to the batch
+ * @param[in] batch The batch instance
+ * @param[in] sample The sample data of the configured sample size
+ * @param[in] time The current system time in milliseconds
+ * @return Nonzero if the batch is full and must be flushed
+ */
+uint8_t Batch_Append(batch_t *const batch, const void *const sample, uint32_t time);
+
+/**
+ * @brief Determines if a batch should be flushed
+ * @param[in] batch The batch instance
+ * @param[in] time The current system time in milliseconds
+ * @param[in] deadline The maximum age of the first sample in milliseconds
+ * @return Nonzero if the batch is full or the deadline has passed
+ */
+uint8_t Batch_Due(const batch_t *const batch, uint32_t time, uint32_t deadline);
+
+/**
+ * @brief Determines the time until a batch becomes due by its deadline
+ * @param[in] batch The batch instance
+ * @param[in] time The current system time in milliseconds
+ * @param[in] deadline The maximum age of the first sample in milliseconds
+ * @return The time in milliseconds, zero if the batch is due now, or UINT32_MAX if it is empty
+ */
+uint32_t Batch_Remaining(const batch_t *const batch, uint32_t time, uint32_t deadline);
+
+/**
+ * @brief Sends the batch, if not empty, and starts a new one
+ * @param[in] batch The batch instance
+ * 
+ * Must only be used after initialization of Uart0 interrupt.
+ */
+void Batch_Flush(batch_t *const batch);
+
+#endif /* BATCH_H_ */
@@ -17,6 +17,23 @@
  */
 #define RINGBUFFER_ENABLE_WFI_ON_BLOCK 0
 
+/**
+ * @brief The maximum number of committed frames tracked per buffer
+ * 
+ * Reservations fail (or block) once this many frames are pending, so the
+ * boundaries of all pending frames are always known.
+ */
+#define RINGBUFFER_FRAME_SLOTS	(16)
+
+/**
+ * @brief Policy applied when a frame reservation does not fit into the buffer
+ */
+typedef enum {
+	RINGBUFFER_POLICY_BLOCK			= 0,	/*! Block until the reader made enough room */
+	RINGBUFFER_POLICY_DROP_NEWEST	= 1,	/*! Discard the frame to be written */
+	RINGBUFFER_POLICY_DROP_OLDEST	= 2,	/*! Discard the oldest frames not yet claimed by the reader */
+} buffer_policy_t;
+
 /**
  * @brief Ring buffer type
  */
@@ -25,7 +42,14 @@ typedef struct {
 	uint32_t mask;			/*< The address mask; one less than size */
 	volatile uint32_t writeIndex;	/*< The write index */
 	volatile uint32_t readIndex;	/*< The read index */
+	volatile uint32_t claimIndex;	/*< The index up to which the reader owns the data; readIndex <= claimIndex <= writeIndex */
 	uint8_t */*const*/ data;		/*< The data array; Size is defined in size */
+	buffer_policy_t policy;			/*< The full buffer policy for frame reservations */
+	uint32_t overflows;				/*< The number of frame reservations that did not fit */
+	uint32_t drops;					/*< The number of frames dropped */
+	uint32_t frameStart[RINGBUFFER_FRAME_SLOTS];	/*< The start indices of pending frames */
+	uint8_t frameHead;				/*< The slot of the oldest pending frame */
+	uint8_t frameCount;				/*< The number of pending frames */
 } buffer_t;
 
 /**
@@ -42,10 +66,21 @@ uint8_t RingBuffer_Init(buffer_t *const buffer, uint8_t (*const data)[], const u
  */
 __STATIC_INLINE void RingBuffer_Reset(buffer_t *buffer)
 {
-	buffer->writeIndex = buffer->readIndex = 0;
+	buffer->writeIndex = buffer->readIndex = buffer->claimIndex = 0;
+	buffer->frameHead = buffer->frameCount = 0;
 	__DMB();
 }
 
+/**
+ * @brief Sets the full buffer policy for frame reservations
+ * @param[in] buffer The ring buffer instance
+ * @param[in] policy The policy
+ */
+__STATIC_INLINE void RingBuffer_SetPolicy(buffer_t *const buffer, const buffer_policy_t policy)
+{
+	buffer->policy = policy;
+}
+
 /**
  * @brief Writes an item to the ring buffer
  * @param[in] buffer The ring buffer instance
@@ -65,11 +100,44 @@ __STATIC_INLINE void RingBuffer_Write(buffer_t *buffer, const uint8_t data)
 __STATIC_INLINE const uint8_t RingBuffer_Read(buffer_t *const buffer)
 {
 	const uint8_t data = buffer->data[buffer->mask & (buffer->readIndex++)];
+	buffer->claimIndex = buffer->readIndex;
 	assert(buffer->readIndex <= buffer->writeIndex);
 	__DMB();
 	return data;
 }
 
+/**
+ * @brief Claims the next contiguous span of unread items for a bulk reader, e.g. a DMA transfer
+ * @param[in] buffer The ring buffer instance
+ * @param[out] offset The array offset of the first item
+ * @return The number of items claimed; zero if the buffer is empty
+ * 
+ * The span ends at the end of the data array at the latest. Claimed items are exempt
+ * from {@see RINGBUFFER_POLICY_DROP_OLDEST} and must be released using {@see RingBuffer_ReleaseSpan}.
+ */
+__STATIC_INLINE uint32_t RingBuffer_ClaimSpan(buffer_t *const buffer, uint32_t *const offset)
+{
+	__DMB();
+	const uint32_t count = buffer->writeIndex - buffer->readIndex;
+	*offset = buffer->readIndex & buffer->mask;
+	
+	const uint32_t contiguous = buffer->size - *offset;
+	const uint32_t span = (count < contiguous) ? count : contiguous;
+	
+	buffer->claimIndex = buffer->readIndex + span;
+	return span;
+}
+
+/**
+ * @brief Releases the claimed span to the writer
+ * @param[in] buffer The ring buffer instance
+ */
+__STATIC_INLINE void RingBuffer_ReleaseSpan(buffer_t *const buffer)
+{
+	buffer->readIndex = buffer->claimIndex;
+	__DMB();
+}
+
 /**
  * @brief Returns if the ring buffer is empty
  * @param[in] buffer The ring buffer instance
@@ -104,6 +172,56 @@ __STATIC_INLINE const uint8_t RingBuffer_Full(const buffer_t *const buffer)
 	return RingBuffer_Count(buffer) >= buffer->size;
 }
 
+/**
+ * @brief Gets the number of items that can be written without overflowing the buffer
+ * @param[in] buffer The ring buffer instance
+ * @return The free item count
+ */
+__STATIC_INLINE const uint32_t RingBuffer_Free(const buffer_t *const buffer)
+{
+	return buffer->size - RingBuffer_Count(buffer);
+}
+
+/**
+ * @brief Reserves a span of items for writing a frame, applying the buffer's full buffer policy.
+ * @param[in] buffer The ring buffer instance
+ * @param[in] count The number of items to reserve; Must not exceed the buffer size
+ * @param[out] index The (free running) index of the first reserved item, to be used with {@see RingBuffer_Put} and {@see RingBuffer_Commit}
+ * @return Zero on success, nonzero if the frame was dropped according to the policy
+ * 
+ * The reserved items are invisible to the reader until they are published
+ * using {@see RingBuffer_Commit}. Only one span may be reserved at a time.
+ */
+uint8_t RingBuffer_Reserve(buffer_t *const buffer, const uint32_t count, uint32_t *const index);
+
+/**
+ * @brief Writes an item into a reserved span without publishing it
+ * @param[in] buffer The ring buffer instance
+ * @param[in] index The (free running) index to write to
+ * @param[in] data The data to write
+ */
+__STATIC_INLINE void RingBuffer_Put(buffer_t *const buffer, const uint32_t index, const uint8_t data)
+{
+	buffer->data[buffer->mask & index] = data;
+}
+
+/**
+ * @brief Publishes all items of a reserved span up to (excluding) the given index as one frame
+ * @param[in] buffer The ring buffer instance
+ * @param[in] index The (free running) index one past the last written item
+ */
+__STATIC_INLINE void RingBuffer_Commit(buffer_t *const buffer, const uint32_t index)
+{
+	/* track the frame boundary; the reservation guaranteed a free slot */
+	buffer->frameStart[(buffer->frameHead + buffer->frameCount) % RINGBUFFER_FRAME_SLOTS] = buffer->writeIndex;
+	++buffer->frameCount;
+	
+	/* make sure the data is visible before the index is */
+	__DMB();
+	buffer->writeIndex = index;
+	__DMB();
+}
+
 /**
  * @brief Blocks until the ring buffer contains data 
  * @param[in] buffer The ring buffer instance
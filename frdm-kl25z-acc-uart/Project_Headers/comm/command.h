@@ -0,0 +1,84 @@
+/*
+ * command.h
+ *
+ * Runtime command channel on top of P2PPE framing
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include <stdint.h>
+#include "output_mode.h"
+#include "comm/buffer.h"
+#include "comm/scheduler.h"
+
+/**
+ * @brief The frame type of command responses
+ */
+#define COMMAND_RESPONSE_TYPE	(0x60)
+
+/**
+ * @brief Command identifiers; the first byte of a command frame payload
+ * 
+ * All multi-byte arguments are in native (little) endianness.
+ */
+typedef enum {
+	COMMAND_SET_OUTPUT_MODE		= 0x10,	/*! Sets the output mode; argument: uint8 {@see output_mode_t} */
+	COMMAND_SET_TRANSMIT_PERIOD	= 0x11,	/*! Sets the period of output stream 0; argument: uint16 milliseconds */
+	COMMAND_SET_MPU6050_RATE	= 0x12,	/*! Sets the MPU6050 sample rate divider; argument: uint8 divider */
+	COMMAND_SET_HMC5883L_RATE	= 0x13,	/*! Sets the HMC5883L output rate; argument: uint8 {@see hmc5883l_do_t} */
+	COMMAND_SET_BAUD_RATE		= 0x14,	/*! Sets the UART baud rate; argument: uint32 baud */
+	COMMAND_SET_TX_POLICY		= 0x15,	/*! Sets the transmit buffer full policy; argument: uint8 {@see buffer_policy_t} */
+	COMMAND_SET_FRAMING			= 0x16,	/*! Sets the outgoing frame encoding; argument: uint8 {@see io_framing_t} */
+	COMMAND_SET_STREAM_PERIOD	= 0x17,	/*! Sets an output stream period; arguments: uint8 stream, uint16 milliseconds (0 disables) */
+	COMMAND_SET_ACCEL_DECIMATION	= 0x18,	/*! Sets the number of gyroscope predictions per accelerometer correction; argument: uint8 decimation (>= 1) */
+	COMMAND_STORE_PARAMETERS	= 0x19,	/*! Stores the calibration, tuning and sensor configuration in use in flash; no arguments */
+	COMMAND_ERASE_PARAMETERS	= 0x1A,	/*! Erases the stored parameters, the next boot uses the defaults; no arguments */
+	COMMAND_PING				= 0x1B,	/*! Answers with timestamps for latency and clock offset estimation; argument: uint32 echo, see {@see Command_Process} */
+} command_id_t;
+
+/**
+ * @brief Command response status codes
+ */
+typedef enum {
+	COMMAND_STATUS_OK			= 0x00,	/*! The command was executed */
+	COMMAND_STATUS_UNKNOWN		= 0x01,	/*! The command is unknown */
+	COMMAND_STATUS_INVALID		= 0x02,	/*! The command arguments are invalid */
+	COMMAND_STATUS_FAILED		= 0x03,	/*! The command could not be executed */
+} command_status_t;
+
+/**
+ * @brief Runtime settings modified by commands
+ */
+typedef struct {
+	output_mode_t outputMode;		/*< The output mode */
+	output_scheduler_t *scheduler;	/*< The output stream scheduler */
+	uint16_t hmc5883lPeriod;		/*< The HMC5883L polling or measurement trigger period in milliseconds */
+	uint8_t accelerometerDecimation;	/*< The number of gyroscope predictions per accelerometer correction */
+} command_settings_t;
+
+/**
+ * @brief Initializes the command channel
+ * @param[in] settings The runtime settings to operate on
+ * @param[in] transmitFifo The transmit buffer whose policy can be changed
+ */
+void Command_Init(command_settings_t *const settings, buffer_t *const transmitFifo);
+
+/**
+ * @brief Feeds a received byte into the command channel, executing complete commands
+ * @param[in] byte The received byte
+ * 
+ * Each command is answered with a {@see COMMAND_RESPONSE_TYPE} frame carrying the
+ * command identifier and a {@see command_status_t}. A baud rate change is answered
+ * at the old baud rate before switching.
+ * 
+ * {@see COMMAND_PING} appends three uint32 to the status: the echo argument, the
+ * microsecond time the request frame ended (see {@see Uart0_FrameEndTime}) and the
+ * microsecond time the response was queued for transmission.
+ */
+void Command_Process(uint8_t byte);
+
+#endif /* COMMAND_H_ */
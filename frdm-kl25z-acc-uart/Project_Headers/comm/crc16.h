@@ -0,0 +1,29 @@
+/*
+ * crc16.h
+ *
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef CRC16_H_
+#define CRC16_H_
+
+#include <stdint.h>
+
+/**
+ * @brief The initial CRC value
+ */
+#define CRC16_INITIAL_VALUE (0xFFFFU)
+
+/**
+ * @brief Updates a CRC-16 with the given data
+ * @param[in] crc The current CRC value; {@see CRC16_INITIAL_VALUE} for a new calculation
+ * @param[in] data The data
+ * @param[in] dataCount The number of data bytes
+ * @return The updated CRC value
+ */
+uint16_t CRC16_Update(register uint16_t crc, register const uint8_t *const data, register uint32_t dataCount);
+
+#endif /* CRC16_H_ */
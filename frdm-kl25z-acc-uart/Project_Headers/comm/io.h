@@ -10,6 +10,20 @@
 
 #include "ARMCM0plus.h"
 
+/**
+ * @brief The framing used by {@see IO_SendFramePrefixed}
+ */
+typedef enum {
+	IO_FRAMING_ESCAPE	= 0x00,	/*! P2PPE framing with preamble, length and ESC/XOR stuffing */
+	IO_FRAMING_COBS		= 0x01	/*! Consistent Overhead Byte Stuffing with zero delimiter */
+} io_framing_t;
+
+/**
+ * @brief Selects the framing used for outgoing frames
+ * @param[in] framing The framing
+ */
+void IO_SetFraming(io_framing_t framing);
+
 /**
  * @brief Sends a char without flushing the buffer.
  */
@@ -31,30 +45,6 @@ void IO_SendByte(uint8_t value);
  */
 void IO_SendInt16(int16_t value);
 
-/**
- * @brief Sends a signed 16bit value as string
- * @param[in] value The value to send
- * 
- * Must only be used after initialization of Uart0 interrupt.
- */
-void IO_SendSInt16AsString(int16_t value);
-
-/**
- * @brief Sends an unsigned 16bit value as string
- * @param[in] value The value to send
- * 
- * Must only be used after initialization of Uart0 interrupt.
- */
-void IO_SendUInt16AsString(uint16_t value);
-
-/**
- * @brief Sends a signed number in 2.12 format (signed 1.12)
- * @param[in] value The value to send
- * 
- * Must only be used after initialization of Uart0 interrupt.
- */
-void IO_Send2p14AsString(register int16_t value);
-
 /**
  * @brief Sends a 32bit value in native endianness
  * @param[in] value The value to send
@@ -87,6 +77,18 @@ void IO_SendZString(const char *const string);
  */
 void IO_SendBuffer(const uint8_t *const buffer, uint8_t length);
 
+/**
+ * @brief Sends a frame with a prefix using the selected framing
+ * @param[in] prefix The prefix data to send
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to send
+ * @param[in] dataCount The number of data bytes
+ * 
+ * Must only be used after initialization of Uart0 interrupt.
+ * {@see IO_SetFraming}
+ */
+void IO_SendFramePrefixed(const uint8_t *const prefix, uint8_t prefixCount, const uint8_t *const data, uint8_t dataCount);
+
 /**
  * @brief Flushes the IO.
  */
@@ -12,6 +12,31 @@
 
 #include "derivative.h"
 #include <stdint.h>
+#include "comm/buffer.h"
+
+/**
+ * @brief The byte terminating a P2PPE frame
+ *
+ * Escaped within the payload, so that it is seen on the wire at the end of a frame only.
+ */
+#define P2PPE_END_OF_FRAME (0x04)
+
+/**
+ * @brief The maximum payload length accepted by the decoder
+ */
+#define P2PPE_DECODER_MAX_LENGTH (16)
+
+/**
+ * @brief P2PPE decoder state
+ */
+typedef struct {
+	uint8_t state;			/*< The decoder state */
+	uint8_t lastByte;		/*< The previous byte, used for preamble detection */
+	uint8_t escape;			/*< Nonzero if the previous data byte was an escape */
+	uint8_t length;			/*< The announced payload length */
+	uint8_t count;			/*< The number of payload bytes decoded so far */
+	uint8_t data[P2PPE_DECODER_MAX_LENGTH];	/*< The decoded payload */
+} p2ppe_decoder_t;
 
 /**
  * @brief Begins a P2PPE Transmission
@@ -31,4 +56,82 @@ void P2PPE_Transmission(register const uint8_t*const data, register uint8_t data
  */
 void P2PPE_TransmissionPrefixed(register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount, register void (*sendHandler)(uint8_t dataByte));
 
+#define P2PPE_BUFFER_OK			(0) /*< the frame was encoded into the buffer */
+#define P2PPE_BUFFER_TOO_SMALL	(1) /*< the encoded frame is larger than the buffer */
+#define P2PPE_BUFFER_DROPPED	(2) /*< the frame was dropped according to the buffer policy */
+
+/**
+ * @brief Encodes a P2PPE Transmission with a prefix directly into a ring buffer
+ * @param[in] prefix The prefix data to send
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to send
+ * @param[in] dataCount The number of data bytes
+ * @param[in] buffer The ring buffer to encode into
+ * @return {@see P2PPE_BUFFER_OK} on success, {@see P2PPE_BUFFER_TOO_SMALL} or {@see P2PPE_BUFFER_DROPPED} otherwise
+ * 
+ * The whole encoded frame is reserved up front and published with a single index
+ * update, so the reader never observes a partial frame. Transmission must be
+ * triggered by the caller.
+ */
+uint8_t P2PPE_TransmissionPrefixedToBuffer(register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount, buffer_t *const buffer);
+
+/**
+ * @brief Determines the worst case length of a P2PPE frame
+ * @param[in] count The number of payload bytes
+ * @return The maximum number of bytes on the wire, including preamble, header and trailer
+ */
+#define P2PPE_MAX_LENGTH(count) (2*(count) + 5)
+
+/**
+ * @brief Determines the worst case length of a COBS frame
+ * @param[in] count The number of payload bytes
+ * @return The maximum number of bytes on the wire, including the delimiter
+ */
+#define P2PPE_COBS_MAX_LENGTH(count) ((count) + ((count) / 254) + 2)
+
+/**
+ * @brief Begins a COBS framed transmission with a prefix
+ * @param[in] prefix The prefix data to send
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to send
+ * @param[in] dataCount The number of data bytes
+ * @param[in] sendHandler The actual send function
+ * 
+ * The payload is encoded using Consistent Overhead Byte Stuffing and terminated
+ * with a zero byte. No preamble or length is sent; Overhead is one byte per 254
+ * payload bytes plus the delimiter, independent of the data.
+ */
+void P2PPE_CobsTransmissionPrefixed(register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount, register void (*sendHandler)(uint8_t dataByte));
+
+/**
+ * @brief Encodes a COBS framed transmission with a prefix directly into a ring buffer
+ * @param[in] prefix The prefix data to send
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to send
+ * @param[in] dataCount The number of data bytes
+ * @param[in] buffer The ring buffer to encode into
+ * @return {@see P2PPE_BUFFER_OK} on success, {@see P2PPE_BUFFER_TOO_SMALL} or {@see P2PPE_BUFFER_DROPPED} otherwise
+ * 
+ * The worst case length {@see P2PPE_COBS_MAX_LENGTH} is reserved and the actual
+ * frame is published at once. Transmission must be triggered by the caller.
+ */
+uint8_t P2PPE_CobsTransmissionPrefixedToBuffer(register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount, buffer_t *const buffer);
+
+/**
+ * @brief Resets a P2PPE decoder
+ * @param[in] decoder The decoder instance
+ */
+void P2PPE_DecoderInit(p2ppe_decoder_t *const decoder);
+
+/**
+ * @brief Feeds a byte into a P2PPE decoder
+ * @param[in] decoder The decoder instance
+ * @param[in] byte The received byte
+ * @return The payload length if a frame was completed with this byte, zero otherwise
+ * 
+ * Frames longer than {@see P2PPE_DECODER_MAX_LENGTH} are discarded.
+ * The payload is valid in decoder->data until the next call.
+ */
+uint8_t P2PPE_Decode(p2ppe_decoder_t *const decoder, register uint8_t byte);
+
 #endif /* P2PPROTOCOL_H_ */
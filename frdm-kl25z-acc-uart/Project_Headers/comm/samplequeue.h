@@ -0,0 +1,168 @@
+/*
+ * samplequeue.h
+ *
+ * Lock-free single producer, single consumer queues handing sensor register
+ * blocks from interrupt context to the main loop
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef SAMPLEQUEUE_H_
+#define SAMPLEQUEUE_H_
+
+#include <stdint.h>
+#include "ARMCM0plus.h"
+
+/**
+ * @brief The maximum number of slots per queue; Must be a power of two
+ */
+#define SAMPLEQUEUE_MAX_LENGTH	(8)
+
+/**
+ * @brief A queue of equally sized sample slots
+ *
+ * The producer reserves the slot at the write index and points the sensor
+ * transaction at it; only the completion of the transaction publishes the
+ * slot by advancing the write index. The consumer releases a slot by
+ * advancing the read index. Both indices run freely and are written by one
+ * side only, using single word stores, so neither side masks interrupts.
+ *
+ * A full queue is never overwritten. The reservation fails instead, the
+ * overflow is counted and the sequence number of the lost sample is skipped,
+ * so that the consumer sees the gap; {@see losses} sums up all gaps, including
+ * samples lost to failed transactions.
+ */
+typedef struct {
+	uint8_t *data;					/*< The slot storage of length*slotSize bytes */
+	uint16_t slotSize;				/*< The size of a slot in bytes */
+	uint8_t mask;					/*< The slot index mask; one less than the length */
+	volatile uint32_t writeIndex;	/*< The number of published slots; written by the producer only */
+	volatile uint32_t readIndex;	/*< The number of released slots; written by the consumer only */
+	uint32_t overflows;				/*< The number of reservations that found the queue full; written by the producer only */
+	uint16_t nextSequence;			/*< The sequence number of the next reservation; written by the producer only */
+	uint16_t expectedSequence;		/*< The sequence number following the last released slot; written by the consumer only */
+	uint32_t losses;				/*< The number of samples missing from the released sequence; written by the consumer only */
+	uint16_t sequence[SAMPLEQUEUE_MAX_LENGTH];	/*< The sequence number per slot */
+	uint32_t timestamp[SAMPLEQUEUE_MAX_LENGTH];	/*< The capture time per slot in microseconds, see {@see SysTick_Microseconds} */
+} sample_queue_t;
+
+/**
+ * @brief A published sample as seen by the consumer
+ */
+typedef struct {
+	const uint8_t *data;	/*< The register block of the sample */
+	uint32_t timestamp;		/*< The capture time in microseconds */
+	uint16_t sequence;		/*< The sequence number */
+} sample_entry_t;
+
+/**
+ * @brief Initializes a queue
+ * @param[in] queue The queue instance
+ * @param[in] data The slot storage of at least length*slotSize bytes
+ * @param[in] slotSize The size of a slot in bytes
+ * @param[in] length The number of slots; Must be a power of two of at most {@see SAMPLEQUEUE_MAX_LENGTH}
+ * @return Zero on success, nonzero if the configuration is invalid
+ */
+uint8_t SampleQueue_Init(sample_queue_t *const queue, void *const data, const uint16_t slotSize, const uint8_t length);
+
+/**
+ * @brief Determines if all slots are published or reserved
+ * @param[in] queue The queue instance
+ * @return Nonzero if {@see SampleQueue_Reserve} would fail
+ */
+static inline uint8_t SampleQueue_Full(const sample_queue_t *const queue)
+{
+	return (queue->writeIndex - queue->readIndex) > queue->mask;
+}
+
+/**
+ * @brief Reserves the next slot for a sample about to be read
+ * @param[in] queue The queue instance
+ * @param[in] timestamp The capture time of the sample in microseconds
+ * @return The slot to read the sample into, or NULL if the queue is full
+ *
+ * Producer side. Reserving again before {@see SampleQueue_Publish}, e.g. after a
+ * failed transaction, returns the same slot with a new sequence number.
+ */
+static inline uint8_t* SampleQueue_Reserve(sample_queue_t *const queue, const uint32_t timestamp)
+{
+	const uint32_t writeIndex = queue->writeIndex;
+	const uint16_t sequence = queue->nextSequence++;
+	if (SampleQueue_Full(queue))
+	{
+		++queue->overflows;
+		return 0;
+	}
+
+	const uint32_t slot = writeIndex & queue->mask;
+	queue->sequence[slot] = sequence;
+	queue->timestamp[slot] = timestamp;
+	return &queue->data[slot * queue->slotSize];
+}
+
+/**
+ * @brief Accounts for a sample that could not be read
+ * @param[in] queue The queue instance
+ *
+ * Producer side; skips a sequence number without touching the slots.
+ */
+static inline void SampleQueue_Skip(sample_queue_t *const queue)
+{
+	++queue->nextSequence;
+}
+
+/**
+ * @brief Publishes the reserved slot to the consumer
+ * @param[in] queue The queue instance
+ *
+ * Producer side; called from the completion of the transaction that filled the slot.
+ */
+static inline void SampleQueue_Publish(sample_queue_t *const queue)
+{
+	/* the slot contents must be visible before the index */
+	__DMB();
+	queue->writeIndex = queue->writeIndex + 1;
+}
+
+/**
+ * @brief Fetches the oldest published sample without releasing it
+ * @param[in] queue The queue instance
+ * @param[out] entry The sample
+ * @return Nonzero if a sample was available
+ *
+ * Consumer side. The slot stays owned by the consumer until {@see SampleQueue_Release}.
+ */
+static inline uint8_t SampleQueue_Peek(const sample_queue_t *const queue, sample_entry_t *const entry)
+{
+	const uint32_t readIndex = queue->readIndex;
+	if (queue->writeIndex == readIndex) return 0;
+
+	/* the index must be read before the slot contents */
+	__DMB();
+	const uint32_t slot = readIndex & queue->mask;
+	entry->data = &queue->data[slot * queue->slotSize];
+	entry->timestamp = queue->timestamp[slot];
+	entry->sequence = queue->sequence[slot];
+	return 1;
+}
+
+/**
+ * @brief Releases the oldest published sample
+ * @param[in] queue The queue instance
+ *
+ * Consumer side; must only follow a successful {@see SampleQueue_Peek}.
+ */
+static inline void SampleQueue_Release(sample_queue_t *const queue)
+{
+	const uint32_t readIndex = queue->readIndex;
+	const uint16_t sequence = queue->sequence[readIndex & queue->mask];
+	queue->losses += (uint16_t)(sequence - queue->expectedSequence);
+	queue->expectedSequence = sequence + 1;
+
+	/* the slot must be consumed before it is handed back */
+	__DMB();
+	queue->readIndex = readIndex + 1;
+}
+
+#endif /* SAMPLEQUEUE_H_ */
@@ -0,0 +1,122 @@
+/*
+ * scheduler.h
+ *
+ * Output stream scheduling with per-stream period, priority and byte budget
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdint.h>
+#include "comm/buffer.h"
+
+/**
+ * @brief The share of the raw link capacity available to scheduled streams, in percent
+ * 
+ * The remainder is headroom for command responses and unscheduled (e.g. batched) frames.
+ */
+#define SCHEDULER_LINK_UTILIZATION	(80)
+
+/**
+ * @brief The longest period a stream is stretched to before it is shed, in milliseconds
+ */
+#define SCHEDULER_MAX_PERIOD		(10000)
+
+/**
+ * @brief The maximum number of streams per scheduler
+ */
+#define SCHEDULER_MAX_STREAMS		(32)
+
+/**
+ * @brief An output stream
+ */
+typedef struct {
+	uint16_t period;			/*< The requested period in milliseconds; zero disables the stream */
+	uint8_t priority;			/*< The priority; lower values are more important */
+	uint16_t budget;			/*< The worst case number of bytes on the wire per transmission */
+	uint16_t admittedPeriod;	/*< The period admitted by {@see Scheduler_Admit}; zero if the stream is shed */
+	uint16_t reserve;			/*< The transmit buffer space to keep free for more important streams */
+	uint32_t lastTime;			/*< The time of the last transmission */
+	uint32_t skipped;			/*< The number of transmissions skipped due to a saturated link */
+} output_stream_t;
+
+/**
+ * @brief The output scheduler
+ */
+typedef struct {
+	output_stream_t *streams;	/*< The streams */
+	uint8_t count;				/*< The number of streams */
+	uint32_t capacity;			/*< The usable link capacity in bytes per second */
+	const buffer_t *transmitFifo;	/*< The transmit buffer */
+} output_scheduler_t;
+
+/**
+ * @brief Initializes the scheduler
+ * @param[in] scheduler The scheduler instance
+ * @param[in] streams The stream configurations, set up with period, priority and budget
+ * @param[in] count The number of streams
+ * @param[in] transmitFifo The transmit buffer used to detect link saturation
+ * @param[in] baudRate The link baud rate
+ */
+void Scheduler_Init(output_scheduler_t *const scheduler, output_stream_t *const streams, uint8_t count, const buffer_t *const transmitFifo, uint32_t baudRate);
+
+/**
+ * @brief Calculates the admissible stream periods
+ * @param[in] scheduler The scheduler instance
+ * 
+ * Streams are admitted in order of priority at their requested period while
+ * the link capacity suffices. The first stream that does not fit is stretched
+ * to the remaining capacity, or shed if that would exceed {@see SCHEDULER_MAX_PERIOD};
+ * either way, all less important streams are shed.
+ */
+void Scheduler_Admit(output_scheduler_t *const scheduler);
+
+/**
+ * @brief Changes the link baud rate and recalculates the admissible periods
+ * @param[in] scheduler The scheduler instance
+ * @param[in] baudRate The link baud rate
+ */
+void Scheduler_SetBaudRate(output_scheduler_t *const scheduler, uint32_t baudRate);
+
+/**
+ * @brief Changes a stream's period and recalculates the admissible periods
+ * @param[in] scheduler The scheduler instance
+ * @param[in] stream The stream index
+ * @param[in] period The requested period in milliseconds; zero disables the stream
+ * @return Zero on success, nonzero if the stream does not exist
+ */
+uint8_t Scheduler_SetPeriod(output_scheduler_t *const scheduler, uint8_t stream, uint16_t period);
+
+/**
+ * @brief Changes a stream's byte budget and recalculates the admissible periods
+ * @param[in] scheduler The scheduler instance
+ * @param[in] stream The stream index
+ * @param[in] budget The worst case number of bytes on the wire per transmission
+ * @return Zero on success, nonzero if the stream does not exist
+ */
+uint8_t Scheduler_SetBudget(output_scheduler_t *const scheduler, uint8_t stream, uint16_t budget);
+
+/**
+ * @brief Determines if a stream is due for transmission
+ * @param[in] scheduler The scheduler instance
+ * @param[in] stream The stream index
+ * @param[in] time The current system time in milliseconds
+ * @return Nonzero if the stream should be sent now
+ * 
+ * A due transmission is skipped if the transmit buffer cannot take it without
+ * eating into the space reserved for more important streams.
+ */
+uint8_t Scheduler_Due(output_scheduler_t *const scheduler, uint8_t stream, uint32_t time);
+
+/**
+ * @brief Determines the time until the next stream is due
+ * @param[in] scheduler The scheduler instance
+ * @param[in] time The current system time in milliseconds
+ * @return The time in milliseconds, zero if a stream is due now, or {@see SCHEDULER_MAX_PERIOD} if no stream is admitted
+ */
+uint32_t Scheduler_NextDue(const output_scheduler_t *const scheduler, uint32_t time);
+
+#endif /* SCHEDULER_H_ */
@@ -0,0 +1,116 @@
+/*
+ * trace.h
+ *
+ * Binary diagnostic messages: a message ID and raw arguments, formatted on the host
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Set to <code>0</code> to compile out every trace message
+ *
+ * A message costs a frame of two bytes plus four per argument and no formatting,
+ * so the traces stay enabled in release builds.
+ */
+#define TRACE_ENABLED	1
+
+/**
+ * @brief The frame type of the trace messages
+ *
+ * The frame holds the type, the {@see trace_id_t} and the arguments as little
+ * endian int32; the host derives the argument count from the frame length.
+ */
+#define TRACE_FRAME_TYPE	(0x68)
+
+/**
+ * @brief The trace messages as <code>TRACE_MESSAGE(name, id, format)</code>
+ *
+ * The format strings never reach the firmware image; the host reads them from
+ * this table (see matlab/protocol2/traceFormats.m) and applies them with
+ * sprintf semantics to the arguments. IDs must stay stable once released;
+ * append new messages instead of renumbering.
+ */
+#define TRACE_MESSAGES(TRACE_MESSAGE) \
+	TRACE_MESSAGE(TRACE_MMA8451Q_INITIALIZING,	0x01, "MMA8451Q: initializing ...") \
+	TRACE_MESSAGE(TRACE_MMA8451Q_FOUND,			0x02, "MMA8451Q: device found (WHO_AM_I 0x%02X).") \
+	TRACE_MESSAGE(TRACE_MMA8451Q_CONFIGURED,	0x03, "MMA8451Q: configuration done.") \
+	TRACE_MESSAGE(TRACE_MPU6050_INITIALIZING,	0x04, "MPU6050: initializing ...") \
+	TRACE_MESSAGE(TRACE_MPU6050_FOUND,			0x05, "MPU6050: device found (WHO_AM_I 0x%02X).") \
+	TRACE_MESSAGE(TRACE_MPU6050_CONFIGURED,		0x06, "MPU6050: configuration done.") \
+	TRACE_MESSAGE(TRACE_HMC5883L_INITIALIZING,	0x07, "HMC5883L: initializing ...") \
+	TRACE_MESSAGE(TRACE_HMC5883L_FOUND,			0x08, "HMC5883L: device found (identification 0x%06X).") \
+	TRACE_MESSAGE(TRACE_HMC5883L_CONFIGURED,	0x09, "HMC5883L: configuration done.") \
+	TRACE_MESSAGE(TRACE_PARAMETERS_LOADED,		0x0A, "parameters: loaded from flash.") \
+	TRACE_MESSAGE(TRACE_PARAMETERS_DEFAULTS,	0x0B, "parameters: using defaults.") \
+	TRACE_MESSAGE(TRACE_SENSOR_DROPOUT,			0x0C, "sensor %d: no fresh data for %d us.")
+
+#define TRACE_ENUMERATE(name, id, format)	name = id,
+
+/**
+ * @brief The trace message IDs, see {@see TRACE_MESSAGES}
+ */
+typedef enum {
+	TRACE_MESSAGES(TRACE_ENUMERATE)
+} trace_id_t;
+
+#undef TRACE_ENUMERATE
+
+#if TRACE_ENABLED
+
+/**
+ * @brief Sends a trace message
+ * @param[in] id The message
+ * @param[in] args The arguments
+ * @param[in] argCount The number of arguments
+ *
+ * Must only be used after initialization of Uart0 interrupt.
+ */
+void Trace_Send(const trace_id_t id, const int32_t *const args, const uint8_t argCount);
+
+#else
+
+#define Trace_Send(id, args, argCount)	((void)0)
+
+#endif
+
+/**
+ * @brief Sends a trace message without arguments
+ * @param[in] id The message
+ */
+static inline void Trace_Send0(const trace_id_t id)
+{
+	Trace_Send(id, 0, 0);
+}
+
+/**
+ * @brief Sends a trace message with one argument
+ * @param[in] id The message
+ * @param[in] a The argument
+ */
+static inline void Trace_Send1(const trace_id_t id, const int32_t a)
+{
+	const int32_t args[1] = { a };
+	Trace_Send(id, args, 1);
+	(void)args;
+}
+
+/**
+ * @brief Sends a trace message with two arguments
+ * @param[in] id The message
+ * @param[in] a The first argument
+ * @param[in] b The second argument
+ */
+static inline void Trace_Send2(const trace_id_t id, const int32_t a, const int32_t b)
+{
+	const int32_t args[2] = { a, b };
+	Trace_Send(id, args, 2);
+	(void)args;
+}
+
+#endif /* TRACE_H_ */
@@ -8,15 +8,25 @@
 #ifndef UART_H_
 #define UART_H_
 
+#include "cpu/bitflag.h"
+
 /**
- * @brief Enables or disables decorated storage support using the
- * Bit Manipulation Engine.
+ * @brief Enables or disables the DMA driven transmit path.
+ * 
+ * If enabled, DMA channel {@see UART0_TX_DMA_CHANNEL} drains contiguous
+ * spans of the write FIFO into UART0->D and an interrupt is only taken at
+ * the end of each span (i.e. once per frame or when the ring buffer wraps)
+ * instead of once per byte.
  */
-#define USE_BME 1
+#define UART_USE_DMA_TX 1
 
-#if USE_BME
-#include "bme.h"
-#endif
+/**
+ * @brief Enables or disables cycle counting of the UART0 interrupt handler.
+ * 
+ * If enabled, the core cycles spent in each RX and TX interrupt are measured
+ * using the SysTick counter and accumulated in {@see uart0_irq_profile_t}.
+ */
+#define UART_PROFILE_IRQ 0
 
 #include "nice_names.h"
 #include "buffer.h"
@@ -26,6 +36,49 @@
  */
 #define UART0_IRQ		(12)
 
+#if UART_USE_DMA_TX
+
+/*
+ * @brief The DMA channel used for UART0 transmission
+ */
+#define UART0_TX_DMA_CHANNEL	(0)
+
+/*
+ * @brief The IRQ number (not exception number!) for the UART0 TX DMA channel
+ */
+#define UART0_TX_DMA_IRQ		(UART0_TX_DMA_CHANNEL)
+
+/*
+ * @brief The DMAMUX request source for UART0 transmit
+ */
+#define UART0_TX_DMA_SOURCE		(3)
+
+#endif
+
+#if UART_PROFILE_IRQ
+
+/**
+ * @brief Cycle counts of an UART0 interrupt path
+ */
+typedef struct {
+	uint32_t count;			/*< The number of interrupts measured */
+	uint32_t minCycles;		/*< The minimum number of cycles per interrupt */
+	uint32_t maxCycles;		/*< The maximum number of cycles per interrupt */
+	uint32_t totalCycles;	/*< The sum of all measured cycles */
+} uart0_irq_profile_t;
+
+/**
+ * @brief The cycle counts of the receive interrupt path
+ */
+extern volatile uart0_irq_profile_t uart0ReceiveIrqProfile;
+
+/**
+ * @brief The cycle counts of the transmit interrupt path
+ */
+extern volatile uart0_irq_profile_t uart0TransmitIrqProfile;
+
+#endif
+
 /*
  * @brief Sets up the UART0 for 115.2 kbaud on PTA1/RX, PTA2/TX using PLL/2 clocking.
  */
@@ -36,16 +89,47 @@ void InitUart0();
  */
 void Uart0_InitializeIrq(buffer_t *restrict const readFifo, buffer_t *restrict const writeFifo);
 
+/**
+ * @brief Tests if a baud rate can be generated by UART0
+ * @param[in] baudRate The requested baud rate
+ * @return Zero if the baud rate can be generated within 3% error, nonzero otherwise
+ */
+uint8_t Uart0_ValidateBaudRate(uint32_t baudRate);
+
+/**
+ * @brief Reconfigures the UART0 baud rate at runtime
+ * @param[in] baudRate The requested baud rate
+ * @return Zero on success, nonzero if the baud rate can not be generated within 3% error
+ * 
+ * Blocks until all pending data has been transmitted at the old baud rate.
+ */
+uint8_t Uart0_SetBaudRate(uint32_t baudRate);
+
+/**
+ * @brief Returns the time the last P2PPE frame end was received
+ * @return The time in microseconds, see {@see SysTick_Microseconds}
+ * 
+ * Taken in the receive interrupt, so it does not include the delay until the main loop
+ * drains the read FIFO. It belongs to the frame just decoded as long as the host waits
+ * for the response before sending the next frame.
+ */
+uint32_t Uart0_FrameEndTime();
+
+#if UART_USE_DMA_TX
+
+/**
+ * @brief Starts a DMA transfer of the pending write FIFO contents if no transfer is in flight
+ */
+void Uart0_StartTransmitDma();
+
+#endif
+
 /**
  * @brief Enables the UART0 RX interrupt
  */
 static inline void Uart0_EnableReceiveIrq()
 {
-#if !USE_BME
-	UART0->C2 |= UART0_C2_RIE_MASK;
-#else
-	BME_OR_B(&UART0->C2, (1 << UART0_C2_RIE_SHIFT) & UART0_C2_RIE_MASK);
-#endif
+	BitFlag_Set8(&UART0->C2, UART0_C2_RIE_MASK);
 }
 
 /**
@@ -53,22 +137,20 @@ static inline void Uart0_EnableReceiveIrq()
  */
 static inline void Uart0_DisableReceiveIrq()
 {
-#if !USE_BME
-	UART0->C2 &= ~UART0_C2_RIE_MASK;
-#else
-	BME_AND_B(&UART0->C2, (uint8_t)~((1 << UART0_C2_RIE_SHIFT) & UART0_C2_RIE_MASK));
-#endif
+	BitFlag_Clear8(&UART0->C2, UART0_C2_RIE_MASK);
 }
 
 /**
  * @brief Enables the UART0 TX interrupt
+ * 
+ * If {@see UART_USE_DMA_TX} is set, this kicks the DMA transfer instead.
  */
 static inline void Uart0_EnableTransmitIrq()
 {
-#if !USE_BME
-	UART0->C2 |= UART0_C2_RIE_MASK;
+#if UART_USE_DMA_TX
+	Uart0_StartTransmitDma();
 #else
-	BME_OR_B(&UART0->C2, (1 << UART0_C2_TIE_SHIFT) & UART0_C2_TIE_MASK);
+	BitFlag_Set8(&UART0->C2, UART0_C2_TIE_MASK);
 #endif
 }
 
@@ -77,11 +159,7 @@ static inline void Uart0_EnableTransmitIrq()
  */
 static inline void Uart0_DisableTransmitIrq()
 {
-#if !USE_BME
-	UART0->C2 &= ~UART0_C2_TIE_MASK;
-#else
-	BME_AND_B(&UART0->C2, (uint8_t)~((1 << UART0_C2_TIE_SHIFT) & UART0_C2_TIE_MASK));
-#endif
+	BitFlag_Clear8(&UART0->C2, UART0_C2_TIE_MASK);
 }
 
 #endif /* UART_H_ */
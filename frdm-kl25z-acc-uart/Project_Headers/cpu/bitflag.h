@@ -0,0 +1,167 @@
+/*
+ * bitflag.h
+ *
+ * Atomic bit and bit field operations on peripheral registers shared by interrupt and main context
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef BITFLAG_H_
+#define BITFLAG_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Enables the decorated stores and loads of the Bit Manipulation Engine
+ *
+ * A decorated access performs the read-modify-write within a single bus
+ * transaction, so an interrupt cannot slip in between and no interrupt needs
+ * to be masked. Without it, the operations fall back to plain read-modify-write
+ * and are only atomic with respect to contexts that do not touch the register.
+ *
+ * The BME of the KL25Z decorates the peripheral bridge (0x4000_0000-0x4007_FFFF)
+ * only; SRAM state shared with interrupts is laid out as single bytes or words
+ * with one writer instead, see {@see SampleQueue_Reserve}.
+ */
+#define BITFLAG_USE_BME	1
+
+#if BITFLAG_USE_BME
+#include "bme.h"
+#endif
+
+/**
+ * @brief The BME capable alias of a GPIO instance
+ * @param[in] gpio The GPIO instance at 0x400F_F000
+ *
+ * The GPIO module sits outside the decorated range, but is aliased on the peripheral bridge at 0x4000_F000.
+ */
+#if BITFLAG_USE_BME
+#define BITFLAG_GPIO(gpio)	((GPIO_MemMapPtr)((uint32_t)(gpio) - 0x000F0000u))
+#else
+#define BITFLAG_GPIO(gpio)	(gpio)
+#endif
+
+/**
+ * @brief Sets bits of an 8 bit register
+ * @param[in] reg The register
+ * @param[in] mask The bits to set
+ */
+static inline void BitFlag_Set8(volatile uint8_t *const reg, const uint8_t mask)
+{
+#if BITFLAG_USE_BME
+	BME_OR_B(reg, mask);
+#else
+	*reg |= mask;
+#endif
+}
+
+/**
+ * @brief Clears bits of an 8 bit register
+ * @param[in] reg The register
+ * @param[in] mask The bits to clear
+ */
+static inline void BitFlag_Clear8(volatile uint8_t *const reg, const uint8_t mask)
+{
+#if BITFLAG_USE_BME
+	BME_AND_B(reg, (uint8_t)~mask);
+#else
+	*reg &= (uint8_t)~mask;
+#endif
+}
+
+/**
+ * @brief Acknowledges write-one-to-clear flags of an 8 bit register
+ * @param[in] reg The register
+ * @param[in] mask The flags to acknowledge
+ *
+ * Only the given flags that are set are written as one, so the other flags of the register stay pending.
+ */
+static inline void BitFlag_Acknowledge8(volatile uint8_t *const reg, const uint8_t mask)
+{
+#if BITFLAG_USE_BME
+	BME_AND_B(reg, mask);
+#else
+	*reg = *reg & mask;
+#endif
+}
+
+/**
+ * @brief Replaces a bit field of an 8 bit register
+ * @param[in] reg The register
+ * @param[in] value The field value, already shifted into position
+ * @param[in] bit The position of the lowest field bit
+ * @param[in] width The number of field bits
+ */
+static inline void BitFlag_Insert8(volatile uint8_t *const reg, const uint8_t value, const uint8_t bit, const uint8_t width)
+{
+#if BITFLAG_USE_BME
+	BME_BFI_B(reg, value, bit, width);
+#else
+	const uint8_t mask = (uint8_t)(((1u << width) - 1u) << bit);
+	*reg = (uint8_t)((*reg & ~mask) | (value & mask));
+#endif
+}
+
+/**
+ * @brief Sets bits of a 32 bit register
+ * @param[in] reg The register
+ * @param[in] mask The bits to set
+ */
+static inline void BitFlag_Set32(volatile uint32_t *const reg, const uint32_t mask)
+{
+#if BITFLAG_USE_BME
+	BME_OR_W(reg, mask);
+#else
+	*reg |= mask;
+#endif
+}
+
+/**
+ * @brief Clears bits of a 32 bit register
+ * @param[in] reg The register
+ * @param[in] mask The bits to clear
+ */
+static inline void BitFlag_Clear32(volatile uint32_t *const reg, const uint32_t mask)
+{
+#if BITFLAG_USE_BME
+	BME_AND_W(reg, ~mask);
+#else
+	*reg &= ~mask;
+#endif
+}
+
+/**
+ * @brief Acknowledges write-one-to-clear flags of a 32 bit register
+ * @param[in] reg The register
+ * @param[in] mask The flags to acknowledge
+ *
+ * Only the given flags that are set are written as one, so the other flags of the register stay pending.
+ */
+static inline void BitFlag_Acknowledge32(volatile uint32_t *const reg, const uint32_t mask)
+{
+#if BITFLAG_USE_BME
+	BME_AND_W(reg, mask);
+#else
+	*reg = *reg & mask;
+#endif
+}
+
+/**
+ * @brief Replaces a bit field of a 32 bit register
+ * @param[in] reg The register
+ * @param[in] value The field value, already shifted into position
+ * @param[in] bit The position of the lowest field bit
+ * @param[in] width The number of field bits; at most 16
+ */
+static inline void BitFlag_Insert32(volatile uint32_t *const reg, const uint32_t value, const uint8_t bit, const uint8_t width)
+{
+#if BITFLAG_USE_BME
+	BME_BFI_W(reg, value, bit, width);
+#else
+	const uint32_t mask = ((1u << width) - 1u) << bit;
+	*reg = (*reg & ~mask) | (value & mask);
+#endif
+}
+
+#endif /* BITFLAG_H_ */
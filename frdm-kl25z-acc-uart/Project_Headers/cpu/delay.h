@@ -10,6 +10,7 @@
 
 #include "ARMCM0plus.h"
 #include "derivative.h"
+#include "cpu/systick.h"
 
 /**
  * @brief The system tick counter
@@ -22,22 +23,29 @@ extern const volatile uint32_t SystemMilliseconds;
  */
 static inline uint32_t systemTime() 
 {
+#if SYSTICK_TICKLESS
+	/* the counter only advances when the time is read */
+	return SysTick_Milliseconds();
+#else
 	return SystemMilliseconds;
+#endif
 }
 
 
 /**
- * @brief Delays using the system tick counter
+ * @brief Delays by sleeping until a deadline
  * @param[in] ms The delay time in milliseconds
  * @return none.
+ *
+ * Other interrupts end the sleep early, so it is resumed until the deadline has passed.
  */
 static inline void delay_ms(const uint16_t ms) 
 {
-	const uint32_t start_ticks = SystemMilliseconds;
-	do {
-		__DSB();
-		__WFI();
-	} while((SystemMilliseconds - start_ticks) < ms);
+	const uint32_t deadline = SysTick_Microseconds() + (uint32_t)ms * 1000u;
+	while ((int32_t)(SysTick_Microseconds() - deadline) < 0)
+	{
+		SysTick_Sleep(deadline, 0);
+	}
 }
 
 #endif /* DELAY_H_ */
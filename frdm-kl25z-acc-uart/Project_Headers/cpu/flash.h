@@ -0,0 +1,40 @@
+/*
+ * flash.h
+ *
+ * Sector erase and longword programming through the FTFA flash controller
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef FLASH_H_
+#define FLASH_H_
+
+#include <stdint.h>
+
+/**
+ * @brief The size of an erasable flash sector in bytes
+ */
+#define FLASH_SECTOR_SIZE	(1024u)
+
+/**
+ * @brief Erases a flash sector
+ * @param[in] address The sector address, aligned to {@see FLASH_SECTOR_SIZE}
+ * @return 0 on success, otherwise the FTFA error flags (ACCERR, FPVIOL, MGSTAT0)
+ *
+ * Interrupts are masked for the duration of the erase, typically a few milliseconds.
+ */
+uint8_t Flash_EraseSector(const uint32_t address);
+
+/**
+ * @brief Programs erased flash longword by longword
+ * @param[in] address The destination address, aligned to four bytes
+ * @param[in] data The data
+ * @param[in] count The number of longwords
+ * @return 0 on success, otherwise the FTFA error flags of the failed longword
+ *
+ * Interrupts are masked while each longword is programmed.
+ */
+uint8_t Flash_Program(uint32_t address, const uint32_t *data, uint32_t count);
+
+#endif /* FLASH_H_ */
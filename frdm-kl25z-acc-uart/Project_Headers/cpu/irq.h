@@ -0,0 +1,179 @@
+/*
+ * irq.h
+ *
+ * Interrupt priority plan and interrupt latency measurement
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef IRQ_H_
+#define IRQ_H_
+
+#include <stdint.h>
+#include "ARMCM0plus.h"
+
+/**
+ * @brief Set to <code>1</code> to measure the interrupt handlers with the SysTick counter, reported with the link status
+ *
+ * Requires the periodic SysTick, i.e. no {@see SYSTICK_TICKLESS}.
+ */
+#define IRQ_PROFILE_ENABLED	0
+
+/**
+ * @brief Set to <code>1</code> to run the sensor decoding and fusion in the PendSV exception, raised by the read completions
+ *
+ * The main loop then only derives the outputs from the published fusion state,
+ * so a long UART write no longer delays the next fusion step.
+ */
+#define IRQ_FUSION_PENDSV	0
+
+/**
+ * @brief The interrupt sources, in the order of the priority plan
+ *
+ * The M0+ implements four priority levels. A data-ready edge is timestamped in
+ * {@see PORTA_Handler}, so the pin change interrupt must not wait for anything
+ * but the masked sections of the code. The I2C and DMA completions chain the
+ * next sensor read and come second, the per-byte UART0 interrupts third. The
+ * tick has the most slack, since {@see SysTick_Microseconds} counts a reload the
+ * handler has not served yet. The fusion steps of {@see IRQ_FUSION_PENDSV} span
+ * several ticks, so they take the lowest level and the tick moves up to the UART.
+ */
+typedef enum {
+	IRQ_SOURCE_SENSOR = 0,			/*< The sensor data-ready pin changes on PORTA */
+	IRQ_SOURCE_I2C = 1,				/*< The I2C0 and I2C1 byte transfers */
+	IRQ_SOURCE_I2C_DMA = 2,			/*< The I2C receive DMA completions */
+	IRQ_SOURCE_UART = 3,			/*< The UART0 receive and transmit interrupts */
+	IRQ_SOURCE_UART_DMA = 4,		/*< The UART0 transmit DMA completion */
+	IRQ_SOURCE_TICK = 5,			/*< The SysTick, or the LPTMR in tickless mode */
+	IRQ_SOURCE_FUSION = 6,			/*< The PendSV exception running the fusion steps */
+	IRQ_SOURCE_COUNT = 7			/*< The number of sources */
+} irq_source_t;
+
+/**
+ * @brief The priority levels of the plan; lower values preempt higher ones
+ */
+#define IRQ_PRIORITY_SENSOR		(0)		/* pin change capture */
+#define IRQ_PRIORITY_TRANSFER	(1)		/* I2C and DMA completion */
+#define IRQ_PRIORITY_COMM		(2)		/* UART0 */
+#if IRQ_FUSION_PENDSV
+#define IRQ_PRIORITY_TICK		(2)		/* system time */
+#else
+#define IRQ_PRIORITY_TICK		(3)		/* system time */
+#endif
+#define IRQ_PRIORITY_FUSION		(3)		/* sensor decoding and fusion, see IRQ_FUSION_PENDSV */
+
+/**
+ * @brief The IRQ number (not exception number!) of the PORTA pin change interrupt
+ */
+#define PORTA_IRQ				(30)
+
+/**
+ * @brief Assigns the planned priority to an interrupt, clears it and enables it
+ * @param[in] irq The IRQ number, or SysTick_IRQn and PendSV_IRQn for the system exceptions
+ * @param[in] source The source the interrupt belongs to
+ *
+ * The system exceptions cannot be disabled, so they only receive their priority.
+ */
+void Irq_Enable(const IRQn_Type irq, const irq_source_t source);
+
+/**
+ * @brief Clears the pending state of an interrupt
+ * @param[in] irq The IRQ number
+ *
+ * The NVIC registers are write-one; a read-modify-write would clear or set every other pending interrupt as well.
+ */
+static inline void Irq_ClearPending(const uint8_t irq)
+{
+	NVIC->ICPR[0] = 1u << irq;
+}
+
+/**
+ * @brief Pends an interrupt
+ * @param[in] irq The IRQ number
+ */
+static inline void Irq_SetPending(const uint8_t irq)
+{
+	NVIC->ISPR[0] = 1u << irq;
+}
+
+/**
+ * @brief Pends the fusion steps, see {@see IRQ_FUSION_PENDSV}
+ *
+ * Does nothing if the main loop runs the fusion steps itself.
+ */
+static inline void Irq_PendFusion(void)
+{
+#if IRQ_FUSION_PENDSV
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+#endif
+}
+
+/**
+ * @brief The exception entry and exit overhead in core cycles
+ *
+ * Taken from the Cortex-M0+ documentation for zero wait state memory; added
+ * once per handler to the measured durations.
+ */
+#define IRQ_OVERHEAD_CYCLES		(15u + 13u)
+
+/**
+ * @brief Timings of an interrupt source
+ */
+typedef struct {
+	uint32_t count;			/*< The number of handler runs measured */
+	uint32_t maxCycles;		/*< The longest handler run in core cycles, including preemption by higher levels */
+	uint32_t maxLatency;	/*< The worst-case entry latency in core cycles, see {@see Irq_UpdateLatency} */
+} irq_stats_t;
+
+#if IRQ_PROFILE_ENABLED
+
+#include "derivative.h"
+
+/**
+ * @brief The timings per source, indexed by {@see irq_source_t}
+ */
+extern volatile irq_stats_t irqStats[IRQ_SOURCE_COUNT];
+
+/**
+ * @brief The longest observed delay from the SysTick reload to the handler in core cycles
+ *
+ * The only latency measured directly, since the reload time is known; includes the
+ * masked sections of the code.
+ */
+extern volatile uint32_t irqTickLatency;
+
+/**
+ * @brief Accumulates the duration of a handler
+ * @param[in] source The source of the handler
+ * @param[in] start The SysTick counter value at the handler entry
+ */
+void Irq_Record(const irq_source_t source, const uint32_t start);
+
+/**
+ * @brief Derives the worst-case entry latency of every source from the measured handler durations
+ *
+ * A source waits for at most one running handler of its own level and for every
+ * handler of a higher level, each taken once. The masked sections of the code
+ * add on top for all levels; {@see irqTickLatency} bounds them from below.
+ */
+void Irq_UpdateLatency();
+
+/**
+ * @brief Marks the entry of a handler
+ */
+#define IRQ_PROFILE_ENTER()			const uint32_t irq_profile_start = SysTick_BASE_PTR->CVR
+
+/**
+ * @brief Marks the exit of a handler entered with {@see IRQ_PROFILE_ENTER}
+ */
+#define IRQ_PROFILE_EXIT(source)	Irq_Record(source, irq_profile_start)
+
+#else
+
+#define IRQ_PROFILE_ENTER()			((void)0)
+#define IRQ_PROFILE_EXIT(source)	((void)0)
+
+#endif
+
+#endif /* IRQ_H_ */
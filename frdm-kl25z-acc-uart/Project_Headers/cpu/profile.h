@@ -0,0 +1,110 @@
+/*
+* profile.h
+*
+*  Created on: Oct 14, 2026
+*      Author: agent
+*/
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+#include "ARMCM0plus.h"
+#include "derivative.h"
+#include "nice_names.h"
+
+/**
+ * @brief Set to <code>1</code> to measure the hot path sections with TPM1, reported with the link status
+ */
+#define PROFILE_ENABLED 0
+
+/**
+ * @brief The TPM1 prescaler as power of two; one count is 2^PROFILE_PRESCALER_SHIFT core cycles
+ *
+ * With the default of 3 the 16 bit counter wraps after 10.9 ms at 48 MHz, which bounds
+ * the longest section that can be measured.
+ */
+#ifndef PROFILE_PRESCALER_SHIFT
+#define PROFILE_PRESCALER_SHIFT	(3)
+#endif
+
+/**
+ * @brief The number of histogram buckets; bucket k counts durations of [2^k, 2^(k+1)) timer counts
+ */
+#define PROFILE_HISTOGRAM_BUCKETS	(16)
+
+/**
+ * @brief The profiled sections
+ */
+typedef enum {
+	PROFILE_FUSION_PREDICT = 0,		/*< fusion_predict and fusion_predict_batch */
+	PROFILE_FUSION_UPDATE = 1,		/*< The accelerometer, magnetometer and gyroscope updates */
+	PROFILE_MPU6050_READ = 2,		/*< Decoding the MPU6050 register or FIFO data */
+	PROFILE_HMC5883L_READ = 3,		/*< Decoding the HMC5883L register data */
+	PROFILE_MMA8451Q_READ = 4,		/*< Decoding the MMA8451Q register or FIFO data */
+	PROFILE_SENSOR_PREPARE = 5,		/*< The sensor_prepare_* conversions */
+	PROFILE_FRAME_ENCODE = 6,		/*< Encoding a frame into the transmit buffer */
+	PROFILE_UART_RECEIVE = 7,		/*< The receive path of the UART0 interrupt handler */
+	PROFILE_UART_TRANSMIT = 8,		/*< The transmit path of the UART0 interrupt handler */
+	PROFILE_SECTION_COUNT = 9		/*< The number of sections */
+} profile_section_t;
+
+/**
+ * @brief Timings of a profiled section
+ */
+typedef struct {
+	uint32_t count;			/*< The number of measurements */
+	uint32_t minCycles;		/*< The minimum number of cycles */
+	uint32_t maxCycles;		/*< The maximum number of cycles */
+	uint32_t totalCycles;	/*< The sum of all measured cycles */
+	uint16_t histogram[PROFILE_HISTOGRAM_BUCKETS];	/*< Saturating log2 histogram of the durations in timer counts */
+} profile_stats_t;
+
+/**
+ * @brief Initializes TPM1 as free running counter and clears the timings
+ *
+ * Available without {@see PROFILE_ENABLED} for other users of the counter, e.g. the benchmark firmware.
+ */
+void InitProfile();
+
+/**
+ * @brief Samples the free running counter
+ * @return The counter value
+ */
+static inline uint16_t Profile_Now()
+{
+	return (uint16_t)TPM1->CNT;
+}
+
+#if PROFILE_ENABLED
+
+/**
+ * @brief The timings per section, indexed by {@see profile_section_t}
+ */
+extern profile_stats_t profileStats[PROFILE_SECTION_COUNT];
+
+/**
+ * @brief Accumulates the duration of a section
+ * @param[in] section The section
+ * @param[in] start The {@see Profile_Now} value at the start of the section
+ */
+void Profile_Record(const profile_section_t section, const uint16_t start);
+
+/**
+ * @brief Marks the begin of a section within the current scope
+ */
+#define PROFILE_BEGIN(section)	const uint16_t TOKENPASTE(profile_start_, section) = Profile_Now()
+
+/**
+ * @brief Marks the end of a section started with {@see PROFILE_BEGIN} in the same scope
+ */
+#define PROFILE_END(section)	Profile_Record(section, TOKENPASTE(profile_start_, section))
+
+#else
+
+#define PROFILE_BEGIN(section)	((void)0)
+#define PROFILE_END(section)	((void)0)
+
+#endif
+
+#endif /* PROFILE_H_ */
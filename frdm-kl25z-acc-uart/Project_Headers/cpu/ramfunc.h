@@ -0,0 +1,44 @@
+/*
+ * ramfunc.h
+ *
+ * Placement of hot code in SRAM
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef RAMFUNC_H_
+#define RAMFUNC_H_
+
+/**
+ * @brief Enables the execution of the {@see RAMFUNC} functions from SRAM
+ *
+ * At 48 MHz core clock the flash runs at the 24 MHz bus clock, so every
+ * instruction fetch the flash prefetch buffer misses costs a wait state. Set
+ * to zero to compare against flash execution through the TPM1 profile:
+ * PROFILE_FUSION_PREDICT and PROFILE_FUSION_UPDATE cover the fusion kernels,
+ * PROFILE_UART_RECEIVE and PROFILE_UART_TRANSMIT the UART0 handler and
+ * IRQ_SOURCE_SENSOR of {@see IRQ_PROFILE_ENABLED} the PORTA handler.
+ */
+#ifndef RAMFUNC_ENABLED
+#define RAMFUNC_ENABLED	(1)
+#endif
+
+/**
+ * @brief Places a function in the .ramfunc section that the startup code copies to SRAM
+ *
+ * The function is not inlined and called through a register, since the branch
+ * from flash to SRAM is out of range of a bl instruction.
+ */
+#define RAMFUNC_REQUIRED	__attribute__((section(".ramfunc"), noinline, long_call))
+
+/**
+ * @brief Places a hot function in SRAM if {@see RAMFUNC_ENABLED} is set
+ */
+#if RAMFUNC_ENABLED
+#define RAMFUNC				RAMFUNC_REQUIRED
+#else
+#define RAMFUNC
+#endif
+
+#endif /* RAMFUNC_H_ */
@@ -8,15 +8,67 @@
 #ifndef SYSTICK_H_
 #define SYSTICK_H_
 
+#include <stdint.h>
+
 /**
 * @brief Defines for the system tick behaviour
 */
 
 #define SYSTICK_FREQUENCY		(4000u) /* Hz */
 
+/**
+* @brief Microseconds per system tick
+*/
+#define SYSTICK_PERIOD_US		(1000000u/SYSTICK_FREQUENCY)
+
+/**
+* @brief Set to <code>1</code> to count the time with the LPTMR instead of the periodic SysTick interrupt
+*
+* The LPTMR counts the crystal clock at 1 MHz and interrupts twice per 16 bit wrap-around only.
+* The SysTick becomes a one-shot timer ending {@see SysTick_Sleep} at the next deadline, so the
+* core wakes for sensor, UART and scheduled events instead of 4000 times per second.
+*/
+#define SYSTICK_TICKLESS		(0)
+
+/**
+* @brief Set to <code>1</code> to sleep in VLPS instead of WAIT where {@see SysTick_Sleep} permits it
+*
+* Only effective in tickless mode. The PLL is relocked after waking up; UART0 is not clocked
+* in VLPS, so data received meanwhile is lost.
+*/
+#define SYSTICK_TICKLESS_VLPS	(0)
+
+/**
+* @brief The longest sleep in microseconds; bounds the reaction to conditions that raise no interrupt
+*/
+#define SYSTICK_MAX_SLEEP_US	(100000u)
+
 /**
 * @brief Function to initialize the SysTick interrupt 
 */
 void InitSysTick();
 
+/**
+* @brief Returns the current system time in microseconds
+* @return The time; wraps around after approximately 71 minutes.
+*/
+uint32_t SysTick_Microseconds();
+
+/**
+* @brief Returns the current system time in milliseconds
+* @return The time.
+*/
+uint32_t SysTick_Milliseconds();
+
+/**
+* @brief Sleeps until the next interrupt or the deadline, whichever comes first
+* @param[in] deadline The wakeup time in microseconds, see {@see SysTick_Microseconds}
+* @param[in] deep Nonzero if no peripheral needs the bus clock, allowing VLPS
+*
+* May be called with interrupts masked, in which case an interrupt that became pending after
+* the caller's last check ends the sleep, but is only served once the caller unmasks. Without
+* {@see SYSTICK_TICKLESS}, the next tick ends the sleep regardless of the deadline.
+*/
+void SysTick_Sleep(const uint32_t deadline, const uint8_t deep);
+
 #endif /* SYSTICK_H_ */
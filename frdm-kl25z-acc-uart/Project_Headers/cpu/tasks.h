@@ -0,0 +1,112 @@
+/*
+ * tasks.h
+ *
+ * Cooperative tasks run by deadline or by event bits
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef TASKS_H_
+#define TASKS_H_
+
+#include <stdint.h>
+
+/**
+ * @brief The maximum number of tasks per scheduler
+ */
+#define TASKS_MAX_COUNT		(16)
+
+/**
+ * @brief A task function
+ * @param[in] now The current system time in milliseconds
+ */
+typedef void (*task_function_t)(const uint32_t now);
+
+/**
+ * @brief A task
+ *
+ * A task runs once per {@see Tasks_Run} if any of its event bits was signalled
+ * since the last call, and once more when its deadline has passed. Periodic
+ * tasks arm their next deadline themselves.
+ */
+typedef struct {
+	task_function_t run;	/*< The task function */
+	uint32_t events;		/*< The event bits that run the task */
+} task_t;
+
+/**
+ * @brief The task scheduler
+ *
+ * The armed deadlines are kept in a binary min-heap, so the next one is known
+ * without scanning the tasks and arming one takes O(log n).
+ */
+typedef struct {
+	const task_t *tasks;					/*< The tasks, in order of priority */
+	uint8_t count;							/*< The number of tasks */
+	uint8_t armed;							/*< The number of armed deadlines */
+	uint8_t heap[TASKS_MAX_COUNT];			/*< The tasks with an armed deadline, the earliest first */
+	uint8_t position[TASKS_MAX_COUNT];		/*< The heap position per task plus one; zero if no deadline is armed */
+	uint32_t deadline[TASKS_MAX_COUNT];		/*< The deadline per task in milliseconds */
+	volatile uint32_t events;				/*< The event bits signalled since the last {@see Tasks_Run} */
+} task_scheduler_t;
+
+/**
+ * @brief Initializes the scheduler
+ * @param[in] scheduler The scheduler instance
+ * @param[in] tasks The tasks, in order of priority
+ * @param[in] count The number of tasks, at most {@see TASKS_MAX_COUNT}
+ */
+void Tasks_Init(task_scheduler_t *const scheduler, const task_t *const tasks, uint8_t count);
+
+/**
+ * @brief Arms or moves the deadline of a task
+ * @param[in] scheduler The scheduler instance
+ * @param[in] task The task index
+ * @param[in] deadline The system time in milliseconds to run the task at
+ */
+void Tasks_Schedule(task_scheduler_t *const scheduler, uint8_t task, uint32_t deadline);
+
+/**
+ * @brief Disarms the deadline of a task
+ * @param[in] scheduler The scheduler instance
+ * @param[in] task The task index
+ */
+void Tasks_Cancel(task_scheduler_t *const scheduler, uint8_t task);
+
+/**
+ * @brief Signals event bits, running the tasks waiting for them with the next {@see Tasks_Run}
+ * @param[in] scheduler The scheduler instance
+ * @param[in] events The event bits
+ *
+ * May be called from any interrupt level.
+ */
+void Tasks_Signal(task_scheduler_t *const scheduler, uint32_t events);
+
+/**
+ * @brief Determines if event bits are signalled
+ * @param[in] scheduler The scheduler instance
+ * @return Nonzero if the next {@see Tasks_Run} has events to handle
+ */
+static inline uint8_t Tasks_Pending(const task_scheduler_t *const scheduler)
+{
+	return 0 != scheduler->events;
+}
+
+/**
+ * @brief Runs the tasks of the signalled events, then the tasks whose deadline has passed
+ * @param[in] scheduler The scheduler instance
+ * @param[in] now The current system time in milliseconds
+ * @return Nonzero if any task ran
+ */
+uint8_t Tasks_Run(task_scheduler_t *const scheduler, uint32_t now);
+
+/**
+ * @brief Determines the time until the next deadline
+ * @param[in] scheduler The scheduler instance
+ * @param[in] now The current system time in milliseconds
+ * @return The time in milliseconds, zero if a deadline has passed, or UINT32_MAX if none is armed
+ */
+uint32_t Tasks_Remaining(const task_scheduler_t *const scheduler, uint32_t now);
+
+#endif /* TASKS_H_ */
@@ -0,0 +1,52 @@
+/*
+* accelerometer_merge.h
+*
+*  Created on: Oct 14, 2026
+*      Author: agent
+*/
+
+#ifndef ACCELEROMETER_MERGE_H_
+#define ACCELEROMETER_MERGE_H_
+
+#include <stdint.h>
+#include "compiler.h"
+#include "fixmath.h"
+#include "fixvector3d.h"
+
+/*!
+* \def ACCELEROMETER_MERGE_MAX_AGE_US The age in microseconds up to which the sample of the other accelerometer is merged
+*
+* Covers one MMA8451Q FIFO burst, so that every MPU6050 sample finds a partner in FIFO mode.
+*/
+#define ACCELEROMETER_MERGE_MAX_AGE_US  (25000)
+
+/*!
+* \brief The accelerometers feeding the accelerometer observation
+*/
+typedef enum {
+    ACCELEROMETER_SOURCE_MPU6050 = 0,   /*< The MPU6050, defining the frame */
+    ACCELEROMETER_SOURCE_MMA8451Q = 1,  /*< The on-board MMA8451Q, rotated into the MPU6050 frame by its calibration */
+    ACCELEROMETER_SOURCE_COUNT = 2      /*< The number of accelerometers */
+} accelerometer_source_t;
+
+/*!
+* \brief Derives the per axis merge weights from the accelerometer variances
+*
+* Must be called after the parameters are loaded; forgets all samples.
+*/
+void accelerometer_merge_initialize() COLD;
+
+/*!
+* \brief Merges a prepared accelerometer sample with the latest sample of the other accelerometer
+* \param[in] source The accelerometer the sample stems from
+* \param[in] timestamp The capture time of the sample in microseconds
+* \param[in] sample The prepared sample in the MPU6050 frame
+* \param[out] merged The inverse variance weighted mean of both samples, or the sample itself if
+*                    the other accelerometer has no sample within {\ref ACCELEROMETER_MERGE_MAX_AGE_US}; may alias sample
+*
+* Each accelerometer thus provides an observation at its own rate, while the noise of
+* the observation drops to that of the weighted mean whenever both are live.
+*/
+void accelerometer_merge(const accelerometer_source_t source, const uint32_t timestamp, register const v3d *const sample, register v3d *const merged) HOT NONNULL;
+
+#endif // ACCELEROMETER_MERGE_H_
@@ -0,0 +1,57 @@
+/*
+* fast_normalize.h
+*
+*  Created on: Oct 14, 2026
+*      Author: agent
+*/
+
+#ifndef FAST_NORMALIZE_H_
+#define FAST_NORMALIZE_H_
+
+#include <stdbool.h>
+#include "compiler.h"
+#include "fixmath.h"
+#include "fixvector3d.h"
+
+/*!
+* \brief Calculates the reciprocal square root of a nonzero Q32.32 value
+* \param[in] square The value
+* \param[out] half_shift Half of the even normalization shift e
+* \return The reciprocal square root y of the normalized mantissa in Q2.30
+*
+* square = M * 2^(32-e) with M in [0.25, 1), hence 1/sqrt(square) = y * 2^(e/2-16).
+*/
+uint32_t rsqrt_q30(register uint64_t square, register uint_fast8_t *const half_shift) HOT LEAF NONNULL;
+
+/*!
+* \brief Calculates the reciprocal square root of a Q16.16 value.
+* \param[in] value The value, required to be positive
+* \return 1/sqrt(value) or fix16_maximum if value is not positive
+*
+* Seeds from a lookup table and refines with two Newton steps, without any division.
+* The result is within 0.53 LSB of the exact value.
+*/
+fix16_t fix16_rsqrt(register const fix16_t value) HOT CONST;
+
+/*!
+* \brief Normalizes a vector by multiplying with the reciprocal square root of its squared norm.
+* \param[out] dest The normalized vector, may be equal to src
+* \param[in] src The vector to normalize
+* \return false if the vector has zero length and dest was set to zero
+*
+* The squared norm is accumulated with full 64 bit precision, so that every component
+* is within 0.51 LSB of the exact unit vector. The sqrt + three fix16_div path of
+* v3d_normalize loses up to 3.3 LSB for unit length input due to the truncated squares,
+* and all precision for short vectors.
+*/
+bool v3d_normalize_fast(v3d *const dest, const v3d *const src) HOT NONNULL;
+
+/*!
+* \brief Normalizes a two component vector, see {\ref v3d_normalize_fast}.
+* \param[in,out] a The first component
+* \param[in,out] b The second component
+* \return false if the vector has zero length and was left unchanged
+*/
+bool fix16_normalize2_fast(fix16_t *RESTRICT const a, fix16_t *RESTRICT const b) HOT NONNULL;
+
+#endif // FAST_NORMALIZE_H_
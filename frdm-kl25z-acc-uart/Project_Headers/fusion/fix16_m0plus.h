@@ -0,0 +1,125 @@
+/*
+* fix16_m0plus.h
+*
+* Cortex-M0+ backend of the libfixmath multiplication, division and square root
+*
+*  Created on: Oct 14, 2026
+*      Author: agent
+*/
+
+#ifndef FIX16_M0PLUS_H_
+#define FIX16_M0PLUS_H_
+
+#include <stdint.h>
+#include "compiler.h"
+#include "fixmath.h"
+
+/*!
+* \def FIX16_M0PLUS_BACKEND Nonzero if the backend replaces the libfixmath functions
+*
+* The KL25Z4 configurations link with --wrap for fix16_mul, fix16_div and fix16_sqrt, which
+* redirects every call from outside the defining libfixmath unit to the __wrap_ functions of
+* the backend. The library implementations stay reachable as __real_ for the benchmark.
+*/
+#if defined(KL25Z4)
+#define FIX16_M0PLUS_BACKEND 1
+#else
+#define FIX16_M0PLUS_BACKEND 0
+#endif
+
+/*!
+* \brief Multiplies two unsigned 32 bit values to 64 bit
+* \param[in] a The first factor
+* \param[in] b The second factor
+* \return a*b
+*
+* The M0+ has no long multiply, so GCC calls the 64x64 bit __aeabi_lmul even for zero
+* extended operands. The four 16x16 bit partial products map to single cycle MULS instead.
+*/
+HOT CONST
+STATIC_INLINE uint64_t fix16_umul32(register const uint32_t a, register const uint32_t b)
+{
+    register const uint32_t al = a & 0xFFFF, ah = a >> 16;
+    register const uint32_t bl = b & 0xFFFF, bh = b >> 16;
+
+    register const uint32_t low = al * bl;
+    register const uint32_t high = ah * bh;
+
+    // neither sum can carry out, since (2^16-1)^2 + 2*(2^16-1) < 2^32
+    register const uint32_t middle = al * bh + (low >> 16);
+    register const uint32_t cross = ah * bl + (middle & 0xFFFF);
+
+    return ((uint64_t)(high + (middle >> 16) + (cross >> 16)) << 32) | ((cross << 16) | (low & 0xFFFF));
+}
+
+/*!
+* \brief Multiplies two Q16.16 values, see fix16_mul
+* \param[in] a The first factor
+* \param[in] b The second factor
+* \return a*b rounded half away from zero, or fix16_overflow
+*
+* Bit exact to the 64 bit libfixmath implementation. Factors below 1.0 in magnitude take
+* a single multiply.
+*/
+fix16_t fix16_mul_m0plus(register const fix16_t a, register const fix16_t b) HOT CONST;
+
+/*!
+* \brief Divides two Q16.16 values, see fix16_div
+* \param[in] a The dividend
+* \param[in] b The divisor
+* \return a/b rounded half away from zero, fix16_minimum if b is zero or fix16_overflow
+*
+* Scales a table-seeded Newton-Raphson reciprocal of the normalized divisor and corrects
+* the quotient through its remainder, so that the result is exact. For divisors of at least
+* 16.0 the kick-start estimate of libfixmath may be off by one LSB; the backend is not.
+*/
+fix16_t fix16_div_m0plus(register const fix16_t a, register const fix16_t b) HOT CONST;
+
+/*!
+* \brief Calculates the square root of a Q16.16 value, see fix16_sqrt
+* \param[in] value The value
+* \return sqrt(value) rounded to nearest; negative values yield -sqrt(-value) like libfixmath
+*
+* Scales the reciprocal square root of {\ref rsqrt_q30} and corrects the root through its
+* square, so that the result is always correctly rounded. Above 16.0 the two-pass rounding
+* of libfixmath rounds a few values in a million down; the backend does not.
+*/
+fix16_t fix16_sqrt_m0plus(register const fix16_t value) HOT CONST;
+
+#if FIX16_M0PLUS_BACKEND
+
+/*!
+* \def FIX16_BENCHMARK_ITERATIONS Number of calls per measured kernel
+*/
+#define FIX16_BENCHMARK_ITERATIONS  (1024)
+
+/*!
+* \brief The benchmarked kernels
+*/
+typedef enum {
+    FIX16_BENCHMARK_MUL = 0,    /*!< fix16_mul */
+    FIX16_BENCHMARK_DIV = 1,    /*!< fix16_div */
+    FIX16_BENCHMARK_SQRT = 2,   /*!< fix16_sqrt */
+    FIX16_BENCHMARK_COUNT = 3   /*!< The number of kernels */
+} fix16_benchmark_kernel_t;
+
+/*!
+* \brief Timing of a kernel against its libfixmath implementation
+*/
+typedef struct {
+    uint32_t reference;     /*!< microseconds for {\ref FIX16_BENCHMARK_ITERATIONS} calls of the libfixmath function */
+    uint32_t backend;       /*!< microseconds for {\ref FIX16_BENCHMARK_ITERATIONS} calls of the backend */
+    uint32_t mismatches;    /*!< number of results differing from libfixmath */
+} fix16_benchmark_t;
+
+/*!
+* \brief Times the backend against libfixmath on the same operands
+* \param[out] results The timings, indexed by {\ref fix16_benchmark_kernel_t}
+*
+* Requires the SysTick timer. Both loops carry the same call overhead, which is included.
+*/
+void fix16_m0plus_benchmark(fix16_benchmark_t results[FIX16_BENCHMARK_COUNT]) COLD NONNULL;
+
+#endif
+
+#endif // FIX16_M0PLUS_H_
@@ -0,0 +1,238 @@
+/*
+* fixed_matrix.h
+*
+*  Created on: Oct 14, 2026
+*      Author: agent
+*/
+
+#ifndef FIXED_MATRIX_H_
+#define FIXED_MATRIX_H_
+
+#include "compiler.h"
+#include "fixmath.h"
+#include "fixmatrix.h"
+
+/*!
+* \brief Fully unrolled matrix kernels with compile-time dimensions
+*
+* The kernels operate on mf16 storage but neither read nor check the runtime
+* dimensions and skip the per-element overflow detection of the generic
+* mf16 operations. Dimensions are passed as literal 1, 3 or 6.
+*/
+
+/************************************************************************/
+/* Unrolling helpers                                                    */
+/************************************************************************/
+
+// one family per nesting level, since a macro does not expand within itself
+#define FIXED_ROW_1(M, ...)     M(0, __VA_ARGS__)
+#define FIXED_ROW_3(M, ...)     M(0, __VA_ARGS__) M(1, __VA_ARGS__) M(2, __VA_ARGS__)
+#define FIXED_ROW_6(M, ...)     FIXED_ROW_3(M, __VA_ARGS__) M(3, __VA_ARGS__) M(4, __VA_ARGS__) M(5, __VA_ARGS__)
+
+#define FIXED_COLUMN_1(M, ...)  M(0, __VA_ARGS__)
+#define FIXED_COLUMN_3(M, ...)  M(0, __VA_ARGS__) M(1, __VA_ARGS__) M(2, __VA_ARGS__)
+#define FIXED_COLUMN_6(M, ...)  FIXED_COLUMN_3(M, __VA_ARGS__) M(3, __VA_ARGS__) M(4, __VA_ARGS__) M(5, __VA_ARGS__)
+
+#define FIXED_SUM_1(M, ...)     M(0, __VA_ARGS__)
+#define FIXED_SUM_3(M, ...)     M(0, __VA_ARGS__) M(1, __VA_ARGS__) M(2, __VA_ARGS__)
+#define FIXED_SUM_6(M, ...)     FIXED_SUM_3(M, __VA_ARGS__) M(3, __VA_ARGS__) M(4, __VA_ARGS__) M(5, __VA_ARGS__)
+
+/************************************************************************/
+/* Kernel generators                                                    */
+/************************************************************************/
+
+// sum += a(row, k) * b(k, column)
+#define FIXED_TERM_AB(k, a, b, row, column) \
+    sum = fix16_add(sum, fix16_mul((a)->data[row][k], (b)->data[k][column]));
+
+// sum += a(row, k) * b(column, k)
+#define FIXED_TERM_ABT(k, a, b, row, column) \
+    sum = fix16_add(sum, fix16_mul((a)->data[row][k], (b)->data[column][k]));
+
+#define FIXED_ELEMENT(column, row, K, TERM, dest, a, b) \
+    { \
+        register fix16_t sum = 0; \
+        FIXED_SUM_##K(TERM, a, b, row, column) \
+        (dest)->data[row][column] = sum; \
+    }
+
+#define FIXED_ROW(row, C, K, TERM, dest, a, b) \
+    FIXED_COLUMN_##C(FIXED_ELEMENT, row, K, TERM, dest, a, b)
+
+// upper triangle of dest -= a*b', mirrored to the lower triangle
+#define FIXED_SYMMETRIC_ELEMENT(column, row, K, a, b, dest) \
+    if (column >= row) \
+    { \
+        register fix16_t sum = 0; \
+        FIXED_SUM_##K(FIXED_TERM_ABT, a, b, row, column) \
+        sum = fix16_sub((dest)->data[row][column], sum); \
+        (dest)->data[row][column] = sum; \
+        (dest)->data[column][row] = sum; \
+    }
+
+#define FIXED_SYMMETRIC_ROW(row, N, K, a, b, dest) \
+    FIXED_COLUMN_##N(FIXED_SYMMETRIC_ELEMENT, row, K, a, b, dest)
+
+/*!
+* \def FIXED_MATRIX_MUL Defines name(dest, a, b) calculating dest = a*b with a being RxK and b being KxC
+*/
+#define FIXED_MATRIX_MUL(name, R, K, C) \
+    HOT NONNULL LEAF \
+    STATIC_INLINE void name(mf16 *RESTRICT const dest, const mf16 *RESTRICT const a, const mf16 *RESTRICT const b) \
+    { \
+        FIXED_ROW_##R(FIXED_ROW, C, K, FIXED_TERM_AB, dest, a, b) \
+        dest->rows = R; \
+        dest->columns = C; \
+    }
+
+/*!
+* \def FIXED_MATRIX_MUL_BT Defines name(dest, a, b) calculating dest = a*b' with a being RxK and b being CxK
+*/
+#define FIXED_MATRIX_MUL_BT(name, R, K, C) \
+    HOT NONNULL LEAF \
+    STATIC_INLINE void name(mf16 *RESTRICT const dest, const mf16 *RESTRICT const a, const mf16 *RESTRICT const b) \
+    { \
+        FIXED_ROW_##R(FIXED_ROW, C, K, FIXED_TERM_ABT, dest, a, b) \
+        dest->rows = R; \
+        dest->columns = C; \
+    }
+
+/*!
+* \def FIXED_MATRIX_SUB_ABT_SYMMETRIC Defines name(dest, a, b) calculating dest = dest - a*b' with a and b being NxK
+*
+* Only valid if the result is known to be symmetric, e.g. for P - K*(P*H')'. The upper
+* triangle is calculated and mirrored.
+*/
+#define FIXED_MATRIX_SUB_ABT_SYMMETRIC(name, N, K) \
+    HOT NONNULL LEAF \
+    STATIC_INLINE void name(mf16 *RESTRICT const dest, const mf16 *RESTRICT const a, const mf16 *RESTRICT const b) \
+    { \
+        FIXED_ROW_##N(FIXED_SYMMETRIC_ROW, N, K, a, b, dest) \
+    }
+
+/************************************************************************/
+/* Kernels of the 6-state filters                                       */
+/************************************************************************/
+
+/*!
+* \brief Calculates dest = a*b for 6x6 matrices
+*/
+FIXED_MATRIX_MUL(mf16_mul_6x6_6x6, 6, 6, 6)
+
+/*!
+* \brief Calculates dest = a*b for a 6x6 matrix and a 6x1 vector
+*/
+FIXED_MATRIX_MUL(mf16_mul_6x6_6x1, 6, 6, 1)
+
+/*!
+* \brief Calculates dest = a*b for a 3x6 matrix and a 6x1 vector
+*/
+FIXED_MATRIX_MUL(mf16_mul_3x6_6x1, 3, 6, 1)
+
+/*!
+* \brief Calculates dest = a*b for a 3x6 and a 6x3 matrix
+*/
+FIXED_MATRIX_MUL(mf16_mul_3x6_6x3, 3, 6, 3)
+
+/*!
+* \brief Calculates dest = a*b for a 6x3 matrix and a 3x3 matrix
+*/
+FIXED_MATRIX_MUL(mf16_mul_6x3_3x3, 6, 3, 3)
+
+/*!
+* \brief Calculates dest = a*b for a 6x3 matrix and a 3x1 vector
+*/
+FIXED_MATRIX_MUL(mf16_mul_6x3_3x1, 6, 3, 1)
+
+/*!
+* \brief Calculates dest = a*b' for 6x6 matrices
+*/
+FIXED_MATRIX_MUL_BT(mf16_mul_bt_6x6_6x6, 6, 6, 6)
+
+/*!
+* \brief Calculates dest = a*b' for a 6x6 and a 3x6 matrix
+*/
+FIXED_MATRIX_MUL_BT(mf16_mul_bt_6x6_3x6, 6, 6, 3)
+
+/*!
+* \brief Calculates the symmetric dest = dest - a*b' for 6x6 matrices
+*/
+FIXED_MATRIX_SUB_ABT_SYMMETRIC(mf16_sub_abt_symmetric_6x6, 6, 6)
+
+/*!
+* \brief Calculates the symmetric dest = dest - a*b' for 6x3 matrices
+*/
+FIXED_MATRIX_SUB_ABT_SYMMETRIC(mf16_sub_abt_symmetric_6x3, 6, 3)
+
+/************************************************************************/
+/* Kernels of the 3-state axis filter                                   */
+/************************************************************************/
+
+/*!
+* \brief Calculates dest = a*b for 3x3 matrices
+*/
+FIXED_MATRIX_MUL(mf16_mul_3x3_3x3, 3, 3, 3)
+
+/*!
+* \brief Calculates dest = a*b for a 3x3 matrix and a 3x1 vector
+*/
+FIXED_MATRIX_MUL(mf16_mul_3x3_3x1, 3, 3, 1)
+
+/*!
+* \brief Calculates dest = a*b' for 3x3 matrices
+*/
+FIXED_MATRIX_MUL_BT(mf16_mul_bt_3x3_3x3, 3, 3, 3)
+
+/*!
+* \brief Calculates the symmetric dest = dest - a*b' for 3x3 matrices
+*/
+FIXED_MATRIX_SUB_ABT_SYMMETRIC(mf16_sub_abt_symmetric_3x3, 3, 3)
+
+/************************************************************************/
+/* Right-sized storage                                                  */
+/************************************************************************/
+
+/*!
+* \def FIXED_MATRIX_TYPE Defines the type name of an RxC matrix
+*
+* The fields match mf16, so that elements are accessed as data[row][column] alike,
+* but the rows are not padded to FIXMATRIX_MAX_SIZE. The type must therefore not be
+* passed to the mf16 operations or the kernels above.
+*/
+#define FIXED_MATRIX_TYPE(name, R, C) \
+    typedef struct { \
+        uint8_t rows; \
+        uint8_t columns; \
+        uint8_t errors; \
+        fix16_t data[R][C]; \
+    } name;
+
+/*!
+* \def FIXED_DIAGONAL_TYPE Defines the type name of an NxN diagonal matrix storing its diagonal only
+*
+* The element (i, i) is accessed as data[i].
+*/
+#define FIXED_DIAGONAL_TYPE(name, N) \
+    typedef struct { \
+        uint8_t rows; \
+        uint8_t columns; \
+        uint8_t errors; \
+        fix16_t data[N]; \
+    } name;
+
+/*!
+* \brief A 6x6 matrix
+*/
+FIXED_MATRIX_TYPE(mf16_6x6_t, 6, 6)
+
+/*!
+* \brief A 6x1 vector
+*/
+FIXED_MATRIX_TYPE(mf16_6x1_t, 6, 1)
+
+/*!
+* \brief A 6x6 diagonal matrix
+*/
+FIXED_DIAGONAL_TYPE(mf16_diagonal6_t, 6)
+
+#endif // FIXED_MATRIX_H_
@@ -0,0 +1,51 @@
+/*
+* magnetometer_calibration.h
+*
+*  Created on: Oct 14, 2026
+*      Author: agent
+*/
+
+#ifndef MAGNETOMETER_CALIBRATION_H_
+#define MAGNETOMETER_CALIBRATION_H_
+
+#include <stdbool.h>
+#include "compiler.h"
+#include "fixmath.h"
+#include "fixvector3d.h"
+#include "fusion/sensor_calibration.h"
+
+/*!
+* \def MAGNETOMETER_CALIBRATION_ONLINE Set to <code>1</code> to refine the HMC5883L calibration on the device
+*/
+#define MAGNETOMETER_CALIBRATION_ONLINE 1
+
+/*!
+* \brief Resets the ellipsoid fit
+*/
+void magnetometer_calibration_initialize() COLD;
+
+/*!
+* \brief Feeds a calibrated magnetometer sample into the ellipsoid fit and advances the update in progress
+* \param[in] sample The sample as prepared by {\ref sensor_prepare_hmc5883l_data}, or NULL to only advance the update
+* \return true if the fit converged and a correction is available through {\ref magnetometer_calibration_fetch}
+*
+* Samples closer than a few degrees to the last accepted one are dropped, so that the
+* fit runs at a low rate and is not dominated by a resting sensor. The update of an
+* accepted sample is spread over the next 20 calls, which drop their samples, so it
+* should be called with every fusion step rather than with the magnetometer samples only.
+*/
+bool magnetometer_calibration_update(register const v3d *const sample) HOT;
+
+/*!
+* \brief Retrieves the correction of the converged fit and restarts the fit
+* \param[out] correction The affine correction mapping the current calibrated data onto a sphere
+* \return false if the fit does not describe a valid ellipsoid or the correction is within the
+*         noise of the current calibration; the fit is restarted regardless
+*
+* The sphere keeps the geometric mean radius of the ellipsoid, so that the field magnitude
+* is unchanged on average. The correction is to be composed with the current calibration,
+* see {\ref sensor_prepare_correct_hmc5883l}.
+*/
+bool magnetometer_calibration_fetch(calibration_matrix_t *const correction) NONNULL;
+
+#endif // MAGNETOMETER_CALIBRATION_H_
@@ -0,0 +1,45 @@
+/*
+* orientation_pack.h
+*
+*  Created on: Oct 14, 2026
+*      Author: agent
+*/
+
+#ifndef ORIENTATION_PACK_H_
+#define ORIENTATION_PACK_H_
+
+#include <stdint.h>
+#include "compiler.h"
+#include "fixmath.h"
+#include "fixquat.h"
+
+/*!
+* \brief Packs a unit quaternion into four signed Q1.14 values.
+* \param[out] packed The packed components a, b, c, d
+* \param[in] quat The unit quaternion
+*/
+void orientation_pack_q14(int16_t packed[4], const qf16 *const quat) HOT NONNULL;
+
+/*!
+* \brief Packs angles in radians into signed Q2.13 values.
+* \param[out] packed The packed roll, pitch, yaw angles
+* \param[in] roll The roll angle in radians
+* \param[in] pitch The pitch angle in radians
+* \param[in] yaw The yaw angle in radians
+*/
+void orientation_pack_angles_q13(int16_t packed[3], fix16_t roll, fix16_t pitch, fix16_t yaw) HOT NONNULL;
+
+/*!
+* \brief Packs a unit quaternion using the smallest-three encoding.
+*
+* The largest component is dropped and its sign is folded into the others, so
+* it can be restored from the unit norm constraint. The remaining components lie in
+* [-1/sqrt(2), 1/sqrt(2)] and are scaled by sqrt(2) into Q1.15. The index of the dropped
+* component is stored in the least significant bits of the first (bit 0) and second (bit 1) value.
+*
+* \param[out] packed The packed components
+* \param[in] quat The unit quaternion
+*/
+void orientation_pack_smallest_three(int16_t packed[3], const qf16 *const quat) HOT NONNULL;
+
+#endif
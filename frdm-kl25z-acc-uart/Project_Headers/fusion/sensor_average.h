@@ -0,0 +1,65 @@
+/*
+* sensor_average.h
+*
+*  Created on: Oct 14, 2026
+*      Author: agent
+*/
+
+#ifndef SENSOR_AVERAGE_H_
+#define SENSOR_AVERAGE_H_
+
+#include <stdint.h>
+#include "compiler.h"
+#include "fixmath.h"
+#include "fixvector3d.h"
+
+/*!
+* \def SENSOR_AVERAGE_MAX_REPLICAS The maximum number of redundant sensors per quantity, including the primary
+*/
+#define SENSOR_AVERAGE_MAX_REPLICAS     (4)
+
+/*!
+* \def SENSOR_AVERAGE_MAX_AGE_US The time difference in microseconds up to which a replica sample is averaged
+*
+* Covers one MPU6050 sample period at 100 Hz, since the replicas run on their own clocks.
+*/
+#define SENSOR_AVERAGE_MAX_AGE_US       (10000)
+
+/*!
+* \brief The quantities measured redundantly, in the order of the sensor channels
+*/
+typedef enum {
+    SENSOR_AVERAGE_ACCELEROMETER = 0,   /*< Acceleration */
+    SENSOR_AVERAGE_GYROSCOPE = 1,       /*< Angular rate */
+    SENSOR_AVERAGE_MAGNETOMETER = 2,    /*< Magnetic field */
+    SENSOR_AVERAGE_QUANTITY_COUNT = 3   /*< The number of quantities */
+} sensor_average_quantity_t;
+
+/*!
+* \brief Forgets all replica samples
+*/
+void sensor_average_initialize() COLD;
+
+/*!
+* \brief Keeps the prepared sample of a replica until the primary sensor delivers
+* \param[in] quantity The quantity measured
+* \param[in] replica The replica in 1 .. {\ref SENSOR_AVERAGE_MAX_REPLICAS}-1
+* \param[in] timestamp The capture time of the sample in microseconds
+* \param[in] sample The prepared sample in the primary's frame
+*/
+void sensor_average_record(const sensor_average_quantity_t quantity, const uint8_t replica, const uint32_t timestamp, register const v3d *const sample) HOT NONNULL;
+
+/*!
+* \brief Averages a prepared sample of the primary sensor with the latest replica samples
+* \param[in] quantity The quantity measured
+* \param[in] timestamp The capture time of the sample in microseconds
+* \param[in] sample The prepared sample
+* \param[out] averaged The mean of the sample and all replica samples captured within
+*                      {\ref SENSOR_AVERAGE_MAX_AGE_US}, or the sample itself; may alias sample
+*
+* The primary thus paces the observations, while the noise of the observation drops
+* with the number of live replicas; a replica that stops delivering simply ages out.
+*/
+void sensor_average(const sensor_average_quantity_t quantity, const uint32_t timestamp, register const v3d *const sample, register v3d *const averaged) HOT NONNULL;
+
+#endif // SENSOR_AVERAGE_H_
@@ -12,6 +12,39 @@
 #include "fixmath.h"
 #include "fixvector3d.h"
 
+/*!
+* \brief A 3x4 affine transformation; the last column is the offset
+*/
+typedef fix16_t calibration_matrix_t[3][4];
+
+/*!
+* \brief Retrieves the affine calibration of the MPU6050 accelerometer
+* \return The 3x4 transformation applied to the scaled sensor data
+*/
+LEAF
+const calibration_matrix_t *mpu6050_accelerometer_calibration();
+
+/*!
+* \brief Retrieves the affine calibration of the MPU6050 gyroscope
+* \return The 3x4 transformation applied to the scaled sensor data in degree per second
+*/
+LEAF
+const calibration_matrix_t *mpu6050_gyroscope_calibration();
+
+/*!
+* \brief Retrieves the affine calibration of the HMC5883L magnetometer
+* \return The 3x4 transformation applied to the scaled sensor data
+*/
+LEAF
+const calibration_matrix_t *hmc5883l_calibration();
+
+/*!
+* \brief Retrieves the affine calibration of the MMA8451Q accelerometer
+* \return The 3x4 transformation applied to the scaled sensor data, rotating it into the MPU6050 frame
+*/
+LEAF
+const calibration_matrix_t *mma8451q_accelerometer_calibration();
+
 /*!
 * \brief Calibrates MPU6050 accelerometer sensor data
 * \param[inout] x The x data (will be overwritten with the calibrated version)
@@ -96,4 +129,13 @@ void mpu6050_var_gyroscope(register fix16_t *const RESTRICT x, register fix16_t
 LEAF NONNULL
 void hmc5883l_var(register fix16_t *const RESTRICT x, register fix16_t *const RESTRICT y, register fix16_t *const RESTRICT z);
 
+/*!
+* \brief Retrieves the variances of the MMA8451Q accelerometer
+* \param[out] x The x axis variances
+* \param[out] y The y axis variances
+* \param[out] z The z axis variances
+*/
+LEAF NONNULL
+void mma8451q_var_accelerometer(register fix16_t *const RESTRICT x, register fix16_t *const RESTRICT y, register fix16_t *const RESTRICT z);
+
 #endif // SENSOR_CALIBRATIOn_H
\ No newline at end of file
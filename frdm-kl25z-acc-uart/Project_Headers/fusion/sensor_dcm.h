@@ -8,15 +8,32 @@
 #ifndef SENSOR_DDCM_H_
 #define SENSOR_DDCM_H_
 
+#include <stdbool.h>
+
 #include "compiler.h"
 #include "fixmatrix.h"
 #include "fixvector3d.h"
 
+/*!
+* \brief Builds the north, east and down axes from the given calibrated sensor values (TRIAD)
+* \param[out] north The north axis in body coordinates
+* \param[out] east The east axis in body coordinates
+* \param[out] down The down axis in body coordinates
+* \param[in] a The accelerometer vector.
+* \param[in] m The magnetometer vector
+* \return false if a is zero or parallel to m; the axes are undefined then
+*
+* The axes are the rows of the DCM as defined by {\ref fusion_fetch_dcm}.
+*/
+bool sensor_triad(v3d *RESTRICT const north, v3d *RESTRICT const east, v3d *RESTRICT const down, const v3d *RESTRICT const a, const v3d *RESTRICT const m) HOT NONNULL;
+
 /*!
 * \brief Builds a DCM from the given calibrated sensor values
 * \param[out] dcm The DCM matrix to write to
 * \param[in] a The accelerometer vector.
 * \param[in] m The magnetometer vector
+*
+* Sets FIXMATRIX_SINGULAR in the errors of the DCM if a is zero or parallel to m.
 */
 void sensor_dcm(mf16 *const dcm, const v3d *RESTRICT const a, const v3d *RESTRICT const m) HOT NONNULL;
 
@@ -13,6 +13,52 @@
 #include "fixmatrix.h"
 #include "fixquat.h"
 
+/*!
+* \def FUSION_ENGINE_KALMAN Selects the dual 6-state Kalman filter, see sensor_fusion.c
+*/
+#define FUSION_ENGINE_KALMAN    (0)
+
+/*!
+* \def FUSION_ENGINE_MAHONY Selects the quaternion complementary (Mahony) filter, see sensor_fusion_mahony.c
+*/
+#define FUSION_ENGINE_MAHONY    (1)
+
+/*!
+* \def FUSION_ENGINE The fusion engine implementing this interface
+*/
+#ifndef FUSION_ENGINE
+#define FUSION_ENGINE FUSION_ENGINE_KALMAN
+#endif
+
+/*!
+* \def FUSION_FAST_TRIG Derives the output angles with the lookup tables of fast_trig.h instead of fix16_asin and fix16_atan2
+*/
+#ifndef FUSION_FAST_TRIG
+#define FUSION_FAST_TRIG 1
+#endif
+
+/*!
+* \brief Stages of a fusion step whose fixed-point overflows are counted
+*/
+typedef enum {
+    FUSION_STAGE_PREDICT = 0,       /*!< State and covariance prediction */
+    FUSION_STAGE_ACCELEROMETER = 1, /*!< Accelerometer correction */
+    FUSION_STAGE_MAGNETOMETER = 2,  /*!< Magnetometer correction */
+    FUSION_STAGE_GYROSCOPE = 3,     /*!< Gyroscope-only correction */
+    FUSION_STAGE_SANITIZE = 4,      /*!< Re-normalization of the axes */
+    FUSION_STAGE_OUTPUT = 5,        /*!< Derivation of the direction cosine matrix */
+    FUSION_STAGE_COUNT = 6
+} fusion_stage_t;
+
+/*!
+* \brief The fixed-point overflows and filter resets between two reports
+*/
+typedef struct {
+    uint16_t overflows[FUSION_STAGE_COUNT]; /*!< Saturating count of overflows found after every {\ref fusion_stage_t} */
+    uint16_t covarianceResets;              /*!< Saturating count of covariances reset to their initial variances */
+    uint16_t stateResets;                   /*!< Saturating count of states bootstrapped anew */
+} fusion_overflow_report_t;
+
 /*!
 * \brief Initializes the sensor fusion mechanism.
 */
@@ -35,12 +81,35 @@ void fusion_fetch_angles(register fix16_t *RESTRICT const roll, register fix16_t
 HOT NONNULL LEAF
 void fusion_fetch_quaternion(register qf16 *RESTRICT const quat);
 
+/*!
+* \brief Fetches the direction cosine matrix.
+* \param[out] dcm The 3x3 DCM with the north, east and down axes in body coordinates as rows
+*
+* The angles, the quaternion and the DCM are derived at most once between two filter
+* updates, so fetching several representations of the same state is cheap.
+*/
+HOT NONNULL LEAF
+void fusion_fetch_dcm(register mf16 *RESTRICT const dcm);
+
 /*!
 * \brief Performs a prediction of the current Euler angles based on the time difference to the prediction or observation update call.
 * \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
 */
 void fusion_predict(register const fix16_t deltaT) HOT;
 
+/*!
+* \brief Performs a prediction over a burst of gyroscope samples.
+* \param[in] gyro The gyroscope samples, oldest first.
+* \param[in] deltaT The time difference in seconds of every sample to its predecessor.
+* \param[in] count The number of samples.
+*
+* The DCM axes are integrated with every sample while the covariance is propagated once
+* using the accumulated transition. The estimated angular velocities are left to the
+* following gyroscope correction. {\ref fusion_predict} is the single step case using
+* the estimated angular velocities.
+*/
+void fusion_predict_batch(const v3d *const gyro, const fix16_t *const deltaT, register const uint_fast8_t count) HOT NONNULL;
+
 /*!
 * \brief Registers accelerometer measurements for the next update
 * \param[in] ax The x-axis accelerometer value.
@@ -95,7 +164,53 @@ STATIC_INLINE void fusion_set_magnetometer_v3d(register const v3d *const data)
 /*!
 * \brief Updates the current prediction with the set measurements.
 * \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
+*
+* Equals {\ref fusion_update_accelerometer}, {\ref fusion_update_magnetometer} and
+* {\ref fusion_update_gyroscope} using the same time difference.
 */
 void fusion_update(register const fix16_t deltaT) HOT;
 
+/*!
+* \brief Corrects the attitude filter with the registered accelerometer measurement.
+* \param[in] deltaT The time difference in seconds to the last accelerometer correction.
+*
+* Does nothing if no accelerometer measurement was registered since the last correction.
+*/
+void fusion_update_accelerometer(register const fix16_t deltaT) HOT;
+
+/*!
+* \brief Corrects the orientation filter with the registered magnetometer measurement.
+* \param[in] deltaT The time difference in seconds to the last magnetometer correction.
+*
+* Does nothing if no magnetometer measurement was registered since the last correction.
+*/
+void fusion_update_magnetometer(register const fix16_t deltaT) HOT;
+
+/*!
+* \brief Corrects the filters that were not corrected since the last prediction with the gyroscope measurement.
+* \param[in] deltaT The time difference in seconds to the last prediction.
+*
+* Call after {\ref fusion_predict} and any axis corrections of the same gyroscope sample.
+*/
+void fusion_update_gyroscope(register const fix16_t deltaT) HOT;
+
+/*!
+* \brief Estimates the orientation from the registered accelerometer and magnetometer measurements alone.
+*
+* The zero-state fallback for when no gyroscope data arrives: the orientation follows the
+* TRIAD axes of the newest measurements without prediction, at a fraction of the cost
+* of a filter step, and the filters continue from it once the gyroscope returns. Does
+* nothing if no accelerometer measurement was registered since the last update, since the
+* attitude would otherwise be frozen at a stale measurement.
+*/
+void fusion_update_direct() HOT;
+
+/*!
+* \brief Fetches and clears the fixed-point overflows and filter resets since the last report
+* \param[out] report The report; NULL to discard the counts
+*
+* All counts stay zero if the engine does not check for overflows.
+*/
+void fusion_report_overflows(fusion_overflow_report_t *const report);
+
 #endif // SENSOR_FUNCTION_H_
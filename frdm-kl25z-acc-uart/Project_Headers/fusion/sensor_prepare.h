@@ -10,6 +10,26 @@
 
 #include "fixvector3d.h"
 #include "compiler.h"
+#include "fusion/sensor_calibration.h"
+
+/*!
+* \brief Precomputes the sensor transformations from the scaling factors and the calibration.
+* \param[in] accelerometer_scaling The MPU6050 accelerometer scaling factor, e.g. F16(8192) for 4g mode
+* \param[in] gyroscope_scaling The MPU6050 gyroscope scaling factor, e.g. F16(131) for 250/s mode
+* \param[in] magnetometer_scaling The HMC5883L scaling factor, e.g. F16(1090) for 1.3 gauss mode
+*
+* Axis permutation, scaling, calibration and unit conversion are combined into a single
+* affine transformation per sensor, so that preparing a sample takes no division.
+*/
+void sensor_prepare_initialize(const fix16_t accelerometer_scaling, const fix16_t gyroscope_scaling, const fix16_t magnetometer_scaling) COLD;
+
+/*!
+* \brief Precomputes the MMA8451Q accelerometer transformation.
+* \param[in] accelerometer_scaling The MMA8451Q scaling factor, e.g. F16(4096) for 2g mode
+*
+* The calibration rotates the data into the MPU6050 accelerometer frame.
+*/
+void sensor_prepare_initialize_mma8451q(const fix16_t accelerometer_scaling) COLD;
 
 /*!
 * \brief Prepares MPU6050 accelerometer sensor data for fusion by converting and calibrating them.
@@ -17,19 +37,17 @@
 * \param[in] raw_x The sensor x value
 * \param[in] raw_y The sensor y value
 * \param[in] raw_z The sensor z value
-* \param[in] scaling The scaling factor, e.g. F16(8192) for 4g mode, F16(16384) for 4g mode, ...
 */
-void sensor_prepare_mpu6050_accelerometer_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz, const fix16_t scaling) HOT NONNULL;
+void sensor_prepare_mpu6050_accelerometer_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz) HOT NONNULL;
 
 /*!
 * \brief Prepares MPU6050 gyroscope sensor data for fusion by converting and calibrating them.
-* \param[out] out The prepared sensor data
+* \param[out] out The prepared sensor data in radians per second
 * \param[in] raw_x The sensor x value
 * \param[in] raw_y The sensor y value
 * \param[in] raw_z The sensor z value
-* \param[in] scaling The scaling factor, e.g. F16(131) for 250/s mode ...
 */
-void sensor_prepare_mpu6050_gyroscope_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz, const fix16_t scaling) HOT NONNULL;
+void sensor_prepare_mpu6050_gyroscope_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz) HOT NONNULL;
 
 /*!
 * \brief Prepares HMC5883L magnetometer sensor data for fusion by converting and calibrating them.
@@ -37,8 +55,31 @@ void sensor_prepare_mpu6050_gyroscope_data(v3d *const out, int16_t rawx, int16_t
 * \param[in] raw_x The sensor x value
 * \param[in] raw_y The sensor y value
 * \param[in] raw_z The sensor z value
-* \param[in] scaling The scaling factor, e.g. F16(1090) for 1.3 gauss mode ...
 */
-void sensor_prepare_hmc5883l_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz, const fix16_t scaling) HOT NONNULL;
+void sensor_prepare_hmc5883l_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz) HOT NONNULL;
+
+/*!
+* \brief Prepares MMA8451Q accelerometer sensor data for fusion by converting, calibrating and rotating them into the MPU6050 frame.
+* \param[out] out The prepared sensor data
+* \param[in] raw_x The sensor x value
+* \param[in] raw_y The sensor y value
+* \param[in] raw_z The sensor z value
+*/
+void sensor_prepare_mma8451q_accelerometer_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz) HOT NONNULL;
+
+/*!
+* \brief Refines the HMC5883L calibration by an affine correction of the prepared data.
+* \param[in] correction The correction applied after the current calibration
+*
+* The correction is composed with the calibration in use and the transformation is
+* rebuilt, so that the next prepared sample is corrected.
+*/
+void sensor_prepare_correct_hmc5883l(const calibration_matrix_t *const correction) NONNULL;
+
+/*!
+* \brief Retrieves the HMC5883L calibration in use.
+* \return The calibration, including all corrections
+*/
+const calibration_matrix_t *sensor_prepare_hmc5883l_calibration();
 
 #endif
\ No newline at end of file
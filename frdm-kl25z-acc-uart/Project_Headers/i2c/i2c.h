@@ -8,12 +8,6 @@
 #ifndef I2C_H_
 #define I2C_H_
 
-/**
- * @brief Enables or disables decorated storage support using the
- * Bit Manipulation Engine.
- */
-#define I2C_USE_BME 1
-
 /**
  *  @brief According to KINETIS_L_2N97F errata (e6070), repeated start condition can not be sent if prescaler is any other than 1 (0x0). 
  *  Setting this define to a nonzero value activates the proposed workaround (temporarily disabling the multiplier).
@@ -23,10 +17,9 @@
 #include "ARMCM0plus.h"
 #include "derivative.h"
 #include "nice_names.h"
+#include "cpu/clock.h"
 
-#if I2C_USE_BME
-#include "bme.h"
-#endif
+#include "cpu/bitflag.h"
 
 /**
  * @brief Encodes the read address from the 7-bit slave address
@@ -49,165 +42,321 @@
 #define I2C_MOD_NO_AND_MASK	(~0x0)
 
 /**
- * @brief Initializes the SPI interface
+ * @brief The number of unchanged registers that are written through to join two bursts of changed registers
+ * 
+ * Restarting the addressing costs a repeated start, the slave address and the register address.
  */
-void I2C_Init();
+#define I2C_WRITE_MERGE_GAP	(2)
 
 /**
- * @brief Resets the bus by toggling master mode if the bus is busy. This will interrupt ongoing traffic, so use with caution.
+ * @brief A block of registers with contiguous addresses within a configuration structure
  */
-void I2C_ResetBus();
+typedef struct {
+	uint8_t registerAddress;	/*< The address of the first register */
+	uint8_t offset;				/*< The offset of the first register in the configuration structure */
+	uint8_t count;				/*< The number of registers */
+} i2c_regblock_t;
 
 /**
- * @brief Reads an 8-bit register from an I2C slave 
+ * @brief The I2C Standard-mode bus frequency in Hz
+ */
+#define I2C_SPEED_STANDARD	(100000u)
+
+/**
+ * @brief The I2C Fast-mode bus frequency in Hz
+ */
+#define I2C_SPEED_FAST		(400000u)
+
+/**
+ * @brief The number of I2C instances
+ */
+#define I2C_INSTANCE_COUNT	(2)
+
+/**
+ * @brief Determines the index of an I2C instance
+ * @param[in] i2c The I2C instance, {@see I2C0} or {@see I2C1}
+ * @return The zero based instance number
+ */
+__STATIC_INLINE uint8_t I2C_InstanceIndex(I2C_MemMapPtr const i2c)
+{
+	return (I2C1 == i2c) ? 1 : 0;
+}
+
+/**
+ * @brief The maximum number of polling iterations of a bus wait
+ * 
+ * A polling iteration takes at least eight core cycles, so a wait gives
+ * up after roughly one millisecond; a byte at 100 kHz takes 90 microseconds.
+ */
+#define I2C_WAIT_TIMEOUT	(CORE_CLOCK/8000u)
+
+/**
+ * @brief The result of a blocking bus operation
+ */
+typedef enum {
+	I2C_STATUS_OK		= 0,	/*! The operation completed */
+	I2C_STATUS_TIMEOUT	= 1,	/*! A byte transfer did not complete in time; the transfer was aborted */
+	I2C_STATUS_BUSY		= 2,	/*! The bus stayed busy even after clearing it, see {@see I2C_ClearBus} */
+} i2c_status_t;
+
+/**
+ * @brief The status of the current transfer by I2C instance index
+ * 
+ * Latches the first failure of a transfer; cleared by {@see I2C_WaitWhileBusy}.
+ */
+extern i2c_status_t i2c_status[I2C_INSTANCE_COUNT];
+
+/**
+ * @brief Gets the status of the current or last transfer
+ * @param[in] i2c The I2C instance
+ * @return The first failure since the transfer was started or {@see I2C_STATUS_OK}
+ * 
+ * Functions returning received data report failures only through this status.
+ */
+__STATIC_INLINE i2c_status_t I2C_Status(I2C_MemMapPtr const i2c)
+{
+	return i2c_status[I2C_InstanceIndex(i2c)];
+}
+
+/**
+ * @brief Records a failure of the current transfer and releases the bus
+ * @param[in] i2c The I2C instance
+ * @param[in] status The failure
+ * @return The failure
+ */
+i2c_status_t I2C_Abort(I2C_MemMapPtr const i2c, const i2c_status_t status);
+
+/**
+ * @brief Registers the pins an I2C instance is currently muxed to
+ * @param[in] i2c The I2C instance
+ * @param[in] port The port of the pins
+ * @param[in] sclPin The number of the pin used for SCL
+ * @param[in] sclMux The mux value for the SCL pin
+ * @param[in] sdaPin The number of the pin used for SDA
+ * @param[in] sdaMux The mux value for the SDA pin
+ * 
+ * Required by {@see I2C_ClearBus}; usually called by the arbiter.
+ */
+void I2C_SetPins(I2C_MemMapPtr const i2c, PORT_MemMapPtr port, uint32_t sclPin, uint8_t sclMux, uint32_t sdaPin, uint8_t sdaMux);
+
+/**
+ * @brief Clears a bus held by a slave and re-initializes the module
+ * @param[in] i2c The I2C instance
+ * @return {@see I2C_STATUS_OK} if the bus is idle afterwards, {@see I2C_STATUS_BUSY} otherwise
+ * 
+ * Takes the pins from the module and clocks SCL as GPIO until the slave
+ * releases SDA (at most nine clocks), then generates a stop condition.
+ * Takes about 100 microseconds; the transfer in progress is lost.
+ */
+i2c_status_t I2C_ClearBus(I2C_MemMapPtr const i2c);
+
+/**
+ * @brief The I2C instance the slave addressed register functions operate on
+ * 
+ * Set by {@see I2C_SelectBus}, usually through the arbiter.
+ */
+extern I2C_MemMapPtr i2c_selected_bus;
+
+/**
+ * @brief Selects the I2C instance the slave addressed register functions operate on
+ * @param[in] i2c The I2C instance
+ */
+__STATIC_INLINE void I2C_SelectBus(I2C_MemMapPtr const i2c)
+{
+	i2c_selected_bus = i2c;
+}
+
+/**
+ * @brief Gets the I2C instance the slave addressed register functions operate on
+ * @return The I2C instance
+ */
+__STATIC_INLINE I2C_MemMapPtr I2C_SelectedBus()
+{
+	return i2c_selected_bus;
+}
+
+/**
+ * @brief Initializes an I2C instance
+ * @param[in] i2c The I2C instance, {@see I2C0} or {@see I2C1}
+ * 
+ * The bus is initially clocked at {@see I2C_SPEED_FAST}.
+ */
+void I2C_Init(I2C_MemMapPtr const i2c);
+
+/**
+ * @brief Determines the frequency divider register value for a bus frequency
+ * @param[in] i2c The I2C instance the value is for
+ * @param[in] speed The bus frequency in Hz
+ * @return The F register value of the fastest SCL frequency not above {@see speed}
+ * 
+ * I2C0 is clocked by the bus clock, I2C1 by the system clock, so the value
+ * only applies to the given instance.
+ */
+uint8_t I2C_FrequencyDivider(I2C_MemMapPtr const i2c, uint32_t speed);
+
+/**
+ * @brief Re-initializes the module, leaving master mode and clearing all flags. This will interrupt ongoing traffic, so use with caution.
+ * @param[in] i2c The I2C instance
+ * 
+ * The frequency divider is kept; the interrupt and DMA enables are cleared.
+ */
+void I2C_ResetBus(I2C_MemMapPtr const i2c);
+
+/**
+ * @brief Reads an 8-bit register from an I2C slave on the selected bus, see {@see I2C_SelectBus}
  * @param[in] slaveId The device's I2C slave id
  * @param[in] registerAddress Address of the device register to read
- * @return The value at the register
+ * @return The value at the register; see {@see I2C_Status} for failures
  */
 uint8_t I2C_ReadRegister(register uint8_t slaveId, register uint8_t registerAddress);
 
 
 /**
- * @brief Reads multiple 8-bit registers from an I2C slave
+ * @brief Reads multiple 8-bit registers from an I2C slave on the selected bus
  * @param[in] slaveId The slave device ID
  * @param[in] startRegisterAddress The first register address
  * @param[in] registerCount The number of registers to read; Must be larger than zero.
  * @param[out] buffere The buffer to write into
+ * @return The transfer status
  */
-void I2C_ReadRegisters(register uint8_t slaveId, register uint8_t startRegisterAddress, register uint8_t registerCount, uint8_t *buffer);
+i2c_status_t I2C_ReadRegisters(register uint8_t slaveId, register uint8_t startRegisterAddress, register uint8_t registerCount, uint8_t *buffer);
 
 /**
- * @brief Writes an 8-bit value to an 8-bit register on an I2C slave
+ * @brief Writes an 8-bit value to an 8-bit register on an I2C slave on the selected bus
  * @param[in] slaveId The device's I2C slave id
  * @param[in] registerAddress Address of the device register to read
  * @param[in] value The value to write
+ * @return The transfer status
  */
-void I2C_WriteRegister(register uint8_t slaveId, register uint8_t registerAddress, register uint8_t value);
+i2c_status_t I2C_WriteRegister(register uint8_t slaveId, register uint8_t registerAddress, register uint8_t value);
 
 /**
- * @brief Reads an 8-bit register from an I2C slave, modifies it by FIRST and-ing with {@see andMask} and THEN or-ing with {@see orMask} and writes it back
+ * @brief Reads an 8-bit register from an I2C slave on the selected bus, modifies it by FIRST and-ing with {@see andMask} and THEN or-ing with {@see orMask} and writes it back
  * @param[in] slaveId The slave id
  * @param[in] registerAddress The register to modify
  * @param[in] orMask The mask to OR the register with
  * @param[in] andMask The mask to AND the register with
- * @return The register after modification
+ * @return The register after modification; see {@see I2C_Status} for failures
  */
 uint8_t I2C_ModifyRegister(register uint8_t slaveId, uint8_t register registerAddress, register uint8_t andMask, register uint8_t orMask);
 
+/**
+ * @brief Writes the registers of a configuration structure that differ from the last written copy
+ * @param[in] slaveId The slave device ID
+ * @param[in] blocks The register blocks to write, in order
+ * @param[in] blockCount The number of blocks
+ * @param[in] values The configuration structure
+ * @param[in] shadow The configuration last written to the slave or NULL to write all registers
+ * @return The transfer status
+ * 
+ * Changed registers are written in auto-increment bursts within one bus transaction.
+ * Up to {@see I2C_WRITE_MERGE_GAP} unchanged registers are written through to join two bursts.
+ */
+i2c_status_t I2C_WriteRegisterBlocks(register uint8_t slaveId, const i2c_regblock_t *const blocks, uint8_t blockCount, const uint8_t *const values, const uint8_t *const shadow);
+
 
 /**
  * @brief Waits for an I2C bus operation to complete
+ * @param[in] i2c The I2C instance
+ * @return The transfer status
+ * 
+ * Returns immediately if the transfer already failed, so an aborted
+ * sequence of blocking calls costs a single timeout.
  */
-__STATIC_INLINE void I2C_Wait()
+__STATIC_INLINE i2c_status_t I2C_Wait(I2C_MemMapPtr const i2c)
 {
-	while((I2C0->S & I2C_S_IICIF_MASK)==0) {}	/* loop until interrupt is detected */
+	const i2c_status_t status = I2C_Status(i2c);
+	if (I2C_STATUS_OK != status) return status;
 	
-#if !I2C_USE_BME
-	I2C0->S |= I2C_S_IICIF_MASK; /* clear interrupt flag */
-#else
-	BME_OR_B(&I2C0->S, ((1 << I2C_S_IICIF_SHIFT) << I2C_S_IICIF_MASK));
-#endif
+	register uint32_t timeout = I2C_WAIT_TIMEOUT;
+	while((i2c->S & I2C_S_IICIF_MASK)==0)	/* loop until interrupt is detected */
+	{
+		if (0 == --timeout) return I2C_Abort(i2c, I2C_STATUS_TIMEOUT);
+	}
+	
+	BitFlag_Acknowledge8(&i2c->S, I2C_S_IICIF_MASK); /* clear interrupt flag (w1c) */
+	return I2C_STATUS_OK;
 }
 
 /**
- * @brief Waits for an I2C bus operation to complete
+ * @brief Waits for the bus to become idle and starts a new transfer
+ * @param[in] i2c The I2C instance
+ * @return The transfer status
+ * 
+ * Clears the status of the previous transfer. If the bus does not become
+ * idle in time, it is cleared by {@see I2C_ClearBus}.
  */
-__STATIC_INLINE void I2C_WaitWhileBusy()
+__STATIC_INLINE i2c_status_t I2C_WaitWhileBusy(I2C_MemMapPtr const i2c)
 {
-	while((I2C0->S & I2C_S_BUSY_MASK)!=0) {}
+	i2c_status[I2C_InstanceIndex(i2c)] = I2C_STATUS_OK;
+	
+	/* a repeated start written after an aborted transfer may have lost arbitration (w1c) */
+	i2c->S = I2C_S_ARBL_MASK;
+	
+	register uint32_t timeout = I2C_WAIT_TIMEOUT;
+	while((i2c->S & I2C_S_BUSY_MASK)!=0)
+	{
+		if (0 == --timeout)
+		{
+			const i2c_status_t status = I2C_ClearBus(i2c);
+			i2c_status[I2C_InstanceIndex(i2c)] = status;
+			return status;
+		}
+	}
+	return I2C_STATUS_OK;
 }
 
 
 /**
  * @brief Sends a start condition and enters TX mode.
+ * @param[in] i2c The I2C instance
  */
-__STATIC_INLINE void I2C_SendStart()
+__STATIC_INLINE void I2C_SendStart(I2C_MemMapPtr const i2c)
 {
-#if !I2C_USE_BME	
-	I2C0->C1 |= ((1 << I2C_C1_MST_SHIFT) & I2C_C1_MST_MASK) 
-				| ((1 << I2C_C1_TX_SHIFT) & I2C_C1_TX_MASK);
-#else
-	BME_OR_B(&I2C0->C1, 
-			  ((1 << I2C_C1_MST_SHIFT) & I2C_C1_MST_MASK) 
-			| ((1 << I2C_C1_TX_SHIFT) & I2C_C1_TX_MASK)
-		);
-#endif
+	BitFlag_Set8(&i2c->C1, I2C_C1_MST_MASK | I2C_C1_TX_MASK);
 }
 
 /**
  * @brief Enters transmit mode.
+ * @param[in] i2c The I2C instance
  */
-__STATIC_INLINE void I2C_EnterTransmitMode()
+__STATIC_INLINE void I2C_EnterTransmitMode(I2C_MemMapPtr const i2c)
 {
-#if !I2C_USE_BME
-	I2C0->C1 |= ((1 << I2C_C1_TX_SHIFT) & I2C_C1_TX_MASK);
-#else
-	BME_OR_B(&I2C0->C1, 
-			((1 << I2C_C1_TX_SHIFT) & I2C_C1_TX_MASK)
-		);
-#endif
+	BitFlag_Set8(&i2c->C1, I2C_C1_TX_MASK);
 }
 
 /**
  * @brief Enters receive mode.
+ * @param[in] i2c The I2C instance
  */
-__STATIC_INLINE void I2C_EnterReceiveMode()
+__STATIC_INLINE void I2C_EnterReceiveMode(I2C_MemMapPtr const i2c)
 {
-#if !I2C_USE_BME
-	I2C0->C1 &= ~((1 << I2C_C1_TX_SHIFT) & I2C_C1_TX_MASK);
-#else
-	BME_AND_B(&I2C0->C1,
-			(uint8_t)
-			~((1 << I2C_C1_TX_SHIFT) & I2C_C1_TX_MASK)
-		);
-#endif
+	BitFlag_Clear8(&i2c->C1, I2C_C1_TX_MASK);
 }
 
 /**
  * @brief Enters receive mode and enables ACK.
  * 
  * Enabling ACK may be required when more than one data byte will be read.
+ * @param[in] i2c The I2C instance
  */
-__STATIC_INLINE void I2C_EnterReceiveModeWithAck()
+__STATIC_INLINE void I2C_EnterReceiveModeWithAck(I2C_MemMapPtr const i2c)
 {
-#if !I2C_USE_BME
-	I2C0->C1 &= ~((1 << I2C_C1_TX_SHIFT) & I2C_C1_TX_MASK)	
-			& ~((1 << I2C_C1_TXAK_SHIFT) & I2C_C1_TXAK_MASK);
-#else
-	BME_AND_B(&I2C0->C1,
-			(uint8_t) ~(
-				  ((1 << I2C_C1_TX_SHIFT) & I2C_C1_TX_MASK)
-				| ((1 << I2C_C1_TXAK_SHIFT) & I2C_C1_TXAK_MASK)
-			)
-		);
-#endif
+	BitFlag_Clear8(&i2c->C1, I2C_C1_TX_MASK | I2C_C1_TXAK_MASK);
 }
 
 /**
  * @brief Enters receive mode and disables ACK.
  * 
  * Disabling ACK may be required when only one data byte will be read.
+ * @param[in] i2c The I2C instance
  */
-__STATIC_INLINE void I2C_EnterReceiveModeWithoutAck()
+__STATIC_INLINE void I2C_EnterReceiveModeWithoutAck(I2C_MemMapPtr const i2c)
 {
 	/* Straightforward method of clearing TX mode and
 	 * setting NACK bit sending.
 	 */
-#if !I2C_USE_BME
-	register uint8_t reg = I2C0->C1;
-	reg &= ~((1 << I2C_C1_TX_SHIFT) & I2C_C1_TX_MASK);
-	reg |=  ((1 << I2C_C1_TXAK_SHIFT) & I2C_C1_TXAK_MASK);
-	I2C0->C1 = reg;
-#else
-	
-	/* Alternative using the Bit Manipulation Engine
-	 * and decorated Logic AND/OR stores */
-#if 0
-	BME_AND_B(&I2C0->C1, ~(1 << I2C_C1_TX_SHIFT));
-	BME_OR_B(&I2C0->C1,   1 << I2C_C1_TXAK_SHIFT);
-#endif
-	
-	/* Even better alternative: BME Bit Field Insert
+	/* BME Bit Field Insert
 	 * - TX   bit is 0x10 (5th bit, 0b00010000)
 	 * - TXAK bit is 0x08 (4th bit, 0b00001000)
 	 * Thus the following can be deduced:
@@ -215,154 +364,135 @@ __STATIC_INLINE void I2C_EnterReceiveModeWithoutAck()
 	 *   This corresponds to a 2 bit wide mask, shifted by 3 
 	 * - The mask for setting  TXAK bit  is 0x08 (0b00001000)
 	 */
-	BME_BFI_B(&I2C0->C1, 0x08, 3, 2);
-
-#endif /* USE_BME */
+	BitFlag_Insert8(&i2c->C1, I2C_C1_TXAK_MASK, I2C_C1_TXAK_SHIFT, 2);
 }
 
 /**
  * @brief Sends a repeated start condition and enters TX mode.
+ * @param[in] i2c The I2C instance
  */
-__STATIC_INLINE void I2C_SendRepeatedStart()
+__STATIC_INLINE void I2C_SendRepeatedStart(I2C_MemMapPtr const i2c)
 {
 #if I2C_ENABLE_E6070_SPEEDHACK
-	register uint8_t reg = I2C0->F;
-	I2C0->F = reg & ~I2C_F_MULT_MASK; /* NOTE: According to KINETIS_L_2N97F errata (e6070), repeated start condition can not be sent if prescaler is any other than 1 (0x0). A solution is to temporarily disable the multiplier. */
+	register uint8_t reg = i2c->F;
+	i2c->F = reg & ~I2C_F_MULT_MASK; /* NOTE: According to KINETIS_L_2N97F errata (e6070), repeated start condition can not be sent if prescaler is any other than 1 (0x0). A solution is to temporarily disable the multiplier. */
 #endif
 	
-#if !I2C_USE_BME
-	I2C0->C1 |= ((1 << I2C_C1_RSTA_SHIFT) & I2C_C1_RSTA_MASK)
-			  | ((1 << I2C_C1_TX_SHIFT) & I2C_C1_TX_MASK);
-#else
-	BME_OR_B(&I2C0->C1, 
-			  ((1 << I2C_C1_RSTA_SHIFT) & I2C_C1_RSTA_MASK)	
-			| ((1 << I2C_C1_TX_SHIFT) & I2C_C1_TX_MASK)
-		);
-#endif
+	BitFlag_Set8(&i2c->C1, I2C_C1_RSTA_MASK | I2C_C1_TX_MASK);
 
 #if I2C_ENABLE_E6070_SPEEDHACK
-	I2C0->F = reg;
+	i2c->F = reg;
 #endif	
 }
 
 /**
  * @brief Sends a stop condition (also leaves TX mode)
+ * @param[in] i2c The I2C instance
  */
-__STATIC_INLINE void I2C_SendStop()
+__STATIC_INLINE void I2C_SendStop(I2C_MemMapPtr const i2c)
 {
-#if !I2C_USE_BME
-	I2C0->C1 &= ~((1 << I2C_C1_MST_SHIFT) & I2C_C1_MST_MASK)
-			& ~((1 << I2C_C1_TX_SHIFT) & I2C_C1_TX_MASK);
-#else
-	BME_AND_B(&I2C0->C1,
-			(uint8_t) ~(
-				  ((1 << I2C_C1_MST_SHIFT) & I2C_C1_MST_MASK)
-				| ((1 << I2C_C1_TX_SHIFT) & I2C_C1_TX_MASK)
-			)
-		);
-#endif
+	BitFlag_Clear8(&i2c->C1, I2C_C1_MST_MASK | I2C_C1_TX_MASK);
 }
 
 /**
  * @brief Enables sending of ACK
  * 
  * Enabling ACK may be required when more than one data byte will be read.
+ * @param[in] i2c The I2C instance
  */
-__STATIC_INLINE void I2C_EnableAck()
+__STATIC_INLINE void I2C_EnableAck(I2C_MemMapPtr const i2c)
 {
-#if !I2C_USE_BME
-	I2C0->C1 &= ~((1 << I2C_C1_TXAK_SHIFT) & I2C_C1_TXAK_MASK);
-#else
-	BME_AND_B(&I2C0->C1, 
-			(uint8_t)
-			~((1 << I2C_C1_TXAK_SHIFT) & I2C_C1_TXAK_MASK)
-	);
-#endif
+	BitFlag_Clear8(&i2c->C1, I2C_C1_TXAK_MASK);
 }
 
 /**
  * @brief Enables sending of NACK (disabling ACK)
  * 
  * Enabling NACK may be required when no more data byte will be read.
+ * @param[in] i2c The I2C instance
  */
-__STATIC_INLINE void I2C_DisableAck()
+__STATIC_INLINE void I2C_DisableAck(I2C_MemMapPtr const i2c)
 {
-#if !I2C_USE_BME
-	I2C0->C1 |= ((1 << I2C_C1_TXAK_SHIFT) & I2C_C1_TXAK_MASK);
-#else
-	BME_OR_B(&I2C0->C1,
-			((1 << I2C_C1_TXAK_SHIFT) & I2C_C1_TXAK_MASK)
-		);
-#endif
+	BitFlag_Set8(&i2c->C1, I2C_C1_TXAK_MASK);
 }
 
 /**
  * @brief Sends a byte over the I2C bus and waits for the operation to complete
+ * @param[in] i2c The I2C instance
  * @param[in] value The byte to send
+ * @return The transfer status
  */
-__STATIC_INLINE void I2C_SendBlocking(const uint8_t value)
+__STATIC_INLINE i2c_status_t I2C_SendBlocking(I2C_MemMapPtr const i2c, const uint8_t value)
 {
-	I2C0->D = value;
-	I2C_Wait();
+	i2c->D = value;
+	return I2C_Wait(i2c);
 }
 
 /**
  * @brief Reads a byte over the I2C bus and drives the clock for another byte
+ * @param[in] i2c The I2C instance
  * @return There received byte
  */
-__STATIC_INLINE uint8_t I2C_ReceiveDriving()
+__STATIC_INLINE uint8_t I2C_ReceiveDriving(I2C_MemMapPtr const i2c)
 {
-	register uint8_t value = I2C0->D;
-	I2C_Wait();
+	register uint8_t value = i2c->D;
+	I2C_Wait(i2c);
 	return value;
 }
 
 /**
  * @brief Reads a byte over the I2C bus and drives the clock for another byte, while sending NACK
+ * @param[in] i2c The I2C instance
  * @return There received byte
  */
-__STATIC_INLINE uint8_t I2C_ReceiveDrivingWithNack()
+__STATIC_INLINE uint8_t I2C_ReceiveDrivingWithNack(I2C_MemMapPtr const i2c)
 {
-	I2C_DisableAck();
-	return I2C_ReceiveDriving();
+	I2C_DisableAck(i2c);
+	return I2C_ReceiveDriving(i2c);
 }
 
 /**
  * @brief Reads the last byte over the I2C bus and sends a stop condition
+ * @param[in] i2c The I2C instance
  * @return There received byte
  */
-__STATIC_INLINE uint8_t I2C_ReceiveAndStop()
+__STATIC_INLINE uint8_t I2C_ReceiveAndStop(I2C_MemMapPtr const i2c)
 {
-	I2C_SendStop();
-	return I2C0->D;
+	I2C_SendStop(i2c);
+	return i2c->D;
 }
 
 /**
  * @brief Reads a byte over the I2C bus and sends a repeated start condition.
+ * @param[in] i2c The I2C instance
  * @return There received byte
  * 
  * The I2C module is in transmit mode afterwards.
  */
-__STATIC_INLINE uint8_t I2C_ReceiveAndRestart()
+__STATIC_INLINE uint8_t I2C_ReceiveAndRestart(I2C_MemMapPtr const i2c)
 {
-	I2C_SendRepeatedStart();
-	return I2C0->D;
+	I2C_SendRepeatedStart(i2c);
+	return i2c->D;
 }
 
 /**
  * @brief Drives the clock in receiver mode in order to receive the first byte.
+ * @param[in] i2c The I2C instance
+ * @return The transfer status
  */
-__STATIC_INLINE void I2C_ReceiverModeDriveClock()
+__STATIC_INLINE i2c_status_t I2C_ReceiverModeDriveClock(I2C_MemMapPtr const i2c)
 {
-	INTENTIONALLY_UNUSED(register uint8_t) = I2C0->D;
-	I2C_Wait();
+	INTENTIONALLY_UNUSED(register uint8_t) = i2c->D;
+	return I2C_Wait(i2c);
 }
 
 /**
  * @brief Initiates a register read after the module was brought into TX mode.
+ * @param[in] i2c The I2C instance
  * @param[in] slaveId The slave id
  * @param[in] registerAddress the register to read from 
+ * @return The transfer status
  */
-void I2C_InitiateRegisterReadAt(const register uint8_t slaveId, const register uint8_t registerAddress);
+i2c_status_t I2C_InitiateRegisterReadAt(I2C_MemMapPtr const i2c, const register uint8_t slaveId, const register uint8_t registerAddress);
 
 #endif /* I2C_H_ */
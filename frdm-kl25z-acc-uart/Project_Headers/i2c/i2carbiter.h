@@ -2,7 +2,14 @@
  * i2carbiter.h
  *
  * Switches between I2C pin configurations when the same I2C is configured
- * on multiple ports. Intended for use in single master setups. 
+ * on multiple ports and maps the slaves to their I2C instance. Slaves on
+ * different instances are tracked independently, so both buses can be used
+ * at the same time. Intended for use in single master setups. 
+ *
+ * Every entry is also reachable through a handle, its list index plus one,
+ * which selects in constant time no matter how many slaves are configured.
+ * Slaves that share an address (e.g. two identical sensors on different
+ * pins) can only be told apart by their handles.
  *
  *  Created on: Nov 10, 2013
  *      Author: Markus
@@ -18,23 +25,42 @@
  */
 typedef struct {
 	const uint8_t slaveAddress;		/*< The 7-bit slave address */ 
+	I2C_MemMapPtr bus;				/*< The I2C instance the slave is attached to */
 	const uint32_t hash;			/*< Hash of the fields to aid in switching decisions */
 	PORT_MemMapPtr port;			/*< The port for I2C communication */
 	const uint32_t sdaPin;			/*< The pin used to drive SDA */
 	const uint32_t sclPin;			/*< The pin used to drive SCL */
 	const uint8_t sdaMux;			/*< The mux value for the SDA pin */
 	const uint8_t sclMux;			/*< The mux value for the SCL pin */
+	const uint8_t frequencyDivider;	/*< The F register value for the slave's bus frequency */
 } i2carbiter_entry_t;
 
+/**
+ * @brief Handle of an arbiter entry, see {@see I2CARBITER_HANDLE}
+ */
+typedef uint8_t i2carbiter_handle_t;
+
+/**
+ * @brief The handle that does not refer to any entry
+ */
+#define I2CARBITER_NO_HANDLE	((i2carbiter_handle_t)0)
+
+/**
+ * @brief The handle of the entry at the given list index
+ */
+#define I2CARBITER_HANDLE(index)	((i2carbiter_handle_t)((index) + 1))
+
 /**
  * @brief Configures n I2C arbiter entry
  * @param[inout] entry The entry
  * @param[in] slaveAddress The 7-bit slave address
+ * @param[in] bus The I2C instance the slave is attached to, {@see I2C0} or {@see I2C1}
  * @param[in] port The port to use
  * @param[in] sdaPin The number of the pin used for SDA
  * @param[in] sclPin The number of the pin used for SCL
+ * @param[in] speed The bus frequency in Hz, e.g. {@see I2C_SPEED_FAST}
  */
-void I2CArbiter_PrepareEntry(i2carbiter_entry_t *entry, uint8_t slaveAddress,  PORT_MemMapPtr port, uint32_t sclPin, uint8_t sclMux, uint32_t sdaPin, uint8_t sdaMux);
+void I2CArbiter_PrepareEntry(i2carbiter_entry_t *entry, uint8_t slaveAddress, I2C_MemMapPtr bus, PORT_MemMapPtr port, uint32_t sclPin, uint8_t sclMux, uint32_t sdaPin, uint8_t sdaMux, uint32_t speed);
 
 /**
  * @brief Configures the I2C arbiter
@@ -45,10 +71,55 @@ void I2CArbiter_PrepareEntry(i2carbiter_entry_t *entry, uint8_t slaveAddress,  P
 void I2CArbiter_Configure(i2carbiter_entry_t *entries, uint8_t entryCount);
 
 /**
- * @brief Selects an I2C slave and prepares the ports.
+ * @brief Selects an I2C slave and prepares the ports of its bus.
  * @param[in] slaveAddress The slave address
  * @return Zero if successful, nonzero otherwise
+ * 
+ * The slave's bus becomes the selected bus of the blocking functions, see {@see I2C_SelectBus}.
  */
 uint8_t I2CArbiter_Select(uint8_t slaveAddress);
 
+/**
+ * @brief Selects an I2C slave by its handle and prepares the ports of its bus.
+ * @param[in] handle The handle of the slave's entry
+ * @return Zero if successful, nonzero otherwise
+ * 
+ * Same as {@see I2CArbiter_Select}, without looking up the address.
+ * If the slave runs at another bus frequency, waits for the stop condition of
+ * the previous transfer before the clock changes.
+ */
+uint8_t I2CArbiter_SelectHandle(i2carbiter_handle_t handle);
+
+/**
+ * @brief Selects an I2C slave by its handle on a bus the caller has seen idle.
+ * @param[in] handle The handle of the slave's entry
+ * @return Zero if successful, nonzero otherwise
+ * 
+ * Same as {@see I2CArbiter_SelectHandle}, but never waits for or clears the bus,
+ * so it may be called from interrupt context. The caller must have seen the bus
+ * idle since its last stop condition.
+ */
+uint8_t I2CArbiter_SelectHandleIdle(i2carbiter_handle_t handle);
+
+/**
+ * @brief Looks up the handle of a slave
+ * @param[in] slaveAddress The slave address
+ * @return The handle of the first entry with this address or {@see I2CARBITER_NO_HANDLE} if the slave is unknown
+ */
+i2carbiter_handle_t I2CArbiter_Handle(uint8_t slaveAddress);
+
+/**
+ * @brief Determines the I2C instance a slave is attached to
+ * @param[in] slaveAddress The slave address
+ * @return The I2C instance or NULL if the slave is unknown
+ */
+I2C_MemMapPtr I2CArbiter_Bus(uint8_t slaveAddress);
+
+/**
+ * @brief Determines the I2C instance a slave is attached to by its handle
+ * @param[in] handle The handle of the slave's entry
+ * @return The I2C instance or NULL if the handle is invalid
+ */
+I2C_MemMapPtr I2CArbiter_BusOf(i2carbiter_handle_t handle);
+
 #endif /* I2CARBITER_H_ */
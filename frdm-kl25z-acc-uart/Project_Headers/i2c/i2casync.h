@@ -0,0 +1,190 @@
+/*
+ * i2casync.h
+ *
+ * Queued, interrupt driven I2C register transactions. Every initialized I2C
+ * instance runs its own queue, so transactions to slaves on different buses
+ * (see {@see I2CArbiter_Bus}) are transferred at the same time. While the
+ * engine is running (i.e. not suspended), the blocking functions from i2c.h
+ * must not be used; see {@see I2CAsync_Suspend}.
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef I2CASYNC_H_
+#define I2CASYNC_H_
+
+#include <stdint.h>
+#include "derivative.h"
+#include "i2c/i2carbiter.h"
+
+/**
+ * @brief The IRQ number (not exception number!) for I2C0 interrupt
+ */
+#define I2CASYNC_I2C0_IRQ		(8)
+
+/**
+ * @brief The IRQ number (not exception number!) for I2C1 interrupt
+ */
+#define I2CASYNC_I2C1_IRQ		(9)
+
+/**
+ * @brief The number of transactions that can be queued per I2C instance; Must be a power of two
+ */
+#define I2CASYNC_QUEUE_LENGTH	(8)
+
+/**
+ * @brief The time in microseconds a transaction may take regardless of its length
+ */
+#define I2CASYNC_TIMEOUT_BASE_US		(500u)
+
+/**
+ * @brief The additional time in microseconds a transaction may take per register; a byte at 100 kHz takes 90
+ */
+#define I2CASYNC_TIMEOUT_PER_BYTE_US	(100u)
+
+/**
+ * @brief Enables or disables the DMA driven receive path.
+ * 
+ * If enabled, reads of at least {@see I2CASYNC_DMA_MIN_COUNT} registers are
+ * received by one DMA channel per I2C instance instead of one interrupt
+ * per byte. The last two bytes are still taken by the I2C interrupt, since
+ * the final byte has to be NACKed and followed by a stop condition.
+ */
+#define I2CASYNC_USE_DMA_RX		1
+
+#if I2CASYNC_USE_DMA_RX
+
+/**
+ * @brief The DMA channel used for I2C0 reception; Channel 0 is used by UART0
+ */
+#define I2CASYNC_I2C0_DMA_CHANNEL	(1)
+
+/**
+ * @brief The DMA channel used for I2C1 reception
+ */
+#define I2CASYNC_I2C1_DMA_CHANNEL	(2)
+
+/**
+ * @brief The DMAMUX request source for I2C0
+ */
+#define I2CASYNC_I2C0_DMA_SOURCE	(22)
+
+/**
+ * @brief The DMAMUX request source for I2C1
+ */
+#define I2CASYNC_I2C1_DMA_SOURCE	(23)
+
+/**
+ * @brief The minimum register count of a read to use DMA; Must be at least 3
+ */
+#define I2CASYNC_DMA_MIN_COUNT	(4)
+
+#endif
+
+/**
+ * @brief The transfer direction of a transaction
+ */
+typedef enum {
+	I2CASYNC_READ	= 0,	/*! Reads registers starting at the register address */
+	I2CASYNC_WRITE	= 1,	/*! Writes registers starting at the register address */
+} i2casync_direction_t;
+
+/**
+ * @brief The state of a transaction
+ */
+typedef enum {
+	I2CASYNC_STATUS_IDLE	= 0,	/*! The transaction was never submitted */
+	I2CASYNC_STATUS_QUEUED	= 1,	/*! The transaction waits for the bus */
+	I2CASYNC_STATUS_ACTIVE	= 2,	/*! The transaction is on the bus */
+	I2CASYNC_STATUS_DONE	= 3,	/*! The transaction completed successfully */
+	I2CASYNC_STATUS_NACK	= 4,	/*! The slave did not acknowledge */
+	I2CASYNC_STATUS_ERROR	= 5,	/*! The bus arbitration was lost or the bus could not be freed */
+	I2CASYNC_STATUS_TIMEOUT	= 6,	/*! The transaction did not complete in time; the bus was cleared */
+} i2casync_status_t;
+
+typedef struct i2casync_transaction_t i2casync_transaction_t;
+
+/**
+ * @brief Completion callback; Called from interrupt context
+ */
+typedef void (*i2casync_callback_t)(i2casync_transaction_t *const transaction);
+
+/**
+ * @brief A register read or write transaction
+ */
+struct i2casync_transaction_t {
+	uint8_t slaveAddress;			/*< The 7-bit slave address */
+	i2carbiter_handle_t handle;		/*< The arbiter entry of the slave; {@see I2CARBITER_NO_HANDLE} to look it up by address on submission */
+	uint8_t registerAddress;		/*< The first register address */
+	i2casync_direction_t direction;	/*< The transfer direction */
+	uint8_t count;					/*< The number of registers; Must be larger than zero */
+	uint8_t *data;					/*< The data to write or the buffer to read into */
+	i2casync_callback_t callback;	/*< The completion callback; may be NULL */
+	volatile i2casync_status_t status;	/*< The transaction state */
+};
+
+/**
+ * @brief Initializes the transaction engine of an I2C instance in suspended state
+ * @param[in] i2c The I2C instance, {@see I2C0} or {@see I2C1}
+ * 
+ * Must be called after {@see I2C_Init} for every instance slaves are attached to.
+ * Use {@see I2CAsync_Resume} to start processing.
+ */
+void I2CAsync_Init(I2C_MemMapPtr const i2c);
+
+/**
+ * @brief Queues a transaction
+ * @param[in] transaction The transaction; Must stay valid until completion
+ * @return Zero on success, nonzero if the queue is full or the transaction is still pending
+ * 
+ * The transaction is queued on the bus of its slave, see {@see I2CArbiter_BusOf}.
+ * A transaction without handle gets the handle of the first arbiter entry with
+ * its slave address, so it must not be reused for another slave afterwards.
+ * May be called from interrupt context.
+ */
+uint8_t I2CAsync_Submit(i2casync_transaction_t *const transaction);
+
+/**
+ * @brief Waits for the active transactions to finish and holds back the queues
+ * 
+ * Allows the blocking functions from i2c.h to be used until {@see I2CAsync_Resume} is called.
+ * Transactions may still be submitted in the meantime.
+ */
+void I2CAsync_Suspend();
+
+/**
+ * @brief Resumes processing of queued transactions on all initialized instances
+ */
+void I2CAsync_Resume();
+
+/**
+ * @brief Aborts active transactions that exceeded their time budget and clears buses that stay busy
+ * 
+ * A transaction may take {@see I2CASYNC_TIMEOUT_BASE_US} plus {@see I2CASYNC_TIMEOUT_PER_BYTE_US}
+ * per register. A stalled transaction is completed with {@see I2CASYNC_STATUS_TIMEOUT}
+ * after the bus was cleared by {@see I2C_ClearBus}, and the queue moves on. A queued
+ * transaction waits up to {@see I2CASYNC_TIMEOUT_BASE_US} for a busy bus before it
+ * is cleared; if clearing fails, the transaction is completed with {@see I2CASYNC_STATUS_ERROR}.
+ * Must be called periodically from the main loop, never from interrupt context.
+ */
+void I2CAsync_CheckTimeouts();
+
+/**
+ * @brief Determines if all instances are idle
+ * @return Nonzero if no transaction is queued or on any bus
+ */
+uint8_t I2CAsync_Idle();
+
+/**
+ * @brief Determines if a transaction is queued or on the bus
+ * @param[in] transaction The transaction
+ * @return Nonzero if the transaction has not completed yet
+ */
+static inline uint8_t I2CAsync_Pending(const i2casync_transaction_t *const transaction)
+{
+	const i2casync_status_t status = transaction->status;
+	return (I2CASYNC_STATUS_QUEUED == status) || (I2CASYNC_STATUS_ACTIVE == status);
+}
+
+#endif /* I2CASYNC_H_ */
@@ -10,6 +10,8 @@
 
 #include "derivative.h"
 #include "nice_names.h"
+#include "i2c/i2casync.h"
+#include "imu/mpu6050.h"
 
 /**
  * @brief I2C slave address of the HMC5883L magnetometer
@@ -141,9 +143,19 @@ void HMC5883L_FetchConfiguration(hmc5883l_confreg_t *const configuration);
 /**
  * @brief Stores the HMC5883L configuration
  * @param[in] configuration The configuration
+ * 
+ * Only registers that differ from the last fetched or stored configuration are written.
  */
 void HMC5883L_StoreConfiguration(const hmc5883l_confreg_t *const configuration);
 
+/**
+ * @brief Gets the configuration last fetched from or stored to the device
+ * @param[out] configuration The configuration
+ * 
+ * Fetches the configuration if the device state is unknown.
+ */
+void HMC5883L_RecallConfiguration(hmc5883l_confreg_t *const configuration);
+
 /**
  * Sets the averaging mode
  * @param[inout] configuration The configuration
@@ -179,6 +191,20 @@ void HMC5883L_SetGain(hmc5883l_confreg_t *const configuration, register hmc5883l
  */
 void HMC5883L_SetOperatingMode(hmc5883l_confreg_t *const configuration, register hmc5883l_mode_t mode);
 
+/**
+ * @brief Starts a single measurement
+ * 
+ * The sensor pulls DRDY low once the data is available and returns to idle mode.
+ */
+void HMC5883L_TriggerMeasurement();
+
+/**
+ * @brief Prepares an asynchronous transaction starting a single measurement
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] mode The buffer holding the mode register value to write
+ */
+void HMC5883L_PrepareTriggerMeasurement(i2casync_transaction_t *const transaction, uint8_t *const mode);
+
 
 /**
  * @brief Fetches the data from the HMC5883L
@@ -186,6 +212,59 @@ void HMC5883L_SetOperatingMode(hmc5883l_confreg_t *const configuration, register
  */
 void HMC5883L_ReadData(hmc5883l_data_t *const data);
 
+/**
+ * @brief The number of registers read by {@see HMC5883L_PrepareReadData}, DXRA .. SR
+ */
+#define HMC5883L_DATA_BLOCK_LENGTH	(7)
+
+/**
+ * @brief Prepares an asynchronous read of the sensor data and status
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] block The buffer of {@see HMC5883L_DATA_BLOCK_LENGTH} bytes to read into
+ */
+void HMC5883L_PrepareReadData(i2casync_transaction_t *const transaction, uint8_t (*const block)[HMC5883L_DATA_BLOCK_LENGTH]);
+
+/**
+ * @brief Decodes the data read by an asynchronous transaction
+ * @param[in] block The register block read
+ * @param[out] data The sensor data, including the status register
+ */
+void HMC5883L_DecodeData(const uint8_t (*const block)[HMC5883L_DATA_BLOCK_LENGTH], hmc5883l_data_t *const data);
+
+/**
+ * @brief The register block read from the MPU6050 when the HMC5883L is attached to its auxiliary bus
+ */
+#pragma pack(1)
+typedef struct __attribute__ ((__packed__))
+{
+	mpu6050_intdatareg_t mpu6050;					/*< INT_STATUS .. GYRO_ZOUT_L, 0x3A .. 0x48 */
+	uint8_t hmc5883l[HMC5883L_DATA_BLOCK_LENGTH];	/*< EXT_SENS_DATA_00 .. EXT_SENS_DATA_06, mirrors DXRA .. SR */
+} hmc5883l_passthrough_block_t;
+
+/**
+ * @brief Configures the MPU6050 to read the HMC5883L over its auxiliary bus every sample
+ * @param[inout] configuration The MPU6050 configuration structure
+ * 
+ * The HMC5883L must be configured beforehand, e.g. through the MPU6050 bypass.
+ * Afterwards, it is no longer accessible from the primary bus.
+ */
+void HMC5883L_ConfigurePassThrough(mpu6050_confreg_t *const configuration);
+
+/**
+ * @brief Prepares an asynchronous read of the MPU6050 data together with the passed through HMC5883L data
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] block The buffer to read into
+ */
+void HMC5883L_PreparePassThroughRead(i2casync_transaction_t *const transaction, hmc5883l_passthrough_block_t *const block);
+
+/**
+ * @brief Decodes the data read by an asynchronous pass-through transaction
+ * @param[in] block The register block read
+ * @param[out] mpu6050 The MPU6050 data; status is zero if no fresh data was available
+ * @param[out] data The HMC5883L data, including the status register
+ */
+void HMC5883L_DecodePassThroughData(const hmc5883l_passthrough_block_t *const block, mpu6050_sensor_t *const mpu6050, hmc5883l_data_t *const data);
+
 
 /**
 * @brief Prepares a data buffer by clearing its values.
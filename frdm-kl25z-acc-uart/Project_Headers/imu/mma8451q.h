@@ -10,6 +10,7 @@
 
 #include "derivative.h"
 #include "i2c/i2c.h"
+#include "i2c/i2casync.h"
 
 /**
  * @brief I2C slave address of the MMA8451Q accelerometer
@@ -25,7 +26,12 @@
 #define MMA8451Q_STATUS_Y(status)		(status & 0b00000010)	/*< Y data ready */
 #define MMA8451Q_STATUS_ZDR(status)		(status & 0b00000001)	/*< Z data ready */
 
+#define MMA8451Q_F_STATUS_OVF(status)	(status & 0b10000000)	/*< FIFO overflow, FIFO mode STATUS register */
+#define MMA8451Q_F_STATUS_WMRK(status)	(status & 0b01000000)	/*< FIFO watermark reached, FIFO mode STATUS register */
+#define MMA8451Q_F_STATUS_CNT(status)	(status & 0b00111111)	/*< FIFO sample count, FIFO mode STATUS register */
+
 #define MMA8451Q_REG_STATUS				(0x00)	/*< STATUS register */
+#define MMA8451Q_REG_OUT_X_MSB			(0x01)	/*< OUT_X_MSB register, FIFO data output in FIFO mode */
 #define MMA8451Q_REG_F_SETUP			(0x09)	/*< F_SETUP register */
 #define MMA8451Q_REG_SYSMOD				(0x0B)	/*< SYSMOD register for system mode identification */
 #define MMA8451Q_REG_PL_CFG				(0x11)	/*< PL_CFG register for portrait/landscape detection configuration */
@@ -121,6 +127,26 @@ typedef enum {
 } mma8451q_interrupt_t;
 
 
+/**
+ * @brief FIFO buffer operating mode
+ */
+typedef enum {
+	MMA8451Q_FIFO_DISABLED	= (0b00),	/*< FIFO is disabled */
+	MMA8451Q_FIFO_CIRCULAR	= (0b01),	/*< FIFO contains the most recent samples when overflowed */
+	MMA8451Q_FIFO_FILL		= (0b10),	/*< FIFO stops accepting new samples when overflowed */
+	MMA8451Q_FIFO_TRIGGER	= (0b11)	/*< FIFO keeps the samples around a trigger event */
+} mma8451q_fifomode_t;
+
+/**
+ * @brief The number of samples the MMA8451Q FIFO can hold
+ */
+#define MMA8451Q_FIFO_SIZE			(32)
+
+/**
+ * @brief The number of bytes per FIFO sample in 14bit mode, OUT_X_MSB .. OUT_Z_LSB
+ */
+#define MMA8451Q_FIFO_SAMPLE_LENGTH	(6)
+
 /**
  * @brief Interrupt pin routing
  */
@@ -148,6 +174,16 @@ typedef struct __attribute__ ((__packed__))
 	};
 } mma8451q_acc_t;
 
+/**
+ * @brief The raw FIFO data as read by an asynchronous FIFO transaction
+ */
+#pragma pack(1)
+typedef struct __attribute__ ((__packed__))
+{
+	uint8_t status;												/*< the F_STATUS register contents */
+	uint8_t samples[MMA8451Q_FIFO_SIZE][MMA8451Q_FIFO_SAMPLE_LENGTH];	/*< the big endian samples */
+} mma8451q_fifo_block_t;
+
 /**
  * @brief The MMA8451Q configuration registers
  */
@@ -206,9 +242,19 @@ void MMA8451Q_FetchConfiguration(mma8451q_confreg_t *const configuration);
 /**
  * @brief Stores the configuration from a {@see mma8451q_confreg_t} data structure
  * @param[in] The configuration data data; Must not be null.
+ * 
+ * Only registers that differ from the last fetched or stored configuration are written.
  */
 void MMA8451Q_StoreConfiguration(const mma8451q_confreg_t *const configuration);
 
+/**
+ * @brief Gets the configuration last fetched from or stored to the device
+ * @param[out] configuration The configuration; Must not be null.
+ * 
+ * Fetches the configuration if the device state is unknown.
+ */
+void MMA8451Q_RecallConfiguration(mma8451q_confreg_t *const configuration);
+
 /**
  * @brief Initializes a {@see mma8451q_acc_t} data structure
  * @param[inout] The accelerometer data; Must not be null.
@@ -227,6 +273,57 @@ static inline void MMA8451Q_InitializeData(mma8451q_acc_t *const data)
  */
 void MMA8451Q_ReadAcceleration14bitNoFifo(mma8451q_acc_t *const data);
 
+/**
+ * @brief The number of registers read in 14bit no-fifo mode, STATUS .. OUT_Z_LSB
+ */
+#define MMA8451Q_DATA_BLOCK_LENGTH	(7)
+
+/**
+ * @brief Prepares an asynchronous transaction reading the accelerometer data in 14bit no-fifo mode
+ * @param[out] transaction The transaction; the callback is left untouched
+ * @param[in] block The buffer the raw register data is read into
+ */
+void MMA8451Q_PrepareReadAcceleration14bit(i2casync_transaction_t *const transaction, mma8451q_acc_t *const block);
+
+/**
+ * @brief Decodes the data read by an asynchronous transaction
+ * @param[in] block The buffer the raw register data was read into
+ * @param[out] data The accelerometer data; may be the same as block
+ */
+void MMA8451Q_DecodeAcceleration14bit(const mma8451q_acc_t *const block, mma8451q_acc_t *const data);
+
+/**
+ * @brief Reads the FIFO samples in 14bit mode
+ *
+ * Every sample is popped with its own burst read at OUT_X_MSB.
+ *
+ * @param[out] samples The accelerometer samples; Must not be null.
+ * @param[in] capacity The number of samples that fit into {@see samples}
+ * @return The number of samples read
+ */
+uint8_t MMA8451Q_ReadFifo(mma8451q_acc_t *const samples, uint8_t capacity);
+
+/**
+ * @brief Prepares an asynchronous transaction reading F_STATUS and a batch of FIFO samples
+ *
+ * In FIFO mode the register pointer wraps from OUT_Z_LSB back to OUT_X_MSB,
+ * so a single burst starting at STATUS pops {@see count} samples.
+ *
+ * @param[out] transaction The transaction; the callback is left untouched
+ * @param[in] block The buffer the raw register data is read into
+ * @param[in] count The number of samples to read; at most {@see MMA8451Q_FIFO_SIZE}
+ */
+void MMA8451Q_PrepareReadFifo(i2casync_transaction_t *const transaction, mma8451q_fifo_block_t *const block, uint8_t count);
+
+/**
+ * @brief Decodes the FIFO samples read by an asynchronous transaction
+ * @param[in] block The buffer the raw register data was read into
+ * @param[in] count The number of samples the transaction was prepared for
+ * @param[out] samples The accelerometer samples; the status field holds F_STATUS
+ * @return The number of valid samples, i.e. the lower of {@see count} and the FIFO fill level
+ */
+uint8_t MMA8451Q_DecodeFifo(const mma8451q_fifo_block_t *const block, uint8_t count, mma8451q_acc_t *const samples);
+
 /**
  * @brief Reads the STATUS register from the MMA8451Q.
  * @return Status bits, see MMA8451Q_STATUS_XXXX defines. 
@@ -251,27 +348,19 @@ uint8_t MMA8451Q_LandscapePortraitConfig();
 /**
  * @brief Brings the MMA8451Q into passive mode
  */
-static inline void MMA8451Q_EnterPassiveMode()
-{
-	I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG1, ~0b00000001, I2C_MOD_NO_OR_MASK);
-}
+void MMA8451Q_EnterPassiveMode();
 
 /**
  * @brief Resets the MMA8451Q
+ * 
+ * The registers return to their defaults, so the next store writes the full configuration.
  */
-static inline void MMA8451Q_Reset()
-{
-	I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG2, 0b01000000);
-}
+void MMA8451Q_Reset();
 
 /**
  * @brief Brings the MMA8451Q into active mode
- * @param[inout] configuration The configuration structure or {@see MMA8451Q_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
  */
-static inline void MMA8451Q_EnterActiveMode()
-{
-	I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG1, I2C_MOD_NO_AND_MASK, 0x01);
-}
+void MMA8451Q_EnterActiveMode();
 
 /**
  * @brief Sets the data rate and the active mode
@@ -320,6 +409,18 @@ void MMA8451Q_ConfigureInterrupt(mma8451q_confreg_t *const configuration, mma845
  */
 void MMA8451Q_ClearInterruptConfiguration(mma8451q_confreg_t *const configuration);
 
+/**
+ * @brief Configures the FIFO mode and watermark
+ *
+ * The FIFO mode can only be switched between two enabled modes in standby
+ * mode, so the configuration should be stored while in passive mode.
+ *
+ * @param[inout] configuration The configuration structure or {@see MMA8451Q_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] mode The FIFO mode
+ * @param[in] watermark The sample count at which the FIFO interrupt is raised; 0 disables the watermark
+ */
+void MMA8451Q_SetFifo(mma8451q_confreg_t *const configuration, mma8451q_fifomode_t mode, uint8_t watermark);
+
 /**
  * @brief Configures the oversampling modes
  * @param[inout] configuration The configuration structure or {@see MMA8451Q_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
@@ -12,6 +12,7 @@
 
 #include "derivative.h"
 #include "nice_names.h"
+#include "i2c/i2casync.h"
 
 /**
  * @brief AD0 bit of the I2C slave address of the MPU6050 IMU
@@ -23,6 +24,11 @@
  */
 #define MPU6050_I2CADDR	(0b1101000 | MPU6050_I2CADDR_AD0)
 
+/**
+ * @brief I2C slave address of a second MPU6050 IMU on the same bus, AD0 tied low
+ */
+#define MPU6050_I2CADDR_ALT	(0b1101000)
+
 /**
  * @brief Marker for registers not defined in MPU6000/MPU6050 Register Map document revision 4.0 and 4.3
  * 
@@ -304,6 +310,36 @@ typedef struct __attribute__ ((__packed__))
  */
 #define MPU6050_CONFIGURE_DIRECT ((mpu6050_confreg_t*)0x0)
 
+/**
+ * @brief An MPU6050 instance
+ */
+typedef struct {
+	const uint8_t slaveAddress;		/*< The 7-bit slave address, e.g. {@see MPU6050_I2CADDR_ALT} */
+	i2carbiter_handle_t handle;		/*< The arbiter entry; looked up by address on first use if {@see I2CARBITER_NO_HANDLE} */
+	mpu6050_confreg_t shadow;		/*< The configuration last fetched from or written to the device */
+	uint8_t shadowValid;			/*< Nonzero if shadow matches the device */
+} mpu6050_device_t;
+
+/**
+ * @brief Initializer of an {@see mpu6050_device_t} at the given slave address
+ */
+#define MPU6050_DEVICE_INIT(address) { .slaveAddress = (address), .handle = I2CARBITER_NO_HANDLE, .shadowValid = 0 }
+
+/**
+ * @brief The device at {@see MPU6050_I2CADDR}
+ */
+extern mpu6050_device_t mpu6050_primary;
+
+/**
+ * @brief Selects the device the blocking functions talk to and its I2C slave
+ * @param[in] device The device; NULL selects {@see mpu6050_primary}
+ * @return Zero if successful, nonzero if the device has no arbiter entry
+ * 
+ * The primary device is selected by default; the configuration shadow
+ * is kept per device. Use instead of {@see I2CArbiter_Select}.
+ */
+uint8_t MPU6050_SelectDevice(mpu6050_device_t *const device);
+
 /**
  * @brief Reads the WHO_AM_I register from the MPU6050.
  * @return Device identification code; Should be 0b0110100 (0x68)
@@ -319,9 +355,20 @@ void MPU6050_FetchConfiguration(mpu6050_confreg_t *const configuration);
 /**
  * @brief Stores the configuration from a {@see mpu6050_confreg_t} data structure
  * @param[in] The configuration data data; Must not be null.
+ * 
+ * Only registers that differ from the last fetched or stored configuration are written.
  */
 void MPU6050_StoreConfiguration(const mpu6050_confreg_t *const configuration);
 
+/**
+ * @brief Gets the configuration last fetched from or stored to the device
+ * @param[out] configuration The configuration; Must not be null.
+ * 
+ * Fetches the configuration if the device state is unknown. Pair with
+ * {@see MPU6050_StoreConfiguration} for cheap runtime changes.
+ */
+void MPU6050_RecallConfiguration(mpu6050_confreg_t *const configuration);
+
 /**
  * @brief Configures the gyro sample rate divider
  * @param[inout] configuration The configuration structure or {@see MPU6050_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
@@ -507,6 +554,186 @@ typedef struct __attribute__ ((__packed__))
  */
 void MPU6050_ReadData(mpu6050_sensor_t *data);
 
+/**
+ * @brief The number of registers read by {@see MPU6050_PrepareReadData}, INT_STATUS .. GYRO_ZOUT_L
+ */
+#define MPU6050_DATA_BLOCK_LENGTH	(sizeof(mpu6050_intdatareg_t))
+
+/**
+ * @brief Prepares an asynchronous read of accelerometer, gyro and temperature data
+ * @param[in] device The device to read from or write to
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] block The buffer of {@see MPU6050_DATA_BLOCK_LENGTH} bytes to read into
+ */
+void MPU6050_PrepareReadData(mpu6050_device_t *const device, i2casync_transaction_t *const transaction, mpu6050_intdatareg_t *const block);
+
+/**
+ * @brief Decodes the data read by an asynchronous transaction
+ * @param[in] block The register block read
+ * @param[out] data The data; status is zero if no fresh data was available
+ */
+void MPU6050_DecodeData(const mpu6050_intdatareg_t *const block, mpu6050_sensor_t *const data);
+
+/**
+ * @brief Auxiliary I2C bypass configuration
+ */
+typedef enum {
+	MPU6050_BYPASS_DISABLED	= (0b0),	/*! The auxiliary bus is driven by the MPU6050 I2C master */
+	MPU6050_BYPASS_ENABLED	= (0b1),	/*! The auxiliary bus is connected to the primary bus */
+} mpu6050_bypass_t;
+
+/**
+ * @brief Connects or disconnects the auxiliary I2C bus to or from the primary bus
+ * @param[inout] configuration The configuration structure or {@see MPU6050_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] bypass The bypass configuration
+ */
+void MPU6050_SetBypass(mpu6050_confreg_t *const configuration, mpu6050_bypass_t bypass);
+
+/**
+ * @brief Auxiliary I2C master configuration
+ */
+typedef enum {
+	MPU6050_I2CMASTER_DISABLED	= (0b0),	/*! The I2C master is off */
+	MPU6050_I2CMASTER_ENABLED	= (0b1),	/*! The I2C master reads the configured auxiliary slaves */
+} mpu6050_i2cmaster_t;
+
+/**
+ * @brief Enables or disables the auxiliary I2C master
+ * @param[inout] configuration The configuration structure or {@see MPU6050_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] master The master configuration
+ */
+void MPU6050_SetI2CMaster(mpu6050_confreg_t *const configuration, mpu6050_i2cmaster_t master);
+
+/**
+ * @brief The maximum number of registers read from an auxiliary slave
+ */
+#define MPU6050_AUX_MAX_LENGTH		(15)
+
+/**
+ * @brief Configures the I2C master to read an auxiliary slave into EXT_SENS_DATA_00 every sample
+ * @param[inout] configuration The configuration structure
+ * @param[in] slaveAddress The 7-bit address of the auxiliary slave
+ * @param[in] registerAddress The first register to read
+ * @param[in] count The number of registers to read, 1 .. {@see MPU6050_AUX_MAX_LENGTH}
+ * 
+ * Uses slave 0 at 400 kHz and disables the bypass. The data ready interrupt
+ * is held back until the external data was read, so the internal and
+ * external sensor data registers belong to the same sample.
+ */
+void MPU6050_ConfigureAuxiliaryRead(mpu6050_confreg_t *const configuration, uint8_t slaveAddress, uint8_t registerAddress, uint8_t count);
+
+/**
+ * @brief FIFO configuration
+ */
+typedef enum {
+	MPU6050_FIFO_DISABLED	= (0b0),	/*! No data is written to the FIFO */
+	MPU6050_FIFO_ENABLED	= (0b1),	/*! Accelerometer and gyroscope frames are written to the FIFO */
+} mpu6050_fifo_t;
+
+/**
+ * @brief The size of the FIFO in bytes
+ */
+#define MPU6050_FIFO_SIZE				(1024)
+
+/**
+ * @brief The length of a FIFO frame in bytes; accelerometer xyz followed by gyroscope xyz, big endian
+ */
+#define MPU6050_FIFO_FRAME_LENGTH		(12)
+
+/**
+ * @brief The maximum number of FIFO frames fetched by a single burst read
+ * 
+ * Limited by the 8 bit register count of {@see I2C_ReadRegisters} and {@see i2casync_transaction_t}.
+ */
+#define MPU6050_FIFO_BURST_FRAMES		(255 / MPU6050_FIFO_FRAME_LENGTH)
+
+/**
+ * @brief Configures the FIFO
+ * @param[inout] configuration The configuration structure or {@see MPU6050_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] fifo The FIFO configuration
+ * 
+ * Note that {@see MPU6050_StoreConfiguration} also writes to FIFO_R_W, so
+ * the FIFO should be reset with {@see MPU6050_ResetFifo} afterwards.
+ */
+void MPU6050_ConfigureFifo(mpu6050_confreg_t *const configuration, mpu6050_fifo_t fifo);
+
+/**
+ * @brief Discards the FIFO contents
+ */
+void MPU6050_ResetFifo();
+
+/**
+ * @brief Reads the number of bytes in the FIFO
+ * @return The FIFO count in bytes
+ */
+uint16_t MPU6050_ReadFifoCount();
+
+/**
+ * @brief Reads accelerometer and gyroscope frames from the FIFO
+ * @param[out] samples The samples; temperature is not part of the FIFO frames and is set to zero
+ * @param[in] capacity The maximum number of samples to read
+ * @param[out] overflow Set to nonzero if the FIFO overflowed and was reset; may be NULL
+ * @return The number of samples read
+ */
+uint16_t MPU6050_ReadFifo(mpu6050_sensor_t *const samples, uint16_t capacity, uint8_t *const overflow);
+
+/**
+ * @brief The buffers used by the asynchronous FIFO transactions
+ */
+typedef struct {
+	uint8_t count[2];		/*< FIFO_COUNTH and FIFO_COUNTL */
+	uint8_t userControl;	/*< The USER_CTRL value written by the FIFO reset */
+	uint8_t frames[MPU6050_FIFO_BURST_FRAMES * MPU6050_FIFO_FRAME_LENGTH];	/*< The FIFO frames */
+} mpu6050_fifo_block_t;
+
+/**
+ * @brief Prepares an asynchronous read of the FIFO count
+ * @param[in] device The device to read from or write to
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] block The FIFO buffers
+ */
+void MPU6050_PrepareReadFifoCount(mpu6050_device_t *const device, i2casync_transaction_t *const transaction, mpu6050_fifo_block_t *const block);
+
+/**
+ * @brief Prepares an asynchronous burst read of the frames counted by the FIFO count transaction
+ * @param[in] device The device to read from or write to
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] block The FIFO buffers after the FIFO count transaction completed
+ * @return The number of frames the transaction reads; zero if the FIFO is empty or overflowed
+ */
+uint8_t MPU6050_PrepareReadFifo(mpu6050_device_t *const device, i2casync_transaction_t *const transaction, mpu6050_fifo_block_t *const block);
+
+/**
+ * @brief Prepares an asynchronous FIFO reset
+ * @param[in] device The device to read from or write to
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] block The FIFO buffers
+ * @param[in] userControl The USER_CTRL register value to keep; the FIFO reset bit is added
+ */
+void MPU6050_PrepareResetFifo(mpu6050_device_t *const device, i2casync_transaction_t *const transaction, mpu6050_fifo_block_t *const block, uint8_t userControl);
+
+/**
+ * @brief Determines if the FIFO count read by the FIFO count transaction indicates an overflow
+ * @param[in] block The FIFO buffers after the FIFO count transaction completed
+ * @return Nonzero if the FIFO overflowed and needs to be reset
+ * 
+ * The FIFO size is not a multiple of the frame length, so an overflow
+ * always leaves a partial frame behind.
+ */
+static inline uint8_t MPU6050_FifoOverflowed(const mpu6050_fifo_block_t *const block)
+{
+	const uint16_t count = ((uint16_t)block->count[0] << 8) | block->count[1];
+	return 0 != (count % MPU6050_FIFO_FRAME_LENGTH);
+}
+
+/**
+ * @brief Decodes the frames read by an asynchronous FIFO burst read
+ * @param[in] block The FIFO buffers
+ * @param[in] frames The number of frames read, see {@see MPU6050_PrepareReadFifo}
+ * @param[out] samples The samples; temperature is not part of the FIFO frames and is set to zero
+ */
+void MPU6050_DecodeFifo(const mpu6050_fifo_block_t *const block, uint8_t frames, mpu6050_sensor_t *const samples);
+
 /**
  * @brief Prepares a data buffer by clearing its values.
  * @param[inout] data The data buffer to clear. 
@@ -1,21 +1,75 @@
 #ifndef INIT_SENSORS_H
 #define INIT_SENSORS_H
 
-#define ENABLE_MMA8451Q 0						/*! Used to enable or disable MMA8451Q fetching */
+#define ENABLE_MMA8451Q 0						/*! Used to enable or disable MMA8451Q fetching; also required by FUSION_GYRO_FALLBACK in main.c */
+#define ENABLE_MMA8451Q_FIFO 1					/*! Used to sample the MMA8451Q at 800 Hz into its FIFO and read batches on the watermark interrupt */
+#define ENABLE_MPU6050_FIFO 0					/*! Used to sample the MPU6050 at 1 kHz into its FIFO instead of reading each data ready interrupt */
+#define ENABLE_MPU6050_SECONDARY 0				/*! Used to read a second MPU6050 with AD0 tied low on the same bus and average it with the first one */
+
+#define ENABLE_I2C1_EXTERNAL_BUS 0				/*! Used to attach the MPU6050 and HMC5883L to I2C1 at PTE1 (SCL) and PTE0 (SDA), so they are read concurrently with the MMA8451Q on I2C0 */
+
+#define ENABLE_HMC5883L_PASSTHROUGH 0			/*! Used to read the HMC5883L through the MPU6050 auxiliary I2C master, together with the MPU6050 data */
+
+#define ENABLE_HMC5883L_DRDY 0					/*! Used to trigger single HMC5883L measurements and read them on the DRDY interrupt instead of polling; requires DRDY wired to {@see HMC5883L_DRDY_PIN} */
+
+#define ENABLE_FAST_BOOT 0						/*! Used to skip the LED delays during bring-up; the boot timing is reported in binary instead */
+
+#define HMC5883L_DRDY_PORT	PORTA				/*! Port at which the HMC5883L DRDY pin is attached */
+#define HMC5883L_DRDY_GPIO	GPIOA				/*! Port at which the HMC5883L DRDY pin is attached */
+#define HMC5883L_DRDY_PIN	12					/*! Pin at which the HMC5883L DRDY is attached */
+
+#if ENABLE_HMC5883L_PASSTHROUGH && ENABLE_HMC5883L_DRDY
+#error The HMC5883L DRDY line is not used in pass-through mode
+#endif
+
+#if ENABLE_HMC5883L_PASSTHROUGH && ENABLE_MPU6050_FIFO
+#error The HMC5883L pass-through is not available in MPU6050 FIFO mode
+#endif
+
+#if ENABLE_MPU6050_SECONDARY && (ENABLE_MPU6050_FIFO || ENABLE_HMC5883L_PASSTHROUGH)
+#error The second MPU6050 is only read on its data ready interrupt, without pass-through
+#endif
+
+#define MPU6050_FIFO_POLL_PERIOD		10		/*! Period in milliseconds at which the MPU6050 FIFO is drained */
+#define MPU6050_FIFO_SAMPLE_PERIOD_US	1000	/*! Sample period in microseconds of the MPU6050 in FIFO mode */
+
+#define MMA8451Q_FIFO_WATERMARK		16		/*! Number of MMA8451Q FIFO samples at which the watermark interrupt is raised */
+#define MMA8451Q_FIFO_SAMPLE_PERIOD_US	1250	/*! Sample period in microseconds of the MMA8451Q in FIFO mode */
 
 #define MMA8451Q_INT_PORT	PORTA				/*! Port at which the MMA8451Q INT1 and INT2 pins are attached */
 #define MMA8451Q_INT_GPIO	GPIOA				/*! Port at which the MMA8451Q INT1 and INT2 pins are attached */
 #define MMA8451Q_INT1_PIN	14					/*! Pin at which the MMA8451Q INT1 is attached */
 #define MMA8451Q_INT2_PIN	15					/*! Pin at which the MMA8451Q INT2 is attached */
+#define MMA8451Q_INT_IRQC	0b1000				/*! PORT_PCR_IRQC of the MMA8451Q INT pins; interrupt while low, since a missed edge would stop the reads */
 
 #define MPU6050_INT_PORT	PORTA				/*! Port at which the MPU6050 INT pin is attached */
 #define MPU6050_INT_GPIO	GPIOA				/*! Port at which the MPU6050 INT pin is attached */
 #define MPU6050_INT_PIN		13					/*! Pin at which the MPU6050 INT is attached */
 
+#define MPU6050_SECONDARY_INT_PORT	PORTA		/*! Port at which the INT pin of the second MPU6050 is attached */
+#define MPU6050_SECONDARY_INT_GPIO	GPIOA		/*! Port at which the INT pin of the second MPU6050 is attached */
+#define MPU6050_SECONDARY_INT_PIN	16			/*! Pin at which the INT of the second MPU6050 is attached */
+
 #include "fixmath.h"
+#include "imu/hmc5883l.h"
+#include "imu/mpu6050.h"
 
+#if ENABLE_MPU6050_SECONDARY
 /**
-* @brief Sets up the MMA8451Q communication
+* @brief The MPU6050 at {@see MPU6050_I2CADDR_ALT}
+*/
+extern mpu6050_device_t mpu6050_secondary;
+#endif
+
+/**
+* @brief Identifies and resets the MMA8451Q
+*
+* The reset completes while the other sensors are initialized, see {@see InitMMA8451Q}.
+*/
+void ResetMMA8451Q();
+
+/**
+* @brief Sets up the MMA8451Q communication once the reset of {@see ResetMMA8451Q} has completed
 */
 void InitMMA8451Q();
 
@@ -24,11 +78,28 @@ void InitMMA8451Q();
 */
 void InitMPU6050();
 
+/**
+* @brief Sets up the communication with the second MPU6050, see {@see ENABLE_MPU6050_SECONDARY}
+*/
+void InitMPU6050Secondary();
+
 /**
 * @brief Sets up the HMC5883L communication
 */
 void InitHMC5883L();
 
+/**
+* @brief Sets the MPU6050 sample rate divider at runtime
+* @param[in] divider The divider in a range of 1..255
+*/
+void SetMPU6050SampleRateDivider(uint8_t divider);
+
+/**
+* @brief Sets the HMC5883L output rate at runtime
+* @param[in] rate The output rate
+*/
+void SetHMC5883LOutputRate(hmc5883l_do_t rate);
+
 /**
 * @brief Gets the scaling value for the MPU6050 accelerometer
 */
@@ -44,4 +115,27 @@ fix16_t mpu6050_gyroscope_get_scaler();
 */
 fix16_t hmc5883l_magnetometer_get_scaler();
 
+/**
+* @brief Gets the scaling value for the MMA8451Q accelerometer
+*/
+fix16_t mma8451q_accelerometer_get_scaler();
+
+/**
+* @brief Gets the HMC5883L polling period of the configured output rate
+* @return The period in milliseconds
+*/
+uint16_t hmc5883l_get_period();
+
+/**
+* @brief Gets the MPU6050 read period of the configured sample rate
+* @return The period in microseconds; the FIFO poll period in FIFO mode
+*/
+uint32_t mpu6050_get_period_us();
+
+/**
+* @brief Gets the MMA8451Q read period of the configured data rate
+* @return The period in microseconds; the watermark interval in FIFO mode
+*/
+uint32_t mma8451q_get_period_us();
+
 #endif
\ No newline at end of file
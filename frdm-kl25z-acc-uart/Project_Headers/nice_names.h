@@ -63,5 +63,13 @@
 
 #define UART0	UART0_BASE_PTR
 #define I2C0	I2C0_BASE_PTR
+#define I2C1	I2C1_BASE_PTR
+#define DMA0	DMA_BASE_PTR
+#define DMAMUX0	DMAMUX0_BASE_PTR
+#define TPM1	TPM1_BASE_PTR
+#define FTFA	FTFA_BASE_PTR
+#define LPTMR0	LPTMR0_BASE_PTR
+#define OSC0	OSC0_BASE_PTR
+#define SMC		SMC_BASE_PTR
 
 #endif /* NICE_NAMES_H_ */
@@ -16,7 +16,41 @@ typedef enum {
     RPY = 42,               //!< Derived roll/pitch/yaw angles
     QUATERNION = 43,        //!< Fused quaternion only
     QUATERNION_RPY = 44,    //!< Fused quaternion and derived roll/pitch/yaw angles
+    QUATERNION_BATCH = 45,  //!< Every fused quaternion, batched with sequence number and CRC
+    QUATERNION_Q14 = 46,    //!< Fused quaternion as four Q1.14 values
+    QUATERNION_RPY_Q14 = 47,//!< Fused quaternion as four Q1.14 values and roll/pitch/yaw angles as three Q2.13 values
+    QUATERNION_SMALLEST3 = 48, //!< Fused quaternion in smallest-three encoding as three Q1.15 values
+    RAW_CAPTURE = 49,       //!< Timestamped raw MPU6050 (frame type 49) and HMC5883L (frame type 50) samples at full rate, batched
+    QUATERNION_TIMESTAMPED = 51, //!< Every fused quaternion with the capture time of its newest gyroscope sample, batched
+    PIPELINE_HEALTH = 52,   //!< Fused quaternion as in QUATERNION, plus latency, jitter and sample interval histograms (frame type 52) with the link status
 
 } output_mode_t;
 
+/*!
+* \brief Determines if a value is one of the defined output modes
+* \param[in] mode The value, e.g. received from the host
+* \return Nonzero if the value names an {@see output_mode_t}
+*
+* Lists every mode without a default, so a new mode missing here is a -Wswitch warning.
+*/
+static inline int OutputMode_IsValid(const output_mode_t mode)
+{
+    switch (mode)
+    {
+        case SENSORS_RAW:
+        case RPY:
+        case QUATERNION:
+        case QUATERNION_RPY:
+        case QUATERNION_BATCH:
+        case QUATERNION_Q14:
+        case QUATERNION_RPY_Q14:
+        case QUATERNION_SMALLEST3:
+        case RAW_CAPTURE:
+        case QUATERNION_TIMESTAMPED:
+        case PIPELINE_HEALTH:
+            return 1;
+    }
+    return 0;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,107 @@
+/*
+* parameters.h
+*
+* Versioned, CRC protected parameter block persisted in the last flash sector
+*
+*  Created on: Oct 14, 2026
+*      Author: agent
+*/
+
+#ifndef PARAMETERS_H_
+#define PARAMETERS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "fixmath.h"
+#include "fusion/sensor_calibration.h"
+
+#define PARAMETERS_MAGIC	(0x4D524150u)		/*! Identifies a parameter block, "PARM" in memory order */
+#define PARAMETERS_VERSION	(2u)				/*! The layout version; a stored block of another version is ignored */
+
+/**
+* @brief Sensor calibration, see sensor_calibration.h
+*/
+typedef struct {
+    calibration_matrix_t mpu6050_accelerometer;     /*< Affine calibration of the scaled MPU6050 accelerometer data */
+    calibration_matrix_t mpu6050_gyroscope;         /*< Affine calibration of the scaled MPU6050 gyroscope data in degree per second */
+    calibration_matrix_t hmc5883l;                  /*< Affine calibration of the scaled HMC5883L data */
+    calibration_matrix_t mma8451q_accelerometer;    /*< Affine calibration of the scaled MMA8451Q data, including the rotation into the MPU6050 frame */
+    fix16_t var_mpu6050_accelerometer[3];           /*< MPU6050 accelerometer variances */
+    fix16_t var_mpu6050_gyroscope[3];               /*< MPU6050 gyroscope variances */
+    fix16_t var_hmc5883l[3];                        /*< HMC5883L variances */
+    fix16_t var_mma8451q_accelerometer[3];          /*< MMA8451Q accelerometer variances */
+} calibration_parameters_t;
+
+/**
+* @brief Kalman filter tuning, see sensor_fusion.c
+*/
+typedef struct {
+    fix16_t initial_r_axis;         /*< Observation axis uncertainty (accelerometer) */
+    fix16_t initial_r_projection;   /*< Observation projection uncertainty (magnetometer) */
+    fix16_t initial_r_gyro;         /*< Observation gyro uncertainty */
+    fix16_t q_axis;                 /*< Accelerometer process noise */
+    fix16_t q_gyro;                 /*< Gyro process noise */
+    fix16_t alpha1;                 /*< Tuning factor for the axis observation */
+    fix16_t alpha2;                 /*< Tuning factor for the gyro observation */
+} fusion_parameters_t;
+
+/**
+* @brief Sensor configuration applied by init_sensors.c
+*/
+typedef struct {
+    uint8_t mpu6050_sample_rate_divider;    /*< The MPU6050 sample rate divider of the 8 kHz gyro rate, unless in FIFO mode */
+    uint8_t mpu6050_gyroscope_full_scale;   /*< The MPU6050 gyroscope range, {@see mpu6050_gyro_fs_t} */
+    uint8_t mpu6050_accelerometer_full_scale; /*< The MPU6050 accelerometer range, {@see mpu6050_acc_fs_t} */
+    uint8_t hmc5883l_averaging;             /*< The HMC5883L averaging, {@see hmc5883l_ma_t} */
+    uint8_t hmc5883l_output_rate;           /*< The HMC5883L output rate, {@see hmc5883l_do_t} */
+    uint8_t hmc5883l_gain;                  /*< The HMC5883L gain, {@see hmc5883l_gain_t} */
+    uint8_t mma8451q_sensitivity;           /*< The MMA8451Q range, {@see mma8451q_sensitivity_t} */
+    uint8_t mma8451q_data_rate;             /*< The MMA8451Q data rate unless in FIFO mode, {@see mma8451q_datarate_t} */
+} sensor_parameters_t;
+
+/**
+* @brief The parameter block
+*
+* The block is stored as-is, so the layout must only change together with {@see PARAMETERS_VERSION}.
+* Its size is a multiple of the four byte flash programming unit.
+*/
+typedef struct {
+    uint32_t magic;                         /*< {@see PARAMETERS_MAGIC} */
+    uint16_t version;                       /*< {@see PARAMETERS_VERSION} */
+    uint16_t size;                          /*< The size of the block in bytes */
+    calibration_parameters_t calibration;   /*< Sensor calibration */
+    fusion_parameters_t fusion;             /*< Filter tuning */
+    sensor_parameters_t sensors;            /*< Sensor configuration */
+    uint16_t reserved;                      /*< Padding, zero */
+    uint16_t crc;                           /*< CRC-16 of all preceding bytes */
+} parameters_t;
+
+/**
+* @brief The parameters in use
+*/
+extern parameters_t parameters;
+
+/**
+* @brief Loads the stored parameters, or the compiled-in defaults if none are stored
+* @return true if the stored parameters were loaded
+*
+* Must be called before the sensors are initialized.
+*/
+bool Parameters_Load();
+
+/**
+* @brief Stores the parameters in use in flash
+* @return 0 on success, otherwise the flash error flags or 0xFF if the verification failed
+*
+* Erases and reprograms the parameter sector with interrupts masked for several milliseconds.
+*/
+uint8_t Parameters_Store();
+
+/**
+* @brief Erases the stored parameters, so that the next boot uses the defaults
+* @return 0 on success, otherwise the flash error flags
+*/
+uint8_t Parameters_Erase();
+
+#endif // PARAMETERS_H_
@@ -0,0 +1,182 @@
+/*
+* sensor_pipeline.h
+*
+* Common sensor driver interface and the stage draining the sensor queues into the fusion engine
+*
+*  Created on: Oct 14, 2026
+*      Author: agent
+*/
+
+#ifndef SENSOR_PIPELINE_H_
+#define SENSOR_PIPELINE_H_
+
+#include <stdint.h>
+
+#include "fixvector3d.h"
+#include "comm/samplequeue.h"
+#include "fusion/accelerometer_merge.h"
+#include "fusion/sensor_average.h"
+
+#define SENSOR_PIPELINE_MAX_DRIVERS	(4)		/*! The maximum number of drivers per pipeline */
+#define SENSOR_HEALTH_TIMEOUT_PERIODS	(8)		/*! Number of expected read periods without fresh data after which a sensor counts as stuck */
+#define SENSOR_HEALTH_TIMEOUT_SLACK_US	(20000)	/*! Added to the timeout to cover the bus and main loop delays */
+
+/**
+* @brief The measured quantities, each feeding one fusion input
+*/
+typedef enum {
+    SENSOR_CHANNEL_ACCELEROMETER = 0,   /*< Acceleration, feeds {@see fusion_set_accelerometer_v3d} */
+    SENSOR_CHANNEL_GYROSCOPE = 1,       /*< Angular rate, feeds {@see fusion_set_gyroscope_v3d} */
+    SENSOR_CHANNEL_MAGNETOMETER = 2,    /*< Magnetic field, feeds {@see fusion_set_magnetometer_v3d} */
+    SENSOR_CHANNEL_COUNT = 3            /*< The number of channels */
+} sensor_channel_t;
+
+/**
+* @brief The bit of a channel in a channel mask
+*/
+#define SENSOR_CHANNEL_MASK(channel)	((uint8_t)(1u << (channel)))
+
+typedef struct sensor_driver_t sensor_driver_t;
+
+/**
+* @brief A decoded sensor read, i.e. one sample or one FIFO burst
+*/
+typedef struct {
+    const sensor_driver_t *driver;  /*< The driver that decoded the read */
+    uint32_t timestamp;             /*< The capture time of the newest sample in microseconds */
+    uint16_t sequence;              /*< The sequence number of the read, see {@see sample_queue_t} */
+    uint8_t count;                  /*< The number of samples; more than one for FIFO bursts */
+    uint8_t channels;               /*< The channels with fresh data, see {@see SENSOR_CHANNEL_MASK} */
+} sensor_event_t;
+
+/**
+* @brief A sensor driver
+*
+* The asynchronous read publishes register blocks to the queue. The pipeline
+* decodes them in place into the driver state, from where the samples are
+* prepared for fusion; no register block is copied.
+*/
+struct sensor_driver_t {
+    sample_queue_t *queue;      /*< The queue the reads are published to */
+    void (*submit)(const uint32_t timestamp);   /*< Starts a read captured at the given time in microseconds; NULL if the reads are chained by the driver */
+    uint8_t (*decode)(const sample_entry_t *const entry, sensor_event_t *const event);  /*< Decodes a published block, sets the sample count and clears the stale channels; returns zero to drop the read */
+    void (*prepare)(const sensor_channel_t channel, const uint8_t index, v3d *const out);  /*< Converts and calibrates a sample of the last decoded read; NULL if nothing is fused */
+    uint32_t period;            /*< The sample period within a burst in microseconds */
+    uint32_t (*expected_period)();  /*< The configured interval between two reads in microseconds; NULL if the sensor is not monitored */
+    void (*recover)();          /*< Re-initializes a stuck sensor and restarts its reads; NULL if it cannot be recovered */
+    uint8_t channels;           /*< The channels the sensor measures */
+    uint8_t sinks;              /*< The channels passed on to the fusion engine */
+    accelerometer_source_t accelerometer;   /*< The accelerometer merge input of the accelerometer channel */
+    uint8_t replica;            /*< Zero for a primary sensor; else the replica index of a redundant MPU6050, see {@see sensor_average_record} */
+};
+
+/**
+* @brief The health of a sensor accumulated between two reports
+*
+* The achieved rate is <code>reads / interval</code>, to be compared against
+* {@see expectedPeriod}. A read without any fresh channel, i.e. one that
+* repeats the previous data, counts as stale and does not feed the watchdog.
+*/
+typedef struct {
+    uint32_t expectedPeriod;    /*< The configured interval between two reads in microseconds */
+    uint32_t maxGap;            /*< The longest interval between two fresh reads in microseconds */
+    uint16_t reads;             /*< The number of reads with fresh data */
+    uint16_t staleReads;        /*< The number of reads without fresh data */
+    uint16_t dropouts;          /*< The number of watchdog timeouts */
+    uint16_t recoveries;        /*< The number of re-initializations of the sensor */
+} sensor_health_report_t;
+
+/**
+* @brief The health monitor state of a sensor
+*/
+typedef struct {
+    sensor_health_report_t report;  /*< The health since the last report */
+    uint32_t lastFresh;             /*< The capture time of the last fresh read in microseconds */
+} sensor_health_t;
+
+/**
+* @brief The drivers drained by the pipeline stage
+*/
+typedef struct {
+    const sensor_driver_t *drivers[SENSOR_PIPELINE_MAX_DRIVERS];    /*< The registered drivers */
+    sensor_health_t health[SENSOR_PIPELINE_MAX_DRIVERS];            /*< The health per registered driver */
+    uint8_t count;                                                  /*< The number of registered drivers */
+} sensor_pipeline_t;
+
+/**
+* @brief Adds a driver to the pipeline
+* @param[in] pipeline The pipeline
+* @param[in] driver The driver; must stay valid
+* @return Zero on success, nonzero if the pipeline is full
+*/
+uint8_t SensorPipeline_Register(sensor_pipeline_t *const pipeline, const sensor_driver_t *const driver);
+
+/**
+* @brief Decodes the oldest published read over all drivers
+* @param[in] pipeline The pipeline
+* @param[out] event The decoded read
+* @return Nonzero if a read was decoded
+*
+* The reads are taken in capture time order, so that a slow sensor does not
+* overtake a pending faster one. The queue slot is released after decoding.
+*/
+uint8_t SensorPipeline_Next(sensor_pipeline_t *const pipeline, sensor_event_t *const event);
+
+/**
+* @brief Determines if any driver has a published read
+* @param[in] pipeline The pipeline
+* @return Nonzero if {@see SensorPipeline_Next} has a read to decode
+*/
+uint8_t SensorPipeline_Pending(const sensor_pipeline_t *const pipeline);
+
+/**
+* @brief Re-initializes the sensors that delivered no fresh data for too long
+* @param[in] pipeline The pipeline
+* @param[in] now The current time in microseconds
+* @return Nonzero if a sensor was re-initialized
+*
+* A sensor is stuck after {@see SENSOR_HEALTH_TIMEOUT_PERIODS} of its expected
+* periods plus {@see SENSOR_HEALTH_TIMEOUT_SLACK_US} without a fresh read, e.g.
+* when its interrupt line stopped toggling or it keeps returning the same data.
+* The recovery blocks, so every watchdog restarts afterwards.
+*/
+uint8_t SensorPipeline_Watchdog(sensor_pipeline_t *const pipeline, const uint32_t now);
+
+/**
+* @brief Starts the watchdog timeouts of all drivers
+* @param[in] pipeline The pipeline
+* @param[in] now The current time in microseconds
+*/
+void SensorPipeline_StartWatchdog(sensor_pipeline_t *const pipeline, const uint32_t now);
+
+/**
+* @brief Restarts the health accumulation of all drivers
+* @param[in] pipeline The pipeline
+* @param[out] reports The health since the last call, indexed by registration order; NULL to discard
+*/
+void SensorPipeline_Report(sensor_pipeline_t *const pipeline, sensor_health_report_t reports[SENSOR_PIPELINE_MAX_DRIVERS]);
+
+/**
+* @brief Passes the newest sample of every fresh fused channel to the fusion engine
+* @param[in] event The decoded read
+* @param[out] prepared The samples fed, indexed by {@see sensor_channel_t}; only fed channels are written
+* @return The mask of the channels fed
+*
+ * Accelerometer samples are merged with the other accelerometer first, see {@see accelerometer_merge}.
+* The samples of a replica are only kept for the average of the primary's next sample and
+* nothing is fed, see {@see sensor_average}.
+*/
+uint8_t SensorPipeline_Feed(const sensor_event_t *const event, v3d prepared[SENSOR_CHANNEL_COUNT]);
+
+/**
+* @brief Determines the capture time of a sample of a burst
+* @param[in] event The decoded read
+* @param[in] index The sample index, zero being the oldest
+* @return The capture time in microseconds, back-dated from the newest sample
+*/
+static inline uint32_t SensorPipeline_SampleTime(const sensor_event_t *const event, const uint8_t index)
+{
+    return event->timestamp - (uint32_t)(event->count - 1 - index) * event->driver->period;
+}
+
+#endif // SENSOR_PIPELINE_H_
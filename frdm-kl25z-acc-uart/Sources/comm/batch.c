@@ -0,0 +1,118 @@
+/*
+ * batch.c
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include "nice_names.h"
+#include "comm/batch.h"
+#include "comm/crc16.h"
+#include "comm/io.h"
+
+#define BATCH_TYPE_OFFSET		(0) /*< offset of the frame type in the frame */
+#define BATCH_SEQUENCE_OFFSET	(1) /*< offset of the sequence number in the frame */
+#define BATCH_COUNT_OFFSET		(3) /*< offset of the sample count in the frame */
+#define BATCH_SIZE_OFFSET		(4) /*< offset of the sample size in the frame */
+
+/**
+ * @brief Initializes a batch
+ * @param[in] batch The batch instance
+ * @param[in] type The frame type
+ * @param[in] sampleSize The size of a single sample in bytes
+ * @param[in] capacity The number of samples per batch; capacity*sampleSize must not exceed {@see BATCH_MAX_PAYLOAD}
+ * @return Zero on success, nonzero if the configuration is invalid
+ */
+uint8_t Batch_Init(batch_t *const batch, uint8_t type, uint8_t sampleSize, uint8_t capacity)
+{
+	if (0 == capacity || 0 == sampleSize || ((uint32_t)capacity * sampleSize) > BATCH_MAX_PAYLOAD) return 1;
+	
+	batch->capacity = capacity;
+	batch->count = 0;
+	batch->sequence = 0;
+	batch->firstSampleTime = 0;
+	
+	batch->frame[BATCH_TYPE_OFFSET] = type;
+	batch->frame[BATCH_SIZE_OFFSET] = sampleSize;
+	return 0;
+}
+
+/**
+ * @brief Appends a sample to the batch
+ * @param[in] batch The batch instance
+ * @param[in] sample The sample data of the configured sample size
+ * @param[in] time The current system time in milliseconds
+ * @return Nonzero if the batch is full and must be flushed
+ */
+uint8_t Batch_Append(batch_t *const batch, const void *const sample, uint32_t time)
+{
+	assert(batch->count < batch->capacity);
+	
+	const uint8_t sampleSize = batch->frame[BATCH_SIZE_OFFSET];
+	if (0 == batch->count)
+	{
+		batch->firstSampleTime = time;
+	}
+	
+	register const uint8_t *source = (const uint8_t*)sample;
+	register uint8_t *target = &batch->frame[BATCH_HEADER_LENGTH + batch->count * sampleSize];
+	for (uint8_t i=0; i<sampleSize; ++i)
+	{
+		target[i] = source[i];
+	}
+	return ++batch->count >= batch->capacity;
+}
+
+/**
+ * @brief Determines if a batch should be flushed
+ * @param[in] batch The batch instance
+ * @param[in] time The current system time in milliseconds
+ * @param[in] deadline The maximum age of the first sample in milliseconds
+ * @return Nonzero if the batch is full or the deadline has passed
+ */
+uint8_t Batch_Due(const batch_t *const batch, uint32_t time, uint32_t deadline)
+{
+	if (0 == batch->count) return 0;
+	return (batch->count >= batch->capacity) || ((time - batch->firstSampleTime) >= deadline);
+}
+
+/**
+ * @brief Determines the time until a batch becomes due by its deadline
+ * @param[in] batch The batch instance
+ * @param[in] time The current system time in milliseconds
+ * @param[in] deadline The maximum age of the first sample in milliseconds
+ * @return The time in milliseconds, zero if the batch is due now, or UINT32_MAX if it is empty
+ */
+uint32_t Batch_Remaining(const batch_t *const batch, uint32_t time, uint32_t deadline)
+{
+	if (0 == batch->count) return UINT32_MAX;
+	if (Batch_Due(batch, time, deadline)) return 0;
+	return deadline - (time - batch->firstSampleTime);
+}
+
+/**
+ * @brief Sends the batch, if not empty, and starts a new one
+ * @param[in] batch The batch instance
+ * 
+ * Must only be used after initialization of Uart0 interrupt.
+ */
+void Batch_Flush(batch_t *const batch)
+{
+	if (0 == batch->count) return;
+	
+	/* finish the header */
+	const uint16_t sequence = batch->sequence++;
+	batch->frame[BATCH_SEQUENCE_OFFSET] = (uint8_t)(sequence & 0xFF);
+	batch->frame[BATCH_SEQUENCE_OFFSET+1] = (uint8_t)(sequence >> 8);
+	batch->frame[BATCH_COUNT_OFFSET] = batch->count;
+	
+	/* append the checksum */
+	const uint32_t length = BATCH_HEADER_LENGTH + batch->count * batch->frame[BATCH_SIZE_OFFSET];
+	const uint16_t crc = CRC16_Update(CRC16_INITIAL_VALUE, batch->frame, length);
+	batch->frame[length] = (uint8_t)(crc & 0xFF);
+	batch->frame[length+1] = (uint8_t)(crc >> 8);
+	
+	IO_SendFramePrefixed(NULL, 0, batch->frame, length + BATCH_TRAILER_LENGTH);
+	
+	batch->count = 0;
+}
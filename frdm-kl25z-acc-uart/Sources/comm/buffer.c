@@ -26,7 +26,171 @@ uint8_t RingBuffer_Init(buffer_t *const buffer, uint8_t (*const data)[], const u
 	*(uint8_t**)(&buffer->data) = (uint8_t*)*data;
 	*(uint32_t*)(&buffer->size) = size;
 	*(uint32_t*)(&buffer->mask) = size-1;
-	buffer->writeIndex = buffer->readIndex = 0;
+	buffer->writeIndex = buffer->readIndex = buffer->claimIndex = 0;
+	buffer->policy = RINGBUFFER_POLICY_BLOCK;
+	buffer->overflows = buffer->drops = 0;
+	buffer->frameHead = buffer->frameCount = 0;
 	
 	return 0;
 }
+
+/**
+ * @brief Gets the start index of a pending frame
+ * @param[in] buffer The ring buffer instance
+ * @param[in] frame The frame number, zero being the oldest
+ * @return The (free running) start index
+ */
+static inline uint32_t FrameStart(const buffer_t *const buffer, const uint8_t frame)
+{
+	return buffer->frameStart[(buffer->frameHead + frame) % RINGBUFFER_FRAME_SLOTS];
+}
+
+/**
+ * @brief Forgets the boundaries of frames that were completely consumed by the reader
+ * @param[in] buffer The ring buffer instance
+ */
+static void RetireFrames(buffer_t *const buffer)
+{
+	const uint32_t readIndex = buffer->readIndex;
+	while (buffer->frameCount > 0)
+	{
+		/* a frame ends where the next one starts, the newest one at the write index */
+		const uint32_t end = (buffer->frameCount > 1) ? FrameStart(buffer, 1) : buffer->writeIndex;
+		if ((int32_t)(end - readIndex) > 0) break;
+		
+		buffer->frameHead = (buffer->frameHead + 1) % RINGBUFFER_FRAME_SLOTS;
+		--buffer->frameCount;
+	}
+}
+
+/**
+ * @brief Tests if a frame of the given size can be reserved
+ * @param[in] buffer The ring buffer instance
+ * @param[in] count The number of items
+ * @return nonzero if the frame fits
+ */
+static inline uint8_t Fits(const buffer_t *const buffer, const uint32_t count)
+{
+	return (RingBuffer_Free(buffer) >= count) && (buffer->frameCount < RINGBUFFER_FRAME_SLOTS);
+}
+
+/**
+ * @brief Discards the oldest frames not claimed by the reader until a frame of the given size fits
+ * @param[in] buffer The ring buffer instance
+ * @param[in] count The number of items
+ * @return nonzero if enough room was made
+ * 
+ * Frames behind the dropped ones are moved down to keep the data contiguous.
+ */
+static uint8_t DropOldest(buffer_t *const buffer, const uint32_t count)
+{
+	uint8_t success = 0;
+	
+	/* the reader must not advance (or claim) while frames are moved */
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	const uint32_t claimIndex = buffer->claimIndex;
+	const uint32_t writeIndex = buffer->writeIndex;
+	const uint32_t free = RingBuffer_Free(buffer);
+	
+	/* skip the frame in transmission */
+	uint8_t first = 0;
+	while (first < buffer->frameCount && (int32_t)(FrameStart(buffer, first) - claimIndex) < 0)
+	{
+		++first;
+	}
+	
+	/* determine the range of frames to drop */
+	const uint32_t dropStart = (first < buffer->frameCount) ? FrameStart(buffer, first) : writeIndex;
+	uint32_t dropEnd = dropStart;
+	uint8_t last = first;
+	while ((free + (dropEnd - dropStart) < count) || (buffer->frameCount - (last - first) >= RINGBUFFER_FRAME_SLOTS))
+	{
+		if (last >= buffer->frameCount) goto done;
+		
+		++last;
+		dropEnd = (last < buffer->frameCount) ? FrameStart(buffer, last) : writeIndex;
+	}
+	
+	if (last != first)
+	{
+		const uint32_t removed = dropEnd - dropStart;
+		const uint8_t dropped = last - first;
+		
+		/* move newer frames down */
+		register uint32_t to = dropStart;
+		for (register uint32_t from = dropEnd; from != writeIndex; ++from, ++to)
+		{
+			buffer->data[buffer->mask & to] = buffer->data[buffer->mask & from];
+		}
+		
+		/* rebase the remaining frame boundaries */
+		for (uint8_t frame = last; frame < buffer->frameCount; ++frame)
+		{
+			buffer->frameStart[(buffer->frameHead + frame - dropped) % RINGBUFFER_FRAME_SLOTS] = FrameStart(buffer, frame) - removed;
+		}
+		
+		buffer->frameCount -= dropped;
+		buffer->drops += dropped;
+		
+		__DMB();
+		buffer->writeIndex = to;
+		__DMB();
+	}
+	success = 1;
+	
+done:
+	__set_PRIMASK(primask);
+	return success;
+}
+
+/**
+ * @brief Reserves a span of items for writing a frame, applying the buffer's full buffer policy.
+ * @param[in] buffer The ring buffer instance
+ * @param[in] count The number of items to reserve; Must not exceed the buffer size
+ * @param[out] index The (free running) index of the first reserved item, to be used with {@see RingBuffer_Put} and {@see RingBuffer_Commit}
+ * @return Zero on success, nonzero if the frame was dropped according to the policy
+ */
+uint8_t RingBuffer_Reserve(buffer_t *const buffer, const uint32_t count, uint32_t *const index)
+{
+	assert(count <= buffer->size);
+	
+	RetireFrames(buffer);
+	if (!Fits(buffer, count))
+	{
+		++buffer->overflows;
+		
+		switch (buffer->policy)
+		{
+			case RINGBUFFER_POLICY_DROP_NEWEST:
+			{
+				++buffer->drops;
+				return 1;
+			}
+			case RINGBUFFER_POLICY_DROP_OLDEST:
+			{
+				if (DropOldest(buffer, count)) break;
+				
+				/* the claimed span alone is too large, so drop this one instead */
+				++buffer->drops;
+				return 1;
+			}
+			case RINGBUFFER_POLICY_BLOCK:
+			default:
+			{
+				while (!Fits(buffer, count))
+				{
+#if RINGBUFFER_ENABLE_WFI_ON_BLOCK
+					__WFI();
+#endif
+					RetireFrames(buffer);
+				}
+				break;
+			}
+		}
+	}
+	
+	*index = buffer->writeIndex;
+	return 0;
+}
@@ -0,0 +1,237 @@
+/*
+ * command.c
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include "nice_names.h"
+#include "comm/command.h"
+#include "comm/p2pprotocol.h"
+#include "comm/uart.h"
+#include "comm/io.h"
+#include "cpu/systick.h"
+#include "imu/hmc5883l.h"
+#include "i2c/i2casync.h"
+#include "fusion/sensor_prepare.h"
+#include "init_sensors.h"
+#include "parameters.h"
+
+/**
+ * @brief The frame decoder for received commands
+ */
+static p2ppe_decoder_t decoder;
+
+/**
+ * @brief The runtime settings modified by commands
+ */
+static command_settings_t *commandSettings = NULL;
+
+/**
+ * @brief The transmit buffer
+ */
+static buffer_t *commandTransmitFifo = NULL;
+
+/**
+ * @brief Initializes the command channel
+ * @param[in] settings The runtime settings to operate on
+ * @param[in] transmitFifo The transmit buffer whose policy can be changed
+ */
+void Command_Init(command_settings_t *const settings, buffer_t *const transmitFifo)
+{
+	commandSettings = settings;
+	commandTransmitFifo = transmitFifo;
+	P2PPE_DecoderInit(&decoder);
+}
+
+/**
+ * @brief Reads a 16 bit value in native endianness
+ * @param[in] data The data
+ * @return The value
+ */
+static inline uint16_t ReadUInt16(const uint8_t *const data)
+{
+	return (uint16_t)data[0] | ((uint16_t)data[1] << 8);
+}
+
+/**
+ * @brief Reads a 32 bit value in native endianness
+ * @param[in] data The data
+ * @return The value
+ */
+static inline uint32_t ReadUInt32(const uint8_t *const data)
+{
+	return (uint32_t)ReadUInt16(&data[0]) | ((uint32_t)ReadUInt16(&data[2]) << 16);
+}
+
+/**
+ * @brief Sends a command response
+ * @param[in] command The command identifier
+ * @param[in] status The status
+ */
+static void SendResponse(uint8_t command, command_status_t status)
+{
+	uint8_t type = COMMAND_RESPONSE_TYPE;
+	uint8_t response[2] = { command, (uint8_t)status };
+	IO_SendFramePrefixed(&type, 1, response, sizeof(response));
+}
+
+/**
+ * @brief Sends the response to {@see COMMAND_PING}
+ * @param[in] echo The echo argument
+ * 
+ * The departure time is taken last, right before the frame is encoded; the host
+ * rejects responses delayed by earlier frames in the transmit buffer by their round trip.
+ */
+static void SendPingResponse(const uint32_t echo)
+{
+	uint8_t response[3] = { COMMAND_RESPONSE_TYPE, COMMAND_PING, COMMAND_STATUS_OK };
+	uint32_t times[3] = { echo, Uart0_FrameEndTime(), 0 };
+	times[2] = SysTick_Microseconds();
+	IO_SendFramePrefixed(response, sizeof(response), (const uint8_t*)times, sizeof(times));
+}
+
+/**
+ * @brief Executes a decoded command
+ * @param[in] data The command frame payload
+ * @param[in] length The payload length
+ */
+static void Execute(const uint8_t *const data, const uint8_t length)
+{
+	const uint8_t command = data[0];
+	const uint8_t *const args = &data[1];
+	const uint8_t argc = length - 1;
+	
+	switch (command)
+	{
+		case COMMAND_SET_OUTPUT_MODE:
+		{
+			if (argc != 1 || !OutputMode_IsValid((output_mode_t)args[0])) break;
+			commandSettings->outputMode = (output_mode_t)args[0];
+			SendResponse(command, COMMAND_STATUS_OK);
+			return;
+		}
+		case COMMAND_SET_TRANSMIT_PERIOD:
+		{
+			if (argc != 2) break;
+			Scheduler_SetPeriod(commandSettings->scheduler, 0, ReadUInt16(args));
+			SendResponse(command, COMMAND_STATUS_OK);
+			return;
+		}
+		case COMMAND_SET_MPU6050_RATE:
+		{
+			if (argc != 1 || 0 == args[0]) break;
+			I2CAsync_Suspend();
+			SetMPU6050SampleRateDivider(args[0]);
+			I2CAsync_Resume();
+			SendResponse(command, COMMAND_STATUS_OK);
+			return;
+		}
+		case COMMAND_SET_HMC5883L_RATE:
+		{
+			if (argc != 1 || args[0] > HMC5883L_DO_75Hz) break;
+			I2CAsync_Suspend();
+			SetHMC5883LOutputRate((hmc5883l_do_t)args[0]);
+			I2CAsync_Resume();
+			commandSettings->hmc5883lPeriod = hmc5883l_get_period();
+			SendResponse(command, COMMAND_STATUS_OK);
+			return;
+		}
+		case COMMAND_SET_BAUD_RATE:
+		{
+			if (argc != 4) break;
+			
+			const uint32_t baudRate = ReadUInt32(args);
+			if (0 != Uart0_ValidateBaudRate(baudRate)) break;
+			
+			/* the response is sent at the old baud rate, the switch happens once it is out */
+			SendResponse(command, COMMAND_STATUS_OK);
+			Uart0_SetBaudRate(baudRate);
+			
+			/* the admissible stream rates follow the link capacity */
+			Scheduler_SetBaudRate(commandSettings->scheduler, baudRate);
+			return;
+		}
+		case COMMAND_SET_TX_POLICY:
+		{
+			if (argc != 1 || args[0] > RINGBUFFER_POLICY_DROP_OLDEST) break;
+			RingBuffer_SetPolicy(commandTransmitFifo, (buffer_policy_t)args[0]);
+			SendResponse(command, COMMAND_STATUS_OK);
+			return;
+		}
+		case COMMAND_SET_FRAMING:
+		{
+			if (argc != 1 || args[0] > IO_FRAMING_COBS) break;
+			
+			/* the response is sent using the old framing; commands are always P2PPE framed */
+			SendResponse(command, COMMAND_STATUS_OK);
+			IO_SetFraming((io_framing_t)args[0]);
+			return;
+		}
+		case COMMAND_SET_STREAM_PERIOD:
+		{
+			if (argc != 3) break;
+			if (0 != Scheduler_SetPeriod(commandSettings->scheduler, args[0], ReadUInt16(&args[1]))) break;
+			SendResponse(command, COMMAND_STATUS_OK);
+			return;
+		}
+		case COMMAND_SET_ACCEL_DECIMATION:
+		{
+			if (argc != 1 || 0 == args[0]) break;
+			commandSettings->accelerometerDecimation = args[0];
+			SendResponse(command, COMMAND_STATUS_OK);
+			return;
+		}
+		case COMMAND_STORE_PARAMETERS:
+		{
+			if (argc != 0) break;
+
+			/* persist the HMC5883L calibration including the online corrections */
+			const calibration_matrix_t *const calibration = sensor_prepare_hmc5883l_calibration();
+			for (uint_fast8_t row = 0; row < 3; ++row)
+			{
+				for (uint_fast8_t column = 0; column < 4; ++column)
+				{
+					parameters.calibration.hmc5883l[row][column] = (*calibration)[row][column];
+				}
+			}
+
+			/* interrupts are masked during the erase; a concurrently received byte may be lost */
+			SendResponse(command, (0 == Parameters_Store()) ? COMMAND_STATUS_OK : COMMAND_STATUS_FAILED);
+			return;
+		}
+		case COMMAND_ERASE_PARAMETERS:
+		{
+			if (argc != 0) break;
+			SendResponse(command, (0 == Parameters_Erase()) ? COMMAND_STATUS_OK : COMMAND_STATUS_FAILED);
+			return;
+		}
+		case COMMAND_PING:
+		{
+			if (argc != 4) break;
+			SendPingResponse(ReadUInt32(args));
+			return;
+		}
+		default:
+		{
+			SendResponse(command, COMMAND_STATUS_UNKNOWN);
+			return;
+		}
+	}
+	
+	SendResponse(command, COMMAND_STATUS_INVALID);
+}
+
+/**
+ * @brief Feeds a received byte into the command channel, executing complete commands
+ * @param[in] byte The received byte
+ */
+void Command_Process(uint8_t byte)
+{
+	assert_not_null(commandSettings);
+	
+	const uint8_t length = P2PPE_Decode(&decoder, byte);
+	if (0 == length) return;
+	
+	Execute(decoder.data, length);
+}
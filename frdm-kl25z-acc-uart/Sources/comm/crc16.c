@@ -0,0 +1,38 @@
+/*
+ * crc16.c
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include "comm/crc16.h"
+
+/**
+ * @brief Nibble lookup table for polynomial 0x1021
+ * 
+ * A 16 entry table trades a second lookup per byte for 480 bytes of flash
+ * compared to the full 256 entry table.
+ */
+static const uint16_t crc16_nibble_table[16] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/**
+ * @brief Updates a CRC-16 with the given data
+ * @param[in] crc The current CRC value; {@see CRC16_INITIAL_VALUE} for a new calculation
+ * @param[in] data The data
+ * @param[in] dataCount The number of data bytes
+ * @return The updated CRC value
+ */
+uint16_t CRC16_Update(register uint16_t crc, register const uint8_t *const data, register uint32_t dataCount)
+{
+	for (uint32_t i=0; i<dataCount; ++i)
+	{
+		register uint8_t byte = data[i];
+		crc = (crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (byte >> 4)];
+		crc = (crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (byte & 0x0F)];
+	}
+	
+	return crc;
+}
@@ -12,10 +12,14 @@
 
 #include "nice_names.h"
 #include "comm/io.h"
+#include "comm/p2pprotocol.h"
+#include "cpu/profile.h"
 
 extern buffer_t* uartReadFifo; /*< the read buffer, initialized by Uart0_InitializeIrq() */
 extern buffer_t* uartWriteFifo; /*< the write buffer, initialized by Uart0_InitializeIrq() */
 
+static io_framing_t framing = IO_FRAMING_ESCAPE; /*< the framing used for outgoing frames */
+
 /*
  * TODO: Add variants with defined endianness by reading the AIRCR.ENDIANNESS bit.
  */
@@ -61,52 +65,6 @@ void IO_SendInt16(int16_t value)
 	Uart0_EnableTransmitIrq();
 }
 
-/**
- * @brief Sends a 16bit value as string
- * @param[in] value The value to send
- * 
- * Must only be used after initialization of Uart0 interrupt.
- */
-void IO_SendSInt16AsString(int16_t value)
-{
-	/* if value is negative, print sign and invert */
-	if (value < 0) 
-	{
-		IO_SendByteUncommited('-');
-		value = -value;
-	}
-	
-	/* send as unsigned */
-	IO_SendUInt16AsString((uint16_t)value);
-}
-
-/**
- * @brief Sends a 16bit value as string
- * @param[in] value The value to send
- * 
- * Must only be used after initialization of Uart0 interrupt.
- */
-void IO_SendUInt16AsString(uint16_t value)
-{
-	char buf[5]; /* 5 digits */
-	char *p = &buf[0];
-	int8_t digits = 0;
-	
-	/* divide value by 10 until value is 0 */
-	do 
-	{
-		int16_t remainder = value % 10;
-		*p++ = (remainder < 10) ? (remainder + '0') : (remainder + 'a' - 10);
-		++digits;
-	} while (value /= 10);
-	
-	/* dump buffer */
-	do
-	{
-		IO_SendByte(*--p);
-	} while (--digits > 0);
-}
-
 /**
  * @brief Sends a 32bit value in native endianness
  * @param[in] value The value to send
@@ -184,6 +142,54 @@ void IO_SendBuffer(const uint8_t *const string, uint8_t length)
 	Uart0_EnableTransmitIrq();
 }
 
+/**
+ * @brief Selects the framing used for outgoing frames
+ * @param[in] value The framing
+ */
+void IO_SetFraming(io_framing_t value)
+{
+	framing = value;
+}
+
+/**
+ * @brief Sends a frame with a prefix using the selected framing
+ * @param[in] prefix The prefix data to send
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to send
+ * @param[in] dataCount The number of data bytes
+ * 
+ * The frame is encoded directly into the transmit buffer and published at once,
+ * subject to the transmit buffer's full buffer policy. Frames that do not fit
+ * into the transmit buffer at all are sent byte-wise (blocking) instead.
+ */
+void IO_SendFramePrefixed(const uint8_t *const prefix, uint8_t prefixCount, const uint8_t *const data, uint8_t dataCount)
+{
+	/* the blocking fallback is not profiled, since it waits for the transmitter */
+	PROFILE_BEGIN(PROFILE_FRAME_ENCODE);
+	if (IO_FRAMING_COBS == framing)
+	{
+		const uint8_t result = P2PPE_CobsTransmissionPrefixedToBuffer(prefix, prefixCount, data, dataCount, uartWriteFifo);
+		if (P2PPE_BUFFER_TOO_SMALL == result)
+		{
+			P2PPE_CobsTransmissionPrefixed(prefix, prefixCount, data, dataCount, IO_SendByte);
+			return;
+		}
+	}
+	else
+	{
+		const uint8_t result = P2PPE_TransmissionPrefixedToBuffer(prefix, prefixCount, data, dataCount, uartWriteFifo);
+		if (P2PPE_BUFFER_TOO_SMALL == result)
+		{
+			P2PPE_TransmissionPrefixed(prefix, prefixCount, data, dataCount, IO_SendByte);
+			return;
+		}
+	}
+	PROFILE_END(PROFILE_FRAME_ENCODE);
+	
+	/* enable transmit IRQ */
+	Uart0_EnableTransmitIrq();
+}
+
 /**
  * @brief Flushes the IO.
  */
@@ -259,109 +265,3 @@ uint32_t IO_ReadInt32()
 	value = value << 8 | RingBuffer_Read(uartReadFifo);
 	return value;
 }
-
-/**
- * @brief Sends a signed number in 2.12 format (signed 1.12)
- * @param[in] input The value to send
- * 
- * Must only be used after initialisation of Uart0 interrupt.
- */
-void IO_Send2p14AsString(register int16_t input)
-{
-	/* Basic idea
-	 * ----------
-	 * To convert a number in m.n fixed-point format to 
-	 * floating point, it is cast to floating point and 
-	 * then scaled by 2^-n.
-	 * 
-	 * Problem
-	 * -------
-	 * 4096*2^-12 = 1.0	 		<--> 4096 >> 12 = 1
-	 * 4095*2^-12 = 0.999755	<--> 4095 >> 12 = 0 ! missing digits
-	 * 
-	 * Solution
-	 * --------
-	 * If we first scale the number by powers of 10 (shifting
-	 * in the decimal places from the right) and then shift right
-	 * by 12 bits ... 
-	 * 
-	 * 4095*10000 >> 12  = 09997
-	 * 
-	 * we get to the right digit. If we now subtract the result
-	 * of the previous scale, we get the digit alone:
-	 * 
-	 * (4095*10000) >> 12 - (4095*1000 >> 12) = 7
-	 * 
-	 * Unfortunately, for later decimal places these calculations
-	 * exceed 16 bit number range easily, so we will cast to
-	 * unsigned 32 bit integer first.
-	 * 
-	 * Note
-	 * ----
-	 * Since even the fourth decimal place can not be represented 
-	 * correctly anymore, only six decimal places will be rendered. 
-	 */
-	
-#define Q2p12_M  2
-#define Q2p12_N 12	
-
-	register uint8_t digit;
-	
-	register uint32_t input_value = input;
-	register uint32_t current_value = input;
-	register uint32_t last_value = 0;
-	
-	if (input < 0) 
-	{
-		IO_SendByteUncommited('-');
-		input_value = -input_value;
-	}
-	else 
-	{
-		IO_SendByteUncommited(' ');
-	}
-	
-	/* proceed with the absolute value in 1.12 format 
-	 * and determine real part. 
-	 */
-	current_value = (input_value) >> Q2p12_N;
-	digit = current_value;
-	last_value = current_value;
-	
-	IO_SendByte(digit + '0');
-	IO_SendByte('.');
-	
-	/* now determine the remaining digits */
-	current_value = (input_value*10) >> Q2p12_N;
-	digit = current_value - last_value*10;
-	last_value = current_value;
-	IO_SendByte(digit + '0');
-	
-	current_value = (input_value*100) >> Q2p12_N;
-	digit = current_value - last_value*10;
-	last_value = current_value;
-	IO_SendByte(digit + '0');
-	
-	current_value = (input_value*1000) >> Q2p12_N;
-	digit = current_value - last_value*10;
-	last_value = current_value;
-	IO_SendByte(digit + '0');
-	
-	current_value = (input_value*10000) >> Q2p12_N;
-	digit = current_value - last_value*10;
-	last_value = current_value;
-	IO_SendByte(digit + '0');
-	
-	current_value = (input_value*100000) >> Q2p12_N;
-	digit = current_value - last_value*10;
-	last_value = current_value;
-	IO_SendByte(digit + '0');
-	
-	current_value = (input_value*1000000) >> Q2p12_N;
-	digit = current_value - last_value*10;
-	last_value = current_value;
-	IO_SendByte(digit + '0');
-
-#undef Q2p12_M
-#undef Q2p12_N
-}
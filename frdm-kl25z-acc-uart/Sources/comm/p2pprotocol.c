@@ -21,7 +21,7 @@ static const uint8_t default_preamble[DEFAULT_PREAMBLE_LENGTH] = {0xDA, 0x7A};
 #define SOH	0x01 /*< start of header */
 #define STX 0x02 /*< start of text */ 
 #define ETX 0x03 /*< end of text */
-#define EOT 0x04 /*< end of transmission */
+#define EOT P2PPE_END_OF_FRAME /*< end of transmission */
 #define ESC 0x1B /*< escape */
 #define ESC_XOR	0x42 /*< value to escape the data bytes with */
 
@@ -104,3 +104,301 @@ void P2PPE_TransmissionPrefixed(register const uint8_t*const prefix, register ui
 #endif
 	sendHandler(EOT);
 }
+
+/**
+ * @brief Determines if a byte needs to be escaped
+ * @param[in] byte The byte to test
+ * @return nonzero if the byte must be escaped
+ */
+static inline uint8_t requiresEscape(register uint8_t byte)
+{
+	return (EOT == byte) || (ESC == byte);
+}
+
+/**
+ * @brief Counts the bytes that need to be escaped
+ * @param[in] data The data to test
+ * @param[in] dataCount The number of data bytes
+ * @return The number of bytes to escape
+ */
+static inline uint8_t countEscapes(register const uint8_t*const data, register uint8_t dataCount)
+{
+	register uint8_t escapes = 0;
+	for (int i=0; i<dataCount; ++i)
+	{
+		escapes += requiresEscape(data[i]);
+	}
+	return escapes;
+}
+
+/**
+ * @brief Encodes a byte into a reserved buffer span
+ * @param[in] byte The byte to encode
+ * @param[in] buffer The ring buffer
+ * @param[in] index The (free running) write index
+ * @return The updated write index
+ */
+static inline uint32_t encodeAndPut(register uint8_t byte, buffer_t *const buffer, register uint32_t index)
+{
+	if (requiresEscape(byte))
+	{
+		RingBuffer_Put(buffer, index++, ESC);
+		byte ^= ESC_XOR;
+	}
+	
+	RingBuffer_Put(buffer, index++, byte);
+	return index;
+}
+
+/**
+ * @brief Encodes a P2PPE Transmission with a prefix directly into a ring buffer
+ * @param[in] prefix The prefix data to send
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to send
+ * @param[in] dataCount The number of data bytes
+ * @param[in] buffer The ring buffer to encode into
+ * @return {@see P2PPE_BUFFER_OK} on success, {@see P2PPE_BUFFER_TOO_SMALL} or {@see P2PPE_BUFFER_DROPPED} otherwise
+ */
+uint8_t P2PPE_TransmissionPrefixedToBuffer(register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount, buffer_t *const buffer)
+{
+	/* determine the exact encoded length: preamble, SOH, length, escaped payload, EOT */
+	const uint32_t escapes = countEscapes(prefix, prefixCount) + countEscapes(data, dataCount);
+	const uint32_t length = DEFAULT_PREAMBLE_LENGTH + 2 + prefixCount + dataCount + escapes + 1;
+	if (length > buffer->size) return P2PPE_BUFFER_TOO_SMALL;
+	
+	uint32_t index;
+	if (0 != RingBuffer_Reserve(buffer, length, &index)) return P2PPE_BUFFER_DROPPED;
+	
+	/* preamble and header */
+	for (int i=0; i<DEFAULT_PREAMBLE_LENGTH; ++i)
+	{
+		RingBuffer_Put(buffer, index++, default_preamble[i]);
+	}
+	RingBuffer_Put(buffer, index++, SOH);
+	RingBuffer_Put(buffer, index++, dataCount + prefixCount);
+	
+	/* prefix and data */
+	for (int i=0; i<prefixCount; ++i)
+	{
+		index = encodeAndPut(prefix[i], buffer, index);
+	}
+	for (int i=0; i<dataCount; ++i)
+	{
+		index = encodeAndPut(data[i], buffer, index);
+	}
+	
+	RingBuffer_Put(buffer, index++, EOT);
+	
+	/* publish the frame at once */
+	RingBuffer_Commit(buffer, index);
+	return P2PPE_BUFFER_OK;
+}
+
+#define P2PPE_DECODER_AWAIT_PREAMBLE	(0) /*< waiting for the preamble */
+#define P2PPE_DECODER_AWAIT_SOH			(1) /*< preamble received, waiting for SOH */
+#define P2PPE_DECODER_AWAIT_LENGTH		(2) /*< SOH received, waiting for the length */
+#define P2PPE_DECODER_READ_DATA			(3) /*< reading payload bytes */
+#define P2PPE_DECODER_AWAIT_EOT			(4) /*< payload complete, waiting for EOT */
+
+/**
+ * @brief Resets a P2PPE decoder
+ * @param[in] decoder The decoder instance
+ */
+void P2PPE_DecoderInit(p2ppe_decoder_t *const decoder)
+{
+	decoder->state = P2PPE_DECODER_AWAIT_PREAMBLE;
+	decoder->lastByte = 0;
+	decoder->escape = 0;
+	decoder->length = 0;
+	decoder->count = 0;
+}
+
+/**
+ * @brief Feeds a byte into a P2PPE decoder
+ * @param[in] decoder The decoder instance
+ * @param[in] byte The received byte
+ * @return The payload length if a frame was completed with this byte, zero otherwise
+ */
+uint8_t P2PPE_Decode(p2ppe_decoder_t *const decoder, register uint8_t byte)
+{
+	switch (decoder->state)
+	{
+		case P2PPE_DECODER_AWAIT_PREAMBLE:
+		{
+			if (default_preamble[0] == decoder->lastByte && default_preamble[1] == byte)
+			{
+				decoder->state = P2PPE_DECODER_AWAIT_SOH;
+			}
+			decoder->lastByte = byte;
+			break;
+		}
+		case P2PPE_DECODER_AWAIT_SOH:
+		{
+			decoder->state = (SOH == byte) ? P2PPE_DECODER_AWAIT_LENGTH : P2PPE_DECODER_AWAIT_PREAMBLE;
+			decoder->lastByte = 0;
+			break;
+		}
+		case P2PPE_DECODER_AWAIT_LENGTH:
+		{
+			if (0 == byte || byte > P2PPE_DECODER_MAX_LENGTH)
+			{
+				decoder->state = P2PPE_DECODER_AWAIT_PREAMBLE;
+				break;
+			}
+			
+			decoder->length = byte;
+			decoder->count = 0;
+			decoder->escape = 0;
+			decoder->state = P2PPE_DECODER_READ_DATA;
+			break;
+		}
+		case P2PPE_DECODER_READ_DATA:
+		{
+			if (ESC == byte)
+			{
+				decoder->escape = 1;
+				break;
+			}
+			
+			/* an unescaped EOT within the payload means a byte was lost */
+			if (EOT == byte)
+			{
+				decoder->state = P2PPE_DECODER_AWAIT_PREAMBLE;
+				break;
+			}
+			
+			if (decoder->escape)
+			{
+				byte ^= ESC_XOR;
+				decoder->escape = 0;
+			}
+			
+			decoder->data[decoder->count++] = byte;
+			if (decoder->count == decoder->length)
+			{
+				decoder->state = P2PPE_DECODER_AWAIT_EOT;
+			}
+			break;
+		}
+		case P2PPE_DECODER_AWAIT_EOT:
+		{
+			decoder->state = P2PPE_DECODER_AWAIT_PREAMBLE;
+			if (EOT == byte)
+			{
+				return decoder->length;
+			}
+			break;
+		}
+		default:
+		{
+			P2PPE_DecoderInit(decoder);
+			break;
+		}
+	}
+	
+	return 0;
+}
+
+/**
+ * @brief Gets a byte of the concatenation of prefix and data
+ * @param[in] prefix The prefix data
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data
+ * @param[in] index The index into the concatenated payload
+ * @return The byte
+ */
+static inline uint8_t payloadAt(register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint32_t index)
+{
+	return (index < prefixCount) ? prefix[index] : data[index - prefixCount];
+}
+
+/**
+ * @brief Determines the length of the next COBS block
+ * @param[in] prefix The prefix data
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data
+ * @param[in] start The index of the first byte in the block
+ * @param[in] count The total payload length
+ * @return The number of non-zero bytes in the block (0..254)
+ */
+static inline uint32_t cobsBlockLength(register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint32_t start, register uint32_t count)
+{
+	register uint32_t length = 0;
+	while ((start + length) < count && length < 254 && 0 != payloadAt(prefix, prefixCount, data, start + length))
+	{
+		++length;
+	}
+	return length;
+}
+
+/**
+ * @brief Begins a COBS framed transmission with a prefix
+ * @param[in] prefix The prefix data to send
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to send
+ * @param[in] dataCount The number of data bytes
+ * @param[in] sendHandler The actual send function
+ */
+void P2PPE_CobsTransmissionPrefixed(register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount, register void (*sendHandler)(uint8_t dataByte))
+{
+	const uint32_t count = prefixCount + dataCount;
+	register uint32_t index = 0;
+	
+	for (;;)
+	{
+		/* each block is introduced by its length plus one */
+		const uint32_t length = cobsBlockLength(prefix, prefixCount, data, index, count);
+		sendHandler((uint8_t)(length + 1));
+		
+		for (uint32_t i=0; i<length; ++i)
+		{
+			sendHandler(payloadAt(prefix, prefixCount, data, index++));
+		}
+		
+		/* the end of the payload acts as an implicit zero; a full block has no zero to skip */
+		if (index >= count) break;
+		if (length < 254) ++index;
+	}
+	
+	sendHandler(0x00);
+}
+
+/**
+ * @brief Encodes a COBS framed transmission with a prefix directly into a ring buffer
+ * @param[in] prefix The prefix data to send
+ * @param[in] prefixCount The number of prefix data bytes
+ * @param[in] data The data to send
+ * @param[in] dataCount The number of data bytes
+ * @param[in] buffer The ring buffer to encode into
+ * @return {@see P2PPE_BUFFER_OK} on success, {@see P2PPE_BUFFER_TOO_SMALL} or {@see P2PPE_BUFFER_DROPPED} otherwise
+ */
+uint8_t P2PPE_CobsTransmissionPrefixedToBuffer(register const uint8_t*const prefix, register uint8_t prefixCount, register const uint8_t*const data, register uint8_t dataCount, buffer_t *const buffer)
+{
+	const uint32_t count = prefixCount + dataCount;
+	const uint32_t maximum = P2PPE_COBS_MAX_LENGTH(count);
+	if (maximum > buffer->size) return P2PPE_BUFFER_TOO_SMALL;
+	
+	uint32_t target;
+	if (0 != RingBuffer_Reserve(buffer, maximum, &target)) return P2PPE_BUFFER_DROPPED;
+	
+	register uint32_t index = 0;
+	for (;;)
+	{
+		const uint32_t length = cobsBlockLength(prefix, prefixCount, data, index, count);
+		RingBuffer_Put(buffer, target++, (uint8_t)(length + 1));
+		
+		for (uint32_t i=0; i<length; ++i)
+		{
+			RingBuffer_Put(buffer, target++, payloadAt(prefix, prefixCount, data, index++));
+		}
+		
+		if (index >= count) break;
+		if (length < 254) ++index;
+	}
+	
+	RingBuffer_Put(buffer, target++, 0x00);
+	
+	/* publish the frame at once */
+	RingBuffer_Commit(buffer, target);
+	return P2PPE_BUFFER_OK;
+}
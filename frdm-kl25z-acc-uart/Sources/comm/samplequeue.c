@@ -0,0 +1,33 @@
+/*
+ * samplequeue.c
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include "comm/samplequeue.h"
+
+/**
+ * @brief Initializes a queue
+ * @param[in] queue The queue instance
+ * @param[in] data The slot storage of at least length*slotSize bytes
+ * @param[in] slotSize The size of a slot in bytes
+ * @param[in] length The number of slots; Must be a power of two of at most {@see SAMPLEQUEUE_MAX_LENGTH}
+ * @return Zero on success, nonzero if the configuration is invalid
+ */
+uint8_t SampleQueue_Init(sample_queue_t *const queue, void *const data, const uint16_t slotSize, const uint8_t length)
+{
+	if (0 == length || length > SAMPLEQUEUE_MAX_LENGTH || 0 != (length & (length - 1))) return 1;
+	if (0 == slotSize || 0 == data) return 1;
+
+	queue->data = (uint8_t*)data;
+	queue->slotSize = slotSize;
+	queue->mask = length - 1;
+	queue->writeIndex = 0;
+	queue->readIndex = 0;
+	queue->overflows = 0;
+	queue->nextSequence = 0;
+	queue->expectedSequence = 0;
+	queue->losses = 0;
+	return 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * scheduler.c
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include "nice_names.h"
+#include "comm/scheduler.h"
+
+/**
+ * @brief The number of bits on the wire per byte (8N1)
+ */
+#define SCHEDULER_BITS_PER_BYTE	(10)
+
+/**
+ * @brief Compares the importance of two streams
+ * @param[in] streams The streams
+ * @param[in] a The index of the first stream
+ * @param[in] b The index of the second stream
+ * @return Nonzero if stream a is more important than stream b; ties are broken by index
+ */
+static inline uint8_t MoreImportant(const output_stream_t *const streams, uint8_t a, uint8_t b)
+{
+	return (streams[a].priority < streams[b].priority)
+		|| ((streams[a].priority == streams[b].priority) && (a < b));
+}
+
+/**
+ * @brief Initializes the scheduler
+ * @param[in] scheduler The scheduler instance
+ * @param[in] streams The stream configurations, set up with period, priority and budget
+ * @param[in] count The number of streams
+ * @param[in] transmitFifo The transmit buffer used to detect link saturation
+ * @param[in] baudRate The link baud rate
+ */
+void Scheduler_Init(output_scheduler_t *const scheduler, output_stream_t *const streams, uint8_t count, const buffer_t *const transmitFifo, uint32_t baudRate)
+{
+	scheduler->streams = streams;
+	scheduler->count = count;
+	scheduler->transmitFifo = transmitFifo;
+	assert(count <= SCHEDULER_MAX_STREAMS);
+	
+	for (uint8_t i = 0; i < count; ++i)
+	{
+		streams[i].lastTime = 0;
+		streams[i].skipped = 0;
+	}
+	
+	Scheduler_SetBaudRate(scheduler, baudRate);
+}
+
+/**
+ * @brief Calculates the admissible stream periods
+ * @param[in] scheduler The scheduler instance
+ */
+void Scheduler_Admit(output_scheduler_t *const scheduler)
+{
+	output_stream_t *const streams = scheduler->streams;
+	const uint8_t count = scheduler->count;
+	
+	uint32_t remaining = scheduler->capacity;
+	uint16_t reserve = 0;
+	uint32_t admitted = 0;
+	
+	/* selection by priority; there are only a handful of streams */
+	for (uint8_t round = 0; round < count; ++round)
+	{
+		uint8_t next = SCHEDULER_MAX_STREAMS;
+		for (uint8_t i = 0; i < count; ++i)
+		{
+			if (admitted & (1u << i)) continue;
+			if (SCHEDULER_MAX_STREAMS == next || MoreImportant(streams, i, next)) next = i;
+		}
+		admitted |= 1u << next;
+		
+		output_stream_t *const stream = &streams[next];
+		stream->reserve = reserve;
+		stream->admittedPeriod = 0;
+		if (0 == stream->period || 0 == remaining) continue;
+		
+		const uint32_t load = ((uint32_t)stream->budget * 1000 + stream->period - 1) / stream->period;
+		if (load <= remaining)
+		{
+			stream->admittedPeriod = stream->period;
+			remaining -= load;
+		}
+		else
+		{
+			/* stretch the period to the remaining capacity, leaving nothing for less important streams */
+			const uint32_t period = ((uint32_t)stream->budget * 1000 + remaining - 1) / remaining;
+			remaining = 0;
+			
+			/* a shed stream still ends the admission, so its leftover capacity does not go to less important streams */
+			if (period > SCHEDULER_MAX_PERIOD) continue;
+			
+			stream->admittedPeriod = (uint16_t)period;
+		}
+		
+		reserve += stream->budget;
+	}
+}
+
+/**
+ * @brief Changes the link baud rate and recalculates the admissible periods
+ * @param[in] scheduler The scheduler instance
+ * @param[in] baudRate The link baud rate
+ */
+void Scheduler_SetBaudRate(output_scheduler_t *const scheduler, uint32_t baudRate)
+{
+	scheduler->capacity = (baudRate / SCHEDULER_BITS_PER_BYTE) * SCHEDULER_LINK_UTILIZATION / 100;
+	Scheduler_Admit(scheduler);
+}
+
+/**
+ * @brief Changes a stream's period and recalculates the admissible periods
+ * @param[in] scheduler The scheduler instance
+ * @param[in] stream The stream index
+ * @param[in] period The requested period in milliseconds; zero disables the stream
+ * @return Zero on success, nonzero if the stream does not exist
+ */
+uint8_t Scheduler_SetPeriod(output_scheduler_t *const scheduler, uint8_t stream, uint16_t period)
+{
+	if (stream >= scheduler->count) return 1;
+	
+	scheduler->streams[stream].period = period;
+	Scheduler_Admit(scheduler);
+	return 0;
+}
+
+/**
+ * @brief Changes a stream's byte budget and recalculates the admissible periods
+ * @param[in] scheduler The scheduler instance
+ * @param[in] stream The stream index
+ * @param[in] budget The worst case number of bytes on the wire per transmission
+ * @return Zero on success, nonzero if the stream does not exist
+ */
+uint8_t Scheduler_SetBudget(output_scheduler_t *const scheduler, uint8_t stream, uint16_t budget)
+{
+	if (stream >= scheduler->count) return 1;
+	if (scheduler->streams[stream].budget == budget) return 0;
+	
+	scheduler->streams[stream].budget = budget;
+	Scheduler_Admit(scheduler);
+	return 0;
+}
+
+/**
+ * @brief Determines if a stream is due for transmission
+ * @param[in] scheduler The scheduler instance
+ * @param[in] stream The stream index
+ * @param[in] time The current system time in milliseconds
+ * @return Nonzero if the stream should be sent now
+ */
+uint8_t Scheduler_Due(output_scheduler_t *const scheduler, uint8_t stream, uint32_t time)
+{
+	output_stream_t *const entry = &scheduler->streams[stream];
+	if (0 == entry->admittedPeriod) return 0;
+	if ((time - entry->lastTime) < entry->admittedPeriod) return 0;
+	
+	/* the period is consumed either way, so a saturated link sheds instead of queueing */
+	entry->lastTime = time;
+	if (RingBuffer_Free(scheduler->transmitFifo) < (uint32_t)entry->budget + entry->reserve)
+	{
+		++entry->skipped;
+		return 0;
+	}
+	
+	return 1;
+}
+
+/**
+ * @brief Determines the time until the next stream is due
+ * @param[in] scheduler The scheduler instance
+ * @param[in] time The current system time in milliseconds
+ * @return The time in milliseconds, zero if a stream is due now, or {@see SCHEDULER_MAX_PERIOD} if no stream is admitted
+ */
+uint32_t Scheduler_NextDue(const output_scheduler_t *const scheduler, uint32_t time)
+{
+	uint32_t next = SCHEDULER_MAX_PERIOD;
+	for (uint8_t i = 0; i < scheduler->count; ++i)
+	{
+		const output_stream_t *const entry = &scheduler->streams[i];
+		if (0 == entry->admittedPeriod) continue;
+		
+		const uint32_t elapsed = time - entry->lastTime;
+		if (elapsed >= entry->admittedPeriod) return 0;
+		if (entry->admittedPeriod - elapsed < next) next = entry->admittedPeriod - elapsed;
+	}
+	return next;
+}
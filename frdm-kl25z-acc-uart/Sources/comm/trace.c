@@ -0,0 +1,27 @@
+/*
+ * trace.c
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include "comm/io.h"
+#include "comm/trace.h"
+
+#if TRACE_ENABLED
+
+/**
+ * @brief Sends a trace message
+ * @param[in] id The message
+ * @param[in] args The arguments
+ * @param[in] argCount The number of arguments
+ *
+ * The arguments go out in native (little) endianness, as every other frame.
+ */
+void Trace_Send(const trace_id_t id, const int32_t *const args, const uint8_t argCount)
+{
+	const uint8_t prefix[2] = { TRACE_FRAME_TYPE, (uint8_t)id };
+	IO_SendFramePrefixed(prefix, sizeof(prefix), (const uint8_t*)args, argCount * sizeof(int32_t));
+}
+
+#endif
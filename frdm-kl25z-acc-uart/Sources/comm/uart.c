@@ -26,9 +26,14 @@
 
 #include "ARMCM0plus.h"
 #include "derivative.h" /* include peripheral declarations */
-#include "bme.h"
 
+#include "cpu/clock.h"
+#include "cpu/irq.h"
+#include "cpu/profile.h"
+#include "cpu/ramfunc.h"
+#include "cpu/systick.h"
 #include "comm/buffer.h"
+#include "comm/p2pprotocol.h"
 #include "comm/uart.h"
 
 #include "nice_names.h"
@@ -36,6 +41,12 @@
 buffer_t* uartReadFifo = 0; /*< the read buffer, initialized by Uart0_InitializeIrq() */
 buffer_t* uartWriteFifo = 0; /*< the write buffer, initialized by Uart0_InitializeIrq() */
 
+static volatile uint32_t uartFrameEndTime = 0; /*< the receive time of the last P2PPE frame end in microseconds */
+
+#if UART_USE_DMA_TX
+static volatile uint32_t uartDmaSpan = 0; /*< number of bytes currently in flight; 0 if the DMA channel is idle */
+#endif
+
 /*
  * @brief Sets up the UART0 for 115.2 kbaud on PTA1/RX, PTA2/TX using PLL/2 clocking.
  */
@@ -153,6 +164,201 @@ void InitUart0()
 	UART0->C2 |= UART0_C2_TE_MASK | UART0_C2_RE_MASK;
 }
 
+#if UART_USE_DMA_TX
+
+/**
+ * @brief Configures the DMA channel and DMAMUX routing for UART0 transmission
+ */
+static void InitUart0TransmitDma()
+{
+	/* enable clock gating to DMAMUX and DMA */
+	BitFlag_Set32(&SIM->SCGC6, SIM_SCGC6_DMAMUX_MASK);
+	BitFlag_Set32(&SIM->SCGC7, SIM_SCGC7_DMA_MASK);
+	
+	/* disable the channel while configuring */
+	DMAMUX0->CHCFG[UART0_TX_DMA_CHANNEL] = 0;
+	
+	/* clear any pending status and halt the channel */
+	DMA0->DMA[UART0_TX_DMA_CHANNEL].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+	DMA0->DMA[UART0_TX_DMA_CHANNEL].DCR = 0;
+	
+	/* the destination is fixed to the UART data register */
+	DMA0->DMA[UART0_TX_DMA_CHANNEL].DAR = (uint32_t)&UART0->D;
+	
+	/* route the UART0 transmit request to the channel */
+	DMAMUX0->CHCFG[UART0_TX_DMA_CHANNEL] = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(UART0_TX_DMA_SOURCE);
+	
+	/* let the UART raise DMA requests on TDRE; these are only served while ERQ is set */
+	BitFlag_Set8(&UART0->C5, UART0_C5_TDMAE_MASK);
+	
+	uartDmaSpan = 0;
+	
+	/* prepare interrupts for the DMA channel */
+	Irq_Enable((IRQn_Type)UART0_TX_DMA_IRQ, IRQ_SOURCE_UART_DMA);
+}
+
+/**
+ * @brief Starts a DMA transfer of the next contiguous span of the write FIFO.
+ * 
+ * Must only be called from {@see DMA0_Handler} while no transfer is in flight.
+ */
+static inline void StartTransmitSpan()
+{
+	/* only transfer up to the end of the ring; the remainder is sent by the next span */
+	uint32_t offset;
+	const uint32_t span = RingBuffer_ClaimSpan(uartWriteFifo, &offset);
+	if (0 == span) return;
+	
+	uartDmaSpan = span;
+	
+	DMA0->DMA[UART0_TX_DMA_CHANNEL].SAR = (uint32_t)&uartWriteFifo->data[offset];
+	DMA0->DMA[UART0_TX_DMA_CHANNEL].DSR_BCR = DMA_DSR_BCR_BCR(span);
+	
+	/* 8 bit to 8 bit, incrementing source, cycle steal, stop and interrupt when the byte count is exhausted */
+	DMA0->DMA[UART0_TX_DMA_CHANNEL].DCR = DMA_DCR_EINT_MASK
+										| DMA_DCR_ERQ_MASK
+										| DMA_DCR_CS_MASK
+										| DMA_DCR_SINC_MASK
+										| DMA_DCR_SSIZE(0b01)
+										| DMA_DCR_DSIZE(0b01)
+										| DMA_DCR_D_REQ_MASK;
+}
+
+/**
+ * @brief Starts a DMA transfer of the pending write FIFO contents if no transfer is in flight
+ * 
+ * Pends the DMA channel interrupt instead of masking interrupts, so that the span is
+ * only ever claimed from {@see DMA0_Handler}.
+ */
+void Uart0_StartTransmitDma()
+{
+	/* the running transfer will pick up the new data when it completes */
+	if (0 != uartDmaSpan) return;
+	
+	Irq_SetPending(UART0_TX_DMA_IRQ);
+}
+
+/**
+ * @brief IRQ handler for the UART0 TX DMA channel
+ * 
+ * Entered on the completion of a span or pended by {@see Uart0_StartTransmitDma}.
+ */
+void DMA0_Handler()
+{
+	IRQ_PROFILE_ENTER();
+
+	if (DMA0->DMA[UART0_TX_DMA_CHANNEL].DSR_BCR & DMA_DSR_BCR_DONE_MASK)
+	{
+		/* clear the done flag (and any error flags) */
+		DMA0->DMA[UART0_TX_DMA_CHANNEL].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+		
+		/* release the transferred span to the producer */
+		RingBuffer_ReleaseSpan(uartWriteFifo);
+		uartDmaSpan = 0;
+	}
+	
+	/* continue with the wrapped part or anything written in the meantime */
+	if (0 == uartDmaSpan)
+	{
+		StartTransmitSpan();
+	}
+
+	IRQ_PROFILE_EXIT(IRQ_SOURCE_UART_DMA);
+}
+
+#endif
+
+/**
+ * @brief The UART0 module clock (PLL/2)
+ */
+#define UART0_CLOCK (CORE_CLOCK/2)
+
+/**
+ * @brief Determines the baud rate divider and oversampling ratio for a given baud rate
+ * @param[in] baudRate The requested baud rate
+ * @param[out] sbr The baud rate modulo divisor
+ * @param[out] osr The oversampling ratio, minus one, as written to UART0->C4
+ * @return Zero on success, nonzero if the baud rate can not be generated within 3% error
+ */
+static uint8_t CalculateBaudRate(const uint32_t baudRate, uint16_t *const sbr, uint8_t *const osr)
+{
+	uint32_t bestError = 0xFFFFFFFF;
+	
+	/* above the clock divided by the lowest ratio no divisor exists; this also keeps ratio * baudRate within 32 bit */
+	if (baudRate > UART0_CLOCK / 4) return 1;
+	
+	/* the oversampling ratio can be 4x..32x; prefer higher ratios for better noise immunity */
+	for (uint32_t ratio = 32; ratio >= 4; --ratio)
+	{
+		/* rounded divisor */
+		const uint32_t divisor = (UART0_CLOCK + (ratio * baudRate)/2) / (ratio * baudRate);
+		if (divisor < 1 || divisor > 0x1FFF) continue;
+		
+		const uint32_t actual = UART0_CLOCK / (ratio * divisor);
+		const uint32_t error = (actual > baudRate) ? (actual - baudRate) : (baudRate - actual);
+		if (error < bestError)
+		{
+			bestError = error;
+			*sbr = (uint16_t)divisor;
+			*osr = (uint8_t)(ratio - 1);
+		}
+	}
+	
+	return (bestError > (baudRate/100*3));
+}
+
+/**
+ * @brief Tests if a baud rate can be generated by UART0
+ * @param[in] baudRate The requested baud rate
+ * @return Zero if the baud rate can be generated within 3% error, nonzero otherwise
+ */
+uint8_t Uart0_ValidateBaudRate(uint32_t baudRate)
+{
+	uint16_t sbr;
+	uint8_t osr;
+	return (0 == baudRate) || (0 != CalculateBaudRate(baudRate, &sbr, &osr));
+}
+
+/**
+ * @brief Reconfigures the UART0 baud rate at runtime
+ * @param[in] baudRate The requested baud rate
+ * @return Zero on success, nonzero if the baud rate can not be generated within 3% error
+ * 
+ * Blocks until all pending data has been transmitted at the old baud rate.
+ */
+uint8_t Uart0_SetBaudRate(uint32_t baudRate)
+{
+	uint16_t sbr;
+	uint8_t osr;
+	if (0 == baudRate || 0 != CalculateBaudRate(baudRate, &sbr, &osr)) return 1;
+	
+	/* drain the software buffer and the shift register */
+	RingBuffer_BlockWhileNotEmpty(uartWriteFifo);
+	while (!(UART0->S1 & UART0_S1_TC_MASK)) {}
+	
+	/* disable rx and tx */
+	UART0->C2 &= ~UART0_C2_TE_MASK & ~UART0_C2_RE_MASK;
+	
+	UART0->BDH = (UART0->BDH & ~UART0_BDH_SBR_MASK) | UART0_BDH_SBR((sbr & 0x1F00) >> 8);
+	UART0->BDL = UART0_BDL_SBR(sbr & 0x00FF);
+	
+	UART0->C4 = (UART0->C4 & ~UART0_C4_OSR_MASK) | UART0_C4_OSR(osr);
+	
+	/* sampling on both edges is required for oversampling ratios between 4x and 7x */
+	if (osr >= 3 && osr <= 6)
+	{
+		UART0->C5 |= UART0_C5_BOTHEDGE_MASK;
+	}
+	else
+	{
+		UART0->C5 &= ~UART0_C5_BOTHEDGE_MASK;
+	}
+	
+	/* enable rx and tx */
+	UART0->C2 |= UART0_C2_TE_MASK | UART0_C2_RE_MASK;
+	return 0;
+}
+
 /**
  * @brief Initializes the interrupt for UART0
  */
@@ -166,9 +372,13 @@ void Uart0_InitializeIrq(buffer_t *restrict const receiveFifo, buffer_t *restric
 	Uart0_DisableReceiveIrq();
 	Uart0_DisableTransmitIrq();
 	
+#if UART_USE_DMA_TX
+	/* transmission is handled by the DMA controller */
+	InitUart0TransmitDma();
+#endif
+	
 	/* prepare interrupts for UART0 */
-	NVIC_ICPR |= 1 << UART0_IRQ;	/* clear pending flag */
-	NVIC_ISER |= 1 << UART0_IRQ;	/* enable interrupt */
+	Irq_Enable((IRQn_Type)UART0_IRQ, IRQ_SOURCE_UART);
 }
 
 /**
@@ -178,6 +388,21 @@ static inline void HandleReceiveInterrupt()
 {
     const uint8_t data = UART0->D;
 	RingBuffer_Write(uartReadFifo, data);
+
+	/* timestamp the frame end for the ping command; other frames are not affected */
+	if (P2PPE_END_OF_FRAME == data)
+	{
+		uartFrameEndTime = SysTick_Microseconds();
+	}
+}
+
+/**
+ * @brief Returns the time the last P2PPE frame end was received
+ * @return The time in microseconds, see {@see SysTick_Microseconds}
+ */
+uint32_t Uart0_FrameEndTime()
+{
+	return uartFrameEndTime;
 }
 
 /**
@@ -198,30 +423,94 @@ static inline void HandleTransmitInterrupt()
 	}
 }
 
+#if UART_PROFILE_IRQ
+
+volatile uart0_irq_profile_t uart0ReceiveIrqProfile = { 0, UINT32_MAX, 0, 0 };
+volatile uart0_irq_profile_t uart0TransmitIrqProfile = { 0, UINT32_MAX, 0, 0 };
+
+/**
+ * @brief Determines the core cycles elapsed since a SysTick counter value
+ * @param[in] start The SysTick counter value at the start of the measurement
+ * @return The number of cycles; Measurements must not span more than one SysTick period
+ */
+static inline uint32_t CyclesSince(const uint32_t start)
+{
+	const uint32_t now = SysTick_BASE_PTR->CVR;
+	
+	/* the SysTick counter counts down and reloads at zero */
+	return (start >= now) ? (start - now) : (start + SysTick_BASE_PTR->RVR + 1 - now);
+}
+
+/**
+ * @brief Accumulates a cycle count measurement
+ * @param[in] profile The profile to update
+ * @param[in] cycles The measured number of cycles
+ */
+static inline void ProfileIrq(volatile uart0_irq_profile_t *const profile, const uint32_t cycles)
+{
+	++profile->count;
+	profile->totalCycles += cycles;
+	if (cycles < profile->minCycles) profile->minCycles = cycles;
+	if (cycles > profile->maxCycles) profile->maxCycles = cycles;
+}
+
+#endif
+
 /**
  * @brief IRQ handler for UART0
+ * 
+ * \par S1 is read exactly once and before D, which is the sequence that clears
+ * RDRF. All register accesses go through the volatile peripheral pointer and
+ * the ring buffer operations order their index updates using barriers, so the
+ * handler is correct at any optimization level.
+ *
+ * \par With {@see PROFILE_ENABLED} the receive and transmit paths are timed
+ * with TPM1 as {@see PROFILE_UART_RECEIVE} and {@see PROFILE_UART_TRANSMIT};
+ * set {@see PROFILE_PRESCALER_SHIFT} to 0 for single cycle resolution.
  */
-__attribute__((optimize("-O0"))) // fix: no data received in -O3
+RAMFUNC
 void UART0_Handler()
 {
-    const uint8_t config = UART0->C2;
-    const uint8_t status = UART0->S1;
+	IRQ_PROFILE_ENTER();
+	PROFILE_BEGIN(PROFILE_UART_RECEIVE);
+#if UART_PROFILE_IRQ
+	const uint32_t start = SysTick_BASE_PTR->CVR;
+#endif
+	
+	const uint8_t status = UART0->S1;
+	const uint8_t config = UART0->C2;
 
-    /* handle the receiver full IRQ */
-    if ((config & UART0_C2_RIE_MASK) && (status & UART0_S1_RDRF_MASK))
-    {
-        HandleReceiveInterrupt();
+	/* handle the receiver full IRQ */
+	if ((config & UART0_C2_RIE_MASK) && (status & UART0_S1_RDRF_MASK))
+	{
+		HandleReceiveInterrupt();
 
-        // clear flags
-        // TODO: use BME
-        UART0->S1 |= UART0_S1_OR_MASK;  // overrun
-    }
+		/* an overrun blocks further reception until cleared by writing a one */
+		if (status & UART0_S1_OR_MASK)
+		{
+			/* writes back only the OR bit, leaving the other w1c flags untouched */
+			BitFlag_Acknowledge8(&UART0->S1, UART0_S1_OR_MASK);
+		}
+		
+		PROFILE_END(PROFILE_UART_RECEIVE);
+#if UART_PROFILE_IRQ
+		ProfileIrq(&uart0ReceiveIrqProfile, CyclesSince(start));
+#endif
+	}
 
 	/* handle the transmitter empty IRQ */
 	if ((config & UART0_C2_TIE_MASK) && (status & UART0_S1_TDRE_MASK))
 	{
+		PROFILE_BEGIN(PROFILE_UART_TRANSMIT);
 		HandleTransmitInterrupt();
+		PROFILE_END(PROFILE_UART_TRANSMIT);
+		
+#if UART_PROFILE_IRQ
+		ProfileIrq(&uart0TransmitIrqProfile, CyclesSince(start));
+#endif
 	}
+
+	IRQ_PROFILE_EXIT(IRQ_SOURCE_UART);
 }
 
 #endif /* UART_C_ */
@@ -0,0 +1,105 @@
+/*
+ * flash.c
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include "ARMCM0plus.h"
+#include "derivative.h"
+#include "nice_names.h"
+
+#include "cpu/flash.h"
+#include "cpu/ramfunc.h"
+
+/**
+ * @brief FTFA command to program a longword
+ */
+#define FTFA_COMMAND_PROGRAM_LONGWORD	(0x06u)
+
+/**
+ * @brief FTFA command to erase a sector
+ */
+#define FTFA_COMMAND_ERASE_SECTOR		(0x09u)
+
+/**
+ * @brief The FTFA status flags indicating a failed command
+ */
+#define FTFA_ERROR_MASK	(FTFA_FSTAT_ACCERR_MASK | FTFA_FSTAT_FPVIOL_MASK | FTFA_FSTAT_MGSTAT0_MASK)
+
+/**
+ * @brief Launches the loaded command and waits for its completion
+ * @return The FTFA status
+ *
+ * \par The KL25Z has a single flash block that can not be read while a command
+ * is executing, so this function runs from SRAM (see the .ramfunc section
+ * in the linker script) and must be called with interrupts masked.
+ */
+RAMFUNC_REQUIRED
+static uint8_t Flash_Launch()
+{
+	FTFA->FSTAT = FTFA_FSTAT_CCIF_MASK;
+	while (0 == (FTFA->FSTAT & FTFA_FSTAT_CCIF_MASK)) {}
+	return FTFA->FSTAT;
+}
+
+/**
+ * @brief Executes an FTFA command
+ * @param[in] command The command
+ * @param[in] address The flash address
+ * @param[in] data The longword for programming commands
+ * @return 0 on success, otherwise the FTFA error flags
+ */
+static uint8_t Flash_Execute(const uint8_t command, const uint32_t address, const uint32_t data)
+{
+	/* wait for a previous command and clear its error flags */
+	while (0 == (FTFA->FSTAT & FTFA_FSTAT_CCIF_MASK)) {}
+	FTFA->FSTAT = FTFA_FSTAT_ACCERR_MASK | FTFA_FSTAT_FPVIOL_MASK;
+
+	FTFA->FCCOB0 = command;
+	FTFA->FCCOB1 = (uint8_t)(address >> 16);
+	FTFA->FCCOB2 = (uint8_t)(address >> 8);
+	FTFA->FCCOB3 = (uint8_t)address;
+	FTFA->FCCOB4 = (uint8_t)(data >> 24);
+	FTFA->FCCOB5 = (uint8_t)(data >> 16);
+	FTFA->FCCOB6 = (uint8_t)(data >> 8);
+	FTFA->FCCOB7 = (uint8_t)data;
+
+	/* no code may be fetched from flash while the command runs */
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	const uint8_t status = Flash_Launch();
+	__set_PRIMASK(primask);
+
+	/* the flash cache may still hold the previous contents */
+	MCM_BASE_PTR->PLACR |= MCM_PLACR_CFCC_MASK;
+
+	return status & FTFA_ERROR_MASK;
+}
+
+/**
+ * @brief Erases a flash sector
+ * @param[in] address The sector address, aligned to {@see FLASH_SECTOR_SIZE}
+ * @return 0 on success, otherwise the FTFA error flags (ACCERR, FPVIOL, MGSTAT0)
+ */
+uint8_t Flash_EraseSector(const uint32_t address)
+{
+	return Flash_Execute(FTFA_COMMAND_ERASE_SECTOR, address, 0);
+}
+
+/**
+ * @brief Programs erased flash longword by longword
+ * @param[in] address The destination address, aligned to four bytes
+ * @param[in] data The data
+ * @param[in] count The number of longwords
+ * @return 0 on success, otherwise the FTFA error flags of the failed longword
+ */
+uint8_t Flash_Program(uint32_t address, const uint32_t *data, uint32_t count)
+{
+	for (; count > 0; --count, address += sizeof(uint32_t), ++data)
+	{
+		const uint8_t status = Flash_Execute(FTFA_COMMAND_PROGRAM_LONGWORD, address, *data);
+		if (0 != status) return status;
+	}
+	return 0;
+}
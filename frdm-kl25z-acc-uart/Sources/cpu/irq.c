@@ -0,0 +1,105 @@
+/*
+ * irq.c
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include "cpu/irq.h"
+#include "cpu/systick.h"
+
+#if IRQ_PROFILE_ENABLED && SYSTICK_TICKLESS
+#error The interrupt profile measures with the periodic SysTick counter
+#endif
+
+/**
+ * @brief The priority plan, indexed by {@see irq_source_t}
+ */
+static const uint8_t sourcePriority[IRQ_SOURCE_COUNT] = {
+	[IRQ_SOURCE_SENSOR] = IRQ_PRIORITY_SENSOR,
+	[IRQ_SOURCE_I2C] = IRQ_PRIORITY_TRANSFER,
+	[IRQ_SOURCE_I2C_DMA] = IRQ_PRIORITY_TRANSFER,
+	[IRQ_SOURCE_UART] = IRQ_PRIORITY_COMM,
+	[IRQ_SOURCE_UART_DMA] = IRQ_PRIORITY_COMM,
+	[IRQ_SOURCE_TICK] = IRQ_PRIORITY_TICK,
+	[IRQ_SOURCE_FUSION] = IRQ_PRIORITY_FUSION,
+};
+
+/**
+ * @brief Assigns the planned priority to an interrupt, clears it and enables it
+ * @param[in] irq The IRQ number, or SysTick_IRQn and PendSV_IRQn for the system exceptions
+ * @param[in] source The source the interrupt belongs to
+ *
+ * \par The priority must be set while the interrupt is disabled, since the
+ * four priorities of a register word are written at once.
+ */
+void Irq_Enable(const IRQn_Type irq, const irq_source_t source)
+{
+	NVIC_SetPriority(irq, sourcePriority[source]);
+	if (irq < 0) return;
+
+	NVIC_ClearPendingIRQ(irq);
+	NVIC_EnableIRQ(irq);
+}
+
+#if IRQ_PROFILE_ENABLED
+
+volatile irq_stats_t irqStats[IRQ_SOURCE_COUNT];
+volatile uint32_t irqTickLatency = 0;
+
+/**
+ * @brief Accumulates the duration of a handler
+ * @param[in] source The source of the handler
+ * @param[in] start The SysTick counter value at the handler entry
+ *
+ * \par The SysTick counter counts down and reloads at zero; the handler
+ * must not span more than one tick period.
+ */
+void Irq_Record(const irq_source_t source, const uint32_t start)
+{
+	const uint32_t now = SysTick_BASE_PTR->CVR;
+	const uint32_t cycles = (start >= now) ? (start - now) : (start + SysTick_BASE_PTR->RVR + 1 - now);
+
+	/* sources of a higher level may preempt the update */
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	volatile irq_stats_t *const stats = &irqStats[source];
+	++stats->count;
+	if (cycles > stats->maxCycles) stats->maxCycles = cycles;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief Derives the worst-case entry latency of every source from the measured handler durations
+ *
+ * \par Called from the main loop; a handler updating its own maximum meanwhile
+ * is accounted for in the next call.
+ */
+void Irq_UpdateLatency()
+{
+	for (uint_fast8_t source = 0; source < IRQ_SOURCE_COUNT; ++source)
+	{
+		const uint8_t priority = sourcePriority[source];
+		uint32_t preempting = 0;
+		uint32_t blocking = 0;
+
+		for (uint_fast8_t other = 0; other < IRQ_SOURCE_COUNT; ++other)
+		{
+			if (0 == irqStats[other].count) continue;
+
+			const uint32_t cycles = irqStats[other].maxCycles + IRQ_OVERHEAD_CYCLES;
+			if (sourcePriority[other] < priority)
+			{
+				preempting += cycles;
+			}
+			else if ((sourcePriority[other] == priority) && (cycles > blocking))
+			{
+				blocking = cycles;
+			}
+		}
+
+		irqStats[source].maxLatency = IRQ_OVERHEAD_CYCLES + blocking + preempting;
+	}
+}
+
+#endif
@@ -0,0 +1,87 @@
+/*
+* profile.c
+*
+*  Created on: Oct 14, 2026
+*      Author: agent
+*/
+
+#include "cpu/profile.h"
+#include "cpu/clock.h"
+
+#if PROFILE_ENABLED
+profile_stats_t profileStats[PROFILE_SECTION_COUNT];
+#endif
+
+/**
+ * @brief Initializes TPM1 as free running counter and clears the timings
+ * @return none.
+ *
+ * \par TPM1 counts the PLL/2 clock, which equals the core clock, through
+ * the prescaler over the full 16 bit range. No channels or interrupts are used.
+ * The timings only exist with {@see PROFILE_ENABLED}.
+ */
+void InitProfile()
+{
+	/* clock the TPMs from PLL/2, like UART0 */
+	SIM->SOPT2 &= ~(SIM_SOPT2_TPMSRC_MASK | SIM_SOPT2_PLLFLLSEL_MASK);
+	SIM->SOPT2 |= SIM_SOPT2_TPMSRC(0b01U) | SIM_SOPT2_PLLFLLSEL_MASK;
+	SIM->SCGC6 |= SIM_SCGC6_TPM1_MASK;
+
+	/* the prescaler must only be changed while the counter is disabled */
+	TPM1->SC = 0;
+	TPM1->CNT = 0;
+	TPM1->MOD = 0xFFFFu;
+	TPM1->SC = TPM_SC_CMOD(0b01U) | TPM_SC_PS(PROFILE_PRESCALER_SHIFT);
+
+#if PROFILE_ENABLED
+	for (uint_fast8_t section = 0; section < PROFILE_SECTION_COUNT; ++section)
+	{
+		profile_stats_t *const stats = &profileStats[section];
+		stats->count = 0;
+		stats->minCycles = UINT32_MAX;
+		stats->maxCycles = 0;
+		stats->totalCycles = 0;
+		for (uint_fast8_t bucket = 0; bucket < PROFILE_HISTOGRAM_BUCKETS; ++bucket)
+		{
+			stats->histogram[bucket] = 0;
+		}
+	}
+#endif
+}
+
+#if PROFILE_ENABLED
+
+/**
+ * @brief Accumulates the duration of a section
+ * @param[in] section The section
+ * @param[in] start The {@see Profile_Now} value at the start of the section
+ *
+ * \par The modulo 2^16 difference is exact as long as the section is shorter
+ * than one counter period.
+ */
+void Profile_Record(const profile_section_t section, const uint16_t start)
+{
+	const uint16_t counts = (uint16_t)(Profile_Now() - start);
+	const uint32_t cycles = (uint32_t)counts << PROFILE_PRESCALER_SHIFT;
+	profile_stats_t *const stats = &profileStats[section];
+
+	++stats->count;
+	stats->totalCycles += cycles;
+	if (cycles < stats->minCycles) stats->minCycles = cycles;
+	if (cycles > stats->maxCycles) stats->maxCycles = cycles;
+
+	/* floor(log2(counts)) by bisection; the M0+ has no CLZ instruction */
+	uint_fast8_t bucket = 0;
+	uint_fast16_t value = counts;
+	if (value >> 8) { value >>= 8; bucket += 8; }
+	if (value >> 4) { value >>= 4; bucket += 4; }
+	if (value >> 2) { value >>= 2; bucket += 2; }
+	if (value >> 1) { bucket += 1; }
+
+	if (stats->histogram[bucket] != UINT16_MAX)
+	{
+		++stats->histogram[bucket];
+	}
+}
+
+#endif
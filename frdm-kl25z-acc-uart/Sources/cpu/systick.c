@@ -5,11 +5,25 @@
  *      Author: Markus
  */
 
+#include "ARMCM0plus.h"
 #include "derivative.h"
+#include "nice_names.h"
 
 #include "cpu/clock.h"
+#include "cpu/irq.h"
 #include "cpu/systick.h"
 
+#if SYSTICK_TICKLESS
+#include "mcg/mcg.h"
+#endif
+
+/**
+ * @brief The system tick counter
+ */
+volatile uint32_t SystemMilliseconds = 0;
+
+#if !SYSTICK_TICKLESS
+
 /**
  * @brief Initializes the SysTick interrupt
  * @return none.
@@ -24,24 +38,358 @@ void InitSysTick()
 	SysTick_BASE_PTR->CSR = SysTick_CSR_ENABLE_MASK				/* enable the systick timer */ 
 							| SysTick_CSR_TICKINT_MASK 			/* enable interrupt if timer reaches zero */
 							| SysTick_CSR_CLKSOURCE_MASK;		/* use processor clock instead of external clock */
+
+	Irq_Enable(SysTick_IRQn, IRQ_SOURCE_TICK);
 }
 
 /**
- * @brief The system tick counter
+ * @brief 250µs Counter
  */
-volatile uint32_t SystemMilliseconds = 0;
+static uint32_t freeRunner = 0;
 
 /**
- * @brief 250µs Counter
+ * @brief The number of system ticks since start
  */
-static uint32_t freeRunner = 0;
+static volatile uint32_t systemTicks = 0;
+
+/**
+ * @brief Fixed point reciprocal of the core cycles per microsecond, scaled by 2^16
+ * 
+ * The Cortex-M0+ has no hardware divider.
+ */
+#define SYSTICK_US_RECIPROCAL	((65536u + (CORE_CLOCK/1000000u) - 1) / (CORE_CLOCK/1000000u))
+
+/**
+ * @brief Counts a SysTick reload
+ *
+ * Must be called with interrupts masked, once per set COUNTFLAG.
+ */
+static inline void CountTick()
+{
+	++systemTicks;
+	SystemMilliseconds += ((++freeRunner) & 0b100) >> 2;
+	freeRunner &= 0b11;
+}
 
 /**
  * @brief The SysTick interrupt handler
  * @return none.
+ *
+ * \par The tick has the lowest priority, so a handler that reads the time may
+ * preempt this one right after its entry. Reading CSR clears COUNTFLAG; whoever
+ * reads it set first counts the reload, be it this handler or {@see SysTick_Microseconds}.
  */
 void SysTick_Handler() 
 {
-	SystemMilliseconds += ((++freeRunner) & 0b100) >> 2;
-	freeRunner &= 0b11;
+	IRQ_PROFILE_ENTER();
+	__disable_irq();
+#if IRQ_PROFILE_ENABLED
+	/* the reload time is known, so the entry latency is measured directly */
+	const uint32_t latency = SysTick_BASE_PTR->RVR - SysTick_BASE_PTR->CVR;
+	if (latency > irqTickLatency) irqTickLatency = latency;
+#endif
+	if (SysTick_BASE_PTR->CSR & SysTick_CSR_COUNTFLAG_MASK)
+	{
+		CountTick();
+	}
+	__enable_irq();
+	IRQ_PROFILE_EXIT(IRQ_SOURCE_TICK);
+}
+
+/**
+ * @brief Returns the current system time in microseconds
+ * @return The time; wraps around after approximately 71 minutes.
+ *
+ * \par Combines the tick count with the current value of the SysTick counter.
+ * A reload that the handler has not counted yet, because interrupts are masked
+ * or the handler is preempted, is detected and counted using COUNTFLAG, in which
+ * case the counter is sampled again.
+ */
+uint32_t SysTick_Microseconds()
+{
+	const uint32_t reload = SysTick_BASE_PTR->RVR;
+	
+	/* may be called with interrupts already masked */
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint32_t elapsed = reload - SysTick_BASE_PTR->CVR;
+	if (SysTick_BASE_PTR->CSR & SysTick_CSR_COUNTFLAG_MASK)
+	{
+		CountTick();
+		elapsed = reload - SysTick_BASE_PTR->CVR;
+	}
+	const uint32_t ticks = systemTicks;
+	__set_PRIMASK(primask);
+	
+	return ticks * SYSTICK_PERIOD_US + ((elapsed * SYSTICK_US_RECIPROCAL) >> 16);
+}
+
+/**
+ * @brief Returns the current system time in milliseconds
+ * @return The time.
+ */
+uint32_t SysTick_Milliseconds()
+{
+	return SystemMilliseconds;
+}
+
+/**
+ * @brief Sleeps until the next interrupt
+ * @param[in] deadline Unused; the next tick ends the sleep
+ * @param[in] deep Unused
+ */
+void SysTick_Sleep(const uint32_t deadline, const uint8_t deep)
+{
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	__DSB();
+	__WFI();
+	__set_PRIMASK(primask);
 }
+
+#else // SYSTICK_TICKLESS
+
+/**
+ * @brief The LPTMR interrupt number
+ */
+#define LPTMR0_IRQ				(28)
+
+/**
+ * @brief The LPTMR prescaler setting; the crystal clock is divided by 2^(n+1)
+ */
+#define LPTMR_PRESCALE			(2u)
+
+#if (XTAL_FREQ >> (LPTMR_PRESCALE + 1)) != 1000000u
+#error The LPTMR prescaler must divide the crystal clock down to 1 MHz
+#endif
+
+/**
+ * @brief The LPTMR compare step; two compares per wrap-around keep the wrap detection unambiguous
+ */
+#define LPTMR_COMPARE_STEP		(0x8000u)
+
+/**
+ * @brief Core cycles per microsecond, for the one-shot SysTick
+ */
+#define SYSTICK_CYCLES_PER_US	(CORE_CLOCK/1000000u)
+
+#if (SYSTICK_MAX_SLEEP_US * SYSTICK_CYCLES_PER_US) > SysTick_RVR_RELOAD_MASK
+#error SYSTICK_MAX_SLEEP_US exceeds the 24 bit SysTick reload value
+#endif
+
+/**
+ * @brief The microseconds of all completed LPTMR wrap-arounds
+ */
+static uint32_t counterEpoch = 0;
+
+/**
+ * @brief The LPTMR count at the last time update
+ */
+static uint16_t lastCount = 0;
+
+/**
+ * @brief The time of the last update in microseconds
+ */
+static uint32_t lastMicroseconds = 0;
+
+/**
+ * @brief The microseconds not yet carried into {@see SystemMilliseconds}
+ */
+static uint32_t millisecondRemainder = 0;
+
+/**
+ * @brief Initializes the LPTMR time base
+ * @return none.
+ *
+ * \par The LPTMR free-runs on the crystal clock prescaled to 1 MHz, which keeps
+ * running in VLPS. Its compare interrupt fires every {@see LPTMR_COMPARE_STEP}
+ * counts, so that the time is updated at least twice per wrap-around.
+ */
+void InitSysTick()
+{
+	/* the oscillator clock must be enabled, also in stop modes */
+	OSC0->CR |= OSC_CR_ERCLKEN_MASK | OSC_CR_EREFSTEN_MASK;
+	SIM->SCGC5 |= SIM_SCGC5_LPTMR_MASK;
+
+#if SYSTICK_TICKLESS_VLPS
+	/* PMPROT is write-once after reset */
+	SMC->PMPROT = SMC_PMPROT_AVLP_MASK;
+#endif
+
+	/* the prescaler and compare must only be changed while the timer is disabled */
+	LPTMR0->CSR = 0;
+	LPTMR0->PSR = LPTMR_PSR_PCS(0b11) | LPTMR_PSR_PRESCALE(LPTMR_PRESCALE); /* OSCERCLK */
+	LPTMR0->CMR = LPTMR_COMPARE_STEP;
+	LPTMR0->CSR = LPTMR_CSR_TFC_MASK | LPTMR_CSR_TIE_MASK | LPTMR_CSR_TCF_MASK;
+	LPTMR0->CSR |= LPTMR_CSR_TEN_MASK;
+
+	/* the SysTick is armed per sleep only */
+	SysTick_BASE_PTR->CSR = 0;
+
+	Irq_Enable((IRQn_Type)LPTMR0_IRQ, IRQ_SOURCE_TICK);
+	Irq_Enable(SysTick_IRQn, IRQ_SOURCE_TICK);
+}
+
+/**
+ * @brief Advances the time from the LPTMR count
+ * @return The current time in microseconds
+ *
+ * Must be called with interrupts masked.
+ */
+static uint32_t UpdateTime()
+{
+	/* writing the counter latches its value for reading */
+	LPTMR0->CNR = 0;
+	const uint16_t count = (uint16_t)LPTMR0->CNR;
+	if (count < lastCount)
+	{
+		counterEpoch += 0x10000u;
+	}
+	lastCount = count;
+
+	const uint32_t now = counterEpoch + count;
+
+	/* the updates are at most half a wrap-around apart, so this takes a few iterations at most */
+	millisecondRemainder += now - lastMicroseconds;
+	lastMicroseconds = now;
+	while (millisecondRemainder >= 1000u)
+	{
+		millisecondRemainder -= 1000u;
+		++SystemMilliseconds;
+	}
+
+	return now;
+}
+
+/**
+ * @brief The LPTMR interrupt handler
+ * @return none.
+ */
+void LPTimer_Handler()
+{
+	/* the compare value may only be changed while the flag is set */
+	LPTMR0->CMR = (LPTMR0->CMR + LPTMR_COMPARE_STEP) & LPTMR_CMR_COMPARE_MASK;
+	LPTMR0->CSR |= LPTMR_CSR_TCF_MASK;
+
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	UpdateTime();
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief The SysTick interrupt handler
+ * @return none.
+ *
+ * \par The one-shot deadline has passed; waking up was all it had to do.
+ */
+void SysTick_Handler()
+{
+	SysTick_BASE_PTR->CSR = 0;
+}
+
+/**
+ * @brief Returns the current system time in microseconds
+ * @return The time; wraps around after approximately 71 minutes.
+ */
+uint32_t SysTick_Microseconds()
+{
+	/* may be called with interrupts already masked */
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	const uint32_t now = UpdateTime();
+	__set_PRIMASK(primask);
+	return now;
+}
+
+/**
+ * @brief Returns the current system time in milliseconds
+ * @return The time.
+ */
+uint32_t SysTick_Milliseconds()
+{
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	UpdateTime();
+	const uint32_t milliseconds = SystemMilliseconds;
+	__set_PRIMASK(primask);
+	return milliseconds;
+}
+
+#if SYSTICK_TICKLESS_VLPS
+
+/**
+ * @brief Stops the core and the bus clocks until the next interrupt
+ *
+ * Must be called with interrupts masked. The MCG falls back from PEE to PBE
+ * in VLPS, so the PLL is engaged again before any interrupt is served.
+ */
+static void EnterVlps()
+{
+	SMC->PMCTRL = (SMC->PMCTRL & ~SMC_PMCTRL_STOPM_MASK) | SMC_PMCTRL_STOPM(0b010);
+	(void)SMC->PMCTRL; /* the mode must be set before WFI */
+
+	SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+	__DSB();
+	__WFI();
+	SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+	if (((MCG_S & MCG_S_CLKST_MASK) >> MCG_S_CLKST_SHIFT) != 0x3)
+	{
+		pbe_pee(XTAL_FREQ);
+	}
+}
+
+#endif
+
+/**
+ * @brief Sleeps until the next interrupt or the deadline, whichever comes first
+ * @param[in] deadline The wakeup time in microseconds, see {@see SysTick_Microseconds}
+ * @param[in] deep Nonzero if no peripheral needs the bus clock, allowing VLPS
+ *
+ * \par VLPS is only entered if the next LPTMR compare comes before the deadline,
+ * since the SysTick does not run in VLPS; the remainder is slept in WAIT.
+ */
+void SysTick_Sleep(const uint32_t deadline, const uint8_t deep)
+{
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	const uint32_t now = UpdateTime();
+	int32_t remaining = (int32_t)(deadline - now);
+	if (remaining <= 0)
+	{
+		__set_PRIMASK(primask);
+		return;
+	}
+	if (remaining > (int32_t)SYSTICK_MAX_SLEEP_US)
+	{
+		remaining = SYSTICK_MAX_SLEEP_US;
+	}
+
+#if SYSTICK_TICKLESS_VLPS
+	const uint16_t untilCompare = (uint16_t)(LPTMR0->CMR - lastCount);
+	if (deep && (remaining >= untilCompare))
+	{
+		EnterVlps();
+		__set_PRIMASK(primask);
+		return;
+	}
+#endif
+
+	/* one-shot; writing the current value clears it and starts from the reload value */
+	SysTick_BASE_PTR->CSR = 0;
+	SysTick_BASE_PTR->RVR = (uint32_t)remaining * SYSTICK_CYCLES_PER_US - 1;
+	SysTick_BASE_PTR->CVR = 0;
+	SysTick_BASE_PTR->CSR = SysTick_CSR_ENABLE_MASK | SysTick_CSR_TICKINT_MASK | SysTick_CSR_CLKSOURCE_MASK;
+
+	__DSB();
+	__WFI();
+
+	/* whatever woke the core, the deadline is re-armed with the next sleep */
+	SysTick_BASE_PTR->CSR = 0;
+	SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+	__set_PRIMASK(primask);
+}
+
+#endif // SYSTICK_TICKLESS
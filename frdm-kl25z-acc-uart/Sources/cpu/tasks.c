@@ -0,0 +1,205 @@
+/*
+ * tasks.c
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include "ARMCM0plus.h"
+#include "nice_names.h"
+#include "cpu/tasks.h"
+
+/**
+ * @brief Compares two deadlines across the wrap-around of the system time
+ * @param[in] a The first deadline
+ * @param[in] b The second deadline
+ * @return Nonzero if a is earlier than b
+ */
+static inline uint8_t Earlier(const uint32_t a, const uint32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
+
+/**
+ * @brief Places a task at a heap position
+ * @param[in] scheduler The scheduler instance
+ * @param[in] index The heap position
+ * @param[in] task The task index
+ */
+static inline void Place(task_scheduler_t *const scheduler, const uint8_t index, const uint8_t task)
+{
+	scheduler->heap[index] = task;
+	scheduler->position[task] = index + 1;
+}
+
+/**
+ * @brief Restores the heap order for a task that may be earlier than its parents or later than its children
+ * @param[in] scheduler The scheduler instance
+ * @param[in] index The heap position of the task
+ */
+static void Restore(task_scheduler_t *const scheduler, uint8_t index)
+{
+	const uint8_t task = scheduler->heap[index];
+	const uint32_t deadline = scheduler->deadline[task];
+
+	/* up, while earlier than the parent */
+	while (index > 0)
+	{
+		const uint8_t parent = (index - 1) >> 1;
+		if (!Earlier(deadline, scheduler->deadline[scheduler->heap[parent]])) break;
+
+		Place(scheduler, index, scheduler->heap[parent]);
+		index = parent;
+	}
+
+	/* down, while a child is earlier */
+	for (;;)
+	{
+		uint8_t child = 2 * index + 1;
+		if (child >= scheduler->armed) break;
+
+		if ((child + 1 < scheduler->armed) && Earlier(scheduler->deadline[scheduler->heap[child + 1]], scheduler->deadline[scheduler->heap[child]]))
+		{
+			++child;
+		}
+		if (!Earlier(scheduler->deadline[scheduler->heap[child]], deadline)) break;
+
+		Place(scheduler, index, scheduler->heap[child]);
+		index = child;
+	}
+
+	Place(scheduler, index, task);
+}
+
+/**
+ * @brief Initializes the scheduler
+ * @param[in] scheduler The scheduler instance
+ * @param[in] tasks The tasks, in order of priority
+ * @param[in] count The number of tasks, at most {@see TASKS_MAX_COUNT}
+ */
+void Tasks_Init(task_scheduler_t *const scheduler, const task_t *const tasks, uint8_t count)
+{
+	assert(count <= TASKS_MAX_COUNT);
+
+	scheduler->tasks = tasks;
+	scheduler->count = count;
+	scheduler->armed = 0;
+	scheduler->events = 0;
+
+	for (uint8_t i = 0; i < count; ++i)
+	{
+		scheduler->position[i] = 0;
+	}
+}
+
+/**
+ * @brief Arms or moves the deadline of a task
+ * @param[in] scheduler The scheduler instance
+ * @param[in] task The task index
+ * @param[in] deadline The system time in milliseconds to run the task at
+ *
+ * \par Not reentrant; only used by the tasks and their setup in thread mode.
+ */
+void Tasks_Schedule(task_scheduler_t *const scheduler, uint8_t task, uint32_t deadline)
+{
+	scheduler->deadline[task] = deadline;
+
+	if (0 == scheduler->position[task])
+	{
+		Place(scheduler, scheduler->armed++, task);
+	}
+	Restore(scheduler, scheduler->position[task] - 1);
+}
+
+/**
+ * @brief Disarms the deadline of a task
+ * @param[in] scheduler The scheduler instance
+ * @param[in] task The task index
+ */
+void Tasks_Cancel(task_scheduler_t *const scheduler, uint8_t task)
+{
+	const uint8_t position = scheduler->position[task];
+	if (0 == position) return;
+
+	scheduler->position[task] = 0;
+	const uint8_t last = scheduler->heap[--scheduler->armed];
+	if (last == task) return;
+
+	/* the last task fills the gap */
+	Place(scheduler, position - 1, last);
+	Restore(scheduler, position - 1);
+}
+
+/**
+ * @brief Signals event bits, running the tasks waiting for them with the next {@see Tasks_Run}
+ * @param[in] scheduler The scheduler instance
+ * @param[in] events The event bits
+ *
+ * \par The M0+ has no exclusive accesses, so the read-modify-write is masked.
+ */
+void Tasks_Signal(task_scheduler_t *const scheduler, uint32_t events)
+{
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	scheduler->events |= events;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief Runs the tasks of the signalled events, then the tasks whose deadline has passed
+ * @param[in] scheduler The scheduler instance
+ * @param[in] now The current system time in milliseconds
+ * @return Nonzero if any task ran
+ *
+ * \par The deadline of a task is disarmed before it runs. A task runs for a
+ * deadline at most once per call, so one arming an already passed deadline
+ * cannot starve the caller; it runs again with the next call.
+ */
+uint8_t Tasks_Run(task_scheduler_t *const scheduler, uint32_t now)
+{
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	const uint32_t events = scheduler->events;
+	scheduler->events = 0;
+	__set_PRIMASK(primask);
+
+	uint8_t ran = 0;
+	if (0 != events)
+	{
+		for (uint8_t i = 0; i < scheduler->count; ++i)
+		{
+			if (0 == (scheduler->tasks[i].events & events)) continue;
+
+			scheduler->tasks[i].run(now);
+			ran = 1;
+		}
+	}
+
+	uint32_t deadlinesRun = 0;
+	while (scheduler->armed > 0)
+	{
+		const uint8_t task = scheduler->heap[0];
+		if (Earlier(now, scheduler->deadline[task]) || (deadlinesRun & (1u << task))) break;
+
+		Tasks_Cancel(scheduler, task);
+		deadlinesRun |= 1u << task;
+		scheduler->tasks[task].run(now);
+		ran = 1;
+	}
+
+	return ran;
+}
+
+/**
+ * @brief Determines the time until the next deadline
+ * @param[in] scheduler The scheduler instance
+ * @param[in] now The current system time in milliseconds
+ * @return The time in milliseconds, zero if a deadline has passed, or UINT32_MAX if none is armed
+ */
+uint32_t Tasks_Remaining(const task_scheduler_t *const scheduler, uint32_t now)
+{
+	if (0 == scheduler->armed) return UINT32_MAX;
+
+	const uint32_t deadline = scheduler->deadline[scheduler->heap[0]];
+	return Earlier(now, deadline) ? (deadline - now) : 0;
+}
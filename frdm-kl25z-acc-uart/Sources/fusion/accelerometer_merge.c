@@ -0,0 +1,89 @@
+#include <stdint.h>
+#include "fixmath.h"
+#include "fusion/sensor_calibration.h"
+#include "fusion/accelerometer_merge.h"
+
+/*!
+* \brief The latest prepared sample per accelerometer
+*/
+static v3d latest_sample[ACCELEROMETER_SOURCE_COUNT];
+
+/*!
+* \brief The capture time of the latest sample per accelerometer in microseconds
+*/
+static uint32_t latest_time[ACCELEROMETER_SOURCE_COUNT];
+
+/*!
+* \brief Nonzero for the accelerometers that delivered a sample
+*/
+static uint8_t latest_valid[ACCELEROMETER_SOURCE_COUNT];
+
+/*!
+* \brief The MMA8451Q weight per axis, var_mpu6050 / (var_mpu6050 + var_mma8451q)
+*/
+static fix16_t mma8451q_weight[3];
+
+/*!
+* \brief Determines the inverse variance weight of the second of two measurements
+* \param[in] first The variance of the first measurement
+* \param[in] second The variance of the second measurement
+* \return The weight in [0, 1]
+*
+* Runs at initialization only; the variances are close to the Q16 resolution, so the
+* quotient is taken in 64 bit instead of fix16_div.
+*/
+static fix16_t merge_weight(const fix16_t first, const fix16_t second)
+{
+    const int64_t sum = (int64_t)first + second;
+    if (sum <= 0) return fix16_one / 2;
+
+    return (fix16_t)((((int64_t)first << 16) + sum / 2) / sum);
+}
+
+/*!
+* \brief Derives the per axis merge weights from the accelerometer variances
+*/
+void accelerometer_merge_initialize()
+{
+    fix16_t mpu6050[3], mma8451q[3];
+    mpu6050_var_accelerometer(&mpu6050[0], &mpu6050[1], &mpu6050[2]);
+    mma8451q_var_accelerometer(&mma8451q[0], &mma8451q[1], &mma8451q[2]);
+
+    for (uint_fast8_t axis = 0; axis < 3; ++axis)
+    {
+        mma8451q_weight[axis] = merge_weight(mpu6050[axis], mma8451q[axis]);
+    }
+
+    for (uint_fast8_t source = 0; source < ACCELEROMETER_SOURCE_COUNT; ++source)
+    {
+        latest_valid[source] = 0;
+    }
+}
+
+/*!
+* \brief Merges a prepared accelerometer sample with the latest sample of the other accelerometer
+* \param[in] source The accelerometer the sample stems from
+* \param[in] timestamp The capture time of the sample in microseconds
+* \param[in] sample The prepared sample in the MPU6050 frame
+* \param[out] merged The inverse variance weighted mean of both samples; may alias sample
+*/
+void accelerometer_merge(const accelerometer_source_t source, const uint32_t timestamp, register const v3d *const sample, register v3d *const merged)
+{
+    latest_sample[source] = *sample;
+    latest_time[source] = timestamp;
+    latest_valid[source] = 1;
+
+    const accelerometer_source_t other = (ACCELEROMETER_SOURCE_MPU6050 == source) ? ACCELEROMETER_SOURCE_MMA8451Q : ACCELEROMETER_SOURCE_MPU6050;
+    if (!latest_valid[other] || ((timestamp - latest_time[other]) > ACCELEROMETER_MERGE_MAX_AGE_US))
+    {
+        *merged = latest_sample[source];
+        return;
+    }
+
+    // mpu6050 + w * (mma8451q - mpu6050); the weight is at most one, so the difference can not overflow
+    register const v3d *const mpu6050 = &latest_sample[ACCELEROMETER_SOURCE_MPU6050];
+    register const v3d *const mma8451q = &latest_sample[ACCELEROMETER_SOURCE_MMA8451Q];
+    merged->x = fix16_add(mpu6050->x, fix16_mul(mma8451q_weight[0], fix16_sub(mma8451q->x, mpu6050->x)));
+    merged->y = fix16_add(mpu6050->y, fix16_mul(mma8451q_weight[1], fix16_sub(mma8451q->y, mpu6050->y)));
+    merged->z = fix16_add(mpu6050->z, fix16_mul(mma8451q_weight[2], fix16_sub(mma8451q->z, mpu6050->z)));
+}
@@ -0,0 +1,144 @@
+#include <stdint.h>
+#include "fixmath.h"
+#include "fusion/fast_normalize.h"
+
+/*!
+* \brief Reciprocal square root seeds in Q1.15 for the mantissa range [0.25, 1)
+*
+* Entry i covers [(i+16)/64, (i+17)/64) and holds the harmonic mean of the
+* reciprocal square roots at the interval bounds, which keeps the relative
+* seed error below 1.6%.
+*/
+static const uint16_t rsqrt_seed[48] = {
+    64543, 62671, 60953, 59369, 57902, 56539, 55268, 54079,
+    52964, 51915, 50926, 49991, 49106, 48266, 47468, 46709,
+    45984, 45293, 44632, 43998, 43391, 42809, 42249, 41711,
+    41193, 40693, 40212, 39747, 39298, 38863, 38443, 38036,
+    37642, 37260, 36889, 36529, 36180, 35840, 35510, 35188,
+    34875, 34571, 34274, 33985, 33703, 33428, 33159, 32897
+};
+
+/*!
+* \brief Calculates the reciprocal square root of a nonzero Q32.32 value
+* \param[in] square The value
+* \param[out] half_shift Half of the even normalization shift e
+* \return The reciprocal square root y of the normalized mantissa in Q2.30
+*
+* square = M * 2^(32-e) with M in [0.25, 1), hence 1/sqrt(square) = y * 2^(e/2-16).
+* Every Newton step y' = y * (3 - M*y^2) / 2 squares the relative error, so two
+* steps take the 1.6% seed error below the Q16 resolution.
+*/
+HOT LEAF NONNULL
+uint32_t rsqrt_q30(register uint64_t square, register uint_fast8_t *const half_shift)
+{
+    // normalize by even shifts; the M0+ has no CLZ instruction
+    register uint_fast8_t shift = 0;
+    if (0 == (square >> 32)) { square <<= 32; shift += 32; }
+    if (0 == (square >> 48)) { square <<= 16; shift += 16; }
+    if (0 == (square >> 56)) { square <<= 8;  shift += 8; }
+    if (0 == (square >> 60)) { square <<= 4;  shift += 4; }
+    if (0 == (square >> 62)) { square <<= 2;  shift += 2; }
+    *half_shift = shift >> 1;
+
+    // mantissa in Q0.32 and seed in Q2.30
+    register const uint32_t mantissa = (uint32_t)(square >> 32);
+    register uint32_t y = (uint32_t)rsqrt_seed[(square >> 58) - 16] << 15;
+
+    for (uint_fast8_t step = 0; step < 2; ++step)
+    {
+        register const uint64_t y2 = ((uint64_t)y * y) >> 30;
+        register const uint32_t my2 = (uint32_t)((mantissa * y2) >> 32);
+        y = (uint32_t)(((uint64_t)y * ((3UL << 30) - my2)) >> 31);
+    }
+
+    return y;
+}
+
+/*!
+* \brief Scales a Q16.16 value by y * 2^(-shift) with rounding
+* \param[in] value The value
+* \param[in] y The factor in Q2.30
+* \param[in] shift The total shift, at least one
+* \return The scaled value
+*/
+HOT CONST LEAF
+STATIC_INLINE fix16_t scale(register const fix16_t value, register const uint32_t y, register const uint_fast8_t shift)
+{
+    register const int64_t product = (int64_t)value * y;
+    return (fix16_t)((product + ((int64_t)1 << (shift - 1))) >> shift);
+}
+
+/*!
+* \brief Calculates the reciprocal square root of a Q16.16 value.
+* \param[in] value The value, required to be positive
+* \return 1/sqrt(value) or fix16_maximum if value is not positive
+*/
+fix16_t fix16_rsqrt(register const fix16_t value)
+{
+    if (value <= 0)
+    {
+        return fix16_maximum;
+    }
+
+    // value is at least 2^-16, so the result of at most 2^8 needs no saturation
+    uint_fast8_t half_shift;
+    register const uint32_t y = rsqrt_q30((uint64_t)value << 16, &half_shift);
+    return scale(F16(1), y, 46 - half_shift);
+}
+
+/*!
+* \brief Normalizes a vector by multiplying with the reciprocal square root of its squared norm.
+* \param[out] dest The normalized vector, may be equal to src
+* \param[in] src The vector to normalize
+* \return false if the vector has zero length and dest was set to zero
+*/
+bool v3d_normalize_fast(v3d *const dest, const v3d *const src)
+{
+    register const fix16_t x = src->x;
+    register const fix16_t y = src->y;
+    register const fix16_t z = src->z;
+
+    // squared norm in Q32.32; three squares of at most 2^62 fit unsigned
+    register const uint64_t square = (uint64_t)((int64_t)x * x) + (uint64_t)((int64_t)y * y) + (uint64_t)((int64_t)z * z);
+    if (0 == square)
+    {
+        dest->x = dest->y = dest->z = 0;
+        return false;
+    }
+
+    // the components in Q16.16 times y in Q2.30 yield Q18.46 before scaling by 2^(e/2)
+    uint_fast8_t half_shift;
+    register const uint32_t inverse = rsqrt_q30(square, &half_shift);
+    register const uint_fast8_t shift = 46 - half_shift;
+
+    dest->x = scale(x, inverse, shift);
+    dest->y = scale(y, inverse, shift);
+    dest->z = scale(z, inverse, shift);
+    return true;
+}
+
+/*!
+* \brief Normalizes a two component vector, see {\ref v3d_normalize_fast}.
+* \param[in,out] a The first component
+* \param[in,out] b The second component
+* \return false if the vector has zero length and was left unchanged
+*/
+bool fix16_normalize2_fast(fix16_t *RESTRICT const a, fix16_t *RESTRICT const b)
+{
+    register const fix16_t x = *a;
+    register const fix16_t y = *b;
+
+    register const uint64_t square = (uint64_t)((int64_t)x * x) + (uint64_t)((int64_t)y * y);
+    if (0 == square)
+    {
+        return false;
+    }
+
+    uint_fast8_t half_shift;
+    register const uint32_t inverse = rsqrt_q30(square, &half_shift);
+    register const uint_fast8_t shift = 46 - half_shift;
+
+    *a = scale(x, inverse, shift);
+    *b = scale(y, inverse, shift);
+    return true;
+}
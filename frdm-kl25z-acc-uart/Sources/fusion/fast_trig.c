@@ -0,0 +1,194 @@
+#include <stdint.h>
+#include "fixmath.h"
+#include "fusion/fast_normalize.h"
+#include "fusion/fast_trig.h"
+
+#if (FAST_TRIG_TABLE_BITS < 4) || (FAST_TRIG_TABLE_BITS > 7)
+#error FAST_TRIG_TABLE_BITS must be in the range 4 to 7.
+#endif
+
+/*!
+* \def FAST_TRIG_HALF_PI Pi/2 in Q16.16
+*/
+#define FAST_TRIG_HALF_PI   (102944)
+
+/*!
+* \def FAST_TRIG_SQRT_HALF The table range sqrt(1/2) in Q16.16
+*/
+#define FAST_TRIG_SQRT_HALF (46341)
+
+/*!
+* \def FAST_TRIG_SQRT_TWO sqrt(2) in Q2.30, maps the table range to [0, 1]
+*/
+#define FAST_TRIG_SQRT_TWO  (1518500250UL)
+
+/*!
+* \brief asin(i / 2^FAST_TRIG_TABLE_BITS * sqrt(1/2)) in Q16.16
+*
+* Limiting the table to [0, sqrt(1/2)] keeps the slope of the arcsine below sqrt(2),
+* so linear interpolation stays accurate. Larger arguments are mapped into this range
+* through asin(v) = pi/2 - asin(sqrt(1 - v^2)).
+*/
+#if FAST_TRIG_TABLE_BITS == 4
+static const uint16_t asin_table[17] = {
+    0, 2897, 5800, 8715, 11646, 14602, 17588, 20612,
+    23683, 26808, 30000, 33270, 36634, 40110, 43720, 47494,
+    51472
+};
+#elif FAST_TRIG_TABLE_BITS == 5
+static const uint16_t asin_table[33] = {
+    0, 1448, 2897, 4348, 5800, 7256, 8715, 10178,
+    11646, 13121, 14602, 16091, 17588, 19095, 20612, 22141,
+    23683, 25238, 26808, 28395, 30000, 31624, 33270, 34939,
+    36634, 38356, 40110, 41896, 43720, 45584, 47494, 49455,
+    51472
+};
+#elif FAST_TRIG_TABLE_BITS == 6
+static const uint16_t asin_table[65] = {
+    0, 724, 1448, 2173, 2897, 3622, 4348, 5074,
+    5800, 6527, 7256, 7985, 8715, 9446, 10178, 10912,
+    11646, 12383, 13121, 13861, 14602, 15345, 16091, 16838,
+    17588, 18340, 19095, 19852, 20612, 21375, 22141, 22910,
+    23683, 24458, 25238, 26021, 26808, 27599, 28395, 29195,
+    30000, 30810, 31624, 32444, 33270, 34102, 34939, 35783,
+    36634, 37492, 38356, 39229, 40110, 40998, 41896, 42803,
+    43720, 44647, 45584, 46533, 47494, 48468, 49455, 50456,
+    51472
+};
+#elif FAST_TRIG_TABLE_BITS == 7
+static const uint16_t asin_table[129] = {
+    0, 362, 724, 1086, 1448, 1810, 2173, 2535,
+    2897, 3260, 3622, 3985, 4348, 4711, 5074, 5437,
+    5800, 6164, 6527, 6891, 7256, 7620, 7985, 8349,
+    8715, 9080, 9446, 9812, 10178, 10545, 10912, 11279,
+    11646, 12014, 12383, 12752, 13121, 13491, 13861, 14231,
+    14602, 14974, 15345, 15718, 16091, 16464, 16838, 17213,
+    17588, 17964, 18340, 18717, 19095, 19473, 19852, 20232,
+    20612, 20993, 21375, 21758, 22141, 22525, 22910, 23296,
+    23683, 24070, 24458, 24848, 25238, 25629, 26021, 26414,
+    26808, 27203, 27599, 27997, 28395, 28795, 29195, 29597,
+    30000, 30404, 30810, 31216, 31624, 32034, 32444, 32857,
+    33270, 33685, 34102, 34520, 34939, 35361, 35783, 36208,
+    36634, 37062, 37492, 37923, 38356, 38792, 39229, 39668,
+    40110, 40553, 40998, 41446, 41896, 42348, 42803, 43260,
+    43720, 44182, 44647, 45114, 45584, 46057, 46533, 47012,
+    47494, 47979, 48468, 48959, 49455, 49953, 50456, 50962,
+    51472
+};
+#endif
+
+/*!
+* \brief Interpolates the arcsine table.
+* \param[in] value The sine in the range [0, sqrt(1/2)]
+* \return The angle in radians
+*/
+HOT CONST LEAF
+STATIC_INLINE fix16_t asin_interpolate(register const uint32_t value)
+{
+    // position in the table in Q16.16
+    register const uint32_t position = (uint32_t)(((uint64_t)value * FAST_TRIG_SQRT_TWO) >> (30 - FAST_TRIG_TABLE_BITS));
+
+    register uint_fast8_t index = position >> 16;
+    register int32_t fraction = position & 0xFFFF;
+    if (index >= (1 << FAST_TRIG_TABLE_BITS))
+    {
+        index = (1 << FAST_TRIG_TABLE_BITS) - 1;
+        fraction = 0x10000;
+    }
+
+    register const int32_t lower = asin_table[index];
+    register const int32_t upper = asin_table[index + 1];
+    return lower + (((upper - lower) * fraction + 0x8000) >> 16);
+}
+
+/*!
+* \brief Calculates the integer square root.
+* \param[in] value The value
+* \return The square root rounded to the nearest integer
+*/
+HOT CONST LEAF
+STATIC_INLINE uint32_t isqrt32(register uint32_t value)
+{
+    register uint32_t root = 0;
+    register uint32_t bit = 1UL << 30;
+
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+
+    while (0 != bit)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    // round to nearest
+    return (value > root) ? root + 1 : root;
+}
+
+/*!
+* \brief Calculates the arcsine by interpolating a lookup table.
+* \param[in] value The sine, clamped to [-1, 1]
+* \return The angle in radians
+*/
+fix16_t fix16_asin_fast(register const fix16_t value)
+{
+    register const uint32_t v = (uint32_t)fix16_abs(value);
+    register fix16_t angle;
+
+    if (v <= FAST_TRIG_SQRT_HALF)
+    {
+        angle = asin_interpolate(v);
+    }
+    else if (v >= F16(1))
+    {
+        angle = FAST_TRIG_HALF_PI;
+    }
+    else
+    {
+        // the cosine sqrt(1 - v^2); 1 - v^2 is exact in Q32 and at most 1/2
+        register const uint32_t cosine_square = (uint32_t)(((uint64_t)1 << 32) - (uint64_t)v * v);
+        angle = FAST_TRIG_HALF_PI - asin_interpolate(isqrt32(cosine_square));
+    }
+
+    return (value < 0) ? -angle : angle;
+}
+
+/*!
+* \brief Calculates the four-quadrant arctangent by interpolating a lookup table.
+* \param[in] y The y coordinate
+* \param[in] x The x coordinate
+* \return The angle in radians, 0 if both coordinates are zero
+*/
+fix16_t fix16_atan2_fast(fix16_t y, fix16_t x)
+{
+    // the normalized coordinates are the cosine and sine of the angle
+    if (!fix16_normalize2_fast(&y, &x))
+    {
+        return 0;
+    }
+
+    register const uint32_t ay = (uint32_t)fix16_abs(y);
+    register const uint32_t ax = (uint32_t)fix16_abs(x);
+
+    // first quadrant, using the smaller component for the table lookup
+    register fix16_t angle = (ay <= ax)
+        ? asin_interpolate(ay)
+        : FAST_TRIG_HALF_PI - asin_interpolate(ax);
+
+    if (x < 0)
+    {
+        angle = fix16_pi - angle;
+    }
+
+    return (y < 0) ? -angle : angle;
+}
@@ -0,0 +1,303 @@
+/*
+* fix16_m0plus.c
+*
+* Cortex-M0+ backend of the libfixmath multiplication, division and square root
+*
+* The backend does not replace libfixmath by itself. The KL25Z4 link flags in
+* debug.mak, release.mak and the benchmark_*.mak files pass
+* -Wl,--wrap=fix16_mul, -Wl,--wrap=fix16_div and -Wl,--wrap=fix16_sqrt, which
+* redirect the calls to the __wrap_ aliases at the end of this file. Without
+* those flags the functions below are unused and libfixmath stays in place.
+* The host build wraps the same functions for its operation counters instead.
+*
+*  Created on: Oct 14, 2026
+*      Author: agent
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fixmath.h"
+#include "fusion/fast_normalize.h"
+#include "fusion/fix16_m0plus.h"
+
+#if FIX16_M0PLUS_BACKEND
+#include "cpu/systick.h"
+#endif
+
+#if defined(FIXMATH_NO_OVERFLOW) || defined(FIXMATH_NO_ROUNDING)
+#error The backend implements the default libfixmath configuration with overflow detection and rounding only.
+#endif
+
+/*!
+* \brief Reciprocal seeds in Q0.16 for the normalized divisor range [2^31, 2^32)
+*
+* Entry i covers [1 + i/64, 1 + (i+1)/64) * 2^31 and holds 2^16 over the interval
+* center, which keeps the relative seed error below 0.8%.
+*/
+static const uint16_t reciprocal_seed[64] = {
+    65028, 64035, 63072, 62137, 61230, 60349, 59493, 58661,
+    57852, 57065, 56300, 55554, 54829, 54122, 53433, 52761,
+    52107, 51469, 50846, 50239, 49647, 49068, 48503, 47952,
+    47413, 46886, 46372, 45869, 45377, 44896, 44425, 43965,
+    43514, 43073, 42641, 42218, 41804, 41398, 41000, 40610,
+    40228, 39854, 39486, 39126, 38773, 38426, 38087, 37753,
+    37426, 37105, 36790, 36481, 36177, 35879, 35586, 35298,
+    35016, 34738, 34466, 34198, 33935, 33676, 33422, 33172
+};
+
+/*!
+* \brief Multiplies two Q16.16 values, see fix16_mul
+* \param[in] a The first factor
+* \param[in] b The second factor
+* \return a*b rounded half away from zero, or fix16_overflow
+*/
+fix16_t fix16_mul_m0plus(register const fix16_t a, register const fix16_t b)
+{
+    register const bool negative = (a ^ b) < 0;
+    register const uint32_t ua = (a < 0) ? (0u - (uint32_t)a) : (uint32_t)a;
+    register const uint32_t ub = (b < 0) ? (0u - (uint32_t)b) : (uint32_t)b;
+
+    // both below 1.0; the product fits 32 bits and can not overflow
+    if (0 == ((ua | ub) >> 16))
+    {
+        register const uint32_t result = (ua * ub + 0x8000u) >> 16;
+        return negative ? -(fix16_t)result : (fix16_t)result;
+    }
+
+    register const uint64_t product = fix16_umul32(ua, ub);
+    register const uint32_t high = (uint32_t)(product >> 32);
+    register const uint32_t low = (uint32_t)product;
+
+    // the magnitude may reach 2^47 for negative products only, see fix16_mul
+    if (negative ? ((high > 0x8000u) || ((high == 0x8000u) && (0 != low))) : (high >= 0x8000u))
+    {
+        return fix16_overflow;
+    }
+
+    register const uint32_t rounded = low + 0x8000u;
+    register const uint32_t result = ((high + ((rounded < low) ? 1 : 0)) << 16) | (rounded >> 16);
+    return negative ? (fix16_t)(0u - result) : (fix16_t)result;
+}
+
+/*!
+* \brief Calculates the reciprocal of a normalized divisor
+* \param[in] divisor The divisor in [2^31, 2^32)
+* \return 2^63 / divisor, saturated to 32 bit
+*
+* Every Newton-Raphson step r' = r + r*(2^63 - d*r)/2^63 squares the relative error,
+* so two steps take the seed error to about 2^-28.
+*/
+HOT CONST LEAF
+STATIC_INLINE uint32_t reciprocal_q63(register const uint32_t divisor)
+{
+    register uint32_t r = (uint32_t)reciprocal_seed[(divisor >> 25) & 0x3F] << 16;
+
+    for (uint_fast8_t step = 0; step < 2; ++step)
+    {
+        // the error is small, so that its upper word suffices
+        register const int64_t error = (int64_t)(((uint64_t)1 << 63) - fix16_umul32(divisor, r));
+        register const int32_t error_high = (int32_t)(error >> 32);
+        register const int64_t correction = (error_high < 0)
+            ? -(int64_t)(fix16_umul32(r, (uint32_t)-error_high) >> 31)
+            : (int64_t)(fix16_umul32(r, (uint32_t)error_high) >> 31);
+
+        register const int64_t refined = (int64_t)r + correction;
+        r = (refined > (int64_t)UINT32_MAX) ? UINT32_MAX : (uint32_t)refined;
+    }
+
+    return r;
+}
+
+/*!
+* \brief Divides two Q16.16 values, see fix16_div
+* \param[in] a The dividend
+* \param[in] b The divisor
+* \return a/b rounded half away from zero, fix16_minimum if b is zero or fix16_overflow
+*/
+fix16_t fix16_div_m0plus(register const fix16_t a, register const fix16_t b)
+{
+    if (0 == b)
+    {
+        return fix16_minimum;
+    }
+
+    register const bool negative = (a ^ b) < 0;
+    register const uint32_t dividend = (a < 0) ? (0u - (uint32_t)a) : (uint32_t)a;
+    register const uint32_t divisor = (b < 0) ? (0u - (uint32_t)b) : (uint32_t)b;
+
+    // the doubled quotient dividend*2^17/divisor must fit 32 bit
+    if ((divisor <= 0x10000u) && (dividend >= (divisor << 15)))
+    {
+        return fix16_overflow;
+    }
+
+    // normalize the divisor; the M0+ has no CLZ instruction
+    register uint32_t normalized = divisor;
+    register uint_fast8_t shift = 0;
+    if (0 == (normalized >> 16)) { normalized <<= 16; shift += 16; }
+    if (0 == (normalized >> 24)) { normalized <<= 8;  shift += 8; }
+    if (0 == (normalized >> 28)) { normalized <<= 4;  shift += 4; }
+    if (0 == (normalized >> 30)) { normalized <<= 2;  shift += 2; }
+    if (0 == (normalized >> 31)) { normalized <<= 1;  shift += 1; }
+
+    // dividend*2^17/divisor = dividend*2^(17+shift)/normalized = dividend*r/2^(46-shift)
+    register const uint32_t r = reciprocal_q63(normalized);
+    register const uint64_t estimate = fix16_umul32(dividend, r) >> (46 - shift);
+    register uint32_t quotient = (estimate > UINT32_MAX) ? UINT32_MAX : (uint32_t)estimate;
+
+    // exact floor through the remainder; the estimate is off by a few units at most
+    register int64_t remainder = (int64_t)((uint64_t)dividend << 17) - (int64_t)fix16_umul32(quotient, divisor);
+    while (remainder < 0)
+    {
+        --quotient;
+        remainder += divisor;
+    }
+    while (remainder >= (int64_t)divisor)
+    {
+        ++quotient;
+        remainder -= divisor;
+    }
+
+    // round half up; the doubled quotient of all ones would wrap in libfixmath
+    if (UINT32_MAX == quotient)
+    {
+        return fix16_overflow;
+    }
+
+    register const uint32_t result = (quotient + 1) >> 1;
+    return negative ? (fix16_t)(0u - result) : (fix16_t)result;
+}
+
+/*!
+* \brief Calculates the square root of a Q16.16 value, see fix16_sqrt
+* \param[in] value The value
+* \return sqrt(value) rounded to nearest; negative values yield -sqrt(-value) like libfixmath
+*/
+fix16_t fix16_sqrt_m0plus(register const fix16_t value)
+{
+    register const bool negative = value < 0;
+    register const uint32_t magnitude = negative ? (0u - (uint32_t)value) : (uint32_t)value;
+    if (0 == magnitude)
+    {
+        return 0;
+    }
+
+    // sqrt(magnitude*2^16) = 2^8 * magnitude / sqrt(magnitude) with 1/sqrt(magnitude) = y*2^(h-62)
+    uint_fast8_t half_shift;
+    register const uint32_t y = rsqrt_q30(magnitude, &half_shift);
+    register uint32_t root = (uint32_t)(fix16_umul32(magnitude, y) >> (54 - half_shift));
+
+    // exact floor through the square; the root is below 2^24
+    register const uint64_t square = (uint64_t)magnitude << 16;
+    while (fix16_umul32(root, root) > square)
+    {
+        --root;
+    }
+    while (fix16_umul32(root + 1, root + 1) <= square)
+    {
+        ++root;
+    }
+
+    // round up if square - root^2 > root, i.e. square > (root + 1/2)^2
+    if ((square - fix16_umul32(root, root)) > root)
+    {
+        ++root;
+    }
+
+    return negative ? -(fix16_t)root : (fix16_t)root;
+}
+
+#if FIX16_M0PLUS_BACKEND
+
+/************************************************************************/
+/* libfixmath replacement                                               */
+/************************************************************************/
+
+/* effective only with the -Wl,--wrap link flags, see the file header */
+fix16_t __wrap_fix16_mul(fix16_t a, fix16_t b) __attribute__((alias("fix16_mul_m0plus")));
+fix16_t __wrap_fix16_div(fix16_t a, fix16_t b) __attribute__((alias("fix16_div_m0plus")));
+fix16_t __wrap_fix16_sqrt(fix16_t value) __attribute__((alias("fix16_sqrt_m0plus")));
+
+fix16_t __real_fix16_mul(fix16_t a, fix16_t b);
+fix16_t __real_fix16_div(fix16_t a, fix16_t b);
+fix16_t __real_fix16_sqrt(fix16_t value);
+
+/************************************************************************/
+/* Benchmark                                                            */
+/************************************************************************/
+
+/*!
+* \def FIX16_BENCHMARK_OPERANDS Number of distinct operand pairs, cycled through by the benchmark
+*/
+#define FIX16_BENCHMARK_OPERANDS    (32)
+
+/*!
+* \brief Fills the operands with pseudo-random values of the magnitudes seen by the fusion engine
+* \param[out] a The first operands in [-128, 128)
+* \param[out] b The second operands in (0, 32), never zero
+*/
+COLD NONNULL
+static void fix16_benchmark_operands(fix16_t a[FIX16_BENCHMARK_OPERANDS], fix16_t b[FIX16_BENCHMARK_OPERANDS])
+{
+    uint32_t state = 0x2545F491u;
+    for (uint_fast8_t i = 0; i < FIX16_BENCHMARK_OPERANDS; ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        a[i] = (fix16_t)state >> 8;
+
+        state = state * 1664525u + 1013904223u;
+        b[i] = (fix16_t)((state >> 11) | 1u);
+    }
+}
+
+/*!
+* \brief Times the backend against libfixmath on the same operands
+* \param[out] results The timings, indexed by {\ref fix16_benchmark_kernel_t}
+*/
+void fix16_m0plus_benchmark(fix16_benchmark_t results[FIX16_BENCHMARK_COUNT])
+{
+    fix16_t a[FIX16_BENCHMARK_OPERANDS];
+    fix16_t b[FIX16_BENCHMARK_OPERANDS];
+    fix16_benchmark_operands(a, b);
+
+    // the results are folded into a sink, so that no call is dropped
+    volatile fix16_t sink = 0;
+    fix16_t folded;
+    uint32_t start;
+
+#define FIX16_BENCHMARK_TIME(target, expression) \
+    folded = 0; \
+    start = SysTick_Microseconds(); \
+    for (uint_fast16_t n = 0; n < FIX16_BENCHMARK_ITERATIONS; ++n) \
+    { \
+        const uint_fast8_t i = n & (FIX16_BENCHMARK_OPERANDS - 1); \
+        folded ^= (expression); \
+    } \
+    (target) = SysTick_Microseconds() - start; \
+    sink = folded
+
+    FIX16_BENCHMARK_TIME(results[FIX16_BENCHMARK_MUL].reference, __real_fix16_mul(a[i], b[i]));
+    FIX16_BENCHMARK_TIME(results[FIX16_BENCHMARK_MUL].backend, fix16_mul_m0plus(a[i], b[i]));
+    FIX16_BENCHMARK_TIME(results[FIX16_BENCHMARK_DIV].reference, __real_fix16_div(a[i], b[i]));
+    FIX16_BENCHMARK_TIME(results[FIX16_BENCHMARK_DIV].backend, fix16_div_m0plus(a[i], b[i]));
+    FIX16_BENCHMARK_TIME(results[FIX16_BENCHMARK_SQRT].reference, __real_fix16_sqrt(b[i]));
+    FIX16_BENCHMARK_TIME(results[FIX16_BENCHMARK_SQRT].backend, fix16_sqrt_m0plus(b[i]));
+
+#undef FIX16_BENCHMARK_TIME
+
+    // bit exactness on the same operands
+    for (uint_fast8_t k = 0; k < FIX16_BENCHMARK_COUNT; ++k)
+    {
+        results[k].mismatches = 0;
+    }
+    for (uint_fast8_t i = 0; i < FIX16_BENCHMARK_OPERANDS; ++i)
+    {
+        results[FIX16_BENCHMARK_MUL].mismatches += (__real_fix16_mul(a[i], b[i]) != fix16_mul_m0plus(a[i], b[i])) ? 1 : 0;
+        results[FIX16_BENCHMARK_DIV].mismatches += (__real_fix16_div(a[i], b[i]) != fix16_div_m0plus(a[i], b[i])) ? 1 : 0;
+        results[FIX16_BENCHMARK_SQRT].mismatches += (__real_fix16_sqrt(a[i]) != fix16_sqrt_m0plus(a[i])) ? 1 : 0;
+    }
+
+    (void)sink;
+}
+
+#endif
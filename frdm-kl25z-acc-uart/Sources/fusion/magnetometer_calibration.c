@@ -0,0 +1,597 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "fixmath.h"
+#include "fusion/magnetometer_calibration.h"
+
+/*!
+* \brief The number of ellipsoid parameters
+*
+* The fit solves a*x^2 + b*y^2 + c*z^2 + 2d*xy + 2e*xz + 2f*yz + 2g*x + 2h*y + 2i*z = 1
+* for theta = [a b c d e f g h i] by recursive least squares.
+*/
+#define ELLIPSOID_PARAMETERS            (9)
+
+/*!
+* \brief The number of stored covariance entries, i.e. the upper triangle including the diagonal
+*/
+#define ELLIPSOID_COVARIANCE_ENTRIES    (ELLIPSOID_PARAMETERS * (ELLIPSOID_PARAMETERS + 1) / 2)
+
+/*!
+* \brief The fraction bits of the covariance beyond Q16
+*
+* The converged covariance is in the order of 2^-12, where Q16 rounding of the
+* rank one downdates would make it indefinite within a few hundred samples.
+*/
+#define ELLIPSOID_COVARIANCE_SHIFT      (8)
+
+/*!
+* \brief The initial parameter covariance, in Q(16+ELLIPSOID_COVARIANCE_SHIFT)
+*/
+#define ELLIPSOID_INITIAL_COVARIANCE    (F16(16) << ELLIPSOID_COVARIANCE_SHIFT)
+
+/*!
+* \brief The covariance diagonal above which the forgetting stops, bounding the windup of unexcited directions
+*/
+#define ELLIPSOID_COVARIANCE_LIMIT      (F16(64) << ELLIPSOID_COVARIANCE_SHIFT)
+
+/*!
+* \brief The covariance diagonal below which the fit may converge
+*/
+#define ELLIPSOID_CONVERGED_COVARIANCE  (F16(0.25) << ELLIPSOID_COVARIANCE_SHIFT)
+
+/*!
+* \brief The mean squared residual below which the fit may converge
+*/
+#define ELLIPSOID_CONVERGED_RESIDUAL    F16(1.0/1024)
+
+/*!
+* \brief The forgetting factor as power of two; lambda = 1 - 2^-ELLIPSOID_FORGETTING_SHIFT, i.e. a memory of 256 samples
+*/
+#define ELLIPSOID_FORGETTING_SHIFT      (8)
+
+/*!
+* \brief The number of accepted samples locating the reference point before the fit starts
+*
+* The fit is relative to the center of their bounding box; with an offset in the order of
+* the field magnitude the origin is close to the ellipsoid and the normalization to 1 is
+* ill-conditioned.
+*/
+#define ELLIPSOID_REFERENCE_SAMPLES     (64)
+
+/*!
+* \brief The minimum number of fitted samples before the fit may converge
+*/
+#define ELLIPSOID_MINIMUM_SAMPLES       (256)
+
+/*!
+* \brief The squared minimum separation of accepted samples relative to the squared field magnitude, about 7 degree
+*/
+#define ELLIPSOID_SEPARATION_SHIFT      (6)
+
+/*!
+* \brief The deviation from the identity below which a correction is considered noise
+*
+* Prevents the repeated refits from random walking the calibration in use.
+*/
+#define ELLIPSOID_SIGNIFICANT_CORRECTION F16(1.0/128)
+
+/*!
+* \brief The steps of an update, each run by one call of {\ref magnetometer_calibration_update}
+*
+* The covariance product and the covariance update are sliced by row, so that a call
+* costs at most eleven 64 bit multiplications. Samples arriving during an update are dropped.
+*/
+typedef enum {
+    ELLIPSOID_STEP_ACCEPT = 0,                                          /*!< Waits for a sample */
+    ELLIPSOID_STEP_PRODUCT = 1,                                         /*!< Row i of u = P*phi at ELLIPSOID_STEP_PRODUCT + i */
+    ELLIPSOID_STEP_GAIN = ELLIPSOID_STEP_PRODUCT + ELLIPSOID_PARAMETERS, /*!< The reciprocal of s = 1 + phi'*u */
+    ELLIPSOID_STEP_UPDATE = ELLIPSOID_STEP_GAIN + 1,                    /*!< Row i of the covariance update at ELLIPSOID_STEP_UPDATE + i */
+} ellipsoid_step_t;
+
+/*!
+* \brief The index of the first entry of each row of the packed covariance
+*/
+static const uint8_t row_start[ELLIPSOID_PARAMETERS] = { 0, 9, 17, 24, 30, 35, 39, 42, 44 };
+
+/*!
+* \brief The parameter estimate
+*/
+static fix16_t theta[ELLIPSOID_PARAMETERS];
+
+/*!
+* \brief The upper triangle of the symmetric parameter covariance in Q(16+ELLIPSOID_COVARIANCE_SHIFT), packed row by row
+*/
+static int32_t covariance[ELLIPSOID_COVARIANCE_ENTRIES];
+
+/*!
+* \brief Exponentially weighted mean of the squared a priori residual
+*/
+static fix16_t residual;
+
+/*!
+* \brief The next step of the update in progress
+*/
+static uint_fast8_t step;
+
+/*!
+* \brief The regressor of the update in progress
+*/
+static fix16_t phi[ELLIPSOID_PARAMETERS];
+
+/*!
+* \brief The covariance product u = P*phi of the update in progress
+*/
+static fix16_t u[ELLIPSOID_PARAMETERS];
+
+/*!
+* \brief The accumulators of s = 1 + phi'*u and of the a priori residual e = 1 - phi'*theta, in Q32
+*/
+static int64_t s_sum, e_sum;
+
+/*!
+* \brief The a priori residual of the update in progress
+*/
+static fix16_t error;
+
+/*!
+* \brief The reciprocal of s in Q30
+*/
+static int64_t inverse;
+
+/*!
+* \brief Indicates that the update in progress applies the forgetting factor
+*/
+static bool forget;
+
+/*!
+* \brief The last accepted sample
+*/
+static v3d last_sample;
+
+/*!
+* \brief The number of accepted samples, saturating
+*/
+static uint_fast16_t accepted;
+
+/*!
+* \brief The power of two scaling the samples to a magnitude in [1, 2), fixed by the first sample
+*
+* Keeps the regressor well scaled regardless of the calibration's field magnitude.
+*/
+static int_fast8_t scale_shift;
+
+/*!
+* \brief Indicates that {\ref scale_shift} has been determined
+*/
+static bool scaled;
+
+/*!
+* \brief Bounding box of the accepted samples in scaled units, for the coverage check
+*/
+static v3d lower, upper;
+
+/*!
+* \brief The reference point of the fit in scaled units, see {\ref ELLIPSOID_REFERENCE_SAMPLES}
+*/
+static v3d reference;
+
+/*!
+* \brief Converts a Q32 accumulator to Q16 with rounding and saturation
+* \param[in] value The accumulator
+* \return The Q16 value
+*/
+CONST
+STATIC_INLINE fix16_t from_q32(register const int64_t value)
+{
+    register const int64_t result = (value + 0x8000) >> 16;
+    if (result > fix16_maximum) return fix16_maximum;
+    if (result < -fix16_maximum) return -fix16_maximum;
+    return (fix16_t)result;
+}
+
+/*!
+* \brief Resets the ellipsoid fit
+*/
+void magnetometer_calibration_initialize()
+{
+    int32_t *entry = covariance;
+    for (uint_fast8_t i = 0; i < ELLIPSOID_PARAMETERS; ++i)
+    {
+        theta[i] = 0;
+        for (uint_fast8_t j = i; j < ELLIPSOID_PARAMETERS; ++j)
+        {
+            *entry++ = (i == j) ? ELLIPSOID_INITIAL_COVARIANCE : 0;
+        }
+    }
+
+    residual = fix16_one;
+    last_sample.x = last_sample.y = last_sample.z = 0;
+    reference.x = reference.y = reference.z = 0;
+    lower.x = lower.y = lower.z = fix16_maximum;
+    upper.x = upper.y = upper.z = -fix16_maximum;
+    accepted = 0;
+    scaled = false;
+    step = ELLIPSOID_STEP_ACCEPT;
+}
+
+/*!
+* \brief Scales a value by a power of two
+* \param[in] value The value
+* \param[in] shift The power of two, may be negative
+* \return The scaled value
+*/
+CONST
+STATIC_INLINE fix16_t scale_by(register const fix16_t value, register const int_fast8_t shift)
+{
+    return (shift >= 0) ? (value << shift) : (value >> -shift);
+}
+
+/*!
+* \brief Accepts a sample for the next update if it is sufficiently far from the last accepted one
+* \param[in] sample The sample
+* \return true if an update was started
+*/
+STATIC_INLINE bool accept(register const v3d *const sample)
+{
+    if (!scaled)
+    {
+        // magnitude in [1, 2) after scaling; at most 2^11 keeps the scaled squares in range
+        register const int64_t square = (int64_t)sample->x*sample->x + (int64_t)sample->y*sample->y + (int64_t)sample->z*sample->z;
+        if (0 == square) return false;
+
+        int64_t scaled_square = square;
+        int_fast8_t shift = 0;
+        while ((shift < 11) && (scaled_square < ((int64_t)1 << 32))) { scaled_square <<= 2; ++shift; }
+        while (scaled_square >= ((int64_t)1 << 34)) { scaled_square >>= 2; --shift; }
+        scale_shift = shift;
+        scaled = true;
+    }
+
+    register const fix16_t x = scale_by(sample->x, scale_shift), y = scale_by(sample->y, scale_shift), z = scale_by(sample->z, scale_shift);
+
+    // only accept samples that are sufficiently far from the last accepted one
+    register const fix16_t dx = x - last_sample.x, dy = y - last_sample.y, dz = z - last_sample.z;
+    register const int64_t distance = (int64_t)dx*dx + (int64_t)dy*dy + (int64_t)dz*dz;
+    register const int64_t magnitude = (int64_t)x*x + (int64_t)y*y + (int64_t)z*z;
+    if (distance < (magnitude >> ELLIPSOID_SEPARATION_SHIFT))
+    {
+        return false;
+    }
+    last_sample.x = x;
+    last_sample.y = y;
+    last_sample.z = z;
+
+    if (x < lower.x) lower.x = x;
+    if (y < lower.y) lower.y = y;
+    if (z < lower.z) lower.z = z;
+    if (x > upper.x) upper.x = x;
+    if (y > upper.y) upper.y = y;
+    if (z > upper.z) upper.z = z;
+
+    if (accepted < ELLIPSOID_REFERENCE_SAMPLES)
+    {
+        if (++accepted == ELLIPSOID_REFERENCE_SAMPLES)
+        {
+            reference.x = lower.x + ((upper.x - lower.x) >> 1);
+            reference.y = lower.y + ((upper.y - lower.y) >> 1);
+            reference.z = lower.z + ((upper.z - lower.z) >> 1);
+        }
+        return false;
+    }
+
+    // regressor relative to the reference point
+    register const fix16_t rx = x - reference.x, ry = y - reference.y, rz = z - reference.z;
+    phi[0] = fix16_mul(rx, rx);
+    phi[1] = fix16_mul(ry, ry);
+    phi[2] = fix16_mul(rz, rz);
+    phi[3] = fix16_mul(rx, ry) << 1;
+    phi[4] = fix16_mul(rx, rz) << 1;
+    phi[5] = fix16_mul(ry, rz) << 1;
+    phi[6] = rx << 1;
+    phi[7] = ry << 1;
+    phi[8] = rz << 1;
+
+    s_sum = (int64_t)fix16_one << 16;
+    e_sum = (int64_t)fix16_one << 16;
+
+    // forgetting stops while any diagonal exceeds its limit
+    forget = true;
+    return true;
+}
+
+/*!
+* \brief Calculates row i of u = P*phi and its terms of s and e
+* \param[in] i The row
+*/
+STATIC_INLINE void product_row(register const uint_fast8_t i)
+{
+    // the row runs down column i of the upper triangle up to the diagonal, then along row i
+    int64_t sum = 0;
+    for (uint_fast8_t j = 0; j < i; ++j)
+    {
+        sum += (int64_t)covariance[row_start[j] + i - j] * phi[j];
+    }
+
+    register const int32_t *entry = &covariance[row_start[i]];
+    if (*entry > ELLIPSOID_COVARIANCE_LIMIT)
+    {
+        forget = false;
+    }
+    for (uint_fast8_t j = i; j < ELLIPSOID_PARAMETERS; ++j)
+    {
+        sum += (int64_t)*entry++ * phi[j];
+    }
+
+    u[i] = from_q32(sum >> ELLIPSOID_COVARIANCE_SHIFT);
+    s_sum += (int64_t)phi[i] * u[i];
+    e_sum -= (int64_t)phi[i] * theta[i];
+}
+
+/*!
+* \brief Updates theta(i) and row i of the covariance, P = (P - u*u'/s) / lambda in place on the upper triangle
+* \param[in] i The row
+*/
+STATIC_INLINE void update_row(register const uint_fast8_t i)
+{
+    // gain in Q(16+ELLIPSOID_COVARIANCE_SHIFT), bounded by the covariance
+    register const int32_t gain = (int32_t)(((int64_t)u[i] * inverse + ((int64_t)1 << (29 - ELLIPSOID_COVARIANCE_SHIFT))) >> (30 - ELLIPSOID_COVARIANCE_SHIFT));
+    theta[i] = fix16_sadd(theta[i], from_q32(((int64_t)gain * error) >> ELLIPSOID_COVARIANCE_SHIFT));
+
+    register int32_t *target = &covariance[row_start[i]];
+    for (uint_fast8_t j = i; j < ELLIPSOID_PARAMETERS; ++j)
+    {
+        register const int32_t value = *target - (int32_t)(((int64_t)gain * u[j] + 0x8000) >> 16);
+        *target++ = forget ? (value + (value >> ELLIPSOID_FORGETTING_SHIFT)) : value;
+    }
+}
+
+/*!
+* \brief Determines if the fit converged after an update
+* \return true if the fit converged
+*/
+STATIC_INLINE bool converged()
+{
+    // exponentially weighted residual with a memory of 32 samples
+    residual += (fix16_mul(error, error) - residual) >> 5;
+
+    if (accepted < ELLIPSOID_REFERENCE_SAMPLES + ELLIPSOID_MINIMUM_SAMPLES)
+    {
+        ++accepted;
+        return false;
+    }
+
+    if (residual > ELLIPSOID_CONVERGED_RESIDUAL)
+    {
+        return false;
+    }
+
+    for (uint_fast8_t i = 0; i < ELLIPSOID_PARAMETERS; ++i)
+    {
+        if (covariance[row_start[i]] > ELLIPSOID_CONVERGED_COVARIANCE)
+        {
+            return false;
+        }
+    }
+
+    // every axis must be covered by at least half the extent of the best covered one
+    register const fix16_t span_x = upper.x - lower.x, span_y = upper.y - lower.y, span_z = upper.z - lower.z;
+    register const fix16_t span = (span_x > span_y) ? ((span_x > span_z) ? span_x : span_z) : ((span_y > span_z) ? span_y : span_z);
+    return (span_x >= (span >> 1)) && (span_y >= (span >> 1)) && (span_z >= (span >> 1));
+}
+
+/*!
+* \brief Feeds a calibrated magnetometer sample into the ellipsoid fit and advances the update in progress
+* \param[in] sample The sample as prepared by {\ref sensor_prepare_hmc5883l_data}, or NULL to only advance the update
+* \return true if the fit converged and a correction is available through {\ref magnetometer_calibration_fetch}
+*
+* An accepted sample costs about 160 64 bit multiplications, 81 of them for P*phi and 45 for the
+* rank one update of the packed covariance. Without a long multiply on the M0+ that is a few
+* thousand cycles, so the update is spread over 20 calls, see {\ref ellipsoid_step_t}: one accepts
+* the sample, nine compute a row of P*phi with at most eleven multiplications, one the reciprocal
+* of s by a single 64 bit division, and nine update a row of the covariance with at most eleven
+* multiplications. The fit does not change; it only accepts a new sample every 20 calls at most.
+*/
+bool magnetometer_calibration_update(register const v3d *const sample)
+{
+    if (ELLIPSOID_STEP_ACCEPT == step)
+    {
+        if ((NULL != sample) && accept(sample))
+        {
+            step = ELLIPSOID_STEP_PRODUCT;
+        }
+        return false;
+    }
+
+    if (step < ELLIPSOID_STEP_GAIN)
+    {
+        product_row(step - ELLIPSOID_STEP_PRODUCT);
+        ++step;
+        return false;
+    }
+
+    if (ELLIPSOID_STEP_GAIN == step)
+    {
+        // the gain u/s is applied through its reciprocal in Q30, i.e. a single division; s is at least one
+        error = from_q32(e_sum);
+        register const fix16_t denominator = from_q32(s_sum);
+        inverse = ((int64_t)1 << 46) / ((denominator > fix16_one) ? denominator : fix16_one);
+        ++step;
+        return false;
+    }
+
+    register const uint_fast8_t row = step - ELLIPSOID_STEP_UPDATE;
+    update_row(row);
+    if (row < ELLIPSOID_PARAMETERS - 1)
+    {
+        ++step;
+        return false;
+    }
+
+    step = ELLIPSOID_STEP_ACCEPT;
+    return converged();
+}
+
+/*!
+* \brief Calculates the determinant of a 3x3 matrix
+* \param[in] m The matrix
+* \return The determinant
+*/
+PURE NONNULL
+static fix16_t determinant3(const fix16_t m[static 3][3])
+{
+    register const int64_t c0 = (int64_t)m[1][1]*m[2][2] - (int64_t)m[1][2]*m[2][1];
+    register const int64_t c1 = (int64_t)m[1][2]*m[2][0] - (int64_t)m[1][0]*m[2][2];
+    register const int64_t c2 = (int64_t)m[1][0]*m[2][1] - (int64_t)m[1][1]*m[2][0];
+    return from_q32((int64_t)m[0][0] * from_q32(c0) + (int64_t)m[0][1] * from_q32(c1) + (int64_t)m[0][2] * from_q32(c2));
+}
+
+/*!
+* \brief Inverts a 3x3 matrix by its adjugate
+* \param[out] inverse The inverse
+* \param[in] m The matrix
+* \return false if the matrix is singular
+*/
+NONNULL
+static bool invert3(fix16_t inverse[static 3][3], const fix16_t m[static 3][3])
+{
+    register const fix16_t det = determinant3(m);
+    if (0 == det)
+    {
+        return false;
+    }
+
+    register const fix16_t scale = fix16_div(fix16_one, det);
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        for (uint_fast8_t j = 0; j < 3; ++j)
+        {
+            // cofactor of m(j, i)
+            const uint_fast8_t r0 = (j + 1) % 3, r1 = (j + 2) % 3;
+            const uint_fast8_t c0 = (i + 1) % 3, c1 = (i + 2) % 3;
+            register const fix16_t cofactor = from_q32((int64_t)m[r0][c0]*m[r1][c1] - (int64_t)m[r0][c1]*m[r1][c0]);
+            inverse[i][j] = fix16_mul(cofactor, scale);
+        }
+    }
+    return true;
+}
+
+/*!
+* \brief Calculates the cube root of a positive value by Newton's method
+* \param[in] value The value
+* \return The cube root
+*/
+CONST
+static fix16_t cube_root(register const fix16_t value)
+{
+    register fix16_t y = (value > fix16_one) ? value : fix16_one;
+    for (uint_fast8_t step = 0; step < 24; ++step)
+    {
+        y = fix16_div(fix16_add(y << 1, fix16_div(value, fix16_mul(y, y))), F16(3));
+    }
+    return y;
+}
+
+/*!
+* \brief Retrieves the correction of the converged fit and restarts the fit
+* \param[out] correction The affine correction mapping the current calibrated data onto a sphere
+* \return false if the fit does not describe a valid ellipsoid or the correction is within the
+*         noise of the current calibration; the fit is restarted regardless
+*/
+bool magnetometer_calibration_fetch(calibration_matrix_t *const correction)
+{
+    const fix16_t A[3][3] = {
+        { theta[0], theta[3], theta[4] },
+        { theta[3], theta[1], theta[5] },
+        { theta[4], theta[5], theta[2] }
+    };
+    const fix16_t g[3] = { theta[6], theta[7], theta[8] };
+    const fix16_t origin[3] = { reference.x, reference.y, reference.z };
+    const int_fast8_t shift = scale_shift;
+    magnetometer_calibration_initialize();
+
+    // an ellipsoid requires A to be positive definite
+    if ((A[0][0] <= 0)
+        || (from_q32((int64_t)A[0][0]*A[1][1] - (int64_t)A[0][1]*A[1][0]) <= 0)
+        || (determinant3(A) <= 0))
+    {
+        return false;
+    }
+
+    // center c = -A^-1 * g relative to the reference point and the right hand side k = 1 + c'*A*c = 1 - g'*c
+    fix16_t Ainv[3][3];
+    if (!invert3(Ainv, A))
+    {
+        return false;
+    }
+
+    fix16_t center[3];
+    int64_t k = (int64_t)fix16_one << 16;
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        center[i] = -from_q32((int64_t)Ainv[i][0]*g[0] + (int64_t)Ainv[i][1]*g[1] + (int64_t)Ainv[i][2]*g[2]);
+        k -= (int64_t)g[i] * center[i];
+    }
+    if (k <= 0)
+    {
+        return false;
+    }
+
+    // W = sqrtm(A/k) by the Denman-Beavers iteration, Y -> sqrtm(M) and Z -> inv(sqrtm(M))
+    register const fix16_t inverse_k = fix16_div(fix16_one, from_q32(k));
+    fix16_t Y[3][3], Z[3][3];
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        for (uint_fast8_t j = 0; j < 3; ++j)
+        {
+            Y[i][j] = fix16_mul(A[i][j], inverse_k);
+            Z[i][j] = (i == j) ? fix16_one : 0;
+        }
+    }
+
+    for (uint_fast8_t step = 0; step < 8; ++step)
+    {
+        fix16_t Yinv[3][3], Zinv[3][3];
+        if (!invert3(Yinv, Y) || !invert3(Zinv, Z))
+        {
+            return false;
+        }
+
+        for (uint_fast8_t i = 0; i < 3; ++i)
+        {
+            for (uint_fast8_t j = 0; j < 3; ++j)
+            {
+                Y[i][j] = (Y[i][j] + Zinv[i][j]) >> 1;
+                Z[i][j] = (Z[i][j] + Yinv[i][j]) >> 1;
+            }
+        }
+    }
+
+    // keep the geometric mean radius, i.e. divide by det(W)^(1/3)
+    register const fix16_t det = determinant3(Y);
+    if (det <= 0)
+    {
+        return false;
+    }
+    register const fix16_t radius = fix16_div(fix16_one, cube_root(det));
+
+    // correction(m) = radius * W * (m - c); the offset is relative to the scaled magnitude of about one
+    bool significant = false;
+    for (uint_fast8_t i = 0; i < 3; ++i)
+    {
+        int64_t offset = 0;
+        for (uint_fast8_t j = 0; j < 3; ++j)
+        {
+            register const fix16_t value = fix16_mul(Y[i][j], radius);
+            (*correction)[i][j] = value;
+            offset -= (int64_t)value * (center[j] + origin[j]);
+
+            significant |= fix16_abs(value - ((i == j) ? fix16_one : 0)) > ELLIPSOID_SIGNIFICANT_CORRECTION;
+        }
+
+        register const fix16_t scaled_offset = from_q32(offset);
+        (*correction)[i][3] = scale_by(scaled_offset, -shift);
+        significant |= fix16_abs(scaled_offset) > ELLIPSOID_SIGNIFICANT_CORRECTION;
+    }
+
+    return significant;
+}
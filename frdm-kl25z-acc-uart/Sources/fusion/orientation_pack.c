@@ -0,0 +1,89 @@
+/*
+ * orientation_pack.c
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include "fixmath.h"
+#include "fusion/orientation_pack.h"
+
+/*!
+* \brief Converts a Q16.16 value to a saturated Q(16-shift).shift
+* \param[in] value The value to convert
+* \param[in] shift The number of bits to shift right, i.e. 16 minus the number of fractional bits
+* \return The rounded and saturated value
+*/
+STATIC_INLINE int16_t fix16_to_q(register const fix16_t value, register const uint_fast8_t shift)
+{
+    register const int32_t rounded = (value + (1 << (shift - 1))) >> shift;
+    if (rounded > INT16_MAX) return INT16_MAX;
+    if (rounded < -INT16_MAX) return -INT16_MAX;
+    return (int16_t)rounded;
+}
+
+/*!
+* \brief Packs a unit quaternion into four signed Q1.14 values.
+* \param[out] packed The packed components a, b, c, d
+* \param[in] quat The unit quaternion
+*/
+void orientation_pack_q14(int16_t packed[4], const qf16 *const quat)
+{
+    packed[0] = fix16_to_q(quat->a, 2);
+    packed[1] = fix16_to_q(quat->b, 2);
+    packed[2] = fix16_to_q(quat->c, 2);
+    packed[3] = fix16_to_q(quat->d, 2);
+}
+
+/*!
+* \brief Packs angles in radians into signed Q2.13 values.
+* \param[out] packed The packed roll, pitch, yaw angles
+* \param[in] roll The roll angle in radians
+* \param[in] pitch The pitch angle in radians
+* \param[in] yaw The yaw angle in radians
+*/
+void orientation_pack_angles_q13(int16_t packed[3], fix16_t roll, fix16_t pitch, fix16_t yaw)
+{
+    packed[0] = fix16_to_q(roll, 3);
+    packed[1] = fix16_to_q(pitch, 3);
+    packed[2] = fix16_to_q(yaw, 3);
+}
+
+/*!
+* \brief Packs a unit quaternion using the smallest-three encoding.
+* \param[out] packed The packed components
+* \param[in] quat The unit quaternion
+*/
+void orientation_pack_smallest_three(int16_t packed[3], const qf16 *const quat)
+{
+    const fix16_t components[4] = { quat->a, quat->b, quat->c, quat->d };
+
+    // find the largest component
+    uint_fast8_t largest = 0;
+    fix16_t largest_abs = fix16_abs(components[0]);
+    for (uint_fast8_t i = 1; i < 4; ++i)
+    {
+        const fix16_t value = fix16_abs(components[i]);
+        if (value > largest_abs)
+        {
+            largest_abs = value;
+            largest = i;
+        }
+    }
+
+    // q and -q are the same rotation, so make the dropped component positive
+    const fix16_t sign = (components[largest] < 0) ? -fix16_one : fix16_one;
+    const fix16_t scale = fix16_mul(sign, F16(1.41421356));
+
+    // scale the remaining components from [-1/sqrt(2), 1/sqrt(2)] to Q1.15
+    uint_fast8_t j = 0;
+    for (uint_fast8_t i = 0; i < 4; ++i)
+    {
+        if (i == largest) continue;
+        packed[j++] = fix16_to_q(fix16_mul(components[i], scale), 1);
+    }
+
+    // store the index in the least significant bits
+    packed[0] = (int16_t)((packed[0] & ~1) | (largest & 1));
+    packed[1] = (int16_t)((packed[1] & ~1) | ((largest >> 1) & 1));
+}
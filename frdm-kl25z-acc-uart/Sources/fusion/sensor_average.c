@@ -0,0 +1,91 @@
+#include <stdint.h>
+#include "fixmath.h"
+#include "fusion/sensor_average.h"
+
+/*!
+* \brief The latest prepared sample per quantity and replica; index zero is unused
+*/
+static v3d latest_sample[SENSOR_AVERAGE_QUANTITY_COUNT][SENSOR_AVERAGE_MAX_REPLICAS];
+
+/*!
+* \brief The capture time of the latest sample per quantity and replica in microseconds
+*/
+static uint32_t latest_time[SENSOR_AVERAGE_QUANTITY_COUNT][SENSOR_AVERAGE_MAX_REPLICAS];
+
+/*!
+* \brief The replicas per quantity that delivered a sample, one bit per replica
+*/
+static uint8_t latest_valid[SENSOR_AVERAGE_QUANTITY_COUNT];
+
+/*!
+* \brief The reciprocals of the sample counts, indexed by count - 1
+*/
+static const fix16_t reciprocals[SENSOR_AVERAGE_MAX_REPLICAS] = { F16(1), F16(1.0/2), F16(1.0/3), F16(1.0/4) };
+
+/*!
+* \brief Forgets all replica samples
+*/
+void sensor_average_initialize()
+{
+    for (uint_fast8_t quantity = 0; quantity < SENSOR_AVERAGE_QUANTITY_COUNT; ++quantity)
+    {
+        latest_valid[quantity] = 0;
+    }
+}
+
+/*!
+* \brief Keeps the prepared sample of a replica until the primary sensor delivers
+* \param[in] quantity The quantity measured
+* \param[in] replica The replica in 1 .. {\ref SENSOR_AVERAGE_MAX_REPLICAS}-1
+* \param[in] timestamp The capture time of the sample in microseconds
+* \param[in] sample The prepared sample in the primary's frame
+*/
+void sensor_average_record(const sensor_average_quantity_t quantity, const uint8_t replica, const uint32_t timestamp, register const v3d *const sample)
+{
+    if ((0 == replica) || (replica >= SENSOR_AVERAGE_MAX_REPLICAS)) return;
+
+    latest_sample[quantity][replica] = *sample;
+    latest_time[quantity][replica] = timestamp;
+    latest_valid[quantity] |= (uint8_t)(1u << replica);
+}
+
+/*!
+* \brief Averages a prepared sample of the primary sensor with the latest replica samples
+* \param[in] quantity The quantity measured
+* \param[in] timestamp The capture time of the sample in microseconds
+* \param[in] sample The prepared sample
+* \param[out] averaged The mean of the sample and all live replica samples; may alias sample
+*/
+void sensor_average(const sensor_average_quantity_t quantity, const uint32_t timestamp, register const v3d *const sample, register v3d *const averaged)
+{
+    const uint8_t valid = latest_valid[quantity];
+    if (0 == valid)
+    {
+        *averaged = *sample;
+        return;
+    }
+
+    // the replicas deviate little from the primary, so the deviations are summed instead of the samples
+    int32_t dx = 0, dy = 0, dz = 0;
+    uint_fast8_t count = 1;
+
+    for (uint_fast8_t replica = 1; replica < SENSOR_AVERAGE_MAX_REPLICAS; ++replica)
+    {
+        if (0 == (valid & (1u << replica))) continue;
+
+        // the replica may have been captured just after the primary
+        const int32_t age = (int32_t)(timestamp - latest_time[quantity][replica]);
+        if ((age > SENSOR_AVERAGE_MAX_AGE_US) || (age < -SENSOR_AVERAGE_MAX_AGE_US)) continue;
+
+        register const v3d *const other = &latest_sample[quantity][replica];
+        dx += other->x - sample->x;
+        dy += other->y - sample->y;
+        dz += other->z - sample->z;
+        ++count;
+    }
+
+    const fix16_t reciprocal = reciprocals[count - 1];
+    averaged->x = fix16_add(sample->x, fix16_mul(dx, reciprocal));
+    averaged->y = fix16_add(sample->y, fix16_mul(dy, reciprocal));
+    averaged->z = fix16_add(sample->z, fix16_mul(dz, reciprocal));
+}
@@ -3,81 +3,13 @@
 #include "compiler.h"
 #include "fixmatrix.h"
 #include "fixarray.h"
+#include "fusion/sensor_calibration.h"
+#include "parameters.h"
 
 #if !defined(FIXMATRIX_MAX_SIZE) || (FIXMATRIX_MAX_SIZE < 4)
 #error FIXMATRIX_MAX_SIZE must be defined to value greater or equal 4.
 #endif
 
-#ifdef __GNUC__
-#define STORE_IN_ROM __attribute__((section("ROM")))
-#else
-#define STORE_IN_ROM
-#endif
-
-
-/*!
-* \brief Affine transformation matrix for HMC5883L sensor data calibration
-*
-* Data is retrieved via MATLAB script and only valid for a specific board configuration.
-* Be sure to provide your own values here or YMMV.
-*/
-const static fix16_t hmc5883l_calibration_data[3][4] = {
-        { F16(0.98308),     F16(0.0025144),     F16(0.02777),       F16(0.0064502) },
-        { F16(0.0025144),   F16(0.92661),       F16(-0.043022),     F16(0.10543) },
-        { F16(0.02777),     F16(-0.043022),     F16(1.1128),        F16(-0.020258) }
-    };
-
-/*!
-* \brief Affine transformation matrix for MPU6050 accelerometer sensor data calibration
-*
-* Data is retrieved via MATLAB script and only valid for a specific board configuration.
-* Be sure to provide your own values here or YMMV.
-*/
-const static fix16_t mpu6050_accelerometer_calibration_data[3][4] = {
-        { F16(1.0062),      F16(0.0034341),     F16(-0.0027532),    F16(-0.0164) },
-        { F16(0.0034341),   F16(1.0008),        F16(-0.0056162),    F16(-0.016173) },
-        { F16(-0.0027532),  F16(-0.0056162),    F16(0.9931),        F16(0.02059) }
-    };
-
-/*!
-* \brief Affine transformation matrix for MPU6050 gyroscope sensor data calibration
-*
-* Data is retrieved via MATLAB script and only valid for a specific board configuration.
-* Be sure to provide your own values here or YMMV.
-*/
-const static fix16_t mpu6050_gyroscope_calibration_data[3][4] = {
-        { F16(1),           0,                  0,                  F16(-4.5446) },
-        { 0,                F16(1),             0,                  F16(-0.048858) },
-        { 0,                0,                  F16(1),             F16(-1.1197) }
-    };
-
-/*!
-* \brief Sensor variances for the MPU6050 accelerometer.
-*
-* Data is retrieved via MATLAB script and only valid for a specific board configuration.
-* Be sure to provide your own values here or YMMV.
-*/
-STORE_IN_ROM
-const static fix16_t var_mpu6050_accelerometer[3]   = { F16(9.8036e-06),    F16(9.6462e-06),    F16(2.4831e-05) };
-
-/*!
-* \brief Sensor variances for the MPU6050 gyroscope.
-*
-* Data is retrieved via MATLAB script and only valid for a specific board configuration.
-* Be sure to provide your own values here or YMMV.
-*/
-STORE_IN_ROM
-const static fix16_t var_mpu6050_gyroscope[3]       = { F16(0.016307),      F16(0.0084706),     F16(0.0129) };
-
-/*!
-* \brief Sensor variances for the HMC5883L magnetometer.
-*
-* Data is retrieved via MATLAB script and only valid for a specific board configuration.
-* Be sure to provide your own values here or YMMV.
-*/
-STORE_IN_ROM
-const static fix16_t var_hmc5883l[3]                = { F16(2.0347e-06),    F16(1.9233e-06),    F16(2.3021e-06) };
-
 /*!
 * \brief Retrieves the variances of the MPU6050 accelerometer
 * \param[out] x The x axis variances
@@ -86,9 +18,9 @@ const static fix16_t var_hmc5883l[3]                = { F16(2.0347e-06),    F16(
 */
 void mpu6050_var_accelerometer(register fix16_t *const RESTRICT x, register fix16_t *const RESTRICT y, register fix16_t *const RESTRICT z)
 {
-    *x = var_mpu6050_accelerometer[0];
-    *y = var_mpu6050_accelerometer[1];
-    *z = var_mpu6050_accelerometer[2];
+    *x = parameters.calibration.var_mpu6050_accelerometer[0];
+    *y = parameters.calibration.var_mpu6050_accelerometer[1];
+    *z = parameters.calibration.var_mpu6050_accelerometer[2];
 
     // these should really be compile-time checks
     assert(*x > 0);
@@ -104,9 +36,9 @@ void mpu6050_var_accelerometer(register fix16_t *const RESTRICT x, register fix1
 */
 void mpu6050_var_gyroscope(register fix16_t *const RESTRICT x, register fix16_t *const RESTRICT y, register fix16_t *const RESTRICT z)
 {
-    *x = var_mpu6050_gyroscope[0];
-    *y = var_mpu6050_gyroscope[1];
-    *z = var_mpu6050_gyroscope[2];
+    *x = parameters.calibration.var_mpu6050_gyroscope[0];
+    *y = parameters.calibration.var_mpu6050_gyroscope[1];
+    *z = parameters.calibration.var_mpu6050_gyroscope[2];
 
     // these should really be compile-time checks
     assert(*x > 0);
@@ -122,9 +54,27 @@ void mpu6050_var_gyroscope(register fix16_t *const RESTRICT x, register fix16_t
 */
 void hmc5883l_var(register fix16_t *const RESTRICT x, register fix16_t *const RESTRICT y, register fix16_t *const RESTRICT z)
 {
-    *x = var_hmc5883l[0];
-    *y = var_hmc5883l[1];
-    *z = var_hmc5883l[2];
+    *x = parameters.calibration.var_hmc5883l[0];
+    *y = parameters.calibration.var_hmc5883l[1];
+    *z = parameters.calibration.var_hmc5883l[2];
+
+    // these should really be compile-time checks
+    assert(*x > 0);
+    assert(*y > 0);
+    assert(*z > 0);
+}
+
+/*!
+* \brief Retrieves the variances of the MMA8451Q accelerometer
+* \param[out] x The x axis variances
+* \param[out] y The y axis variances
+* \param[out] z The z axis variances
+*/
+void mma8451q_var_accelerometer(register fix16_t *const RESTRICT x, register fix16_t *const RESTRICT y, register fix16_t *const RESTRICT z)
+{
+    *x = parameters.calibration.var_mma8451q_accelerometer[0];
+    *y = parameters.calibration.var_mma8451q_accelerometer[1];
+    *z = parameters.calibration.var_mma8451q_accelerometer[2];
 
     // these should really be compile-time checks
     assert(*x > 0);
@@ -132,6 +82,42 @@ void hmc5883l_var(register fix16_t *const RESTRICT x, register fix16_t *const RE
     assert(*z > 0);
 }
 
+/*!
+* \brief Retrieves the affine calibration of the MPU6050 accelerometer
+* \return The 3x4 transformation applied to the scaled sensor data
+*/
+const calibration_matrix_t *mpu6050_accelerometer_calibration()
+{
+    return &parameters.calibration.mpu6050_accelerometer;
+}
+
+/*!
+* \brief Retrieves the affine calibration of the MPU6050 gyroscope
+* \return The 3x4 transformation applied to the scaled sensor data in degree per second
+*/
+const calibration_matrix_t *mpu6050_gyroscope_calibration()
+{
+    return &parameters.calibration.mpu6050_gyroscope;
+}
+
+/*!
+* \brief Retrieves the affine calibration of the HMC5883L magnetometer
+* \return The 3x4 transformation applied to the scaled sensor data
+*/
+const calibration_matrix_t *hmc5883l_calibration()
+{
+    return &parameters.calibration.hmc5883l;
+}
+
+/*!
+* \brief Retrieves the affine calibration of the MMA8451Q accelerometer
+* \return The 3x4 transformation applied to the scaled sensor data, rotating it into the MPU6050 frame
+*/
+const calibration_matrix_t *mma8451q_accelerometer_calibration()
+{
+    return &parameters.calibration.mma8451q_accelerometer;
+}
+
 /*!
 * \brief Calibrates a given sensor using a 3x4 affine transformation
 * \param[inout] x The x data (will be overwritten with the calibrated version)
@@ -172,7 +158,7 @@ void sensor_calibrate(register const fix16_t calibration_data[static 3][4], regi
 HOT NONNULL
 void mpu6050_calibrate_accelerometer(register fix16_t *const RESTRICT x, register fix16_t *const RESTRICT y, register fix16_t *const RESTRICT z)
 {
-    sensor_calibrate(&mpu6050_accelerometer_calibration_data[0], x, y, z);
+    sensor_calibrate(&parameters.calibration.mpu6050_accelerometer[0], x, y, z);
 }
 
 /*!
@@ -184,7 +170,7 @@ void mpu6050_calibrate_accelerometer(register fix16_t *const RESTRICT x, registe
 HOT NONNULL
 void mpu6050_calibrate_gyroscope(register fix16_t *RESTRICT const x, register fix16_t *RESTRICT const y, register fix16_t *RESTRICT const z)
 {
-    sensor_calibrate(&mpu6050_gyroscope_calibration_data[0], x, y, z);
+    sensor_calibrate(&parameters.calibration.mpu6050_gyroscope[0], x, y, z);
 }
 
 /*!
@@ -196,5 +182,5 @@ void mpu6050_calibrate_gyroscope(register fix16_t *RESTRICT const x, register fi
 HOT NONNULL
 void hmc5883l_calibrate(register fix16_t *RESTRICT const x, register fix16_t *RESTRICT const y, register fix16_t *RESTRICT const z)
 {
-    sensor_calibrate(&hmc5883l_calibration_data[0], x, y, z);
+    sensor_calibrate(&parameters.calibration.hmc5883l[0], x, y, z);
 }
@@ -1,4 +1,7 @@
+#include <stdbool.h>
+
 #include "fixmath.h"
+#include "fusion/fast_normalize.h"
 #include "fusion/sensor_dcm.h"
 
 static v3d coordinate_system[3] = { { F16(1), 0, 0 }, { 0, F16(1), 0 }, { 0, 0, F16(1) } };
@@ -12,8 +15,47 @@ static v3d coordinate_system[3] = { { F16(1), 0, 0 }, { 0, F16(1), 0 }, { 0, 0,
 void sensor_get_csys(v3d *x, v3d *y, v3d *z) 
 {
     *x = coordinate_system[0];
-    *y = coordinate_system[2];
-    *z = coordinate_system[3];
+    *y = coordinate_system[1];
+    *z = coordinate_system[2];
+}
+
+/*!
+* \brief Builds the north, east and down axes from the given calibrated sensor values (TRIAD)
+* \param[out] north The north axis in body coordinates
+* \param[out] east The east axis in body coordinates
+* \param[out] down The down axis in body coordinates
+* \param[in] a The accelerometer vector.
+* \param[in] m The magnetometer vector
+* \return false if a is zero or parallel to m; the axes are undefined then
+*
+* The cross product with the unit accelerometer is invariant to the length of m, so m
+* is never normalized, and the cross product of the two orthogonal unit axes already
+* has unit length. This takes two normalizations and two cross products.
+*/
+bool sensor_triad(v3d *RESTRICT const north, v3d *RESTRICT const east, v3d *RESTRICT const down,
+    const v3d *RESTRICT const a, const v3d *RESTRICT const m)
+{
+    // after normalization, a (positive up) is the negated down axis
+    v3d up;
+    if (!v3d_normalize_fast(&up, a))
+    {
+        return false;
+    }
+
+    // east is orthogonal to both the field and the up axis
+    v3d_cross(east, m, &up);
+    if (!v3d_normalize_fast(east, east))
+    {
+        return false;
+    }
+
+    // north = up x east has unit length by construction
+    v3d_cross(north, &up, east);
+
+    down->x = -up.x;
+    down->y = -up.y;
+    down->z = -up.z;
+    return true;
 }
 
 /*!
@@ -25,34 +67,19 @@ void sensor_get_csys(v3d *x, v3d *y, v3d *z)
 void sensor_dcm(mf16 *const dcm,
     const v3d *RESTRICT const a, const v3d *RESTRICT const m)
 {
-
-    v3d an, mn;
-    v3d_normalize(&an, a);
-    v3d_normalize(&mn, m);
-
-    // define coordinate system
+    // define coordinate system; a (positive up) is the Z axis, Y is orthogonal to the
+    // magnetic field and X lies in the plane of Z and m
     v3d X, Y, Z;
+    if (!sensor_triad(&X, &Y, &Z, a, m))
+    {
+        dcm->rows = dcm->columns = 3;
+        dcm->errors = FIXMATRIX_SINGULAR;
+        return;
+    }
 
-    // after normalization, a (positive up) is the Z axis
-    Z = an;
-
-    // after normalization, m lies along the X axis
-    // note that X and Z are most probably not orthogonal due to the
-    // fact that m follows the magnetic field.
-    // we will correct for that later
-    X = mn;
-
-    // now we calculate Y by crossing X and Z and renormalize
-    v3d_cross(&Y, &X, &Z);
-    v3d_normalize(&Y, &Y);
-
-    // finally we recreate X from Z and Y
-    v3d_cross(&X, &Z, &Y);
-    v3d_normalize(&X, &X);
-
-    // and now, Z from X and Y
-    v3d_cross(&Z, &X, &Y);
-    v3d_normalize(&Z, &Z);
+    Z.x = -Z.x;
+    Z.y = -Z.y;
+    Z.z = -Z.z;
 
     coordinate_system[0] = X;
     coordinate_system[1] = Y;
@@ -100,6 +127,7 @@ void sensor_dcm(mf16 *const dcm,
 #endif
 
     dcm->rows = dcm->columns = 3;
+    dcm->errors = 0;
 }
 
 /*!
@@ -1,5 +1,7 @@
 #include <assert.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
 
 #include "fixmath.h"
 #include "fixkalman.h"
@@ -31,27 +33,239 @@
 #undef TEST_ACCEL
 #endif
 
+/*!
+* \def FUSION_SEQUENTIAL_UPDATE Enables sequential scalar measurement updates instead of {\ref kalman_correct_uc}
+*
+* Requires a diagonal measurement noise R. Every observation is processed on its own, so the
+* inverse of the innovation covariance reduces to one fix16_div per observation.
+*/
+#ifndef FUSION_SEQUENTIAL_UPDATE
+#define FUSION_SEQUENTIAL_UPDATE 1
+#endif
+
+/*!
+* \def FUSION_STEADY_STATE_GAIN Enables the scheduled steady-state gain mode
+*
+* Once the covariance of a filter has converged, the covariance prediction and update are skipped
+* and measurements are applied with the gain cached for the current observation regime. Innovations
+* outside of their gate drop the filter back to the full update. Requires {\ref FUSION_SEQUENTIAL_UPDATE}.
+*/
+#ifndef FUSION_STEADY_STATE_GAIN
+#define FUSION_STEADY_STATE_GAIN 0
+#endif
+
+#if FUSION_STEADY_STATE_GAIN && !FUSION_SEQUENTIAL_UPDATE
+#error FUSION_STEADY_STATE_GAIN requires FUSION_SEQUENTIAL_UPDATE.
+#endif
+
+/*!
+* \def FUSION_FIXED_KERNELS Enables the unrolled fixed-size matrix kernels of fixed_matrix.h
+*
+* The measurement updates then rely on the compile-time filter dimensions instead of
+* the runtime sizes of the matrices. If disabled, the generic libfixkalman and
+* libfixmatrix loops are used, e.g. for testing against the reference implementation.
+*/
+#ifndef FUSION_FIXED_KERNELS
+#define FUSION_FIXED_KERNELS 1
+#endif
+
+/*!
+* \def FUSION_COMPACT_STORAGE Stores the filters and observations in right-sized matrices
+*
+* The state and measurement vectors take a single column and the diagonal process and
+* measurement noise covariances their diagonal only, instead of FIXMATRIX_MAX_SIZE squared
+* elements each. The compact types cannot be passed to libfixkalman, hence this requires
+* {\ref FUSION_SEQUENTIAL_UPDATE}.
+*/
+#ifndef FUSION_COMPACT_STORAGE
+#define FUSION_COMPACT_STORAGE 1
+#endif
+
+#if FUSION_COMPACT_STORAGE && !FUSION_SEQUENTIAL_UPDATE
+#error FUSION_COMPACT_STORAGE requires FUSION_SEQUENTIAL_UPDATE.
+#endif
+
+/*!
+* \def FUSION_ADAPTIVE_NOISE Enables the innovation based adaptation of the measurement noise
+*
+* Every scalar update tracks the exponentially weighted mean of its squared innovation and
+* uses the part that h*P*h' does not explain as its noise, bounded relative to the configured
+* noise. This costs one multiply-add per observation and lets the accelerometer take part in
+* moderate accelerations instead of falling back to gyroscope-only updates.
+* Requires {\ref FUSION_SEQUENTIAL_UPDATE}.
+*/
+#ifndef FUSION_ADAPTIVE_NOISE
+#define FUSION_ADAPTIVE_NOISE 1
+#endif
+
+#if FUSION_ADAPTIVE_NOISE && !FUSION_SEQUENTIAL_UPDATE
+#error FUSION_ADAPTIVE_NOISE requires FUSION_SEQUENTIAL_UPDATE.
+#endif
+
+/*!
+* \def FUSION_SHARED_RATES Lets the orientation filter follow the angular velocities estimated by the attitude filter
+*
+* The orientation filter then keeps its three axis states only and is corrected by the projected
+* magnetometer alone, so the gyroscope is processed once per cycle, by the attitude filter. The
+* uncertainty of the shared rates enters the orientation covariance with the prediction. If
+* disabled, both filters estimate and correct the angular velocities on their own.
+*/
+#ifndef FUSION_SHARED_RATES
+#define FUSION_SHARED_RATES 1
+#endif
+
+/*!
+* \def FUSION_FAST_NORMALIZE Normalizes with the reciprocal square root of fast_normalize.h
+*
+* If disabled, the libfixmatrix v3d_normalize with its square root and divisions is used,
+* e.g. for testing against the reference implementation.
+*/
+#ifndef FUSION_FAST_NORMALIZE
+#define FUSION_FAST_NORMALIZE 1
+#endif
+
+/*!
+* \def FUSION_OVERFLOW_CHECK Counts the fixed-point overflows of every fusion stage and resets the affected filter
+*
+* After the prediction and every correction, the state and the upper triangle of the covariance are
+* scanned for fix16_overflow and saturated values, the variances for negative values, and the matrices
+* for FIXMATRIX_OVERFLOW and a failed decomposition. A hit resets the covariance of the filter and, if the
+* state itself is affected, bootstraps the filter anew. See {\ref fusion_report_overflows}.
+*/
+#ifndef FUSION_OVERFLOW_CHECK
+#define FUSION_OVERFLOW_CHECK 1
+#endif
+
+/*!
+* \def FUSION_SATURATING_ARITHMETIC Saturates the fix16 additions, subtractions and multiplications of the filter
+*
+* Results out of range then clamp to +-fix16_maximum instead of becoming fix16_overflow, which
+* otherwise spreads through every following operation. This costs a sign test per addition and
+* a comparison per multiplication; {\ref FUSION_OVERFLOW_CHECK} still reports the saturated values.
+*/
+#ifndef FUSION_SATURATING_ARITHMETIC
+#define FUSION_SATURATING_ARITHMETIC 0
+#endif
+
+#if FUSION_SATURATING_ARITHMETIC
+
+#include "compiler.h"
+
+/*!
+* \brief Adds two Q16.16 values, saturating at +-fix16_maximum
+* \param[in] a The first summand
+* \param[in] b The second summand
+* \return a+b
+*/
+HOT CONST
+STATIC_INLINE fix16_t fusion_sadd(register const fix16_t a, register const fix16_t b)
+{
+    register const fix16_t sum = (fix16_t)((uint32_t)a + (uint32_t)b);
+
+    // the sum overflowed if both summands have a sign the sum does not have
+    if ((~(a ^ b) & (a ^ sum)) < 0)
+    {
+        return (a < 0) ? -fix16_maximum : fix16_maximum;
+    }
+
+    // fix16_minimum equals fix16_overflow
+    return (fix16_minimum == sum) ? -fix16_maximum : sum;
+}
+
+/*!
+* \brief Subtracts two Q16.16 values, saturating at +-fix16_maximum
+* \param[in] a The minuend
+* \param[in] b The subtrahend
+* \return a-b
+*/
+HOT CONST
+STATIC_INLINE fix16_t fusion_ssub(register const fix16_t a, register const fix16_t b)
+{
+    register const fix16_t difference = (fix16_t)((uint32_t)a - (uint32_t)b);
+
+    // the difference overflowed if the operands differ in sign and the difference has the sign of b
+    if (((a ^ b) & (a ^ difference)) < 0)
+    {
+        return (a < 0) ? -fix16_maximum : fix16_maximum;
+    }
+
+    return (fix16_minimum == difference) ? -fix16_maximum : difference;
+}
+
+/*!
+* \brief Multiplies two Q16.16 values, saturating at +-fix16_maximum
+* \param[in] a The first factor
+* \param[in] b The second factor
+* \return a*b
+*
+* Unlike fix16_smul, this keeps calling the fix16_mul backend of the target.
+*/
+HOT CONST
+STATIC_INLINE fix16_t fusion_smul(register const fix16_t a, register const fix16_t b)
+{
+    register const fix16_t product = fix16_mul(a, b);
+
+    if (fix16_overflow == product)
+    {
+        return ((a ^ b) < 0) ? -fix16_maximum : fix16_maximum;
+    }
+
+    return product;
+}
+
+// everything below, including the kernels of fixed_matrix.h, saturates
+#define fix16_add(a, b)     fusion_sadd(a, b)
+#define fix16_sub(a, b)     fusion_ssub(a, b)
+#define fix16_mul(a, b)     fusion_smul(a, b)
+
+#endif
+
+#include "cpu/ramfunc.h"
+#include "fusion/fast_normalize.h"
+#include "fusion/fast_trig.h"
+#include "fusion/fixed_matrix.h"
 #include "fusion/sensor_dcm.h"
 #include "fusion/sensor_fusion.h"
+#include "parameters.h"
+
+#if FUSION_ENGINE == FUSION_ENGINE_KALMAN
+
+#if FUSION_FAST_TRIG
+#define output_asin(value)      fix16_asin_fast(value)
+#define output_atan2(y, x)      fix16_atan2_fast(y, x)
+#else
+#define output_asin(value)      fix16_asin(value)
+#define output_atan2(y, x)      fix16_atan2(y, x)
+#endif
+
+#if FUSION_FAST_NORMALIZE
+#define fusion_normalize(dest, src)     v3d_normalize_fast(dest, src)
+#else
+#define fusion_normalize(dest, src)     v3d_normalize(dest, src)
+#endif
 
 /************************************************************************/
 /* Measurement covariance definitions                                   */
 /************************************************************************/
 
+/*
+* The tuning is part of the persisted parameter block, see {\ref fusion_parameters_t}.
+*/
+
 /*
 * \brief Observation axis uncertainty (accelerometer)
 */
-static const fix16_t initial_r_axis = F16(0.05);
+#define initial_r_axis          (parameters.fusion.initial_r_axis)
 
 /*
 * \brief Observation projection uncertainty (magnetometer)
 */
-static const fix16_t initial_r_projection = F16(0.02);
+#define initial_r_projection    (parameters.fusion.initial_r_projection)
 
 /*
 * \brief Observation gyro uncertainty
 */
-static const fix16_t initial_r_gyro = F16(0.02);
+#define initial_r_gyro          (parameters.fusion.initial_r_gyro)
 
 /*
 * \brief Accelerometer process noise. Since the accelerometer readings are never used directly, this should always be set to zero.
@@ -59,23 +273,23 @@ static const fix16_t initial_r_gyro = F16(0.02);
 #ifdef TEST_ACCEL
 static const fix16_t q_axis = F16(.1);
 #else
-static const fix16_t q_axis = F16(0);
+#define q_axis                  (parameters.fusion.q_axis)
 #endif
 
 /*
 * \brief Gyro process noise
 */
-static const fix16_t q_gyro = F16(1);
+#define q_gyro                  (parameters.fusion.q_gyro)
 
 /*
 * \brief Tuning factor for the axis observation
 */
-static const fix16_t alpha1 = F16(5);
+#define alpha1                  (parameters.fusion.alpha1)
 
 /*
 * \brief Tuning factor for the gyro observation
 */
-static const fix16_t alpha2 = F16(.8);
+#define alpha2                  (parameters.fusion.alpha2)
 
 /*!
 * \brief Threshold value for attitude detection. Difference to norm.
@@ -87,14 +301,124 @@ static const fix16_t attitude_threshold = F16(0.14);
 */
 static const fix16_t singularity_cos_threshold = F16(0.17365);
 
+#if FUSION_SHARED_RATES
+
+/*!
+* \brief Axis process noise per step added to the orientation filter with shared rates
+*
+* The 3-state orientation filter lacks the rate uncertainty that the cross-covariance of the
+* 6-state filter accumulates; without it, and with the default q_axis of zero, the covariance
+* collapses below the fix16 resolution.
+*/
+static const fix16_t shared_rates_axis_noise = F16(0.0001);
+
+#endif
+
+#if FUSION_ADAPTIVE_NOISE
+
+/*!
+* \brief Threshold value for attitude detection with adapted noise. Difference to norm.
+*
+* Below it, the adapted accelerometer noise absorbs the acceleration; above it, e.g. on shocks,
+* the update still falls back to the gyroscope.
+*/
+static const fix16_t adaptive_attitude_threshold = F16(0.5);
+
+/*!
+* \brief Weight of the newest squared innovation; the statistics settle within about 1/weight updates
+*/
+static const fix16_t adaptive_noise_weight = F16(1.0/32);
+
+/*!
+* \brief Lower bound of the adapted noise relative to the configured noise
+*/
+static const fix16_t adaptive_noise_floor = F16(0.25);
+
+/*!
+* \brief Upper bound of the adapted noise relative to the configured noise
+*/
+static const fix16_t adaptive_noise_ceiling = F16(64);
+
+/*!
+* \brief Bound of the innovation entering the statistics, so that its square stays in range
+*/
+static const fix16_t adaptive_innovation_limit = F16(64);
+
+#endif
+
+#if FUSION_STEADY_STATE_GAIN
+
+/*!
+* \brief Relative change of the covariance trace between two updates that is considered converged
+*/
+static const fix16_t steady_state_tolerance = F16(0.002);
+
+/*!
+* \brief Number of consecutive converged updates required before a gain is cached
+*/
+static const uint_fast16_t steady_state_count = 50;
+
+/*!
+* \brief Innovation gate in standard deviations. Larger innovations are treated as transients.
+*/
+static const fix16_t steady_state_gate = F16(3);
+
+#endif
+
 /************************************************************************/
 /* Kalman filter structure definition                                   */
 /************************************************************************/
 
+#if FUSION_COMPACT_STORAGE
+
+/*!
+* \brief A state transition, state covariance or observation model matrix
+*/
+typedef mf16_6x6_t fusion_matrix_t;
+
+/*!
+* \brief A state or measurement vector
+*/
+typedef mf16_6x1_t fusion_vector_t;
+
+/*!
+* \brief A diagonal process or measurement noise covariance
+*/
+typedef mf16_diagonal6_t fusion_diagonal_t;
+
+/*!
+* \brief A Kalman filter without control input
+*/
+typedef struct {
+    fusion_matrix_t A;      /*!< state transition model */
+    fusion_matrix_t P;      /*!< state covariance */
+    fusion_diagonal_t Q;    /*!< process noise covariance */
+    fusion_vector_t x;      /*!< state vector */
+} fusion_filter_t;
+
+/*!
+* \brief A Kalman filter observation of up to six variables
+*/
+typedef struct {
+    fusion_matrix_t H;      /*!< observation model */
+    fusion_diagonal_t R;    /*!< measurement noise covariance */
+    fusion_vector_t z;      /*!< measurement vector */
+} fusion_observation_t;
+
+#else
+
+typedef mf16 fusion_matrix_t;
+typedef mf16 fusion_vector_t;
+typedef mf16 fusion_diagonal_t;
+typedef kalman16_uc_t fusion_filter_t;
+typedef kalman16_observation_t fusion_observation_t;
+
+#endif
+
 /*!
 * \brief The Kalman filter instance used to predict the orientation.
 */
-static kalman16_uc_t kf_attitude;
+static fusion_filter_t kf_attitude;
 
 /*!
 * \def KF_STATES Number of states
@@ -104,17 +428,32 @@ static kalman16_uc_t kf_attitude;
 /*!
 * \brief The Kalman filter instance used to predict the orientation.
 */
-static kalman16_uc_t kf_orientation;
+static fusion_filter_t kf_orientation;
 
 /*!
 * \def KF_STATES Number of states
 */
+#if FUSION_SHARED_RATES
+#define KF_ORIENTATION_STATES 3
+#else
 #define KF_ORIENTATION_STATES 6
+#endif
+
+#if FUSION_SHARED_RATES
+
+/*!
+* \brief The transition of the orientation axes by the shared angular velocities, accumulated over the prediction steps
+*
+* Corresponds to the upper right block S of the attitude state matrix, see {\ref fusion_fastpredict_P}.
+*/
+static fix16_t m_orientation_coupling[3][3];
+
+#endif
 
 /*!
 * \brief The Kalman filter observation instance used to update the prediction with accelerometer data
 */
-static kalman16_observation_t kfm_accel;
+static fusion_observation_t kfm_accel;
 
 /*!
 * \def KFM_ACCEL Number of observation variables for accelerometer updates
@@ -124,23 +463,104 @@ static kalman16_observation_t kfm_accel;
 /*!
 * \brief The Kalman filter observation instance used to update the prediction with magnetometer data
 */
-static kalman16_observation_t kfm_magneto;
+static fusion_observation_t kfm_magneto;
 
 /*!
 * \def KFM_MAGNETO Number of observation variables for magnetometer updates
 */
+#if FUSION_SHARED_RATES
+#define KFM_MAGNETO 3
+#else
 #define KFM_MAGNETO 6
+#endif
 
 /*!
 * \brief The Kalman filter observation instance used to update the prediction with magnetometer data
 */
-static kalman16_observation_t kfm_gyro;
+static fusion_observation_t kfm_gyro;
 
 /*!
 * \def KFM_GYRO Number of observation variables for gyroscope-only updates
 */
 #define KFM_GYRO 3
 
+#if (FUSION_FIXED_KERNELS || FUSION_COMPACT_STORAGE) && ((KF_ATTITUDE_STATES != 6) || (KFM_ACCEL != 6) || (KFM_GYRO != 3))
+#error FUSION_FIXED_KERNELS and FUSION_COMPACT_STORAGE require 6 attitude states and 6 or 3 observations.
+#endif
+
+#if (FUSION_FIXED_KERNELS || FUSION_COMPACT_STORAGE) && !(((KF_ORIENTATION_STATES == 6) && (KFM_MAGNETO == 6)) || ((KF_ORIENTATION_STATES == 3) && (KFM_MAGNETO == 3)))
+#error FUSION_FIXED_KERNELS and FUSION_COMPACT_STORAGE require 6 or 3 orientation states with as many observations.
+#endif
+
+/*!
+* \brief Observation regimes of a filter
+*/
+typedef enum {
+    FUSION_REGIME_ROTATION = 0, /*!< gyroscope-only update */
+    FUSION_REGIME_AXES = 1,     /*!< accelerometer or magnetometer update */
+    FUSION_REGIME_COUNT = 2
+} fusion_regime_t;
+
+#if FUSION_SEQUENTIAL_UPDATE
+
+/*!
+* \brief Gain of a sequential measurement update
+*/
+typedef struct {
+    fix16_t K[FIXMATRIX_MAX_SIZE][FIXMATRIX_MAX_SIZE];  /*!< gain of every observation, K[m][i] */
+    fix16_t s[FIXMATRIX_MAX_SIZE];                      /*!< innovation variance of every observation */
+} fusion_gain_t;
+
+#endif
+
+#if FUSION_STEADY_STATE_GAIN
+
+/*!
+* \brief Gain schedule of a filter
+*/
+typedef struct {
+    fusion_gain_t gain[FUSION_REGIME_COUNT];                /*!< last gain per regime */
+    fix16_t bound[FUSION_REGIME_COUNT][FIXMATRIX_MAX_SIZE]; /*!< innovation gates per regime */
+    fix16_t trace[FUSION_REGIME_COUNT];                     /*!< trace of P after the last full update per regime */
+    bool valid[FUSION_REGIME_COUNT];                        /*!< set if the regime gain was taken from a converged covariance */
+    uint_fast16_t stable;                                   /*!< number of consecutive converged updates */
+    bool steady;                                            /*!< set if the covariance is frozen */
+    uint_fast8_t predict_pending;                           /*!< steps of a skipped covariance prediction; 0 if none */
+} fusion_schedule_t;
+
+/*!
+* \brief The gain schedule of the attitude filter
+*/
+static fusion_schedule_t schedule_attitude;
+
+/*!
+* \brief The gain schedule of the orientation filter
+*/
+static fusion_schedule_t schedule_orientation;
+
+#endif
+
+#if FUSION_ADAPTIVE_NOISE
+
+/*!
+* \brief Innovation statistics of a filter
+*/
+typedef struct {
+    fix16_t power[FUSION_REGIME_COUNT][FIXMATRIX_MAX_SIZE];  /*!< mean squared innovation per regime and observation; 0 if not seeded yet */
+} fusion_noise_t;
+
+/*!
+* \brief The innovation statistics of the attitude filter
+*/
+static fusion_noise_t noise_attitude;
+
+/*!
+* \brief The innovation statistics of the orientation filter
+*/
+static fusion_noise_t noise_orientation;
+
+#endif
+
 /*!
 * \brief Lambda parameter for certainty tuning
 */
@@ -194,6 +614,78 @@ static bool m_attitude_bootstrapped = false;
 */
 static bool m_orientation_bootstrapped = false;
 
+/************************************************************************/
+/* Multi-rate update tracking                                           */
+/************************************************************************/
+
+/*!
+* \brief Determines if the attitude filter was corrected since the last prediction
+*/
+static bool m_attitude_corrected = false;
+
+/*!
+* \brief Determines if the orientation filter was corrected since the last prediction
+*/
+static bool m_orientation_corrected = false;
+
+/************************************************************************/
+/* Output derivation cache                                              */
+/************************************************************************/
+
+/*!
+* \brief Flags of the output representations derived from the filter state
+*/
+typedef enum {
+    FUSION_OUTPUT_DCM           = 0x01, /*!< The direction cosine matrix */
+    FUSION_OUTPUT_QUATERNION    = 0x02, /*!< The orientation quaternion */
+    FUSION_OUTPUT_ANGLES        = 0x04, /*!< The roll, pitch and yaw angles */
+} fusion_output_flags_t;
+
+/*!
+* \brief Output representations of the filter state, derived on demand
+*/
+typedef struct {
+    fix16_t dcm[3][3];          /*!< The DCM with the north, east and down rows in body coordinates */
+    qf16 quaternion;            /*!< The orientation quaternion */
+    fix16_t roll;               /*!< The roll angle in radians */
+    fix16_t pitch;              /*!< The pitch angle in radians */
+    fix16_t yaw;                /*!< The yaw angle in radians */
+    uint_fast8_t valid;         /*!< The {\ref fusion_output_flags_t} already derived in the current filter epoch */
+} fusion_output_t;
+
+/*!
+* \brief The output cache, invalidated whenever the filter state changes
+*/
+static fusion_output_t m_output = { .valid = 0 };
+
+/*!
+* \def fusion_output_invalidate Starts a new filter epoch by discarding all derived outputs
+*/
+#define fusion_output_invalidate() \
+    do { m_output.valid = 0; } while (0)
+
+#if FUSION_OVERFLOW_CHECK
+
+/************************************************************************/
+/* Overflow detection                                                   */
+/************************************************************************/
+
+/*!
+* \brief The overflows and resets since the last report
+*/
+static fusion_overflow_report_t m_overflows;
+
+/*!
+* \brief Damage found in a filter
+*/
+typedef enum {
+    FUSION_FAULT_NONE           = 0x00, /*!< The filter is intact */
+    FUSION_FAULT_COVARIANCE     = 0x01, /*!< The covariance overflowed or lost its positive variances */
+    FUSION_FAULT_STATE          = 0x02, /*!< The state overflowed */
+} fusion_fault_flags_t;
+
+#endif
+
 /************************************************************************/
 /* Helper macros                                                        */
 /************************************************************************/
@@ -221,6 +713,37 @@ static bool m_orientation_bootstrapped = false;
     matrix->data[row][column] = value; \
     matrix->data[column][row] = value
 
+#if FUSION_COMPACT_STORAGE
+
+/*!
+* \def diagonal_set Helper macro to set a diagonal element of a noise covariance
+*/
+#define diagonal_set(matrix, index, value) \
+    assert(index < matrix->rows); \
+    matrix->data[index] = value
+
+/*!
+* \def diagonal_get Helper macro to get a diagonal element of a noise covariance
+*/
+#define diagonal_get(matrix, index) \
+    (matrix->data[index])
+
+#else
+
+/*!
+* \def diagonal_set Helper macro to set a diagonal element of a noise covariance
+*/
+#define diagonal_set(matrix, index, value) \
+    matrix_set(matrix, index, index, value)
+
+/*!
+* \def diagonal_get Helper macro to get a diagonal element of a noise covariance
+*/
+#define diagonal_get(matrix, index) \
+    (matrix->data[index][index])
+
+#endif
+
 
 /*!
 * \def F16_ONE The value 1 in Q16
@@ -324,16 +847,84 @@ STATIC_INLINE void mf16_add_scaled(mf16 *dest, const mf16 *RESTRICT a, const mf1
 /* System initialization                                                */
 /************************************************************************/
 
+#if FUSION_COMPACT_STORAGE
+
+/*!
+* \def matrix_initialize Helper macro to clear a matrix and set its dimensions
+*/
+#define matrix_initialize(matrix, row_count, column_count) \
+    memset(matrix, 0, sizeof(*matrix)); \
+    matrix->rows = row_count; \
+    matrix->columns = column_count
+
+/*!
+* \brief Clears a filter and sets its dimensions
+* \param[out] kf The filter
+* \param[in] states The number of states
+*/
+COLD NONNULL
+static void fusion_filter_initialize(fusion_filter_t *const kf, const uint_fast8_t states)
+{
+    matrix_initialize((&kf->A), states, states);
+    matrix_initialize((&kf->P), states, states);
+    matrix_initialize((&kf->Q), states, states);
+    matrix_initialize((&kf->x), states, 1);
+}
+
+/*!
+* \brief Clears an observation and sets its dimensions
+* \param[out] kfm The observation
+* \param[in] states The number of states of the observed filter
+* \param[in] observations The number of observation variables
+*/
+COLD NONNULL
+static void fusion_observation_initialize(fusion_observation_t *const kfm, const uint_fast8_t states, const uint_fast8_t observations)
+{
+    matrix_initialize((&kfm->H), observations, states);
+    matrix_initialize((&kfm->R), observations, observations);
+    matrix_initialize((&kfm->z), observations, 1);
+}
+
+#else
+
+#define fusion_filter_initialize(kf, states) \
+    kalman_filter_initialize_uc(kf, states)
+
+#define fusion_observation_initialize(kfm, states, observations) \
+    kalman_observation_initialize(kfm, states, observations)
+
+#endif
+
+#if FUSION_STEADY_STATE_GAIN
+
+/*!
+* \brief Discards all cached gains of a filter and returns it to the full update
+* \param[in] schedule The gain schedule of the filter
+*/
+NONNULL
+static void fusion_schedule_reset(fusion_schedule_t *const schedule)
+{
+    for (int_fast8_t r = 0; r < FUSION_REGIME_COUNT; ++r)
+    {
+        schedule->valid[r] = false;
+    }
+
+    schedule->stable = 0;
+    schedule->steady = false;
+}
+
+#endif
+
 /*!
 * \brief Initializes the state matrix of a specific filter based on its state
 * \param[in] kf The filter to update
 * \param[in] deltaT The time differential
 */
 HOT NONNULL LEAF
-STATIC_INLINE void update_state_matrix_from_state(kalman16_uc_t *const kf, register fix16_t deltaT)
+STATIC_INLINE void update_state_matrix_from_state(fusion_filter_t *const kf, register fix16_t deltaT)
 {
-    mf16 *const A = &kf->A;
-    const mf16 *const x = &kf->x;
+    fusion_matrix_t *const A = &kf->A;
+    const fusion_vector_t *const x = &kf->x;
 
     fix16_t c1 = x->data[0][0];
     fix16_t c2 = x->data[1][0];
@@ -352,13 +943,139 @@ STATIC_INLINE void update_state_matrix_from_state(kalman16_uc_t *const kf, regis
     //matrix_set(A, 2, 5,   0);
 }
 
+/*!
+* \brief Accumulates the transition of a further prediction step into the state matrix
+* \param[in] kf The filter to update
+* \param[in] deltaT The time differential of the step
+*
+* With A = [I S; 0 I], the product of two transitions is [I S1+S2; 0 I], so the
+* accumulated state matrix keeps the layout expected by {\ref fusion_fastpredict_P}.
+*/
+HOT NONNULL LEAF
+STATIC_INLINE void accumulate_state_matrix_from_state(fusion_filter_t *const kf, register fix16_t deltaT)
+{
+    fusion_matrix_t *const A = &kf->A;
+    const fusion_vector_t *const x = &kf->x;
+
+    fix16_t c1 = x->data[0][0];
+    fix16_t c2 = x->data[1][0];
+    fix16_t c3 = x->data[2][0];
+
+    A->data[0][4] = fix16_add(A->data[0][4],  fix16_mul(c3, deltaT));
+    A->data[0][5] = fix16_sub(A->data[0][5],  fix16_mul(c2, deltaT));
+
+    A->data[1][3] = fix16_sub(A->data[1][3],  fix16_mul(c3, deltaT));
+    A->data[1][5] = fix16_add(A->data[1][5],  fix16_mul(c1, deltaT));
+
+    A->data[2][3] = fix16_add(A->data[2][3],  fix16_mul(c2, deltaT));
+    A->data[2][4] = fix16_sub(A->data[2][4],  fix16_mul(c1, deltaT));
+}
+
+#if FUSION_SHARED_RATES
+
+/*!
+* \brief Sets or accumulates the transition of the orientation axes by the shared angular velocities
+* \param[in] deltaT The time differential of the step
+* \param[in] accumulate Set to add the step to the previous ones of the same prediction
+*
+* The layout equals the S block of {\ref update_state_matrix_from_state}.
+*/
+HOT LEAF
+STATIC_INLINE void update_orientation_coupling(register fix16_t deltaT, const bool accumulate)
+{
+    fix16_t (*const S)[3] = m_orientation_coupling;
+    const fusion_vector_t *const x = &kf_orientation.x;
+
+    fix16_t c1 = fix16_mul(x->data[0][0], deltaT);
+    fix16_t c2 = fix16_mul(x->data[1][0], deltaT);
+    fix16_t c3 = fix16_mul(x->data[2][0], deltaT);
+
+    if (accumulate)
+    {
+        c1 = fix16_add(c1, S[1][2]);
+        c2 = fix16_add(c2, S[2][0]);
+        c3 = fix16_add(c3, S[0][1]);
+    }
+
+    S[0][1] =  c3;
+    S[0][2] = -c2;
+
+    S[1][0] = -c3;
+    S[1][2] =  c1;
+
+    S[2][0] =  c2;
+    S[2][1] = -c1;
+}
+
+#endif
+
+/*!
+* \brief Sets the state covariance of a filter to its initial variances
+* \param[in] kf The filter
+*/
+COLD NONNULL
+static void fusion_reset_covariance(fusion_filter_t *const kf)
+{
+    fusion_matrix_t *const P = &kf->P;
+    const uint_fast8_t states = kf->x.rows;
+
+    for (uint_fast8_t i = 0; i < states; ++i)
+    {
+        for (uint_fast8_t j = 0; j < states; ++j)
+        {
+            P->data[i][j] = 0;
+        }
+    }
+    P->errors = 0;
+
+    // initial axis (accelerometer/magnetometer) variances
+    matrix_set(P, 0, 0, F16(5));
+    matrix_set(P, 1, 1, F16(5));
+    matrix_set(P, 2, 2, F16(5));
+
+    // initial gyro variances
+    if (states > 3)
+    {
+        matrix_set(P, 3, 3, F16(1));
+        matrix_set(P, 4, 4, F16(1));
+        matrix_set(P, 5, 5, F16(1));
+    }
+}
+
+/*!
+* \brief Sets the state of a filter to its initial estimate
+* \param[in] kf The filter
+*
+* The attitude axis points up, the orientation axis east, and the angular velocities are zero.
+*/
+COLD NONNULL
+static void fusion_reset_state(fusion_filter_t *const kf)
+{
+    fusion_vector_t *const x = &kf->x;
+
+    for (uint_fast8_t i = 0; i < x->rows; ++i)
+    {
+        x->data[i][0] = 0;
+    }
+    x->errors = 0;
+
+    if (kf == &kf_attitude)
+    {
+        x->data[2][0] = F16(1);
+    }
+    else
+    {
+        x->data[1][0] = F16(1);
+    }
+}
+
 /*!
 * \brief Initialization of a specific filter
 */
 COLD NONNULL
-static void initialize_system_filter(kalman16_uc_t *const kf, const uint_fast8_t states)
+static void initialize_system_filter(fusion_filter_t *const kf, const uint_fast8_t states)
 {
-    kalman_filter_initialize_uc(kf, states);
+    fusion_filter_initialize(kf, states);
 
     /************************************************************************/
     /* Prepare initial state estimation                                     */
@@ -369,43 +1086,42 @@ static void initialize_system_filter(kalman16_uc_t *const kf, const uint_fast8_t
     /* Set state transition model                                           */
     /************************************************************************/
     {
-        mf16 *const A = &kf->A;
-        mf16_fill_diagonal(A, F16(1));
-        update_state_matrix_from_state(kf, F16(1)); // assume bootstrap dT := 1
+        fusion_matrix_t *const A = &kf->A;
+        for (uint_fast8_t i = 0; i < states; ++i)
+        {
+            matrix_set(A, i, i, F16(1));
+        }
+
+        // an axis filter without angular velocity states is transitioned by the shared rates
+        if (states > 3)
+        {
+            update_state_matrix_from_state(kf, F16(1)); // assume bootstrap dT := 1
+        }
     }
 
     /************************************************************************/
     /* Set state variances                                                  */
     /************************************************************************/
-    {
-        mf16 *const P = &kf->P;
-
-        // initial axis (accelerometer/magnetometer) variances
-        matrix_set(P, 0, 0, F16(5));
-        matrix_set(P, 1, 1, F16(5));
-        matrix_set(P, 2, 2, F16(5));
-
-        // initial gyro variances
-        matrix_set(P, 3, 3, F16(1));
-        matrix_set(P, 4, 4, F16(1));
-        matrix_set(P, 5, 5, F16(1));
-    }
+    fusion_reset_covariance(kf);
     
     /************************************************************************/
     /* Set system process noise                                             */
     /************************************************************************/
     {
-        mf16 *const Q = &kf->Q;
+        fusion_diagonal_t *const Q = &kf->Q;
 
         // axis process noise
-        matrix_set(Q, 0, 0, q_axis);
-        matrix_set(Q, 1, 1, q_axis);
-        matrix_set(Q, 2, 2, q_axis);
+        diagonal_set(Q, 0, q_axis);
+        diagonal_set(Q, 1, q_axis);
+        diagonal_set(Q, 2, q_axis);
 
         // gyro process noise
-        matrix_set(Q, 3, 3, q_gyro);
-        matrix_set(Q, 4, 4, q_gyro);
-        matrix_set(Q, 5, 5, q_gyro);
+        if (states > 3)
+        {
+            diagonal_set(Q, 3, q_gyro);
+            diagonal_set(Q, 4, q_gyro);
+            diagonal_set(Q, 5, q_gyro);
+        }
     }
 }
 
@@ -419,13 +1135,8 @@ static void initialize_system()
     initialize_system_filter(&kf_attitude, KF_ATTITUDE_STATES);
 
     // set intial state estimate
-    kf_attitude.x.data[0][0] = 0;
-    kf_attitude.x.data[1][0] = 0;
-    kf_attitude.x.data[2][0] = 1;
-
-    kf_orientation.x.data[0][0] = 0;
-    kf_orientation.x.data[1][0] = 1;
-    kf_orientation.x.data[2][0] = 0;
+    fusion_reset_state(&kf_attitude);
+    fusion_reset_state(&kf_orientation);
 }
 
 /*!
@@ -435,17 +1146,21 @@ static void initialize_system()
 * \param[in] gyroXYZ The gyro observation noise
 */
 HOT NONNULL
-STATIC_INLINE void update_measurement_noise(kalman16_observation_t *const kfm, register const fix16_t axisXYZ, register const fix16_t gyroXYZ)
+STATIC_INLINE void update_measurement_noise(fusion_observation_t *const kfm, register const fix16_t axisXYZ, register const fix16_t gyroXYZ)
 {
-    mf16 *const R = &kfm->R;
+    fusion_diagonal_t *const R = &kfm->R;
 
-    matrix_set(R, 0, 0, axisXYZ);
-    matrix_set(R, 1, 1, axisXYZ);
-    matrix_set(R, 2, 2, axisXYZ);
+    diagonal_set(R, 0, axisXYZ);
+    diagonal_set(R, 1, axisXYZ);
+    diagonal_set(R, 2, axisXYZ);
 
-    matrix_set(R, 3, 3, gyroXYZ);
-    matrix_set(R, 4, 4, gyroXYZ);
-    matrix_set(R, 5, 5, gyroXYZ);
+    // the axis-only observation has no gyro half
+    if (R->rows > 3)
+    {
+        diagonal_set(R, 3, gyroXYZ);
+        diagonal_set(R, 4, gyroXYZ);
+        diagonal_set(R, 5, gyroXYZ);
+    }
 }
 
 /*!
@@ -456,7 +1171,11 @@ HOT
 STATIC_INLINE uint_fast8_t acceleration_detected()
 {
     register fix16_t alpha = fix16_abs(fix16_sub(norm3(m_accelerometer.x, m_accelerometer.y, m_accelerometer.z), F16(1)));
+#if FUSION_ADAPTIVE_NOISE
+    if (alpha < adaptive_attitude_threshold)
+#else
     if (alpha < attitude_threshold)
+#endif
     {
         return 0;
     }
@@ -468,33 +1187,36 @@ STATIC_INLINE uint_fast8_t acceleration_detected()
 * \brief Dynamic measurement noise updating
 */
 HOT NONNULL
-STATIC_INLINE void tune_measurement_noise(kalman16_observation_t *const kfm)
+STATIC_INLINE void tune_measurement_noise(fusion_observation_t *const kfm)
 {
-    mf16 *const R = &kfm->R;
+    fusion_diagonal_t *const R = &kfm->R;
   
 
-    matrix_set(R, 0, 0, fix16_mul(initial_r_axis, alpha1));
-    matrix_set(R, 1, 1, fix16_mul(initial_r_axis, alpha1));
-    matrix_set(R, 2, 2, fix16_mul(initial_r_axis, alpha1));
+    diagonal_set(R, 0, fix16_mul(initial_r_axis, alpha1));
+    diagonal_set(R, 1, fix16_mul(initial_r_axis, alpha1));
+    diagonal_set(R, 2, fix16_mul(initial_r_axis, alpha1));
 
-    matrix_set(R, 3, 3, fix16_mul(initial_r_gyro, alpha2));
-    matrix_set(R, 4, 4, fix16_mul(initial_r_gyro, alpha2));
-    matrix_set(R, 5, 5, fix16_mul(initial_r_gyro, alpha2));
+    if (R->rows > 3)
+    {
+        diagonal_set(R, 3, fix16_mul(initial_r_gyro, alpha2));
+        diagonal_set(R, 4, fix16_mul(initial_r_gyro, alpha2));
+        diagonal_set(R, 5, fix16_mul(initial_r_gyro, alpha2));
+    }
 }
 
 /*!
 * \brief Initialization of a specific measurement
 */
 COLD
-static void initialize_observation(kalman16_observation_t *const kfm, const uint_fast8_t states, const uint_fast8_t observations)
+static void initialize_observation(fusion_observation_t *const kfm, const uint_fast8_t states, const uint_fast8_t observations)
 {
-    kalman_observation_initialize(kfm, states, observations);
+    fusion_observation_initialize(kfm, states, observations);
 
     /************************************************************************/
     /* Set observation model                                                */
     /************************************************************************/
     {
-        mf16 *const H = &kfm->H;
+        fusion_matrix_t *const H = &kfm->H;
 
         // axes
         matrix_set(H, 0, 0, F16_ONE);
@@ -502,9 +1224,12 @@ static void initialize_observation(kalman16_observation_t *const kfm, const uint
         matrix_set(H, 2, 2, F16_ONE);
 
         // gyro
-        matrix_set(H, 3, 3, F16_ONE);
-        matrix_set(H, 4, 4, F16_ONE);
-        matrix_set(H, 5, 5, F16_ONE);
+        if (observations > 3)
+        {
+            matrix_set(H, 3, 3, F16_ONE);
+            matrix_set(H, 4, 4, F16_ONE);
+            matrix_set(H, 5, 5, F16_ONE);
+        }
     }
 
     /************************************************************************/
@@ -519,7 +1244,7 @@ static void initialize_observation(kalman16_observation_t *const kfm, const uint
 COLD
 static void initialize_observation_accel()
 {
-    kalman16_observation_t *const kfm = &kfm_accel;
+    fusion_observation_t *const kfm = &kfm_accel;
     initialize_observation(kfm, KF_ATTITUDE_STATES, KFM_ACCEL);
 }
 
@@ -529,7 +1254,7 @@ static void initialize_observation_accel()
 COLD
 static void initialize_observation_magneto()
 {
-    kalman16_observation_t *const kfm = &kfm_magneto;
+    fusion_observation_t *const kfm = &kfm_magneto;
     initialize_observation(kfm, KF_ORIENTATION_STATES, KFM_MAGNETO);
 }
 
@@ -539,13 +1264,13 @@ static void initialize_observation_magneto()
 COLD
 static void initialize_observation_gyro()
 {
-    kalman_observation_initialize(&kfm_gyro, KF_ORIENTATION_STATES, KFM_GYRO);
+    fusion_observation_initialize(&kfm_gyro, KF_ATTITUDE_STATES, KFM_GYRO);
 
     /************************************************************************/
     /* Set observation model                                                */
     /************************************************************************/
     {
-        mf16 *const H = &kfm_gyro.H;
+        fusion_matrix_t *const H = &kfm_gyro.H;
 
         // gyro
         matrix_set(H, 0, 3, F16_ONE);
@@ -557,11 +1282,11 @@ static void initialize_observation_gyro()
     /* Set observation process noise covariance                             */
     /************************************************************************/
     {
-        mf16 *const R = &kfm_gyro.R;
+        fusion_diagonal_t *const R = &kfm_gyro.R;
 
-        matrix_set(R, 0, 0, initial_r_gyro);
-        matrix_set(R, 1, 1, initial_r_gyro);
-        matrix_set(R, 2, 2, initial_r_gyro);
+        diagonal_set(R, 0, initial_r_gyro);
+        diagonal_set(R, 1, initial_r_gyro);
+        diagonal_set(R, 2, initial_r_gyro);
     }
 
 }
@@ -575,137 +1300,220 @@ void fusion_initialize()
     initialize_observation_gyro();
     initialize_observation_accel();
     initialize_observation_magneto();
+
+#if FUSION_STEADY_STATE_GAIN
+    fusion_schedule_reset(&schedule_attitude);
+    fusion_schedule_reset(&schedule_orientation);
+#endif
+
+#if FUSION_ADAPTIVE_NOISE
+    noise_attitude = (fusion_noise_t){ { { 0 } } };
+    noise_orientation = (fusion_noise_t){ { { 0 } } };
+#endif
+
+    fusion_output_invalidate();
 }
 
-/************************************************************************/
-/* State calculation helpers                                            */
-/************************************************************************/
+#if FUSION_OVERFLOW_CHECK
 
 /*!
-* \brief Sanitizes the state variables
+* \brief Determines if a value is fix16_overflow or saturated
+* \param[in] value The value
+* \return true if the value is fix16_overflow, i.e. fix16_minimum, or +-fix16_maximum
+*/
+HOT CONST
+STATIC_INLINE bool fusion_is_overflow(register const fix16_t value)
+{
+    // fix16_maximum, fix16_minimum and -fix16_maximum map to 0, 1 and 2
+    return ((uint32_t)value - (uint32_t)fix16_maximum) <= 2u;
+}
+
+/*!
+* \brief Scans a filter for overflowed values
+* \param[in] kf The filter
+* \param[in] covariance Set to scan the covariance in addition to the state
+* \return The {\ref fusion_fault_flags_t} found
 */
 HOT NONNULL
-STATIC_INLINE void fusion_sanitize_state(kalman16_uc_t *const kf)
+static uint_fast8_t fusion_find_overflow(const fusion_filter_t *const kf, const bool covariance)
 {
-    mf16 *const A = &kf->A;
-    mf16 *const x = &kf->x;
-    
-    // fetch axes
-    fix16_t c1 = x->data[0][0];
-    fix16_t c2 = x->data[1][0];
-    fix16_t c3 = x->data[2][0];
+    const fusion_vector_t *const x = &kf->x;
+    const fusion_matrix_t *const P = &kf->P;
+    const int_fast8_t states = x->rows;
+    register int_fast8_t i, j;
+
+    uint_fast8_t fault = FUSION_FAULT_NONE;
+    for (i = 0; i < states; ++i)
+    {
+        if (fusion_is_overflow(x->data[i][0]))
+        {
+            fault |= FUSION_FAULT_STATE;
+            break;
+        }
+    }
 
-    // calculate vector norm
-    fix16_t norm = norm3(c1, c2, c3);
+    if (!covariance)
+    {
+        return fault;
+    }
 
-    // normalize vectors
-    c1 = fix16_div(c1, norm);
-    c2 = fix16_div(c2, norm);
-    c3 = fix16_div(c3, norm);
+    // the covariance is kept symmetric
+    if (0 != (P->errors & (FIXMATRIX_OVERFLOW | FIXMATRIX_NEGATIVE)))
+    {
+        return fault | FUSION_FAULT_COVARIANCE;
+    }
 
-    // re-set to state and state matrix
-    x->data[0][0] = c1;
-    x->data[1][0] = c2;
-    x->data[2][0] = c3;
+    for (i = 0; i < states; ++i)
+    {
+        if (P->data[i][i] < 0)
+        {
+            return fault | FUSION_FAULT_COVARIANCE;
+        }
+
+        for (j = i; j < states; ++j)
+        {
+            if (fusion_is_overflow(P->data[i][j]))
+            {
+                return fault | FUSION_FAULT_COVARIANCE;
+            }
+        }
+    }
+
+    return fault;
 }
 
 /*!
-* \brief Fetches the values without any modification
-* \param[out] roll The roll angle in radians.
-* \param[out] pitch The pitch (elevation) angle in radians.
+* \brief Increments a saturating overflow counter
+* \param[in,out] counter The counter
 */
-HOT NONNULL LEAF
-STATIC_INLINE void calculate_roll_pitch(register fix16_t *RESTRICT const roll, register fix16_t *RESTRICT const pitch)
+STATIC_INLINE void fusion_count_overflow(uint16_t *const counter)
 {
-    const mf16 *const x = kalman_get_state_vector_uc(&kf_attitude);
-
-    // fetch axes
-    fix16_t c31 =  x->data[0][0];
-    fix16_t c32 =  x->data[1][0];
-    fix16_t c33 =  x->data[2][0];
-    
-    // calculate pitch
-    *pitch = -fix16_asin(c31);
-
-    // calculate roll
-    *roll = -fix16_atan2(c32, -c33);
+    if (UINT16_MAX != *counter) ++*counter;
 }
 
 /*!
-* \brief Fetches the values without any modification
-* \param[in] roll The roll angle in radians.
-* \param[in] pitch The pitch (elevation) angle in radians.
-* \param[out] yaw The yaw angle in radians
+* \brief Recovers a damaged filter
+* \param[in] kf The filter
+* \param[in] fault The {\ref fusion_fault_flags_t} found
+*
+* The covariance restarts from the initial variances, and cached gains and innovation
+* statistics are discarded. A damaged state is replaced with the initial estimate and
+* bootstrapped anew with the next measurements; as the orientation is bootstrapped from
+* the attitude, a damaged attitude restarts both filters.
 */
-HOT NONNULL LEAF
-STATIC_INLINE void calculate_yaw(register const fix16_t roll, register const fix16_t pitch, register fix16_t *RESTRICT const yaw)
+COLD NONNULL
+static void fusion_recover(fusion_filter_t *const kf, const uint_fast8_t fault)
 {
-    const mf16 *const x2 = kalman_get_state_vector_uc(&kf_orientation);
-    const mf16 *const x3 = kalman_get_state_vector_uc(&kf_attitude);
+    fusion_reset_covariance(kf);
+    fusion_count_overflow(&m_overflows.covarianceResets);
 
-    // fetch axes
-    const fix16_t c21 = x2->data[0][0];
-    const fix16_t c22 = x2->data[1][0];
-    const fix16_t c23 = x2->data[2][0];
+#if FUSION_STEADY_STATE_GAIN
+    fusion_schedule_reset((kf == &kf_attitude) ? &schedule_attitude : &schedule_orientation);
+#endif
+
+#if FUSION_ADAPTIVE_NOISE
+    *((kf == &kf_attitude) ? &noise_attitude : &noise_orientation) = (fusion_noise_t){ { { 0 } } };
+#endif
 
-    const fix16_t c31 = x3->data[0][0];
-    const fix16_t c32 = x3->data[1][0];
-    const fix16_t c33 = x3->data[2][0];
+    if (0 == (fault & FUSION_FAULT_STATE))
+    {
+        return;
+    }
 
-    // calculate partial cross product for C11
-    // C1  = cross([C21 C22 C23], [C31 C32 C33])
-    // -->
-    //      C11 = C22*C33 - C23*C32
-    //      C12 = C23*C31 - C21*C33
-    //      C13 = C21*C32 - C22*C31
-    fix16_t c11 = fix16_sub(fix16_mul(c22, c33), fix16_mul(c23, c32));
+    fusion_reset_state(kf);
+    fusion_count_overflow(&m_overflows.stateResets);
 
-    // calculate pitch
-    *yaw = fix16_atan2(c21, -c11);
+    if (kf == &kf_attitude)
+    {
+        m_attitude_bootstrapped = false;
+    }
+    m_orientation_bootstrapped = false;
 }
 
-/************************************************************************/
-/* Convenience functions                                                */
-/************************************************************************/
+#endif
 
 /*!
-* \brief Fetches the values without any modification
-* \param[out] roll The roll angle in degree.
-* \param[out] pitch The pitch (elevation) angle in degree.
-* \param[out] yaw The yaw (heading, azimuth) angle in degree.
+* \brief Checks a filter for overflows after a fusion stage and recovers it if required
+* \param[in] kf The filter
+* \param[in] stage The fusion stage that last changed the filter
+* \param[in] covariance Set if the stage changed the covariance
 */
-HOT NONNULL LEAF
-void fusion_fetch_angles(register fix16_t *RESTRICT const roll, register fix16_t *RESTRICT const pitch, register fix16_t *RESTRICT const yaw)
+HOT NONNULL
+STATIC_INLINE void fusion_check_overflow(fusion_filter_t *const kf, const fusion_stage_t stage, const bool covariance)
 {
-    // calculate roll and pitch
-    calculate_roll_pitch(roll, pitch);
+#if FUSION_OVERFLOW_CHECK
+    const uint_fast8_t fault = fusion_find_overflow(kf, covariance);
+    if (FUSION_FAULT_NONE != fault)
+    {
+        fusion_count_overflow(&m_overflows.overflows[stage]);
+        fusion_recover(kf, fault);
+    }
+#else
+    (void)kf;
+    (void)stage;
+    (void)covariance;
+#endif
+}
 
-    // calculate yaw
-    calculate_yaw(*roll, *pitch, yaw);
+/*!
+* \brief Fetches and clears the fixed-point overflows and filter resets since the last report
+* \param[out] report The report; NULL to discard the counts
+*/
+void fusion_report_overflows(fusion_overflow_report_t *const report)
+{
+#if FUSION_OVERFLOW_CHECK
+    if (NULL != report)
+    {
+        *report = m_overflows;
+    }
+    m_overflows = (fusion_overflow_report_t){ { 0 } };
+#else
+    if (NULL != report)
+    {
+        *report = (fusion_overflow_report_t){ { 0 } };
+    }
+#endif
 }
 
+/************************************************************************/
+/* State calculation helpers                                            */
+/************************************************************************/
+
 /*!
-* \brief  Returns the maximum value of two 
+* \brief Sanitizes the state variables
 */
-HOT CONST LEAF
-STATIC_INLINE const fix16_t zero_or_value(register const fix16_t value)
+HOT NONNULL
+STATIC_INLINE void fusion_sanitize_state(fusion_filter_t *const kf)
 {
-    return value >= 0 ? value : 0;
+    fusion_matrix_t *const A = &kf->A;
+    fusion_vector_t *const x = &kf->x;
+    
+    // fetch axes
+    v3d c = { x->data[0][0], x->data[1][0], x->data[2][0] };
+
+    // normalize vectors
+    fusion_normalize(&c, &c);
+
+    // re-set to state and state matrix
+    x->data[0][0] = c.x;
+    x->data[1][0] = c.y;
+    x->data[2][0] = c.z;
+
+    fusion_check_overflow(kf, FUSION_STAGE_SANITIZE, false);
 }
 
 /*!
-* \brief Fetches the orientation quaternion.
-* \param[out] quat The orientation quaternion
-*
-* While this method, described at http://www.euclideanspace.com/maths/geometry/rotations/conversions/matrixToQuaternion/index.htm
-* should be computationally faster than opt2, it would result in glitches (i.e. flipping of the rotation axis' signs) around pitch 0, yaw 180.
+* \brief Derives the direction cosine matrix from the filter states
+* \param[out] m The DCM
 *
+* The east and down rows are the orientation and the negated attitude state,
+* the north row is their normalized cross product.
 */
 HOT NONNULL LEAF
-static void fetch_quaternion_opt1(register qf16 *RESTRICT const quat)
+static void derive_dcm(fix16_t m[3][3])
 {
-    const register mf16 *const x2 = kalman_get_state_vector_uc(&kf_orientation);
-    const register mf16 *const x3 = kalman_get_state_vector_uc(&kf_attitude);
+    const fusion_vector_t *const x2 = &kf_orientation.x;
+    const fusion_vector_t *const x3 = &kf_attitude.x;
 
     // m00 = R(1, 1);    m01 = R(1, 2);    m02 = R(1, 3);
     // m10 = R(2, 1);    m11 = R(2, 2);    m12 = R(2, 3);
@@ -715,9 +1523,9 @@ static void fetch_quaternion_opt1(register qf16 *RESTRICT const quat)
     const fix16_t m11 = x2->data[1][0];
     const fix16_t m12 = x2->data[2][0];
 
-    const fix16_t m20 = x3->data[0][0];
-    const fix16_t m21 = x3->data[1][0];
-    const fix16_t m22 = x3->data[2][0];
+    const fix16_t m20 = -x3->data[0][0];
+    const fix16_t m21 = -x3->data[1][0];
+    const fix16_t m22 = -x3->data[2][0];
 
     // calculate cross product for C1
     // m0 = cross([m10 m11 m12], [m20 m21 m22])
@@ -725,28 +1533,84 @@ static void fetch_quaternion_opt1(register qf16 *RESTRICT const quat)
     //      m00 = m11*m22 - m12*m21
     //      m01 = m12*m20 - m10*m22
     //      m02 = m10*m21 - m11*m20
-    fix16_t m00 = fix16_sub(fix16_mul(m11, m22), fix16_mul(m12, m21));
-    fix16_t m01 = fix16_sub(fix16_mul(m12, m20), fix16_mul(m10, m22));
-    fix16_t m02 = fix16_sub(fix16_mul(m10, m21), fix16_mul(m11, m20));
+    v3d m0 = {
+        fix16_sub(fix16_mul(m11, m22), fix16_mul(m12, m21)),
+        fix16_sub(fix16_mul(m12, m20), fix16_mul(m10, m22)),
+        fix16_sub(fix16_mul(m10, m21), fix16_mul(m11, m20))
+    };
 
     // normalize C1 
-    const register fix16_t norm = norm3(m00, m01, m02);
-    m00 = fix16_div(m00, norm);
-    m01 = fix16_div(m01, norm);
-    m02 = fix16_div(m02, norm);
+    fusion_normalize(&m0, &m0);
+    m[0][0] = m0.x;
+    m[0][1] = m0.y;
+    m[0][2] = m0.z;
+
+    m[1][0] = m10;
+    m[1][1] = m11;
+    m[1][2] = m12;
+
+    m[2][0] = m20;
+    m[2][1] = m21;
+    m[2][2] = m22;
+}
 
-    /*
-    From MATLAB code:
+/*!
+* \brief Derives the Euler angles from the direction cosine matrix
+* \param[in] m The DCM
+* \param[out] roll The roll angle in radians.
+* \param[out] pitch The pitch (elevation) angle in radians.
+* \param[out] yaw The yaw (heading, azimuth) angle in radians.
+*/
+HOT NONNULL LEAF
+static void derive_angles(const fix16_t m[3][3], register fix16_t *RESTRICT const roll, register fix16_t *RESTRICT const pitch, register fix16_t *RESTRICT const yaw)
+{
+    // calculate pitch
+    *pitch = output_asin(m[2][0]);
 
-    qw = sqrt(max(0, 1 + m00 + m11 + m22)) / 2;
-    qx = sqrt(max(0, 1 + m00 - m11 - m22)) / 2;
-    qy = sqrt(max(0, 1 - m00 + m11 - m22)) / 2;
-    qz = sqrt(max(0, 1 - m00 - m11 + m22)) / 2;
+    // calculate roll
+    *roll = -output_atan2(-m[2][1], m[2][2]);
 
-    % patch the signs
-    qx = copysign(qx, m21 - m12);
-    qy = copysign(qy, m02 - m20);
-    qz = copysign(qz, m10 - m01);
+    // calculate yaw
+    *yaw = output_atan2(m[1][0], m[0][0]);
+}
+
+/*!
+* \brief  Returns the maximum value of two 
+*/
+HOT CONST LEAF
+STATIC_INLINE const fix16_t zero_or_value(register const fix16_t value)
+{
+    return value >= 0 ? value : 0;
+}
+
+/*!
+* \brief Derives the orientation quaternion from the direction cosine matrix.
+* \param[in] m The DCM
+* \param[out] quat The orientation quaternion
+*
+* While this method, described at http://www.euclideanspace.com/maths/geometry/rotations/conversions/matrixToQuaternion/index.htm
+* should be computationally faster than opt2, it would result in glitches (i.e. flipping of the rotation axis' signs) around pitch 0, yaw 180.
+*
+*/
+HOT NONNULL LEAF
+static void derive_quaternion_opt1(const fix16_t m[3][3], register qf16 *RESTRICT const quat)
+{
+    const fix16_t m00 = m[0][0], m01 = m[0][1], m02 = m[0][2];
+    const fix16_t m10 = m[1][0], m11 = m[1][1], m12 = m[1][2];
+    const fix16_t m20 = m[2][0], m21 = m[2][1], m22 = m[2][2];
+
+    /*
+    From MATLAB code:
+
+    qw = sqrt(max(0, 1 + m00 + m11 + m22)) / 2;
+    qx = sqrt(max(0, 1 + m00 - m11 - m22)) / 2;
+    qy = sqrt(max(0, 1 - m00 + m11 - m22)) / 2;
+    qz = sqrt(max(0, 1 - m00 - m11 + m22)) / 2;
+
+    % patch the signs
+    qx = copysign(qx, m21 - m12);
+    qy = copysign(qy, m02 - m20);
+    qz = copysign(qz, m10 - m01);
 
     q = [qw qx qy qz];
     */
@@ -791,42 +1655,16 @@ static void fetch_quaternion_opt1(register qf16 *RESTRICT const quat)
 }
 
 /*!
-* \brief Fetches the orientation quaternion.
+* \brief Derives the orientation quaternion from the direction cosine matrix.
+* \param[in] m The DCM
 * \param[out] quat The orientation quaternion
 */
 HOT NONNULL LEAF
-static void fetch_quaternion_opt2(register qf16 *RESTRICT const quat)
+static void derive_quaternion_opt2(const fix16_t m[3][3], register qf16 *RESTRICT const quat)
 {
-    const register mf16 *const x2 = kalman_get_state_vector_uc(&kf_orientation);
-    const register mf16 *const x3 = kalman_get_state_vector_uc(&kf_attitude);
-
-    // m00 = R(1, 1);    m01 = R(1, 2);    m02 = R(1, 3);
-    // m10 = R(2, 1);    m11 = R(2, 2);    m12 = R(2, 3);
-    // m20 = R(3, 1);    m21 = R(3, 2);    m22 = R(3, 3);
-
-    const fix16_t m10 = x2->data[0][0];
-    const fix16_t m11 = x2->data[1][0];
-    const fix16_t m12 = x2->data[2][0];
-
-    const fix16_t m20 = -x3->data[0][0];
-    const fix16_t m21 = -x3->data[1][0];
-    const fix16_t m22 = -x3->data[2][0];
-
-    // calculate cross product for C1
-    // m0 = cross([m10 m11 m12], [m20 m21 m22])
-    // -->
-    //      m00 = m11*m22 - m12*m21
-    //      m01 = m12*m20 - m10*m22
-    //      m02 = m10*m21 - m11*m20
-    fix16_t m00 = fix16_sub(fix16_mul(m11, m22), fix16_mul(m12, m21));
-    fix16_t m01 = fix16_sub(fix16_mul(m12, m20), fix16_mul(m10, m22));
-    fix16_t m02 = fix16_sub(fix16_mul(m10, m21), fix16_mul(m11, m20));
-
-    // normalize C1 
-    const register fix16_t norm = norm3(m00, m01, m02);
-    m00 = fix16_div(m00, norm);
-    m01 = fix16_div(m01, norm);
-    m02 = fix16_div(m02, norm);
+    const fix16_t m00 = m[0][0], m01 = m[0][1], m02 = m[0][2];
+    const fix16_t m10 = m[1][0], m11 = m[1][1], m12 = m[1][2];
+    const fix16_t m20 = m[2][0], m21 = m[2][1], m22 = m[2][2];
 
     // "Angel" code
     // http://www.euclideanspace.com/maths/geometry/rotations/conversions/matrixToQuaternion/
@@ -897,113 +1735,948 @@ static void fetch_quaternion_opt2(register qf16 *RESTRICT const quat)
             */
             const fix16_t s = fix16_mul(F16(2), fix16_sqrt(fix16_add(F16(1), fix16_sub(m22, fix16_add(m00, m11)))));
 
-            qw = fix16_div(fix16_sub(m10, m01), s);
-            qx = fix16_div(fix16_add(m02, m20), s);
-            qy = fix16_div(fix16_add(m12, m21), s);
-            qz = fix16_mul(F16(0.25), s);
+            qw = fix16_div(fix16_sub(m10, m01), s);
+            qx = fix16_div(fix16_add(m02, m20), s);
+            qy = fix16_div(fix16_add(m12, m21), s);
+            qz = fix16_mul(F16(0.25), s);
+        }
+    }
+
+    // compose quaternion
+    quat->a = qw;
+    quat->b = qx;
+    quat->c = qy;
+    quat->d = qz;
+
+    // normalizify
+    qf16_normalize(quat, quat);
+}
+
+/*!
+* \brief Fetches the output cache, deriving the requested representations once per filter epoch
+* \param[in] flags The required {\ref fusion_output_flags_t}
+* \return The output cache
+*/
+HOT LEAF
+static const fusion_output_t* fusion_output(register const uint_fast8_t flags)
+{
+    fusion_output_t *const output = &m_output;
+
+    // the quaternion and the angles are both derived from the DCM
+    if (0 == (output->valid & FUSION_OUTPUT_DCM))
+    {
+        derive_dcm(output->dcm);
+        output->valid |= FUSION_OUTPUT_DCM;
+
+#if FUSION_OVERFLOW_CHECK
+        // counted only; the damaged filter state is caught by the stages
+        for (uint_fast8_t i = 0; i < 9; ++i)
+        {
+            if (fusion_is_overflow(output->dcm[i / 3][i % 3]))
+            {
+                fusion_count_overflow(&m_overflows.overflows[FUSION_STAGE_OUTPUT]);
+                break;
+            }
+        }
+#endif
+    }
+
+    const uint_fast8_t missing = flags & ~output->valid;
+    if (0 != (missing & FUSION_OUTPUT_QUATERNION))
+    {
+        derive_quaternion_opt2(output->dcm, &output->quaternion);
+    }
+
+    if (0 != (missing & FUSION_OUTPUT_ANGLES))
+    {
+        derive_angles(output->dcm, &output->roll, &output->pitch, &output->yaw);
+    }
+
+    output->valid |= missing;
+    return output;
+}
+
+/************************************************************************/
+/* Convenience functions                                                */
+/************************************************************************/
+
+/*!
+* \brief Fetches the values without any modification
+* \param[out] roll The roll angle in degree.
+* \param[out] pitch The pitch (elevation) angle in degree.
+* \param[out] yaw The yaw (heading, azimuth) angle in degree.
+*/
+HOT NONNULL LEAF
+void fusion_fetch_angles(register fix16_t *RESTRICT const roll, register fix16_t *RESTRICT const pitch, register fix16_t *RESTRICT const yaw)
+{
+    const fusion_output_t *const output = fusion_output(FUSION_OUTPUT_ANGLES);
+
+    *roll = output->roll;
+    *pitch = output->pitch;
+    *yaw = output->yaw;
+}
+
+/*!
+* \brief Fetches the orientation quaternion.
+* \param[out] quat The orientation quaternion
+*/
+HOT NONNULL LEAF
+void fusion_fetch_quaternion(register qf16 *RESTRICT const quat)
+{
+    *quat = fusion_output(FUSION_OUTPUT_QUATERNION)->quaternion;
+}
+
+/*!
+* \brief Fetches the direction cosine matrix.
+* \param[out] dcm The 3x3 DCM with the north, east and down axes in body coordinates as rows
+*/
+HOT NONNULL LEAF
+void fusion_fetch_dcm(register mf16 *RESTRICT const dcm)
+{
+    const fusion_output_t *const output = fusion_output(FUSION_OUTPUT_DCM);
+
+    dcm->rows = 3;
+    dcm->columns = 3;
+    dcm->errors = 0;
+
+    for (uint_fast8_t row = 0; row < 3; ++row)
+    {
+        dcm->data[row][0] = output->dcm[row][0];
+        dcm->data[row][1] = output->dcm[row][1];
+        dcm->data[row][2] = output->dcm[row][2];
+    }
+}
+
+/************************************************************************/
+/* State prediction                                                     */
+/************************************************************************/
+
+/*!
+* \brief Performs a fast state update by using knowledge about the matrix structure
+* \param[in] kf The filter whose state to update
+* \param[in] rates The angular velocities to integrate with; NULL to use the estimated ones
+* \param[in] deltaT The time differential
+*
+* The estimated angular velocities are kept constant in either case.
+*/
+HOT
+STATIC_INLINE void fusion_fastpredict_X(fusion_filter_t *const kf, const v3d *const rates, const register fix16_t deltaT)
+{
+    fusion_vector_t *const x = &kf->x;
+
+    /*
+        Transition matrix layout:
+
+        A_rp = [0 0 0,     0  Cn3 -Cn2;
+                0 0 0,  -Cn3    0  Cn1;
+                0 0 0,   Cn2 -Cn1    0;
+
+                0 0 0,     0 0 0;
+                0 0 0,     0 0 0;
+                0 0 0,     0 0 0];
+    */
+
+    // fetch estimated DCM components
+    register const fix16_t c1 = x->data[0][0];
+    register const fix16_t c2 = x->data[1][0];
+    register const fix16_t c3 = x->data[2][0];
+
+    // fetch estimated angular velocities
+    register const fix16_t gx = x->data[3][0];
+    register const fix16_t gy = x->data[4][0];
+    register const fix16_t gz = x->data[5][0];
+
+    // fetch the angular velocities to integrate with
+    register const fix16_t wx = (NULL != rates) ? rates->x : gx;
+    register const fix16_t wy = (NULL != rates) ? rates->y : gy;
+    register const fix16_t wz = (NULL != rates) ? rates->z : gz;
+    
+    // solve differential equations
+    register const fix16_t d_c1 = fix16_sub(fix16_mul(c3, wy), fix16_mul(c2, wz)); //    0*wx  +   c3*wy  + (-c2*wz) = c3*wy - c2*wz
+    register const fix16_t d_c2 = fix16_sub(fix16_mul(c1, wz), fix16_mul(c3, wx)); // (-c3*wx) +    0*wy  +   c1*wz  = c1*wz - c3*wx
+    register const fix16_t d_c3 = fix16_sub(fix16_mul(c2, wx), fix16_mul(c1, wy)); //   c2*wx  + (-c1*wy) +    0*wz  = c2*wx - c1*wy
+
+    // integrate
+    x->data[0][0] = fix16_add(c1, fix16_mul(d_c1, deltaT));
+    x->data[1][0] = fix16_add(c2, fix16_mul(d_c2, deltaT));
+    x->data[2][0] = fix16_add(c3, fix16_mul(d_c3, deltaT));
+
+    // keep constant.
+    x->data[3][0] = gx;
+    x->data[4][0] = gy;
+    x->data[5][0] = gz;
+}
+
+/*!
+* \brief Performs a fast covariance prediction P = A*P*A' + n*Q by using knowledge about the matrix structure
+* \param[in] kf The filter whose covariance to update
+* \param[in] steps The number n of prediction steps accumulated in A
+*
+* Requires A to be set up by {\ref update_state_matrix_from_state} and optionally
+* {\ref accumulate_state_matrix_from_state}. P is assumed to be symmetric and Q to be diagonal.
+* For n > 1, the propagation of the process noise within the steps is neglected.
+*/
+RAMFUNC HOT NONNULL LEAF
+static void fusion_fastpredict_P(fusion_filter_t *const kf, register const uint_fast8_t steps)
+{
+    fusion_matrix_t *const P = &kf->P;
+    const fusion_matrix_t *const A = &kf->A;
+    const fusion_diagonal_t *const Q = &kf->Q;
+
+    /*
+        Transition matrix layout:
+
+        A = [I S;     S = [   0  Cn3 -Cn2;
+             0 I]         -Cn3    0  Cn1;
+                           Cn2 -Cn1    0] * dT
+
+        With P = [P11 P12; P12' P22] this yields
+
+        A*P*A' = [P11 + S*P12' + M*S',  M;
+                  M',                 P22]
+
+        where M = P12 + S*P22. Every row of S has two nonzero elements
+        at the columns (row+1) mod 3 and (row+2) mod 3.
+    */
+
+    register int_fast8_t i, j;
+    register const fix16_t q_scale = fix16_from_int(steps);
+    fix16_t S[3][3];
+    fix16_t M[3][3];
+
+    // fetch the skew-symmetric block
+    for (i = 0; i < 3; ++i)
+    {
+        for (j = 0; j < 3; ++j)
+        {
+            S[i][j] = A->data[i][3 + j];
+        }
+    }
+
+    // M = P12 + S*P22
+    for (i = 0; i < 3; ++i)
+    {
+        const int_fast8_t k1 = (i + 1) % 3;
+        const int_fast8_t k2 = (i + 2) % 3;
+
+        for (j = 0; j < 3; ++j)
+        {
+            register fix16_t value = P->data[i][3 + j];
+            value = fix16_add(value, fix16_mul(S[i][k1], P->data[3 + k1][3 + j]));
+            value = fix16_add(value, fix16_mul(S[i][k2], P->data[3 + k2][3 + j]));
+            M[i][j] = value;
+        }
+    }
+
+    // P11 = P11 + S*P12' + M*S' + Q11, upper triangle only
+    for (i = 0; i < 3; ++i)
+    {
+        const int_fast8_t k1 = (i + 1) % 3;
+        const int_fast8_t k2 = (i + 2) % 3;
+
+        for (j = i; j < 3; ++j)
+        {
+            const int_fast8_t l1 = (j + 1) % 3;
+            const int_fast8_t l2 = (j + 2) % 3;
+
+            register fix16_t value = P->data[i][j];
+            if (i == j)
+            {
+                value = fix16_add(value, fix16_mul(diagonal_get(Q, i), q_scale));
+            }
+            value = fix16_add(value, fix16_mul(S[i][k1], P->data[j][3 + k1]));
+            value = fix16_add(value, fix16_mul(S[i][k2], P->data[j][3 + k2]));
+            value = fix16_add(value, fix16_mul(M[i][l1], S[j][l1]));
+            value = fix16_add(value, fix16_mul(M[i][l2], S[j][l2]));
+
+            P->data[i][j] = value;
+            P->data[j][i] = value;
+        }
+    }
+
+    // P12 = M, since Q12 is zero
+    for (i = 0; i < 3; ++i)
+    {
+        for (j = 0; j < 3; ++j)
+        {
+            register const fix16_t value = M[i][j];
+            P->data[i][3 + j] = value;
+            P->data[3 + j][i] = value;
+        }
+    }
+
+    // P22 = P22 + Q22, diagonal only
+    for (i = 3; i < 6; ++i)
+    {
+        P->data[i][i] = fix16_add(P->data[i][i], fix16_mul(diagonal_get(Q, i), q_scale));
+    }
+}
+
+#if FUSION_SHARED_RATES
+
+/*!
+* \brief Performs the covariance prediction P = P + S*Pw*S' + n*Q of the orientation axes
+* \param[in] steps The number n of prediction steps accumulated in {\ref m_orientation_coupling}
+*
+* With the angular velocities taken from the attitude filter, the transition of the axes is
+* the identity and the covariance Pw of the shared rates, the lower right block of the attitude
+* covariance, enters through S. The correlation between the orientation axes and the attitude
+* rates is neglected.
+*/
+RAMFUNC HOT LEAF
+static void fusion_fastpredict_P_axes(register const uint_fast8_t steps)
+{
+    fusion_matrix_t *const P = &kf_orientation.P;
+    const fusion_diagonal_t *const Q = &kf_orientation.Q;
+    const fusion_matrix_t *const Pw = &kf_attitude.P;
+    const fix16_t (*const S)[3] = (const fix16_t (*)[3])m_orientation_coupling;
+
+    register int_fast8_t i, j;
+    register const fix16_t q_scale = fix16_from_int(steps);
+    fix16_t M[3][3];
+
+    // M = S*Pw; every row of S has two nonzero elements, see fusion_fastpredict_P
+    for (i = 0; i < 3; ++i)
+    {
+        const int_fast8_t k1 = (i + 1) % 3;
+        const int_fast8_t k2 = (i + 2) % 3;
+
+        for (j = 0; j < 3; ++j)
+        {
+            M[i][j] = fix16_add(fix16_mul(S[i][k1], Pw->data[3 + k1][3 + j]), fix16_mul(S[i][k2], Pw->data[3 + k2][3 + j]));
+        }
+    }
+
+    // P = P + M*S' + Q, upper triangle only
+    for (i = 0; i < 3; ++i)
+    {
+        for (j = i; j < 3; ++j)
+        {
+            const int_fast8_t l1 = (j + 1) % 3;
+            const int_fast8_t l2 = (j + 2) % 3;
+
+            register fix16_t value = P->data[i][j];
+            if (i == j)
+            {
+                value = fix16_add(value, fix16_mul(fix16_add(diagonal_get(Q, i), shared_rates_axis_noise), q_scale));
+            }
+            value = fix16_add(value, fix16_mul(M[i][l1], S[j][l1]));
+            value = fix16_add(value, fix16_mul(M[i][l2], S[j][l2]));
+
+            P->data[i][j] = value;
+            P->data[j][i] = value;
+        }
+    }
+}
+
+#endif
+
+/*!
+* \brief Performs the structured covariance prediction of a filter
+* \param[in] kf The filter whose covariance to update
+* \param[in] steps The number of prediction steps accumulated in its transition
+*/
+HOT NONNULL
+STATIC_INLINE void fusion_propagate_P(fusion_filter_t *const kf, register const uint_fast8_t steps)
+{
+#if FUSION_SHARED_RATES
+    if (&kf_orientation == kf)
+    {
+        fusion_fastpredict_P_axes(steps);
+        return;
+    }
+#endif
+
+    fusion_fastpredict_P(kf, steps);
+}
+
+#if FUSION_SEQUENTIAL_UPDATE
+
+#if FUSION_ADAPTIVE_NOISE
+
+/*!
+* \brief Updates the innovation statistics of an observation and adapts its noise
+* \param[inout] power The mean squared innovation of the observation
+* \param[in] innovation The innovation z(m) - h*x
+* \param[in] hPh The innovation variance explained by the state, h*P*h'
+* \param[in] r The configured noise of the observation
+* \return The adapted noise
+*
+* For a consistent filter E(y^2) = h*P*h' + r, hence
+*
+*   E(y^2) = E(y^2) + w*(y^2 - E(y^2))
+*   r' = E(y^2) - h*P*h', bounded to [floor*r, ceiling*r]
+*
+* The current innovation enters the mean first, so an outlier is weighted down by the very update it disturbs.
+*/
+HOT LEAF NONNULL
+STATIC_INLINE fix16_t fusion_adapt_noise(fix16_t *const power, register fix16_t innovation, register const fix16_t hPh, register const fix16_t r)
+{
+    if (innovation > adaptive_innovation_limit) innovation = adaptive_innovation_limit;
+    else if (innovation < -adaptive_innovation_limit) innovation = -adaptive_innovation_limit;
+
+    // seed with the configured noise
+    register fix16_t mean = *power;
+    if (0 == mean)
+    {
+        mean = fix16_add(hPh, r);
+    }
+
+    mean = fix16_add(mean, fix16_mul(adaptive_noise_weight, fix16_sub(fix16_mul(innovation, innovation), mean)));
+    *power = mean;
+
+    register const fix16_t lower = fix16_mul(r, adaptive_noise_floor);
+    register const fix16_t upper = fix16_mul(r, adaptive_noise_ceiling);
+    register const fix16_t adapted = fix16_sub(mean, hPh);
+    if (adapted < lower) return lower;
+    if (adapted > upper) return upper;
+    return adapted;
+}
+
+#endif
+
+/*!
+* \brief Performs the measurement update as a sequence of scalar updates
+* \param[in] kf The filter to update
+* \param[in] kfm The measurement; R must be diagonal
+* \param[out] gain Receives the gains and innovation variances; may be NULL
+* \param[inout] power The innovation statistics of the observations; may be NULL to use R as configured
+*
+* For every observation m with observation row h and noise r:
+*
+*   s = h*P*h' + r
+*   K = P*h' / s
+*   x = x + K*(z(m) - h*x)
+*   P = P - K*(P*h')'
+*
+* Since R is diagonal, this equals the batch update of {\ref kalman_correct_uc}.
+* With {\ref FUSION_ADAPTIVE_NOISE}, r is taken from {\ref fusion_adapt_noise} instead.
+*
+* \param[in] states The number of states; a constant with {\ref FUSION_FIXED_KERNELS}, so that the loops unroll
+*/
+HOT
+STATIC_INLINE void fusion_correct_sequential_states(fusion_filter_t *const kf, const fusion_observation_t *const kfm, fusion_gain_t *const gain, fix16_t *const power, const int_fast8_t states)
+{
+    fusion_vector_t *const x = &kf->x;
+    fusion_matrix_t *const P = &kf->P;
+    const fusion_matrix_t *const H = &kfm->H;
+    const fusion_diagonal_t *const R = &kfm->R;
+    const fusion_vector_t *const z = &kfm->z;
+
+    register const int_fast8_t observations = z->rows;
+
+    fix16_t PHt[FIXMATRIX_MAX_SIZE];
+    fix16_t K_local[FIXMATRIX_MAX_SIZE];
+
+    for (int_fast8_t m = 0; m < observations; ++m)
+    {
+        const fix16_t *const h = H->data[m];
+        fix16_t *const K = (NULL != gain) ? gain->K[m] : K_local;
+        register int_fast8_t i, j, k;
+
+        // P*h' and h*x; the observation rows are sparse
+        register fix16_t hx = 0;
+        for (i = 0; i < states; ++i)
+        {
+            PHt[i] = 0;
+        }
+        for (k = 0; k < states; ++k)
+        {
+            if (0 == h[k]) continue;
+
+            hx = fix16_add(hx, fix16_mul(h[k], x->data[k][0]));
+            for (i = 0; i < states; ++i)
+            {
+                PHt[i] = fix16_add(PHt[i], fix16_mul(P->data[i][k], h[k]));
+            }
+        }
+
+        // innovation covariance s = h*P*h' + r
+        register fix16_t hPh = 0;
+        for (k = 0; k < states; ++k)
+        {
+            if (0 == h[k]) continue;
+            hPh = fix16_add(hPh, fix16_mul(h[k], PHt[k]));
+        }
+
+        register const fix16_t innovation = fix16_sub(z->data[m][0], hx);
+#if FUSION_ADAPTIVE_NOISE
+        register const fix16_t r = (NULL != power) ? fusion_adapt_noise(&power[m], innovation, hPh, diagonal_get(R, m)) : diagonal_get(R, m);
+#else
+        (void)power;
+        register const fix16_t r = diagonal_get(R, m);
+#endif
+        register const fix16_t s = fix16_add(hPh, r);
+
+        // the only division of the update
+        register const fix16_t inverse_s = fix16_div(F16_ONE, s);
+        if (NULL != gain)
+        {
+            gain->s[m] = s;
+        }
+
+        // gain and state update
+        for (i = 0; i < states; ++i)
+        {
+            K[i] = fix16_mul(PHt[i], inverse_s);
+            x->data[i][0] = fix16_add(x->data[i][0], fix16_mul(K[i], innovation));
+        }
+
+        // covariance update, upper triangle only
+        for (i = 0; i < states; ++i)
+        {
+            for (j = i; j < states; ++j)
+            {
+                register const fix16_t value = fix16_sub(P->data[i][j], fix16_mul(K[i], PHt[j]));
+                P->data[i][j] = value;
+                P->data[j][i] = value;
+            }
+        }
+    }
+}
+
+/*!
+* \brief Performs the measurement update as a sequence of scalar updates, see {\ref fusion_correct_sequential_states}
+* \param[in] kf The filter to update
+* \param[in] kfm The measurement; R must be diagonal
+* \param[out] gain Receives the gains and innovation variances; may be NULL
+* \param[inout] power The innovation statistics of the observations; may be NULL to use R as configured
+*/
+RAMFUNC HOT
+static void fusion_correct_sequential(fusion_filter_t *const kf, const fusion_observation_t *const kfm, fusion_gain_t *const gain, fix16_t *const power)
+{
+#if FUSION_FIXED_KERNELS && FUSION_SHARED_RATES
+    // constant trip counts per filter dimension
+    if (KF_ORIENTATION_STATES == kf->x.rows)
+    {
+        fusion_correct_sequential_states(kf, kfm, gain, power, KF_ORIENTATION_STATES);
+        return;
+    }
+    fusion_correct_sequential_states(kf, kfm, gain, power, KF_ATTITUDE_STATES);
+#elif FUSION_FIXED_KERNELS
+    // constant trip counts, so that the loops unroll
+    fusion_correct_sequential_states(kf, kfm, gain, power, KF_ATTITUDE_STATES);
+#else
+    fusion_correct_sequential_states(kf, kfm, gain, power, kf->x.rows);
+#endif
+}
+
+#endif
+
+#if !FUSION_SEQUENTIAL_UPDATE && FUSION_FIXED_KERNELS
+
+/*!
+* \brief Performs the measurement update with the fixed-size kernels
+* \param[in] kf The filter to update
+* \param[in] kfm The measurement with either six or three observations
+*
+* With {\ref FUSION_SHARED_RATES}, the three orientation axes are observed directly, H = I.
+*
+*   y = z - H*x
+*   S = H*P*H' + R
+*   K = P*H' * S^-1
+*   x = x + K*y
+*   P = P - K*(P*H')'
+*
+* Equals {\ref kalman_correct_uc}, with S inverted through its Cholesky decomposition.
+*/
+HOT NONNULL
+static void fusion_correct_batch(fusion_filter_t *const kf, const fusion_observation_t *const kfm)
+{
+    fusion_vector_t *const x = &kf->x;
+    fusion_matrix_t *const P = &kf->P;
+    const fusion_matrix_t *const H = &kfm->H;
+    const fusion_diagonal_t *const R = &kfm->R;
+    const fusion_vector_t *const z = &kfm->z;
+
+    register const int_fast8_t observations = z->rows;
+    register int_fast8_t i, j;
+    mf16 y, PHt, S, K;
+
+    // predicted measurement, P*H' and H*P*H'
+#if FUSION_SHARED_RATES
+    const bool axes = (KF_ORIENTATION_STATES == x->rows);
+    if (axes)
+    {
+        mf16_mul_3x3_3x1(&y, H, x);
+        mf16_mul_bt_3x3_3x3(&PHt, P, H);
+        mf16_mul_3x3_3x3(&S, H, &PHt);
+    }
+    else
+#endif
+    if (KFM_GYRO == observations)
+    {
+        mf16_mul_3x6_6x1(&y, H, x);
+        mf16_mul_bt_6x6_3x6(&PHt, P, H);
+        mf16_mul_3x6_6x3(&S, H, &PHt);
+    }
+    else
+    {
+        mf16_mul_6x6_6x1(&y, H, x);
+        mf16_mul_bt_6x6_6x6(&PHt, P, H);
+        mf16_mul_6x6_6x6(&S, H, &PHt);
+    }
+
+    // innovation y = z - H*x and its covariance S = H*P*H' + R
+    for (i = 0; i < observations; ++i)
+    {
+        y.data[i][0] = fix16_sub(z->data[i][0], y.data[i][0]);
+        for (j = 0; j < observations; ++j)
+        {
+            S.data[i][j] = fix16_add(S.data[i][j], R->data[i][j]);
+        }
+    }
+
+    // S^-1 from the Cholesky decomposition; a failed decomposition leaves the covariance unusable
+    S.errors = 0;
+    mf16_cholesky(&S, &S);
+    mf16_invert_lt(&S, &S);
+    P->errors |= S.errors;
+
+    // gain, state and covariance update; S is reused for K*y
+#if FUSION_SHARED_RATES
+    if (axes)
+    {
+        mf16_mul_3x3_3x3(&K, &PHt, &S);
+        mf16_mul_3x3_3x1(&S, &K, &y);
+        mf16_sub_abt_symmetric_3x3(P, &K, &PHt);
+    }
+    else
+#endif
+    if (KFM_GYRO == observations)
+    {
+        mf16_mul_6x3_3x3(&K, &PHt, &S);
+        mf16_mul_6x3_3x1(&S, &K, &y);
+        mf16_sub_abt_symmetric_6x3(P, &K, &PHt);
+    }
+    else
+    {
+        mf16_mul_6x6_6x6(&K, &PHt, &S);
+        mf16_mul_6x6_6x1(&S, &K, &y);
+        mf16_sub_abt_symmetric_6x6(P, &K, &PHt);
+    }
+
+    for (i = 0; i < x->rows; ++i)
+    {
+        x->data[i][0] = fix16_add(x->data[i][0], S.data[i][0]);
+    }
+}
+
+#endif
+
+#if FUSION_ADAPTIVE_NOISE
+
+/*!
+* \brief Fetches the innovation statistics of a filter
+* \param[in] kf The filter
+* \param[in] regime The observation regime
+* \return The statistics of the observations of the regime
+*/
+HOT CONST NONNULL
+STATIC_INLINE fix16_t* fusion_noise_of(const fusion_filter_t *const kf, const fusion_regime_t regime)
+{
+    return ((kf == &kf_attitude) ? &noise_attitude : &noise_orientation)->power[regime];
+}
+
+#endif
+
+#if FUSION_STEADY_STATE_GAIN
+
+/*!
+* \brief Fetches the gain schedule of a filter
+* \param[in] kf The filter
+* \return The gain schedule
+*/
+HOT CONST NONNULL
+STATIC_INLINE fusion_schedule_t* fusion_schedule_of(const fusion_filter_t *const kf)
+{
+    return (kf == &kf_attitude) ? &schedule_attitude : &schedule_orientation;
+}
+
+/*!
+* \brief Observes the state through a sparse observation row
+* \param[in] h The observation row
+* \param[in] x The state vector
+* \return h*x
+*/
+HOT LEAF NONNULL
+STATIC_INLINE fix16_t fusion_observe(const fix16_t *const h, const fusion_vector_t *const x)
+{
+    register fix16_t hx = 0;
+    for (int_fast8_t k = 0; k < x->rows; ++k)
+    {
+        if (0 == h[k]) continue;
+        hx = fix16_add(hx, fix16_mul(h[k], x->data[k][0]));
+    }
+    return hx;
+}
+
+/*!
+* \brief Runs the covariance prediction that was skipped while the filter was steady
+* \param[in] kf The filter
+* \param[in] schedule The gain schedule of the filter
+*/
+HOT NONNULL
+STATIC_INLINE void fusion_catch_up_predict(fusion_filter_t *const kf, fusion_schedule_t *const schedule)
+{
+    if (0 != schedule->predict_pending)
+    {
+        fusion_propagate_P(kf, schedule->predict_pending);
+        schedule->predict_pending = 0;
+    }
+}
+
+/*!
+* \brief Applies a measurement using the cached gain of a regime
+* \param[in] kf The filter to update
+* \param[in] kfm The measurement
+* \param[in] schedule The gain schedule of the filter
+* \param[in] regime The observation regime
+* \return false if an innovation left its gate; the state is then unchanged
+*
+* The covariance is not touched. The innovations are gated against the state before
+* the update, then applied in the same order as in {\ref fusion_correct_sequential}.
+*/
+HOT NONNULL
+STATIC_INLINE bool fusion_correct_steady(fusion_filter_t *const kf, const fusion_observation_t *const kfm, const fusion_schedule_t *const schedule, const fusion_regime_t regime)
+{
+    fusion_vector_t *const x = &kf->x;
+    const fusion_matrix_t *const H = &kfm->H;
+    const fusion_vector_t *const z = &kfm->z;
+    const fusion_gain_t *const gain = &schedule->gain[regime];
+    const fix16_t *const bound = schedule->bound[regime];
+
+    register const int_fast8_t states = x->rows;
+    register const int_fast8_t observations = z->rows;
+    register int_fast8_t m, i;
+
+    // detect transients
+    for (m = 0; m < observations; ++m)
+    {
+        register const fix16_t innovation = fix16_sub(z->data[m][0], fusion_observe(H->data[m], x));
+        if (fix16_abs(innovation) > bound[m])
+        {
+            return false;
         }
     }
 
-    // compose quaternion
-    quat->a = qw;
-    quat->b = qx;
-    quat->c = qy;
-    quat->d = qz;
+    // state update with the cached gain
+    for (m = 0; m < observations; ++m)
+    {
+        register const fix16_t innovation = fix16_sub(z->data[m][0], fusion_observe(H->data[m], x));
+        for (i = 0; i < states; ++i)
+        {
+            x->data[i][0] = fix16_add(x->data[i][0], fix16_mul(gain->K[m][i], innovation));
+        }
+    }
 
-    // normalizify
-    qf16_normalize(quat, quat);
+    return true;
 }
 
 /*!
-* \brief Fetches the orientation quaternion.
-* \param[out] quat The orientation quaternion
+* \brief Tracks the convergence of the covariance after a full measurement update
+* \param[in] kf The filter that was updated
+* \param[in] schedule The gain schedule of the filter
+* \param[in] regime The observation regime of the update
+* \param[in] observations The number of observations of the update
+*
+* The gain of the update is cached and enabled once the trace of P changed by less than
+* {\ref steady_state_tolerance} for {\ref steady_state_count} consecutive updates.
 */
-HOT NONNULL LEAF
-void fusion_fetch_quaternion(register qf16 *RESTRICT const quat)
+HOT NONNULL
+static void fusion_track_convergence(const fusion_filter_t *const kf, fusion_schedule_t *const schedule, const fusion_regime_t regime, const int_fast8_t observations)
 {
-    fetch_quaternion_opt2(quat);
+    const fusion_matrix_t *const P = &kf->P;
+
+    register fix16_t trace = 0;
+    for (int_fast8_t i = 0; i < P->rows; ++i)
+    {
+        trace = fix16_add(trace, P->data[i][i]);
+    }
+
+    register const fix16_t change = fix16_abs(fix16_sub(trace, schedule->trace[regime]));
+    schedule->trace[regime] = trace;
+
+    if (change > fix16_mul(steady_state_tolerance, trace))
+    {
+        fusion_schedule_reset(schedule);
+        return;
+    }
+
+    if (schedule->stable < steady_state_count)
+    {
+        ++schedule->stable;
+        return;
+    }
+
+    // converged; derive the innovation gates and enable the gain
+    const fusion_gain_t *const gain = &schedule->gain[regime];
+    for (int_fast8_t m = 0; m < observations; ++m)
+    {
+        schedule->bound[regime][m] = fix16_mul(steady_state_gate, fix16_sqrt(gain->s[m]));
+    }
+
+    schedule->valid[regime] = true;
+    schedule->steady = true;
 }
 
-/************************************************************************/
-/* State prediction                                                     */
-/************************************************************************/
+#endif
 
 /*!
-* \brief Performs a fast state update by using knowledge about the matrix structure
-* \param[in] kf The filter whose state to update
-* \param[in] deltaT The time differential
+* \brief Performs the covariance prediction of a filter
+* \param[in] kf The filter to predict
+* \param[in] steps The number of prediction steps accumulated in A
 */
 HOT NONNULL
-STATIC_INLINE void fusion_fastpredict_X(kalman16_uc_t *const kf, const register fix16_t deltaT)
+STATIC_INLINE void fusion_predict_covariance(fusion_filter_t *const kf, register const uint_fast8_t steps)
 {
-    mf16 *const x = kalman_get_state_vector_uc(kf);
-
-    /*
-        Transition matrix layout:
-
-        A_rp = [0 0 0,     0  Cn3 -Cn2;
-                0 0 0,  -Cn3    0  Cn1;
-                0 0 0,   Cn2 -Cn1    0;
+#if FUSION_STEADY_STATE_GAIN
+    fusion_schedule_t *const schedule = fusion_schedule_of(kf);
+    if (schedule->steady)
+    {
+        schedule->predict_pending = steps;
+        return;
+    }
+#endif
 
-                0 0 0,     0 0 0;
-                0 0 0,     0 0 0;
-                0 0 0,     0 0 0];
-    */
+    fusion_propagate_P(kf, steps);
+}
 
-    // fetch estimated DCM components
-    register const fix16_t c1 = x->data[0][0];
-    register const fix16_t c2 = x->data[1][0];
-    register const fix16_t c3 = x->data[2][0];
+/*!
+* \brief Performs the measurement update of a filter
+* \param[in] kf The filter to update
+* \param[in] kfm The measurement
+* \param[in] regime The observation regime of the measurement
+*/
+HOT NONNULL
+STATIC_INLINE void fusion_correct(fusion_filter_t *const kf, fusion_observation_t *const kfm, const fusion_regime_t regime)
+{
+#if FUSION_ADAPTIVE_NOISE
+    fix16_t *const power = fusion_noise_of(kf, regime);
+#elif FUSION_SEQUENTIAL_UPDATE
+    fix16_t *const power = NULL;
+#endif
 
-    // fetch estimated angular velocities
-    register const fix16_t gx = x->data[3][0];
-    register const fix16_t gy = x->data[4][0];
-    register const fix16_t gz = x->data[5][0];
-    
-    // solve differential equations
-    register const fix16_t d_c1 = fix16_sub(fix16_mul(c3, gy), fix16_mul(c2, gz)); //    0*gx  +   c3*gy  + (-c2*gz) = c3*gy - c2*gz
-    register const fix16_t d_c2 = fix16_sub(fix16_mul(c1, gz), fix16_mul(c3, gx)); // (-c3*gx) +    0*gy  +   c1*gz  = c1*gz - c3*gx
-    register const fix16_t d_c3 = fix16_sub(fix16_mul(c2, gx), fix16_mul(c1, gy)); //   c2*gx  + (-c1*gy) +    0*gz  = c2*gx - c1*gy
+#if FUSION_STEADY_STATE_GAIN
+    fusion_schedule_t *const schedule = fusion_schedule_of(kf);
+    if (schedule->steady && schedule->valid[regime])
+    {
+        if (fusion_correct_steady(kf, kfm, schedule, regime))
+        {
+            return;
+        }
 
-    // integrate
-    x->data[0][0] = fix16_add(c1, fix16_mul(d_c1, deltaT));
-    x->data[1][0] = fix16_add(c2, fix16_mul(d_c2, deltaT));
-    x->data[2][0] = fix16_add(c3, fix16_mul(d_c3, deltaT));
+        // transient; continue with the full filter
+        fusion_schedule_reset(schedule);
+    }
 
-    // keep constant.
-    x->data[3][0] = gx;
-    x->data[4][0] = gy;
-    x->data[5][0] = gz;
+    fusion_catch_up_predict(kf, schedule);
+    fusion_correct_sequential(kf, kfm, &schedule->gain[regime], power);
+    fusion_track_convergence(kf, schedule, regime, kfm->z.rows);
+#elif FUSION_SEQUENTIAL_UPDATE
+    (void)regime;
+    fusion_correct_sequential(kf, kfm, NULL, power);
+#elif FUSION_FIXED_KERNELS
+    (void)regime;
+    fusion_correct_batch(kf, kfm);
+#else
+    (void)regime;
+    kalman_correct_uc(kf, kfm);
+#endif
 }
 
 /*!
-* \brief Performs a prediction of the current Euler angles based on the time difference to the previous prediction/update iteration.
-* \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
+* \brief Performs the prediction over a number of steps
+* \param[in] gyro The angular velocities of every step; NULL to use the estimated ones
+* \param[in] deltaT The time differences of every step
+* \param[in] count The number of steps
+*
+* The DCM axes are integrated in every step while the transitions are accumulated,
+* so that the covariance is propagated only once.
 */
 HOT
-void fusion_predict(register const fix16_t deltaT)
+static void fusion_predict_steps(const v3d *const gyro, const fix16_t *const deltaT, register const uint_fast8_t count)
 {
-    mf16 *const x2 = kalman_get_state_vector_uc(&kf_orientation);
-    mf16 *const x3 = kalman_get_state_vector_uc(&kf_attitude);
-    
-    mf16 *const P2 = kalman_get_system_covariance_uc(&kf_orientation);
-    mf16 *const P3 = kalman_get_system_covariance_uc(&kf_attitude);
-    
-    // update state matrix
-    update_state_matrix_from_state(&kf_attitude, deltaT);
-    update_state_matrix_from_state(&kf_orientation, deltaT);
+    for (uint_fast8_t k = 0; k < count; ++k)
+    {
+        const v3d *const rates = (NULL != gyro) ? &gyro[k] : NULL;
+
+        // update state matrix
+        if (0 == k)
+        {
+            update_state_matrix_from_state(&kf_attitude, deltaT[k]);
+#if FUSION_SHARED_RATES
+            update_orientation_coupling(deltaT[k], false);
+#else
+            update_state_matrix_from_state(&kf_orientation, deltaT[k]);
+#endif
+        }
+        else
+        {
+            accumulate_state_matrix_from_state(&kf_attitude, deltaT[k]);
+#if FUSION_SHARED_RATES
+            update_orientation_coupling(deltaT[k], true);
+#else
+            accumulate_state_matrix_from_state(&kf_orientation, deltaT[k]);
+#endif
+        }
+
+#if FUSION_SHARED_RATES
+        // the orientation axes follow the rates estimated by the attitude filter
+        const v3d shared = { kf_attitude.x.data[3][0], kf_attitude.x.data[4][0], kf_attitude.x.data[5][0] };
+        const v3d *const orientation_rates = (NULL != rates) ? rates : &shared;
+#else
+        const v3d *const orientation_rates = rates;
+#endif
 
-    // predict state
-    fusion_fastpredict_X(&kf_attitude, deltaT);
-    fusion_fastpredict_X(&kf_orientation, deltaT);
+        // predict state
+        fusion_fastpredict_X(&kf_attitude, rates, deltaT[k]);
+        fusion_fastpredict_X(&kf_orientation, orientation_rates, deltaT[k]);
+    }
 
     // predict covariance
-    kalman_predict_P_uc(&kf_attitude);
-    kalman_predict_P_uc(&kf_orientation);
+    fusion_predict_covariance(&kf_attitude, count);
+    fusion_predict_covariance(&kf_orientation, count);
+
+    fusion_check_overflow(&kf_attitude, FUSION_STAGE_PREDICT, true);
+    fusion_check_overflow(&kf_orientation, FUSION_STAGE_PREDICT, true);
 
     // re-orthogonalize and update state matrix
     fusion_sanitize_state(&kf_attitude);
     fusion_sanitize_state(&kf_orientation);
+
+    // both filters await their correction
+    m_attitude_corrected = false;
+    m_orientation_corrected = false;
+    fusion_output_invalidate();
+}
+
+/*!
+* \brief Performs a prediction of the current Euler angles based on the time difference to the previous prediction/update iteration.
+* \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
+*/
+HOT
+void fusion_predict(register const fix16_t deltaT)
+{
+    const fix16_t step = deltaT;
+    fusion_predict_steps(NULL, &step, 1);
+}
+
+/*!
+* \brief Performs a prediction over a burst of gyroscope samples.
+* \param[in] gyro The gyroscope samples, oldest first.
+* \param[in] deltaT The time difference in seconds of every sample to its predecessor.
+* \param[in] count The number of samples.
+*/
+HOT
+void fusion_predict_batch(const v3d *const gyro, const fix16_t *const deltaT, register const uint_fast8_t count)
+{
+    if (0 == count)
+    {
+        return;
+    }
+
+    fusion_predict_steps(gyro, deltaT, count);
 }
 
 /************************************************************************/
@@ -1066,7 +2739,7 @@ void fusion_update_attitude_gyro(register const fix16_t deltaT)
     /* Prepare measurement                                                  */
     /************************************************************************/
     {
-        mf16 *const z = &kfm_gyro.z;
+        fusion_vector_t *const z = &kfm_gyro.z;
 
         matrix_set(z, 0, 0, m_gyroscope.x);
         matrix_set(z, 1, 0, m_gyroscope.y);
@@ -1077,7 +2750,8 @@ void fusion_update_attitude_gyro(register const fix16_t deltaT)
     /* Perform Kalman update                                                */
     /************************************************************************/
 
-    kalman_correct_uc(&kf_attitude, &kfm_gyro);
+    fusion_correct(&kf_attitude, &kfm_gyro, FUSION_REGIME_ROTATION);
+    fusion_check_overflow(&kf_attitude, FUSION_STAGE_GYROSCOPE, true);
 
     /************************************************************************/
     /* Re-orthogonalize and update state matrix                             */
@@ -1106,13 +2780,14 @@ void fusion_update_attitude(register const fix16_t deltaT)
     /* Prepare measurement                                                  */
     /************************************************************************/
     {
-        mf16 *const z = &kfm_accel.z;
+        fusion_vector_t *const z = &kfm_accel.z;
 
-        fix16_t norm = v3d_norm(&m_accelerometer);
+        v3d an;
+        fusion_normalize(&an, &m_accelerometer);
         
-        matrix_set(z, 0, 0, fix16_div(m_accelerometer.x, norm));
-        matrix_set(z, 1, 0, fix16_div(m_accelerometer.y, norm));
-        matrix_set(z, 2, 0, fix16_div(m_accelerometer.z, norm));
+        matrix_set(z, 0, 0, an.x);
+        matrix_set(z, 1, 0, an.y);
+        matrix_set(z, 2, 0, an.z);
 
         matrix_set(z, 3, 0, m_gyroscope.x);
         matrix_set(z, 4, 0, m_gyroscope.y);
@@ -1129,7 +2804,8 @@ void fusion_update_attitude(register const fix16_t deltaT)
     /* Perform Kalman update                                                */
     /************************************************************************/
 
-    kalman_correct_uc(&kf_attitude, &kfm_accel);
+    fusion_correct(&kf_attitude, &kfm_accel, FUSION_REGIME_AXES);
+    fusion_check_overflow(&kf_attitude, FUSION_STAGE_ACCELEROMETER, true);
 
     /************************************************************************/
     /* Re-orthogonalize and update state matrix                             */
@@ -1150,7 +2826,7 @@ void fusion_update_attitude(register const fix16_t deltaT)
 HOT LEAF NONNULL
 STATIC_INLINE void magnetometer_project(fix16_t *RESTRICT const mx, fix16_t *RESTRICT const my, fix16_t *RESTRICT const mz)
 {
-    const mf16 *const x = kalman_get_state_vector_uc(&kf_attitude);
+    const fusion_vector_t *const x = &kf_attitude.x;
 
     register const fix16_t acc_x = x->data[0][0];
     register const fix16_t acc_y = x->data[1][0];
@@ -1166,17 +2842,21 @@ STATIC_INLINE void magnetometer_project(fix16_t *RESTRICT const mx, fix16_t *RES
     //      mx = m_magnetometer.y*m_accelerometer.z - m_magnetometer.z*m_accelerometer.y
     //      my = m_magnetometer.z*m_accelerometer.x - m_magnetometer.x*m_accelerometer.z
     //      mz = m_magnetometer.x*m_accelerometer.y - m_magnetometer.y*m_accelerometer.x
-    *mx = fix16_sub(fix16_mul(m_magnetometer.y, acc_z), fix16_mul(m_magnetometer.z, acc_y));
-    *my = fix16_sub(fix16_mul(m_magnetometer.z, acc_x), fix16_mul(m_magnetometer.x, acc_z));
-    *mz = fix16_sub(fix16_mul(m_magnetometer.x, acc_y), fix16_mul(m_magnetometer.y, acc_x));
+    v3d m = {
+        fix16_sub(fix16_mul(m_magnetometer.y, acc_z), fix16_mul(m_magnetometer.z, acc_y)),
+        fix16_sub(fix16_mul(m_magnetometer.z, acc_x), fix16_mul(m_magnetometer.x, acc_z)),
+        fix16_sub(fix16_mul(m_magnetometer.x, acc_y), fix16_mul(m_magnetometer.y, acc_x))
+    };
 
     // normalize C1 
-    const register fix16_t norm = norm3(*mx, *my, *mz);
-    *mx = fix16_div(*mx, norm);
-    *my = fix16_div(*my, norm);
-    *mz = fix16_div(*mz, norm);
+    fusion_normalize(&m, &m);
+    *mx = m.x;
+    *my = m.y;
+    *mz = m.z;
 }
 
+#if !FUSION_SHARED_RATES
+
 /*!
 * \brief Updates the current prediction with gyroscope data
 */
@@ -1187,7 +2867,7 @@ static void fusion_update_orientation_gyro(register const fix16_t deltaT)
     /* Prepare measurement                                                  */
     /************************************************************************/
     {
-        mf16 *const z = &kfm_gyro.z;
+        fusion_vector_t *const z = &kfm_gyro.z;
 
         matrix_set(z, 0, 0, m_gyroscope.x);
         matrix_set(z, 1, 0, m_gyroscope.y);
@@ -1198,7 +2878,8 @@ static void fusion_update_orientation_gyro(register const fix16_t deltaT)
     /* Perform Kalman update                                                */
     /************************************************************************/
 
-    kalman_correct_uc(&kf_orientation, &kfm_gyro);
+    fusion_correct(&kf_orientation, &kfm_gyro, FUSION_REGIME_ROTATION);
+    fusion_check_overflow(&kf_orientation, FUSION_STAGE_GYROSCOPE, true);
 
     /************************************************************************/
     /* Re-orthogonalize and update state matrix                             */
@@ -1207,6 +2888,8 @@ static void fusion_update_orientation_gyro(register const fix16_t deltaT)
     fusion_sanitize_state(&kf_orientation);
 }
 
+#endif
+
 /*!
 * \brief Updates the current prediction with magnetometer data
 */
@@ -1234,12 +2917,12 @@ static void fusion_update_orientation(register const fix16_t deltaT)
 
     tune_measurement_noise(&kfm_magneto);
     {
-        mf16 *const R = &kfm_magneto.R;
+        fusion_diagonal_t *const R = &kfm_magneto.R;
 
         // anyway, overwrite covariance of projection
-        matrix_set(R, 0, 0, fix16_mul(initial_r_projection, alpha1));
-        matrix_set(R, 1, 1, fix16_mul(initial_r_projection, alpha1));
-        matrix_set(R, 2, 2, fix16_mul(initial_r_projection, alpha1));
+        diagonal_set(R, 0, fix16_mul(initial_r_projection, alpha1));
+        diagonal_set(R, 1, fix16_mul(initial_r_projection, alpha1));
+        diagonal_set(R, 2, fix16_mul(initial_r_projection, alpha1));
     }
 
     
@@ -1248,20 +2931,17 @@ static void fusion_update_orientation(register const fix16_t deltaT)
     /* Prepare measurement                                                  */
     /************************************************************************/
     {
-        mf16 *const z = &kfm_magneto.z;
+        fusion_vector_t *const z = &kfm_magneto.z;
 
         matrix_set(z, 0, 0, mx);
         matrix_set(z, 1, 0, my);
         matrix_set(z, 2, 0, mz);
 
-#if 1
+        // with shared rates, the gyroscope is left to the attitude filter
+#if !FUSION_SHARED_RATES
         matrix_set(z, 3, 0, m_gyroscope.x);
         matrix_set(z, 4, 0, m_gyroscope.y);
         matrix_set(z, 5, 0, m_gyroscope.z);
-#else
-        matrix_set(z, 3, 0, kf_attitude.x.data[3][0]);
-        matrix_set(z, 4, 0, kf_attitude.x.data[4][0]);
-        matrix_set(z, 5, 0, kf_attitude.x.data[5][0]);
 #endif
     }
 
@@ -1269,7 +2949,8 @@ static void fusion_update_orientation(register const fix16_t deltaT)
     /* Perform Kalman update                                                */
     /************************************************************************/
 
-    kalman_correct_uc(&kf_orientation, &kfm_magneto);
+    fusion_correct(&kf_orientation, &kfm_magneto, FUSION_REGIME_AXES);
+    fusion_check_overflow(&kf_orientation, FUSION_STAGE_MAGNETOMETER, true);
 
     /************************************************************************/
     /* Re-orthogonalize and update state matrix                             */
@@ -1278,6 +2959,195 @@ static void fusion_update_orientation(register const fix16_t deltaT)
     fusion_sanitize_state(&kf_orientation);
 }
 
+/*!
+* \brief Sets the axis states of both filters and zeroes their angular velocities
+* \param[in] up The attitude axis, i.e. the negated down axis
+* \param[in] east The orientation axis
+*/
+NONNULL
+STATIC_INLINE void fusion_seed_axes(const v3d *RESTRICT const up, const v3d *RESTRICT const east)
+{
+    fusion_vector_t *const x3 = &kf_attitude.x;
+    fusion_vector_t *const x2 = &kf_orientation.x;
+
+    x3->data[0][0] = up->x;
+    x3->data[1][0] = up->y;
+    x3->data[2][0] = up->z;
+    x3->data[3][0] = 0;
+    x3->data[4][0] = 0;
+    x3->data[5][0] = 0;
+
+    x2->data[0][0] = east->x;
+    x2->data[1][0] = east->y;
+    x2->data[2][0] = east->z;
+#if !FUSION_SHARED_RATES
+    x2->data[3][0] = 0;
+    x2->data[4][0] = 0;
+    x2->data[5][0] = 0;
+#endif
+}
+
+/*!
+* \brief Bootstraps the filters from the registered measurements
+*
+* Seeds both filters from the TRIAD axes of the accelerometer and the last magnetometer
+* measurement, so that attitude and orientation start out orthogonal. Without a usable
+* magnetometer measurement only the attitude is seeded; the orientation then follows
+* with the first magnetometer correction.
+*/
+COLD
+static void fusion_bootstrap()
+{
+    v3d north, east, down;
+    if (sensor_triad(&north, &east, &down, &m_accelerometer, &m_magnetometer))
+    {
+        const v3d up = { -down.x, -down.y, -down.z };
+        fusion_seed_axes(&up, &east);
+
+        m_orientation_bootstrapped = true;
+    }
+    else
+    {
+        v3d an;
+        fusion_normalize(&an, &m_accelerometer);
+
+        kf_attitude.x.data[0][0] = an.x;
+        kf_attitude.x.data[1][0] = an.y;
+        kf_attitude.x.data[2][0] = an.z;
+    }
+
+    m_attitude_bootstrapped = true;
+}
+
+/*!
+* \brief Corrects the attitude filter with the registered accelerometer measurement.
+* \param[in] deltaT The time difference in seconds to the last accelerometer correction.
+*/
+HOT
+void fusion_update_accelerometer(register const fix16_t deltaT)
+{
+    if (false == m_have_accelerometer)
+    {
+        return;
+    }
+
+    // bootstrap filter
+    if (false == m_attitude_bootstrapped)
+    {
+        fusion_bootstrap();
+    }
+
+    fusion_update_attitude(deltaT);
+
+    m_have_accelerometer = false;
+    m_attitude_corrected = true;
+    fusion_output_invalidate();
+}
+
+/*!
+* \brief Corrects the orientation filter with the registered magnetometer measurement.
+* \param[in] deltaT The time difference in seconds to the last magnetometer correction.
+*/
+HOT
+void fusion_update_magnetometer(register const fix16_t deltaT)
+{
+    if (false == m_have_magnetometer)
+    {
+        return;
+    }
+
+    // bootstrap filter
+    // make sure that the attitude filter was already bootstrapped in order to be able to project the
+    // magnetometer readings
+    if ((false == m_orientation_bootstrapped) && (true == m_attitude_bootstrapped))
+    {
+        fix16_t mx, my, mz;
+        magnetometer_project(&mx, &my, &mz);
+
+        kf_orientation.x.data[0][0] = mx;
+        kf_orientation.x.data[1][0] = my;
+        kf_orientation.x.data[2][0] = mz;
+
+        m_orientation_bootstrapped = true;
+    }
+
+    fusion_update_orientation(deltaT);
+
+    m_have_magnetometer = false;
+    m_orientation_corrected = true;
+    fusion_output_invalidate();
+}
+
+/*!
+* \brief Corrects the filters that were not corrected since the last prediction with the gyroscope measurement.
+* \param[in] deltaT The time difference in seconds to the last prediction.
+*/
+HOT
+void fusion_update_gyroscope(register const fix16_t deltaT)
+{
+    if (false == m_attitude_corrected)
+    {
+        fusion_update_attitude_gyro(deltaT);
+        m_attitude_corrected = true;
+        fusion_output_invalidate();
+    }
+
+    if (false == m_orientation_corrected)
+    {
+        // with shared rates, the gyroscope does not observe the orientation axes
+#if !FUSION_SHARED_RATES
+        fusion_update_orientation_gyro(deltaT);
+        fusion_output_invalidate();
+#endif
+        m_orientation_corrected = true;
+    }
+}
+
+/*!
+* \brief Estimates the orientation from the registered accelerometer and magnetometer measurements alone.
+*
+* The TRIAD axes replace both filter states and directly become the output DCM, so the
+* filters continue from there once the gyroscope returns. The tilt requires a fresh
+* accelerometer measurement, so a lone magnetometer measurement stays registered until
+* one arrives; without a fresh magnetometer measurement, the last one is used.
+*/
+HOT
+void fusion_update_direct()
+{
+    if (false == m_have_accelerometer)
+    {
+        return;
+    }
+
+    m_have_accelerometer = false;
+    m_have_magnetometer = false;
+
+    v3d north, east, down;
+    if (!sensor_triad(&north, &east, &down, &m_accelerometer, &m_magnetometer))
+    {
+        return;
+    }
+
+    const v3d up = { -down.x, -down.y, -down.z };
+    fusion_seed_axes(&up, &east);
+
+    m_attitude_bootstrapped = true;
+    m_orientation_bootstrapped = true;
+
+    // the TRIAD axes are the DCM rows, no need to derive them from the states again
+    fusion_output_invalidate();
+    m_output.dcm[0][0] = north.x;
+    m_output.dcm[0][1] = north.y;
+    m_output.dcm[0][2] = north.z;
+    m_output.dcm[1][0] = east.x;
+    m_output.dcm[1][1] = east.y;
+    m_output.dcm[1][2] = east.z;
+    m_output.dcm[2][0] = down.x;
+    m_output.dcm[2][1] = down.y;
+    m_output.dcm[2][2] = down.z;
+    m_output.valid = FUSION_OUTPUT_DCM;
+}
+
 /*!
 * \brief Updates the current prediction with the set measurements.
 * \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
@@ -1299,55 +3169,13 @@ void fusion_update(register const fix16_t deltaT)
 #endif
 
     // perform roll and pitch updates
-    if (true == m_have_accelerometer)
-    {
-        // bootstrap filter
-        if (false == m_attitude_bootstrapped)
-        {
-            fix16_t norm = v3d_norm(&m_accelerometer);
-
-            kf_attitude.x.data[0][0] = fix16_div(m_accelerometer.x, norm);
-            kf_attitude.x.data[1][0] = fix16_div(m_accelerometer.y, norm);
-            kf_attitude.x.data[2][0] = fix16_div(m_accelerometer.z, norm);
-
-            m_attitude_bootstrapped = true;
-        }
-
-        fusion_update_attitude(deltaT);
-    }
-    else
-    {
-        // perform only rotational update
-        fusion_update_attitude_gyro(deltaT);
-    }
+    fusion_update_accelerometer(deltaT);
 
     // perform yaw updates
-    if (true == m_have_magnetometer)
-    {
-        // bootstrap filter
-        // make sure that the attitude filter was already bootstrapped in order to be able to project the
-        // magnetometer readings
-        if ((false == m_orientation_bootstrapped) && (true == m_attitude_bootstrapped))
-        {
-            fix16_t mx, my, mz;
-            magnetometer_project(&mx, &my, &mz);
+    fusion_update_magnetometer(deltaT);
 
-            kf_orientation.x.data[0][0] = mx;
-            kf_orientation.x.data[1][0] = my;
-            kf_orientation.x.data[2][0] = mz;
-
-            m_orientation_bootstrapped = true;
-        }
-
-        fusion_update_orientation(deltaT);
-    }
-    else
-    {
-        // perform only rotational update
-        fusion_update_orientation_gyro(deltaT);
-    }
-    
-    // reset information
-    m_have_accelerometer = false;
-    m_have_magnetometer = false;
+    // perform only rotational updates where no measurement was available
+    fusion_update_gyroscope(deltaT);
 }
+
+#endif // FUSION_ENGINE == FUSION_ENGINE_KALMAN
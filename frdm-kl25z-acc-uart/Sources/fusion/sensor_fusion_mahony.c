@@ -0,0 +1,652 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "fixmath.h"
+#include "fixvector3d.h"
+#include "fixquat.h"
+
+#include "fusion/fast_normalize.h"
+#include "fusion/fast_trig.h"
+#include "fusion/sensor_fusion.h"
+
+#if FUSION_ENGINE == FUSION_ENGINE_MAHONY
+
+#if FUSION_FAST_TRIG
+#define output_asin(value)      fix16_asin_fast(value)
+#define output_atan2(y, x)      fix16_atan2_fast(y, x)
+#else
+#define output_asin(value)      fix16_asin(value)
+#define output_atan2(y, x)      fix16_atan2(y, x)
+#endif
+
+/************************************************************************/
+/* Filter gains                                                         */
+/************************************************************************/
+
+/*!
+* \brief Proportional gain of the error feedback
+*/
+static const fix16_t kp = F16(1);
+
+/*!
+* \brief Integral gain of the error feedback, i.e. the gyroscope bias estimation
+*/
+static const fix16_t ki = F16(0.05);
+
+/*!
+* \brief Proportional gain used during bootstrapping
+*/
+static const fix16_t kp_bootstrap = F16(10);
+
+/*!
+* \brief Duration of the bootstrapping in seconds
+*/
+static const fix16_t bootstrap_time = F16(2);
+
+/************************************************************************/
+/* Filter state                                                         */
+/************************************************************************/
+
+/*!
+* \brief The orientation quaternion; rotates body into world coordinates (north, east, down)
+*/
+static qf16 m_orientation = { F16(1), 0, 0, 0 };
+
+/*!
+* \brief The integrated error in body rates
+*/
+static v3d m_error_integral = { 0, 0, 0 };
+
+/*!
+* \brief The time since initialization in seconds, saturated at {\ref bootstrap_time}
+*/
+static fix16_t m_time = 0;
+
+/************************************************************************/
+/* Sensor data buffers                                                  */
+/************************************************************************/
+
+/*!
+* \brief The current accelerometer measurements
+*/
+static v3d m_accelerometer = { 0, 0, 0 };
+
+/*!
+* \brief The current gyroscope measurements
+*/
+static v3d m_gyroscope = { 0, 0, 0 };
+
+/*!
+* \brief The current magnetometer measurements
+*/
+static v3d m_magnetometer = { 0, 0, 0 };
+
+/*!
+* \brief Determines if an accelerometer measurement is available
+*/
+static bool m_have_accelerometer = false;
+
+/*!
+* \brief Determines if an magnetometer measurement is available
+*/
+static bool m_have_magnetometer = false;
+
+/************************************************************************/
+/* Filter bootstrapping                                                 */
+/************************************************************************/
+
+/*!
+* \brief Determines if the attitude was already bootstrapped
+*/
+static bool m_attitude_bootstrapped = false;
+
+/*!
+* \brief Determines if the heading was already bootstrapped
+*/
+static bool m_orientation_bootstrapped = false;
+
+/************************************************************************/
+/* Helper macros                                                        */
+/************************************************************************/
+
+/*!
+* \def F16_ONE The value 1 in Q16
+*/
+#define F16_ONE             (F16(1))
+
+/*!
+* \def F16_ONE_HALF The value 0.5 in Q16
+*/
+#define F16_ONE_HALF        (F16(0.5))
+
+/************************************************************************/
+/* Helper functions                                                     */
+/************************************************************************/
+
+/*!
+* \brief Normalizes a vector
+* \param[in,out] v The vector
+* \return false if the vector has zero length and was left unchanged
+*/
+HOT NONNULL LEAF
+STATIC_INLINE bool normalize(v3d *const v)
+{
+    return v3d_normalize_fast(v, v);
+}
+
+/*!
+* \brief Fetches a row of the rotation matrix of the orientation quaternion
+* \param[in] row The row index, 0..2
+* \param[out] r The row, i.e. the world axis in body coordinates
+*
+* R = [1-2(c^2+d^2)   2(bc-ad)     2(bd+ac);
+*      2(bc+ad)     1-2(b^2+d^2)   2(cd-ab);
+*      2(bd-ac)     2(cd+ab)     1-2(b^2+c^2)]
+*/
+HOT NONNULL LEAF
+STATIC_INLINE void rotation_row(register const uint_fast8_t row, v3d *const r)
+{
+    register const fix16_t a = m_orientation.a;
+    register const fix16_t b = m_orientation.b;
+    register const fix16_t c = m_orientation.c;
+    register const fix16_t d = m_orientation.d;
+
+    switch (row)
+    {
+        case 0:
+            r->x = fix16_sub(F16_ONE, fix16_mul(F16(2), fix16_add(fix16_sq(c), fix16_sq(d))));
+            r->y = fix16_mul(F16(2), fix16_sub(fix16_mul(b, c), fix16_mul(a, d)));
+            r->z = fix16_mul(F16(2), fix16_add(fix16_mul(b, d), fix16_mul(a, c)));
+            break;
+        case 1:
+            r->x = fix16_mul(F16(2), fix16_add(fix16_mul(b, c), fix16_mul(a, d)));
+            r->y = fix16_sub(F16_ONE, fix16_mul(F16(2), fix16_add(fix16_sq(b), fix16_sq(d))));
+            r->z = fix16_mul(F16(2), fix16_sub(fix16_mul(c, d), fix16_mul(a, b)));
+            break;
+        default:
+            r->x = fix16_mul(F16(2), fix16_sub(fix16_mul(b, d), fix16_mul(a, c)));
+            r->y = fix16_mul(F16(2), fix16_add(fix16_mul(c, d), fix16_mul(a, b)));
+            r->z = fix16_sub(F16_ONE, fix16_mul(F16(2), fix16_add(fix16_sq(b), fix16_sq(c))));
+            break;
+    }
+}
+
+/*!
+* \brief Rotates the orientation by a body rate over a time difference
+* \param[in] wx The x-axis body rate
+* \param[in] wy The y-axis body rate
+* \param[in] wz The z-axis body rate
+* \param[in] deltaT The time difference in seconds
+*
+* Integrates q' = 0.5 * q x (0, w) in one Euler step and renormalizes using
+* the first order approximation 1/|q| = (3 - |q|^2)/2, which holds since
+* the step keeps |q| close to 1.
+*/
+HOT LEAF
+STATIC_INLINE void rotate(register fix16_t wx, register fix16_t wy, register fix16_t wz, register const fix16_t deltaT)
+{
+    register const fix16_t half_dT = fix16_mul(F16_ONE_HALF, deltaT);
+    wx = fix16_mul(wx, half_dT);
+    wy = fix16_mul(wy, half_dT);
+    wz = fix16_mul(wz, half_dT);
+
+    register const fix16_t a = m_orientation.a;
+    register const fix16_t b = m_orientation.b;
+    register const fix16_t c = m_orientation.c;
+    register const fix16_t d = m_orientation.d;
+
+    register fix16_t qa = fix16_sub(a, fix16_add(fix16_mul(b, wx), fix16_add(fix16_mul(c, wy), fix16_mul(d, wz))));
+    register fix16_t qb = fix16_add(b, fix16_sub(fix16_add(fix16_mul(a, wx), fix16_mul(c, wz)), fix16_mul(d, wy)));
+    register fix16_t qc = fix16_add(c, fix16_add(fix16_sub(fix16_mul(a, wy), fix16_mul(b, wz)), fix16_mul(d, wx)));
+    register fix16_t qd = fix16_add(d, fix16_sub(fix16_add(fix16_mul(a, wz), fix16_mul(b, wy)), fix16_mul(c, wx)));
+
+    // renormalize
+    register const fix16_t norm_sq = fix16_add(fix16_add(fix16_sq(qa), fix16_sq(qb)), fix16_add(fix16_sq(qc), fix16_sq(qd)));
+    register const fix16_t scale = fix16_mul(F16_ONE_HALF, fix16_sub(F16(3), norm_sq));
+
+    m_orientation.a = fix16_mul(qa, scale);
+    m_orientation.b = fix16_mul(qb, scale);
+    m_orientation.c = fix16_mul(qc, scale);
+    m_orientation.d = fix16_mul(qd, scale);
+}
+
+/*!
+* \brief Applies the error feedback
+* \param[in] error The error in body rates
+* \param[in] deltaT The time difference in seconds to the last feedback of the same sensor
+*/
+HOT NONNULL
+STATIC_INLINE void feedback(const v3d *const error, register const fix16_t deltaT)
+{
+    // bias estimation
+    m_error_integral.x = fix16_add(m_error_integral.x, fix16_mul(error->x, deltaT));
+    m_error_integral.y = fix16_add(m_error_integral.y, fix16_mul(error->y, deltaT));
+    m_error_integral.z = fix16_add(m_error_integral.z, fix16_mul(error->z, deltaT));
+
+    // proportional correction
+    register const fix16_t gain = (m_time < bootstrap_time) ? kp_bootstrap : kp;
+    rotate(fix16_mul(error->x, gain), fix16_mul(error->y, gain), fix16_mul(error->z, gain), deltaT);
+}
+
+/*!
+* \brief Performs a gyroscope integration step
+* \param[in] gyro The gyroscope sample
+* \param[in] deltaT The time difference in seconds
+*
+* The gyroscope rates have the sign convention of the Kalman engine, in which
+* world axes in body coordinates follow c' = w x c. Body rates are thus -w.
+*/
+HOT NONNULL
+STATIC_INLINE void predict_step(const v3d *const gyro, register const fix16_t deltaT)
+{
+    rotate(fix16_sub(fix16_mul(ki, m_error_integral.x), gyro->x),
+           fix16_sub(fix16_mul(ki, m_error_integral.y), gyro->y),
+           fix16_sub(fix16_mul(ki, m_error_integral.z), gyro->z),
+           deltaT);
+
+    if (m_time < bootstrap_time)
+    {
+        m_time = fix16_add(m_time, deltaT);
+    }
+}
+
+/*!
+* \brief Bootstraps the attitude from the normalized accelerometer reading
+* \param[in] an The normalized accelerometer reading
+*
+* Uses the shortest arc quaternion that rotates g = -an onto the world down axis.
+*/
+HOT NONNULL
+static void bootstrap_attitude(const v3d *const an)
+{
+    // q = (1 + g.z, g x z) / norm, with g x z = (gy, -gx, 0)
+    register const fix16_t w = fix16_sub(F16_ONE, an->z);
+    if (w < F16(0.001))
+    {
+        // g is antiparallel to the down axis, rotate half a turn about x
+        m_orientation.a = 0;
+        m_orientation.b = F16_ONE;
+        m_orientation.c = 0;
+        m_orientation.d = 0;
+        return;
+    }
+
+    m_orientation.a = w;
+    m_orientation.b = -an->y;
+    m_orientation.c = an->x;
+    m_orientation.d = 0;
+    qf16_normalize(&m_orientation, &m_orientation);
+}
+
+/*!
+* \brief Bootstraps the heading from the normalized magnetometer reading
+* \param[in] mn The normalized magnetometer reading
+*
+* Rotates about the world down axis so that the horizontal field points north.
+*/
+HOT NONNULL
+static void bootstrap_heading(const v3d *const mn)
+{
+    v3d r0, r1;
+    rotation_row(0, &r0);
+    rotation_row(1, &r1);
+
+    // heading of the field in world coordinates
+    register const fix16_t half_yaw = fix16_mul(F16_ONE_HALF, fix16_atan2(v3d_dot(&r1, mn), v3d_dot(&r0, mn)));
+
+    // q = qz(-yaw) x q
+    const qf16 correction = { fix16_cos(half_yaw), 0, 0, -fix16_sin(half_yaw) };
+    qf16 orientation;
+    qf16_mul(&orientation, &correction, &m_orientation);
+    qf16_normalize(&m_orientation, &orientation);
+}
+
+/************************************************************************/
+/* Initialization                                                       */
+/************************************************************************/
+
+/*!
+* \brief Initializes the sensor fusion mechanism.
+*/
+void fusion_initialize()
+{
+    m_orientation.a = F16_ONE;
+    m_orientation.b = 0;
+    m_orientation.c = 0;
+    m_orientation.d = 0;
+
+    m_error_integral.x = 0;
+    m_error_integral.y = 0;
+    m_error_integral.z = 0;
+
+    m_time = 0;
+
+    m_have_accelerometer = false;
+    m_have_magnetometer = false;
+    m_attitude_bootstrapped = false;
+    m_orientation_bootstrapped = false;
+}
+
+/************************************************************************/
+/* Convenience functions                                                */
+/************************************************************************/
+
+/*!
+* \brief Fetches the values without any modification
+* \param[out] roll The roll angle in radians.
+* \param[out] pitch The pitch (elevation) angle in radians.
+* \param[out] yaw The yaw (heading, azimuth) angle in radians.
+*
+* Uses the same axis definitions as the Kalman engine.
+*/
+HOT NONNULL LEAF
+void fusion_fetch_angles(register fix16_t *RESTRICT const roll, register fix16_t *RESTRICT const pitch, register fix16_t *RESTRICT const yaw)
+{
+    v3d r1, r2;
+    rotation_row(1, &r1);
+    rotation_row(2, &r2);
+
+    // the attitude axis is the negated down axis, the orientation axis is east
+    const fix16_t c21 = r1.x;
+    const fix16_t c22 = r1.y;
+    const fix16_t c23 = r1.z;
+
+    const fix16_t c31 = -r2.x;
+    const fix16_t c32 = -r2.y;
+    const fix16_t c33 = -r2.z;
+
+    *pitch = -output_asin(c31);
+    *roll = -output_atan2(c32, -c33);
+
+    // C11 = C22*C33 - C23*C32
+    const fix16_t c11 = fix16_sub(fix16_mul(c22, c33), fix16_mul(c23, c32));
+    *yaw = output_atan2(c21, -c11);
+}
+
+/*!
+* \brief Fetches the orientation quaternion.
+* \param[out] quat The orientation quaternion
+*/
+HOT NONNULL LEAF
+void fusion_fetch_quaternion(register qf16 *RESTRICT const quat)
+{
+    *quat = m_orientation;
+}
+
+/*!
+* \brief Fetches the direction cosine matrix.
+* \param[out] dcm The 3x3 DCM with the north, east and down axes in body coordinates as rows
+*/
+HOT NONNULL LEAF
+void fusion_fetch_dcm(register mf16 *RESTRICT const dcm)
+{
+    dcm->rows = 3;
+    dcm->columns = 3;
+    dcm->errors = 0;
+
+    for (uint_fast8_t row = 0; row < 3; ++row)
+    {
+        v3d r;
+        rotation_row(row, &r);
+
+        dcm->data[row][0] = r.x;
+        dcm->data[row][1] = r.y;
+        dcm->data[row][2] = r.z;
+    }
+}
+
+/************************************************************************/
+/* Prediction                                                           */
+/************************************************************************/
+
+/*!
+* \brief Performs a prediction of the current orientation based on the time difference to the previous prediction.
+* \param[in] deltaT The time difference in seconds to the last prediction.
+*/
+HOT
+void fusion_predict(register const fix16_t deltaT)
+{
+    predict_step(&m_gyroscope, deltaT);
+}
+
+/*!
+* \brief Performs a prediction over a burst of gyroscope samples.
+* \param[in] gyro The gyroscope samples, oldest first.
+* \param[in] deltaT The time difference in seconds of every sample to its predecessor.
+* \param[in] count The number of samples.
+*/
+HOT
+void fusion_predict_batch(const v3d *const gyro, const fix16_t *const deltaT, register const uint_fast8_t count)
+{
+    for (uint_fast8_t k = 0; k < count; ++k)
+    {
+        predict_step(&gyro[k], deltaT[k]);
+    }
+}
+
+/************************************************************************/
+/* Setters for sensor data                                              */
+/************************************************************************/
+
+/*!
+* \brief Registers accelerometer measurements for the next update
+* \param[in] ax The x-axis accelerometer value.
+* \param[in] ay The y-axis accelerometer value.
+* \param[in] az The z-axis accelerometer value.
+*/
+void fusion_set_accelerometer(register const fix16_t *const ax, register const fix16_t *const ay, register const fix16_t *const az)
+{
+    m_accelerometer.x = *ax;
+    m_accelerometer.y = *ay;
+    m_accelerometer.z = *az;
+    m_have_accelerometer = true;
+}
+
+/*!
+* \brief Registers gyroscope measurements for the next prediction
+* \param[in] gx The x-axis gyroscope value.
+* \param[in] gy The y-axis gyroscope value.
+* \param[in] gz The z-axis gyroscope value.
+*/
+void fusion_set_gyroscope(register const fix16_t *const gx, register const fix16_t *const gy, register const fix16_t *const gz)
+{
+    m_gyroscope.x = *gx;
+    m_gyroscope.y = *gy;
+    m_gyroscope.z = *gz;
+}
+
+/*!
+* \brief Registers magnetometer measurements for the next update
+* \param[in] mx The x-axis magnetometer value.
+* \param[in] my The y-axis magnetometer value.
+* \param[in] mz The z-axis magnetometer value.
+*/
+void fusion_set_magnetometer(register const fix16_t *const mx, register const fix16_t *const my, register const fix16_t *const mz)
+{
+    m_magnetometer.x = *mx;
+    m_magnetometer.y = *my;
+    m_magnetometer.z = *mz;
+    m_have_magnetometer = true;
+}
+
+/************************************************************************/
+/* State update                                                         */
+/************************************************************************/
+
+/*!
+* \brief Corrects the attitude with the registered accelerometer measurement.
+* \param[in] deltaT The time difference in seconds to the last accelerometer correction.
+*/
+HOT
+void fusion_update_accelerometer(register const fix16_t deltaT)
+{
+    if (false == m_have_accelerometer)
+    {
+        return;
+    }
+    m_have_accelerometer = false;
+
+    v3d an = m_accelerometer;
+    if (!normalize(&an))
+    {
+        return;
+    }
+
+    // bootstrap filter
+    if (false == m_attitude_bootstrapped)
+    {
+        bootstrap_attitude(&an);
+        m_attitude_bootstrapped = true;
+        return;
+    }
+
+    // the expected accelerometer direction is the negated down axis
+    v3d v;
+    rotation_row(2, &v);
+    v.x = -v.x;
+    v.y = -v.y;
+    v.z = -v.z;
+
+    // e = an x v turns the estimate towards the measurement
+    v3d error;
+    v3d_cross(&error, &an, &v);
+    feedback(&error, deltaT);
+}
+
+/*!
+* \brief Corrects the heading with the registered magnetometer measurement.
+* \param[in] deltaT The time difference in seconds to the last magnetometer correction.
+*
+* The error is restricted to the world down axis so that the magnetometer
+* does not disturb the attitude.
+*/
+HOT
+void fusion_update_magnetometer(register const fix16_t deltaT)
+{
+    if (false == m_have_magnetometer)
+    {
+        return;
+    }
+    m_have_magnetometer = false;
+
+    // the heading requires the attitude
+    if (false == m_attitude_bootstrapped)
+    {
+        return;
+    }
+
+    v3d mn = m_magnetometer;
+    if (!normalize(&mn))
+    {
+        return;
+    }
+
+    // bootstrap filter
+    if (false == m_orientation_bootstrapped)
+    {
+        bootstrap_heading(&mn);
+        m_orientation_bootstrapped = true;
+        return;
+    }
+
+    v3d r0, r1, r2;
+    rotation_row(0, &r0);
+    rotation_row(1, &r1);
+    rotation_row(2, &r2);
+
+    // reference field in the north/down plane of the world
+    register const fix16_t hx = v3d_dot(&r0, &mn);
+    register const fix16_t hy = v3d_dot(&r1, &mn);
+    register const fix16_t bx = fix16_sqrt(fix16_add(fix16_sq(hx), fix16_sq(hy)));
+    register const fix16_t bz = v3d_dot(&r2, &mn);
+
+    // expected field in body coordinates, w = R' * [bx 0 bz]
+    v3d w;
+    w.x = fix16_add(fix16_mul(bx, r0.x), fix16_mul(bz, r2.x));
+    w.y = fix16_add(fix16_mul(bx, r0.y), fix16_mul(bz, r2.y));
+    w.z = fix16_add(fix16_mul(bx, r0.z), fix16_mul(bz, r2.z));
+
+    // e = mn x w, restricted to the down axis
+    v3d error;
+    v3d_cross(&error, &mn, &w);
+
+    register const fix16_t e_down = v3d_dot(&error, &r2);
+    error.x = fix16_mul(e_down, r2.x);
+    error.y = fix16_mul(e_down, r2.y);
+    error.z = fix16_mul(e_down, r2.z);
+    feedback(&error, deltaT);
+}
+
+/*!
+* \brief Does nothing, since the gyroscope is integrated by the prediction.
+* \param[in] deltaT The time difference in seconds to the last prediction.
+*/
+HOT
+void fusion_update_gyroscope(register const fix16_t deltaT)
+{
+    (void)deltaT;
+}
+
+/*!
+* \brief Estimates the orientation from the registered accelerometer and magnetometer measurements alone.
+*
+* Replaces the orientation with the bootstrap of both measurements; the integrated bias
+* is kept for when the gyroscope returns. The tilt requires a fresh accelerometer
+* measurement, so a lone magnetometer measurement stays registered until one arrives;
+* without a fresh magnetometer measurement, the heading is taken from the last one.
+*/
+HOT
+void fusion_update_direct()
+{
+    if (false == m_have_accelerometer)
+    {
+        return;
+    }
+    m_have_accelerometer = false;
+
+    v3d an = m_accelerometer;
+    if (!normalize(&an))
+    {
+        return;
+    }
+
+    bootstrap_attitude(&an);
+    m_attitude_bootstrapped = true;
+
+    // the attitude bootstrap discards the heading; without any magnetometer reading it is bootstrapped later
+    v3d mn = m_magnetometer;
+    m_have_magnetometer = false;
+    m_orientation_bootstrapped = normalize(&mn);
+    if (m_orientation_bootstrapped)
+    {
+        bootstrap_heading(&mn);
+    }
+}
+
+/*!
+* \brief Fetches and clears the fixed-point overflows and filter resets since the last report
+* \param[out] report The report; NULL to discard the counts
+*
+* The complementary filter has no covariance to guard, so all counts are zero.
+*/
+void fusion_report_overflows(fusion_overflow_report_t *const report)
+{
+    if (NULL != report)
+    {
+        *report = (fusion_overflow_report_t){ { 0 } };
+    }
+}
+
+/*!
+* \brief Updates the current prediction with the set measurements.
+* \param[in] deltaT The time difference in seconds to the last prediction or observation update call.
+*/
+HOT
+void fusion_update(register const fix16_t deltaT)
+{
+    fusion_update_accelerometer(deltaT);
+    fusion_update_magnetometer(deltaT);
+    fusion_update_gyroscope(deltaT);
+}
+
+#endif // FUSION_ENGINE == FUSION_ENGINE_MAHONY
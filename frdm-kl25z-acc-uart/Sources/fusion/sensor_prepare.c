@@ -1,93 +1,278 @@
+#include <stdint.h>
 #include "fixmath.h"
 #include "fusion/sensor_calibration.h"
 #include "fusion/sensor_prepare.h"
 
+/*!
+* \brief Combined axis permutation, scaling and calibration of a sensor
+*
+* out = ((linear * raw + rounding) >> shift) + offset, with the linear part in Q(16+shift).
+* The shift is chosen as large as the int32 accumulation of full scale raw data allows.
+*/
+typedef struct {
+    int32_t linear[3][3];   //!< The linear part in Q(16+shift)
+    fix16_t offset[3];      //!< The offset in Q16
+    int32_t rounding;       //!< Half an output LSB in Q(16+shift)
+    uint_fast8_t shift;     //!< The fraction bits beyond Q16 of the linear part
+} sensor_transform_t;
+
+/*!
+* \brief The MPU6050 accelerometer transformation
+*/
+static sensor_transform_t mpu6050_accelerometer_transform;
+
+/*!
+* \brief The MPU6050 gyroscope transformation
+*/
+static sensor_transform_t mpu6050_gyroscope_transform;
+
+/*!
+* \brief The HMC5883L magnetometer transformation
+*/
+static sensor_transform_t hmc5883l_transform;
+
+/*!
+* \brief The MMA8451Q accelerometer transformation
+*/
+static sensor_transform_t mma8451q_accelerometer_transform;
+
+/*!
+* \brief The HMC5883L calibration in use, see {\ref sensor_prepare_correct_hmc5883l}
+*/
+static calibration_matrix_t hmc5883l_active_calibration;
+
+/*!
+* \brief The HMC5883L scaling factor, kept to rebuild the transformation
+*/
+static fix16_t hmc5883l_scaling;
+
+/*!
+* \brief The HMC5883L axis mapping
+*/
+static const int8_t magnetometer_axes[3] = { 1, 2, 3 };
+
+/*!
+* \brief The HMC5883L output signs
+*/
+static const int8_t magnetometer_signs[3] = { 1, 1, 1 };
+
+/*!
+* \brief The largest shift considered; keeps calibration * numerator << shift within 64 bit
+*/
+#define SENSOR_TRANSFORM_MAX_SHIFT  (24)
+
+/*!
+* \brief Divides with rounding to nearest
+* \param[in] numerator The numerator
+* \param[in] denominator The denominator, required to be positive
+* \return The rounded quotient
+*/
+STATIC_INLINE int64_t divide_rounded(register const int64_t numerator, register const int64_t denominator)
+{
+    return (numerator >= 0)
+        ? (numerator + denominator / 2) / denominator
+        : (numerator - denominator / 2) / denominator;
+}
+
+/*!
+* \brief Precomputes a sensor transformation
+* \param[out] transform The transformation
+* \param[in] calibration The calibration applied to the scaled sensor data
+* \param[in] axes The raw axis feeding each scaled axis, 1-based, negative to flip the sign
+* \param[in] signs The sign of each calibrated axis, +1 or -1
+* \param[in] scaling The scaling factor, see {\ref sensor_prepare_initialize}
+* \param[in] numerator Q16 numerator of a unit conversion applied after calibration
+* \param[in] denominator Integer denominator of the unit conversion
+*
+* Runs once per sensor at initialization; the 64 bit divisions are not on the hot path.
+*/
+static void sensor_transform_initialize(sensor_transform_t *const transform, const calibration_matrix_t *const calibration,
+    const int8_t axes[static 3], const int8_t signs[static 3], const fix16_t scaling, const fix16_t numerator, const int32_t denominator)
+{
+    // linear part of calibration * permutation, as calibration * numerator in Q32
+    int64_t linear[3][3] = { { 0 } };
+    for (uint_fast8_t row = 0; row < 3; ++row)
+    {
+        for (uint_fast8_t k = 0; k < 3; ++k)
+        {
+            const int_fast8_t axis = axes[k];
+            const uint_fast8_t column = ((axis < 0) ? -axis : axis) - 1;
+            const int64_t term = (int64_t)(*calibration)[row][k] * numerator;
+            linear[row][column] += (axis < 0) ? -term : term;
+        }
+    }
+
+    // the largest shift for which full scale raw data can not overflow the accumulator
+    const int64_t divisor = (int64_t)denominator * scaling;
+    uint_fast8_t shift = SENSOR_TRANSFORM_MAX_SHIFT;
+    for (;; --shift)
+    {
+        int64_t worst = 0;
+        for (uint_fast8_t row = 0; row < 3; ++row)
+        {
+            int64_t sum = 0;
+            for (uint_fast8_t column = 0; column < 3; ++column)
+            {
+                const int64_t coefficient = divide_rounded(linear[row][column] << shift, divisor);
+                sum += (coefficient < 0) ? -coefficient : coefficient;
+            }
+            if (sum > worst) worst = sum;
+        }
+
+        if ((0 == shift) || (worst * 32768 + ((shift > 0) ? ((int64_t)1 << (shift - 1)) : 0) <= INT32_MAX))
+        {
+            break;
+        }
+    }
+
+    for (uint_fast8_t row = 0; row < 3; ++row)
+    {
+        const int_fast8_t sign = signs[row];
+        for (uint_fast8_t column = 0; column < 3; ++column)
+        {
+            transform->linear[row][column] = sign * (int32_t)divide_rounded(linear[row][column] << shift, divisor);
+        }
+        transform->offset[row] = sign * (fix16_t)divide_rounded((int64_t)(*calibration)[row][3] * numerator, (int64_t)denominator * fix16_one);
+    }
+
+    transform->shift = shift;
+    transform->rounding = (shift > 0) ? ((int32_t)1 << (shift - 1)) : 0;
+}
+
+/*!
+* \brief Applies a sensor transformation to raw sensor data
+* \param[out] out The transformed data
+* \param[in] transform The transformation
+* \param[in] rawx The sensor x value
+* \param[in] rawy The sensor y value
+* \param[in] rawz The sensor z value
+*
+* Nine 32 bit multiply-accumulates plus three offsets; no division.
+*/
+HOT NONNULL LEAF
+STATIC_INLINE void sensor_transform_apply(v3d *const out, register const sensor_transform_t *const transform, register const int32_t rawx, register const int32_t rawy, register const int32_t rawz)
+{
+    register const int32_t rounding = transform->rounding;
+    register const uint_fast8_t shift = transform->shift;
+
+    out->x = ((transform->linear[0][0] * rawx + transform->linear[0][1] * rawy + transform->linear[0][2] * rawz + rounding) >> shift) + transform->offset[0];
+    out->y = ((transform->linear[1][0] * rawx + transform->linear[1][1] * rawy + transform->linear[1][2] * rawz + rounding) >> shift) + transform->offset[1];
+    out->z = ((transform->linear[2][0] * rawx + transform->linear[2][1] * rawy + transform->linear[2][2] * rawz + rounding) >> shift) + transform->offset[2];
+}
+
+/*!
+* \brief Precomputes the sensor transformations from the scaling factors and the calibration.
+* \param[in] accelerometer_scaling The MPU6050 accelerometer scaling factor, e.g. F16(8192) for 4g mode
+* \param[in] gyroscope_scaling The MPU6050 gyroscope scaling factor, e.g. F16(131) for 250/s mode
+* \param[in] magnetometer_scaling The HMC5883L scaling factor, e.g. F16(1090) for 1.3 gauss mode
+*/
+void sensor_prepare_initialize(const fix16_t accelerometer_scaling, const fix16_t gyroscope_scaling, const fix16_t magnetometer_scaling)
+{
+    // swapping X and Y axis and flipping X and Z signs in order to convert from AHRS to regular coordinate system
+    static const int8_t accelerometer_axes[3] = { -2, 1, -3 };
+    static const int8_t accelerometer_signs[3] = { 1, 1, 1 };
+    sensor_transform_initialize(&mpu6050_accelerometer_transform, mpu6050_accelerometer_calibration(),
+        accelerometer_axes, accelerometer_signs, accelerometer_scaling, fix16_one, 1);
+
+    // swapping X and Y axis and flipping X sign, then flipping the calibrated Z sign and converting to radians
+    static const int8_t gyroscope_axes[3] = { -2, 1, 3 };
+    static const int8_t gyroscope_signs[3] = { 1, 1, -1 };
+    sensor_transform_initialize(&mpu6050_gyroscope_transform, mpu6050_gyroscope_calibration(),
+        gyroscope_axes, gyroscope_signs, gyroscope_scaling, fix16_pi, 180);
+
+    const calibration_matrix_t *const calibration = hmc5883l_calibration();
+    for (uint_fast8_t row = 0; row < 3; ++row)
+    {
+        for (uint_fast8_t column = 0; column < 4; ++column)
+        {
+            hmc5883l_active_calibration[row][column] = (*calibration)[row][column];
+        }
+    }
+
+    hmc5883l_scaling = magnetometer_scaling;
+    sensor_transform_initialize(&hmc5883l_transform, &hmc5883l_active_calibration,
+        magnetometer_axes, magnetometer_signs, magnetometer_scaling, fix16_one, 1);
+}
+
+/*!
+* \brief Precomputes the MMA8451Q accelerometer transformation.
+* \param[in] accelerometer_scaling The MMA8451Q scaling factor, e.g. F16(4096) for 2g mode
+*/
+void sensor_prepare_initialize_mma8451q(const fix16_t accelerometer_scaling)
+{
+    // the axes are laid out like the MPU6050 ones; the calibration takes the residual mounting rotation
+    static const int8_t accelerometer_axes[3] = { -2, 1, -3 };
+    static const int8_t accelerometer_signs[3] = { 1, 1, 1 };
+    sensor_transform_initialize(&mma8451q_accelerometer_transform, mma8451q_accelerometer_calibration(),
+        accelerometer_axes, accelerometer_signs, accelerometer_scaling, fix16_one, 1);
+}
+
+/*!
+* \brief Refines the HMC5883L calibration by an affine correction of the prepared data.
+* \param[in] correction The correction applied after the current calibration
+*
+* The correction is composed with the calibration in use and the transformation is
+* rebuilt, so that the next prepared sample is corrected.
+*/
+void sensor_prepare_correct_hmc5883l(const calibration_matrix_t *const correction)
+{
+    calibration_matrix_t composed;
+    for (uint_fast8_t row = 0; row < 3; ++row)
+    {
+        for (uint_fast8_t column = 0; column < 4; ++column)
+        {
+            int64_t sum = (3 == column) ? ((int64_t)(*correction)[row][3] << 16) : 0;
+            for (uint_fast8_t k = 0; k < 3; ++k)
+            {
+                sum += (int64_t)(*correction)[row][k] * hmc5883l_active_calibration[k][column];
+            }
+            composed[row][column] = (fix16_t)((sum + 0x8000) >> 16);
+        }
+    }
+
+    for (uint_fast8_t row = 0; row < 3; ++row)
+    {
+        for (uint_fast8_t column = 0; column < 4; ++column)
+        {
+            hmc5883l_active_calibration[row][column] = composed[row][column];
+        }
+    }
+
+    sensor_transform_initialize(&hmc5883l_transform, &hmc5883l_active_calibration,
+        magnetometer_axes, magnetometer_signs, hmc5883l_scaling, fix16_one, 1);
+}
+
+/*!
+* \brief Retrieves the HMC5883L calibration in use.
+* \return The calibration, including all corrections
+*/
+const calibration_matrix_t *sensor_prepare_hmc5883l_calibration()
+{
+    return &hmc5883l_active_calibration;
+}
+
 /*!
 * \brief Prepares MPU6050 accelerometer sensor data for fusion by converting and calibrating them.
 * \param[out] out The prepared sensor data
 * \param[in] raw_x The sensor x value
 * \param[in] raw_y The sensor y value
 * \param[in] raw_z The sensor z value
-* \param[in] scaling The scaling factor, e.g. F16(8192) for 4g mode, F16(16384) for 4g mode, ...
 */
-void sensor_prepare_mpu6050_accelerometer_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz, const fix16_t scaling)
+void sensor_prepare_mpu6050_accelerometer_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz)
 {
-    // fetch value
-    v3d value = {
-        // note that we are swapping X and Y axis here and flipping X and Z signs
-        // in order to convert from AHRS to regular coordinate system
-        -fix16_from_int(rawy),
-         fix16_from_int(rawx),
-        -fix16_from_int(rawz)
-    };
-
-    // scale
-    v3d_div_s(out, &value, scaling);
-
-    // calibrate!
-    mpu6050_calibrate_accelerometer_v3d(out);
-
-    value = *out;
-    out->x =  value.x;
-    out->y =  value.y;
-    out->z =  value.z;
+    sensor_transform_apply(out, &mpu6050_accelerometer_transform, rawx, rawy, rawz);
 }
 
 /*!
 * \brief Prepares MPU6050 gyroscope sensor data for fusion by converting and calibrating them.
-* \param[out] out The prepared sensor data
+* \param[out] out The prepared sensor data in radians per second
 * \param[in] raw_x The sensor x value
 * \param[in] raw_y The sensor y value
 * \param[in] raw_z The sensor z value
-* \param[in] scaling The scaling factor, e.g. F16(131) for 250/s mode ...
 */
-void sensor_prepare_mpu6050_gyroscope_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz, const fix16_t scaling)
+void sensor_prepare_mpu6050_gyroscope_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz)
 {
-#if 1
-    // fetch value
-    v3d value = {
-        // note that we are swapping X and Y axis here and flipping X sign
-        // in order to convert from AHRS to regular coordinate system
-        -fix16_from_int(rawy),
-         fix16_from_int(rawx),
-         fix16_from_int(rawz)
-    };
-#else
-    // fetch value
-    v3d value = {
-        fix16_from_int(rawx),
-        fix16_from_int(rawy),
-        fix16_from_int(rawz)
-    };
-#endif
-
-#if 0
-    float tx = fix16_to_float(value.x);
-    float ty = fix16_to_float(value.y);
-    float tz = fix16_to_float(value.z);
-#endif
-
-    // scale
-    v3d_div_s(out, &value, scaling);
-
-    // calibrate!
-    mpu6050_calibrate_gyroscope_v3d(out);
-
-    // data in degree, so convert to radians
-
-#if 0
-    out->x = fix16_deg_to_rad( out->x);
-    out->y = fix16_deg_to_rad(-out->y);
-    out->z = fix16_deg_to_rad( out->z);
-#elseif 0
-    out->x = fix16_deg_to_rad(-out->x);
-    out->y = fix16_deg_to_rad( out->y);
-    out->z = fix16_deg_to_rad(-out->z);
-#else
-    out->x = fix16_deg_to_rad(out->x);
-    out->y = fix16_deg_to_rad(out->y);
-    out->z = fix16_deg_to_rad(-out->z);
-#endif
+    sensor_transform_apply(out, &mpu6050_gyroscope_transform, rawx, rawy, rawz);
 }
 
 /*!
@@ -96,21 +281,20 @@ void sensor_prepare_mpu6050_gyroscope_data(v3d *const out, int16_t rawx, int16_t
 * \param[in] raw_x The sensor x value
 * \param[in] raw_y The sensor y value
 * \param[in] raw_z The sensor z value
-* \param[in] scaling The scaling factor, e.g. F16(1090) for 1.3 gauss mode ...
 */
-void sensor_prepare_hmc5883l_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz, const fix16_t scaling)
+void sensor_prepare_hmc5883l_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz)
 {
-    // fetch value
-    const register fix16_t invScaling = fix16_div(F16(1), scaling);
-    out->x = fix16_mul(fix16_from_int(rawx), invScaling);
-    out->y = fix16_mul(fix16_from_int(rawy), invScaling);
-    out->z = fix16_mul(fix16_from_int(rawz), invScaling);
-
-    // calibrate!
-    hmc5883l_calibrate_v3d(out);
-
-    v3d value = *out;
-    out->x =  value.x;
-    out->y =  value.y;
-    out->z =  value.z;
-}
\ No newline at end of file
+    sensor_transform_apply(out, &hmc5883l_transform, rawx, rawy, rawz);
+}
+
+/*!
+* \brief Prepares MMA8451Q accelerometer sensor data for fusion by converting, calibrating and rotating them into the MPU6050 frame.
+* \param[out] out The prepared sensor data
+* \param[in] raw_x The sensor x value
+* \param[in] raw_y The sensor y value
+* \param[in] raw_z The sensor z value
+*/
+void sensor_prepare_mma8451q_accelerometer_data(v3d *const out, int16_t rawx, int16_t rawy, int16_t rawz)
+{
+    sensor_transform_apply(out, &mma8451q_accelerometer_transform, rawx, rawy, rawz);
+}
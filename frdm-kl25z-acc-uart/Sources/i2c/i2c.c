@@ -7,27 +7,79 @@
 
 #include "i2c/i2c.h"
 #include "cpu/delay.h"
+#include "cpu/clock.h"
+#include "cpu/systick.h"
 
 /**
- * @brief Initialises the I2C interface
+ * @brief I2C0 is clocked by the bus clock, that is core/2
  */
-void I2C_Init()
+#define I2C0_MODULE_CLOCK	(CORE_CLOCK/2)
+
+/**
+ * @brief I2C1 is clocked by the system clock, that is the core clock
+ */
+#define I2C1_MODULE_CLOCK	(CORE_CLOCK)
+
+/**
+ * @brief The I2C instance the slave addressed register functions operate on
+ */
+I2C_MemMapPtr i2c_selected_bus = I2C0;
+
+/**
+ * @brief The status of the current transfer by I2C instance index
+ */
+i2c_status_t i2c_status[I2C_INSTANCE_COUNT] = { I2C_STATUS_OK, I2C_STATUS_OK };
+
+/**
+ * @brief The pins an I2C instance is muxed to
+ */
+typedef struct {
+	PORT_MemMapPtr port;			/*< The port of the pins; NULL if unknown */
+	uint32_t sclPin;				/*< The pin used to drive SCL */
+	uint32_t sdaPin;				/*< The pin used to drive SDA */
+	uint8_t sclMux;					/*< The mux value for the SCL pin */
+	uint8_t sdaMux;					/*< The mux value for the SDA pin */
+} i2c_pins_t;
+
+/**
+ * @brief The current pins by I2C instance index
+ */
+static i2c_pins_t pins[I2C_INSTANCE_COUNT];
+
+/**
+ * @brief Half of an SCL period in microseconds while clearing the bus, i.e. 100 kHz
+ */
+#define I2C_CLEAR_HALF_PERIOD_US	(5u)
+
+/**
+ * @brief The maximum number of SCL clocks needed to make a slave release SDA
+ */
+#define I2C_CLEAR_CLOCKS			(9u)
+
+/**
+ * @brief The SCL dividers by ICR value, see table 38-41, I2C divider and hold values
+ */
+static const uint16_t sclDividers[64] = {
+	  20,   22,   24,   26,   28,   30,   34,   40,   28,   32,   36,   40,   44,   48,   56,   68,
+	  48,   56,   64,   72,   80,   88,  104,  128,   80,   96,  112,  128,  144,  160,  192,  240,
+	 160,  192,  224,  256,  288,  320,  384,  480,  320,  384,  448,  512,  576,  640,  768,  960,
+	 640,  768,  896, 1024, 1152, 1280, 1536, 1920, 1280, 1536, 1792, 2048, 2304, 2560, 3072, 3840
+};
+
+/**
+ * @brief Initialises an I2C instance
+ * @param[in] i2c The I2C instance, {@see I2C0} or {@see I2C1}
+ */
+void I2C_Init(I2C_MemMapPtr const i2c)
 {
-	/* enable clock gating to I2C0 */
-#if !I2C_USE_BME
-	SIM->SCGC4 |= (1 << SIM_SCGC4_I2C0_SHIFT) & SIM_SCGC4_I2C0_MASK;
-#else
-	BME_OR_W(&SIM->SCGC4, (1 << SIM_SCGC4_I2C0_SHIFT) & SIM_SCGC4_I2C0_MASK);
-#endif
+	/* enable clock gating to the instance */
+	const uint32_t clockGate = (I2C1 == i2c) ? SIM_SCGC4_I2C1_MASK : SIM_SCGC4_I2C0_MASK;
+	BitFlag_Set32(&SIM->SCGC4, clockGate);
 	
 #if 0 /* in ancient times this was hardcoded */
 	
 	/* enable the clock gate to port E */
-#if !I2C_USE_BME
-	SIM->SCGC5 |= (1 << SIM_SCGC5_PORTE_SHIFT) & SIM_SCGC5_PORTE_MASK;
-#else
-	BME_OR_W(&SIM->SCGC5, (1 << SIM_SCGC5_PORTE_SHIFT) & SIM_SCGC5_PORTE_MASK);
-#endif
+	BitFlag_Set32(&SIM->SCGC5, SIM_SCGC5_PORTE_MASK);
 	
 	/* configure port E pins to I2C operation */
 	PORTE->PCR[24] = PORT_PCR_MUX(5); /* SCL */
@@ -35,29 +87,54 @@ void I2C_Init()
 	
 #endif
 	
-	/* configure the I2C clock */
-	/* 
-	 * I2C0 is clocked by the bus clock, that is core/2.
+	/* configure the I2C clock
 	 * For the MMA8451Q inertial sensor on the FRDM-25KLZ board the
-	 * maximum SCL frequency is 400 kHz.
-	 * Assuming PEE mode with core=48MHz, 400 kHz = 48MHz/2 / 60,
-	 * which means a prescaler (SCL divider) of 60.
-	 * According to table 38-41, I2C divider and hold values,
-	 * the closest SCL diver is 64 (375 kHz SCL), which is ICR value 0x12.
-	 * Alternatively, the SCL divider of 30 can be used (ICR=0x05) in combination
-	 * with a multiplicator of 2 (MULT=0x01).
+	 * maximum SCL frequency is 400 kHz. See I2C_FrequencyDivider() for
+	 * the divider selection; the arbiter changes it per slave.
+	 */
+	i2c->F = I2C_FrequencyDivider(i2c, I2C_SPEED_FAST);
+	
+	/* enable the I2C module */
+	i2c->C1 = (1 << I2C_C1_IICEN_SHIFT) & I2C_C1_IICEN_MASK;
+}
+
+/**
+ * @brief Determines the frequency divider register value for a bus frequency
+ * @param[in] i2c The I2C instance the value is for
+ * @param[in] speed The bus frequency in Hz
+ * @return The F register value of the fastest SCL frequency not above {@see speed}
+ */
+uint8_t I2C_FrequencyDivider(I2C_MemMapPtr const i2c, uint32_t speed)
+{
+	/* 
+	 * Assuming PEE mode with core=48MHz, 400 kHz on I2C0 = 48MHz/2 / 60,
+	 * which is reached with an SCL divider of 30 (ICR=0x05) and a multiplicator 
+	 * of 2 (MULT=0x01); 100 kHz is an SCL divider of 240 (ICR=0x1F).
+	 * I2C1 runs from the undivided clock and needs twice the divider.
 	 * A note states that ICR values lower than 0x10 might result in a varying
 	 * SCL divider (+/- 4). However the data sheet does not state anything
 	 * useful about that.
+	 * Repeated starts with MULT other than 0x00 are covered by the e6070 workaround.
 	 */
-#if ENABLE_SPEEDHACK
-	I2C0->F = I2C_F_MULT(0x01) | I2C_F_ICR(0x05); /* NOTE: According to KINETIS_L_2N97F errata (e6070), repeated start condition can not be sent if prescaler is any other than 1 (0x0). */
-#else
-	I2C0->F = I2C_F_MULT(0x00) | I2C_F_ICR(0x12); /* divide by 64 instead, so 375 kHz */
-#endif
+	const uint32_t moduleClock = (I2C1 == i2c) ? I2C1_MODULE_CLOCK : I2C0_MODULE_CLOCK;
+	const uint32_t target = (moduleClock + speed - 1) / speed;
 	
-	/* enable the I2C module */
-	I2C0->C1 = (1 << I2C_C1_IICEN_SHIFT) & I2C_C1_IICEN_MASK;
+	uint8_t best = I2C_F_MULT(0x02) | I2C_F_ICR(0x3F);
+	uint32_t bestDivider = 4 * sclDividers[0x3F];
+	for (uint8_t mult = 0; mult < 3; ++mult)
+	{
+		for (uint8_t icr = 0; icr < 64; ++icr)
+		{
+			const uint32_t divider = (uint32_t)sclDividers[icr] << mult;
+			if (divider >= target && divider < bestDivider)
+			{
+				best = I2C_F_MULT(mult) | I2C_F_ICR(icr);
+				bestDivider = divider;
+			}
+		}
+	}
+	
+	return best;
 }
 
 /**
@@ -65,35 +142,37 @@ void I2C_Init()
  */
 uint8_t I2C_ReadRegister(register uint8_t slaveId, register uint8_t registerAddress)
 {
+	I2C_MemMapPtr const i2c = I2C_SelectedBus();
+	
 	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
+	if (I2C_STATUS_OK != I2C_WaitWhileBusy(i2c)) return 0;
 	
 	/* send I2C start signal and set write direction, also enables ACK */
-	I2C_SendStart();
+	I2C_SendStart(i2c);
 	
 	/* send the slave address and wait for the I2C bus operation to complete */
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(slaveId));
+	I2C_SendBlocking(i2c, I2C_WRITE_ADDRESS(slaveId));
 	
 	/* send the register address */
-	I2C_SendBlocking(registerAddress);
+	I2C_SendBlocking(i2c, registerAddress);
 	
 	/* signal a repeated start condition */
-	I2C_SendRepeatedStart();
+	I2C_SendRepeatedStart(i2c);
 
 	/* send the read address */
-	I2C_SendBlocking(I2C_READ_ADDRESS(slaveId));
+	I2C_SendBlocking(i2c, I2C_READ_ADDRESS(slaveId));
 	
 	/* switch to receive mode but disable ACK because only one data byte will be read */
-	I2C_EnterReceiveModeWithoutAck();
+	I2C_EnterReceiveModeWithoutAck(i2c);
 	
 	/* read a dummy byte to drive the clock */
-	I2C_ReceiverModeDriveClock();
+	I2C_ReceiverModeDriveClock(i2c);
 	
 	/* stop signal */
-	I2C_SendStop();
+	I2C_SendStop(i2c);
 	
 	/* fetch the last received byte */
-	register uint8_t result = I2C0->D;
+	register uint8_t result = i2c->D;
 	return result;
 }
 
@@ -103,34 +182,38 @@ uint8_t I2C_ReadRegister(register uint8_t slaveId, register uint8_t registerAddr
  * @param[in] startRegisterAddress The first register address
  * @param[in] registerCount The number of registers to read; Must be greater than or equal to two.
  * @param[out] buffere The buffer to write into
+ * @return The transfer status
  */
-static void I2C_ReadRegistersInternal(register uint8_t slaveId, register uint8_t startRegisterAddress, register uint8_t registerCount, uint8_t *const buffer)
+static i2c_status_t I2C_ReadRegistersInternal(register uint8_t slaveId, register uint8_t startRegisterAddress, register uint8_t registerCount, uint8_t *const buffer)
 {
+	I2C_MemMapPtr const i2c = I2C_SelectedBus();
+	
 	assert(registerCount >= 2);
 	
 	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
+	const i2c_status_t status = I2C_WaitWhileBusy(i2c);
+	if (I2C_STATUS_OK != status) return status;
 	
 	/* send I2C start signal and set write direction, also enables ACK */
-	I2C_SendStart();
+	I2C_SendStart(i2c);
 	
 	/* send the slave address and wait for the I2C bus operation to complete */
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(slaveId));
+	I2C_SendBlocking(i2c, I2C_WRITE_ADDRESS(slaveId));
 	
 	/* send the register address */
-	I2C_SendBlocking(startRegisterAddress);
+	I2C_SendBlocking(i2c, startRegisterAddress);
 	
 	/* signal a repeated start condition */
-	I2C_SendRepeatedStart();
+	I2C_SendRepeatedStart(i2c);
 
 	/* send the read address */
-	I2C_SendBlocking(I2C_READ_ADDRESS(slaveId));
+	I2C_SendBlocking(i2c, I2C_READ_ADDRESS(slaveId));
 	
 	/* switch to receive mode and assume more than one register */
-	I2C_EnterReceiveModeWithAck();
+	I2C_EnterReceiveModeWithAck(i2c);
 	
 	/* read a dummy byte to drive the clock */
-	I2C_ReceiverModeDriveClock();
+	I2C_ReceiverModeDriveClock(i2c);
 	
 	/* for all remaining bytes, read */
 	--registerCount;
@@ -138,27 +221,28 @@ static void I2C_ReadRegistersInternal(register uint8_t slaveId, register uint8_t
 	while (--registerCount > 0)
 	{
 		/* fetch and store value */
-		register uint8_t value = I2C0->D;
+		register uint8_t value = i2c->D;
 		buffer[index++] = value;
 		
 		/* wait for completion */
-		I2C_Wait();
+		I2C_Wait(i2c);
 	}
 	
 	/* disable ACK and read second-to-last byte */
-	I2C_DisableAck();
+	I2C_DisableAck(i2c);
 	
 	/* fetch and store value */
-	buffer[index++] = I2C0->D;
+	buffer[index++] = i2c->D;
 	
 	/* wait for completion */
-	I2C_Wait();
+	I2C_Wait(i2c);
 	
 	/* stop signal */
-	I2C_SendStop();
+	I2C_SendStop(i2c);
 	
 	/* fetch the last received byte */
-	buffer[index++] = I2C0->D; 
+	buffer[index++] = i2c->D; 
+	return I2C_Status(i2c);
 }
 
 /**
@@ -167,45 +251,52 @@ static void I2C_ReadRegistersInternal(register uint8_t slaveId, register uint8_t
  * @param[in] startRegisterAddress The first register address
  * @param[in] registerCount The number of registers to read; Must be larger than zero.
  * @param[out] buffer The buffer to write into
+ * @return The transfer status
  */
-void I2C_ReadRegisters(register uint8_t slaveId, register uint8_t startRegisterAddress, register uint8_t registerCount, register uint8_t *buffer)
+i2c_status_t I2C_ReadRegisters(register uint8_t slaveId, register uint8_t startRegisterAddress, register uint8_t registerCount, register uint8_t *buffer)
 {
 	assert(registerCount > 0);
 	
 	if (registerCount >= 2)
 	{
-		I2C_ReadRegistersInternal(slaveId, startRegisterAddress, registerCount, buffer);
+		return I2C_ReadRegistersInternal(slaveId, startRegisterAddress, registerCount, buffer);
 	}
 	else
 	{
 		assert(1 == registerCount);
 		register uint8_t result = I2C_ReadRegister(slaveId, startRegisterAddress);
 		buffer[0] = result;
+		return I2C_Status(I2C_SelectedBus());
 	}
 }
 
 /**
- * @brief Reads an 8-bit register from an I2C slave 
+ * @brief Writes an 8-bit value to an 8-bit register on an I2C slave
+ * @return The transfer status
  */
-void I2C_WriteRegister(register uint8_t slaveId, register uint8_t registerAddress, register uint8_t value)
+i2c_status_t I2C_WriteRegister(register uint8_t slaveId, register uint8_t registerAddress, register uint8_t value)
 {
+	I2C_MemMapPtr const i2c = I2C_SelectedBus();
+	
 	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();	
+	const i2c_status_t status = I2C_WaitWhileBusy(i2c);
+	if (I2C_STATUS_OK != status) return status;
 	
 	/* send I2C start signal and set write direction*/
-	I2C_SendStart();
+	I2C_SendStart(i2c);
 		
 	/* send the slave address and wait for the I2C bus operation to complete */
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(slaveId));
+	I2C_SendBlocking(i2c, I2C_WRITE_ADDRESS(slaveId));
 	
 	/* send the register address */
-	I2C_SendBlocking(registerAddress);
+	I2C_SendBlocking(i2c, registerAddress);
 		
 	/* send the register address */
-	I2C_SendBlocking(value);
+	I2C_SendBlocking(i2c, value);
 	
 	/* issue stop signal by clearing master mode. */
-	I2C_SendStop();
+	I2C_SendStop(i2c);
+	return I2C_Status(i2c);
 }
 
 /**
@@ -214,105 +305,260 @@ void I2C_WriteRegister(register uint8_t slaveId, register uint8_t registerAddres
  * @param[in] registerAddress The register to modify
  * @param[in] orMask The mask to OR the register with
  * @param[in] andMask The mask to AND the register with
- * @return The register after modification
+ * @return The register after modification; see {@see I2C_Status} for failures
  */
 uint8_t I2C_ModifyRegister(register uint8_t slaveId, register uint8_t registerAddress, register uint8_t andMask, register uint8_t orMask)
 {
+	I2C_MemMapPtr const i2c = I2C_SelectedBus();
+	
 	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
+	if (I2C_STATUS_OK != I2C_WaitWhileBusy(i2c)) return 0;
 
 	/* send the slave address and register */
-	I2C_SendStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(slaveId));
-	I2C_SendBlocking(registerAddress);
+	I2C_SendStart(i2c);
+	I2C_SendBlocking(i2c, I2C_WRITE_ADDRESS(slaveId));
+	I2C_SendBlocking(i2c, registerAddress);
 	
 	/* signal a repeated start condition */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_READ_ADDRESS(slaveId));
+	I2C_SendRepeatedStart(i2c);
+	I2C_SendBlocking(i2c, I2C_READ_ADDRESS(slaveId));
 	
 	/* switch to receive mode but disable ACK because only one data byte will be read */
-	I2C_EnterReceiveModeWithoutAck();
-	I2C_ReceiverModeDriveClock();
+	I2C_EnterReceiveModeWithoutAck(i2c);
+	I2C_ReceiverModeDriveClock(i2c);
+	
+	/* never write back a value that was not read */
+	if (I2C_STATUS_OK != I2C_Status(i2c))
+	{
+		I2C_SendStop(i2c);
+		return 0;
+	}
 	
 	/* instead of a stop signal, send repeated start again */
-	I2C_SendRepeatedStart();
+	I2C_SendRepeatedStart(i2c);
 	
 	/* fetch the last received byte */
-	register uint8_t value = I2C0->D;
+	register uint8_t value = i2c->D;
 	
 	/* modify the register */
 	value &= andMask;
 	value |= orMask;
 
 	/* send the slave address and wait for the I2C bus operation to complete */
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(slaveId));
+	I2C_SendBlocking(i2c, I2C_WRITE_ADDRESS(slaveId));
 	
 	/* send the register address */
-	I2C_SendBlocking(registerAddress);
+	I2C_SendBlocking(i2c, registerAddress);
 		
 	/* send the register address */
-	I2C_SendBlocking(value);
+	I2C_SendBlocking(i2c, value);
 	
 	/* issue stop signal by clearing master mode. */
-	I2C_SendStop();
+	I2C_SendStop(i2c);
 	return value;
 }
 
 /**
- * @brief Resets the bus by toggling master mode if the bus is busy. This will interrupt ongoing traffic, so use with caution.
+ * @brief Writes the registers of a configuration structure that differ from the last written copy
+ * @param[in] slaveId The slave device ID
+ * @param[in] blocks The register blocks to write, in order
+ * @param[in] blockCount The number of blocks
+ * @param[in] values The configuration structure
+ * @param[in] shadow The configuration last written to the slave or NULL to write all registers
+ * @return The transfer status
  */
-void I2C_ResetBus()
+i2c_status_t I2C_WriteRegisterBlocks(register uint8_t slaveId, const i2c_regblock_t *const blocks, uint8_t blockCount, const uint8_t *const values, const uint8_t *const shadow)
 {
-#if !I2C_USE_BME
-	I2C0->S |= I2C_S_IICIF_MASK; /* clear interrupt flag */
-#else
-	BME_OR_B(&I2C0->S, ((1 << I2C_S_IICIF_SHIFT) << I2C_S_IICIF_MASK));
-#endif	
-	
-#if 0
-	while (I2C0->S & I2C_S_BUSY_MASK)
+	I2C_MemMapPtr const i2c = I2C_SelectedBus();
+	uint8_t started = 0;
+	
+	for (uint8_t block = 0; block < blockCount; ++block)
 	{
-		/**
-		 * TODO: This is obviously not working. 
-		 * The proposed solution is to switch the SCL pin to GPIO mode
-		 * and toggle it a few times.
-		 */
+		const uint8_t offset = blocks[block].offset;
+		const uint8_t count = blocks[block].count;
 		
-		I2C_SendStart();
-		delay_ms(2);
-		I2C0->D = 0xAA;
-		delay_ms(2);
-		I2C0->D = 0x05;
-		delay_ms(2);
-		I2C0->D = 0x50;
-		delay_ms(2);
-		I2C0->D = 0xAA;
-		delay_ms(2);
-		I2C_SendStop();
+		uint8_t index = 0;
+		while (index < count)
+		{
+			/* skip unchanged registers */
+			if (NULL != shadow && values[offset + index] == shadow[offset + index])
+			{
+				++index;
+				continue;
+			}
+			
+			/* extend the burst as long as the next change is close enough */
+			uint8_t last = index;
+			for (uint8_t next = index + 1; next < count && (next - last) <= (I2C_WRITE_MERGE_GAP + 1); ++next)
+			{
+				if (NULL == shadow || values[offset + next] != shadow[offset + next]) last = next;
+			}
+			
+			/* address the first register of the burst */
+			if (!started)
+			{
+				const i2c_status_t status = I2C_WaitWhileBusy(i2c);
+				if (I2C_STATUS_OK != status) return status;
+				
+				I2C_SendStart(i2c);
+				started = 1;
+			}
+			else
+			{
+				I2C_SendRepeatedStart(i2c);
+			}
+			I2C_SendBlocking(i2c, I2C_WRITE_ADDRESS(slaveId));
+			I2C_SendBlocking(i2c, blocks[block].registerAddress + index);
+			
+			/* write the burst */
+			for (; index <= last; ++index)
+			{
+				I2C_SendBlocking(i2c, values[offset + index]);
+			}
+		}
+	}
+	
+	/* nothing changed, so nothing was sent */
+	if (!started) return I2C_STATUS_OK;
+	
+	I2C_SendStop(i2c);
+	return I2C_Status(i2c);
+}
+
+/**
+ * @brief Records a failure of the current transfer and releases the bus
+ * @param[in] i2c The I2C instance
+ * @param[in] status The failure
+ * @return The failure
+ */
+i2c_status_t I2C_Abort(I2C_MemMapPtr const i2c, const i2c_status_t status)
+{
+	i2c_status[I2C_InstanceIndex(i2c)] = status;
+	
+	/* leaving master mode releases SCL; a slave still holding the bus is handled by the next I2C_WaitWhileBusy() */
+	I2C_SendStop(i2c);
+	return status;
+}
+
+/**
+ * @brief Re-initializes the module, leaving master mode and clearing all flags. This will interrupt ongoing traffic, so use with caution.
+ * @param[in] i2c The I2C instance
+ */
+void I2C_ResetBus(I2C_MemMapPtr const i2c)
+{
+	const uint8_t frequencyDivider = i2c->F;
+	
+	/* disabling the module drops master mode and releases both lines */
+	i2c->C1 = 0;
+	i2c->S = I2C_S_IICIF_MASK | I2C_S_ARBL_MASK; /* clear flags (w1c) */
+	
+	i2c->F = frequencyDivider;
+	i2c->C1 = (1 << I2C_C1_IICEN_SHIFT) & I2C_C1_IICEN_MASK;
+}
+
+/**
+ * @brief Registers the pins an I2C instance is currently muxed to
+ * @param[in] i2c The I2C instance
+ * @param[in] port The port of the pins
+ * @param[in] sclPin The number of the pin used for SCL
+ * @param[in] sclMux The mux value for the SCL pin
+ * @param[in] sdaPin The number of the pin used for SDA
+ * @param[in] sdaMux The mux value for the SDA pin
+ */
+void I2C_SetPins(I2C_MemMapPtr const i2c, PORT_MemMapPtr port, uint32_t sclPin, uint8_t sclMux, uint32_t sdaPin, uint8_t sdaMux)
+{
+	i2c_pins_t *const entry = &pins[I2C_InstanceIndex(i2c)];
+	entry->port = port;
+	entry->sclPin = sclPin;
+	entry->sclMux = sclMux;
+	entry->sdaPin = sdaPin;
+	entry->sdaMux = sdaMux;
+}
+
+/**
+ * @brief Busy waits for half an SCL period while clearing the bus
+ * 
+ * May be called with interrupts masked.
+ */
+static void HalfPeriodDelay()
+{
+	const uint32_t start = SysTick_Microseconds();
+	while ((SysTick_Microseconds() - start) < I2C_CLEAR_HALF_PERIOD_US) {}
+}
+
+/**
+ * @brief Clears a bus held by a slave and re-initializes the module
+ * @param[in] i2c The I2C instance
+ * @return {@see I2C_STATUS_OK} if the bus is idle afterwards, {@see I2C_STATUS_BUSY} otherwise
+ */
+i2c_status_t I2C_ClearBus(I2C_MemMapPtr const i2c)
+{
+	const i2c_pins_t *const entry = &pins[I2C_InstanceIndex(i2c)];
+	PORT_MemMapPtr const port = entry->port;
+	
+	/* release the module first; without known pins this is all that can be done */
+	I2C_ResetBus(i2c);
+	if (NULL == port)
+	{
+		return (i2c->S & I2C_S_BUSY_MASK) ? I2C_STATUS_BUSY : I2C_STATUS_OK;
+	}
+	
+	/* the GPIO instances are laid out like the ports, 0x40 apart instead of 0x1000; accessed through the BME capable alias */
+	const uint32_t portIndex = ((uint32_t)port - (uint32_t)PORTA_BASE_PTR) >> 12;
+	GPIO_MemMapPtr const gpio = BITFLAG_GPIO((GPIO_MemMapPtr)((uint32_t)PTA_BASE_PTR + (portIndex << 6)));
+	const uint32_t scl = 1 << entry->sclPin;
+	const uint32_t sda = 1 << entry->sdaPin;
+	
+	/* emulate open drain: the output latches stay low, a line is pulled low by making it an output */
+	gpio->PCOR = scl | sda;
+	BitFlag_Clear32(&gpio->PDDR, scl | sda);
+	port->PCR[entry->sclPin] = PORT_PCR_MUX(1) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK;
+	port->PCR[entry->sdaPin] = PORT_PCR_MUX(1) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK;
+	HalfPeriodDelay();
+	
+	/* clock until the slave finished its byte and released SDA */
+	for (uint32_t clock = 0; clock < I2C_CLEAR_CLOCKS && 0 == (gpio->PDIR & sda); ++clock)
+	{
+		BitFlag_Set32(&gpio->PDDR, scl);
+		HalfPeriodDelay();
+		BitFlag_Clear32(&gpio->PDDR, scl);
+		HalfPeriodDelay();
 	}
-#endif
 	
-#if !I2C_USE_BME
-	I2C0->S |= I2C_S_IICIF_MASK; /* clear interrupt flag */
-#else
-	BME_OR_B(&I2C0->S, ((1 << I2C_S_IICIF_SHIFT) << I2C_S_IICIF_MASK));
-#endif	
+	/* stop condition: SDA rises while SCL is high */
+	BitFlag_Set32(&gpio->PDDR, scl);
+	HalfPeriodDelay();
+	BitFlag_Set32(&gpio->PDDR, sda);
+	HalfPeriodDelay();
+	BitFlag_Clear32(&gpio->PDDR, scl);
+	HalfPeriodDelay();
+	BitFlag_Clear32(&gpio->PDDR, sda);
+	HalfPeriodDelay();
+	
+	/* hand the pins back to the module */
+	port->PCR[entry->sclPin] = PORT_PCR_MUX(entry->sclMux);
+	port->PCR[entry->sdaPin] = PORT_PCR_MUX(entry->sdaMux);
+	
+	I2C_ResetBus(i2c);
+	return (i2c->S & I2C_S_BUSY_MASK) ? I2C_STATUS_BUSY : I2C_STATUS_OK;
 }
 
 /**
  * @brief Initiates a register read after the module was brought into TX mode.
+ * @param[in] i2c The I2C instance
  * @param[in] slaveId The slave id
  * @param[in] registerAddress the register to read from 
+ * @return The transfer status
  */
-void I2C_InitiateRegisterReadAt(const register uint8_t slaveId, const register uint8_t registerAddress)
+i2c_status_t I2C_InitiateRegisterReadAt(I2C_MemMapPtr const i2c, const register uint8_t slaveId, const register uint8_t registerAddress)
 {
 	/* send register id */
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(slaveId));
-	I2C_SendBlocking(registerAddress);
+	I2C_SendBlocking(i2c, I2C_WRITE_ADDRESS(slaveId));
+	I2C_SendBlocking(i2c, registerAddress);
 	
 	/* enter read mode */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_READ_ADDRESS(slaveId));
-	I2C_EnterReceiveModeWithAck();
-	I2C_ReceiverModeDriveClock();	
+	I2C_SendRepeatedStart(i2c);
+	I2C_SendBlocking(i2c, I2C_READ_ADDRESS(slaveId));
+	I2C_EnterReceiveModeWithAck(i2c);
+	return I2C_ReceiverModeDriveClock(i2c);
 }
@@ -6,16 +6,24 @@
  */
 
 #include "derivative.h"
-#include "bme.h"
+#include "cpu/bitflag.h"
+#include "i2c/i2c.h"
 #include "i2c/i2carbiter.h"
 
 /**
- * @brief Control structure for the I2C arbiter
+ * @brief Selection state of a single I2C instance
  */
 typedef struct {
 	uint32_t lastSelectedHash;		/*< The last selected hash */
-	uint8_t lastSelectedSlave;		/*< The last selected slave address */
-	uint8_t lastSelectedSlaveIndex;	/*< The list index of the last selected slave */
+	i2carbiter_handle_t lastSelectedHandle;	/*< The handle of the last selected slave */
+	uint8_t frequencyDivider;		/*< The currently programmed F register value */
+} i2carbiter_bus_t;
+
+/**
+ * @brief Control structure for the I2C arbiter
+ */
+typedef struct {
+	i2carbiter_bus_t buses[I2C_INSTANCE_COUNT];	/*< The selection state by I2C instance */
 	i2carbiter_entry_t* entries;	/*< The arbiter entries */
 	const uint8_t entryCount;		/*< The number of arbiter entries */
 } i2carbiter_t;
@@ -28,18 +36,22 @@ static i2carbiter_t configuration;
 /**
  * @brief Configures n I2C arbiter entry
  * @param[inout] entry The entry
+ * @param[in] bus The I2C instance the slave is attached to
  * @param[in] port The port to use
  * @param[in] sdaPin The number of the pin used for SDA
  * @param[in] sclPin The number of the pin used for SCL
+ * @param[in] speed The bus frequency in Hz, e.g. {@see I2C_SPEED_FAST}
  */
-void I2CArbiter_PrepareEntry(i2carbiter_entry_t *entry, uint8_t slaveAddress, PORT_MemMapPtr port, uint32_t sclPin, uint8_t sclMux, uint32_t sdaPin, uint8_t sdaMux)
+void I2CArbiter_PrepareEntry(i2carbiter_entry_t *entry, uint8_t slaveAddress, I2C_MemMapPtr bus, PORT_MemMapPtr port, uint32_t sclPin, uint8_t sclMux, uint32_t sdaPin, uint8_t sdaMux, uint32_t speed)
 {
+	entry->bus = bus;
 	entry->port = port;
 	*(uint8_t*)&entry->slaveAddress = slaveAddress;
 	*(uint32_t*)&entry->sdaPin = sdaPin;
 	*(uint8_t*)&entry->sdaMux = sdaMux;
 	*(uint32_t*)&entry->sclPin = sclPin;
 	*(uint8_t*)&entry->sclMux = sclMux;
+	*(uint8_t*)&entry->frequencyDivider = I2C_FrequencyDivider(bus, speed);
 	
 	/* hash the unique configuration 
 	 * The number 37 and 23 are arbitrary co-primes. 
@@ -57,70 +69,179 @@ void I2CArbiter_PrepareEntry(i2carbiter_entry_t *entry, uint8_t slaveAddress, PO
  * @param[inout] config The control structure
  * @param[in] entries The entries
  * @param[in] entryCount the number of entries
+ * 
+ * The I2C instances of all entries must have been initialized.
  */
 void I2CArbiter_Configure(i2carbiter_entry_t *entries, uint8_t entryCount)
 {
-	configuration.lastSelectedSlave = 0;
-	configuration.lastSelectedHash = 0;
+	for (int i=0; i<I2C_INSTANCE_COUNT; ++i)
+	{
+		configuration.buses[i].lastSelectedHandle = I2CARBITER_NO_HANDLE;
+		configuration.buses[i].lastSelectedHash = 0;
+	}
+	
 	configuration.entries = entries;
 	*(uint32_t*)&configuration.entryCount = entryCount;
 	
-	/* assume the first slave will be used first */ 
-	I2CArbiter_Select(entries[0].slaveAddress);
+	/* assume the first slave of every bus will be used first */
+	for (int i=0; i<entryCount; ++i)
+	{
+		i2carbiter_bus_t *const state = &configuration.buses[I2C_InstanceIndex(entries[i].bus)];
+		if (I2CARBITER_NO_HANDLE == state->lastSelectedHandle)
+		{
+			state->frequencyDivider = entries[i].bus->F;
+			I2CArbiter_SelectHandle(I2CARBITER_HANDLE(i));
+		}
+	}
+	
+	/* leave the first slave's bus selected for the blocking functions */
+	I2CArbiter_SelectHandle(I2CARBITER_HANDLE(0));
+}
+
+/**
+ * @brief Looks up the handle of a slave
+ * @param[in] slaveAddress The slave address
+ * @return The handle of the first entry with this address or {@see I2CARBITER_NO_HANDLE} if the slave is unknown
+ */
+i2carbiter_handle_t I2CArbiter_Handle(uint8_t slaveAddress)
+{
+	register int count = configuration.entryCount;
+	for (int i=0; i<count; ++i)
+	{
+		if (configuration.entries[i].slaveAddress == slaveAddress)
+		{
+			return I2CARBITER_HANDLE(i);
+		}
+	}
+	
+	return I2CARBITER_NO_HANDLE;
+}
+
+/**
+ * @brief Resolves a handle to its arbiter entry
+ * @param[in] handle The handle
+ * @return The entry or NULL if the handle is invalid
+ */
+static inline i2carbiter_entry_t* EntryOf(const i2carbiter_handle_t handle)
+{
+	/* the unsigned wrap-around rejects I2CARBITER_NO_HANDLE as well */
+	const uint8_t index = (uint8_t)(handle - 1);
+	return (index < configuration.entryCount) ? &configuration.entries[index] : NULL;
+}
+
+/**
+ * @brief Determines the I2C instance a slave is attached to
+ * @param[in] slaveAddress The slave address
+ * @return The I2C instance or NULL if the slave is unknown
+ */
+I2C_MemMapPtr I2CArbiter_Bus(uint8_t slaveAddress)
+{
+	return I2CArbiter_BusOf(I2CArbiter_Handle(slaveAddress));
 }
 
 /**
- * @brief Selects an I2C slave and prepares the ports.
+ * @brief Determines the I2C instance a slave is attached to by its handle
+ * @param[in] handle The handle of the slave's entry
+ * @return The I2C instance or NULL if the handle is invalid
+ */
+I2C_MemMapPtr I2CArbiter_BusOf(i2carbiter_handle_t handle)
+{
+	const i2carbiter_entry_t *const token = EntryOf(handle);
+	return (NULL != token) ? token->bus : NULL;
+}
+
+/**
+ * @brief Selects an I2C slave and prepares the ports of its bus.
  * @param[in] slaveAddress The slave address
  * @return Zero if successful, nonzero otherwise
  */
 uint8_t I2CArbiter_Select(uint8_t slaveAddress)
 {
-	register uint32_t lastSelectedSlave = configuration.lastSelectedSlave;
+	return I2CArbiter_SelectHandle(I2CArbiter_Handle(slaveAddress));
+}
+
+/**
+ * @brief Selects an I2C slave by its handle and prepares the ports of its bus.
+ * @param[in] handle The handle of the slave's entry
+ * @param[in] waitForStop Nonzero if a clock change has to wait for the previous stop condition
+ * @return Zero if successful, nonzero otherwise
+ */
+static uint8_t SelectEntry(const i2carbiter_handle_t handle, const uint8_t waitForStop)
+{
+	i2carbiter_entry_t *const token = EntryOf(handle);
+	if (NULL == token)
+	{
+		return 1;
+	}
+	
+	/* the pins and clock of the other bus are left alone */
+	I2C_MemMapPtr const bus = token->bus;
+	i2carbiter_bus_t *const state = &configuration.buses[I2C_InstanceIndex(bus)];
+	I2C_SelectBus(bus);
 	
-	/* early exit */
-	if (lastSelectedSlave == slaveAddress) 
+	/* early exit; by entry, so slaves sharing an address on different pins still switch */
+	register i2carbiter_handle_t lastSelectedHandle = state->lastSelectedHandle;
+	if (lastSelectedHandle == handle) 
 	{
 		return 0;
 	}
 	
-	/* find the current slave */
-	register uint32_t lastSelectedHash = configuration.lastSelectedHash;
-	register int count = configuration.entryCount;
-	for (int i=0; i<count; ++i)
+	/* only touch the clock if the slave runs at a different bus frequency */
+	if (token->frequencyDivider != state->frequencyDivider)
 	{
-		i2carbiter_entry_t* token = &configuration.entries[i];
-		if (token->slaveAddress == slaveAddress)
+		/* the previous stop condition must be on the wire of the previous slave before the clock changes */
+		if (waitForStop)
 		{
-			/* try to avoid switching by comparing the port address / pin hashes */
-			if (token->hash != lastSelectedHash)
-			{
-				/* disable last slave */
-				if (lastSelectedSlave != 0)
-				{
-					/* disable last selected slave */
-					i2carbiter_entry_t* entry = &configuration.entries[configuration.lastSelectedSlaveIndex];
-					entry->port->PCR[entry->sdaPin] &= ~PORT_PCR_MUX_MASK;
-					entry->port->PCR[entry->sclPin] &= ~PORT_PCR_MUX_MASK;
-				}
+			I2C_WaitWhileBusy(bus);
+		}
+		
+		bus->F = token->frequencyDivider;
+		state->frequencyDivider = token->frequencyDivider;
+	}
 	
-				/* TODO: candidate for BME */
-				
-				/* enable new slave */
-				token->port->PCR[token->sdaPin] &= ~PORT_PCR_MUX_MASK;
-				token->port->PCR[token->sdaPin] |= PORT_PCR_MUX(token->sdaMux);
-				token->port->PCR[token->sclPin] &= ~PORT_PCR_MUX_MASK;
-				token->port->PCR[token->sclPin] |= PORT_PCR_MUX(token->sclMux);
-			}
-			
-			/* set up lookup */
-			configuration.lastSelectedHash = token->hash;
-			configuration.lastSelectedSlave = slaveAddress;
-			configuration.lastSelectedSlaveIndex = i;
-			
-			return 0;
+	/* try to avoid switching by comparing the port address / pin hashes */
+	if (token->hash != state->lastSelectedHash)
+	{
+		/* disable last slave */
+		if (lastSelectedHandle != I2CARBITER_NO_HANDLE)
+		{
+			/* disable last selected slave */
+			i2carbiter_entry_t* entry = EntryOf(lastSelectedHandle);
+			BitFlag_Clear32(&entry->port->PCR[entry->sdaPin], PORT_PCR_MUX_MASK);
+			BitFlag_Clear32(&entry->port->PCR[entry->sclPin], PORT_PCR_MUX_MASK);
 		}
+
+		/* enable new slave; the field insert switches the mux without passing through another function */
+		BitFlag_Insert32(&token->port->PCR[token->sdaPin], PORT_PCR_MUX(token->sdaMux), PORT_PCR_MUX_SHIFT, 3);
+		BitFlag_Insert32(&token->port->PCR[token->sclPin], PORT_PCR_MUX(token->sclMux), PORT_PCR_MUX_SHIFT, 3);
+		
+		/* bus recovery needs to know which pins to bit-bang */
+		I2C_SetPins(bus, token->port, token->sclPin, token->sclMux, token->sdaPin, token->sdaMux);
 	}
 	
-	return 1;
+	/* set up lookup */
+	state->lastSelectedHash = token->hash;
+	state->lastSelectedHandle = handle;
+	
+	return 0;
+}
+
+/**
+ * @brief Selects an I2C slave by its handle and prepares the ports of its bus.
+ * @param[in] handle The handle of the slave's entry
+ * @return Zero if successful, nonzero otherwise
+ */
+uint8_t I2CArbiter_SelectHandle(i2carbiter_handle_t handle)
+{
+	return SelectEntry(handle, 1);
+}
+
+/**
+ * @brief Selects an I2C slave by its handle on a bus the caller has seen idle.
+ * @param[in] handle The handle of the slave's entry
+ * @return Zero if successful, nonzero otherwise
+ */
+uint8_t I2CArbiter_SelectHandleIdle(i2carbiter_handle_t handle)
+{
+	return SelectEntry(handle, 0);
 }
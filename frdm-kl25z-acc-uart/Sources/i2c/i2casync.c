@@ -0,0 +1,720 @@
+/*
+ * i2casync.c
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include "i2c/i2c.h"
+#include "i2c/i2casync.h"
+#include "i2c/i2carbiter.h"
+#include "cpu/irq.h"
+#include "cpu/systick.h"
+
+/**
+ * @brief The bus states of the engine
+ */
+typedef enum {
+	STATE_IDLE,				/*< No transaction on the bus */
+	STATE_ADDRESS,			/*< The write address was sent */
+	STATE_REGISTER,			/*< The register address was sent */
+	STATE_READ_ADDRESS,		/*< The read address was sent after a repeated start */
+	STATE_WRITE,			/*< Data bytes are being written */
+	STATE_READ,				/*< Data bytes are being read */
+	STATE_READ_DMA,			/*< Data bytes are being read by DMA */
+	STATE_WAIT_BUS,			/*< The next transaction waits for the stop condition of the busy bus */
+	STATE_CLEAR_BUS,		/*< The bus is being cleared by {@see I2CAsync_CheckTimeouts} */
+} i2casync_state_t;
+
+/**
+ * @brief The engine control structure of an I2C instance
+ */
+typedef struct {
+	I2C_MemMapPtr const i2c;						/*< The I2C instance */
+	const uint8_t irq;								/*< The IRQ number of the instance */
+#if I2CASYNC_USE_DMA_RX
+	const uint8_t dmaChannel;						/*< The DMA channel used for reception */
+	const uint8_t dmaSource;						/*< The DMAMUX request source of the instance */
+#endif
+	i2casync_transaction_t *queue[I2CASYNC_QUEUE_LENGTH];	/*< The pending transactions */
+	volatile uint32_t head;							/*< The read index of the queue; free running */
+	volatile uint32_t tail;							/*< The write index of the queue; free running */
+	i2casync_transaction_t *volatile active;		/*< The transaction on the bus */
+	uint32_t started;								/*< The {@see SysTick_Microseconds} time the active transaction or the wait for the bus started */
+	volatile uint8_t suspended;						/*< Nonzero if the queue is held back */
+	uint8_t initialized;							/*< Nonzero if {@see I2CAsync_Init} was called for the instance */
+	i2casync_state_t state;							/*< The bus state */
+	uint8_t index;									/*< The index of the next data byte */
+} i2casync_engine_t;
+
+/**
+ * @brief The engines by I2C instance index
+ */
+static i2casync_engine_t engines[I2C_INSTANCE_COUNT] = {
+	{
+		.i2c = I2C0,
+		.irq = I2CASYNC_I2C0_IRQ,
+#if I2CASYNC_USE_DMA_RX
+		.dmaChannel = I2CASYNC_I2C0_DMA_CHANNEL,
+		.dmaSource = I2CASYNC_I2C0_DMA_SOURCE,
+#endif
+	},
+	{
+		.i2c = I2C1,
+		.irq = I2CASYNC_I2C1_IRQ,
+#if I2CASYNC_USE_DMA_RX
+		.dmaChannel = I2CASYNC_I2C1_DMA_CHANNEL,
+		.dmaSource = I2CASYNC_I2C1_DMA_SOURCE,
+#endif
+	}
+};
+
+/**
+ * @brief Enables the I2C interrupt
+ * @param[in] i2c The I2C instance
+ */
+static inline void EnableIrq(I2C_MemMapPtr const i2c)
+{
+	BitFlag_Set8(&i2c->C1, I2C_C1_IICIE_MASK);
+}
+
+/**
+ * @brief Disables the I2C interrupt, handing the bus back to the blocking functions
+ * @param[in] i2c The I2C instance
+ */
+static inline void DisableIrq(I2C_MemMapPtr const i2c)
+{
+	BitFlag_Clear8(&i2c->C1, I2C_C1_IICIE_MASK);
+}
+
+/**
+ * @brief Disables the stop detection interrupt
+ * @param[in] i2c The I2C instance
+ */
+static inline void DisarmStop(I2C_MemMapPtr const i2c)
+{
+	/* writing zero leaves the w1c stop flag alone */
+	i2c->FLT &= ~(I2C_FLT_STOPIE_MASK | I2C_FLT_STOPF_MASK);
+}
+
+/**
+ * @brief Determines if the bus is busy and if so, waits for its stop condition by interrupt
+ * @param[in] engine The engine
+ * @return Nonzero if the bus is busy
+ * 
+ * Never blocks; a bus that stays busy is cleared by {@see I2CAsync_CheckTimeouts}.
+ */
+static uint8_t WaitForStop(i2casync_engine_t *const engine)
+{
+	I2C_MemMapPtr const i2c = engine->i2c;
+	
+	/* a stop condition after clearing the flag latches it again, so none is missed (w1c) */
+	i2c->FLT |= I2C_FLT_STOPF_MASK;
+	if (0 == (i2c->S & I2C_S_BUSY_MASK))
+	{
+		DisarmStop(i2c);
+		return 0;
+	}
+	
+	if (STATE_WAIT_BUS != engine->state)
+	{
+		engine->started = SysTick_Microseconds();
+		engine->state = STATE_WAIT_BUS;
+	}
+	i2c->FLT = (i2c->FLT & ~I2C_FLT_STOPF_MASK) | I2C_FLT_STOPIE_MASK;
+	EnableIrq(i2c);
+	return 1;
+}
+
+#if I2CASYNC_USE_DMA_RX
+
+/**
+ * @brief Enables or disables the I2C DMA requests
+ * @param[in] i2c The I2C instance
+ * @param[in] enabled Nonzero to enable the requests
+ */
+static inline void SetDmaRequests(I2C_MemMapPtr const i2c, const uint8_t enabled)
+{
+	if (enabled)
+	{
+		BitFlag_Set8(&i2c->C1, I2C_C1_DMAEN_MASK);
+	}
+	else
+	{
+		BitFlag_Clear8(&i2c->C1, I2C_C1_DMAEN_MASK);
+	}
+}
+
+/**
+ * @brief Configures the DMA channel and DMAMUX routing for I2C reception
+ * @param[in] engine The engine
+ */
+static void InitReceiveDma(i2casync_engine_t *const engine)
+{
+	const uint8_t channel = engine->dmaChannel;
+	
+	/* enable clock gating to DMAMUX and DMA */
+	BitFlag_Set32(&SIM->SCGC6, SIM_SCGC6_DMAMUX_MASK);
+	BitFlag_Set32(&SIM->SCGC7, SIM_SCGC7_DMA_MASK);
+	
+	/* disable the channel while configuring */
+	DMAMUX0->CHCFG[channel] = 0;
+	
+	/* clear any pending status and halt the channel */
+	DMA0->DMA[channel].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+	DMA0->DMA[channel].DCR = 0;
+	
+	/* the source is fixed to the I2C data register */
+	DMA0->DMA[channel].SAR = (uint32_t)&engine->i2c->D;
+	
+	/* route the I2C request to the channel; requests are only raised while DMAEN is set */
+	DMAMUX0->CHCFG[channel] = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(engine->dmaSource);
+	SetDmaRequests(engine->i2c, 0);
+	
+	/* prepare interrupts for the DMA channel; the IRQ number equals the channel number */
+	Irq_Enable((IRQn_Type)channel, IRQ_SOURCE_I2C_DMA);
+}
+
+/**
+ * @brief Starts receiving all but the last two bytes of the active read by DMA
+ * @param[in] engine The engine
+ * @param[in] transaction The active transaction
+ * 
+ * Must be called in receive mode with ACK enabled, before the dummy read.
+ */
+static inline void StartReceiveDma(i2casync_engine_t *const engine, i2casync_transaction_t *const transaction)
+{
+	const uint8_t channel = engine->dmaChannel;
+	DMA0->DMA[channel].DAR = (uint32_t)transaction->data;
+	DMA0->DMA[channel].DSR_BCR = DMA_DSR_BCR_BCR(transaction->count - 2);
+	
+	/* 8 bit to 8 bit, incrementing destination, cycle steal, stop and interrupt when the byte count is exhausted */
+	DMA0->DMA[channel].DCR = DMA_DCR_EINT_MASK
+										| DMA_DCR_ERQ_MASK
+										| DMA_DCR_CS_MASK
+										| DMA_DCR_DINC_MASK
+										| DMA_DCR_SSIZE(0b01)
+										| DMA_DCR_DSIZE(0b01)
+										| DMA_DCR_D_REQ_MASK;
+	
+	/* the byte interrupts are replaced by the DMA completion */
+	DisableIrq(engine->i2c);
+	SetDmaRequests(engine->i2c, 1);
+}
+
+/**
+ * @brief Halts the RX DMA channel of an engine
+ * @param[in] engine The engine
+ */
+static inline void StopReceiveDma(i2casync_engine_t *const engine)
+{
+	const uint8_t channel = engine->dmaChannel;
+	
+	SetDmaRequests(engine->i2c, 0);
+	DMA0->DMA[channel].DCR = 0;
+	DMA0->DMA[channel].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+	Irq_ClearPending(channel);
+}
+
+#endif
+
+/**
+ * @brief Completes a transaction and invokes its callback
+ * @param[in] transaction The transaction
+ * @param[in] status The final transaction status
+ */
+static inline void Complete(i2casync_transaction_t *const transaction, const i2casync_status_t status)
+{
+	transaction->status = status;
+	if (NULL != transaction->callback)
+	{
+		transaction->callback(transaction);
+	}
+}
+
+/**
+ * @brief Starts the next queued transaction, if any
+ * @param[in] engine The engine
+ * 
+ * Must be called with interrupts masked or from the engine's I2C interrupt.
+ * While the bus is busy, the transaction stays queued until the stop condition
+ * interrupt; a bus that does not free itself is left to {@see I2CAsync_CheckTimeouts}.
+ */
+static void StartNext(i2casync_engine_t *const engine)
+{
+	I2C_MemMapPtr const i2c = engine->i2c;
+	
+	/* the queue is restarted once the bus was cleared */
+	if (STATE_CLEAR_BUS == engine->state) return;
+	
+	engine->active = NULL;
+	if (engine->suspended || engine->head == engine->tail)
+	{
+		DisarmStop(i2c);
+		engine->state = STATE_IDLE;
+		DisableIrq(i2c);
+		return;
+	}
+	
+	/* the previous stop condition takes a few bus cycles to appear on the wire, first on the pins of the previous slave, then on those of the next */
+	i2casync_transaction_t *const transaction = engine->queue[engine->head & (I2CASYNC_QUEUE_LENGTH - 1)];
+	if (WaitForStop(engine)) return;
+	I2CArbiter_SelectHandleIdle(transaction->handle);
+	if (WaitForStop(engine)) return;
+	
+	++engine->head;
+	engine->active = transaction;
+	transaction->status = I2CASYNC_STATUS_ACTIVE;
+	
+	engine->started = SysTick_Microseconds();
+	EnableIrq(i2c);
+	I2C_SendStart(i2c);
+	i2c->D = I2C_WRITE_ADDRESS(transaction->slaveAddress);
+	engine->state = STATE_ADDRESS;
+}
+
+/**
+ * @brief Completes the active transaction and starts the next one
+ * @param[in] engine The engine
+ * @param[in] status The final transaction status
+ * @param[in] sendStop Nonzero if a stop condition still has to be sent
+ */
+static void Finish(i2casync_engine_t *const engine, const i2casync_status_t status, const uint8_t sendStop)
+{
+	if (sendStop)
+	{
+		I2C_SendStop(engine->i2c);
+	}
+	
+	Complete(engine->active, status);
+	
+	/* a higher priority interrupt must not submit between the queue check and going idle */
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	StartNext(engine);
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief Initializes the transaction engine of an I2C instance in suspended state
+ * @param[in] i2c The I2C instance, {@see I2C0} or {@see I2C1}
+ */
+void I2CAsync_Init(I2C_MemMapPtr const i2c)
+{
+	i2casync_engine_t *const engine = &engines[I2C_InstanceIndex(i2c)];
+	
+	engine->head = 0;
+	engine->tail = 0;
+	engine->active = NULL;
+	engine->suspended = 1;
+	engine->state = STATE_IDLE;
+	engine->initialized = 1;
+	
+	DisarmStop(i2c);
+	DisableIrq(i2c);
+	
+#if I2CASYNC_USE_DMA_RX
+	InitReceiveDma(engine);
+#endif
+	
+	/* prepare interrupts for the instance */
+	Irq_Enable((IRQn_Type)engine->irq, IRQ_SOURCE_I2C);
+}
+
+/**
+ * @brief Queues a transaction
+ * @param[in] transaction The transaction; Must stay valid until completion
+ * @return Zero on success, nonzero if the queue is full or the transaction is still pending
+ */
+uint8_t I2CAsync_Submit(i2casync_transaction_t *const transaction)
+{
+	assert(transaction->count > 0);
+	
+	/* resolve the address once, every later submission and selection is a table access */
+	if (I2CARBITER_NO_HANDLE == transaction->handle)
+	{
+		transaction->handle = I2CArbiter_Handle(transaction->slaveAddress);
+	}
+	
+	I2C_MemMapPtr const bus = I2CArbiter_BusOf(transaction->handle);
+	assert(NULL != bus);
+	
+	i2casync_engine_t *const engine = &engines[I2C_InstanceIndex(bus)];
+	assert(engine->initialized);
+	
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	if (I2CAsync_Pending(transaction) || (engine->tail - engine->head) >= I2CASYNC_QUEUE_LENGTH)
+	{
+		__set_PRIMASK(primask);
+		return 1;
+	}
+	
+	transaction->status = I2CASYNC_STATUS_QUEUED;
+	engine->queue[engine->tail++ & (I2CASYNC_QUEUE_LENGTH - 1)] = transaction;
+	
+	if (NULL == engine->active)
+	{
+		StartNext(engine);
+	}
+	
+	__set_PRIMASK(primask);
+	return 0;
+}
+
+/**
+ * @brief Waits for the active transactions to finish and holds back the queues
+ */
+void I2CAsync_Suspend()
+{
+	for (int i=0; i<I2C_INSTANCE_COUNT; ++i)
+	{
+		engines[i].suspended = 1;
+	}
+	
+	for (int i=0; i<I2C_INSTANCE_COUNT; ++i)
+	{
+		i2casync_engine_t *const engine = &engines[i];
+		while (NULL != engine->active)
+		{
+			I2CAsync_CheckTimeouts();
+		}
+		
+		/* a transaction waiting for the bus stays queued; the interrupt flag belongs to the blocking functions now */
+		const uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		if (STATE_WAIT_BUS == engine->state)
+		{
+			DisarmStop(engine->i2c);
+			DisableIrq(engine->i2c);
+			engine->state = STATE_IDLE;
+		}
+		__set_PRIMASK(primask);
+	}
+}
+
+/**
+ * @brief Resumes processing of queued transactions on all initialized instances
+ */
+void I2CAsync_Resume()
+{
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	for (int i=0; i<I2C_INSTANCE_COUNT; ++i)
+	{
+		i2casync_engine_t *const engine = &engines[i];
+		if (!engine->initialized) continue;
+		
+		engine->suspended = 0;
+		if (NULL == engine->active)
+		{
+			StartNext(engine);
+		}
+	}
+	
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief Determines if all instances are idle
+ * @return Nonzero if no transaction is queued or on any bus
+ */
+uint8_t I2CAsync_Idle()
+{
+	for (int i=0; i<I2C_INSTANCE_COUNT; ++i)
+	{
+		const i2casync_engine_t *const engine = &engines[i];
+		if (NULL != engine->active || engine->head != engine->tail) return 0;
+	}
+	return 1;
+}
+
+/**
+ * @brief Aborts active transactions that exceeded their time budget and clears buses that stay busy
+ * 
+ * Must be called from thread mode; the bus is bit-banged with interrupts enabled.
+ */
+void I2CAsync_CheckTimeouts()
+{
+	for (int i=0; i<I2C_INSTANCE_COUNT; ++i)
+	{
+		i2casync_engine_t *const engine = &engines[i];
+		I2C_MemMapPtr const i2c = engine->i2c;
+		
+		/* the engine must not make progress while the bus is taken away */
+		const uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		
+		const uint32_t elapsed = SysTick_Microseconds() - engine->started;
+		i2casync_transaction_t *const transaction = engine->active;
+		if (NULL != transaction)
+		{
+			if (elapsed <= I2CASYNC_TIMEOUT_BASE_US + I2CASYNC_TIMEOUT_PER_BYTE_US * (uint32_t)transaction->count)
+			{
+				__set_PRIMASK(primask);
+				continue;
+			}
+			
+			/* silence the instance; the transaction stays active, so no other is started meanwhile */
+#if I2CASYNC_USE_DMA_RX
+			StopReceiveDma(engine);
+#endif
+		}
+		else if (STATE_WAIT_BUS != engine->state || elapsed <= I2CASYNC_TIMEOUT_BASE_US)
+		{
+			__set_PRIMASK(primask);
+			continue;
+		}
+		else
+		{
+			/* the stop condition never came */
+			DisarmStop(i2c);
+		}
+		
+		DisableIrq(i2c);
+		Irq_ClearPending(engine->irq);
+		engine->state = STATE_CLEAR_BUS;
+		__set_PRIMASK(primask);
+		
+		/* bit-bang the stalled slave off the bus */
+		const i2c_status_t status = I2C_ClearBus(i2c);
+		
+		__disable_irq();
+		engine->state = STATE_IDLE;
+		if (NULL != transaction)
+		{
+			Finish(engine, I2CASYNC_STATUS_TIMEOUT, 0);
+		}
+		else
+		{
+			/* a bus that cannot be freed fails the queued transactions one per timeout */
+			if (I2C_STATUS_OK != status && !engine->suspended && engine->head != engine->tail)
+			{
+				Complete(engine->queue[engine->head++ & (I2CASYNC_QUEUE_LENGTH - 1)], I2CASYNC_STATUS_ERROR);
+			}
+			StartNext(engine);
+		}
+		__set_PRIMASK(primask);
+	}
+}
+
+/**
+ * @brief Services the I2C interrupt of an engine
+ * @param[in] engine The engine
+ */
+static void HandleInterrupt(i2casync_engine_t *const engine)
+{
+	I2C_MemMapPtr const i2c = engine->i2c;
+	
+	/* the stop condition the next transaction waited for; the stop flag must be cleared before the interrupt flag (w1c) */
+	if (STATE_WAIT_BUS == engine->state)
+	{
+		i2c->FLT |= I2C_FLT_STOPF_MASK;
+		BitFlag_Acknowledge8(&i2c->S, I2C_S_IICIF_MASK);
+		
+		const uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		StartNext(engine);
+		__set_PRIMASK(primask);
+		return;
+	}
+	
+	const uint8_t status = i2c->S;
+	
+	/* clear the interrupt flag (w1c) */
+	BitFlag_Acknowledge8(&i2c->S, I2C_S_IICIF_MASK);
+	
+	i2casync_transaction_t *const transaction = engine->active;
+	if (NULL == transaction) return;
+	
+	/* arbitration lost: the module already left master mode */
+	if (status & I2C_S_ARBL_MASK)
+	{
+		i2c->S = I2C_S_ARBL_MASK;
+		Finish(engine, I2CASYNC_STATUS_ERROR, 0);
+		return;
+	}
+	
+	switch (engine->state)
+	{
+		case STATE_ADDRESS:
+		{
+			if (status & I2C_S_RXAK_MASK) break;
+			
+			i2c->D = transaction->registerAddress;
+			engine->state = STATE_REGISTER;
+			return;
+		}
+		case STATE_REGISTER:
+		{
+			if (status & I2C_S_RXAK_MASK) break;
+			
+			if (I2CASYNC_WRITE == transaction->direction)
+			{
+				engine->index = 1;
+				i2c->D = transaction->data[0];
+				engine->state = STATE_WRITE;
+			}
+			else
+			{
+				I2C_SendRepeatedStart(i2c);
+				i2c->D = I2C_READ_ADDRESS(transaction->slaveAddress);
+				engine->state = STATE_READ_ADDRESS;
+			}
+			return;
+		}
+		case STATE_WRITE:
+		{
+			if (status & I2C_S_RXAK_MASK) break;
+			
+			if (engine->index < transaction->count)
+			{
+				i2c->D = transaction->data[engine->index++];
+			}
+			else
+			{
+				Finish(engine, I2CASYNC_STATUS_DONE, 1);
+			}
+			return;
+		}
+		case STATE_READ_ADDRESS:
+		{
+			if (status & I2C_S_RXAK_MASK) break;
+			
+			/* a single byte read must be NACKed right away */
+			if (1 == transaction->count)
+			{
+				I2C_EnterReceiveModeWithoutAck(i2c);
+			}
+			else
+			{
+				I2C_EnterReceiveModeWithAck(i2c);
+			}
+			
+			/* dummy read to drive the clock for the first byte */
+			engine->index = 0;
+			engine->state = STATE_READ;
+#if I2CASYNC_USE_DMA_RX
+			if (transaction->count >= I2CASYNC_DMA_MIN_COUNT)
+			{
+				StartReceiveDma(engine, transaction);
+				engine->state = STATE_READ_DMA;
+			}
+#endif
+			INTENTIONALLY_UNUSED(register uint8_t) = i2c->D;
+			return;
+		}
+		case STATE_READ:
+		{
+			const uint8_t remaining = transaction->count - engine->index;
+			if (1 == remaining)
+			{
+				/* stop before reading D, otherwise another byte would be clocked in */
+				I2C_SendStop(i2c);
+				transaction->data[engine->index++] = i2c->D;
+				Finish(engine, I2CASYNC_STATUS_DONE, 0);
+				return;
+			}
+			
+			/* NACK the last byte */
+			if (2 == remaining)
+			{
+				I2C_DisableAck(i2c);
+			}
+			
+			transaction->data[engine->index++] = i2c->D;
+			return;
+		}
+		default:
+		{
+			return;
+		}
+	}
+	
+	/* the slave did not acknowledge */
+	Finish(engine, I2CASYNC_STATUS_NACK, 1);
+}
+
+/**
+ * @brief IRQ handler for I2C0
+ */
+void I2C0_Handler()
+{
+	IRQ_PROFILE_ENTER();
+	HandleInterrupt(&engines[0]);
+	IRQ_PROFILE_EXIT(IRQ_SOURCE_I2C);
+}
+
+/**
+ * @brief IRQ handler for I2C1
+ */
+void I2C1_Handler()
+{
+	IRQ_PROFILE_ENTER();
+	HandleInterrupt(&engines[1]);
+	IRQ_PROFILE_EXIT(IRQ_SOURCE_I2C);
+}
+
+#if I2CASYNC_USE_DMA_RX
+
+/**
+ * @brief Services the RX DMA channel interrupt of an engine
+ * @param[in] engine The engine
+ */
+static void HandleDmaInterrupt(i2casync_engine_t *const engine)
+{
+	I2C_MemMapPtr const i2c = engine->i2c;
+	const uint8_t channel = engine->dmaChannel;
+	const uint32_t status = DMA0->DMA[channel].DSR_BCR;
+	
+	/* clear the done flag (and any error flags) */
+	DMA0->DMA[channel].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+	SetDmaRequests(i2c, 0);
+	
+	i2casync_transaction_t *const transaction = engine->active;
+	if (NULL == transaction || STATE_READ_DMA != engine->state) return;
+	
+	if (status & (DMA_DSR_BCR_CE_MASK | DMA_DSR_BCR_BES_MASK | DMA_DSR_BCR_BED_MASK))
+	{
+		Finish(engine, I2CASYNC_STATUS_ERROR, 1);
+		return;
+	}
+	
+	/* the second to last byte is on the wire; hand it to the I2C interrupt */
+	engine->index = transaction->count - 2;
+	engine->state = STATE_READ;
+	
+	/* drop the flag of the last DMA served byte (w1c) */
+	BitFlag_Acknowledge8(&i2c->S, I2C_S_IICIF_MASK);
+	EnableIrq(i2c);
+	
+	/* the byte may have completed before the flag was cleared */
+	if (i2c->S & I2C_S_TCF_MASK)
+	{
+		Irq_SetPending(engine->irq);
+	}
+}
+
+/**
+ * @brief IRQ handler for the I2C0 RX DMA channel
+ */
+void DMA1_Handler()
+{
+	IRQ_PROFILE_ENTER();
+	HandleDmaInterrupt(&engines[0]);
+	IRQ_PROFILE_EXIT(IRQ_SOURCE_I2C_DMA);
+}
+
+/**
+ * @brief IRQ handler for the I2C1 RX DMA channel
+ */
+void DMA2_Handler()
+{
+	IRQ_PROFILE_ENTER();
+	HandleDmaInterrupt(&engines[1]);
+	IRQ_PROFILE_EXIT(IRQ_SOURCE_I2C_DMA);
+}
+
+#endif
@@ -5,6 +5,8 @@
  *      Author: Markus
  */
 
+#include <stddef.h>
+#include <string.h>
 #include "imu/hmc5883l.h"
 #include "endian.h"
 #include "i2c/i2c.h"
@@ -22,6 +24,23 @@
 	configuration->reg &= (uint8_t)~(HMC5883L_ ## reg ## _ ## bits ## _MASK); \
 	configuration->reg |= (value << HMC5883L_## reg ## _ ## bits ## _SHIFT) & HMC5883L_ ## reg ## _ ## bits ## _MASK
 
+/**
+ * @brief The configuration last fetched from or written to the device
+ */
+static hmc5883l_confreg_t shadow;
+
+/**
+ * @brief Nonzero if {@see shadow} matches the device
+ */
+static uint8_t shadowValid = 0;
+
+/**
+ * @brief The register blocks written by {@see HMC5883L_StoreConfiguration}
+ */
+static const i2c_regblock_t storeBlocks[] = {
+	{ HMC5883L_REG_CRA,	offsetof(hmc5883l_confreg_t, CRA),	3 },	/* CRA, CRB, MR */
+};
+
 /**
  * @brief Reads the Identification registers from the HMC5883L.
  * @return Device identification code; Should be 0x00483433 ('\0H43' sequential Memory!)
@@ -40,15 +59,17 @@ uint32_t HMC5883L_Identification()
  */
 void HMC5883L_ReadData(hmc5883l_data_t *const data)
 {
+	I2C_MemMapPtr const i2c = I2C_SelectedBus();
+	
 	assert_not_null(data);
 	register uint8_t bufferA, bufferB;
 	
 	/* fetch the data */
 #if 0
-	I2C_SendStart();
-	I2C_InitiateRegisterReadAt(HMC5883L_I2CADDR, HMC5883L_REG_SR);
-	I2C_DisableAck();
-	bufferA = I2C_ReceiveAndStop();
+	I2C_SendStart(i2c);
+	I2C_InitiateRegisterReadAt(i2c, HMC5883L_I2CADDR, HMC5883L_REG_SR);
+	I2C_DisableAck(i2c);
+	bufferA = I2C_ReceiveAndStop(i2c);
 	if ((bufferA & HMC5883L_SR_LOCK_MASK) || !(bufferA & HMC5883L_SR_RDY_MASK))
 	{
 		/* data is either locked - a write process is in process -
@@ -61,64 +82,195 @@ void HMC5883L_ReadData(hmc5883l_data_t *const data)
 	/* TODO: find a way to keep the wire here using repeated start */
 	
 	/* if there is data available and no lock, read data */
-	I2C_SendStart();
-	I2C_InitiateRegisterReadAt(HMC5883L_I2CADDR, HMC5883L_REG_DXRA);
+	I2C_SendStart(i2c);
+	I2C_InitiateRegisterReadAt(i2c, HMC5883L_I2CADDR, HMC5883L_REG_DXRA);
 	
 	/* read x */
-	bufferA = I2C_ReceiveDriving();
-	bufferB = I2C_ReceiveDriving();
+	bufferA = I2C_ReceiveDriving(i2c);
+	bufferB = I2C_ReceiveDriving(i2c);
 	data->x = (int16_t)(((bufferA << 8) & 0xFF00) | ((bufferB) & 0x00FF));
 		
 	/* read z - note that this is not a bug but the 
     * actual ordering of the sensor data registers */
-    bufferA = I2C_ReceiveDriving();
-    bufferB = I2C_ReceiveDriving();
+    bufferA = I2C_ReceiveDriving(i2c);
+    bufferB = I2C_ReceiveDriving(i2c);
 	data->z = (int16_t)(((bufferA << 8) & 0xFF00) | ((bufferB) & 0x00FF));
 
     /* read y */
-    bufferA = I2C_ReceiveDrivingWithNack();
-    bufferB = I2C_ReceiveAndStop();
+    bufferA = I2C_ReceiveDrivingWithNack(i2c);
+    bufferB = I2C_ReceiveAndStop(i2c);
     data->y = (int16_t)(((bufferA << 8) & 0xFF00) | ((bufferB)& 0x00FF));
 }
 
+/**
+ * @brief Prepares an asynchronous read of the sensor data and status
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] block The buffer of {@see HMC5883L_DATA_BLOCK_LENGTH} bytes to read into
+ */
+void HMC5883L_PrepareReadData(i2casync_transaction_t *const transaction, uint8_t (*const block)[HMC5883L_DATA_BLOCK_LENGTH])
+{
+	assert_not_null(transaction);
+	assert_not_null(block);
+	
+	transaction->slaveAddress = HMC5883L_I2CADDR;
+	transaction->registerAddress = HMC5883L_REG_DXRA;
+	transaction->direction = I2CASYNC_READ;
+	transaction->count = HMC5883L_DATA_BLOCK_LENGTH;
+	transaction->data = *block;
+}
+
+/**
+ * @brief Decodes the data read by an asynchronous transaction
+ * @param[in] block The register block read
+ * @param[out] data The sensor data, including the status register
+ */
+void HMC5883L_DecodeData(const uint8_t (*const block)[HMC5883L_DATA_BLOCK_LENGTH], hmc5883l_data_t *const data)
+{
+	assert_not_null(block);
+	assert_not_null(data);
+	
+	/* note that z precedes y in the register map */
+	const uint8_t *const registers = *block;
+	data->x = (int16_t)(((registers[0] << 8) & 0xFF00) | ((registers[1]) & 0x00FF));
+	data->z = (int16_t)(((registers[2] << 8) & 0xFF00) | ((registers[3]) & 0x00FF));
+	data->y = (int16_t)(((registers[4] << 8) & 0xFF00) | ((registers[5]) & 0x00FF));
+	data->status = registers[6];
+}
+
+/**
+ * @brief Starts a single measurement
+ */
+void HMC5883L_TriggerMeasurement()
+{
+	I2C_WriteRegister(HMC5883L_I2CADDR, HMC5883L_REG_MR, (HMC5883L_MD_SINGLE << HMC5883L_MR_MD_SHIFT) & HMC5883L_MR_MD_MASK);
+}
+
+/**
+ * @brief Prepares an asynchronous transaction starting a single measurement
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] mode The buffer holding the mode register value to write
+ */
+void HMC5883L_PrepareTriggerMeasurement(i2casync_transaction_t *const transaction, uint8_t *const mode)
+{
+	assert_not_null(transaction);
+	assert_not_null(mode);
+	
+	*mode = (HMC5883L_MD_SINGLE << HMC5883L_MR_MD_SHIFT) & HMC5883L_MR_MD_MASK;
+	
+	transaction->slaveAddress = HMC5883L_I2CADDR;
+	transaction->registerAddress = HMC5883L_REG_MR;
+	transaction->direction = I2CASYNC_WRITE;
+	transaction->count = 1;
+	transaction->data = mode;
+}
+
+/**
+ * @brief Configures the MPU6050 to read the HMC5883L over its auxiliary bus every sample
+ * @param[inout] configuration The MPU6050 configuration structure
+ */
+void HMC5883L_ConfigurePassThrough(mpu6050_confreg_t *const configuration)
+{
+	assert_not_null(configuration);
+	
+	/* slave 0 addresses DXRA on every sample and reads through the status register */
+	MPU6050_ConfigureAuxiliaryRead(configuration, HMC5883L_I2CADDR, HMC5883L_REG_DXRA, HMC5883L_DATA_BLOCK_LENGTH);
+}
+
+/**
+ * @brief Prepares an asynchronous read of the MPU6050 data together with the passed through HMC5883L data
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] block The buffer to read into
+ */
+void HMC5883L_PreparePassThroughRead(i2casync_transaction_t *const transaction, hmc5883l_passthrough_block_t *const block)
+{
+	assert_not_null(transaction);
+	assert_not_null(block);
+	
+	transaction->slaveAddress = MPU6050_I2CADDR;
+	transaction->registerAddress = MPU6050_REG_INT_STATUS;
+	transaction->direction = I2CASYNC_READ;
+	transaction->count = sizeof(hmc5883l_passthrough_block_t);
+	transaction->data = (uint8_t*)block;
+}
+
+/**
+ * @brief Decodes the data read by an asynchronous pass-through transaction
+ * @param[in] block The register block read
+ * @param[out] mpu6050 The MPU6050 data; status is zero if no fresh data was available
+ * @param[out] data The HMC5883L data, including the status register
+ */
+void HMC5883L_DecodePassThroughData(const hmc5883l_passthrough_block_t *const block, mpu6050_sensor_t *const mpu6050, hmc5883l_data_t *const data)
+{
+	assert_not_null(block);
+	
+	MPU6050_DecodeData(&block->mpu6050, mpu6050);
+	HMC5883L_DecodeData(&block->hmc5883l, data);
+}
+
 /**
  * @brief Fetches the HMC5883L configuration
  * @param[inout] configuration The configuration
  */
 void HMC5883L_FetchConfiguration(hmc5883l_confreg_t *const configuration)
 {
+	I2C_MemMapPtr const i2c = I2C_SelectedBus();
+	
 	assert_not_null(configuration);
 	
 	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
+	I2C_WaitWhileBusy(i2c);
 	
 	/* start register addressing */
-	I2C_SendStart();
-	I2C_InitiateRegisterReadAt(HMC5883L_I2CADDR, HMC5883L_REG_CRA);
-	configuration->CRA = I2C_ReceiveDriving();
-	configuration->CRB = I2C_ReceiveDrivingWithNack();
-	configuration->MR = I2C_ReceiveAndStop();
+	I2C_SendStart(i2c);
+	I2C_InitiateRegisterReadAt(i2c, HMC5883L_I2CADDR, HMC5883L_REG_CRA);
+	configuration->CRA = I2C_ReceiveDriving(i2c);
+	configuration->CRB = I2C_ReceiveDrivingWithNack(i2c);
+	configuration->MR = I2C_ReceiveAndStop(i2c);
+	
+	/* the device holds this configuration now */
+	shadow = *configuration;
+	shadowValid = (I2C_STATUS_OK == I2C_Status(i2c));
 }
 
 /**
  * @brief Stores the HMC5883L configuration
  * @param[in] configuration The configuration
+ * 
+ * Only registers that differ from the last fetched or stored configuration are written.
  */
 void HMC5883L_StoreConfiguration(const hmc5883l_confreg_t *const configuration)
 {
 	assert_not_null(configuration);
 	
-	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
+	const i2c_status_t status = I2C_WriteRegisterBlocks(HMC5883L_I2CADDR, storeBlocks, sizeof(storeBlocks)/sizeof(storeBlocks[0]),
+			(const uint8_t*)configuration, shadowValid ? (const uint8_t*)&shadow : NULL);
 	
-	/* start register addressing */
-	I2C_SendStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(HMC5883L_I2CADDR));
-	I2C_SendBlocking(HMC5883L_REG_CRA);
-	I2C_SendBlocking(configuration->CRA);
-	I2C_SendBlocking(configuration->CRB);
-	I2C_SendBlocking(configuration->MR);
-	I2C_SendStop();
+	/* after a failure, the device state is unknown */
+	shadow = *configuration;
+	shadowValid = (I2C_STATUS_OK == status);
+	
+	/* a single measurement drops back to idle by itself */
+	if (((shadow.MR & HMC5883L_MR_MD_MASK) >> HMC5883L_MR_MD_SHIFT) == HMC5883L_MD_SINGLE)
+	{
+		shadow.MR = (shadow.MR & (uint8_t)~HMC5883L_MR_MD_MASK) | ((HMC5883L_MD_IDLE << HMC5883L_MR_MD_SHIFT) & HMC5883L_MR_MD_MASK);
+	}
+}
+
+/**
+ * @brief Gets the configuration last fetched from or stored to the device
+ * @param[out] configuration The configuration
+ */
+void HMC5883L_RecallConfiguration(hmc5883l_confreg_t *const configuration)
+{
+	assert_not_null(configuration);
+	
+	if (!shadowValid)
+	{
+		HMC5883L_FetchConfiguration(configuration);
+		return;
+	}
+	
+	*configuration = shadow;
 }
 
 /**
@@ -5,6 +5,8 @@
  *      Author: Markus
  */
 
+#include <stddef.h>
+#include <string.h>
 #include "ARMCM0plus.h"
 #include "endian.h"
 #include "nice_names.h"
@@ -34,21 +36,52 @@
 #define XYZ_DATA_CFG_HPF_OUT_SHIFT (0x04u)
 #define XYZ_DATA_CFG_HPF_OUT_MASK (0x10u)
 
+#define F_SETUP_F_MODE_SHIFT	(0x06u)
+#define F_SETUP_F_MODE_MASK		(0xC0u)
+#define F_SETUP_F_WMRK_SHIFT	(0x00u)
+#define F_SETUP_F_WMRK_MASK		(0x3Fu)
+
 /**
- * @brief Reads the accelerometer data in 14bit no-fifo mode
- * @param[out] The accelerometer data; Must not be null. 
+ * @brief The configuration last fetched from or written to the device
  */
-void MMA8451Q_ReadAcceleration14bitNoFifo(mma8451q_acc_t *const data)
+static mma8451q_confreg_t shadow;
+
+/**
+ * @brief Nonzero if {@see shadow} matches the device
+ */
+static uint8_t shadowValid = 0;
+
+/**
+ * @brief The register blocks written by {@see MMA8451Q_StoreConfiguration}, except CTRL_REG1
+ */
+static const i2c_regblock_t storeBlocks[] = {
+	{ MMA8451Q_REG_F_SETUP,			offsetof(mma8451q_confreg_t, F_SETUP),			2 },	/* 0x09 .. 0x0A */
+	{ MMA8451Q_REG_XYZ_DATA_CFG,	offsetof(mma8451q_confreg_t, XYZ_DATA_CFG),		2 },	/* 0x0E .. 0x0F */
+	{ MMA8451Q_REG_PL_CFG,			offsetof(mma8451q_confreg_t, PL_CFG),			5 },	/* 0x11 .. 0x15 */
+	{ MMA8451Q_REG_FF_MT_THS,		offsetof(mma8451q_confreg_t, FF_MT_THS),		2 },	/* 0x17 .. 0x18 */
+	{ MMA8451Q_TRANSIENT_CFG,		offsetof(mma8451q_confreg_t, TRANSIENT_CFG),	1 },	/* 0x1D, TRANSIENT_SCR is read only */
+	{ MMA8451Q_TRANSIENT_THS,		offsetof(mma8451q_confreg_t, TRANSIENT_THS),	3 },	/* 0x1F .. 0x21 */
+	{ MMA8451Q_PULSE_THSX,			offsetof(mma8451q_confreg_t, PULSE_THSX),		7 },	/* 0x23 .. 0x29 */
+	{ MMA8451Q_REG_CTRL_REG2,		offsetof(mma8451q_confreg_t, CTRL_REG2),		7 },	/* 0x2B .. 0x31 */
+};
+
+/**
+ * @brief Tracks a register that was written directly
+ * @param[out] field The register in {@see shadow}
+ * @param[in] value The value written
+ */
+static void ShadowRegister(uint8_t *const field, const uint8_t value)
+{
+	*field = value;
+	if (I2C_STATUS_OK != I2C_Status(I2C_SelectedBus())) shadowValid = 0;
+}
+
+/**
+ * @brief Converts raw 14bit register data to the native 16bit layout
+ * @param[inout] data The accelerometer data
+ */
+static inline void AssignAcceleration14bit(mma8451q_acc_t *const data)
 {
-	/* in 14bit mode there are 7 registers to be read (1 status + 6 data) */
-	static const uint8_t registerCount = 7;
-	
-	/* address the buffer by skipping the padding field */
-	uint8_t *buffer = &data->status;
-	
-	/* read the register data */
-	I2C_ReadRegisters(MMA8451Q_I2CADDR, MMA8451Q_REG_STATUS, registerCount, buffer);
-	
 	/* apply fix for endianness */
 	if (endianCorrectionRequired(FROM_BIG_ENDIAN))
 	{
@@ -63,6 +96,151 @@ void MMA8451Q_ReadAcceleration14bitNoFifo(mma8451q_acc_t *const data)
 	data->z >>= 2;
 }
 
+/**
+ * @brief Reads the accelerometer data in 14bit no-fifo mode
+ * @param[out] The accelerometer data; Must not be null. 
+ */
+void MMA8451Q_ReadAcceleration14bitNoFifo(mma8451q_acc_t *const data)
+{
+	/* address the buffer by skipping the padding field */
+	uint8_t *buffer = &data->status;
+	
+	/* read the register data (1 status + 6 data) */
+	I2C_ReadRegisters(MMA8451Q_I2CADDR, MMA8451Q_REG_STATUS, MMA8451Q_DATA_BLOCK_LENGTH, buffer);
+	
+	AssignAcceleration14bit(data);
+}
+
+/**
+ * @brief Prepares an asynchronous transaction reading the accelerometer data in 14bit no-fifo mode
+ * @param[out] transaction The transaction; the callback is left untouched
+ * @param[in] block The buffer the raw register data is read into
+ */
+void MMA8451Q_PrepareReadAcceleration14bit(i2casync_transaction_t *const transaction, mma8451q_acc_t *const block)
+{
+	assert(transaction != 0x0);
+	assert(block != 0x0);
+	
+	transaction->slaveAddress = MMA8451Q_I2CADDR;
+	transaction->registerAddress = MMA8451Q_REG_STATUS;
+	transaction->direction = I2CASYNC_READ;
+	transaction->count = MMA8451Q_DATA_BLOCK_LENGTH;
+	
+	/* address the buffer by skipping the padding field */
+	transaction->data = &block->status;
+}
+
+/**
+ * @brief Decodes the data read by an asynchronous transaction
+ * @param[in] block The buffer the raw register data was read into
+ * @param[out] data The accelerometer data; may be the same as block
+ */
+void MMA8451Q_DecodeAcceleration14bit(const mma8451q_acc_t *const block, mma8451q_acc_t *const data)
+{
+	assert(block != 0x0);
+	assert(data != 0x0);
+	
+	*data = *block;
+	AssignAcceleration14bit(data);
+}
+
+/**
+ * @brief Reads the FIFO samples in 14bit mode
+ * @param[out] samples The accelerometer samples; Must not be null.
+ * @param[in] capacity The number of samples that fit into {@see samples}
+ * @return The number of samples read
+ */
+uint8_t MMA8451Q_ReadFifo(mma8451q_acc_t *const samples, uint8_t capacity)
+{
+	assert(samples != 0x0);
+	
+	/* reading F_STATUS also clears the watermark and overflow flags */
+	const uint8_t status = I2C_ReadRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_STATUS);
+	
+	uint8_t count = MMA8451Q_F_STATUS_CNT(status);
+	if (count > capacity) count = capacity;
+	
+	/* every burst at OUT_X_MSB pops one sample */
+	for (uint8_t i = 0; i < count; ++i)
+	{
+		samples[i].status = status;
+		I2C_ReadRegisters(MMA8451Q_I2CADDR, MMA8451Q_REG_OUT_X_MSB, MMA8451Q_FIFO_SAMPLE_LENGTH, (uint8_t*)samples[i].xyz);
+		AssignAcceleration14bit(&samples[i]);
+	}
+	
+	return count;
+}
+
+/**
+ * @brief Prepares an asynchronous transaction reading F_STATUS and a batch of FIFO samples
+ * @param[out] transaction The transaction; the callback is left untouched
+ * @param[in] block The buffer the raw register data is read into
+ * @param[in] count The number of samples to read; at most {@see MMA8451Q_FIFO_SIZE}
+ */
+void MMA8451Q_PrepareReadFifo(i2casync_transaction_t *const transaction, mma8451q_fifo_block_t *const block, uint8_t count)
+{
+	assert(transaction != 0x0);
+	assert(block != 0x0);
+	assert(count > 0 && count <= MMA8451Q_FIFO_SIZE);
+	
+	transaction->slaveAddress = MMA8451Q_I2CADDR;
+	transaction->registerAddress = MMA8451Q_REG_STATUS;
+	transaction->direction = I2CASYNC_READ;
+	transaction->count = 1 + count * MMA8451Q_FIFO_SAMPLE_LENGTH;
+	transaction->data = &block->status;
+}
+
+/**
+ * @brief Decodes the FIFO samples read by an asynchronous transaction
+ * @param[in] block The buffer the raw register data was read into
+ * @param[in] count The number of samples the transaction was prepared for
+ * @param[out] samples The accelerometer samples; the status field holds F_STATUS
+ * @return The number of valid samples, i.e. the lower of {@see count} and the FIFO fill level
+ */
+uint8_t MMA8451Q_DecodeFifo(const mma8451q_fifo_block_t *const block, uint8_t count, mma8451q_acc_t *const samples)
+{
+	assert(block != 0x0);
+	assert(samples != 0x0);
+	
+	/* F_STATUS was latched before the first sample was popped */
+	const uint8_t status = block->status;
+	if (count > MMA8451Q_F_STATUS_CNT(status)) count = MMA8451Q_F_STATUS_CNT(status);
+	
+	for (uint8_t i = 0; i < count; ++i)
+	{
+		const uint8_t *sample = block->samples[i];
+		
+		/* the samples are big endian, left-aligned 14bit values */
+		samples[i].status = status;
+		samples[i].x = (int16_t)((sample[0] << 8) | sample[1]) >> 2;
+		samples[i].y = (int16_t)((sample[2] << 8) | sample[3]) >> 2;
+		samples[i].z = (int16_t)((sample[4] << 8) | sample[5]) >> 2;
+	}
+	
+	return count;
+}
+
+/**
+ * @brief Configures the FIFO mode and watermark
+ * @param[inout] configuration The configuration structure or {@see MMA8451Q_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] mode The FIFO mode
+ * @param[in] watermark The sample count at which the FIFO interrupt is raised; 0 disables the watermark
+ */
+void MMA8451Q_SetFifo(mma8451q_confreg_t *const configuration, mma8451q_fifomode_t mode, uint8_t watermark)
+{
+	const register uint8_t value = ((mode << F_SETUP_F_MODE_SHIFT) & F_SETUP_F_MODE_MASK) | ((watermark << F_SETUP_F_WMRK_SHIFT) & F_SETUP_F_WMRK_MASK);
+	
+	if (MMA8451Q_CONFIGURE_DIRECT == configuration)
+	{
+		I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_F_SETUP, value);
+		ShadowRegister(&shadow.F_SETUP, value);
+	}
+	else
+	{
+		configuration->F_SETUP = value;
+	}
+}
+
 /**
  * @brief Sets the data rate and the active mode
  */
@@ -72,7 +250,7 @@ void MMA8451Q_SetDataRate(mma8451q_confreg_t *const configuration, mma8451q_data
 	{
 		const register uint8_t value = ((datarate << CTRL_REG1_DR_SHIFT) & CTRL_REG1_DR_MASK) | ((lownoise << CTRL_REG1_LNOISE_SHIFT) & CTRL_REG1_LNOISE_MASK);
 		const register uint8_t mask = (uint8_t)~(CTRL_REG1_DR_MASK | CTRL_REG1_LNOISE_MASK);
-		I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG1, mask, value); 
+		ShadowRegister(&shadow.CTRL_REG1, I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG1, mask, value));
 	}
 	else
 	{
@@ -109,7 +287,7 @@ void MMA8451Q_SetOversampling(mma8451q_confreg_t *const configuration, mma8451q_
 	{
 		const register uint8_t value = (oversampling << CTRL_REG2_MODS_SHIFT) & CTRL_REG2_MODS_MASK;
 		const register uint8_t mask = (uint8_t)~(CTRL_REG2_MODS_MASK);
-		I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG2, mask, value);
+		ShadowRegister(&shadow.CTRL_REG2, I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG2, mask, value));
 	}
 	else
 	{
@@ -128,7 +306,7 @@ void MMA8451Q_SetSleepOversampling(mma8451q_confreg_t *const configuration, mma8
 	{
 		const register uint8_t value = (oversampling << CTRL_REG2_SMODS_SHIFT) & CTRL_REG2_SMODS_MASK;
 		const register uint8_t mask = (uint8_t)~(CTRL_REG2_SMODS_MASK);
-		I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG2, mask, value);
+		ShadowRegister(&shadow.CTRL_REG2, I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG2, mask, value));
 	}
 	else
 	{
@@ -146,7 +324,9 @@ void MMA8451Q_SetSensitivity(mma8451q_confreg_t *const configuration, mma8451q_s
 {
 	if (MMA8451Q_CONFIGURE_DIRECT == configuration)
 	{
-		I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_XYZ_DATA_CFG, (sensitivity & 0x03) | ((highpassEnabled << 4) & 0x10));
+		const uint8_t value = (sensitivity & 0x03) | ((highpassEnabled << 4) & 0x10);
+		I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_XYZ_DATA_CFG, value);
+		ShadowRegister(&shadow.XYZ_DATA_CFG, value);
 	}
 	else
 	{
@@ -167,7 +347,7 @@ void MMA8451Q_SetInterruptMode(mma8451q_confreg_t *const configuration, mma8451q
 		const uint8_t value = ((mode << CTRL_REG3_PPOD_SHIFT) & CTRL_REG3_PPOD_MASK)
 									| ((polarity << CTRL_REG3_IPOL_SHIFT) & CTRL_REG3_IPOL_MASK);
 		const uint8_t mask = (uint8_t)~(CTRL_REG3_IPOL_MASK | CTRL_REG3_PPOD_MASK);
-		I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG3, mask, value);
+		ShadowRegister(&shadow.CTRL_REG3, I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG3, mask, value));
 	}
 	else
 	{
@@ -197,10 +377,10 @@ void MMA8451Q_ConfigureInterrupt(mma8451q_confreg_t *const configuration, mma845
 	
 	if (MMA8451Q_CONFIGURE_DIRECT == configuration)
 	{
-		I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG5, clearMask, setMask);	
+		ShadowRegister(&shadow.CTRL_REG5, I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG5, clearMask, setMask));
 		
 		/* interrupt enable */
-		I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG4, I2C_MOD_NO_AND_MASK, 1 << irq);
+		ShadowRegister(&shadow.CTRL_REG4, I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG4, I2C_MOD_NO_AND_MASK, 1 << irq));
 	}
 	else
 	{
@@ -218,7 +398,9 @@ void MMA8451Q_ClearInterruptConfiguration(mma8451q_confreg_t *const configuratio
 	if (MMA8451Q_CONFIGURE_DIRECT == configuration)
 	{
 		I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG4, 0);
+		ShadowRegister(&shadow.CTRL_REG4, 0);
 		I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG5, 0);
+		ShadowRegister(&shadow.CTRL_REG5, 0);
 	}
 	else
 	{
@@ -233,183 +415,176 @@ void MMA8451Q_ClearInterruptConfiguration(mma8451q_confreg_t *const configuratio
  */
 void MMA8451Q_FetchConfiguration(mma8451q_confreg_t *const configuration)
 {
+	I2C_MemMapPtr const i2c = I2C_SelectedBus();
+	
 	assert(configuration != 0x0);
 		
 	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
+	I2C_WaitWhileBusy(i2c);
 	
 	/* start register addressing */
-	I2C_SendStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_F_SETUP);
+	I2C_SendStart(i2c);
+	I2C_SendBlocking(i2c, I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
+	I2C_SendBlocking(i2c, MMA8451Q_REG_F_SETUP);
 
 	/* start read */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_READ_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_EnterReceiveModeWithAck();
-	I2C_ReceiverModeDriveClock();
+	I2C_SendRepeatedStart(i2c);
+	I2C_SendBlocking(i2c, I2C_READ_ADDRESS(MMA8451Q_I2CADDR));
+	I2C_EnterReceiveModeWithAck(i2c);
+	I2C_ReceiverModeDriveClock(i2c);
 	
 	/* read the registers */
-	configuration->F_SETUP = I2C_ReceiveDriving();
-	configuration->TRIG_CFG = I2C_ReceiveDriving();
-	*((uint8_t*)&configuration->SYSMOD) = I2C_ReceiveDriving();
+	configuration->F_SETUP = I2C_ReceiveDriving(i2c);
+	configuration->TRIG_CFG = I2C_ReceiveDriving(i2c);
+	*((uint8_t*)&configuration->SYSMOD) = I2C_ReceiveDriving(i2c);
 	
-	I2C_ReceiverModeDriveClock(); /* skip 1 register */
+	I2C_ReceiverModeDriveClock(i2c); /* skip 1 register */
 	
-	*((uint8_t*)&configuration->WHO_AM_I) = I2C_ReceiveDriving();
-	configuration->XYZ_DATA_CFG = I2C_ReceiveDriving();
-	configuration->HP_FILTER_CUTOFF = I2C_ReceiveDriving();
+	*((uint8_t*)&configuration->WHO_AM_I) = I2C_ReceiveDriving(i2c);
+	configuration->XYZ_DATA_CFG = I2C_ReceiveDriving(i2c);
+	configuration->HP_FILTER_CUTOFF = I2C_ReceiveDriving(i2c);
 	
-	I2C_ReceiverModeDriveClock(); /* skip 1 register */
+	I2C_ReceiverModeDriveClock(i2c); /* skip 1 register */
 	
-	configuration->PL_CFG = I2C_ReceiveDriving();
-	configuration->PL_COUNT = I2C_ReceiveDriving();
-	configuration->PL_BF_ZCOMP = I2C_ReceiveDriving();
-	configuration->P_L_THS_REG = I2C_ReceiveDriving();
-	configuration->FF_MT_CFG = I2C_ReceiveDriving();
+	configuration->PL_CFG = I2C_ReceiveDriving(i2c);
+	configuration->PL_COUNT = I2C_ReceiveDriving(i2c);
+	configuration->PL_BF_ZCOMP = I2C_ReceiveDriving(i2c);
+	configuration->P_L_THS_REG = I2C_ReceiveDriving(i2c);
+	configuration->FF_MT_CFG = I2C_ReceiveDriving(i2c);
 	
-	I2C_ReceiverModeDriveClock(); /* skip 1 register */
+	I2C_ReceiverModeDriveClock(i2c); /* skip 1 register */
 	
 #if 1
 	/* After FF_MT_THS (0x17) and FF_MT_COUNT (0x18)
 	 * the next 4 registers are undefined, so bulk-reading
 	 * over them may yield in undesired behaviour
 	 */
-	configuration->FF_MT_THS = I2C_ReceiveDrivingWithNack();
-	configuration->FF_MT_COUNT = I2C_ReceiveAndRestart();
+	configuration->FF_MT_THS = I2C_ReceiveDrivingWithNack(i2c);
+	configuration->FF_MT_COUNT = I2C_ReceiveAndRestart(i2c);
 	
 	/* restart read at 0x1D */
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_TRANSIENT_CFG);
+	I2C_SendBlocking(i2c, I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
+	I2C_SendBlocking(i2c, MMA8451Q_TRANSIENT_CFG);
 	
 	/* re-enter read mode */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_READ_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_EnterReceiveModeWithAck();
-	I2C_ReceiverModeDriveClock();
+	I2C_SendRepeatedStart(i2c);
+	I2C_SendBlocking(i2c, I2C_READ_ADDRESS(MMA8451Q_I2CADDR));
+	I2C_EnterReceiveModeWithAck(i2c);
+	I2C_ReceiverModeDriveClock(i2c);
 #else
 	/* bulk-read through the next registers */
-	configuration->FF_MT_THS = I2C_ReceiveDriving();
-	configuration->FF_MT_COUNT = I2C_ReceiveDriving();
+	configuration->FF_MT_THS = I2C_ReceiveDriving(i2c);
+	configuration->FF_MT_COUNT = I2C_ReceiveDriving(i2c);
 	
-	I2C_ReceiverModeDriveClock(); /* skip 4 registers */
-	I2C_ReceiverModeDriveClock();
-	I2C_ReceiverModeDriveClock();
-	I2C_ReceiverModeDriveClock();
+	I2C_ReceiverModeDriveClock(i2c); /* skip 4 registers */
+	I2C_ReceiverModeDriveClock(i2c);
+	I2C_ReceiverModeDriveClock(i2c);
+	I2C_ReceiverModeDriveClock(i2c);
 #endif
 		
-	configuration->TRANSIENT_CFG = I2C_ReceiveDriving();
-	configuration->TRANSIENT_SCR = I2C_ReceiveDriving();
-	configuration->TRANSIENT_THS = I2C_ReceiveDriving();
-	configuration->TRANSIENT_COUNT = I2C_ReceiveDriving();
-	configuration->PULSE_CFG = I2C_ReceiveDriving();
-	
-	I2C_ReceiverModeDriveClock(); /* skip 1 register */
-	
-	configuration->PULSE_THSX = I2C_ReceiveDriving();
-	configuration->PULSE_THSY = I2C_ReceiveDriving();
-	configuration->PULSE_THSZ = I2C_ReceiveDriving();
-	configuration->PULSE_TMLT = I2C_ReceiveDriving();
-	configuration->PULSE_LTCY = I2C_ReceiveDriving();
-	configuration->PULSE_WIND = I2C_ReceiveDriving();
-	configuration->ASLP_COUNT = I2C_ReceiveDriving();
-	configuration->CTRL_REG1 = I2C_ReceiveDriving();
-	configuration->CTRL_REG2 = I2C_ReceiveDriving();
-	configuration->CTRL_REG3 = I2C_ReceiveDriving();
-	configuration->CTRL_REG4 = I2C_ReceiveDriving();
-	configuration->CTRL_REG5 = I2C_ReceiveDriving();
-	configuration->OFF_X = I2C_ReceiveDriving();
-	configuration->OFF_Y = I2C_ReceiveDrivingWithNack();
-	configuration->OFF_Z = I2C_ReceiveAndStop();
+	configuration->TRANSIENT_CFG = I2C_ReceiveDriving(i2c);
+	configuration->TRANSIENT_SCR = I2C_ReceiveDriving(i2c);
+	configuration->TRANSIENT_THS = I2C_ReceiveDriving(i2c);
+	configuration->TRANSIENT_COUNT = I2C_ReceiveDriving(i2c);
+	configuration->PULSE_CFG = I2C_ReceiveDriving(i2c);
+	
+	I2C_ReceiverModeDriveClock(i2c); /* skip 1 register */
+	
+	configuration->PULSE_THSX = I2C_ReceiveDriving(i2c);
+	configuration->PULSE_THSY = I2C_ReceiveDriving(i2c);
+	configuration->PULSE_THSZ = I2C_ReceiveDriving(i2c);
+	configuration->PULSE_TMLT = I2C_ReceiveDriving(i2c);
+	configuration->PULSE_LTCY = I2C_ReceiveDriving(i2c);
+	configuration->PULSE_WIND = I2C_ReceiveDriving(i2c);
+	configuration->ASLP_COUNT = I2C_ReceiveDriving(i2c);
+	configuration->CTRL_REG1 = I2C_ReceiveDriving(i2c);
+	configuration->CTRL_REG2 = I2C_ReceiveDriving(i2c);
+	configuration->CTRL_REG3 = I2C_ReceiveDriving(i2c);
+	configuration->CTRL_REG4 = I2C_ReceiveDriving(i2c);
+	configuration->CTRL_REG5 = I2C_ReceiveDriving(i2c);
+	configuration->OFF_X = I2C_ReceiveDriving(i2c);
+	configuration->OFF_Y = I2C_ReceiveDrivingWithNack(i2c);
+	configuration->OFF_Z = I2C_ReceiveAndStop(i2c);
+	
+	/* the device holds this configuration now */
+	memcpy(&shadow, configuration, sizeof(shadow));
+	shadowValid = (I2C_STATUS_OK == I2C_Status(i2c));
 }
 
 /**
  * @brief Stores the configuration from a {@see mma8451q_confreg_t} data structure
  * @param[in] The configuration data data; Must not be null.
+ * 
+ * Only registers that differ from the last fetched or stored configuration are written.
  */
 void MMA8451Q_StoreConfiguration(const mma8451q_confreg_t *const configuration)
 {
 	assert(configuration != 0x0);
 	
-	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
-	
-	/* start register addressing at 0x2A - enter passive mode */
-	I2C_SendStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_CTRL_REG1);
-	I2C_SendBlocking(configuration->CTRL_REG1 & ~((1 << CTRL_REG1_ACTIVE_SHIFT) & CTRL_REG1_ACTIVE_MASK)); /* 0x2A, clear active mode */
-	
-	/* start register addressing at 0x09 */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_F_SETUP);
-	I2C_SendBlocking(configuration->F_SETUP); /* 0x09 */
-	I2C_SendBlocking(configuration->TRIG_CFG); /* 0x0A */
-	
-	/* repeat write at 0x0E */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_XYZ_DATA_CFG);
-	I2C_SendBlocking(configuration->XYZ_DATA_CFG); /* 0x0E */
-	I2C_SendBlocking(configuration->HP_FILTER_CUTOFF); /* 0x0F */
-	
-	/* repeat write at 0x11 */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_PL_CFG);
-	I2C_SendBlocking(configuration->PL_CFG); /* 0x11 */
-	I2C_SendBlocking(configuration->PL_COUNT); /* 0x12 */
-	I2C_SendBlocking(configuration->PL_BF_ZCOMP); /* 0x13 */
-	I2C_SendBlocking(configuration->P_L_THS_REG); /* 0x14 */
-	I2C_SendBlocking(configuration->FF_MT_CFG); /* 0x15 */
-	
-	/* repeat write at 0x17 */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_FF_MT_THS);
-	I2C_SendBlocking(configuration->FF_MT_THS); /* 0x17 */
-	I2C_SendBlocking(configuration->FF_MT_COUNT); /* 0x18 */
-	
-	/* repeat write at 0x1D */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_TRANSIENT_CFG);
-	I2C_SendBlocking(configuration->TRANSIENT_CFG); /* 0x1D */
-	
-	/* repeat write at 0x1F */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_TRANSIENT_THS);
-	I2C_SendBlocking(configuration->TRANSIENT_THS); /* 0x1F */
-	I2C_SendBlocking(configuration->TRANSIENT_COUNT); /* 0x20 */
-	I2C_SendBlocking(configuration->PULSE_CFG); /* 0x21 */
-	
-	/* repeat write at 0x23 */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_PULSE_THSX);
-	I2C_SendBlocking(configuration->PULSE_THSX); /* 0x23 */
-	I2C_SendBlocking(configuration->PULSE_THSY); /* 0x24 */
-	I2C_SendBlocking(configuration->PULSE_THSZ); /* 0x25 */
-	I2C_SendBlocking(configuration->PULSE_TMLT); /* 0x26 */
-	I2C_SendBlocking(configuration->PULSE_LTCY); /* 0x27 */
-	I2C_SendBlocking(configuration->PULSE_WIND); /* 0x28 */
-	I2C_SendBlocking(configuration->ASLP_COUNT); /* 0x29 */
-	I2C_SendBlocking(configuration->CTRL_REG1 & ~((1 << CTRL_REG1_ACTIVE_SHIFT) & CTRL_REG1_ACTIVE_MASK));  /* 0x2A, clear active mode */
-	I2C_SendBlocking(configuration->CTRL_REG2);  /* 0x2B */
-	I2C_SendBlocking(configuration->CTRL_REG3); /* 0x2C */
-	I2C_SendBlocking(configuration->CTRL_REG4); /* 0x2D */
-	I2C_SendBlocking(configuration->CTRL_REG5); /* 0x2E */
-	I2C_SendBlocking(configuration->OFF_X); /* 0x2F */
-	I2C_SendBlocking(configuration->OFF_Y); /* 0x30 */
-	I2C_SendBlocking(configuration->OFF_Z); /* 0x31 */
-	
-	/* rewind to 0x2A - enter desired mode */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_CTRL_REG1);
-	I2C_SendBlocking(configuration->CTRL_REG1); /* 0x2A, write real value */
-	
-	I2C_SendStop();
+	/* early exit, the device already holds the configuration */
+	if (shadowValid && 0 == memcmp(configuration, &shadow, sizeof(shadow))) return;
+	
+	/* enter passive mode, the registers may only be changed in standby */
+	const uint8_t standby = configuration->CTRL_REG1 & ~((1 << CTRL_REG1_ACTIVE_SHIFT) & CTRL_REG1_ACTIVE_MASK);
+	i2c_status_t status = I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG1, standby);
+	
+	if (I2C_STATUS_OK == status)
+	{
+		status = I2C_WriteRegisterBlocks(MMA8451Q_I2CADDR, storeBlocks, sizeof(storeBlocks)/sizeof(storeBlocks[0]),
+				(const uint8_t*)configuration, shadowValid ? (const uint8_t*)&shadow : NULL);
+	}
+	
+	/* enter desired mode */
+	if (I2C_STATUS_OK == status && configuration->CTRL_REG1 != standby)
+	{
+		status = I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG1, configuration->CTRL_REG1);
+	}
+	
+	/* after a failure, the device state is unknown */
+	memcpy(&shadow, configuration, sizeof(shadow));
+	shadowValid = (I2C_STATUS_OK == status);
+}
+
+/**
+ * @brief Gets the configuration last fetched from or stored to the device
+ * @param[out] configuration The configuration; Must not be null.
+ */
+void MMA8451Q_RecallConfiguration(mma8451q_confreg_t *const configuration)
+{
+	assert(configuration != 0x0);
+	
+	if (!shadowValid)
+	{
+		MMA8451Q_FetchConfiguration(configuration);
+		return;
+	}
+	
+	memcpy(configuration, &shadow, sizeof(shadow));
+}
+
+/**
+ * @brief Brings the MMA8451Q into passive mode
+ */
+void MMA8451Q_EnterPassiveMode()
+{
+	ShadowRegister(&shadow.CTRL_REG1, I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG1, ~0b00000001, I2C_MOD_NO_OR_MASK));
+}
+
+/**
+ * @brief Resets the MMA8451Q
+ */
+void MMA8451Q_Reset()
+{
+	I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG2, 0b01000000);
+	
+	/* all registers return to their defaults */
+	shadowValid = 0;
+}
+
+/**
+ * @brief Brings the MMA8451Q into active mode
+ */
+void MMA8451Q_EnterActiveMode()
+{
+	ShadowRegister(&shadow.CTRL_REG1, I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG1, I2C_MOD_NO_AND_MASK, 0x01));
 }
@@ -5,6 +5,8 @@
  *      Author: Markus
  */
 
+#include <stddef.h>
+#include <string.h>
 #include "imu/mpu6050.h"
 #include "i2c/i2c.h"
 #include "nice_names.h"
@@ -37,13 +39,71 @@
     variable &= (uint8_t)~(MPU6050_ ## reg ## _ ## bits ## _MASK); \
     variable |= (value << MPU6050_## reg ## _ ## bits ## _SHIFT) & MPU6050_ ## reg ## _ ## bits ## _MASK
 
+/**
+ * @brief The device at the default address, selected until {@see MPU6050_SelectDevice} is called
+ */
+mpu6050_device_t mpu6050_primary = MPU6050_DEVICE_INIT(MPU6050_I2CADDR);
+
+/**
+ * @brief The device the blocking functions talk to
+ */
+static mpu6050_device_t *selected = &mpu6050_primary;
+
+/**
+ * @brief The register blocks written by {@see MPU6050_StoreConfiguration}, in order
+ */
+static const i2c_regblock_t storeBlocks[] = {
+	{ MPU6050_REG_SMPLRT_DIV,	offsetof(mpu6050_confreg_t, SMPLRT_DIV),	4 },	/* 0x19 .. 0x1C */
+	{ MPU6050_REG_PWR_MGMT_1,	offsetof(mpu6050_confreg_t, PWR_MGMT_1),	1 },	/* wake up before the remaining writes */
+	{ MPU6050_REG_FIFO_EN,		offsetof(mpu6050_confreg_t, FIFO_EN),		18 },	/* 0x23 .. 0x34 */
+	{ MPU6050_REG_INT_PIN_CFG,	offsetof(mpu6050_confreg_t, INT_PIN_CFG),	2 },	/* 0x37 .. 0x38 */
+	{ MPU6050_REG_I2C_SLV0_DO,	offsetof(mpu6050_confreg_t, I2C_SLV0_DO),	10 },	/* 0x63 .. 0x6C */
+	{ MPU6050_REG_FIFO_COUNTH,	offsetof(mpu6050_confreg_t, FIFO_COUNTH),	3 },	/* 0x72 .. 0x74 */
+};
+
+/**
+ * @brief Tracks a register that was written directly
+ * @param[out] field The register in {@see shadow}
+ * @param[in] value The value written
+ */
+static void ShadowRegister(uint8_t *const field, const uint8_t value)
+{
+	*field = value;
+	if (I2C_STATUS_OK != I2C_Status(I2C_SelectedBus())) selected->shadowValid = 0;
+}
+
+/**
+ * @brief Gets the arbiter handle of a device, looking it up by address once
+ * @param[inout] device The device
+ * @return The handle
+ */
+static inline i2carbiter_handle_t DeviceHandle(mpu6050_device_t *const device)
+{
+	if (I2CARBITER_NO_HANDLE == device->handle)
+	{
+		device->handle = I2CArbiter_Handle(device->slaveAddress);
+	}
+	return device->handle;
+}
+
+/**
+ * @brief Selects the device the blocking functions talk to and its I2C slave
+ * @param[in] device The device; NULL selects {@see mpu6050_primary}
+ * @return Zero if successful, nonzero if the device has no arbiter entry
+ */
+uint8_t MPU6050_SelectDevice(mpu6050_device_t *const device)
+{
+	selected = (NULL != device) ? device : &mpu6050_primary;
+	return I2CArbiter_SelectHandle(DeviceHandle(selected));
+}
+
 /**
  * @brief Reads the WHO_AM_I register from the MPU6050.
  * @return Device identification code; Should be 0b0110100 (0x68)
  */
 uint8_t MPU6050_WhoAmI()
 {
-	return I2C_ReadRegister(MPU6050_I2CADDR, MPU6050_REG_WHO_AM_I);
+	return I2C_ReadRegister(selected->slaveAddress, MPU6050_REG_WHO_AM_I);
 }
 
 /**
@@ -52,147 +112,107 @@ uint8_t MPU6050_WhoAmI()
  */
 void MPU6050_FetchConfiguration(mpu6050_confreg_t *const configuration)
 {
+	I2C_MemMapPtr const i2c = I2C_SelectedBus();
+	
 	assert(configuration != 0x0);
 		
 	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
+	I2C_WaitWhileBusy(i2c);
 	
 	/* start register addressing */
-	I2C_SendStart();
-	I2C_InitiateRegisterReadAt(MPU6050_I2CADDR, MPU6050_REG_SMPLRT_DIV);
+	I2C_SendStart(i2c);
+	I2C_InitiateRegisterReadAt(i2c, selected->slaveAddress, MPU6050_REG_SMPLRT_DIV);
 	
 	/* read the registers */
-	configuration->SMPLRT_DIV = I2C_ReceiveDriving();
-	configuration->CONFIG = I2C_ReceiveDriving();
-	configuration->GYRO_CONFIG = I2C_ReceiveDrivingWithNack();
-	configuration->ACCEL_CONFIG = I2C_ReceiveAndRestart();
+	configuration->SMPLRT_DIV = I2C_ReceiveDriving(i2c);
+	configuration->CONFIG = I2C_ReceiveDriving(i2c);
+	configuration->GYRO_CONFIG = I2C_ReceiveDrivingWithNack(i2c);
+	configuration->ACCEL_CONFIG = I2C_ReceiveAndRestart(i2c);
 	
 	/* restart read at 0x23 */
-	I2C_InitiateRegisterReadAt(MPU6050_I2CADDR, MPU6050_REG_FIFO_EN);
-	configuration->FIFO_EN = I2C_ReceiveDriving();
-	configuration->I2C_MST_CTRL = I2C_ReceiveDriving();
-	configuration->I2C_SLV0_ADDR = I2C_ReceiveDriving();
-	configuration->I2C_SLV0_CTRL = I2C_ReceiveDriving();
-	configuration->I2C_SLV0_REG = I2C_ReceiveDriving();
-	
-	configuration->I2C_SLV1_ADDR = I2C_ReceiveDriving();
-	configuration->I2C_SLV1_REG = I2C_ReceiveDriving();
-	configuration->I2C_SLV1_CTRL = I2C_ReceiveDriving();
-	configuration->I2C_SLV2_ADDR = I2C_ReceiveDriving();
-	configuration->I2C_SLV2_REG = I2C_ReceiveDriving(); /* 2C */
-	configuration->I2C_SLV2_CTRL = I2C_ReceiveDriving();
-	configuration->I2C_SLV3_ADDR = I2C_ReceiveDriving();
-	configuration->I2C_SLV3_REG = I2C_ReceiveDriving();
-	configuration->I2C_SLV3_CTRL = I2C_ReceiveDriving();
-	configuration->I2C_SLV4_ADDR = I2C_ReceiveDriving();
-	configuration->I2C_SLV4_REG = I2C_ReceiveDriving();
-	configuration->I2C_SLV4_DO = I2C_ReceiveDriving();
-	configuration->I2C_SLV4_CTRL = I2C_ReceiveDriving();
-	*(uint8_t*)&configuration->I2C_SLV4_DI = I2C_ReceiveDriving();
-	*(uint8_t*)&configuration->I2C_MST_STATUS = I2C_ReceiveDriving();
-	configuration->INT_PIN_CFG = I2C_ReceiveDrivingWithNack();
-	configuration->INT_ENABLE = I2C_ReceiveAndRestart(); /* 0x38 */
+	I2C_InitiateRegisterReadAt(i2c, selected->slaveAddress, MPU6050_REG_FIFO_EN);
+	configuration->FIFO_EN = I2C_ReceiveDriving(i2c);
+	configuration->I2C_MST_CTRL = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV0_ADDR = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV0_CTRL = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV0_REG = I2C_ReceiveDriving(i2c);
+	
+	configuration->I2C_SLV1_ADDR = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV1_REG = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV1_CTRL = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV2_ADDR = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV2_REG = I2C_ReceiveDriving(i2c); /* 2C */
+	configuration->I2C_SLV2_CTRL = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV3_ADDR = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV3_REG = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV3_CTRL = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV4_ADDR = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV4_REG = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV4_DO = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV4_CTRL = I2C_ReceiveDriving(i2c);
+	*(uint8_t*)&configuration->I2C_SLV4_DI = I2C_ReceiveDriving(i2c);
+	*(uint8_t*)&configuration->I2C_MST_STATUS = I2C_ReceiveDriving(i2c);
+	configuration->INT_PIN_CFG = I2C_ReceiveDrivingWithNack(i2c);
+	configuration->INT_ENABLE = I2C_ReceiveAndRestart(i2c); /* 0x38 */
 	
 	/* restart read at 0x63 */
-	I2C_InitiateRegisterReadAt(MPU6050_I2CADDR, MPU6050_REG_I2C_SLV0_DO);
-	configuration->I2C_SLV0_DO = I2C_ReceiveDriving();
-	configuration->I2C_SLV1_DO = I2C_ReceiveDriving();
-	configuration->I2C_SLV2_DO = I2C_ReceiveDriving();
-	configuration->I2C_SLV3_DO = I2C_ReceiveDriving();
-	configuration->I2C_MST_DELAY_CTRL = I2C_ReceiveDriving();
-	configuration->SIGNAL_PATH_RESET = I2C_ReceiveDriving();
-	configuration->MOT_DETECT_CTRL = I2C_ReceiveDriving();
-	configuration->USER_CTRL = I2C_ReceiveDriving();
-	configuration->PWR_MGMT_1 = I2C_ReceiveDrivingWithNack();
-	configuration->PWR_MGMT_2 = I2C_ReceiveAndRestart();
+	I2C_InitiateRegisterReadAt(i2c, selected->slaveAddress, MPU6050_REG_I2C_SLV0_DO);
+	configuration->I2C_SLV0_DO = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV1_DO = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV2_DO = I2C_ReceiveDriving(i2c);
+	configuration->I2C_SLV3_DO = I2C_ReceiveDriving(i2c);
+	configuration->I2C_MST_DELAY_CTRL = I2C_ReceiveDriving(i2c);
+	configuration->SIGNAL_PATH_RESET = I2C_ReceiveDriving(i2c);
+	configuration->MOT_DETECT_CTRL = I2C_ReceiveDriving(i2c);
+	configuration->USER_CTRL = I2C_ReceiveDriving(i2c);
+	configuration->PWR_MGMT_1 = I2C_ReceiveDrivingWithNack(i2c);
+	configuration->PWR_MGMT_2 = I2C_ReceiveAndRestart(i2c);
 	
 	/* restart read at 0x6D */
-	I2C_InitiateRegisterReadAt(MPU6050_I2CADDR, MPU6050_REG_FIFO_COUNTH);
-	configuration->FIFO_COUNTH = I2C_ReceiveDriving();
-	configuration->FIFO_COUNTL = I2C_ReceiveDriving();
-	configuration->FIFO_R_W = I2C_ReceiveDrivingWithNack();
-	*(uint8_t*)&configuration->WHO_AM_I = I2C_ReceiveAndStop();
+	I2C_InitiateRegisterReadAt(i2c, selected->slaveAddress, MPU6050_REG_FIFO_COUNTH);
+	configuration->FIFO_COUNTH = I2C_ReceiveDriving(i2c);
+	configuration->FIFO_COUNTL = I2C_ReceiveDriving(i2c);
+	configuration->FIFO_R_W = I2C_ReceiveDrivingWithNack(i2c);
+	*(uint8_t*)&configuration->WHO_AM_I = I2C_ReceiveAndStop(i2c);
+	
+	/* the device holds this configuration now */
+	memcpy(&selected->shadow, configuration, sizeof(selected->shadow));
+	selected->shadowValid = (I2C_STATUS_OK == I2C_Status(i2c));
 }
 
 /**
  * @brief Stores the configuration from a {@see mpu6050_confreg_t} data structure
  * @param[in] The configuration data data; Must not be null.
+ * 
+ * Only registers that differ from the last fetched or stored configuration are written.
  */
 void MPU6050_StoreConfiguration(const mpu6050_confreg_t *const configuration)
 {
 	assert(configuration != 0x0);
-		
-	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
-	
-	/* start register addressing at 0x19 */
-	I2C_SendStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
-	I2C_SendBlocking(MPU6050_REG_SMPLRT_DIV);
-	I2C_SendBlocking(configuration->SMPLRT_DIV);
-	I2C_SendBlocking(configuration->CONFIG);
-	I2C_SendBlocking(configuration->GYRO_CONFIG);
-	I2C_SendBlocking(configuration->ACCEL_CONFIG);
-
-    /* restart register addressing at 0x6B */
-    I2C_SendRepeatedStart();
-    I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
-    I2C_SendBlocking(MPU6050_REG_PWR_MGMT_1);
-    I2C_SendBlocking(configuration->PWR_MGMT_1);
-
-	/* restart register addressing at 0x23 */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
-	I2C_SendBlocking(MPU6050_REG_FIFO_EN);
-	I2C_SendBlocking(configuration->FIFO_EN);
-	I2C_SendBlocking(configuration->I2C_MST_CTRL);
-	I2C_SendBlocking(configuration->I2C_SLV0_ADDR);
-	I2C_SendBlocking(configuration->I2C_SLV0_REG);
-	I2C_SendBlocking(configuration->I2C_SLV0_CTRL);
-	I2C_SendBlocking(configuration->I2C_SLV1_ADDR);
-	I2C_SendBlocking(configuration->I2C_SLV1_REG);
-	I2C_SendBlocking(configuration->I2C_SLV1_CTRL);
-	I2C_SendBlocking(configuration->I2C_SLV2_ADDR);
-	I2C_SendBlocking(configuration->I2C_SLV2_REG);
-	I2C_SendBlocking(configuration->I2C_SLV2_CTRL);
-	I2C_SendBlocking(configuration->I2C_SLV3_ADDR);
-	I2C_SendBlocking(configuration->I2C_SLV3_REG);
-	I2C_SendBlocking(configuration->I2C_SLV3_CTRL);
-	I2C_SendBlocking(configuration->I2C_SLV4_ADDR);
-	I2C_SendBlocking(configuration->I2C_SLV4_REG);
-	I2C_SendBlocking(configuration->I2C_SLV4_DO);
-	I2C_SendBlocking(configuration->I2C_SLV4_CTRL);
-	
-	/* restart register addressing at 0x37 */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
-	I2C_SendBlocking(MPU6050_REG_INT_PIN_CFG);
-	I2C_SendBlocking(configuration->INT_PIN_CFG);
-	I2C_SendBlocking(configuration->INT_ENABLE);
-	
-	/* restart register addressing at 0x63 */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
-	I2C_SendBlocking(MPU6050_REG_I2C_SLV0_DO);
-	I2C_SendBlocking(configuration->I2C_SLV0_DO);
-	I2C_SendBlocking(configuration->I2C_SLV1_DO);
-	I2C_SendBlocking(configuration->I2C_SLV2_DO);
-	I2C_SendBlocking(configuration->I2C_SLV3_DO);
-	I2C_SendBlocking(configuration->I2C_MST_DELAY_CTRL);
-	I2C_SendBlocking(configuration->SIGNAL_PATH_RESET);
-	I2C_SendBlocking(configuration->MOT_DETECT_CTRL);
-	I2C_SendBlocking(configuration->USER_CTRL);
-	I2C_SendBlocking(configuration->PWR_MGMT_1);
-	I2C_SendBlocking(configuration->PWR_MGMT_2);
-	
-	/* restart register addressing at 0x71 */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
-	I2C_SendBlocking(MPU6050_REG_FIFO_COUNTH);
-	I2C_SendBlocking(configuration->FIFO_COUNTH);
-	I2C_SendBlocking(configuration->FIFO_COUNTL);
-	I2C_SendBlocking(configuration->FIFO_R_W);
-	I2C_SendStop();
+	
+	const i2c_status_t status = I2C_WriteRegisterBlocks(selected->slaveAddress, storeBlocks, sizeof(storeBlocks)/sizeof(storeBlocks[0]),
+			(const uint8_t*)configuration, selected->shadowValid ? (const uint8_t*)&selected->shadow : NULL);
+	
+	/* after a failure, the device state is unknown */
+	memcpy(&selected->shadow, configuration, sizeof(selected->shadow));
+	selected->shadowValid = (I2C_STATUS_OK == status);
+}
+
+/**
+ * @brief Gets the configuration last fetched from or stored to the device
+ * @param[out] configuration The configuration; Must not be null.
+ */
+void MPU6050_RecallConfiguration(mpu6050_confreg_t *const configuration)
+{
+	assert_not_null(configuration);
+	
+	if (!selected->shadowValid)
+	{
+		MPU6050_FetchConfiguration(configuration);
+		return;
+	}
+	
+	memcpy(configuration, &selected->shadow, sizeof(selected->shadow));
 }
 
 #define MPU6050_SMPLRT_DIV_SMPLRT_DIV_MASK 		(0b11111111)
@@ -266,18 +286,21 @@ void MPU6050_ConfigureInterrupts(mpu6050_confreg_t *const configuration, mpu6050
 {
     if (configuration == MPU6050_CONFIGURE_DIRECT)
     {
+        I2C_MemMapPtr const i2c = I2C_SelectedBus();
+
         uint8_t value = 0;
         MPU6050_VALUE_SET(value, INT_PIN_CFG, INT_LEVEL, level);
         MPU6050_VALUE_SET(value, INT_PIN_CFG, INT_OPEN, type);
         MPU6050_VALUE_SET(value, INT_PIN_CFG, LATCH_INT_EN, latch);
         MPU6050_VALUE_SET(value, INT_PIN_CFG, INT_RD_CLEAR, clear);
 
-        I2C_WaitWhileBusy();
-        I2C_SendStart();
-        I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
-        I2C_SendBlocking(MPU6050_REG_INT_PIN_CFG);
-        I2C_SendBlocking(value);
-        I2C_SendStop();
+        I2C_WaitWhileBusy(i2c);
+        I2C_SendStart(i2c);
+        I2C_SendBlocking(i2c, I2C_WRITE_ADDRESS(selected->slaveAddress));
+        I2C_SendBlocking(i2c, MPU6050_REG_INT_PIN_CFG);
+        I2C_SendBlocking(i2c, value);
+        I2C_SendStop(i2c);
+        ShadowRegister(&selected->shadow.INT_PIN_CFG, value);
     }
     else
     {
@@ -306,17 +329,20 @@ void MPU6050_EnableInterrupts(mpu6050_confreg_t *const configuration, mpu6050_in
 {
     if (configuration == MPU6050_CONFIGURE_DIRECT)
     {
+        I2C_MemMapPtr const i2c = I2C_SelectedBus();
+
         uint8_t value = 0;
         MPU6050_VALUE_SET(value, INT_ENABLE, FIFO_OFLOW_EN, fifoOverflow);
         MPU6050_VALUE_SET(value, INT_ENABLE, I2CMST_INT_EN, i2cMaster);
         MPU6050_VALUE_SET(value, INT_ENABLE, DATA_RDY_EN, dataReady);
 
-        I2C_WaitWhileBusy();
-        I2C_SendStart();
-        I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
-        I2C_SendBlocking(MPU6050_REG_INT_ENABLE);
-        I2C_SendBlocking(value);
-        I2C_SendStop();
+        I2C_WaitWhileBusy(i2c);
+        I2C_SendStart(i2c);
+        I2C_SendBlocking(i2c, I2C_WRITE_ADDRESS(selected->slaveAddress));
+        I2C_SendBlocking(i2c, MPU6050_REG_INT_ENABLE);
+        I2C_SendBlocking(i2c, value);
+        I2C_SendStop(i2c);
+        ShadowRegister(&selected->shadow.INT_ENABLE, value);
     }
     else
     {
@@ -338,15 +364,18 @@ void MPU6050_SelectClockSource(mpu6050_confreg_t *const configuration, mpu6050_c
 {
     if (configuration == MPU6050_CONFIGURE_DIRECT)
     {
+        I2C_MemMapPtr const i2c = I2C_SelectedBus();
+
         uint8_t value = 0;
         MPU6050_VALUE_SET(value, PWR_MGMT_1, CLKSEL, source);
 
-        I2C_WaitWhileBusy();
-        I2C_SendStart();
-        I2C_SendBlocking(I2C_WRITE_ADDRESS(MPU6050_I2CADDR));
-        I2C_SendBlocking(MPU6050_REG_PWR_MGMT_1);
-        I2C_SendBlocking(value);
-        I2C_SendStop();
+        I2C_WaitWhileBusy(i2c);
+        I2C_SendStart(i2c);
+        I2C_SendBlocking(i2c, I2C_WRITE_ADDRESS(selected->slaveAddress));
+        I2C_SendBlocking(i2c, MPU6050_REG_PWR_MGMT_1);
+        I2C_SendBlocking(i2c, value);
+        I2C_SendStop(i2c);
+        ShadowRegister(&selected->shadow.PWR_MGMT_1, value);
     }
     else 
     {
@@ -371,56 +400,391 @@ void MPU6050_SetSleepMode(mpu6050_confreg_t *const configuration, mpu6050_sleep_
 #define MPU6050_INT_STATUS_DATA_RDY_INT_MASK 	(0b00000001)
 #define MPU6050_INT_STATUS_DATA_RDY_INT_SHIFT 	(0)
 
+/**
+ * @brief Assigns the sensor data from the raw register contents
+ * @param[in] buffer The register contents
+ * @param[out] data The data
+ */
+static inline void AssignData(const mpu6050_intdatareg_t *const buffer, mpu6050_sensor_t *const data)
+{
+	data->status = buffer->INT_STATUS;
+	data->accel.x = (int16_t)((((uint16_t)buffer->ACCEL_XOUT_H << 8) & 0xFF00) | (((uint16_t)buffer->ACCEL_XOUT_L) & 0x00FF));
+	data->accel.y = (int16_t)((((uint16_t)buffer->ACCEL_YOUT_H << 8) & 0xFF00) | (((uint16_t)buffer->ACCEL_YOUT_L) & 0x00FF));
+	data->accel.z = (int16_t)((((uint16_t)buffer->ACCEL_ZOUT_H << 8) & 0xFF00) | (((uint16_t)buffer->ACCEL_ZOUT_L) & 0x00FF));
+	data->gyro.x  = (int16_t)((((uint16_t)buffer->GYRO_XOUT_H << 8) & 0xFF00)  | (((uint16_t)buffer->GYRO_XOUT_L) & 0x00FF));
+	data->gyro.y  = (int16_t)((((uint16_t)buffer->GYRO_YOUT_H << 8) & 0xFF00)  | (((uint16_t)buffer->GYRO_YOUT_L) & 0x00FF));
+	data->gyro.z  = (int16_t)((((uint16_t)buffer->GYRO_ZOUT_H << 8) & 0xFF00)  | (((uint16_t)buffer->GYRO_ZOUT_L) & 0x00FF));
+	
+	/* Temperature in degrees C = (TEMP_OUT Register Value as a signed quantity)/340 + 36.53 */
+	data->temperature  = (((int16_t)buffer->TEMP_OUT_H << 8) & 0xFF00)  | (((int16_t)buffer->TEMP_OUT_L) & 0x00FF);
+}
+
 /**
  * @brief Reads accelerometer, gyro and temperature data from the MPU6050
  * @param[inout] data The data 
  */
 void MPU6050_ReadData(mpu6050_sensor_t *data)
 {
+	I2C_MemMapPtr const i2c = I2C_SelectedBus();
+	
 	assert_not_null(data);
 	mpu6050_intdatareg_t buffer;
 	
 	/* fetch the data */
-	I2C_SendStart();
-	I2C_InitiateRegisterReadAt(MPU6050_I2CADDR, MPU6050_REG_INT_STATUS);
-	buffer.INT_STATUS = I2C_ReceiveDriving();
+	I2C_SendStart(i2c);
+	I2C_InitiateRegisterReadAt(i2c, selected->slaveAddress, MPU6050_REG_INT_STATUS);
+	buffer.INT_STATUS = I2C_ReceiveDriving(i2c);
 	
 	/* early exit */
 	int dataReady = (buffer.INT_STATUS & MPU6050_INT_STATUS_DATA_RDY_INT_MASK) >> MPU6050_INT_STATUS_DATA_RDY_INT_SHIFT; 
 	if (!dataReady)
 	{
-		I2C_DisableAck();
-		I2C_ReceiverModeDriveClock();
-		I2C_SendStop();
+		I2C_DisableAck(i2c);
+		I2C_ReceiverModeDriveClock(i2c);
+		I2C_SendStop(i2c);
 		data->status = 0;
 		return;
 	}
 	
 	/* read the registers */
-	buffer.ACCEL_XOUT_H = I2C_ReceiveDriving();
-	buffer.ACCEL_XOUT_L = I2C_ReceiveDriving();
-	buffer.ACCEL_YOUT_H = I2C_ReceiveDriving();
-	buffer.ACCEL_YOUT_L = I2C_ReceiveDriving();
-	buffer.ACCEL_ZOUT_H = I2C_ReceiveDriving();
-	buffer.ACCEL_ZOUT_L = I2C_ReceiveDriving();
-	buffer.TEMP_OUT_H = I2C_ReceiveDriving();
-	buffer.TEMP_OUT_L = I2C_ReceiveDriving();
-	buffer.GYRO_XOUT_H = I2C_ReceiveDriving();
-	buffer.GYRO_XOUT_L = I2C_ReceiveDriving();
-	buffer.GYRO_YOUT_H = I2C_ReceiveDriving();
-	buffer.GYRO_YOUT_L = I2C_ReceiveDriving();
-	buffer.GYRO_ZOUT_H = I2C_ReceiveDrivingWithNack();
-	buffer.GYRO_ZOUT_L = I2C_ReceiveAndStop();
+	buffer.ACCEL_XOUT_H = I2C_ReceiveDriving(i2c);
+	buffer.ACCEL_XOUT_L = I2C_ReceiveDriving(i2c);
+	buffer.ACCEL_YOUT_H = I2C_ReceiveDriving(i2c);
+	buffer.ACCEL_YOUT_L = I2C_ReceiveDriving(i2c);
+	buffer.ACCEL_ZOUT_H = I2C_ReceiveDriving(i2c);
+	buffer.ACCEL_ZOUT_L = I2C_ReceiveDriving(i2c);
+	buffer.TEMP_OUT_H = I2C_ReceiveDriving(i2c);
+	buffer.TEMP_OUT_L = I2C_ReceiveDriving(i2c);
+	buffer.GYRO_XOUT_H = I2C_ReceiveDriving(i2c);
+	buffer.GYRO_XOUT_L = I2C_ReceiveDriving(i2c);
+	buffer.GYRO_YOUT_H = I2C_ReceiveDriving(i2c);
+	buffer.GYRO_YOUT_L = I2C_ReceiveDriving(i2c);
+	buffer.GYRO_ZOUT_H = I2C_ReceiveDrivingWithNack(i2c);
+	buffer.GYRO_ZOUT_L = I2C_ReceiveAndStop(i2c);
 	
 	/* assign the data */
-	data->status = buffer.INT_STATUS;
-	data->accel.x = (int16_t)((((uint16_t)buffer.ACCEL_XOUT_H << 8) & 0xFF00) | (((uint16_t)buffer.ACCEL_XOUT_L) & 0x00FF));
-	data->accel.y = (int16_t)((((uint16_t)buffer.ACCEL_YOUT_H << 8) & 0xFF00) | (((uint16_t)buffer.ACCEL_YOUT_L) & 0x00FF));
-	data->accel.z = (int16_t)((((uint16_t)buffer.ACCEL_ZOUT_H << 8) & 0xFF00) | (((uint16_t)buffer.ACCEL_ZOUT_L) & 0x00FF));
-	data->gyro.x  = (int16_t)((((uint16_t)buffer.GYRO_XOUT_H << 8) & 0xFF00)  | (((uint16_t)buffer.GYRO_XOUT_L) & 0x00FF));
-	data->gyro.y  = (int16_t)((((uint16_t)buffer.GYRO_YOUT_H << 8) & 0xFF00)  | (((uint16_t)buffer.GYRO_YOUT_L) & 0x00FF));
-	data->gyro.z  = (int16_t)((((uint16_t)buffer.GYRO_ZOUT_H << 8) & 0xFF00)  | (((uint16_t)buffer.GYRO_ZOUT_L) & 0x00FF));
+	AssignData(&buffer, data);
+}
+
+/**
+ * @brief Prepares an asynchronous read of accelerometer, gyro and temperature data
+ * @param[in] device The device to read from or write to
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] block The buffer of {@see MPU6050_DATA_BLOCK_LENGTH} bytes to read into
+ */
+void MPU6050_PrepareReadData(mpu6050_device_t *const device, i2casync_transaction_t *const transaction, mpu6050_intdatareg_t *const block)
+{
+	assert_not_null(device);
+	assert_not_null(transaction);
+	assert_not_null(block);
 	
-	/* Temperature in degrees C = (TEMP_OUT Register Value as a signed quantity)/340 + 36.53 */
-	data->temperature  = (((int16_t)buffer.TEMP_OUT_H << 8) & 0xFF00)  | (((int16_t)buffer.TEMP_OUT_L) & 0x00FF);
+	transaction->slaveAddress = device->slaveAddress;
+	transaction->handle = DeviceHandle(device);
+	transaction->registerAddress = MPU6050_REG_INT_STATUS;
+	transaction->direction = I2CASYNC_READ;
+	transaction->count = MPU6050_DATA_BLOCK_LENGTH;
+	transaction->data = (uint8_t*)block;
+}
+
+/**
+ * @brief Decodes the data read by an asynchronous transaction
+ * @param[in] block The register block read
+ * @param[out] data The data; status is zero if no fresh data was available
+ */
+void MPU6050_DecodeData(const mpu6050_intdatareg_t *const block, mpu6050_sensor_t *const data)
+{
+	assert_not_null(block);
+	assert_not_null(data);
+	
+	/* stale data */
+	if (0 == (block->INT_STATUS & MPU6050_INT_STATUS_DATA_RDY_INT_MASK))
+	{
+		data->status = 0;
+		return;
+	}
+	
+	AssignData(block, data);
+}
+
+#define MPU6050_INT_PIN_CFG_I2C_BYPASS_EN_MASK	(0b00000010)
+#define MPU6050_INT_PIN_CFG_I2C_BYPASS_EN_SHIFT	(1)
+#define MPU6050_USER_CTRL_I2C_MST_EN_MASK		(0b00100000)
+#define MPU6050_USER_CTRL_I2C_MST_EN_SHIFT		(5)
+#define MPU6050_I2C_MST_CTRL_WAIT_FOR_ES_MASK	(0b01000000)
+#define MPU6050_I2C_MST_CTRL_I2C_MST_CLK_MASK	(0b00001111)
+#define MPU6050_I2C_MST_CTRL_I2C_MST_CLK_400KHZ	(13)
+#define MPU6050_I2C_SLV0_ADDR_I2C_SLV0_RW_MASK	(0b10000000)
+#define MPU6050_I2C_SLV0_CTRL_I2C_SLV0_EN_MASK	(0b10000000)
+#define MPU6050_I2C_SLV0_CTRL_I2C_SLV0_LEN_MASK	(0b00001111)
+
+/**
+ * @brief Connects or disconnects the auxiliary I2C bus to or from the primary bus
+ * @param[inout] configuration The configuration structure or {@see MPU6050_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] bypass The bypass configuration
+ */
+void MPU6050_SetBypass(mpu6050_confreg_t *const configuration, mpu6050_bypass_t bypass)
+{
+	if (configuration == MPU6050_CONFIGURE_DIRECT)
+	{
+		ShadowRegister(&selected->shadow.INT_PIN_CFG, I2C_ModifyRegister(selected->slaveAddress, MPU6050_REG_INT_PIN_CFG, 
+				(uint8_t)~MPU6050_INT_PIN_CFG_I2C_BYPASS_EN_MASK, 
+				(bypass << MPU6050_INT_PIN_CFG_I2C_BYPASS_EN_SHIFT) & MPU6050_INT_PIN_CFG_I2C_BYPASS_EN_MASK));
+	}
+	else
+	{
+		MPU6050_CONFIG_SET(INT_PIN_CFG, I2C_BYPASS_EN, bypass);
+	}
+}
+
+/**
+ * @brief Enables or disables the auxiliary I2C master
+ * @param[inout] configuration The configuration structure or {@see MPU6050_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] master The master configuration
+ */
+void MPU6050_SetI2CMaster(mpu6050_confreg_t *const configuration, mpu6050_i2cmaster_t master)
+{
+	if (configuration == MPU6050_CONFIGURE_DIRECT)
+	{
+		ShadowRegister(&selected->shadow.USER_CTRL, I2C_ModifyRegister(selected->slaveAddress, MPU6050_REG_USER_CTRL, 
+				(uint8_t)~MPU6050_USER_CTRL_I2C_MST_EN_MASK, 
+				(master << MPU6050_USER_CTRL_I2C_MST_EN_SHIFT) & MPU6050_USER_CTRL_I2C_MST_EN_MASK));
+	}
+	else
+	{
+		MPU6050_CONFIG_SET(USER_CTRL, I2C_MST_EN, master);
+	}
+}
+
+/**
+ * @brief Configures the I2C master to read an auxiliary slave into EXT_SENS_DATA_00 every sample
+ * @param[inout] configuration The configuration structure
+ * @param[in] slaveAddress The 7-bit address of the auxiliary slave
+ * @param[in] registerAddress The first register to read
+ * @param[in] count The number of registers to read, 1 .. {@see MPU6050_AUX_MAX_LENGTH}
+ */
+void MPU6050_ConfigureAuxiliaryRead(mpu6050_confreg_t *const configuration, uint8_t slaveAddress, uint8_t registerAddress, uint8_t count)
+{
+	assert_not_null(configuration);
+	assert(count > 0 && count <= MPU6050_AUX_MAX_LENGTH);
+	
+	/* slave 0 reads the register block; the data lands in EXT_SENS_DATA_00 onwards */
+	configuration->I2C_SLV0_ADDR = MPU6050_I2C_SLV0_ADDR_I2C_SLV0_RW_MASK | (slaveAddress & 0x7F);
+	configuration->I2C_SLV0_REG = registerAddress;
+	configuration->I2C_SLV0_CTRL = MPU6050_I2C_SLV0_CTRL_I2C_SLV0_EN_MASK | (count & MPU6050_I2C_SLV0_CTRL_I2C_SLV0_LEN_MASK);
+	
+	/* delay data ready until the external data is in, clock the auxiliary bus at 400 kHz */
+	configuration->I2C_MST_CTRL = MPU6050_I2C_MST_CTRL_WAIT_FOR_ES_MASK | MPU6050_I2C_MST_CTRL_I2C_MST_CLK_400KHZ;
+	
+	/* the MPU6050 becomes the master of the auxiliary bus */
+	MPU6050_CONFIG_SET(INT_PIN_CFG, I2C_BYPASS_EN, MPU6050_BYPASS_DISABLED);
+	MPU6050_CONFIG_SET(USER_CTRL, I2C_MST_EN, MPU6050_I2CMASTER_ENABLED);
+}
+
+#define MPU6050_FIFO_EN_XG_FIFO_EN_MASK			(0b01000000)
+#define MPU6050_FIFO_EN_YG_FIFO_EN_MASK			(0b00100000)
+#define MPU6050_FIFO_EN_ZG_FIFO_EN_MASK			(0b00010000)
+#define MPU6050_FIFO_EN_ACCEL_FIFO_EN_MASK		(0b00001000)
+#define MPU6050_USER_CTRL_FIFO_EN_MASK			(0b01000000)
+#define MPU6050_USER_CTRL_FIFO_EN_SHIFT			(6)
+#define MPU6050_USER_CTRL_FIFO_RESET_MASK		(0b00000100)
+
+/**
+ * @brief The FIFO_EN value for accelerometer and gyroscope frames
+ */
+#define MPU6050_FIFO_EN_ACCEL_GYRO	(MPU6050_FIFO_EN_XG_FIFO_EN_MASK | MPU6050_FIFO_EN_YG_FIFO_EN_MASK | MPU6050_FIFO_EN_ZG_FIFO_EN_MASK | MPU6050_FIFO_EN_ACCEL_FIFO_EN_MASK)
+
+/**
+ * @brief Configures the FIFO
+ * @param[inout] configuration The configuration structure or {@see MPU6050_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] fifo The FIFO configuration
+ */
+void MPU6050_ConfigureFifo(mpu6050_confreg_t *const configuration, mpu6050_fifo_t fifo)
+{
+	const uint8_t sources = (MPU6050_FIFO_ENABLED == fifo) ? MPU6050_FIFO_EN_ACCEL_GYRO : 0;
+	
+	if (configuration == MPU6050_CONFIGURE_DIRECT)
+	{
+		I2C_WriteRegister(selected->slaveAddress, MPU6050_REG_FIFO_EN, sources);
+		ShadowRegister(&selected->shadow.FIFO_EN, sources);
+		ShadowRegister(&selected->shadow.USER_CTRL, I2C_ModifyRegister(selected->slaveAddress, MPU6050_REG_USER_CTRL, 
+				(uint8_t)~MPU6050_USER_CTRL_FIFO_EN_MASK, 
+				(fifo << MPU6050_USER_CTRL_FIFO_EN_SHIFT) & MPU6050_USER_CTRL_FIFO_EN_MASK));
+	}
+	else
+	{
+		configuration->FIFO_EN = sources;
+		MPU6050_CONFIG_SET(USER_CTRL, FIFO_EN, fifo);
+	}
+}
+
+/**
+ * @brief Discards the FIFO contents
+ */
+void MPU6050_ResetFifo()
+{
+	/* the reset bit clears itself */
+	const uint8_t value = I2C_ModifyRegister(selected->slaveAddress, MPU6050_REG_USER_CTRL, I2C_MOD_NO_AND_MASK, MPU6050_USER_CTRL_FIFO_RESET_MASK);
+	ShadowRegister(&selected->shadow.USER_CTRL, value & (uint8_t)~MPU6050_USER_CTRL_FIFO_RESET_MASK);
+}
+
+/**
+ * @brief Reads the number of bytes in the FIFO
+ * @return The FIFO count in bytes
+ */
+uint16_t MPU6050_ReadFifoCount()
+{
+	uint8_t count[2];
+	I2C_ReadRegisters(selected->slaveAddress, MPU6050_REG_FIFO_COUNTH, 2, count);
+	return ((uint16_t)count[0] << 8) | count[1];
+}
+
+/**
+ * @brief Assigns the sensor data from a FIFO frame
+ * @param[in] frame The frame of {@see MPU6050_FIFO_FRAME_LENGTH} bytes
+ * @param[out] data The data
+ */
+static inline void AssignFifoFrame(const uint8_t *const frame, mpu6050_sensor_t *const data)
+{
+	data->status = MPU6050_INT_STATUS_DATA_RDY_INT_MASK;
+	data->accel.x = (int16_t)((((uint16_t)frame[0] << 8) & 0xFF00)  | (((uint16_t)frame[1]) & 0x00FF));
+	data->accel.y = (int16_t)((((uint16_t)frame[2] << 8) & 0xFF00)  | (((uint16_t)frame[3]) & 0x00FF));
+	data->accel.z = (int16_t)((((uint16_t)frame[4] << 8) & 0xFF00)  | (((uint16_t)frame[5]) & 0x00FF));
+	data->gyro.x  = (int16_t)((((uint16_t)frame[6] << 8) & 0xFF00)  | (((uint16_t)frame[7]) & 0x00FF));
+	data->gyro.y  = (int16_t)((((uint16_t)frame[8] << 8) & 0xFF00)  | (((uint16_t)frame[9]) & 0x00FF));
+	data->gyro.z  = (int16_t)((((uint16_t)frame[10] << 8) & 0xFF00) | (((uint16_t)frame[11]) & 0x00FF));
+	data->temperature = 0;
+}
+
+/**
+ * @brief Reads accelerometer and gyroscope frames from the FIFO
+ * @param[out] samples The samples; temperature is not part of the FIFO frames and is set to zero
+ * @param[in] capacity The maximum number of samples to read
+ * @param[out] overflow Set to nonzero if the FIFO overflowed and was reset; may be NULL
+ * @return The number of samples read
+ */
+uint16_t MPU6050_ReadFifo(mpu6050_sensor_t *const samples, uint16_t capacity, uint8_t *const overflow)
+{
+	assert_not_null(samples);
+	
+	/* a partial frame means the oldest data was overwritten and the frame alignment is lost */
+	const uint16_t count = MPU6050_ReadFifoCount();
+	const uint8_t overflowed = (0 != (count % MPU6050_FIFO_FRAME_LENGTH));
+	if (NULL != overflow)
+	{
+		*overflow = overflowed;
+	}
+	if (overflowed)
+	{
+		MPU6050_ResetFifo();
+		return 0;
+	}
+	
+	uint16_t frames = count / MPU6050_FIFO_FRAME_LENGTH;
+	if (frames > capacity) frames = capacity;
+	
+	/* FIFO_R_W does not auto-increment, so every burst pops consecutive bytes */
+	uint8_t buffer[MPU6050_FIFO_BURST_FRAMES * MPU6050_FIFO_FRAME_LENGTH];
+	uint16_t index = 0;
+	while (index < frames)
+	{
+		uint16_t burst = frames - index;
+		if (burst > MPU6050_FIFO_BURST_FRAMES) burst = MPU6050_FIFO_BURST_FRAMES;
+		
+		I2C_ReadRegisters(selected->slaveAddress, MPU6050_REG_FIFO_R_W, (uint8_t)(burst * MPU6050_FIFO_FRAME_LENGTH), buffer);
+		for (uint16_t i = 0; i < burst; ++i)
+		{
+			AssignFifoFrame(&buffer[i * MPU6050_FIFO_FRAME_LENGTH], &samples[index++]);
+		}
+	}
+	
+	return frames;
+}
+
+/**
+ * @brief Prepares an asynchronous read of the FIFO count
+ * @param[in] device The device to read from or write to
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] block The FIFO buffers
+ */
+void MPU6050_PrepareReadFifoCount(mpu6050_device_t *const device, i2casync_transaction_t *const transaction, mpu6050_fifo_block_t *const block)
+{
+	assert_not_null(device);
+	assert_not_null(transaction);
+	assert_not_null(block);
+	
+	transaction->slaveAddress = device->slaveAddress;
+	transaction->handle = DeviceHandle(device);
+	transaction->registerAddress = MPU6050_REG_FIFO_COUNTH;
+	transaction->direction = I2CASYNC_READ;
+	transaction->count = sizeof(block->count);
+	transaction->data = block->count;
+}
+
+/**
+ * @brief Prepares an asynchronous burst read of the frames counted by the FIFO count transaction
+ * @param[in] device The device to read from or write to
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] block The FIFO buffers after the FIFO count transaction completed
+ * @return The number of frames the transaction reads; zero if the FIFO is empty or overflowed
+ */
+uint8_t MPU6050_PrepareReadFifo(mpu6050_device_t *const device, i2casync_transaction_t *const transaction, mpu6050_fifo_block_t *const block)
+{
+	assert_not_null(device);
+	assert_not_null(transaction);
+	assert_not_null(block);
+	
+	if (MPU6050_FifoOverflowed(block)) return 0;
+	
+	uint16_t frames = (((uint16_t)block->count[0] << 8) | block->count[1]) / MPU6050_FIFO_FRAME_LENGTH;
+	if (frames > MPU6050_FIFO_BURST_FRAMES) frames = MPU6050_FIFO_BURST_FRAMES;
+	
+	transaction->slaveAddress = device->slaveAddress;
+	transaction->handle = DeviceHandle(device);
+	transaction->registerAddress = MPU6050_REG_FIFO_R_W;
+	transaction->direction = I2CASYNC_READ;
+	transaction->count = (uint8_t)(frames * MPU6050_FIFO_FRAME_LENGTH);
+	transaction->data = block->frames;
+	
+	return (uint8_t)frames;
+}
+
+/**
+ * @brief Prepares an asynchronous FIFO reset
+ * @param[in] device The device to read from or write to
+ * @param[out] transaction The transaction to prepare; the callback is left untouched
+ * @param[in] block The FIFO buffers
+ * @param[in] userControl The USER_CTRL register value to keep; the FIFO reset bit is added
+ */
+void MPU6050_PrepareResetFifo(mpu6050_device_t *const device, i2casync_transaction_t *const transaction, mpu6050_fifo_block_t *const block, uint8_t userControl)
+{
+	assert_not_null(device);
+	assert_not_null(transaction);
+	assert_not_null(block);
+	
+	block->userControl = userControl | MPU6050_USER_CTRL_FIFO_RESET_MASK;
+	
+	transaction->slaveAddress = device->slaveAddress;
+	transaction->handle = DeviceHandle(device);
+	transaction->registerAddress = MPU6050_REG_USER_CTRL;
+	transaction->direction = I2CASYNC_WRITE;
+	transaction->count = 1;
+	transaction->data = &block->userControl;
+}
+
+/**
+ * @brief Decodes the frames read by an asynchronous FIFO burst read
+ * @param[in] block The FIFO buffers
+ * @param[in] frames The number of frames read, see {@see MPU6050_PrepareReadFifo}
+ * @param[out] samples The samples; temperature is not part of the FIFO frames and is set to zero
+ */
+void MPU6050_DecodeFifo(const mpu6050_fifo_block_t *const block, uint8_t frames, mpu6050_sensor_t *const samples)
+{
+	assert_not_null(block);
+	assert_not_null(samples);
+	assert(frames <= MPU6050_FIFO_BURST_FRAMES);
+	
+	for (uint8_t i = 0; i < frames; ++i)
+	{
+		AssignFifoFrame(&block->frames[i * MPU6050_FIFO_FRAME_LENGTH], &samples[i]);
+	}
 }
@@ -1,11 +1,16 @@
 #include "comm/io.h"
+#include "comm/trace.h"
 #include "i2c/i2c.h"
 #include "i2c/i2carbiter.h"
+#include "cpu/bitflag.h"
+#include "cpu/delay.h"
+#include "cpu/irq.h"
 #include "imu/mma8451q.h"
 #include "imu/mpu6050.h"
 #include "imu/hmc5883l.h"
 
 #include "init_sensors.h"
+#include "parameters.h"
 
 /**
 * @brief Static buffer to save memory
@@ -21,6 +26,28 @@ static union {
 } config_buffer;
 
 
+/**
+* @brief The MPU6050 gyroscope scaling values, indexed by {@see mpu6050_gyro_fs_t}
+*/
+static const fix16_t mpu6050_gyroscope_scalers[] = { F16(131), F16(65.5), F16(32.8), F16(16.4) };
+
+/**
+* @brief The HMC5883L scaling values, indexed by {@see hmc5883l_gain_t}
+*/
+static const int16_t hmc5883l_magnetometer_scalers[] = { 1370, 1090, 820, 660, 440, 390, 330, 230 };
+
+/**
+* @brief The HMC5883L polling periods in milliseconds, indexed by {@see hmc5883l_do_t}
+*/
+static const uint16_t hmc5883l_periods[] = { 1333, 666, 333, 133, 66, 33, 13 };
+
+#if !ENABLE_MMA8451Q_FIFO
+/**
+* @brief The MMA8451Q sample periods in microseconds, indexed by {@see mma8451q_datarate_t}
+*/
+static const uint32_t mma8451q_periods[] = { 1250, 2500, 5000, 10000, 20000, 80000, 160000, 640000 };
+#endif
+
 /**
 * @brief Gets the scaling value for the MPU6050 accelerometer
 */
@@ -37,25 +64,37 @@ static fix16_t mpu6050_gyroscope_scaler = 0;
 static fix16_t hmc5883l_magnetometer_scaler = 0;
 
 /**
-* @brief Sets up the MMA8451Q communication
+* @brief Gets the scaling value for the MMA8451Q accelerometer
 */
-void InitMMA8451Q()
+static fix16_t mma8451q_accelerometer_scaler = 0;
+
+/**
+* @brief The time of the MMA8451Q reset in milliseconds
+*/
+static uint32_t mma8451q_reset_time = 0;
+
+/**
+* @brief The time the MMA8451Q needs after a reset in milliseconds
+*/
+#define MMA8451Q_RESET_DELAY	(20)
+
+/**
+* @brief Identifies and resets the MMA8451Q
+*/
+void ResetMMA8451Q()
 {
 #if ENABLE_MMA8451Q
-    mpu6050_confreg_t *configuration = &config_buffer.mma8451q_configuration;
-
-    IO_SendZString("MMA8451Q: initializing ...\r\n");
+    Trace_Send0(TRACE_MMA8451Q_INITIALIZING);
 
     /* configure interrupts for accelerometer */
     /* INT1_ACCEL is on PTA14, INT2_ACCEL is on PTA15 */
-    SIM->SCGC5 |= (1 << SIM_SCGC5_PORTC_SHIFT) & SIM_SCGC5_PORTC_MASK; /* power to the masses */
-    MMA8451Q_INT_PORT->PCR[MMA8451Q_INT1_PIN] = PORT_PCR_MUX(0x1) | PORT_PCR_IRQC(0b1010) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK; /* interrupt on falling edge, pull-up for open drain/active low line */
-    MMA8451Q_INT_PORT->PCR[MMA8451Q_INT2_PIN] = PORT_PCR_MUX(0x1) | PORT_PCR_IRQC(0b1010) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK; /* interrupt on falling edge, pull-up for open drain/active low line */
-    MMA8451Q_INT_GPIO->PDDR &= ~(GPIO_PDDR_PDD(1 << MMA8451Q_INT1_PIN) | GPIO_PDDR_PDD(1 << MMA8451Q_INT2_PIN));
+    BitFlag_Set32(&SIM->SCGC5, SIM_SCGC5_PORTC_MASK); /* power to the masses */
+    MMA8451Q_INT_PORT->PCR[MMA8451Q_INT1_PIN] = PORT_PCR_MUX(0x1) | PORT_PCR_IRQC(MMA8451Q_INT_IRQC) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK; /* interrupt while low, pull-up for open drain/active low line */
+    MMA8451Q_INT_PORT->PCR[MMA8451Q_INT2_PIN] = PORT_PCR_MUX(0x1) | PORT_PCR_IRQC(MMA8451Q_INT_IRQC) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK; /* interrupt while low, pull-up for open drain/active low line */
+    BitFlag_Clear32(&BITFLAG_GPIO(MMA8451Q_INT_GPIO)->PDDR, GPIO_PDDR_PDD(1 << MMA8451Q_INT1_PIN) | GPIO_PDDR_PDD(1 << MMA8451Q_INT2_PIN));
 
     /* prepare interrupts for pin change / PORTA */
-    NVIC_ICPR |= 1 << 30;	/* clear pending flag */
-    NVIC_ISER |= 1 << 30;	/* enable interrupt */
+    Irq_Enable((IRQn_Type)PORTA_IRQ, IRQ_SOURCE_SENSOR);
 
     /* switch to the correct port */
     I2CArbiter_Select(MMA8451Q_I2CADDR);
@@ -63,41 +102,81 @@ void InitMMA8451Q()
     /* perform identity check */
     uint8_t id = MMA8451Q_WhoAmI();
     assert(id = 0x1A);
-    IO_SendZString("MMA8451Q: device found.\r\n");
+    Trace_Send1(TRACE_MMA8451Q_FOUND, id);
 
     /* configure accelerometer */
     MMA8451Q_EnterPassiveMode();
     MMA8451Q_Reset();
-    delay_ms(20);
+    mma8451q_reset_time = systemTime();
+#endif
+}
+
+/**
+* @brief Sets up the MMA8451Q communication once the reset of {@see ResetMMA8451Q} has completed
+*/
+void InitMMA8451Q()
+{
+#if ENABLE_MMA8451Q
+    mma8451q_confreg_t *configuration = &config_buffer.mma8451q_configuration;
+
+    /* wait for the remainder of the reset time */
+    const uint32_t elapsed = systemTime() - mma8451q_reset_time;
+    if (elapsed < MMA8451Q_RESET_DELAY)
+    {
+        delay_ms(MMA8451Q_RESET_DELAY - elapsed);
+    }
+
+    /* the bus may have been switched in the meantime */
+    I2CArbiter_Select(MMA8451Q_I2CADDR);
 
     /* TODO: Initiate self-test */
 
     /* read configuration and modify */
     MMA8451Q_FetchConfiguration(configuration);
 
-    MMA8451Q_SetSensitivity(configuration, MMA8451Q_SENSITIVITY_2G, MMA8451Q_HPO_DISABLED);
-    MMA8451Q_SetDataRate(configuration, MMA8451Q_DATARATE_100Hz, MMA8451Q_LOWNOISE_ENABLED);
+    MMA8451Q_SetSensitivity(configuration, (mma8451q_sensitivity_t)parameters.sensors.mma8451q_sensitivity, MMA8451Q_HPO_DISABLED);
+    mma8451q_accelerometer_scaler = fix16_from_int(4096 >> parameters.sensors.mma8451q_sensitivity);    /* 4096 LSB/g at 2G in 14bit mode, halved per range step */
+#if ENABLE_MMA8451Q_FIFO
+    /* full rate into the FIFO; the watermark interrupt batches the bus traffic */
+    MMA8451Q_SetDataRate(configuration, MMA8451Q_DATARATE_800Hz, MMA8451Q_LOWNOISE_ENABLED);
+    MMA8451Q_SetFifo(configuration, MMA8451Q_FIFO_CIRCULAR, MMA8451Q_FIFO_WATERMARK);
+#else
+    MMA8451Q_SetDataRate(configuration, (mma8451q_datarate_t)parameters.sensors.mma8451q_data_rate, MMA8451Q_LOWNOISE_ENABLED);
+    MMA8451Q_SetFifo(configuration, MMA8451Q_FIFO_DISABLED, 0);
+#endif
     MMA8451Q_SetOversampling(configuration, MMA8451Q_OVERSAMPLING_HIGHRESOLUTION);
     MMA8451Q_ClearInterruptConfiguration(configuration);
     MMA8451Q_SetInterruptMode(configuration, MMA8451Q_INTMODE_OPENDRAIN, MMA8451Q_INTPOL_ACTIVELOW);
+#if ENABLE_MMA8451Q_FIFO
+    MMA8451Q_ConfigureInterrupt(configuration, MMA8451Q_INT_FIFO, MMA8451Q_INTPIN_INT2);
+#else
     MMA8451Q_ConfigureInterrupt(configuration, MMA8451Q_INT_DRDY, MMA8451Q_INTPIN_INT2);
+#endif
 
     MMA8451Q_StoreConfiguration(configuration);
     MMA8451Q_EnterActiveMode();
 
-    IO_SendZString("MMA8451Q: configuration done.\r\n");
+    Trace_Send0(TRACE_MMA8451Q_CONFIGURED);
 #endif
 }
 
+#if ENABLE_MPU6050_SECONDARY
 /**
-* @brief Sets up the MPU6050 communication
+* @brief The MPU6050 at the alternate address, see {@see ENABLE_MPU6050_SECONDARY}
 */
-void InitMPU6050()
+mpu6050_device_t mpu6050_secondary = MPU6050_DEVICE_INIT(MPU6050_I2CADDR_ALT);
+#endif
+
+/**
+* @brief Identifies and configures an MPU6050 from the sensor parameters
+* @param[in] device The device
+*
+* All devices share the full scales, so the scalers apply to every one of them.
+*/
+static void ConfigureMPU6050(mpu6050_device_t *const device)
 {
     mpu6050_confreg_t *configuration = &config_buffer.mpu6050_configuration;
 
-    IO_SendZString("MPU6050: initializing ...\r\n");
-
     /**
     * BUG: see also note in main()
     * After power-up the interrupt line toggles
@@ -106,12 +185,12 @@ void InitMPU6050()
     */
 
     /* switch to the correct port */
-    I2CArbiter_Select(MPU6050_I2CADDR);
+    MPU6050_SelectDevice(device);
 
     /* perform identity check */
     uint8_t value = MPU6050_WhoAmI();
     assert(value == 0x68);
-    IO_SendZString("MPU6050: device found.\r\n");
+    Trace_Send1(TRACE_MPU6050_FOUND, value);
 
     /* disable interrupts */
     MPU6050_SelectClockSource(MPU6050_CONFIGURE_DIRECT, MPU6050_CLOCK_8MHZOSC);
@@ -122,70 +201,192 @@ void InitMPU6050()
 
     /* read configuration and modify */
     MPU6050_FetchConfiguration(configuration);
-#if DEBUG
-    MPU6050_SetGyroscopeSampleRateDivider(configuration, 80); /* the gyro samples at 8kHz, so division by 40 --> 200Hz */
+#if ENABLE_MPU6050_FIFO
+    MPU6050_SetGyroscopeSampleRateDivider(configuration, 8000 / (1000000 / MPU6050_FIFO_SAMPLE_PERIOD_US)); /* the gyro samples at 8kHz, so division by 8 --> 1kHz */
 #else
-    MPU6050_SetGyroscopeSampleRateDivider(configuration, 40); /* the gyro samples at 8kHz, so division by 40 --> 200Hz */
+    MPU6050_SetGyroscopeSampleRateDivider(configuration, parameters.sensors.mpu6050_sample_rate_divider);
 #endif
     
-    MPU6050_SetGyroscopeFullScale(configuration, MPU6050_GYRO_FS_2000);
-    mpu6050_gyroscope_scaler = fix16_from_float(MPU6050_GYRO_LSB(MPU6050_GYRO_FS_2000));
+    const mpu6050_gyro_fs_t gyroscope_full_scale = (mpu6050_gyro_fs_t)parameters.sensors.mpu6050_gyroscope_full_scale;
+    MPU6050_SetGyroscopeFullScale(configuration, gyroscope_full_scale);
+    mpu6050_gyroscope_scaler = mpu6050_gyroscope_scalers[gyroscope_full_scale];
 
-    MPU6050_SetAccelerometerFullScale(configuration, MPU6050_ACC_FS_4);
-    mpu6050_accelerometer_scaler = fix16_from_int(8192);    /* scaler value for ACC_FS_4*/
+    const mpu6050_acc_fs_t accelerometer_full_scale = (mpu6050_acc_fs_t)parameters.sensors.mpu6050_accelerometer_full_scale;
+    MPU6050_SetAccelerometerFullScale(configuration, accelerometer_full_scale);
+    mpu6050_accelerometer_scaler = fix16_from_int(16384 >> accelerometer_full_scale);    /* 16384 LSB/g at ACC_FS_2, halved per range step */
 
     MPU6050_ConfigureInterrupts(configuration,
         MPU6050_INTLEVEL_ACTIVELOW,
         MPU6050_INTOPEN_OPENDRAIN,
         MPU6050_INTLATCH_LATCHED, /* if configured to PULSE the line goes postal */
         MPU6050_INTRDCLEAR_READSTATUS);
+#if ENABLE_MPU6050_FIFO
+    MPU6050_EnableInterrupts(configuration,
+        MPU6050_INT_DISABLED,
+        MPU6050_INT_DISABLED,
+        MPU6050_INT_DISABLED); /* the FIFO is drained periodically, see MPU6050_FIFO_POLL_PERIOD */
+    MPU6050_ConfigureFifo(configuration, MPU6050_FIFO_ENABLED);
+#else
     MPU6050_EnableInterrupts(configuration,
         MPU6050_INT_DISABLED,
         MPU6050_INT_DISABLED,
         MPU6050_INT_ENABLED); /* enable data ready interrupt */
+    MPU6050_ConfigureFifo(configuration, MPU6050_FIFO_DISABLED);
+#endif
+#if ENABLE_HMC5883L_PASSTHROUGH
+    HMC5883L_ConfigurePassThrough(configuration); /* data ready waits for the magnetometer read */
+#endif
     MPU6050_SelectClockSource(configuration, MPU6050_CLOCK_XGYROPLL);
     MPU6050_SetSleepMode(configuration, MPU6050_SLEEP_DISABLED);
     MPU6050_StoreConfiguration(configuration);
 
+    /* the first store after power-up writes every register, including FIFO_R_W */
+    MPU6050_ResetFifo();
+}
+
+/**
+* @brief Sets up the MPU6050 communication
+*/
+void InitMPU6050()
+{
+    Trace_Send0(TRACE_MPU6050_INITIALIZING);
+    ConfigureMPU6050(&mpu6050_primary);
+
     /* configure interrupts for MPU6050 */
     /* INT is on PTA13 */
-    SIM->SCGC5 |= (1 << SIM_SCGC5_PORTA_SHIFT) & SIM_SCGC5_PORTA_MASK; /* power to the masses */
+    BitFlag_Set32(&SIM->SCGC5, SIM_SCGC5_PORTA_MASK); /* power to the masses */
     MPU6050_INT_PORT->PCR[MPU6050_INT_PIN] = PORT_PCR_MUX(0x1) | PORT_PCR_IRQC(0b1010) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK; /* interrupt on falling edge, pull-up for open drain/active low line */
-    MPU6050_INT_GPIO->PDDR &= ~(GPIO_PDDR_PDD(1 << MPU6050_INT_PIN));
+    BitFlag_Clear32(&BITFLAG_GPIO(MPU6050_INT_GPIO)->PDDR, GPIO_PDDR_PDD(1 << MPU6050_INT_PIN));
 
     /* prepare interrupts for pin change / PORTA */
-    NVIC_ICPR |= 1 << 30;	/* clear pending flag */
-    NVIC_ISER |= 1 << 30;	/* enable interrupt */
+    Irq_Enable((IRQn_Type)PORTA_IRQ, IRQ_SOURCE_SENSOR);
 
-    IO_SendZString("MPU6050: configuration done.\r\n");
+    Trace_Send0(TRACE_MPU6050_CONFIGURED);
 }
 
+#if ENABLE_MPU6050_SECONDARY
+/**
+* @brief Sets up the communication with the second MPU6050
+*/
+void InitMPU6050Secondary()
+{
+    Trace_Send0(TRACE_MPU6050_INITIALIZING);
+    ConfigureMPU6050(&mpu6050_secondary);
+
+    /* the second INT shares PORTA with the first one */
+    BitFlag_Set32(&SIM->SCGC5, SIM_SCGC5_PORTA_MASK);
+    MPU6050_SECONDARY_INT_PORT->PCR[MPU6050_SECONDARY_INT_PIN] = PORT_PCR_MUX(0x1) | PORT_PCR_IRQC(0b1010) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK; /* interrupt on falling edge, pull-up for open drain/active low line */
+    BitFlag_Clear32(&BITFLAG_GPIO(MPU6050_SECONDARY_INT_GPIO)->PDDR, GPIO_PDDR_PDD(1 << MPU6050_SECONDARY_INT_PIN));
+
+    Irq_Enable((IRQn_Type)PORTA_IRQ, IRQ_SOURCE_SENSOR);
+
+    Trace_Send0(TRACE_MPU6050_CONFIGURED);
+}
+#endif
+
 /**
 * @brief Sets up the HMC5883L communication
 */
 void InitHMC5883L()
 {
     hmc5883l_confreg_t *configuration = &config_buffer.hmc5883l_configuration;
-    IO_SendZString("HMC5883L: initializing ...\r\n");
+    Trace_Send0(TRACE_HMC5883L_INITIALIZING);
+
+#if ENABLE_HMC5883L_PASSTHROUGH
+    /* the HMC5883L sits on the MPU6050 auxiliary bus; connect it to ours until InitMPU6050() takes over */
+    MPU6050_SelectDevice(&mpu6050_primary);
+    MPU6050_SetI2CMaster(MPU6050_CONFIGURE_DIRECT, MPU6050_I2CMASTER_DISABLED);
+    MPU6050_SetBypass(MPU6050_CONFIGURE_DIRECT, MPU6050_BYPASS_ENABLED);
+#endif
 
     I2CArbiter_Select(HMC5883L_I2CADDR);
     uint32_t ident = HMC5883L_Identification();
     assert(ident == 0x00483433);
-    IO_SendZString("HMC5883L: device found.\r\n");
+    Trace_Send1(TRACE_HMC5883L_FOUND, ident);
 
     /* read configuration and modify */
     HMC5883L_FetchConfiguration(configuration);
-    HMC5883L_SetAveraging(configuration, HMC5883L_MA_1);
-    HMC5883L_SetOutputRate(configuration, HMC5883L_DO_75Hz);
+    HMC5883L_SetAveraging(configuration, (hmc5883l_ma_t)parameters.sensors.hmc5883l_averaging);
+    HMC5883L_SetOutputRate(configuration, (hmc5883l_do_t)parameters.sensors.hmc5883l_output_rate);
     HMC5883L_SetMeasurementMode(configuration, HMC5883L_MS_NORMAL);
     
-    HMC5883L_SetGain(configuration, HMC5883L_GN_1090_1p3Ga);
-    hmc5883l_magnetometer_scaler = fix16_from_int(1090);         /* scaler value for GN_1090_1p3Ga*/
+    const hmc5883l_gain_t gain = (hmc5883l_gain_t)parameters.sensors.hmc5883l_gain;
+    HMC5883L_SetGain(configuration, gain);
+    hmc5883l_magnetometer_scaler = fix16_from_int(hmc5883l_magnetometer_scalers[gain]);
 
+#if ENABLE_HMC5883L_DRDY
+    HMC5883L_SetOperatingMode(configuration, HMC5883L_MD_IDLE); /* measurements are triggered one by one */
+#else
     HMC5883L_SetOperatingMode(configuration, HMC5883L_MD_CONT);
+#endif
     HMC5883L_StoreConfiguration(configuration);
 
-    IO_SendZString("HMC5883L: configuration done.\r\n");
+#if ENABLE_HMC5883L_DRDY
+    /* configure interrupts for HMC5883L */
+    BitFlag_Set32(&SIM->SCGC5, SIM_SCGC5_PORTA_MASK);
+    HMC5883L_DRDY_PORT->PCR[HMC5883L_DRDY_PIN] = PORT_PCR_MUX(0x1) | PORT_PCR_IRQC(0b1010) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK; /* interrupt on falling edge, DRDY is pulled low for 250us */
+    BitFlag_Clear32(&BITFLAG_GPIO(HMC5883L_DRDY_GPIO)->PDDR, GPIO_PDDR_PDD(1 << HMC5883L_DRDY_PIN));
+
+    /* prepare interrupts for pin change / PORTA */
+    Irq_Enable((IRQn_Type)PORTA_IRQ, IRQ_SOURCE_SENSOR);
+#endif
+
+    Trace_Send0(TRACE_HMC5883L_CONFIGURED);
+}
+
+/**
+* @brief Sets the MPU6050 sample rate divider at runtime
+* @param[in] divider The divider in a range of 1..255
+*/
+void SetMPU6050SampleRateDivider(uint8_t divider)
+{
+    mpu6050_confreg_t *configuration = &config_buffer.mpu6050_configuration;
+
+    /* only SMPLRT_DIV goes over the wire */
+    MPU6050_SelectDevice(&mpu6050_primary);
+    MPU6050_RecallConfiguration(configuration);
+    MPU6050_SetGyroscopeSampleRateDivider(configuration, divider);
+    MPU6050_StoreConfiguration(configuration);
+
+#if ENABLE_MPU6050_SECONDARY
+    /* the replica has to keep pace with the primary */
+    MPU6050_SelectDevice(&mpu6050_secondary);
+    MPU6050_RecallConfiguration(configuration);
+    MPU6050_SetGyroscopeSampleRateDivider(configuration, divider);
+    MPU6050_StoreConfiguration(configuration);
+#endif
+
+    parameters.sensors.mpu6050_sample_rate_divider = divider;
+}
+
+/**
+* @brief Sets the HMC5883L output rate at runtime
+* @param[in] rate The output rate
+*/
+void SetHMC5883LOutputRate(hmc5883l_do_t rate)
+{
+    hmc5883l_confreg_t *configuration = &config_buffer.hmc5883l_configuration;
+
+#if ENABLE_HMC5883L_PASSTHROUGH
+    /* stop the auxiliary master and let a pending slave read finish before taking over the bus */
+    MPU6050_SelectDevice(&mpu6050_primary);
+    MPU6050_SetI2CMaster(MPU6050_CONFIGURE_DIRECT, MPU6050_I2CMASTER_DISABLED);
+    delay_ms(1);
+    MPU6050_SetBypass(MPU6050_CONFIGURE_DIRECT, MPU6050_BYPASS_ENABLED);
+#endif
+
+    /* only CRA goes over the wire */
+    I2CArbiter_Select(HMC5883L_I2CADDR);
+    HMC5883L_RecallConfiguration(configuration);
+    HMC5883L_SetOutputRate(configuration, rate);
+    HMC5883L_StoreConfiguration(configuration);
+    parameters.sensors.hmc5883l_output_rate = rate;
+
+#if ENABLE_HMC5883L_PASSTHROUGH
+    MPU6050_SelectDevice(&mpu6050_primary);
+    MPU6050_SetBypass(MPU6050_CONFIGURE_DIRECT, MPU6050_BYPASS_DISABLED);
+    MPU6050_SetI2CMaster(MPU6050_CONFIGURE_DIRECT, MPU6050_I2CMASTER_ENABLED);
+#endif
 }
 
 /**
@@ -210,4 +411,47 @@ fix16_t mpu6050_gyroscope_get_scaler()
 fix16_t hmc5883l_magnetometer_get_scaler()
 {
     return hmc5883l_magnetometer_scaler;
+}
+
+/**
+* @brief Gets the scaling value for the MMA8451Q accelerometer
+*/
+fix16_t mma8451q_accelerometer_get_scaler()
+{
+    return mma8451q_accelerometer_scaler;
+}
+
+/**
+* @brief Gets the HMC5883L polling period of the configured output rate
+* @return The period in milliseconds
+*/
+uint16_t hmc5883l_get_period()
+{
+    return hmc5883l_periods[parameters.sensors.hmc5883l_output_rate];
+}
+
+/**
+* @brief Gets the MPU6050 read period of the configured sample rate
+* @return The period in microseconds; the FIFO poll period in FIFO mode
+*/
+uint32_t mpu6050_get_period_us()
+{
+#if ENABLE_MPU6050_FIFO
+    return MPU6050_FIFO_POLL_PERIOD * 1000u;
+#else
+    return parameters.sensors.mpu6050_sample_rate_divider * 125u; /* 8 kHz gyro rate */
+#endif
+}
+
+/**
+* @brief Gets the MMA8451Q read period of the configured data rate
+* @return The period in microseconds; the watermark interval in FIFO mode
+*/
+uint32_t mma8451q_get_period_us()
+{
+#if ENABLE_MMA8451Q_FIFO
+    return MMA8451Q_FIFO_WATERMARK * MMA8451Q_FIFO_SAMPLE_PERIOD_US;
+#else
+    return mma8451q_periods[parameters.sensors.mma8451q_data_rate];
+#endif
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "derivative.h"
 #include "nice_names.h"
 
+#include "cpu/bitflag.h"
 #include "cpu/delay.h"
 #include "led/led.h"
 
@@ -17,7 +18,7 @@
 void LED_Init()
 {
 	/* Set system clock gating to enable gate to port B */
-	SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK | SIM_SCGC5_PORTD_MASK;
+	BitFlag_Set32(&SIM->SCGC5, SIM_SCGC5_PORTB_MASK | SIM_SCGC5_PORTD_MASK);
 	
 	/* Set Port B, pin 18 and 19 to GPIO mode */
 	PORTB->PCR[18] = PORT_PCR_MUX(1) | PORT_PCR_DSE_MASK; /* not using |= assignment here due to some of the flags being undefined at reset */
@@ -27,8 +28,8 @@ void LED_Init()
 	PORTD->PCR[1] = PORT_PCR_MUX(1) | PORT_PCR_DSE_MASK;
 		
 	/* Data direction for port B, pin 18 and 19 and port D, pin 1 set to output */ 
-	GPIOB->PDDR |= GPIO_PDDR_PDD(1<<18) | GPIO_PDDR_PDD(1<<19);
-	GPIOD->PDDR |= GPIO_PDDR_PDD(1<<1);
+	BitFlag_Set32(&BITFLAG_GPIO(GPIOB)->PDDR, GPIO_PDDR_PDD(1<<18) | GPIO_PDDR_PDD(1<<19));
+	BitFlag_Set32(&BITFLAG_GPIO(GPIOD)->PDDR, GPIO_PDDR_PDD(1<<1));
 	
 	/* disable all leds */
 	LED_Off();
@@ -13,169 +13,2256 @@
 */
 #define DATA_FUSE_MODE (!DATA_FETCH_MODE)
 
-#if 1
+/*!
+* \def FIX16_BENCHMARK Set to <code>1</code> to time the M0+ fix16 kernels against libfixmath once at startup, see {@see fix16_m0plus_benchmark}
+*/
+#define FIX16_BENCHMARK 0
+
+/*!
+* \def FUSION_GYRO_FALLBACK Set to <code>1</code> to follow the TRIAD axes with {@see fusion_update_direct} while no gyroscope data arrives
+*
+* The MPU6050 delivers both the gyroscope and the accelerometer, so the fallback needs another
+* accelerometer, i.e. {@see ENABLE_MMA8451Q}; without one the output is reported as stale instead.
+* The default build has ENABLE_MMA8451Q set to <code>0</code>, so there this switch has no effect:
+* an MPU6050 dropout freezes the attitude and is only visible as staleSteps in the pipeline health.
+*/
+#define FUSION_GYRO_FALLBACK 1
+
+#if !defined(BENCHMARK_FIRMWARE)
 
 #include "ARMCM0plus.h"
 #include "derivative.h" /* include peripheral declarations */
-#include "bme.h"
 
+#include "cpu/bitflag.h"
 #include "cpu/clock.h"
 #include "cpu/systick.h"
 #include "cpu/delay.h"
+#include "cpu/irq.h"
+#include "cpu/profile.h"
+#include "cpu/ramfunc.h"
+#include "cpu/tasks.h"
 #include "comm/uart.h"
 #include "comm/buffer.h"
 #include "comm/io.h"
 #include "comm/p2pprotocol.h"
+#include "comm/batch.h"
+#include "comm/command.h"
+#include "comm/samplequeue.h"
+#include "comm/scheduler.h"
+#include "comm/trace.h"
 
 #include "i2c/i2c.h"
 #include "i2c/i2carbiter.h"
+#include "i2c/i2casync.h"
 #include "imu/mma8451q.h"
 #include "imu/mpu6050.h"
 #include "imu/hmc5883l.h"
 #include "led/led.h"
 
+#include "fusion/accelerometer_merge.h"
 #include "fusion/sensor_prepare.h"
+#include "fusion/magnetometer_calibration.h"
 #include "fusion/sensor_fusion.h"
+#include "fusion/orientation_pack.h"
+#include "fusion/fix16_m0plus.h"
 
 #include "init_sensors.h"
 #include "nice_names.h"
 #include "output_mode.h"
+#include "parameters.h"
+#include "sensor_pipeline.h"
 
 #define UART_RX_BUFFER_SIZE	(16)				        /*! Size of the UART RX buffer in byte*/
-#define UART_TX_BUFFER_SIZE	(64)				        /*! Size of the UART TX buffer in byte */
+#define UART_TX_BUFFER_SIZE	(256)				        /*! Size of the UART TX buffer in byte; must hold a fully escaped batch frame */
 static uint8_t uartInputData[UART_RX_BUFFER_SIZE]  __attribute__((aligned(4))), 	    /*! The UART RX buffer */
                uartOutputData[UART_TX_BUFFER_SIZE]  __attribute__((aligned(4)));	/*! The UART TX buffer */
 static buffer_t uartInputFifo, 						    /*! The UART RX buffer driver */
 		        uartOutputFifo;							/*! The UART TX buffer driver */
 
+#define UART_BAUD_RATE      (115200)    /*! The initial baud rate, see {@see InitUart0} */
+
+#define LINK_STATUS_TYPE    (0x61)  /*! Frame type of the link status telemetry */
+#define UART_PROFILE_TYPE   (0x62)  /*! Frame type of the UART0 interrupt cycle counts, see {@see UART_PROFILE_IRQ} */
+#define SECTION_PROFILE_TYPE (0x64) /*! Frame type of the hot path section timings, see {@see PROFILE_ENABLED} */
+#define BOOT_REPORT_TYPE    (0x65)  /*! Frame type of the one-time bring-up timing report, see {@see boot_report_t} */
+#define FIX16_BENCHMARK_TYPE (0x66) /*! Frame type of the one-time fix16 kernel benchmark, see {@see FIX16_BENCHMARK} */
+#define IRQ_PROFILE_TYPE    (0x67)  /*! Frame type of the interrupt handler timings and latencies, see {@see IRQ_PROFILE_ENABLED} */
+/* 0x68 is the trace message frame, see {@see TRACE_FRAME_TYPE} */
+/* 0x69 is the report of the benchmark firmware, see maintest.c */
+
+#if ENABLE_MPU6050_SECONDARY
+#define I2CARBITER_COUNT 	(4)					/*< Number of I2C devices we're talking to */
+#else
 #define I2CARBITER_COUNT 	(3)					/*< Number of I2C devices we're talking to */
+#endif
 i2carbiter_entry_t i2carbiter_entries[I2CARBITER_COUNT]; /*< Structure for the pin enabling/disabling manager */
 
+#define MPU6050_QUEUE_LENGTH	(4)		/*< Number of MPU6050 register blocks in flight between the interrupts and the main loop */
+#define HMC5883L_QUEUE_LENGTH	(2)		/*< Number of HMC5883L register blocks in flight between the interrupts and the main loop */
+#define MMA8451Q_QUEUE_LENGTH	(2)		/*< Number of MMA8451Q register blocks in flight between the interrupts and the main loop */
+
+/**
+ * @brief The queues handing the sensor register blocks to the main loop
+ * 
+ * Every read transaction is pointed at a reserved slot and publishes it
+ * on completion, see {@see sample_queue_t}; the main loop decodes and
+ * releases the slots in order.
+ */
+static sample_queue_t mpu6050_queue, hmc5883l_queue;
+
+/**
+ * @brief The asynchronous sensor read transactions
+ */
+static i2casync_transaction_t mpu6050_transaction, hmc5883l_transaction;
+
+/**
+ * @brief The register blocks read by the sensor transactions, i.e. the queue slots
+ */
+#if ENABLE_MPU6050_FIFO
+/* the sensor FIFO buffers the samples, see mpu6050_fifo_block */
+#elif ENABLE_HMC5883L_PASSTHROUGH
+static hmc5883l_passthrough_block_t mpu6050_blocks[MPU6050_QUEUE_LENGTH];
+#else
+static mpu6050_intdatareg_t mpu6050_blocks[MPU6050_QUEUE_LENGTH];
+#endif
+static uint8_t hmc5883l_blocks[HMC5883L_QUEUE_LENGTH][HMC5883L_DATA_BLOCK_LENGTH];
+
+#if ENABLE_MMA8451Q
+static sample_queue_t mma8451q_queue;
+static i2casync_transaction_t mma8451q_transaction;
+#if ENABLE_MMA8451Q_FIFO
+static mma8451q_fifo_block_t mma8451q_blocks[MMA8451Q_QUEUE_LENGTH];
+
+/**
+ * @brief The number of MMA8451Q FIFO overflows
+ */
+static uint32_t mma8451q_fifo_overflows = 0;
+
+/**
+ * @brief The decoded MMA8451Q FIFO samples
+ */
+static mma8451q_acc_t mma8451q_fifo_samples[MMA8451Q_FIFO_WATERMARK];
+#else
+static mma8451q_acc_t mma8451q_blocks[MMA8451Q_QUEUE_LENGTH];
+#endif
+#endif
+
+#if ENABLE_MPU6050_FIFO
+
+/**
+ * @brief The FIFO transactions of the MPU6050 in FIFO mode
+ * 
+ * The count transaction is submitted every {@ref MPU6050_FIFO_POLL_PERIOD};
+ * its callback chains either the burst read or the reset after an overflow.
+ * The block is the single slot of {@see mpu6050_queue}: no burst is started
+ * before the main loop released the previous one, the frames wait in the
+ * sensor FIFO instead.
+ */
+static i2casync_transaction_t mpu6050_fifo_count_transaction, mpu6050_fifo_read_transaction, mpu6050_fifo_reset_transaction;
+static mpu6050_fifo_block_t mpu6050_fifo_block;
+
+/**
+ * @brief The number of frames read by the FIFO burst in flight
+ */
+static volatile uint8_t mpu6050_fifo_frames = 0;
+
+/**
+ * @brief The number of FIFO overflows
+ */
+static volatile uint32_t mpu6050_fifo_overflows = 0;
+
+/**
+ * @brief The decoded FIFO frames
+ */
+static mpu6050_sensor_t mpu6050_fifo_samples[MPU6050_FIFO_BURST_FRAMES];
+
+#endif
+
+#if ENABLE_MPU6050_FIFO
+
+/**
+ * @brief The capture timestamp of the MPU6050 FIFO count transaction in flight
+ */
+static volatile uint32_t mpu6050_capture_time = 0;
+
+#endif
+
+#if ENABLE_HMC5883L_DRDY
+
+/**
+ * @brief The transaction starting a single HMC5883L measurement and its mode register value
+ */
+static i2casync_transaction_t hmc5883l_trigger_transaction;
+static uint8_t hmc5883l_trigger_mode;
+
+#endif
+
+/**
+ * @brief The event bits of the main loop tasks
+ */
+#define LOOP_EVENT_SENSOR_READ	(1u << 0)	/*< A sensor read was published */
+#define LOOP_EVENT_SNAPSHOT		(1u << 1)	/*< The fusion task published a snapshot */
+#define LOOP_EVENT_COMMAND		(1u << 2)	/*< Command bytes were received */
+
+/**
+ * @brief The main loop tasks, see {@see loop_task_table}
+ */
+typedef enum {
+    LOOP_TASK_FUSION = 0,       /*< Fuses the sensor reads and sends the orientation */
+    LOOP_TASK_BATCHES,          /*< Sends the due sample batches */
+    LOOP_TASK_COMMANDS,         /*< Executes the received commands */
+    LOOP_TASK_STREAMS,          /*< Sends the scheduled output streams */
+    LOOP_TASK_WATCHDOG,         /*< Re-initializes the stuck sensors */
+#if ENABLE_HMC5883L_DRDY || !ENABLE_HMC5883L_PASSTHROUGH
+    LOOP_TASK_HMC5883L,         /*< Starts the HMC5883L measurements */
+#endif
+#if ENABLE_MPU6050_FIFO
+    LOOP_TASK_MPU6050_FIFO,     /*< Polls the MPU6050 FIFO */
+#endif
+    LOOP_TASK_COUNT             /*< The number of tasks */
+} loop_task_t;
+
+/**
+ * @brief The main loop task scheduler
+ */
+static task_scheduler_t loop_tasks;
+
+/**
+ * @brief Wakes the fusion steps for a published read
+ *
+ * Pends the fusion task with {@see IRQ_FUSION_PENDSV}; the main loop only runs the steps while batching then.
+ */
+STATIC_INLINE void FusionTask_Notify()
+{
+    Irq_PendFusion();
+    Tasks_Signal(&loop_tasks, LOOP_EVENT_SENSOR_READ);
+}
+
+/**
+ * @brief Reserves the queue slot for a sensor read
+ * @param[in] transaction The read transaction
+ * @param[in] queue The queue the sample is read into
+ * @param[in] timestamp The capture time in microseconds
+ * @return The slot, or NULL if the sample is lost
+ * 
+ * While the previous read is still on the bus, its slot stays reserved
+ * and the sample is skipped; the sequence gap tells the main loop.
+ */
+static uint8_t* sample_read_reserve(const i2casync_transaction_t *const transaction, sample_queue_t *const queue, const uint32_t timestamp)
+{
+    if (I2CAsync_Pending(transaction))
+    {
+        SampleQueue_Skip(queue);
+        return 0;
+    }
+    return SampleQueue_Reserve(queue, timestamp);
+}
+
+#if !ENABLE_MPU6050_FIFO
+
+/**
+ * @brief Starts the MPU6050 read into the next queue slot
+ * @param[in] timestamp The capture time in microseconds
+ */
+static void mpu6050_submit_read(const uint32_t timestamp)
+{
+    uint8_t *const slot = sample_read_reserve(&mpu6050_transaction, &mpu6050_queue, timestamp);
+    if (0 == slot) return;
+
+#if ENABLE_HMC5883L_PASSTHROUGH
+    HMC5883L_PreparePassThroughRead(&mpu6050_transaction, (hmc5883l_passthrough_block_t*)slot);
+#else
+    MPU6050_PrepareReadData(&mpu6050_primary, &mpu6050_transaction, (mpu6050_intdatareg_t*)slot);
+#endif
+    I2CAsync_Submit(&mpu6050_transaction);
+}
+
+#endif
+
+#if !ENABLE_HMC5883L_PASSTHROUGH
+
+/**
+ * @brief Starts the HMC5883L read into the next queue slot
+ * @param[in] timestamp The capture time in microseconds
+ */
+static void hmc5883l_submit_read(const uint32_t timestamp)
+{
+    uint8_t *const slot = sample_read_reserve(&hmc5883l_transaction, &hmc5883l_queue, timestamp);
+    if (0 == slot) return;
+
+    HMC5883L_PrepareReadData(&hmc5883l_transaction, (uint8_t (*)[HMC5883L_DATA_BLOCK_LENGTH])slot);
+    I2CAsync_Submit(&hmc5883l_transaction);
+}
+
+#endif
+
+/**
+ * @brief Completion callback of the MPU6050 read transaction
+ * @param[in] transaction The transaction
+ */
+static void mpu6050_read_complete(i2casync_transaction_t *const transaction)
+{
+    if (I2CASYNC_STATUS_DONE == transaction->status)
+    {
+        SampleQueue_Publish(&mpu6050_queue);
+        FusionTask_Notify();
+    }
+}
+
+/**
+ * @brief Completion callback of the HMC5883L read transaction
+ * @param[in] transaction The transaction
+ */
+static void hmc5883l_read_complete(i2casync_transaction_t *const transaction)
+{
+    if (I2CASYNC_STATUS_DONE == transaction->status)
+    {
+        SampleQueue_Publish(&hmc5883l_queue);
+        FusionTask_Notify();
+    }
+}
+
+#if ENABLE_MPU6050_FIFO
+
+/**
+ * @brief Completion callback of the MPU6050 FIFO count transaction
+ * @param[in] transaction The transaction
+ */
+static void mpu6050_fifo_count_complete(i2casync_transaction_t *const transaction)
+{
+    if (I2CASYNC_STATUS_DONE != transaction->status) return;
+
+    /* the frame alignment is lost after an overflow, so start over */
+    if (MPU6050_FifoOverflowed(&mpu6050_fifo_block))
+    {
+        ++mpu6050_fifo_overflows;
+        I2CAsync_Submit(&mpu6050_fifo_reset_transaction);
+        return;
+    }
+
+    /* the main loop still decodes the previous burst; the frames keep until the next poll */
+    if (SampleQueue_Full(&mpu6050_queue)) return;
+
+    const uint8_t frames = MPU6050_PrepareReadFifo(&mpu6050_primary, &mpu6050_fifo_read_transaction, &mpu6050_fifo_block);
+    if (0 == frames) return;
+
+    SampleQueue_Reserve(&mpu6050_queue, mpu6050_capture_time);
+    mpu6050_fifo_frames = frames;
+    I2CAsync_Submit(&mpu6050_fifo_read_transaction);
+}
+
+#endif
+
+#if ENABLE_MMA8451Q
+
+/**
+ * @brief Masks or unmasks the MMA8451Q interrupt pins
+ * @param[in] enabled Nonzero to interrupt while a pin is low, see {@see MMA8451Q_INT_IRQC}
+ *
+ * The pins stay low until the data is read, so they are masked while a read
+ * is on the way. An unmasked pin that is still low fires right away.
+ */
+static inline void mma8451q_set_interrupt(const uint8_t enabled)
+{
+    const uint32_t irqc = enabled ? PORT_PCR_IRQC(MMA8451Q_INT_IRQC) : 0;
+    BitFlag_Insert32(&MMA8451Q_INT_PORT->PCR[MMA8451Q_INT1_PIN], irqc, PORT_PCR_IRQC_SHIFT, 4);
+    BitFlag_Insert32(&MMA8451Q_INT_PORT->PCR[MMA8451Q_INT2_PIN], irqc, PORT_PCR_IRQC_SHIFT, 4);
+}
+
+/**
+ * @brief Completion callback of the MMA8451Q read transaction
+ * @param[in] transaction The transaction
+ *
+ * Unmasks the interrupt pins also after a failed read, which is then retried
+ * as long as the watermark or data ready condition holds.
+ */
+static void mma8451q_read_complete(i2casync_transaction_t *const transaction)
+{
+    if (I2CASYNC_STATUS_DONE == transaction->status)
+    {
+        SampleQueue_Publish(&mma8451q_queue);
+        FusionTask_Notify();
+    }
+    mma8451q_set_interrupt(1);
+}
+
+/**
+ * @brief Unmasks the MMA8451Q interrupt pins after a read that could not be started
+ *
+ * Called by the consumer; a read dropped on a full queue is retried once a slot was released.
+ */
+static void mma8451q_rearm()
+{
+    if (!I2CAsync_Pending(&mma8451q_transaction) && !SampleQueue_Full(&mma8451q_queue))
+    {
+        mma8451q_set_interrupt(1);
+    }
+}
+
+/**
+ * @brief Starts the MMA8451Q read into the next queue slot
+ * @param[in] timestamp The capture time in microseconds
+ *
+ * The interrupt pins stay masked until the read completes, see {@see mma8451q_set_interrupt}.
+ */
+static void mma8451q_submit_read(const uint32_t timestamp)
+{
+    mma8451q_set_interrupt(0);
+
+    uint8_t *const slot = sample_read_reserve(&mma8451q_transaction, &mma8451q_queue, timestamp);
+    if (0 == slot) return;
+
+#if ENABLE_MMA8451Q_FIFO
+    MMA8451Q_PrepareReadFifo(&mma8451q_transaction, (mma8451q_fifo_block_t*)slot, MMA8451Q_FIFO_WATERMARK);
+#else
+    MMA8451Q_PrepareReadAcceleration14bit(&mma8451q_transaction, (mma8451q_acc_t*)slot);
+#endif
+    I2CAsync_Submit(&mma8451q_transaction);
+}
+
+#endif
+
+/************************************************************************/
+/* Sensor drivers                                                       */
+/************************************************************************/
+
+/**
+ * @brief The most recently decoded sensor data
+ */
+static mpu6050_sensor_t accgyrotemp;
+static hmc5883l_data_t compass, previous_compass;
+
+/**
+ * @brief Incremented with every fresh {@see accgyrotemp} and {@see compass} sample, see {@see LoopTask_Streams}
+ */
+static uint16_t accgyrotemp_sequence = 0, compass_sequence = 0;
+#if ENABLE_MMA8451Q
+static mma8451q_acc_t acc;
+#endif
+
+#if !ENABLE_MPU6050_FIFO
+
+/**
+ * @brief The previously decoded MPU6050 data, see {@see mpu6050_repeated}
+ */
+static mpu6050_sensor_t previous_accgyrotemp;
+
+/**
+ * @brief Tests if an MPU6050 read repeats the previous one
+ * @param[in] previous The previous read
+ * @param[in] current The current read
+ * @return Nonzero if all seven registers are equal, which the sensor noise rules out for fresh data
+ */
+static uint8_t mpu6050_repeated(const mpu6050_sensor_t *const previous, const mpu6050_sensor_t *const current)
+{
+    for (uint_fast8_t i = 0; i < 7; ++i)
+    {
+        if (previous->data[i] != current->data[i]) return 0;
+    }
+    return 1;
+}
+
+#endif
+
+/**
+ * @brief Decodes a published MPU6050 block
+ * @param[in] entry The published block
+ * @param[inout] event The read
+ * @return Nonzero if the read is valid
+ */
+static uint8_t mpu6050_decode(const sample_entry_t *const entry, sensor_event_t *const event)
+{
+    PROFILE_BEGIN(PROFILE_MPU6050_READ);
+#if ENABLE_MPU6050_FIFO
+    /* the newest frame drives the single sample paths */
+    event->count = mpu6050_fifo_frames;
+    MPU6050_DecodeFifo((const mpu6050_fifo_block_t*)entry->data, event->count, mpu6050_fifo_samples);
+    accgyrotemp = mpu6050_fifo_samples[event->count - 1];
+#elif ENABLE_HMC5883L_PASSTHROUGH
+    HMC5883L_DecodePassThroughData((const hmc5883l_passthrough_block_t*)entry->data, &accgyrotemp, &compass);
+
+    /* the passed through registers repeat the last measurement at the MPU6050 rate */
+    if ((compass.x == previous_compass.x) && (compass.y == previous_compass.y) && (compass.z == previous_compass.z))
+    {
+        event->channels &= ~SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_MAGNETOMETER);
+    }
+    previous_compass = compass;
+#else
+    MPU6050_DecodeData((const mpu6050_intdatareg_t*)entry->data, &accgyrotemp);
+#endif
+#if !ENABLE_MPU6050_FIFO
+    /* repeated registers, including the temperature, mean the sensor stopped sampling */
+    if (mpu6050_repeated(&previous_accgyrotemp, &accgyrotemp))
+    {
+        event->channels &= ~(SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_ACCELEROMETER) | SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_GYROSCOPE));
+    }
+    previous_accgyrotemp = accgyrotemp;
+#endif
+    if (event->channels & (SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_ACCELEROMETER) | SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_GYROSCOPE))) ++accgyrotemp_sequence;
+#if ENABLE_HMC5883L_PASSTHROUGH
+    if (event->channels & SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_MAGNETOMETER)) ++compass_sequence;
+#endif
+    PROFILE_END(PROFILE_MPU6050_READ);
+    return 1;
+}
+
+/**
+ * @brief Prepares a decoded MPU6050 sample for fusion
+ * @param[in] channel The channel
+ * @param[in] index The sample index within the read
+ * @param[out] out The prepared sample
+ */
+static void mpu6050_prepare(const sensor_channel_t channel, const uint8_t index, v3d *const out)
+{
+#if ENABLE_MPU6050_FIFO
+    const mpu6050_sensor_t *const sample = &mpu6050_fifo_samples[index];
+#else
+    const mpu6050_sensor_t *const sample = &accgyrotemp;
+#endif
+
+    switch (channel)
+    {
+        case SENSOR_CHANNEL_ACCELEROMETER:
+            sensor_prepare_mpu6050_accelerometer_data(out, sample->accel.x, sample->accel.y, sample->accel.z);
+            break;
+        case SENSOR_CHANNEL_GYROSCOPE:
+            sensor_prepare_mpu6050_gyroscope_data(out, sample->gyro.x, sample->gyro.y, sample->gyro.z);
+            break;
+#if ENABLE_HMC5883L_PASSTHROUGH
+        case SENSOR_CHANNEL_MAGNETOMETER:
+            sensor_prepare_hmc5883l_data(out, compass.x, compass.y, compass.z);
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Re-initializes a stuck MPU6050 and restarts its reads
+ * 
+ * Covers the interrupt line that stops toggling, see {@see InitMPU6050}.
+ */
+static void mpu6050_recover()
+{
+    I2CAsync_Suspend();
+    InitMPU6050();
+    I2CAsync_Resume();
+#if !ENABLE_MPU6050_FIFO
+    /* the first read clears a latched interrupt */
+    mpu6050_submit_read(SysTick_Microseconds());
+#endif
+}
+
+/**
+ * @brief The MPU6050 driver; also provides the HMC5883L data in pass-through mode
+ */
+static const sensor_driver_t mpu6050_driver = {
+    .queue = &mpu6050_queue,
+#if ENABLE_MPU6050_FIFO
+    .submit = 0, /* chained by the FIFO count transaction */
+    .period = MPU6050_FIFO_SAMPLE_PERIOD_US,
+#else
+    .submit = mpu6050_submit_read,
+    .period = 0,
+#endif
+    .decode = mpu6050_decode,
+    .prepare = mpu6050_prepare,
+    .expected_period = mpu6050_get_period_us,
+    .recover = mpu6050_recover,
+#if ENABLE_HMC5883L_PASSTHROUGH
+    .channels = SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_ACCELEROMETER) | SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_GYROSCOPE) | SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_MAGNETOMETER),
+#else
+    .channels = SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_ACCELEROMETER) | SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_GYROSCOPE),
+#endif
+    .sinks = SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_ACCELEROMETER) | SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_GYROSCOPE) | SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_MAGNETOMETER),
+    .accelerometer = ACCELEROMETER_SOURCE_MPU6050,
+};
+
+#if ENABLE_MPU6050_SECONDARY
+
+/**
+ * @brief The queue, read transaction and register blocks of the second MPU6050
+ */
+static sample_queue_t mpu6050_secondary_queue;
+static i2casync_transaction_t mpu6050_secondary_transaction;
+static mpu6050_intdatareg_t mpu6050_secondary_blocks[MPU6050_QUEUE_LENGTH];
+
+/**
+ * @brief The most recently and the previously decoded data of the second MPU6050
+ */
+static mpu6050_sensor_t secondary_accgyrotemp, previous_secondary_accgyrotemp;
+
+/**
+ * @brief Starts the read of the second MPU6050 into the next queue slot
+ * @param[in] timestamp The capture time in microseconds
+ */
+static void mpu6050_secondary_submit_read(const uint32_t timestamp)
+{
+    uint8_t *const slot = sample_read_reserve(&mpu6050_secondary_transaction, &mpu6050_secondary_queue, timestamp);
+    if (0 == slot) return;
+
+    MPU6050_PrepareReadData(&mpu6050_secondary, &mpu6050_secondary_transaction, (mpu6050_intdatareg_t*)slot);
+    I2CAsync_Submit(&mpu6050_secondary_transaction);
+}
+
+/**
+ * @brief Completion callback of the read transaction of the second MPU6050
+ * @param[in] transaction The transaction
+ */
+static void mpu6050_secondary_read_complete(i2casync_transaction_t *const transaction)
+{
+    if (I2CASYNC_STATUS_DONE == transaction->status)
+    {
+        SampleQueue_Publish(&mpu6050_secondary_queue);
+        FusionTask_Notify();
+    }
+}
+
+/**
+ * @brief Decodes a published block of the second MPU6050
+ * @param[in] entry The published block
+ * @param[inout] event The read
+ * @return Nonzero if the read is valid
+ */
+static uint8_t mpu6050_secondary_decode(const sample_entry_t *const entry, sensor_event_t *const event)
+{
+    PROFILE_BEGIN(PROFILE_MPU6050_READ);
+    MPU6050_DecodeData((const mpu6050_intdatareg_t*)entry->data, &secondary_accgyrotemp);
+    if (mpu6050_repeated(&previous_secondary_accgyrotemp, &secondary_accgyrotemp))
+    {
+        event->channels &= ~(SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_ACCELEROMETER) | SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_GYROSCOPE));
+    }
+    previous_secondary_accgyrotemp = secondary_accgyrotemp;
+    PROFILE_END(PROFILE_MPU6050_READ);
+    return 1;
+}
+
+/**
+ * @brief Prepares a decoded sample of the second MPU6050 for averaging
+ * @param[in] channel The channel
+ * @param[in] index The sample index within the read
+ * @param[out] out The prepared sample
+ * 
+ * The replica is mounted in the frame of the first MPU6050 and shares its calibration.
+ */
+static void mpu6050_secondary_prepare(const sensor_channel_t channel, const uint8_t index, v3d *const out)
+{
+    const mpu6050_sensor_t *const sample = &secondary_accgyrotemp;
+    switch (channel)
+    {
+        case SENSOR_CHANNEL_ACCELEROMETER:
+            sensor_prepare_mpu6050_accelerometer_data(out, sample->accel.x, sample->accel.y, sample->accel.z);
+            break;
+        case SENSOR_CHANNEL_GYROSCOPE:
+            sensor_prepare_mpu6050_gyroscope_data(out, sample->gyro.x, sample->gyro.y, sample->gyro.z);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Re-initializes a stuck second MPU6050 and restarts its reads
+ */
+static void mpu6050_secondary_recover()
+{
+    I2CAsync_Suspend();
+    InitMPU6050Secondary();
+    I2CAsync_Resume();
+    mpu6050_secondary_submit_read(SysTick_Microseconds());
+}
+
+/**
+ * @brief The driver of the second MPU6050; a replica averaged into the first one, see {@see sensor_average}
+ */
+static const sensor_driver_t mpu6050_secondary_driver = {
+    .queue = &mpu6050_secondary_queue,
+    .submit = mpu6050_secondary_submit_read,
+    .period = 0,
+    .decode = mpu6050_secondary_decode,
+    .prepare = mpu6050_secondary_prepare,
+    .expected_period = mpu6050_get_period_us,
+    .recover = mpu6050_secondary_recover,
+    .channels = SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_ACCELEROMETER) | SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_GYROSCOPE),
+    .sinks = SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_ACCELEROMETER) | SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_GYROSCOPE),
+    .accelerometer = ACCELEROMETER_SOURCE_MPU6050,
+    .replica = 1,
+};
+
+#endif
+
+#if !ENABLE_HMC5883L_PASSTHROUGH
+
 /**
- * @brief Indicates that polling the MMA8451Q is required
+ * @brief Decodes a published HMC5883L block
+ * @param[in] entry The published block
+ * @param[inout] event The read
+ * @return Nonzero if the read is valid
  */
-static volatile uint8_t poll_mma8451q = 1;
+static uint8_t hmc5883l_decode(const sample_entry_t *const entry, sensor_event_t *const event)
+{
+    PROFILE_BEGIN(PROFILE_HMC5883L_READ);
+    HMC5883L_DecodeData((const uint8_t (*)[HMC5883L_DATA_BLOCK_LENGTH])entry->data, &compass);
+
+    /* a poll ahead of the next measurement returns the previous one */
+    if ((compass.x == previous_compass.x) && (compass.y == previous_compass.y) && (compass.z == previous_compass.z))
+    {
+        event->channels &= ~SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_MAGNETOMETER);
+    }
+    previous_compass = compass;
+    if (event->channels & SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_MAGNETOMETER)) ++compass_sequence;
+    PROFILE_END(PROFILE_HMC5883L_READ);
+    return 1;
+}
+
+/**
+ * @brief Prepares a decoded HMC5883L sample for fusion
+ * @param[in] channel The channel
+ * @param[in] index The sample index within the read
+ * @param[out] out The prepared sample
+ */
+static void hmc5883l_prepare(const sensor_channel_t channel, const uint8_t index, v3d *const out)
+{
+    sensor_prepare_hmc5883l_data(out, compass.x, compass.y, compass.z);
+}
+
+/**
+ * @brief Gets the HMC5883L read period
+ * @return The period in microseconds
+ */
+static uint32_t hmc5883l_expected_period()
+{
+    return hmc5883l_get_period() * 1000u;
+}
+
+/**
+ * @brief Re-initializes an HMC5883L whose measurements stopped updating
+ * 
+ * The polled or triggered reads continue by themselves.
+ */
+static void hmc5883l_recover()
+{
+    I2CAsync_Suspend();
+    InitHMC5883L();
+    I2CAsync_Resume();
+}
+
+/**
+ * @brief The HMC5883L driver
+ */
+static const sensor_driver_t hmc5883l_driver = {
+    .queue = &hmc5883l_queue,
+    .submit = hmc5883l_submit_read,
+    .decode = hmc5883l_decode,
+    .prepare = hmc5883l_prepare,
+    .expected_period = hmc5883l_expected_period,
+    .recover = hmc5883l_recover,
+    .period = 0,
+    .channels = SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_MAGNETOMETER),
+    .sinks = SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_MAGNETOMETER),
+};
+
+#endif
+
+#if ENABLE_MMA8451Q
+
+/**
+ * @brief Decodes a published MMA8451Q block
+ * @param[in] entry The published block
+ * @param[inout] event The read
+ * @return Nonzero if the read is valid
+ */
+static uint8_t mma8451q_decode(const sample_entry_t *const entry, sensor_event_t *const event)
+{
+    PROFILE_BEGIN(PROFILE_MMA8451Q_READ);
+#if ENABLE_MMA8451Q_FIFO
+    const mma8451q_fifo_block_t *const block = (const mma8451q_fifo_block_t*)entry->data;
+    event->count = MMA8451Q_DecodeFifo(block, MMA8451Q_FIFO_WATERMARK, mma8451q_fifo_samples);
+    if (MMA8451Q_F_STATUS_OVF(block->status))
+    {
+        ++mma8451q_fifo_overflows;
+    }
+
+    /* the newest sample is the current acceleration */
+    if (event->count > 0)
+    {
+        acc = mma8451q_fifo_samples[event->count - 1];
+    }
+#else
+    MMA8451Q_DecodeAcceleration14bit((const mma8451q_acc_t*)entry->data, &acc);
+#endif
+    PROFILE_END(PROFILE_MMA8451Q_READ);
+    return 1;
+}
+
+/**
+ * @brief Prepares a decoded MMA8451Q sample for fusion
+ * @param[in] channel The channel
+ * @param[in] index The sample index within the read
+ * @param[out] out The prepared sample in the MPU6050 frame
+ */
+static void mma8451q_prepare(const sensor_channel_t channel, const uint8_t index, v3d *const out)
+{
+#if ENABLE_MMA8451Q_FIFO
+    const mma8451q_acc_t *const sample = &mma8451q_fifo_samples[index];
+#else
+    const mma8451q_acc_t *const sample = &acc;
+#endif
+    sensor_prepare_mma8451q_accelerometer_data(out, sample->x, sample->y, sample->z);
+}
+
+/**
+ * @brief Resets and re-initializes a stuck MMA8451Q and restarts its reads
+ */
+static void mma8451q_recover()
+{
+    I2CAsync_Suspend();
+    ResetMMA8451Q();
+    InitMMA8451Q();
+    I2CAsync_Resume();
+    mma8451q_submit_read(SysTick_Microseconds());
+}
+
+/**
+ * @brief The MMA8451Q driver; merged with the MPU6050 accelerometer
+ */
+static const sensor_driver_t mma8451q_driver = {
+    .queue = &mma8451q_queue,
+    .submit = mma8451q_submit_read,
+    .decode = mma8451q_decode,
+    .prepare = mma8451q_prepare,
+    .expected_period = mma8451q_get_period_us,
+    .recover = mma8451q_recover,
+#if ENABLE_MMA8451Q_FIFO
+    .period = MMA8451Q_FIFO_SAMPLE_PERIOD_US,
+#else
+    .period = 0,
+#endif
+    .channels = SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_ACCELEROMETER),
+    .sinks = SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_ACCELEROMETER),
+    .accelerometer = ACCELEROMETER_SOURCE_MMA8451Q,
+};
+
+#endif
+
+/**
+ * @brief The pipeline draining the sensor queues in capture time order
+ */
+static sensor_pipeline_t sensor_pipeline;
+
+#define SENSOR_WATCHDOG_PERIOD_MS	(10)	/*< Period of the sensor watchdog checks; the timeouts are tens of milliseconds, see SENSOR_HEALTH_TIMEOUT_SLACK_US */
+
+/**
+ * @brief Returns the smaller of two values
+ */
+static inline uint32_t min_u32(const uint32_t a, const uint32_t b)
+{
+    return (a < b) ? a : b;
+}
+
+/*!
+*  \brief The output streams
+*/
+typedef enum {
+    STREAM_ORIENTATION = 0,     //!< Fused orientation according to the output mode; stream 0 by command convention
+    STREAM_SENSORS = 1,         //!< Raw MPU6050 (frame type 0x02) and HMC5883L (frame type 0x03) data, each only if new
+    STREAM_LINK_STATUS = 2,     //!< Link status and health telemetry
+    STREAM_COUNT                //!< The number of streams
+} output_stream_id_t;
+
+#if UART_PROFILE_IRQ
+#define LINK_STATUS_UART_BUDGET     (P2PPE_MAX_LENGTH(1 + 8*4))
+#else
+#define LINK_STATUS_UART_BUDGET     (0)
+#endif
+
+#if PROFILE_ENABLED
+#define LINK_STATUS_SECTION_BUDGET  (P2PPE_MAX_LENGTH(3 + 4*4 + PROFILE_HISTOGRAM_BUCKETS*2))
+#else
+#define LINK_STATUS_SECTION_BUDGET  (0)
+#endif
+
+#if IRQ_PROFILE_ENABLED
+#define LINK_STATUS_IRQ_BUDGET      (P2PPE_MAX_LENGTH(1 + (1 + IRQ_SOURCE_COUNT*3)*4))
+#else
+#define LINK_STATUS_IRQ_BUDGET      (0)
+#endif
+
+#define LINK_STATUS_BUDGET   (P2PPE_MAX_LENGTH(1 + 5*4) + LINK_STATUS_UART_BUDGET + LINK_STATUS_SECTION_BUDGET + LINK_STATUS_IRQ_BUDGET)
+
+/*!
+*  \brief The output stream configuration: period in ms, priority (lower is more important) and byte budget per transmission
+*/
+static output_stream_t output_streams[STREAM_COUNT] = {
+    [STREAM_ORIENTATION] = { .period = 10, .priority = 0, .budget = P2PPE_MAX_LENGTH(1 + 7*4) },
+    [STREAM_SENSORS] = { .period = 100, .priority = 2, .budget = P2PPE_MAX_LENGTH(1 + 7*2) + P2PPE_MAX_LENGTH(1 + 3*2) },
+    [STREAM_LINK_STATUS] = { .period = 1000, .priority = 1, .budget = LINK_STATUS_BUDGET },
+};
+
+/*!
+*  \brief The output stream scheduler
+*/
+static output_scheduler_t output_scheduler;
+
+/************************************************************************/
+/* Bring-up timing                                                      */
+/************************************************************************/
+
+#define BOOT_FLAG_FAST_BOOT         (0x01)  /*! The firmware was built with {@see ENABLE_FAST_BOOT} */
+#define BOOT_FLAG_PARAMETERS_STORED (0x02)  /*! The parameters were loaded from flash instead of the defaults */
+
+/*!
+*  \brief Bring-up milestones in microseconds since the SysTick start, sent once as {@see BOOT_REPORT_TYPE}
+*
+*  Replaces the diagnostic strings in fast boot mode; the time before the PLL is locked is not included.
+*/
+typedef struct {
+    uint32_t parametersLoaded;      //!< The parameter block is loaded
+    uint32_t sensorsConfigured;     //!< All sensors are configured
+    uint32_t loopEntered;           //!< The main loop is entered
+    uint32_t firstSample;           //!< The first MPU6050 sample was captured
+    uint32_t firstQuaternion;       //!< The first fusion step after both an accelerometer and a magnetometer correction completed
+    uint8_t flags;                  //!< Combination of BOOT_FLAG_FAST_BOOT and BOOT_FLAG_PARAMETERS_STORED
+    uint8_t reserved[3];            //!< Padding
+} boot_report_t;
+
+/*!
+*  \brief The bring-up milestones
+*/
+static boot_report_t bootReport = { .flags = ENABLE_FAST_BOOT ? BOOT_FLAG_FAST_BOOT : 0 };
+
+/*!
+*  \brief The runtime settings, modified through the command channel
+*/
+static command_settings_t settings = {
+    .outputMode = QUATERNION_RPY,
+    .scheduler = &output_scheduler,
+    .hmc5883lPeriod = 1000 / 75, /* at 75Hz, data come every (1000/75Hz) ms. */
+    .accelerometerDecimation = 1,
+};
+
+/*!
+*  \brief Determines the orientation stream byte budget for an output mode
+*  \param[in] mode The output mode
+*  \return The worst case number of bytes on the wire per transmission
+*/
+static uint16_t orientation_budget(output_mode_t mode)
+{
+    switch (mode)
+    {
+        case RPY:                   return P2PPE_MAX_LENGTH(1 + 3*4);
+        case QUATERNION:            return P2PPE_MAX_LENGTH(1 + 4*4);
+        case PIPELINE_HEALTH:       return P2PPE_MAX_LENGTH(1 + 4*4);
+        case QUATERNION_RPY:        return P2PPE_MAX_LENGTH(1 + 7*4);
+        case SENSORS_RAW:           return P2PPE_MAX_LENGTH(1 + 6*4);
+        case QUATERNION_Q14:        return P2PPE_MAX_LENGTH(1 + 4*2);
+        case QUATERNION_RPY_Q14:    return P2PPE_MAX_LENGTH(1 + 7*2);
+        case QUATERNION_SMALLEST3:  return P2PPE_MAX_LENGTH(1 + 3*2);
+        default:                    return 0; /* batched modes are not sent through the stream */
+    }
+}
+
+#if DATA_FUSE_MODE
+
+#define FUSION_MAX_DELTA_US             (500000) /*! Upper bound of the fusion time differences in microseconds */
+#define FUSION_GYRO_TIMEOUT_US          (100000) /*! Time without gyroscope data after which {@see FUSION_GYRO_FALLBACK} takes over */
+
+/*!
+*  \brief Converts a capture time difference into the fusion time difference
+*  \param[in] microseconds The time difference in microseconds
+*  \return The time difference in seconds, bounded by {\ref FUSION_MAX_DELTA_US}
+*/
+static fix16_t fusion_delta(uint32_t microseconds)
+{
+    if (microseconds > FUSION_MAX_DELTA_US)
+    {
+        microseconds = FUSION_MAX_DELTA_US;
+    }
+
+    /* 4295/65536 approximates 65536/1000000 without a division */
+    return (fix16_t)((microseconds * 4295u) >> 16);
+}
+
+#define QUATERNION_BATCH_CAPACITY       (6)     /*! Number of quaternion samples per batch frame */
+#define QUATERNION_BATCH_DEADLINE_MS    (100)   /*! Maximum age of a batched sample before the batch is sent */
+
+/*!
+*  \brief The quaternion batch for {\ref QUATERNION_BATCH} output mode
+*/
+static batch_t quaternion_batch;
+
+#define TIMESTAMPED_BATCH_CAPACITY      (6)     /*! Number of timestamped quaternion samples per batch frame */
+
+/*!
+*  \brief A fused quaternion for {\ref QUATERNION_TIMESTAMPED} output mode
+*/
+typedef struct __attribute__ ((__packed__))
+{
+    uint32_t timestamp;     //!< Capture time of the newest fused gyroscope sample in microseconds, see {\ref SysTick_Microseconds}
+    fix16_t quaternion[4];  //!< The orientation quaternion a, b, c, d
+} timestamped_quaternion_t;
+
+/*!
+*  \brief The quaternion batch for {\ref QUATERNION_TIMESTAMPED} output mode
+*/
+static batch_t timestamped_quaternion_batch;
+
+#endif // DATA_FUSE_MODE
+
+#define RAW_CAPTURE_MPU6050_TYPE        (RAW_CAPTURE)   /*! Frame type of the MPU6050 raw capture batches */
+#define RAW_CAPTURE_HMC5883L_TYPE       (50)    /*! Frame type of the HMC5883L raw capture batches */
+#define RAW_CAPTURE_MPU6050_CAPACITY    (6)     /*! Number of MPU6050 samples per capture batch frame */
+#define RAW_CAPTURE_HMC5883L_CAPACITY   (8)     /*! Number of HMC5883L samples per capture batch frame */
+#define RAW_CAPTURE_DEADLINE_MS         (50)    /*! Maximum age of a captured sample before the batch is sent */
+
+/*!
+*  \brief A timestamped raw MPU6050 sample for {\ref RAW_CAPTURE} output mode
+*/
+typedef struct __attribute__ ((__packed__))
+{
+    uint32_t timestamp;     //!< Capture time in microseconds, see {\ref SysTick_Microseconds}
+    int16_t data[7];        //!< The raw accelerometer, gyroscope and temperature data in {\ref mpu6050_sensor_t} order
+} mpu6050_capture_t;
+
+/*!
+*  \brief A timestamped raw HMC5883L sample for {\ref RAW_CAPTURE} output mode
+*/
+typedef struct __attribute__ ((__packed__))
+{
+    uint32_t timestamp;     //!< Capture time in microseconds, see {\ref SysTick_Microseconds}
+    uint16_t xyz[3];        //!< The raw magnetometer data in {\ref hmc5883l_data_t} order
+} hmc5883l_capture_t;
+
+/*!
+*  \brief The capture batches for {\ref RAW_CAPTURE} output mode
+*/
+static batch_t mpu6050_capture_batch, hmc5883l_capture_batch;
+
+/************************************************************************/
+/* Interrupt handlers                                                   */
+/************************************************************************/
+
+/**
+ * @brief Handler for interrupts on port A
+ */
+RAMFUNC
+void PORTA_Handler()
+{
+    IRQ_PROFILE_ENTER();
+
+#if ENABLE_MMA8451Q	
+    register uint32_t isfr_mma = MMA8451Q_INT_PORT->ISFR;
+
+	/* check MMA8451Q */
+    register uint32_t fromMMA8451Q 	= (isfr_mma & ((1 << MMA8451Q_INT1_PIN) | (1 << MMA8451Q_INT2_PIN)));
+	if (fromMMA8451Q)
+	{
+		/* in FIFO mode this is the watermark; the transaction pops the whole batch and the pins are masked until then */
+		mma8451q_submit_read(SysTick_Microseconds());
+		LED_RedOn();
+		
+		/* acknowledge only these pins (w1c); an OR would write back the other pending pins as well */
+		BitFlag_Acknowledge32(&MMA8451Q_INT_PORT->ISFR, (1 << MMA8451Q_INT1_PIN) | (1 << MMA8451Q_INT2_PIN));
+	}
+#endif
+	
+#if !ENABLE_MPU6050_FIFO
+	/* check MPU6050 */
+    register uint32_t isfr_mpu = MPU6050_INT_PORT->ISFR;
+    register uint32_t fromMPU6050 = (isfr_mpu & (1 << MPU6050_INT_PIN));
+	if (fromMPU6050)
+	{
+		/* start the read right away; if the previous one is still pending, this sample is skipped */
+		mpu6050_submit_read(SysTick_Microseconds());
+		LED_BlueOn();
+		
+		/* acknowledge only this pin (w1c) */
+		BitFlag_Acknowledge32(&MPU6050_INT_PORT->ISFR, (1 << MPU6050_INT_PIN));
+	}
+#endif
+
+#if ENABLE_MPU6050_SECONDARY
+	/* check the second MPU6050 */
+    register uint32_t isfr_secondary = MPU6050_SECONDARY_INT_PORT->ISFR;
+	if (isfr_secondary & (1 << MPU6050_SECONDARY_INT_PIN))
+	{
+		mpu6050_secondary_submit_read(SysTick_Microseconds());
+		
+		/* acknowledge only this pin (w1c) */
+		BitFlag_Acknowledge32(&MPU6050_SECONDARY_INT_PORT->ISFR, (1 << MPU6050_SECONDARY_INT_PIN));
+	}
+#endif
+	
+#if ENABLE_HMC5883L_DRDY
+	/* check HMC5883L */
+    register uint32_t isfr_hmc = HMC5883L_DRDY_PORT->ISFR;
+    register uint32_t fromHMC5883L = (isfr_hmc & (1 << HMC5883L_DRDY_PIN));
+	if (fromHMC5883L)
+	{
+		/* the measurement is complete; read it right away */
+		hmc5883l_submit_read(SysTick_Microseconds());
+		
+		/* acknowledge only this pin (w1c) */
+		BitFlag_Acknowledge32(&HMC5883L_DRDY_PORT->ISFR, (1 << HMC5883L_DRDY_PIN));
+	}
+#endif
+
+    IRQ_PROFILE_EXIT(IRQ_SOURCE_SENSOR);
+}
+
+/************************************************************************/
+/* I2C arbiter configuration                                            */
+/************************************************************************/
+
+void InitI2CArbiter()
+{
+    /* prior to configuring the I2C arbiter, enable the clocks required for
+    * the used pins
+    */
+    BitFlag_Set32(&SIM->SCGC5, SIM_SCGC5_PORTB_MASK | SIM_SCGC5_PORTE_MASK);
+
+    /* configure I2C arbiter
+    * The arbiter takes care of pin selection
+    */
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[0], MMA8451Q_I2CADDR, I2C0, PORTE, 24, 5, 25, 5, I2C_SPEED_FAST);
+#if ENABLE_I2C1_EXTERNAL_BUS
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[1], MPU6050_I2CADDR, I2C1, PORTE, 1, 6, 0, 6, I2C_SPEED_FAST);
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[2], HMC5883L_I2CADDR, I2C1, PORTE, 1, 6, 0, 6, I2C_SPEED_FAST);
+#else
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[1], MPU6050_I2CADDR, I2C0, PORTB, 0, 2, 1, 2, I2C_SPEED_FAST);
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[2], HMC5883L_I2CADDR, I2C0, PORTB, 0, 2, 1, 2, I2C_SPEED_FAST);
+#endif
+#if ENABLE_MPU6050_SECONDARY
+    /* the second MPU6050 shares the pins of the first one */
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[3], MPU6050_I2CADDR_ALT, i2carbiter_entries[1].bus, i2carbiter_entries[1].port,
+        i2carbiter_entries[1].sclPin, i2carbiter_entries[1].sclMux, i2carbiter_entries[1].sdaPin, i2carbiter_entries[1].sdaMux, I2C_SPEED_FAST);
+#endif
+    I2CArbiter_Configure(i2carbiter_entries, I2CARBITER_COUNT);
+}
+
+/************************************************************************/
+/* Signaling of fusion process                                          */
+/************************************************************************/
+
+#if DATA_FUSE_MODE
+
+/**
+* @brief Sets up the GPIOs for fusion signaling
+*/
+void FusionSignal_Init()
+{
+    /* Set system clock gating to enable gate to port B */
+    BitFlag_Set32(&SIM->SCGC5, SIM_SCGC5_PORTB_MASK);
+
+    /* Set Port B, pin 8 and 9 to GPIO mode */
+    PORTB->PCR[8] = PORT_PCR_MUX(1); /* not using |= assignment here due to some of the flags being undefined at reset */
+    PORTB->PCR[9] = PORT_PCR_MUX(1);
+
+    /* Data direction for port B, pin 8 and 9  to output */
+    BitFlag_Set32(&BITFLAG_GPIO(GPIOB)->PDDR, GPIO_PDDR_PDD(1 << 8) | GPIO_PDDR_PDD(1 << 9));
+}
+
+/**
+* @brief Sets the fusion predict signal
+*/
+STATIC_INLINE void FusionSignal_Predict()
+{
+    GPIOB->PSOR = 1 << 8;
+    GPIOB->PCOR = 1 << 9;
+}
+
+/**
+* @brief Clears the fusion update signal
+*/
+STATIC_INLINE void FusionSignal_Update()
+{
+    GPIOB->PCOR = 1 << 8;
+    GPIOB->PSOR = 1 << 9;
+}
+
+/**
+* @brief Clears the fusion signal
+*/
+STATIC_INLINE void FusionSignal_Clear()
+{
+    GPIOB->PCOR = (1 << 8) | (1 << 9);
+}
+
+#define PIPELINE_HEALTH_BUCKETS     (10)    /*! Histogram buckets; bucket 0 counts below 64 us, bucket k [2^(k+5), 2^(k+6)) us, the last one open ended */
+
+/*!
+*  \brief The pipeline health histograms
+*/
+typedef enum {
+    HEALTH_SENSOR_TO_FUSION = 0,    //!< MPU6050 capture to fusion complete
+    HEALTH_FUSION_TO_WIRE = 1,      //!< Fusion complete to the first byte of the orientation frame on the wire
+    HEALTH_LOOP_JITTER = 2,         //!< Absolute change of the fusion step period
+    HEALTH_MPU6050_INTERVAL = 3,    //!< MPU6050 sample (or FIFO burst) interval
+    HEALTH_HMC5883L_INTERVAL = 4,   //!< HMC5883L sample interval
+    HEALTH_HISTOGRAM_COUNT          //!< The number of histograms
+} pipeline_health_histogram_t;
+
+/*!
+*  \brief The pipeline health accumulated between two health frames; the frame payload of {\ref PIPELINE_HEALTH}
+*/
+typedef struct {
+    uint32_t interval;                  //!< The accumulation time in microseconds, set when sent
+    uint16_t fusionSteps;               //!< The number of fusion steps
+    uint16_t mpu6050Samples;            //!< The number of MPU6050 samples
+    uint16_t hmc5883lSamples;           //!< The number of HMC5883L samples
+    uint16_t histogram[HEALTH_HISTOGRAM_COUNT][PIPELINE_HEALTH_BUCKETS]; //!< Saturating log2 histograms in microseconds
+    uint16_t sensorCount;               //!< The number of valid sensor reports, in driver registration order
+    sensor_health_report_t sensors[SENSOR_PIPELINE_MAX_DRIVERS]; //!< The rate, staleness and watchdog counts per sensor
+    fusion_overflow_report_t fusion;    //!< The fixed-point overflows per fusion stage and the filter resets
+    uint16_t staleSteps;                //!< The fusion steps without gyroscope and accelerometer data, i.e. with a frozen attitude
+} pipeline_health_t;
+
+/*!
+*  \brief The pipeline health since the last health frame
+*/
+static pipeline_health_t pipelineHealth;
+
+#define PIPELINE_HEALTH_BUDGET      (P2PPE_MAX_LENGTH(1 + sizeof(pipeline_health_t)))
+
+/*!
+*  \brief Accumulates a duration into a health histogram
+*  \param[in] histogram The histogram
+*  \param[in] microseconds The duration
+*/
+static void PipelineHealth_Record(const pipeline_health_histogram_t histogram, uint32_t microseconds)
+{
+    /* floor(log2) by bisection; the M0+ has no CLZ instruction */
+    uint_fast8_t bucket = 0;
+    microseconds >>= 5;
+    if (microseconds >> 16) { microseconds >>= 16; bucket += 16; }
+    if (microseconds >> 8)  { microseconds >>= 8;  bucket += 8; }
+    if (microseconds >> 4)  { microseconds >>= 4;  bucket += 4; }
+    if (microseconds >> 2)  { microseconds >>= 2;  bucket += 2; }
+    if (microseconds >> 1)  { bucket += 1; }
+    if (bucket >= PIPELINE_HEALTH_BUCKETS) bucket = PIPELINE_HEALTH_BUCKETS - 1;
+
+    uint16_t *const count = &pipelineHealth.histogram[histogram][bucket];
+    if (*count != UINT16_MAX) ++*count;
+}
+
+/*!
+*  \brief Increments a saturating health counter
+*  \param[in,out] counter The counter
+*  \param[in] increment The increment
+*/
+STATIC_INLINE void PipelineHealth_Count(uint16_t *const counter, const uint_fast16_t increment)
+{
+    const uint32_t sum = (uint32_t)*counter + increment;
+    *counter = (sum > UINT16_MAX) ? UINT16_MAX : (uint16_t)sum;
+}
+
+#endif // #if DATA_FUSE_MODE
+
+/************************************************************************/
+/* Fusion task                                                          */
+/************************************************************************/
+
+#if IRQ_FUSION_PENDSV && DATA_FETCH_MODE
+#error The raw sensor frames are sent from the fusion task, which must not write to the UART
+#endif
+
+#if DATA_FUSE_MODE
+
+/* capture times of the last prediction and corrections; each path has its own time difference */
+static uint32_t last_predict_time;
+static uint32_t last_accelerometer_time;
+static uint32_t last_magnetometer_time;
+#if FUSION_GYRO_FALLBACK
+static uint32_t last_gyro_time;
+#endif
+
+/* the most recently prepared sample per channel */
+static v3d prepared[SENSOR_CHANNEL_COUNT];
+
+/* number of predicted samples since the last accelerometer correction */
+static uint_fast16_t accelerometer_predictions = 0;
+
+/* the corrections applied so far, bit 0 accelerometer, bit 1 magnetometer; see boot_report_t */
+static uint_fast8_t boot_corrections = 0;
+
+/* fusion step timing, see PIPELINE_HEALTH */
+static uint32_t fusion_complete_time;
+static uint32_t last_fusion_period = 0;
+
+/**
+* @brief The fusion state after a step, from which the outputs are derived
+*/
+typedef struct {
+    qf16 orientation;           /*< The orientation quaternion */
+    fix16_t roll;               /*< The roll angle, only in the output modes sending the angles */
+    fix16_t pitch;              /*< The pitch angle, see roll */
+    fix16_t yaw;                /*< The yaw angle, see roll */
+    v3d accelerometer;          /*< The prepared accelerometer sample */
+    v3d magnetometer;           /*< The prepared magnetometer sample */
+    uint32_t timestamp;         /*< The capture time of the last prediction in microseconds */
+    uint32_t completeTime;      /*< The {@see SysTick_Microseconds} time the step completed */
+    uint32_t systemTime;        /*< The system time of the step in milliseconds */
+} fusion_snapshot_t;
+
+/**
+* @brief The latest two snapshots; the newest one is at the count of published snapshots, modulo two
+*/
+static fusion_snapshot_t fusionSnapshots[2];
+
+/**
+* @brief The number of snapshots published so far
+*/
+static volatile uint32_t fusionSnapshotCount = 0;
+
+/**
+* @brief Publishes the fusion state after a step
+* @param[in] current_time The system time of the step in milliseconds
+* @param[in] complete_time The {@see SysTick_Microseconds} time the step completed
+*
+* Writes the slot behind the newest snapshot and only then advances the count,
+* so the newest snapshot is never written while it may be read.
+*/
+static void FusionSnapshot_Publish(const uint32_t current_time, const uint32_t complete_time)
+{
+    fusion_snapshot_t *const snapshot = &fusionSnapshots[(fusionSnapshotCount + 1) & 1];
+    fusion_fetch_quaternion(&snapshot->orientation);
+
+    /* the angles are costly; right after switching to a mode sending them, they may be one step old */
+    const output_mode_t mode = settings.outputMode;
+    if (RPY == mode || QUATERNION_RPY == mode || QUATERNION_RPY_Q14 == mode)
+    {
+        fusion_fetch_angles(&snapshot->roll, &snapshot->pitch, &snapshot->yaw);
+    }
+
+    snapshot->accelerometer = prepared[SENSOR_CHANNEL_ACCELEROMETER];
+    snapshot->magnetometer = prepared[SENSOR_CHANNEL_MAGNETOMETER];
+    snapshot->timestamp = last_predict_time;
+    snapshot->completeTime = complete_time;
+    snapshot->systemTime = current_time;
+
+    __DMB();
+    ++fusionSnapshotCount;
+    Tasks_Signal(&loop_tasks, LOOP_EVENT_SNAPSHOT);
+}
+
+/**
+* @brief Copies the newest snapshot
+* @param[out] snapshot The copy
+* @return The number of snapshots published up to the copied one
+*
+* Only two publications during the copy overwrite the slot being read; the copy is repeated then.
+*/
+static uint32_t FusionSnapshot_Fetch(fusion_snapshot_t *const snapshot)
+{
+    uint32_t count;
+    do
+    {
+        count = fusionSnapshotCount;
+        __DMB();
+        *snapshot = fusionSnapshots[count & 1];
+        __DMB();
+    } while ((fusionSnapshotCount - count) >= 2);
+    return count;
+}
+
+#endif // DATA_FUSE_MODE
+
+/**
+* @brief Decodes the oldest sensor read and fuses it
+* @param[in] sending Nonzero if the step may write to the UART, i.e. runs in the main loop
+* @return Nonzero if a read was decoded
+*/
+static int FusionTask_Step(const bool sending)
+{
+    /************************************************************************/
+    /* Decode the oldest sensor read                                        */
+    /************************************************************************/
+
+    /* one read per step, in capture time order over all sensors */
+    sensor_event_t event;
+	const int eventsProcessed = SensorPipeline_Next(&sensor_pipeline, &event);
+
+    const int readMPU = eventsProcessed && (&mpu6050_driver == event.driver);
+    const int readHMC = eventsProcessed && (0 != (event.channels & SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_MAGNETOMETER)));
+#if ENABLE_MMA8451Q
+    const int readMMA = eventsProcessed && (&mma8451q_driver == event.driver);
+
+    /* a read dropped on a full queue left the interrupt pins masked */
+    mma8451q_rearm();
+#endif
+
+    /* replicas only refine the primary's next sample, so they do not step the fusion */
+    const int readReplica = eventsProcessed && (0 != event.driver->replica);
+
+    /* freshness per fused channel; every published block is a new data ready event */
+    const uint_fast8_t fresh_channels = (eventsProcessed && !readReplica) ? (event.channels & event.driver->sinks) : 0;
+    const uint_fast8_t have_gyro_data = 0 != (fresh_channels & SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_GYROSCOPE));
+    const uint_fast8_t have_acc_data = 0 != (fresh_channels & SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_ACCELEROMETER));
+    const uint_fast8_t have_mag_data = 0 != (fresh_channels & SENSOR_CHANNEL_MASK(SENSOR_CHANNEL_MAGNETOMETER));
+
+    /* the MPU6050 samples of this iteration; more than one in FIFO mode */
+#if ENABLE_MPU6050_FIFO
+    const mpu6050_sensor_t *const mpu6050_samples = mpu6050_fifo_samples;
+#else
+    const mpu6050_sensor_t *const mpu6050_samples = &accgyrotemp;
+#endif
+    const uint_fast8_t mpu6050_sample_count = readMPU ? event.count : 0;
+
+    if (readMPU)
+    {
+        LED_BlueOff();
+    }
+#if ENABLE_MMA8451Q
+    if (readMMA)
+    {
+        LED_RedOff();
+    }
+#endif
+	
+    /************************************************************************/
+    /* Raw sensor data output over serial                                   */
+    /************************************************************************/
+
+#if DATA_FETCH_MODE
+
+	/* data availability + sanity check 
+	 * This sent me on a long bug hunt: Sometimes the interrupt would be raised
+	 * even if not all data registers were written. This always resulted in a
+	 * z data register not being fully written which, in turn, resulted in
+	 * extremely jumpy measurements. 
+	 */
+	if (readMPU && accgyrotemp.status != 0)
+	{
+		/* write data */
+		uint8_t type = 0x02;
+		IO_SendFramePrefixed(&type, 1, (uint8_t*)accgyrotemp.data, sizeof(accgyrotemp.data));
+	}
+	
+	/* data availability + sanity check */
+	if (readHMC && (compass.status & HMC5883L_SR_RDY_MASK) != 0) /* TODO: check if not in lock state */
+	{
+		uint8_t type = 0x03;
+		IO_SendFramePrefixed(&type, 1, (uint8_t*)compass.xyz, sizeof(compass.xyz));
+	}
+	
+#if ENABLE_MMA8451Q
+	/* data availability + sanity check */
+	if (readMMA && acc.status != 0) 
+	{
+		uint8_t type = 0x01;
+#if ENABLE_MMA8451Q_FIFO
+		for (uint_fast8_t i = 0; i < event.count; ++i)
+		{
+			IO_SendFramePrefixed(&type, 1, (uint8_t*)mma8451q_fifo_samples[i].xyz, sizeof(mma8451q_fifo_samples[i].xyz));
+		}
+#else
+		IO_SendFramePrefixed(&type, 1, (uint8_t*)acc.xyz, sizeof(acc.xyz));
+#endif
+	}
+#endif
+	
+#endif // DATA_FETCH_MODE
+
+    /************************************************************************/
+    /* Timestamped raw capture output over serial                           */
+    /************************************************************************/
+
+    if (sending && (RAW_CAPTURE == settings.outputMode))
+    {
+        /* every fresh sample goes into the batch, see DATA_FETCH_MODE for the sanity checks */
+        if (readMPU && accgyrotemp.status != 0 && (have_acc_data || have_gyro_data))
+        {
+            /* FIFO frames are back-dated from the newest one */
+            for (uint_fast8_t frame = 0; frame < mpu6050_sample_count; ++frame)
+            {
+                mpu6050_capture_t sample;
+                sample.timestamp = SensorPipeline_SampleTime(&event, frame);
+                for (int i = 0; i < 7; ++i) sample.data[i] = mpu6050_samples[frame].data[i];
+
+                if (Batch_Append(&mpu6050_capture_batch, &sample, systemTime()))
+                {
+                    Batch_Flush(&mpu6050_capture_batch);
+                }
+            }
+        }
+
+        if (readHMC && (compass.status & HMC5883L_SR_RDY_MASK) != 0 && have_mag_data)
+        {
+            hmc5883l_capture_t sample;
+            sample.timestamp = event.timestamp;
+            for (int i = 0; i < 3; ++i) sample.xyz[i] = compass.xyz[i];
+
+            if (Batch_Append(&hmc5883l_capture_batch, &sample, systemTime()))
+            {
+                Batch_Flush(&hmc5883l_capture_batch);
+            }
+        }
+    }
+
+    /************************************************************************/
+    /* Sensor data fusion                                                   */
+    /************************************************************************/
+
+#if DATA_FUSE_MODE
+
+    // keep the replica samples for the average, see sensor_average
+    if (readReplica)
+    {
+        v3d replica_samples[SENSOR_CHANNEL_COUNT];
+        SensorPipeline_Feed(&event, replica_samples);
+    }
+
+    // if there were sensor data to be fused ...
+    if (fresh_channels)
+    {
+        // convert, calibrate and store the newest sample of every fresh channel
+        SensorPipeline_Feed(&event, prepared);
+
+#if MAGNETOMETER_CALIBRATION_ONLINE
+        // refine the calibration once the ellipsoid fit converged; applies from the next sample on.
+        // every step advances the fit update, which is spread over several steps
+        if (magnetometer_calibration_update(have_mag_data ? &prepared[SENSOR_CHANNEL_MAGNETOMETER] : NULL))
+        {
+            calibration_matrix_t correction;
+            if (magnetometer_calibration_fetch(&correction))
+            {
+                sensor_prepare_correct_hmc5883l(&correction);
+            }
+        }
+#endif
+
+        const uint32_t current_time = systemTime();
+        
+        FusionSignal_Predict();
+
+        // predict at gyroscope rate, i.e. with every MPU6050 sample
+        fix16_t predict_deltaT = 0;
+        if (readMPU)
+        {
+            PipelineHealth_Record(HEALTH_MPU6050_INTERVAL, event.timestamp - last_predict_time);
+            PipelineHealth_Count(&pipelineHealth.mpu6050Samples, mpu6050_sample_count);
+
+#if FUSION_GYRO_FALLBACK
+            // the first prediction after an outage must not integrate over it
+            if ((int32_t)(event.timestamp - last_gyro_time) > FUSION_GYRO_TIMEOUT_US)
+            {
+                last_predict_time = SensorPipeline_SampleTime(&event, 0);
+            }
+            last_gyro_time = event.timestamp;
+#endif
+
+#if ENABLE_MPU6050_FIFO
+            // integrate every FIFO frame, but propagate the covariance once per burst
+            v3d burst_gyro[MPU6050_FIFO_BURST_FRAMES];
+            fix16_t burst_deltaT[MPU6050_FIFO_BURST_FRAMES];
+
+            for (uint_fast8_t frame = 0; frame < mpu6050_sample_count; ++frame)
+            {
+                const uint32_t frame_time = SensorPipeline_SampleTime(&event, frame);
+                burst_deltaT[frame] = fusion_delta(frame_time - last_predict_time);
+                last_predict_time = frame_time;
+
+                predict_deltaT = fix16_add(predict_deltaT, burst_deltaT[frame]);
+                PROFILE_BEGIN(PROFILE_SENSOR_PREPARE);
+                event.driver->prepare(SENSOR_CHANNEL_GYROSCOPE, frame, &burst_gyro[frame]);
+                PROFILE_END(PROFILE_SENSOR_PREPARE);
+            }
+
+            PROFILE_BEGIN(PROFILE_FUSION_PREDICT);
+            fusion_predict_batch(burst_gyro, burst_deltaT, mpu6050_sample_count);
+            PROFILE_END(PROFILE_FUSION_PREDICT);
+            accelerometer_predictions += mpu6050_sample_count;
+#else
+            predict_deltaT = fusion_delta(event.timestamp - last_predict_time);
+            last_predict_time = event.timestamp;
+
+            PROFILE_BEGIN(PROFILE_FUSION_PREDICT);
+            fusion_predict(predict_deltaT);
+            PROFILE_END(PROFILE_FUSION_PREDICT);
+            ++accelerometer_predictions;
+#endif
+        }
+
+        FusionSignal_Update();
+        PROFILE_BEGIN(PROFILE_FUSION_UPDATE);
+
+#if FUSION_GYRO_FALLBACK
+        // without gyroscope data the filters cannot predict; follow the measured axes until it returns.
+        // the tilt requires an accelerometer sample captured after the gyroscope went silent, which only
+        // another sensor than the MPU6050 can provide. this consumes the measurements, so the corrections
+        // below leave the filters alone; otherwise the attitude is frozen and the output is stale
+        if (!readMPU && ((int32_t)(event.timestamp - last_gyro_time) > FUSION_GYRO_TIMEOUT_US))
+        {
+            if (have_acc_data)
+            {
+                fusion_update_direct();
+            }
+            else
+            {
+                PipelineHealth_Count(&pipelineHealth.staleSteps, 1);
+            }
+        }
+#endif
+
+        // correct the attitude at the decimated accelerometer rate
+        if (have_acc_data && (accelerometer_predictions >= settings.accelerometerDecimation))
+        {
+            const fix16_t deltaT = fusion_delta(event.timestamp - last_accelerometer_time);
+            last_accelerometer_time = event.timestamp;
+            accelerometer_predictions = 0;
+
+            fusion_update_accelerometer(deltaT);
+            boot_corrections |= 0b01;
+        }
+
+        // correct the orientation only with fresh compass data
+        if (have_mag_data)
+        {
+            PipelineHealth_Record(HEALTH_HMC5883L_INTERVAL, event.timestamp - last_magnetometer_time);
+            PipelineHealth_Count(&pipelineHealth.hmc5883lSamples, 1);
+
+            const fix16_t deltaT = fusion_delta(event.timestamp - last_magnetometer_time);
+            last_magnetometer_time = event.timestamp;
+
+            fusion_update_magnetometer(deltaT);
+            boot_corrections |= 0b10;
+        }
+
+        // the filters without a correction follow the gyroscope
+        if (readMPU)
+        {
+            fusion_update_gyroscope(predict_deltaT);
+        }
+        
+        PROFILE_END(PROFILE_FUSION_UPDATE);
+        FusionSignal_Clear();
+
+        // capture-to-fusion latency and the jitter of the fusion step period
+        const uint32_t fusion_complete = SysTick_Microseconds();
+        if (readMPU)
+        {
+            PipelineHealth_Record(HEALTH_SENSOR_TO_FUSION, fusion_complete - event.timestamp);
+        }
+
+        const uint32_t fusion_period = fusion_complete - fusion_complete_time;
+        PipelineHealth_Record(HEALTH_LOOP_JITTER, (fusion_period > last_fusion_period) ? (fusion_period - last_fusion_period) : (last_fusion_period - fusion_period));
+        PipelineHealth_Count(&pipelineHealth.fusionSteps, 1);
+        last_fusion_period = fusion_period;
+        fusion_complete_time = fusion_complete;
+
+        // time to the first quaternion that is backed by both attitude and heading corrections
+        if ((0 == bootReport.firstSample) && readMPU)
+        {
+            bootReport.firstSample = event.timestamp;
+        }
+        if ((0 == bootReport.firstQuaternion) && (0b11 == boot_corrections))
+        {
+            bootReport.firstQuaternion = fusion_complete;
+#if ENABLE_FAST_BOOT
+            LED_Off();
+#endif
+        }
+
+        // the outputs are derived from the published state, see Output_Orientation
+        FusionSnapshot_Publish(current_time, fusion_complete);
+    }
+
+#endif // DATA_FUSE_MODE
+
+    return eventsProcessed;
+}
+
+#if DATA_FUSE_MODE
+
+/**
+* @brief Sends the orientation of a snapshot in the current output mode
+* @param[in] snapshot The snapshot
+*/
+static void Output_Orientation(const fusion_snapshot_t *const snapshot)
+{
+    const uint32_t current_time = snapshot->systemTime;
+
+    // every snapshot goes into the batch; with IRQ_FUSION_PENDSV, the loop runs the steps itself in the batch modes, so no step is skipped
+    if (QUATERNION_BATCH == settings.outputMode)
+    {
+        const qf16 orientation = snapshot->orientation;
+
+        fix16_t sample[4] = { orientation.a, orientation.b, orientation.c, orientation.d };
+        Batch_Append(&quaternion_batch, sample, current_time);
+    }
+    else if (QUATERNION_TIMESTAMPED == settings.outputMode)
+    {
+        const qf16 orientation = snapshot->orientation;
+
+        timestamped_quaternion_t sample = {
+            .timestamp = snapshot->timestamp,
+            .quaternion = { orientation.a, orientation.b, orientation.c, orientation.d },
+        };
+        Batch_Append(&timestamped_quaternion_batch, &sample, current_time);
+    }
+
+#if 0
+
+    const fix16_t roll = snapshot->roll, pitch = snapshot->pitch, yaw = snapshot->yaw;
+
+#if 0
+    float yawf = fix16_to_float(yaw),
+        pitchf = fix16_to_float(pitch),
+        rollf = fix16_to_float(roll);
+
+    IO_SendInt16((int16_t)yawf);
+    IO_SendInt16((int16_t)pitchf);
+    IO_SendInt16((int16_t)rollf);
+
+    IO_SendByteUncommited('\r');
+    IO_SendByte('\n');
+#else
+    if (current_time - last_transmit_time >= 100)
+    {
+        /* write data */
+        uint8_t type = 42;
+        fix16_t buffer[3] = { roll, pitch, yaw };
+        IO_SendFramePrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer));
+
+        last_transmit_time = current_time;
+    }
+#endif
+#else
+    if (Scheduler_Due(&output_scheduler, STREAM_ORIENTATION, current_time))
+    {
+        /* the first byte goes out once the queued bytes are sent at the scheduled link capacity */
+        if (PIPELINE_HEALTH == settings.outputMode && output_scheduler.capacity > 0)
+        {
+            const uint32_t queued = RingBuffer_Count(&uartOutputFifo);
+            PipelineHealth_Record(HEALTH_FUSION_TO_WIRE, (SysTick_Microseconds() - snapshot->completeTime) + queued * 1000000u / output_scheduler.capacity);
+        }
+
+        /* write data */
+        switch (settings.outputMode)
+        {
+            case RPY:
+            {
+                        const fix16_t roll = snapshot->roll, pitch = snapshot->pitch, yaw = snapshot->yaw;
+
+                        /* write data */
+                        uint8_t type = 42;
+                        fix16_t buffer[3] = { roll, pitch, yaw };
+                        IO_SendFramePrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer));
+                        break;
+            }
+            case PIPELINE_HEALTH:   /* the health frame is sent with the link status */
+            case QUATERNION:
+            {
+                               const qf16 orientation = snapshot->orientation;
+
+                               uint8_t type = 43;
+                               fix16_t buffer[4] = { orientation.a, orientation.b, orientation.c, orientation.d };
+                               IO_SendFramePrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer));
+                               break;
+            }
+            case QUATERNION_RPY:
+            {
+                                   const fix16_t roll = snapshot->roll, pitch = snapshot->pitch, yaw = snapshot->yaw;
+
+                                   const qf16 orientation = snapshot->orientation;
+
+                                   uint8_t type = 44;
+                                   fix16_t buffer[7] = { orientation.a, orientation.b, orientation.c, orientation.d, roll, pitch, yaw };
+                                   IO_SendFramePrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer));
+                                   break;
+            }
+            case SENSORS_RAW:
+            {
+                                uint8_t type = 0;
+                                fix16_t buffer[6] = {
+                                    snapshot->accelerometer.x, snapshot->accelerometer.y, snapshot->accelerometer.z,
+                                    snapshot->magnetometer.x, snapshot->magnetometer.y, snapshot->magnetometer.z
+                                };
+                                IO_SendFramePrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer));
+                                break;
+            }
+            case QUATERNION_BATCH:
+            {
+                                /* sent when the batch is due */
+                                break;
+            }
+            case RAW_CAPTURE:
+            {
+                                /* sent when the capture batches are due */
+                                break;
+            }
+            case QUATERNION_TIMESTAMPED:
+            {
+                                /* sent when the batch is due */
+                                break;
+            }
+            case QUATERNION_Q14:
+            {
+                                const qf16 orientation = snapshot->orientation;
+
+                                uint8_t type = 46;
+                                int16_t buffer[4];
+                                orientation_pack_q14(buffer, &orientation);
+                                IO_SendFramePrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer));
+                                break;
+            }
+            case QUATERNION_RPY_Q14:
+            {
+                                const fix16_t roll = snapshot->roll, pitch = snapshot->pitch, yaw = snapshot->yaw;
+
+                                const qf16 orientation = snapshot->orientation;
+
+                                uint8_t type = 47;
+                                int16_t buffer[7];
+                                orientation_pack_q14(&buffer[0], &orientation);
+                                orientation_pack_angles_q13(&buffer[4], roll, pitch, yaw);
+                                IO_SendFramePrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer));
+                                break;
+            }
+            case QUATERNION_SMALLEST3:
+            {
+                                const qf16 orientation = snapshot->orientation;
+
+                                uint8_t type = 48;
+                                int16_t buffer[3];
+                                orientation_pack_smallest_three(buffer, &orientation);
+                                IO_SendFramePrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer));
+                                break;
+            }
+        }
+    }
+#endif
+}
+
+#endif // DATA_FUSE_MODE
+
+#if IRQ_FUSION_PENDSV
+
+/**
+* @brief Nonzero while the main loop holds off the fusion task; held until the main loop is entered
+*/
+static volatile uint8_t fusionTaskSuspended = 1;
+
+/**
+* @brief Holds off the fusion task while the main loop accesses the state shared with the steps
+*
+* Nests. The PendSV exception preempts the main loop, so no step is running on return.
+*/
+STATIC_INLINE void FusionTask_Suspend()
+{
+    ++fusionTaskSuspended;
+}
+
+/**
+* @brief Releases the fusion task, which catches up on the reads published meanwhile
+*/
+STATIC_INLINE void FusionTask_Resume()
+{
+    if (0 == --fusionTaskSuspended)
+    {
+        Irq_PendFusion();
+    }
+}
+
+/**
+* @brief Runs the fusion steps until the sensor queues are drained
+*
+* Pended by the read completions, see {@see Irq_PendFusion}. Not measured with
+* {@see IRQ_PROFILE_ENTER}, since a step spans several ticks.
+*/
+void PendableSrvReq_Handler()
+{
+    while ((0 == fusionTaskSuspended) && FusionTask_Step(false)) {}
+}
+
+#else
+
+/* the main loop runs the fusion steps itself */
+STATIC_INLINE void FusionTask_Suspend() {}
+STATIC_INLINE void FusionTask_Resume() {}
+
+#endif // IRQ_FUSION_PENDSV
+
+
+/************************************************************************/
+/* Main loop tasks                                                      */
+/************************************************************************/
+
+#if IRQ_FUSION_PENDSV
+/**
+* @brief Nonzero while the main loop runs the fusion steps itself, see {@see LoopTask_Fusion}
+*/
+static bool loop_steps = false;
+#endif
+
+#if DATA_FUSE_MODE
+
+/**
+* @brief The number of snapshots the outputs were derived from, see {@see FusionSnapshot_Fetch}
+*/
+static uint32_t output_snapshot_count = 0;
+
+/**
+* @brief The start of the pipeline health accumulation, see {@see PIPELINE_HEALTH}
+*/
+static uint32_t health_start_time;
+
+#endif
+
+/**
+* @brief The output mode the stream budgets are set up for
+*/
+static output_mode_t scheduled_mode;
+
+/**
+* @brief Nonzero until the boot report is sent
+*/
+static bool bootReportPending = true;
+
+#if FIX16_BENCHMARK && FIX16_M0PLUS_BACKEND
+/**
+* @brief The reference and backend timings per kernel, sent with the boot report
+*/
+static fix16_benchmark_t fix16_benchmark[FIX16_BENCHMARK_COUNT];
+#endif
+
+/**
+* @brief Decodes and fuses the next sensor read, then sends the outputs of the newest snapshot
+* @param[in] now The current system time in milliseconds
+*/
+static void LoopTask_Fusion(const uint32_t now)
+{
+#if IRQ_FUSION_PENDSV
+    /* the fusion task runs in PendSV, but the capture batches are sent from the step and the quaternion batches take every snapshot, so the loop takes over while batching */
+    const bool batching = (RAW_CAPTURE == settings.outputMode)
+        || (QUATERNION_BATCH == settings.outputMode)
+        || (QUATERNION_TIMESTAMPED == settings.outputMode);
+    if (batching != loop_steps)
+    {
+        loop_steps = batching;
+        if (loop_steps) FusionTask_Suspend(); else FusionTask_Resume();
+    }
+
+    if (loop_steps)
+#endif
+    {
+        /* one read per run, in capture time order over all sensors; the other tasks run in between */
+        FusionTask_Step(true);
+        if (SensorPipeline_Pending(&sensor_pipeline))
+        {
+            Tasks_Signal(&loop_tasks, LOOP_EVENT_SENSOR_READ);
+        }
+    }
+
+#if DATA_FUSE_MODE
+    /* every step publishes a snapshot; the outputs follow the newest one */
+    if (fusionSnapshotCount != output_snapshot_count)
+    {
+        fusion_snapshot_t snapshot;
+        output_snapshot_count = FusionSnapshot_Fetch(&snapshot);
+        Output_Orientation(&snapshot);
+    }
+#endif
+}
 
 /**
- * @brief Indicates that polling the MPU6050 is required
- */
-static volatile uint8_t poll_mpu6050 = 1;
-
-/*!
-*  \brief The output mode
+* @brief Sends the batches that are full or hit their deadline, then arms the deadline of the oldest remaining one
+* @param[in] now The current system time in milliseconds
 */
-static output_mode_t output_mode = QUATERNION_RPY;
+static void LoopTask_Batches(const uint32_t now)
+{
+    /* send partial capture batches in time, also after leaving the capture mode */
+    if (Batch_Due(&mpu6050_capture_batch, now, RAW_CAPTURE_DEADLINE_MS))
+    {
+        Batch_Flush(&mpu6050_capture_batch);
+    }
+    if (Batch_Due(&hmc5883l_capture_batch, now, RAW_CAPTURE_DEADLINE_MS))
+    {
+        Batch_Flush(&hmc5883l_capture_batch);
+    }
+    uint32_t remaining = min_u32(Batch_Remaining(&mpu6050_capture_batch, now, RAW_CAPTURE_DEADLINE_MS), Batch_Remaining(&hmc5883l_capture_batch, now, RAW_CAPTURE_DEADLINE_MS));
 
-/************************************************************************/
-/* Interrupt handlers                                                   */
-/************************************************************************/
+#if DATA_FUSE_MODE
+    /* send the batch when it is full or its oldest sample hits the deadline */
+    if (Batch_Due(&quaternion_batch, now, QUATERNION_BATCH_DEADLINE_MS))
+    {
+        Batch_Flush(&quaternion_batch);
+    }
+    if (Batch_Due(&timestamped_quaternion_batch, now, QUATERNION_BATCH_DEADLINE_MS))
+    {
+        Batch_Flush(&timestamped_quaternion_batch);
+    }
+    remaining = min_u32(remaining, Batch_Remaining(&quaternion_batch, now, QUATERNION_BATCH_DEADLINE_MS));
+    remaining = min_u32(remaining, Batch_Remaining(&timestamped_quaternion_batch, now, QUATERNION_BATCH_DEADLINE_MS));
+#endif
+
+    if (UINT32_MAX == remaining)
+    {
+        Tasks_Cancel(&loop_tasks, LOOP_TASK_BATCHES);
+    }
+    else
+    {
+        Tasks_Schedule(&loop_tasks, LOOP_TASK_BATCHES, now + remaining);
+    }
+}
 
 /**
- * @brief Handler for interrupts on port A
- */
-void PORTA_Handler()
+* @brief Executes the received commands and applies a changed output mode
+* @param[in] now The current system time in milliseconds
+*/
+static void LoopTask_Commands(const uint32_t now)
 {
-#if ENABLE_MMA8451Q	
-    register uint32_t isfr_mma = MMA8451Q_INT_PORT->ISFR;
-
-	/* check MMA8451Q */
-    register uint32_t fromMMA8451Q 	= (isfr_mma & ((1 << MMA8451Q_INT1_PIN) | (1 << MMA8451Q_INT2_PIN)));
-	if (fromMMA8451Q || fromMPU6050)
+	/* as long as there is data in the buffer */
+	while(!RingBuffer_Empty(&uartInputFifo))
 	{
-		poll_mma8451q = 1;
+		/* light one led */
 		LED_RedOn();
 		
-		/* clear interrupts using BME decorated logical OR store 
-		 * PORTA->ISFR |= (1 << MMA8451Q_INT1_PIN) | (1 << MMA8451Q_INT2_PIN); 
-		 */
-		BME_OR_W(&MMA8451Q_INT_PORT->ISFR, (1 << MMA8451Q_INT1_PIN) | (1 << MMA8451Q_INT2_PIN));
-	}
-#endif
-	
-	/* check MPU6050 */
-    register uint32_t isfr_mpu = MPU6050_INT_PORT->ISFR;
-    register uint32_t fromMPU6050 = (isfr_mpu & (1 << MPU6050_INT_PIN));
-	if (fromMPU6050)
-	{
-		poll_mpu6050 = 1;
-		LED_BlueOn();
+		/* fetch byte and feed the command channel; the commands reconfigure what the fusion task uses */
+		uint8_t data = IO_ReadByte();
+		
+        FusionTask_Suspend();
+        Command_Process(data);
+        FusionTask_Resume();
+
+        LED_RedOff();
+#if 0
+		/* echo to output */
+		IO_SendByte(data);
 		
-		/* clear interrupts using BME decorated logical OR store 
-		 * PORTA->ISFR |= (1 << MPU6050_INT_PIN); 
-		 */
-		BME_OR_W(&MMA8451Q_INT_PORT->ISFR, (1 << MPU6050_INT_PIN));
+		/* mark event as detected */
+		eventsProcessed = 1;
+#endif
 	}
-}
 
-/************************************************************************/
-/* I2C arbiter configuration                                            */
-/************************************************************************/
+    /* the orientation frame size depends on the output mode */
+    if (scheduled_mode != settings.outputMode)
+    {
+        scheduled_mode = settings.outputMode;
+        Scheduler_SetBudget(&output_scheduler, STREAM_ORIENTATION, orientation_budget(scheduled_mode));
 
-void InitI2CArbiter()
-{
-    /* prior to configuring the I2C arbiter, enable the clocks required for
-    * the used pins
-    */
-    SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK | SIM_SCGC5_PORTE_MASK;
+#if DATA_FUSE_MODE
+        /* the health frame is only sent in its output mode and starts afresh */
+        Scheduler_SetBudget(&output_scheduler, STREAM_LINK_STATUS, LINK_STATUS_BUDGET + ((PIPELINE_HEALTH == scheduled_mode) ? PIPELINE_HEALTH_BUDGET : 0));
+        FusionTask_Suspend();
+        pipelineHealth = (pipeline_health_t){ 0 };
+        SensorPipeline_Report(&sensor_pipeline, 0);
+        fusion_report_overflows(NULL);
+        FusionTask_Resume();
+        health_start_time = SysTick_Microseconds();
+#endif
+    }
 
-    /* configure I2C arbiter
-    * The arbiter takes care of pin selection
-    */
-    I2CArbiter_PrepareEntry(&i2carbiter_entries[0], MMA8451Q_I2CADDR, PORTE, 24, 5, 25, 5);
-    I2CArbiter_PrepareEntry(&i2carbiter_entries[1], MPU6050_I2CADDR, PORTB, 0, 2, 1, 2);
-    I2CArbiter_PrepareEntry(&i2carbiter_entries[2], HMC5883L_I2CADDR, PORTB, 0, 2, 1, 2);
-    I2CArbiter_Configure(i2carbiter_entries, I2CARBITER_COUNT);
+    /* changed stream periods apply right away; in PendSV mode a new output mode may move the fusion steps */
+    Tasks_Schedule(&loop_tasks, LOOP_TASK_STREAMS, now);
+    Tasks_Signal(&loop_tasks, LOOP_EVENT_SENSOR_READ);
 }
 
-/************************************************************************/
-/* Signaling of fusion process                                          */
-/************************************************************************/
+/**
+* @brief Sends the due output streams but the orientation, which follows the fusion snapshots
+* @param[in] now The current system time in milliseconds
+*/
+static void LoopTask_Streams(const uint32_t now)
+{
+    if (Scheduler_Due(&output_scheduler, STREAM_SENSORS, now))
+    {
+        /* the samples are decoded by the fusion task; a sensor without a new sample since the last frame is not repeated */
+        static uint16_t sent_accgyrotemp_sequence = 0, sent_compass_sequence = 0;
+        FusionTask_Suspend();
+        if (sent_accgyrotemp_sequence != accgyrotemp_sequence)
+        {
+            sent_accgyrotemp_sequence = accgyrotemp_sequence;
+            uint8_t type = 0x02;
+            IO_SendFramePrefixed(&type, 1, (uint8_t*)accgyrotemp.data, sizeof(accgyrotemp.data));
+        }
+
+        if (sent_compass_sequence != compass_sequence)
+        {
+            sent_compass_sequence = compass_sequence;
+            uint8_t type = 0x03;
+            IO_SendFramePrefixed(&type, 1, (uint8_t*)compass.xyz, sizeof(compass.xyz));
+        }
+        FusionTask_Resume();
+    }
+
+    if (Scheduler_Due(&output_scheduler, STREAM_LINK_STATUS, now))
+    {
+        /* transmit buffer overflows and dropped frames, followed by the samples lost per sensor queue */
+        uint8_t type = LINK_STATUS_TYPE;
+        uint32_t buffer[5] = {
+            uartOutputFifo.overflows, uartOutputFifo.drops,
+            mpu6050_queue.losses, hmc5883l_queue.losses,
+#if ENABLE_MMA8451Q
+            mma8451q_queue.losses
+#else
+            0
+#endif
+        };
+        IO_SendFramePrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer));
+
+#if UART_PROFILE_IRQ
+        /* count, min, max and total cycles of the RX and TX interrupt paths */
+        uint8_t profile_type = UART_PROFILE_TYPE;
+        uint32_t profile[8] = {
+            uart0ReceiveIrqProfile.count, uart0ReceiveIrqProfile.minCycles, uart0ReceiveIrqProfile.maxCycles, uart0ReceiveIrqProfile.totalCycles,
+            uart0TransmitIrqProfile.count, uart0TransmitIrqProfile.minCycles, uart0TransmitIrqProfile.maxCycles, uart0TransmitIrqProfile.totalCycles
+        };
+        IO_SendFramePrefixed(&profile_type, 1, (uint8_t*)profile, sizeof(profile));
+#endif
+
+#if IRQ_PROFILE_ENABLED
+        /* the measured tick latency, then count, longest run and derived worst-case latency per source in cycles */
+        Irq_UpdateLatency();
+        uint8_t irq_profile_type = IRQ_PROFILE_TYPE;
+        uint32_t irq_profile[1 + IRQ_SOURCE_COUNT*3] = { irqTickLatency };
+        for (uint_fast8_t source = 0; source < IRQ_SOURCE_COUNT; ++source)
+        {
+            irq_profile[1 + source*3] = irqStats[source].count;
+            irq_profile[2 + source*3] = irqStats[source].maxCycles;
+            irq_profile[3 + source*3] = irqStats[source].maxLatency;
+        }
+        IO_SendFramePrefixed(&irq_profile_type, 1, (uint8_t*)irq_profile, sizeof(irq_profile));
+#endif
 
 #if DATA_FUSE_MODE
+        /* frame counts, sample counts and histograms since the last health frame */
+        if (PIPELINE_HEALTH == settings.outputMode)
+        {
+            FusionTask_Suspend();
+            const uint32_t now = SysTick_Microseconds();
+            pipelineHealth.interval = now - health_start_time;
+            health_start_time = now;
+            pipelineHealth.sensorCount = sensor_pipeline.count;
+            SensorPipeline_Report(&sensor_pipeline, pipelineHealth.sensors);
+            fusion_report_overflows(&pipelineHealth.fusion);
+
+            uint8_t health_type = PIPELINE_HEALTH;
+            IO_SendFramePrefixed(&health_type, 1, (uint8_t*)&pipelineHealth, sizeof(pipelineHealth));
+            pipelineHealth = (pipeline_health_t){ 0 };
+            FusionTask_Resume();
+        }
+#endif
+
+        /* once, as soon as the first valid quaternion is known; small enough to go unbudgeted */
+        if (bootReportPending && (0 != bootReport.firstQuaternion))
+        {
+            uint8_t boot_type = BOOT_REPORT_TYPE;
+            FusionTask_Suspend();
+            IO_SendFramePrefixed(&boot_type, 1, (uint8_t*)&bootReport, sizeof(bootReport));
+            FusionTask_Resume();
+            bootReportPending = false;
+
+#if FIX16_BENCHMARK && FIX16_M0PLUS_BACKEND
+            uint8_t benchmark_type = FIX16_BENCHMARK_TYPE;
+            IO_SendFramePrefixed(&benchmark_type, 1, (uint8_t*)fix16_benchmark, sizeof(fix16_benchmark));
+#endif
+        }
+
+#if PROFILE_ENABLED
+        /* one section per report: section, fusion engine, count, min, max and total cycles, followed by the histogram */
+        static uint8_t reported_section = 0;
+        uint8_t section_prefix[3] = { SECTION_PROFILE_TYPE, reported_section, FUSION_ENGINE };
+        IO_SendFramePrefixed(section_prefix, sizeof(section_prefix), (uint8_t*)&profileStats[reported_section], sizeof(profile_stats_t));
+
+        if (++reported_section >= PROFILE_SECTION_COUNT)
+        {
+            reported_section = 0;
+        }
+#endif
+    }
+
+    /* while the orientation frame waits for the next snapshot, the next stream is due right away */
+    const uint32_t next = Scheduler_NextDue(&output_scheduler, now);
+    Tasks_Schedule(&loop_tasks, LOOP_TASK_STREAMS, now + ((0 == next) ? 1 : next));
+}
 
 /**
-* @brief Sets up the GPIOs for fusion signaling
+* @brief Re-initializes the sensors that stopped delivering
+* @param[in] now The current system time in milliseconds
 */
-void FusionSignal_Init()
+static void LoopTask_Watchdog(const uint32_t now)
 {
-    /* Set system clock gating to enable gate to port B */
-    SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK;
-
-    /* Set Port B, pin 8 and 9 to GPIO mode */
-    PORTB->PCR[8] = PORT_PCR_MUX(1); /* not using |= assignment here due to some of the flags being undefined at reset */
-    PORTB->PCR[9] = PORT_PCR_MUX(1);
+    FusionTask_Suspend();
+    SensorPipeline_Watchdog(&sensor_pipeline, SysTick_Microseconds());
+    FusionTask_Resume();
 
-    /* Data direction for port B, pin 8 and 9  to output */
-    GPIOB->PDDR |= GPIO_PDDR_PDD(1 << 8) | GPIO_PDDR_PDD(1 << 9);
+    Tasks_Schedule(&loop_tasks, LOOP_TASK_WATCHDOG, now + SENSOR_WATCHDOG_PERIOD_MS);
 }
 
+#if ENABLE_HMC5883L_DRDY
+
 /**
-* @brief Sets the fusion predict signal
+* @brief Starts the next HMC5883L measurement; DRDY starts the read once the data is in
+* @param[in] now The current system time in milliseconds
 */
-STATIC_INLINE void FusionSignal_Predict()
+static void LoopTask_HMC5883L(const uint32_t now)
 {
-    GPIOB->PSOR = 1 << 8;
-    GPIOB->PCOR = 1 << 9;
+    /* a busy transaction engine is retried in the next millisecond */
+    const uint8_t started = (0 == I2CAsync_Submit(&hmc5883l_trigger_transaction));
+    Tasks_Schedule(&loop_tasks, LOOP_TASK_HMC5883L, now + (started ? settings.hmc5883lPeriod : 1));
 }
 
+#elif !ENABLE_HMC5883L_PASSTHROUGH
+
 /**
-* @brief Clears the fusion update signal
+* @brief Starts the HMC5883L read; the data is picked up once the transaction completes
+* @param[in] now The current system time in milliseconds
 */
-STATIC_INLINE void FusionSignal_Update()
+static void LoopTask_HMC5883L(const uint32_t now)
 {
-    GPIOB->PCOR = 1 << 8;
-    GPIOB->PSOR = 1 << 9;
+    /* the previous read is retried for in the next millisecond */
+    if (I2CAsync_Pending(&hmc5883l_transaction))
+    {
+        Tasks_Schedule(&loop_tasks, LOOP_TASK_HMC5883L, now + 1);
+        return;
+    }
+
+    /* a full queue loses this sample; the period restarts either way */
+    hmc5883l_driver.submit(SysTick_Microseconds());
+    Tasks_Schedule(&loop_tasks, LOOP_TASK_HMC5883L, now + settings.hmc5883lPeriod);
 }
 
+#endif
+
+#if ENABLE_MPU6050_FIFO
+
 /**
-* @brief Clears the fusion signal
+* @brief Drains the MPU6050 FIFO; the burst read is chained by the count transaction
+* @param[in] now The current system time in milliseconds
 */
-STATIC_INLINE void FusionSignal_Clear()
+static void LoopTask_MPU6050Fifo(const uint32_t now)
 {
-    GPIOB->PCOR = (1 << 8) | (1 << 9);
+    const uint32_t capture_time = SysTick_Microseconds();
+    if (0 == I2CAsync_Submit(&mpu6050_fifo_count_transaction))
+    {
+        mpu6050_capture_time = capture_time;
+        Tasks_Schedule(&loop_tasks, LOOP_TASK_MPU6050_FIFO, now + MPU6050_FIFO_POLL_PERIOD);
+    }
+    else
+    {
+        Tasks_Schedule(&loop_tasks, LOOP_TASK_MPU6050_FIFO, now + 1);
+    }
 }
 
-#endif // #if DATA_FUSE_MODE
+#endif
+
+/**
+* @brief The main loop tasks, indexed by {@see loop_task_t}; the event tasks run in this order
+*/
+static const task_t loop_task_table[LOOP_TASK_COUNT] = {
+    [LOOP_TASK_FUSION] = { LoopTask_Fusion, LOOP_EVENT_SENSOR_READ | LOOP_EVENT_SNAPSHOT },
+    [LOOP_TASK_BATCHES] = { LoopTask_Batches, LOOP_EVENT_SENSOR_READ | LOOP_EVENT_SNAPSHOT },
+    [LOOP_TASK_COMMANDS] = { LoopTask_Commands, LOOP_EVENT_COMMAND },
+    [LOOP_TASK_STREAMS] = { LoopTask_Streams, 0 },
+    [LOOP_TASK_WATCHDOG] = { LoopTask_Watchdog, 0 },
+#if ENABLE_HMC5883L_DRDY || !ENABLE_HMC5883L_PASSTHROUGH
+    [LOOP_TASK_HMC5883L] = { LoopTask_HMC5883L, 0 },
+#endif
+#if ENABLE_MPU6050_FIFO
+    [LOOP_TASK_MPU6050_FIFO] = { LoopTask_MPU6050Fifo, 0 },
+#endif
+};
 
 /************************************************************************/
 /* Main program                                                         */
@@ -193,11 +2280,24 @@ int main(void)
     /* Initialize UART0 */
     InitUart0();
 
+#if PROFILE_ENABLED
+    /* start the profiling counter */
+    InitProfile();
+#endif
+
+#if ENABLE_FAST_BOOT
+    /* lit until the first valid quaternion instead of blocking for the flashes */
+    LED_White();
+#else
     /* double rainbow all across the sky */
     DoubleFlash();
+#endif
 
-    /* initialize the I2C bus */
-    I2C_Init();
+    /* initialize the I2C buses */
+    I2C_Init(I2C0);
+#if ENABLE_I2C1_EXTERNAL_BUS
+    I2C_Init(I2C1);
+#endif
 
 #if DATA_FUSE_MODE
 
@@ -214,52 +2314,144 @@ int main(void)
     Uart0_InitializeIrq(&uartInputFifo, &uartOutputFifo);
     Uart0_EnableReceiveIrq();
 
+    /* initialize the output scheduler and the command channel */
+    Scheduler_Init(&output_scheduler, output_streams, STREAM_COUNT, &uartOutputFifo, UART_BAUD_RATE);
+    Command_Init(&settings, &uartOutputFifo);
+
+    /* load the persisted calibration, filter tuning and sensor configuration */
+    if (Parameters_Load())
+    {
+        bootReport.flags |= BOOT_FLAG_PARAMETERS_STORED;
+        Trace_Send0(TRACE_PARAMETERS_LOADED);
+    }
+    else
+    {
+        Trace_Send0(TRACE_PARAMETERS_DEFAULTS);
+    }
+    settings.hmc5883lPeriod = hmc5883l_get_period();
+    bootReport.parametersLoaded = SysTick_Microseconds();
+
     /* initialize I2C arbiter */
     InitI2CArbiter();
+
+    /* prepare the asynchronous sensor reads; the engine stays suspended during initialization */
+    I2CAsync_Init(I2C0);
+#if ENABLE_I2C1_EXTERNAL_BUS
+    I2CAsync_Init(I2C1);
+#endif
+    /* the transactions are pointed at their queue slot on every submission */
+#if ENABLE_MPU6050_FIFO
+    SampleQueue_Init(&mpu6050_queue, &mpu6050_fifo_block, sizeof(mpu6050_fifo_block), 1);
+#else
+    SampleQueue_Init(&mpu6050_queue, mpu6050_blocks, sizeof(mpu6050_blocks[0]), MPU6050_QUEUE_LENGTH);
+#endif
+    mpu6050_transaction.callback = mpu6050_read_complete;
+#if ENABLE_MPU6050_SECONDARY
+    SampleQueue_Init(&mpu6050_secondary_queue, mpu6050_secondary_blocks, sizeof(mpu6050_secondary_blocks[0]), MPU6050_QUEUE_LENGTH);
+    mpu6050_secondary_transaction.callback = mpu6050_secondary_read_complete;
+#endif
+    SampleQueue_Init(&hmc5883l_queue, hmc5883l_blocks, sizeof(hmc5883l_blocks[0]), HMC5883L_QUEUE_LENGTH);
+    hmc5883l_transaction.callback = hmc5883l_read_complete;
+#if ENABLE_HMC5883L_DRDY
+    HMC5883L_PrepareTriggerMeasurement(&hmc5883l_trigger_transaction, &hmc5883l_trigger_mode);
+#endif
+#if ENABLE_MMA8451Q
+    SampleQueue_Init(&mma8451q_queue, mma8451q_blocks, sizeof(mma8451q_blocks[0]), MMA8451Q_QUEUE_LENGTH);
+    mma8451q_transaction.callback = mma8451q_read_complete;
+#endif
+
+    SensorPipeline_Register(&sensor_pipeline, &mpu6050_driver);
+#if ENABLE_MPU6050_SECONDARY
+    SensorPipeline_Register(&sensor_pipeline, &mpu6050_secondary_driver);
+#endif
+#if !ENABLE_HMC5883L_PASSTHROUGH
+    SensorPipeline_Register(&sensor_pipeline, &hmc5883l_driver);
+#endif
+#if ENABLE_MMA8451Q
+    SensorPipeline_Register(&sensor_pipeline, &mma8451q_driver);
+#endif
+#if ENABLE_MPU6050_FIFO
+    MPU6050_PrepareReadFifoCount(&mpu6050_primary, &mpu6050_fifo_count_transaction, &mpu6050_fifo_block);
+    mpu6050_fifo_count_transaction.callback = mpu6050_fifo_count_complete;
+    mpu6050_fifo_read_transaction.callback = mpu6050_read_complete;
+#endif
 		
-	/* initialize the IMUs */
+	/* initialize the IMUs; the MMA8451Q completes its reset meanwhile */
+#if ENABLE_MMA8451Q
+    ResetMMA8451Q();
+#endif
     InitHMC5883L();
 	InitMPU6050();
 //    InitMPU6050();
+#if ENABLE_MPU6050_SECONDARY
+    InitMPU6050Secondary();
+#endif
+
+#if ENABLE_MPU6050_FIFO
+    /* the FIFO reset must keep the remaining USER_CTRL bits */
+    MPU6050_SelectDevice(&mpu6050_primary);
+    MPU6050_PrepareResetFifo(&mpu6050_primary, &mpu6050_fifo_reset_transaction, &mpu6050_fifo_block, I2C_ReadRegister(MPU6050_I2CADDR, MPU6050_REG_USER_CTRL));
+#endif
 
 #if ENABLE_MMA8451Q
 	InitMMA8451Q();
 #endif
 
+    bootReport.sensorsConfigured = SysTick_Microseconds();
+
+#if !ENABLE_FAST_BOOT
 	/* Wait for the config messages to get flushed */
     //TrafficLight();
     DoubleFlash();
 	RingBuffer_BlockWhileNotEmpty(&uartOutputFifo);
+#endif
+
+    /* from now on, a slow host must never stall the fusion loop */
+    RingBuffer_SetPolicy(&uartOutputFifo, RINGBUFFER_POLICY_DROP_OLDEST);
+    scheduled_mode = settings.outputMode;
+
+    /* hand the bus to the transaction engine; the initial read clears a latched MPU6050 interrupt */
+    I2CAsync_Resume();
+#if !ENABLE_MPU6050_FIFO
+    mpu6050_submit_read(SysTick_Microseconds());
+#endif
+#if ENABLE_MPU6050_SECONDARY
+    mpu6050_secondary_submit_read(SysTick_Microseconds());
+#endif
+#if ENABLE_MMA8451Q
+    mma8451q_submit_read(SysTick_Microseconds());
+#endif
 
 #if ENABLE_MMA8451Q
 	/* initialize the MMA8451Q data structure for accelerometer data fetching */
-	mma8451q_acc_t acc;
 	MMA8451Q_InitializeData(&acc);
 #endif
 
 	/* initialize the MPU6050 data structure */
-    mpu6050_sensor_t accgyrotemp, previous_accgyrotemp;
 	MPU6050_InitializeData(&accgyrotemp);
-    MPU6050_InitializeData(&previous_accgyrotemp);
 	
 	/* initialize the HMC5883L data structure */
-	hmc5883l_data_t compass, previous_compass;
     HMC5883L_InitializeData(&compass);
     HMC5883L_InitializeData(&previous_compass);
 
-    /* initialize HMC5883L reading */
-    uint32_t lastHMCRead = 0;
-    const uint32_t readHMCEvery = 1000 / 75; /* at 75Hz, data come every (1000/75Hz) ms. */
+    Batch_Init(&mpu6050_capture_batch, RAW_CAPTURE_MPU6050_TYPE, sizeof(mpu6050_capture_t), RAW_CAPTURE_MPU6050_CAPACITY);
+    Batch_Init(&hmc5883l_capture_batch, RAW_CAPTURE_HMC5883L_TYPE, sizeof(hmc5883l_capture_t), RAW_CAPTURE_HMC5883L_CAPACITY);
     	
     /************************************************************************/
-    /* Fetch scaler values                                                  */
+    /* Precompute the sensor data conversions                             */
     /************************************************************************/
 
 #if DATA_FUSE_MODE
 
-    const fix16_t mpu6050_accelerometer_scaler = mpu6050_accelerometer_get_scaler();
-    const fix16_t mpu6050_gyroscope_scaler = mpu6050_gyroscope_get_scaler();
-    const fix16_t hmc5883l_magnetometer_scaler = hmc5883l_magnetometer_get_scaler();
+    sensor_prepare_initialize(mpu6050_accelerometer_get_scaler(), mpu6050_gyroscope_get_scaler(), hmc5883l_magnetometer_get_scaler());
+#if ENABLE_MMA8451Q
+    sensor_prepare_initialize_mma8451q(mma8451q_accelerometer_get_scaler());
+#endif
+    accelerometer_merge_initialize();
+    sensor_average_initialize();
+#if MAGNETOMETER_CALIBRATION_ONLINE
+    magnetometer_calibration_initialize();
+#endif
 
 #endif // DATA_FUSE_MODE
 
@@ -269,348 +2461,100 @@ int main(void)
 
 #if DATA_FUSE_MODE
 
-    uint32_t last_transmit_time = 0;
-    uint32_t last_fusion_time = systemTime();
+    /* the time differences of the fusion task start here */
+    last_predict_time = SysTick_Microseconds();
+    last_accelerometer_time = last_predict_time;
+    last_magnetometer_time = last_predict_time;
+#if FUSION_GYRO_FALLBACK
+    last_gyro_time = last_predict_time;
+#endif
+    fusion_complete_time = last_predict_time;
+
+    /* pipeline health timing, see PIPELINE_HEALTH */
+    health_start_time = last_predict_time;
+
+#if FIX16_BENCHMARK && FIX16_M0PLUS_BACKEND
+    /* reference and backend timings per kernel, sent with the boot report */
+    fix16_m0plus_benchmark(fix16_benchmark);
+#endif
 
     fusion_initialize();
 
+    Batch_Init(&quaternion_batch, QUATERNION_BATCH, 4 * sizeof(fix16_t), QUATERNION_BATCH_CAPACITY);
+    Batch_Init(&timestamped_quaternion_batch, QUATERNION_TIMESTAMPED, sizeof(timestamped_quaternion_t), TIMESTAMPED_BATCH_CAPACITY);
+
 #endif // DATA_FUSE_MODE
 
     /************************************************************************/
     /* Main loop                                                            */
     /************************************************************************/
 
-	for(;;) 
-	{
-        /* helper variables to track data freshness */
-        uint_fast8_t have_gyro_data = 0;
-        uint_fast8_t have_acc_data = 0;
-        uint_fast8_t have_mag_data = 0;
+    bootReport.loopEntered = SysTick_Microseconds();
 
-        /************************************************************************/
-        /* Determine if sensor data fetching is required                        */
-        /************************************************************************/
+    /* the sensors that deliver nothing from here on are re-initialized */
+    SensorPipeline_StartWatchdog(&sensor_pipeline, bootReport.loopEntered);
 
-        /* helper variables for event processing */
-		int eventsProcessed = 0;
-        int readMPU, readHMC;
-#if ENABLE_MMA8451Q
-        int readMMA;
+    /* the periodic tasks start now; the reads published during the bring-up are picked up right away */
+    Tasks_Init(&loop_tasks, loop_task_table, LOOP_TASK_COUNT);
+    const uint32_t loop_time = systemTime();
+    Tasks_Schedule(&loop_tasks, LOOP_TASK_STREAMS, loop_time);
+    Tasks_Schedule(&loop_tasks, LOOP_TASK_WATCHDOG, loop_time + SENSOR_WATCHDOG_PERIOD_MS);
+#if ENABLE_HMC5883L_DRDY || !ENABLE_HMC5883L_PASSTHROUGH
+    Tasks_Schedule(&loop_tasks, LOOP_TASK_HMC5883L, loop_time);
 #endif
-		
-		/* atomic detection of fresh data */
-		__disable_irq();
-#if ENABLE_MMA8451Q
-		readMMA = poll_mma8451q;
+#if ENABLE_MPU6050_FIFO
+    Tasks_Schedule(&loop_tasks, LOOP_TASK_MPU6050_FIFO, loop_time);
 #endif
-		readMPU = poll_mpu6050;
-		poll_mma8451q = 0;
-		poll_mpu6050 = 0;
-		__enable_irq();
-		
-		/* detection of HMC read */
-		/*
-		 * TODO: read synchronized with MPU
-		 */
-		readHMC = 0;
-		uint32_t time = systemTime(); 
-		if ((time - lastHMCRead) >= readHMCEvery)
-		{
-			readHMC = 1;
-			lastHMCRead = time;
-		}
-
-        /************************************************************************/
-        /* Fetching MPU6050 sensor data if required                             */
-        /************************************************************************/
-
-		/* read accelerometer/gyro */
-		if (readMPU)
-		{
-			LED_BlueOff();
-			
-			I2CArbiter_Select(MPU6050_I2CADDR);
-			MPU6050_ReadData(&accgyrotemp);
-			
-			/* mark event as detected */
-			eventsProcessed = 1;
-
-            /* check for data freshness */
-            have_acc_data = (accgyrotemp.accel.x != previous_accgyrotemp.accel.x)
-                || (accgyrotemp.accel.y != previous_accgyrotemp.accel.y)
-                || (accgyrotemp.accel.z != previous_accgyrotemp.accel.z);
-
-            have_gyro_data = (accgyrotemp.gyro.x != previous_accgyrotemp.gyro.x)
-                || (accgyrotemp.gyro.y != previous_accgyrotemp.gyro.y)
-                || (accgyrotemp.gyro.z != previous_accgyrotemp.gyro.z);
-
-            /* loop current data --> previous data */
-            previous_accgyrotemp = accgyrotemp;
-		}
-		
-        /************************************************************************/
-        /* Fetching HMC5883L sensor data if required                            */
-        /************************************************************************/
-
-		/* read compass data */
-		if (readHMC)
-		{
-			I2CArbiter_Select(HMC5883L_I2CADDR);
-			HMC5883L_ReadData(&compass);
-			
-			/* mark event as detected */
-			eventsProcessed = 1;
-
-            /* check for data freshness */
-            have_mag_data = (compass.x != previous_compass.x)
-                || (compass.y != previous_compass.y)
-                || (compass.z != previous_compass.z);
-
-            /* loop current data --> previous data */
-            previous_compass = compass;
-		}
-		
-        /************************************************************************/
-        /* Fetching MMA8451Q sensor data if required                            */
-        /************************************************************************/
+    Tasks_Signal(&loop_tasks, LOOP_EVENT_SENSOR_READ);
 
-#if ENABLE_MMA8451Q		
-		/* read accelerometer */
-		if (readMMA)
-		{
-			LED_RedOff();
-			
-			I2CArbiter_Select(MMA8451Q_I2CADDR);
-			MMA8451Q_ReadAcceleration14bitNoFifo(&acc);
-			
-			/* mark event as detected */
-			eventsProcessed = 1;
-		}
+#if IRQ_FUSION_PENDSV
+    /* the read completions raise the fusion task from here on */
+    Irq_Enable(PendSV_IRQn, IRQ_SOURCE_FUSION);
+    FusionTask_Resume();
 #endif
-		
-        /************************************************************************/
-        /* Raw sensor data output over serial                                   */
-        /************************************************************************/
 
-#if DATA_FETCH_MODE
+	for(;;) 
+	{
+		/* recover from transactions that stalled the bus */
+		I2CAsync_CheckTimeouts();
 
-		/* data availability + sanity check 
-		 * This sent me on a long bug hunt: Sometimes the interrupt would be raised
-		 * even if not all data registers were written. This always resulted in a
-		 * z data register not being fully written which, in turn, resulted in
-		 * extremely jumpy measurements. 
-		 */
-		if (readMPU && accgyrotemp.status != 0)
-		{
-			/* write data */
-			uint8_t type = 0x02;
-			P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)accgyrotemp.data, sizeof(accgyrotemp.data), IO_SendByte);
-		}
-		
-		/* data availability + sanity check */
-		if (readHMC && (compass.status & HMC5883L_SR_RDY_MASK) != 0) /* TODO: check if not in lock state */
+		/* the UART driver raises no event, but its receive interrupt ended the sleep */
+		if (!RingBuffer_Empty(&uartInputFifo))
 		{
-			uint8_t type = 0x03;
-			P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)compass.xyz, sizeof(compass.xyz), IO_SendByte);
+			Tasks_Signal(&loop_tasks, LOOP_EVENT_COMMAND);
 		}
-		
-#if ENABLE_MMA8451Q
-		/* data availability + sanity check */
-		if (readMMA && acc.status != 0) 
-		{
-			uint8_t type = 0x01;
-			P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)acc.xyz, sizeof(acc.xyz), IO_SendByte);
-		}
-#endif
-		
-#endif // DATA_FETCH_MODE
-
-        /************************************************************************/
-        /* Sensor data fusion                                                   */
-        /************************************************************************/
-
-#if DATA_FUSE_MODE
-
-        // if there were sensor data ...
-        if (eventsProcessed)
-        {
-            v3d gyro, acc, mag;
-
-            // convert, calibrate and store gyroscope data
-            if (have_gyro_data)
-            {
-                sensor_prepare_mpu6050_gyroscope_data(&gyro, accgyrotemp.gyro.x, accgyrotemp.gyro.y, accgyrotemp.gyro.z, mpu6050_gyroscope_scaler);
-                fusion_set_gyroscope_v3d(&gyro);
-            }
-
-            // convert, calibrate and store accelerometer data
-            if (have_acc_data)
-            {
-                sensor_prepare_mpu6050_accelerometer_data(&acc, accgyrotemp.accel.x, accgyrotemp.accel.y, accgyrotemp.accel.z, mpu6050_accelerometer_scaler);
-                fusion_set_accelerometer_v3d(&acc);
-            }
-
-            // convert, calibrate and store magnetometer data
-            if (have_mag_data)
-            {
-                sensor_prepare_hmc5883l_data(&mag, compass.x, compass.y, compass.z, hmc5883l_magnetometer_scaler);
-                fusion_set_magnetometer_v3d(&mag);
-            }
-
-            // get the time differential
-            const uint32_t current_time = systemTime();
-            const fix16_t deltaT_ms = fix16_from_int(current_time - last_fusion_time);
-            const fix16_t deltaT = fix16_mul(deltaT_ms, F16(0.001));
-            
-            last_fusion_time = current_time;
-            
-            FusionSignal_Predict();
-
-            // predict the current measurements
-            fusion_predict(deltaT);
-
-            FusionSignal_Update();
-
-            // correct the measurements
-            fusion_update(deltaT);
-
-            
-            FusionSignal_Clear();
-
-#if 0
-
-            fix16_t yaw, pitch, roll;
-            fusion_fetch_angles(&roll, &pitch, &yaw);
 
-#if 0
-            float yawf = fix16_to_float(yaw),
-                pitchf = fix16_to_float(pitch),
-                rollf = fix16_to_float(roll);
-
-            IO_SendInt16((int16_t)yawf);
-            IO_SendInt16((int16_t)pitchf);
-            IO_SendInt16((int16_t)rollf);
-
-            IO_SendByteUncommited('\r');
-            IO_SendByte('\n');
-#else
-            if (current_time - last_transmit_time >= 100)
-            {
-                /* write data */
-                uint8_t type = 42;
-                fix16_t buffer[3] = { roll, pitch, yaw };
-                P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer), IO_SendByte);
-
-                last_transmit_time = current_time;
-            }
-#endif
-#else
-            if (current_time - last_transmit_time >= 100)
-            {
-                /* write data */
-                switch (output_mode)
-                {
-                    case RPY:
-                    {
-                                fix16_t roll, pitch, yaw;
-                                fusion_fetch_angles(&roll, &pitch, &yaw);
-
-                                /* write data */
-                                uint8_t type = 42;
-                                fix16_t buffer[3] = { roll, pitch, yaw };
-                                P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer), IO_SendByte);
-                                break;
-                    }
-                    case QUATERNION:
-                    {
-                                       qf16 orientation;
-                                       fusion_fetch_quaternion(&orientation);
-
-                                       uint8_t type = 43;
-                                       fix16_t buffer[4] = { orientation.a, orientation.b, orientation.c, orientation.d };
-                                       P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer), IO_SendByte);
-                                       break;
-                    }
-                    case QUATERNION_RPY:
-                    {
-                                           fix16_t roll, pitch, yaw;
-                                           fusion_fetch_angles(&roll, &pitch, &yaw);
-
-                                           qf16 orientation;
-                                           fusion_fetch_quaternion(&orientation);
-
-                                           uint8_t type = 44;
-                                           fix16_t buffer[7] = { orientation.a, orientation.b, orientation.c, orientation.d, roll, pitch, yaw };
-                                           P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer), IO_SendByte);
-                                           break;
-                    }
-                    case SENSORS_RAW:
-                    {
-                                        uint8_t type = 0;
-                                        fix16_t buffer[6] = { acc.x, acc.y, acc.z, mag.x, mag.y, mag.z };
-                                        P2PPE_TransmissionPrefixed(&type, 1, (uint8_t*)buffer, sizeof(buffer), IO_SendByte);
-                                        break;
-                    }
-                }
-
-                last_transmit_time = current_time;
-            }
-#endif
-
-        }
-
-#endif // DATA_FUSE_MODE
-
-        /************************************************************************/
-        /* Read user data input                                                 */
-        /************************************************************************/
-
-		/* as long as there is data in the buffer */
-		while(!RingBuffer_Empty(&uartInputFifo))
+		if (Tasks_Run(&loop_tasks, systemTime()))
 		{
-			/* light one led */
-			LED_RedOn();
-			
-			/* fetch byte */
-			uint8_t data = IO_ReadByte();
-			
-            output_mode = (output_mode_t)data;
-
-            LED_RedOff();
-#if 0
-			/* echo to output */
-			IO_SendByte(data);
-			
-			/* mark event as detected */
-			eventsProcessed = 1;
-#endif
+			continue;
 		}
-		
+
         /************************************************************************/
-        /* Save energy if you like to                                           */
+        /* Sleep until the next event or deadline                               */
         /************************************************************************/
 
-		/* in case of no events, allow a sleep */
-		if (!eventsProcessed)
+		/* an interrupt after the checks below is still pending at the WFI and ends the sleep */
+		__disable_irq();
+		if (!Tasks_Pending(&loop_tasks) && RingBuffer_Empty(&uartInputFifo))
 		{
-			/*
-			 * Care must be taken with this instruction here, as it can lead
-			 * to a condition where after being woken up (e.g. by the SysTick)
-			 * and looping through, immediately before entering WFI again
-			 * an interrupt would yield a true condition for the branches below.
-			 * In this case this loop would be blocked until the next IRQ,
-			 * which, in case of a 1ms SysTick timer, could be too late.
-			 * 
-			 * To counter this behaviour, SysTick has been speed up by factor
-			 * four (0.25ms).
-			 */
-#if 0
-			__WFI();
-#endif
+			const uint32_t idle_ms = Tasks_Remaining(&loop_tasks, systemTime());
+
+			/* a transaction in flight completes by interrupt, unless it stalls and must time out */
+			const uint8_t bus_idle = I2CAsync_Idle();
+			uint32_t idle_us = min_u32(idle_ms, SYSTICK_MAX_SLEEP_US / 1000u) * 1000u;
+			if (!bus_idle)
+			{
+				idle_us = min_u32(idle_us, I2CASYNC_TIMEOUT_BASE_US);
+			}
+
+			/* VLPS stops the bus clock, so only with nothing on the wires; the periodic tick ends the sleep after a tick regardless */
+			const uint8_t deep = bus_idle && RingBuffer_Empty(&uartOutputFifo) && (0 != (UART0->S1 & UART0_S1_TC_MASK));
+			SysTick_Sleep(SysTick_Microseconds() + idle_us, deep);
 		}
+		__enable_irq();
 	}
 
 	return 0;
 }
 
-#endif // 0
\ No newline at end of file
+#endif // !BENCHMARK_FIRMWARE
\ No newline at end of file
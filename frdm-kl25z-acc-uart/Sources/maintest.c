@@ -1,34 +1,434 @@
-#if 0
+/*
+ * Benchmark firmware: times the hot kernels on the target and reports them in a single frame
+ *
+ * Built instead of main.c by the BENCHMARK_DEBUG and BENCHMARK_RELEASE configurations,
+ * see benchmark_debug.mak and benchmark_release.mak.
+ */
+
+#if defined(BENCHMARK_FIRMWARE)
 
 #include "ARMCM0plus.h"
 #include "derivative.h" /* include peripheral declarations */
-#include "bme.h"
 
 #include "cpu/clock.h"
+#include "cpu/delay.h"
+#include "cpu/profile.h"
 #include "cpu/systick.h"
+#include "comm/buffer.h"
+#include "comm/io.h"
+#include "comm/p2pprotocol.h"
+#include "comm/uart.h"
 
-#include "fixvector3d.h"
-#include "fusion/sensor_calibration.h"
+#include "i2c/i2c.h"
+#include "i2c/i2carbiter.h"
+#include "imu/hmc5883l.h"
+#include "imu/mma8451q.h"
+#include "imu/mpu6050.h"
 
+#include "fixquat.h"
+#include "fixvector3d.h"
 #include "fusion/sensor_fusion.h"
+#include "fusion/sensor_prepare.h"
+
+#include "init_sensors.h"
+#include "parameters.h"
+
+#define UART_RX_BUFFER_SIZE	(16)				        /*! Size of the UART RX buffer in byte*/
+#define UART_TX_BUFFER_SIZE	(256)				        /*! Size of the UART TX buffer in byte */
+static uint8_t uartInputData[UART_RX_BUFFER_SIZE]  __attribute__((aligned(4))), 	    /*! The UART RX buffer */
+               uartOutputData[UART_TX_BUFFER_SIZE]  __attribute__((aligned(4)));	/*! The UART TX buffer */
+static buffer_t uartInputFifo, 						    /*! The UART RX buffer driver */
+		        uartOutputFifo;							/*! The UART TX buffer driver */
+
+#define BENCHMARK_REPORT_TYPE       (0x69)  /*! Frame type of the benchmark report, see {@see benchmark_entry_t} */
+#define BENCHMARK_REPORT_VERSION    (1)     /*! The layout version of the report */
+#define BENCHMARK_REPORT_INTERVAL   (2000)  /*! The report is repeated every this many milliseconds, so that a late host catches it */
+
+#define BENCHMARK_ITERATIONS        (4096)  /*! Calls per computational kernel */
+#define BENCHMARK_I2C_ITERATIONS    (1024)  /*! Reads per sensor and bus speed */
+
+#define I2CARBITER_COUNT 	(3)					/*< Number of I2C devices we're talking to */
+static i2carbiter_entry_t i2carbiter_entries[I2CARBITER_COUNT]; /*< Structure for the pin enabling/disabling manager */
+
+/**
+* @brief The benchmarked kernels
+*/
+typedef enum {
+    BENCHMARK_FUSION_PREDICT = 0,               /*< fusion_predict */
+    BENCHMARK_FUSION_UPDATE = 1,                /*< fusion_update with accelerometer and magnetometer data */
+    BENCHMARK_FUSION_FETCH_QUATERNION = 2,      /*< fusion_fetch_quaternion */
+    BENCHMARK_PREPARE_MPU6050_ACCELEROMETER = 3,/*< sensor_prepare_mpu6050_accelerometer_data */
+    BENCHMARK_PREPARE_MPU6050_GYROSCOPE = 4,    /*< sensor_prepare_mpu6050_gyroscope_data */
+    BENCHMARK_PREPARE_HMC5883L = 5,             /*< sensor_prepare_hmc5883l_data */
+    BENCHMARK_PREPARE_MMA8451Q = 6,             /*< sensor_prepare_mma8451q_accelerometer_data */
+    BENCHMARK_P2PPE_ENCODE = 7,                 /*< P2PPE_TransmissionPrefixedToBuffer of a batch sized frame */
+    BENCHMARK_P2PPE_COBS_ENCODE = 8,            /*< P2PPE_CobsTransmissionPrefixedToBuffer of the same frame */
+    BENCHMARK_RINGBUFFER_WRITE = 9,             /*< RingBuffer_Write */
+    BENCHMARK_RINGBUFFER_READ = 10,             /*< RingBuffer_Read */
+    BENCHMARK_RINGBUFFER_RESERVE_COMMIT = 11,   /*< RingBuffer_Reserve and RingBuffer_Commit of an empty frame */
+    BENCHMARK_RINGBUFFER_CLAIM_RELEASE = 12,    /*< RingBuffer_ClaimSpan and RingBuffer_ReleaseSpan */
+    BENCHMARK_I2C_MPU6050_READ = 13,            /*< Blocking read of the MPU6050 data block */
+    BENCHMARK_I2C_HMC5883L_READ = 14,           /*< Blocking read of the HMC5883L data block */
+    BENCHMARK_I2C_MMA8451Q_READ = 15,           /*< Blocking read of the MMA8451Q data block */
+} benchmark_kernel_t;
+
+/**
+* @brief The I2C bus speeds every sensor read is timed at
+*/
+static const uint32_t benchmark_i2c_speeds[] = { I2C_SPEED_STANDARD, I2C_SPEED_FAST };
+
+#define BENCHMARK_I2C_SPEED_COUNT   (sizeof(benchmark_i2c_speeds) / sizeof(benchmark_i2c_speeds[0]))
+
+/**
+* @brief The number of report entries: the computational kernels once, the sensor reads per bus speed
+*/
+#define BENCHMARK_ENTRY_COUNT       (BENCHMARK_I2C_MPU6050_READ + 3 * BENCHMARK_I2C_SPEED_COUNT)
+
+/**
+* @brief The timings of a kernel; an entry of the report frame
+*
+* The min and max are in TPM1 counts of 2^{@see PROFILE_PRESCALER_SHIFT} core cycles,
+* which bounds a single call to 10.9 ms at 48 MHz; the total is in core cycles. The
+* counter is read twice per call, which is measured once and removed.
+*/
+typedef struct {
+    uint8_t kernel;         /*< The {@see benchmark_kernel_t} */
+    uint8_t variant;        /*< The I2C bus speed in 10 kHz for the sensor reads, otherwise zero */
+    uint16_t iterations;    /*< The number of measured calls; failed sensor reads are not counted */
+    uint32_t totalCycles;   /*< The sum of all measured calls in core cycles */
+    uint16_t minCounts;     /*< The shortest call in timer counts */
+    uint16_t maxCounts;     /*< The longest call in timer counts */
+} benchmark_entry_t;
+
+/**
+* @brief The report, sent as the payload of {@see BENCHMARK_REPORT_TYPE}
+*/
+static benchmark_entry_t benchmark_report[BENCHMARK_ENTRY_COUNT];
+
+typedef char benchmark_report_size_check_t[(sizeof(benchmark_report) <= 255) ? 1 : -1];
+
+/**
+* @brief The timer counts of an empty measurement
+*/
+static uint16_t benchmark_overhead;
+
+/**
+* @brief Prepares a report entry
+* @param[in] index The entry
+* @param[in] kernel The kernel
+* @param[in] variant The variant, see {@see benchmark_entry_t}
+* @return The entry
+*/
+static benchmark_entry_t* Benchmark_Entry(const uint8_t index, const benchmark_kernel_t kernel, const uint8_t variant)
+{
+    benchmark_entry_t *const entry = &benchmark_report[index];
+    entry->kernel = (uint8_t)kernel;
+    entry->variant = variant;
+    entry->iterations = 0;
+    entry->totalCycles = 0;
+    entry->minCounts = UINT16_MAX;
+    entry->maxCounts = 0;
+    return entry;
+}
+
+/**
+* @brief Accumulates a measured call
+* @param[inout] entry The entry of the kernel
+* @param[in] start The {@see Profile_Now} value before the call
+*/
+static void Benchmark_Record(benchmark_entry_t *const entry, const uint16_t start)
+{
+    const uint16_t elapsed = (uint16_t)(Profile_Now() - start);
+    const uint16_t counts = (elapsed > benchmark_overhead) ? (uint16_t)(elapsed - benchmark_overhead) : 0;
+
+    if (entry->iterations < UINT16_MAX) ++entry->iterations;
+    entry->totalCycles += (uint32_t)counts << PROFILE_PRESCALER_SHIFT;
+    if (counts < entry->minCounts) entry->minCounts = counts;
+    if (counts > entry->maxCounts) entry->maxCounts = counts;
+}
+
+/**
+* @brief Measures the counter reads of an empty measurement
+*/
+static void Benchmark_Calibrate()
+{
+    uint16_t best = UINT16_MAX;
+    for (uint_fast16_t n = 0; n < BENCHMARK_ITERATIONS; ++n)
+    {
+        const uint16_t start = Profile_Now();
+        const uint16_t elapsed = (uint16_t)(Profile_Now() - start);
+        if (elapsed < best) best = elapsed;
+    }
+    benchmark_overhead = best;
+}
+
+/**
+* @brief Times the fusion over a slowly rotating, resting board
+* @param[in] index The first report entry to use
+* @return The next free report entry
+*/
+static uint8_t Benchmark_Fusion(uint8_t index)
+{
+    benchmark_entry_t *const predict = Benchmark_Entry(index++, BENCHMARK_FUSION_PREDICT, 0);
+    benchmark_entry_t *const update = Benchmark_Entry(index++, BENCHMARK_FUSION_UPDATE, 0);
+    benchmark_entry_t *const fetch = Benchmark_Entry(index++, BENCHMARK_FUSION_FETCH_QUATERNION, 0);
+
+    fusion_initialize();
+
+    const fix16_t deltaT = F16(0.005);
+    const fix16_t ax = F16(0.02), ay = F16(-0.01), az = F16(0.99);
+    const fix16_t mx = F16(0.5), my = F16(0.02), mz = F16(0.86);
+    const fix16_t gx = F16(0.01), gy = F16(-0.02), gz = F16(0.3);
+    qf16 orientation;
+    uint16_t start;
+
+    for (uint_fast16_t n = 0; n < BENCHMARK_ITERATIONS; ++n)
+    {
+        fusion_set_gyroscope(&gx, &gy, &gz);
+        start = Profile_Now();
+        fusion_predict(deltaT);
+        Benchmark_Record(predict, start);
+
+        fusion_set_accelerometer(&ax, &ay, &az);
+        fusion_set_magnetometer(&mx, &my, &mz);
+        start = Profile_Now();
+        fusion_update(deltaT);
+        Benchmark_Record(update, start);
+
+        start = Profile_Now();
+        fusion_fetch_quaternion(&orientation);
+        Benchmark_Record(fetch, start);
+    }
+
+    return index;
+}
+
+/**
+* @brief Times the raw sample conversions
+* @param[in] index The first report entry to use
+* @return The next free report entry
+*/
+static uint8_t Benchmark_Prepare(uint8_t index)
+{
+    benchmark_entry_t *const accelerometer = Benchmark_Entry(index++, BENCHMARK_PREPARE_MPU6050_ACCELEROMETER, 0);
+    benchmark_entry_t *const gyroscope = Benchmark_Entry(index++, BENCHMARK_PREPARE_MPU6050_GYROSCOPE, 0);
+    benchmark_entry_t *const magnetometer = Benchmark_Entry(index++, BENCHMARK_PREPARE_HMC5883L, 0);
+    benchmark_entry_t *const mma8451q = Benchmark_Entry(index++, BENCHMARK_PREPARE_MMA8451Q, 0);
+
+    sensor_prepare_initialize(mpu6050_accelerometer_get_scaler(), mpu6050_gyroscope_get_scaler(), hmc5883l_magnetometer_get_scaler());
+    sensor_prepare_initialize_mma8451q(mma8451q_accelerometer_get_scaler());
 
-void main()
+    v3d out;
+    uint16_t start;
+    for (uint_fast16_t n = 0; n < BENCHMARK_ITERATIONS; ++n)
+    {
+        /* vary the raw values, so that no early exit of the kernels is favored */
+        const int16_t raw = (int16_t)(n * 37u);
+
+        start = Profile_Now();
+        sensor_prepare_mpu6050_accelerometer_data(&out, raw, -raw, 8192);
+        Benchmark_Record(accelerometer, start);
+
+        start = Profile_Now();
+        sensor_prepare_mpu6050_gyroscope_data(&out, raw, 16, -raw);
+        Benchmark_Record(gyroscope, start);
+
+        start = Profile_Now();
+        sensor_prepare_hmc5883l_data(&out, 300, raw, -raw);
+        Benchmark_Record(magnetometer, start);
+
+        start = Profile_Now();
+        sensor_prepare_mma8451q_accelerometer_data(&out, -raw, raw, 4096);
+        Benchmark_Record(mma8451q, start);
+    }
+
+    return index;
+}
+
+/**
+* @brief Times the frame encoders and the ring buffer operations
+* @param[in] index The first report entry to use
+* @return The next free report entry
+*/
+static uint8_t Benchmark_Communication(uint8_t index)
+{
+    benchmark_entry_t *const encode = Benchmark_Entry(index++, BENCHMARK_P2PPE_ENCODE, 0);
+    benchmark_entry_t *const cobs = Benchmark_Entry(index++, BENCHMARK_P2PPE_COBS_ENCODE, 0);
+    benchmark_entry_t *const write = Benchmark_Entry(index++, BENCHMARK_RINGBUFFER_WRITE, 0);
+    benchmark_entry_t *const read = Benchmark_Entry(index++, BENCHMARK_RINGBUFFER_READ, 0);
+    benchmark_entry_t *const reserve = Benchmark_Entry(index++, BENCHMARK_RINGBUFFER_RESERVE_COMMIT, 0);
+    benchmark_entry_t *const claim = Benchmark_Entry(index++, BENCHMARK_RINGBUFFER_CLAIM_RELEASE, 0);
+
+    static uint8_t data[256] __attribute__((aligned(4)));
+    buffer_t buffer;
+    RingBuffer_Init(&buffer, &data, sizeof(data));
+    RingBuffer_SetPolicy(&buffer, RINGBUFFER_POLICY_DROP_NEWEST);
+
+    /* a batch of quaternions with a few bytes that need escaping */
+    uint8_t payload[40];
+    for (uint_fast8_t i = 0; i < sizeof(payload); ++i)
+    {
+        payload[i] = (uint8_t)(i * 29u);
+    }
+    const uint8_t prefix[2] = { 0x00, 0x00 };
+
+    uint16_t start;
+    uint32_t offset;
+    for (uint_fast16_t n = 0; n < BENCHMARK_ITERATIONS; ++n)
+    {
+        RingBuffer_Reset(&buffer);
+        start = Profile_Now();
+        P2PPE_TransmissionPrefixedToBuffer(prefix, sizeof(prefix), payload, sizeof(payload), &buffer);
+        Benchmark_Record(encode, start);
+
+        RingBuffer_Reset(&buffer);
+        start = Profile_Now();
+        P2PPE_CobsTransmissionPrefixedToBuffer(prefix, sizeof(prefix), payload, sizeof(payload), &buffer);
+        Benchmark_Record(cobs, start);
+
+        RingBuffer_Reset(&buffer);
+        start = Profile_Now();
+        RingBuffer_Write(&buffer, (uint8_t)n);
+        Benchmark_Record(write, start);
+
+        start = Profile_Now();
+        (void)RingBuffer_Read(&buffer);
+        Benchmark_Record(read, start);
+
+        uint32_t reserved;
+        start = Profile_Now();
+        if (0 == RingBuffer_Reserve(&buffer, 8, &reserved))
+        {
+            RingBuffer_Commit(&buffer, reserved + 8);
+        }
+        Benchmark_Record(reserve, start);
+
+        start = Profile_Now();
+        if (0 != RingBuffer_ClaimSpan(&buffer, &offset))
+        {
+            RingBuffer_ReleaseSpan(&buffer);
+        }
+        Benchmark_Record(claim, start);
+    }
+
+    return index;
+}
+
+/**
+* @brief Configures the I2C arbiter for a bus speed, with the pin assignment of main.c
+* @param[in] speed The bus frequency in Hz
+*/
+static void Benchmark_ConfigureI2C(const uint32_t speed)
+{
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[0], MMA8451Q_I2CADDR, I2C0, PORTE, 24, 5, 25, 5, speed);
+#if ENABLE_I2C1_EXTERNAL_BUS
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[1], MPU6050_I2CADDR, I2C1, PORTE, 1, 6, 0, 6, speed);
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[2], HMC5883L_I2CADDR, I2C1, PORTE, 1, 6, 0, 6, speed);
+#else
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[1], MPU6050_I2CADDR, I2C0, PORTB, 0, 2, 1, 2, speed);
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[2], HMC5883L_I2CADDR, I2C0, PORTB, 0, 2, 1, 2, speed);
+#endif
+    I2CArbiter_Configure(i2carbiter_entries, I2CARBITER_COUNT);
+}
+
+/**
+* @brief Times blocking reads of a sensor data block
+* @param[in] index The report entry to use
+* @param[in] kernel The kernel
+* @param[in] variant The bus speed in 10 kHz
+* @param[in] slaveId The sensor
+* @param[in] registerAddress The first register of the data block
+* @param[in] length The length of the data block
+*/
+static void Benchmark_SensorRead(const uint8_t index, const benchmark_kernel_t kernel, const uint8_t variant, const uint8_t slaveId, const uint8_t registerAddress, const uint8_t length)
+{
+    benchmark_entry_t *const entry = Benchmark_Entry(index, kernel, variant);
+
+    uint8_t block[16];
+    I2CArbiter_Select(slaveId);
+    for (uint_fast16_t n = 0; n < BENCHMARK_I2C_ITERATIONS; ++n)
+    {
+        const uint16_t start = Profile_Now();
+        if (I2C_STATUS_OK == I2C_ReadRegisters(slaveId, registerAddress, length, block))
+        {
+            Benchmark_Record(entry, start);
+        }
+    }
+}
+
+/**
+* @brief Times the sensor reads at every bus speed
+* @param[in] index The first report entry to use
+* @return The next free report entry
+*/
+static uint8_t Benchmark_I2C(uint8_t index)
+{
+    for (uint_fast8_t s = 0; s < BENCHMARK_I2C_SPEED_COUNT; ++s)
+    {
+        const uint8_t variant = (uint8_t)(benchmark_i2c_speeds[s] / 10000u);
+        Benchmark_ConfigureI2C(benchmark_i2c_speeds[s]);
+
+        Benchmark_SensorRead(index++, BENCHMARK_I2C_MPU6050_READ, variant, MPU6050_I2CADDR, MPU6050_REG_INT_STATUS, MPU6050_DATA_BLOCK_LENGTH);
+        Benchmark_SensorRead(index++, BENCHMARK_I2C_HMC5883L_READ, variant, HMC5883L_I2CADDR, HMC5883L_REG_DXRA, HMC5883L_DATA_BLOCK_LENGTH);
+        Benchmark_SensorRead(index++, BENCHMARK_I2C_MMA8451Q_READ, variant, MMA8451Q_I2CADDR, MMA8451Q_REG_STATUS, MMA8451Q_DATA_BLOCK_LENGTH);
+    }
+
+    return index;
+}
+
+/**
+* @brief Sends the report
+*/
+static void Benchmark_SendReport()
+{
+    const uint8_t prefix[4] = { BENCHMARK_REPORT_TYPE, BENCHMARK_REPORT_VERSION, BENCHMARK_ENTRY_COUNT, PROFILE_PRESCALER_SHIFT };
+    IO_SendFramePrefixed(prefix, sizeof(prefix), (const uint8_t*)benchmark_report, sizeof(benchmark_report));
+    RingBuffer_BlockWhileNotEmpty(&uartOutputFifo);
+}
+
+int main(void)
 {
     /* initialize the core clock and the systick timer */
     InitClock();
     InitSysTick();
-    
-    fusion_initialize();
 
-    v3d a = { F16(-0.99976), F16(0.026611), F16(-0.14551) };
+    /* initialize UART0 and its fifos */
+    InitUart0();
+    RingBuffer_Init(&uartInputFifo, &uartInputData, UART_RX_BUFFER_SIZE);
+    RingBuffer_Init(&uartOutputFifo, &uartOutputData, UART_TX_BUFFER_SIZE);
+    Uart0_InitializeIrq(&uartInputFifo, &uartOutputFifo);
+
+    /* the sensors are configured as in the application, blocking */
+    Parameters_Load();
+    I2C_Init(I2C0);
+#if ENABLE_I2C1_EXTERNAL_BUS
+    I2C_Init(I2C1);
+#endif
+    BitFlag_Set32(&SIM->SCGC5, SIM_SCGC5_PORTB_MASK | SIM_SCGC5_PORTE_MASK);
+    Benchmark_ConfigureI2C(I2C_SPEED_FAST);
+    ResetMMA8451Q();
+    InitHMC5883L();
+    InitMPU6050();
+    InitMMA8451Q();
+    RingBuffer_BlockWhileNotEmpty(&uartOutputFifo);
+
+    /* run every benchmark once; the kernels are disturbed by the tick interrupt only */
+    InitProfile();
+    Benchmark_Calibrate();
+
+    uint8_t index = 0;
+    index = Benchmark_Fusion(index);
+    index = Benchmark_Prepare(index);
+    index = Benchmark_Communication(index);
+    index = Benchmark_I2C(index);
+
+    for (;;)
+    {
+        Benchmark_SendReport();
+        delay_ms(BENCHMARK_REPORT_INTERVAL);
+    }
 
-    mpu6050_calibrate_accelerometer(&a.x, &a.y, &a.z);
-    
-    float x = fix16_to_float(a.x);
-    float y = fix16_to_float(a.y);
-    float z = fix16_to_float(a.z);
-    
-    for (;;) {}
+    return 0;
 }
 
-#endif 
\ No newline at end of file
+#endif // BENCHMARK_FIRMWARE
@@ -0,0 +1,163 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "comm/crc16.h"
+#include "cpu/flash.h"
+#include "imu/hmc5883l.h"
+#include "imu/mma8451q.h"
+#include "imu/mpu6050.h"
+
+#include "init_sensors.h"
+#include "parameters.h"
+
+/**
+* @brief The size check of the parameter block; the flash is programmed in longwords
+*/
+typedef char parameters_size_check_t[((sizeof(parameters_t) % sizeof(uint32_t)) == 0) && (sizeof(parameters_t) <= FLASH_SECTOR_SIZE) ? 1 : -1];
+
+/**
+* @brief The parameter sector, reserved in the linker script
+*/
+extern const uint32_t _sparameters[];
+
+/**
+* @brief The compiled-in parameters
+*
+* Calibration data is retrieved via MATLAB script and only valid for a specific board configuration.
+* Be sure to provide your own values here or YMMV.
+*/
+static const parameters_t parameters_default = {
+    .magic = PARAMETERS_MAGIC,
+    .version = PARAMETERS_VERSION,
+    .size = sizeof(parameters_t),
+    .calibration = {
+        .mpu6050_accelerometer = {
+            { F16(1.0062),      F16(0.0034341),     F16(-0.0027532),    F16(-0.0164) },
+            { F16(0.0034341),   F16(1.0008),        F16(-0.0056162),    F16(-0.016173) },
+            { F16(-0.0027532),  F16(-0.0056162),    F16(0.9931),        F16(0.02059) }
+        },
+        .mpu6050_gyroscope = {
+            { F16(1),           0,                  0,                  F16(-4.5446) },
+            { 0,                F16(1),             0,                  F16(-0.048858) },
+            { 0,                0,                  F16(1),             F16(-1.1197) }
+        },
+        .hmc5883l = {
+            { F16(0.98308),     F16(0.0025144),     F16(0.02777),       F16(0.0064502) },
+            { F16(0.0025144),   F16(0.92661),       F16(-0.043022),     F16(0.10543) },
+            { F16(0.02777),     F16(-0.043022),     F16(1.1128),        F16(-0.020258) }
+        },
+        .mma8451q_accelerometer = {
+            { F16(1),           0,                  0,                  0 },
+            { 0,                F16(1),             0,                  0 },
+            { 0,                0,                  F16(1),             0 }
+        },
+        .var_mpu6050_accelerometer  = { F16(9.8036e-06),    F16(9.6462e-06),    F16(2.4831e-05) },
+        .var_mpu6050_gyroscope      = { F16(0.016307),      F16(0.0084706),     F16(0.0129) },
+        .var_hmc5883l               = { F16(2.0347e-06),    F16(1.9233e-06),    F16(2.3021e-06) },
+        .var_mma8451q_accelerometer = { F16(1.5e-05),       F16(1.5e-05),       F16(1.5e-05) },
+    },
+    .fusion = {
+        .initial_r_axis = F16(0.05),
+        .initial_r_projection = F16(0.02),
+        .initial_r_gyro = F16(0.02),
+        .q_axis = F16(0),
+        .q_gyro = F16(1),
+        .alpha1 = F16(5),
+        .alpha2 = F16(.8),
+    },
+    .sensors = {
+#if DEBUG
+        .mpu6050_sample_rate_divider = 80,  /* the gyro samples at 8kHz, so division by 80 --> 100Hz */
+#else
+        .mpu6050_sample_rate_divider = 40,  /* the gyro samples at 8kHz, so division by 40 --> 200Hz */
+#endif
+        .mpu6050_gyroscope_full_scale = MPU6050_GYRO_FS_2000,
+        .mpu6050_accelerometer_full_scale = MPU6050_ACC_FS_4,
+        .hmc5883l_averaging = HMC5883L_MA_1,
+        .hmc5883l_output_rate = HMC5883L_DO_75Hz,
+        .hmc5883l_gain = HMC5883L_GN_1090_1p3Ga,
+        .mma8451q_sensitivity = MMA8451Q_SENSITIVITY_2G,
+        .mma8451q_data_rate = MMA8451Q_DATARATE_100Hz,
+    },
+    .reserved = 0,
+    .crc = 0
+};
+
+/**
+* @brief The parameters in use
+*/
+parameters_t parameters;
+
+/**
+* @brief Calculates the CRC of a parameter block
+* @param[in] block The block
+* @return The CRC of all bytes preceding the CRC field
+*/
+static uint16_t Parameters_Crc(const parameters_t *const block)
+{
+    return CRC16_Update(CRC16_INITIAL_VALUE, (const uint8_t *)block, offsetof(parameters_t, crc));
+}
+
+/**
+* @brief Checks a stored parameter block
+* @param[in] block The block
+* @return true if the block has the current layout, an intact CRC and a valid sensor configuration
+*/
+static bool Parameters_Valid(const parameters_t *const block)
+{
+    return (PARAMETERS_MAGIC == block->magic)
+        && (PARAMETERS_VERSION == block->version)
+        && (sizeof(parameters_t) == block->size)
+        && (Parameters_Crc(block) == block->crc)
+        && (block->sensors.mpu6050_sample_rate_divider > 0)
+        && (block->sensors.mpu6050_gyroscope_full_scale <= MPU6050_GYRO_FS_2000)
+        && (block->sensors.mpu6050_accelerometer_full_scale <= MPU6050_ACC_FS_16)
+        && (block->sensors.hmc5883l_averaging <= HMC5883L_MA_8)
+        && (block->sensors.hmc5883l_output_rate <= HMC5883L_DO_75Hz)
+        && (block->sensors.hmc5883l_gain <= HMC5883L_GN_230_8p1Ga)
+        && (block->sensors.mma8451q_sensitivity <= MMA8451Q_SENSITIVITY_8G)
+        && (block->sensors.mma8451q_data_rate <= MMA8451Q_DATARATE_1p5Hz);
+}
+
+/**
+* @brief Loads the stored parameters, or the compiled-in defaults if none are stored
+* @return true if the stored parameters were loaded
+*/
+bool Parameters_Load()
+{
+    const parameters_t *const stored = (const parameters_t *)_sparameters;
+    const bool valid = Parameters_Valid(stored);
+    memcpy(&parameters, valid ? stored : &parameters_default, sizeof(parameters_t));
+    return valid;
+}
+
+/**
+* @brief Stores the parameters in use in flash
+* @return 0 on success, otherwise the flash error flags or 0xFF if the verification failed
+*/
+uint8_t Parameters_Store()
+{
+    parameters.magic = PARAMETERS_MAGIC;
+    parameters.version = PARAMETERS_VERSION;
+    parameters.size = sizeof(parameters_t);
+    parameters.reserved = 0;
+    parameters.crc = Parameters_Crc(&parameters);
+
+    const uint32_t address = (uint32_t)_sparameters;
+    uint8_t status = Flash_EraseSector(address);
+    if (0 != status) return status;
+
+    status = Flash_Program(address, (const uint32_t *)&parameters, sizeof(parameters_t) / sizeof(uint32_t));
+    if (0 != status) return status;
+
+    return Parameters_Valid((const parameters_t *)_sparameters) ? 0 : 0xFF;
+}
+
+/**
+* @brief Erases the stored parameters, so that the next boot uses the defaults
+* @return 0 on success, otherwise the flash error flags
+*/
+uint8_t Parameters_Erase()
+{
+    return Flash_EraseSector((uint32_t)_sparameters);
+}
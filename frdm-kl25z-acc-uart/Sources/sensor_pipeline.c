@@ -0,0 +1,243 @@
+#include "comm/trace.h"
+#include "cpu/profile.h"
+#include "cpu/systick.h"
+#include "fusion/sensor_fusion.h"
+
+#include "sensor_pipeline.h"
+
+/**
+* @brief The fusion inputs, indexed by {@see sensor_channel_t}
+*/
+static void (*const sensor_sinks[SENSOR_CHANNEL_COUNT])(const v3d *const) = {
+    [SENSOR_CHANNEL_ACCELEROMETER] = fusion_set_accelerometer_v3d,
+    [SENSOR_CHANNEL_GYROSCOPE] = fusion_set_gyroscope_v3d,
+    [SENSOR_CHANNEL_MAGNETOMETER] = fusion_set_magnetometer_v3d,
+};
+
+/**
+* @brief Adds a driver to the pipeline
+* @param[in] pipeline The pipeline
+* @param[in] driver The driver; must stay valid
+* @return Zero on success, nonzero if the pipeline is full
+*/
+uint8_t SensorPipeline_Register(sensor_pipeline_t *const pipeline, const sensor_driver_t *const driver)
+{
+    if (pipeline->count >= SENSOR_PIPELINE_MAX_DRIVERS) return 1;
+
+    pipeline->drivers[pipeline->count++] = driver;
+    return 0;
+}
+
+/**
+* @brief Increments a saturating health counter
+* @param[in,out] counter The counter
+*/
+static inline void CountHealth(uint16_t *const counter)
+{
+    if (*counter != UINT16_MAX) ++*counter;
+}
+
+/**
+* @brief Accounts a decoded read to the health of its driver
+* @param[in,out] health The health of the driver
+* @param[in] event The decoded read
+* @param[in] valid Nonzero if the driver accepted the read
+*/
+static void RecordHealth(sensor_health_t *const health, const sensor_event_t *const event, const uint8_t valid)
+{
+    /* a dropped, repeated or empty read leaves the watchdog running */
+    if (!valid || (0 == event->channels) || (0 == event->count))
+    {
+        CountHealth(&health->report.staleReads);
+        return;
+    }
+
+    const uint32_t gap = event->timestamp - health->lastFresh;
+    if ((int32_t)gap > 0)
+    {
+        if (gap > health->report.maxGap) health->report.maxGap = gap;
+        health->lastFresh = event->timestamp;
+    }
+    CountHealth(&health->report.reads);
+}
+
+/**
+* @brief Decodes the oldest published read over all drivers
+* @param[in] pipeline The pipeline
+* @param[out] event The decoded read
+* @return Nonzero if a read was decoded
+*
+* The reads are taken in capture time order, so that a slow sensor does not
+* overtake a pending faster one. The queue slot is released after decoding.
+*/
+uint8_t SensorPipeline_Next(sensor_pipeline_t *const pipeline, sensor_event_t *const event)
+{
+    for (;;)
+    {
+        const sensor_driver_t *oldest = 0;
+        sensor_health_t *oldest_health = 0;
+        sample_entry_t oldest_entry;
+
+        for (uint_fast8_t i = 0; i < pipeline->count; ++i)
+        {
+            const sensor_driver_t *const driver = pipeline->drivers[i];
+            sample_entry_t entry;
+            if (!SampleQueue_Peek(driver->queue, &entry)) continue;
+
+            /* the difference is exact across the timer wrap-around */
+            if ((0 == oldest) || ((int32_t)(entry.timestamp - oldest_entry.timestamp) < 0))
+            {
+                oldest = driver;
+                oldest_health = &pipeline->health[i];
+                oldest_entry = entry;
+            }
+        }
+
+        if (0 == oldest) return 0;
+
+        event->driver = oldest;
+        event->timestamp = oldest_entry.timestamp;
+        event->sequence = oldest_entry.sequence;
+        event->count = 1;
+        event->channels = oldest->channels;
+
+        const uint8_t valid = oldest->decode(&oldest_entry, event);
+        SampleQueue_Release(oldest->queue);
+        RecordHealth(oldest_health, event, valid);
+
+        if (valid && (event->count > 0)) return 1;
+    }
+}
+
+/**
+* @brief Determines if any driver has a published read
+* @param[in] pipeline The pipeline
+* @return Nonzero if {@see SensorPipeline_Next} has a read to decode
+*/
+uint8_t SensorPipeline_Pending(const sensor_pipeline_t *const pipeline)
+{
+    for (uint_fast8_t i = 0; i < pipeline->count; ++i)
+    {
+        sample_entry_t entry;
+        if (SampleQueue_Peek(pipeline->drivers[i]->queue, &entry)) return 1;
+    }
+    return 0;
+}
+
+/**
+* @brief Re-initializes the sensors that delivered no fresh data for too long
+* @param[in] pipeline The pipeline
+* @param[in] now The current time in microseconds
+* @return Nonzero if a sensor was re-initialized
+*/
+uint8_t SensorPipeline_Watchdog(sensor_pipeline_t *const pipeline, const uint32_t now)
+{
+    uint8_t recovered = 0;
+
+    for (uint_fast8_t i = 0; i < pipeline->count; ++i)
+    {
+        const sensor_driver_t *const driver = pipeline->drivers[i];
+        if (0 == driver->expected_period) continue;
+
+        sensor_health_t *const health = &pipeline->health[i];
+        const uint32_t period = driver->expected_period();
+        health->report.expectedPeriod = period;
+
+        /* reads captured after now are in flight and count as fresh */
+        const int32_t silence = (int32_t)(now - health->lastFresh);
+        if (silence <= (int32_t)(SENSOR_HEALTH_TIMEOUT_PERIODS * period + SENSOR_HEALTH_TIMEOUT_SLACK_US)) continue;
+
+        CountHealth(&health->report.dropouts);
+        if (silence > (int32_t)health->report.maxGap) health->report.maxGap = (uint32_t)silence;
+        Trace_Send2(TRACE_SENSOR_DROPOUT, i, silence);
+
+        /* without a recovery, the next timeout is reported one period later */
+        health->lastFresh = now;
+        if (0 == driver->recover) continue;
+
+        driver->recover();
+        CountHealth(&health->report.recoveries);
+        recovered = 1;
+    }
+
+    /* the other sensors starved while the recovery blocked the loop */
+    if (recovered)
+    {
+        SensorPipeline_StartWatchdog(pipeline, SysTick_Microseconds());
+    }
+    return recovered;
+}
+
+/**
+* @brief Starts the watchdog timeouts of all drivers
+* @param[in] pipeline The pipeline
+* @param[in] now The current time in microseconds
+*/
+void SensorPipeline_StartWatchdog(sensor_pipeline_t *const pipeline, const uint32_t now)
+{
+    for (uint_fast8_t i = 0; i < pipeline->count; ++i)
+    {
+        pipeline->health[i].lastFresh = now;
+    }
+}
+
+/**
+* @brief Restarts the health accumulation of all drivers
+* @param[in] pipeline The pipeline
+* @param[out] reports The health since the last call, indexed by registration order; NULL to discard
+*/
+void SensorPipeline_Report(sensor_pipeline_t *const pipeline, sensor_health_report_t reports[SENSOR_PIPELINE_MAX_DRIVERS])
+{
+    for (uint_fast8_t i = 0; i < pipeline->count; ++i)
+    {
+        sensor_health_report_t *const report = &pipeline->health[i].report;
+        if (0 != reports) reports[i] = *report;
+
+        /* the expected period stays until the next watchdog check */
+        *report = (sensor_health_report_t){ .expectedPeriod = report->expectedPeriod };
+    }
+}
+
+/**
+* @brief Passes the newest sample of every fresh fused channel to the fusion engine
+* @param[in] event The decoded read
+* @param[out] prepared The samples fed, indexed by {@see sensor_channel_t}; only fed channels are written
+* @return The mask of the channels fed
+*/
+uint8_t SensorPipeline_Feed(const sensor_event_t *const event, v3d prepared[SENSOR_CHANNEL_COUNT])
+{
+    const sensor_driver_t *const driver = event->driver;
+    const uint8_t channels = event->channels & driver->sinks;
+    if ((0 == channels) || (0 == driver->prepare)) return 0;
+
+    for (uint_fast8_t channel = 0; channel < SENSOR_CHANNEL_COUNT; ++channel)
+    {
+        if (0 == (channels & SENSOR_CHANNEL_MASK(channel))) continue;
+
+        PROFILE_BEGIN(PROFILE_SENSOR_PREPARE);
+        driver->prepare((sensor_channel_t)channel, event->count - 1, &prepared[channel]);
+        PROFILE_END(PROFILE_SENSOR_PREPARE);
+
+        /* redundant sensors contribute to the primary's next observation only */
+        if (0 != driver->replica)
+        {
+            sensor_average_record((sensor_average_quantity_t)channel, driver->replica, event->timestamp, &prepared[channel]);
+            continue;
+        }
+
+        /* the replicas mirror the MPU6050, which also defines the accelerometer frame */
+        if ((SENSOR_CHANNEL_ACCELEROMETER != channel) || (ACCELEROMETER_SOURCE_MPU6050 == driver->accelerometer))
+        {
+            sensor_average((sensor_average_quantity_t)channel, event->timestamp, &prepared[channel], &prepared[channel]);
+        }
+
+        /* both accelerometers feed one observation */
+        if (SENSOR_CHANNEL_ACCELEROMETER == channel)
+        {
+            accelerometer_merge(driver->accelerometer, event->timestamp, &prepared[channel], &prepared[channel]);
+        }
+        sensor_sinks[channel](&prepared[channel]);
+    }
+
+    return (0 != driver->replica) ? 0 : channels;
+}
@@ -15,7 +15,7 @@ MACOS_FRAMEWORKS :=
 CFLAGS := -ggdb -ffunction-sections -std=c99 -O0
 CXXFLAGS := -ggdb -ffunction-sections -fno-exceptions -std=c99 -O0
 ASFLAGS := 
-LDFLAGS := -Wl,--gc-sections
+LDFLAGS := -Wl,--gc-sections -Wl,-Map=$(BINARYDIR)/$(basename $(TARGETNAME)).map -Wl,--print-memory-usage -Wl,--wrap=fix16_mul -Wl,--wrap=fix16_div -Wl,--wrap=fix16_sqrt
 COMMONFLAGS := 
 
 START_GROUP := -Wl,--start-group
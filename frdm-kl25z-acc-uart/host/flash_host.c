@@ -0,0 +1,44 @@
+/*
+ * flash_host.c
+ *
+ * Erased parameter sector and failing flash driver for the host build
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include "derivative.h"
+#include "cpu/flash.h"
+
+/**
+ * @brief The parameter sector, erased; {@see Parameters_Load} falls back to the compiled-in defaults
+ */
+const uint32_t _sparameters[FLASH_SECTOR_SIZE / sizeof(uint32_t)] = {
+	[0 ... (FLASH_SECTOR_SIZE / sizeof(uint32_t) - 1)] = 0xFFFFFFFFu
+};
+
+/**
+ * @brief Refuses to erase a sector
+ * @param[in] address The sector address
+ * @return The access error flag
+ */
+uint8_t Flash_EraseSector(const uint32_t address)
+{
+	(void)address;
+	return FTFA_FSTAT_ACCERR_MASK;
+}
+
+/**
+ * @brief Refuses to program longwords
+ * @param[in] address The address
+ * @param[in] data The longwords
+ * @param[in] count The number of longwords
+ * @return The access error flag
+ */
+uint8_t Flash_Program(uint32_t address, const uint32_t *data, uint32_t count)
+{
+	(void)address;
+	(void)data;
+	(void)count;
+	return FTFA_FSTAT_ACCERR_MASK;
+}
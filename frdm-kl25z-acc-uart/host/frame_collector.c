@@ -0,0 +1,323 @@
+/*
+ * frame_collector.c
+ *
+ * Decodes whole chunks of the serial stream into typed sample arrays per frame type
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "comm/batch.h"
+#include "comm/crc16.h"
+
+#include "frame_collector.h"
+
+/**
+ * @brief The frame types with a fixed sample layout, see the output modes in main.c
+ */
+static const frame_layout_t frame_layouts[] = {
+	{ .type = 0,	.batch = 0, .timestamped = 0, .valueSize = 4, .valueCount = 6 },	/* SENSORS_RAW: prepared accelerometer and magnetometer */
+	{ .type = 42,	.batch = 0, .timestamped = 0, .valueSize = 4, .valueCount = 3 },	/* RPY */
+	{ .type = 43,	.batch = 0, .timestamped = 0, .valueSize = 4, .valueCount = 4 },	/* QUATERNION */
+	{ .type = 44,	.batch = 0, .timestamped = 0, .valueSize = 4, .valueCount = 7 },	/* QUATERNION_RPY */
+	{ .type = 45,	.batch = 1, .timestamped = 0, .valueSize = 4, .valueCount = 4 },	/* QUATERNION_BATCH */
+	{ .type = 46,	.batch = 0, .timestamped = 0, .valueSize = 2, .valueCount = 4 },	/* QUATERNION_Q14 */
+	{ .type = 47,	.batch = 0, .timestamped = 0, .valueSize = 2, .valueCount = 7 },	/* QUATERNION_RPY_Q14 */
+	{ .type = 48,	.batch = 0, .timestamped = 0, .valueSize = 2, .valueCount = 3 },	/* QUATERNION_SMALLEST3 */
+	{ .type = 49,	.batch = 1, .timestamped = 1, .valueSize = 2, .valueCount = 7 },	/* RAW_CAPTURE, MPU6050 */
+	{ .type = 50,	.batch = 1, .timestamped = 1, .valueSize = 2, .valueCount = 3 },	/* RAW_CAPTURE, HMC5883L */
+	{ .type = 51,	.batch = 1, .timestamped = 1, .valueSize = 4, .valueCount = 4 },	/* QUATERNION_TIMESTAMPED */
+};
+
+#define FRAME_LAYOUT_COUNT	(sizeof(frame_layouts) / sizeof(frame_layouts[0]))
+
+/**
+ * @brief Gets the layout of a frame type
+ * @param[in] type The frame type
+ * @return The layout, NULL if the type has none
+ */
+const frame_layout_t* FrameCollector_Layout(const uint8_t type)
+{
+	for (size_t i = 0; i < FRAME_LAYOUT_COUNT; ++i)
+	{
+		if (type == frame_layouts[i].type) return &frame_layouts[i];
+	}
+	return NULL;
+}
+
+/**
+ * @brief Reads a little endian word
+ * @param[in] data The data
+ * @return The word
+ */
+static inline uint16_t read16(const uint8_t *const data)
+{
+	return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+/**
+ * @brief Reads a little endian longword
+ * @param[in] data The data
+ * @return The longword
+ */
+static inline uint32_t read32(const uint8_t *const data)
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/**
+ * @brief Grows an array to hold at least the given number of items
+ * @param[inout] items The array
+ * @param[inout] capacity The allocated items
+ * @param[in] required The required items
+ * @param[in] size The size of an item
+ * @return Zero on success
+ */
+static int reserve(void **const items, size_t *const capacity, const size_t required, const size_t size)
+{
+	if (required <= *capacity) return 0;
+
+	size_t grown = (0 == *capacity) ? 1024 : *capacity;
+	while (grown < required) grown *= 2;
+
+	void *const reallocated = realloc(*items, grown * size);
+	if (NULL == reallocated) return 1;
+
+	*items = reallocated;
+	*capacity = grown;
+	return 0;
+}
+
+/**
+ * @brief Appends samples in the frame byte order to the arrays of their type
+ * @param[in] collector The collector instance
+ * @param[in] samples The arrays of the type
+ * @param[in] data The first sample
+ * @param[in] count The number of samples
+ * @param[in] stride The size of a sample in the frame
+ */
+static void appendSamples(frame_collector_t *const collector, frame_samples_t *const samples, const uint8_t *data, const size_t count, const size_t stride)
+{
+	const frame_layout_t *const layout = samples->layout;
+	const size_t required = samples->count + count;
+	size_t timeCapacity = samples->capacity;
+
+	if ((layout->timestamped && reserve((void**)&samples->time, &timeCapacity, required, sizeof(uint32_t)))
+		|| reserve(&samples->values, &samples->capacity, required, (size_t)layout->valueCount * layout->valueSize))
+	{
+		collector->outOfMemory = 1;
+		return;
+	}
+
+	/* both arrays always grow to the same capacity */
+	if (layout->timestamped && timeCapacity != samples->capacity)
+	{
+		uint32_t *const time = realloc(samples->time, samples->capacity * sizeof(uint32_t));
+		if (NULL == time)
+		{
+			collector->outOfMemory = 1;
+			return;
+		}
+		samples->time = time;
+	}
+
+	for (size_t s = 0; s < count; ++s, data += stride)
+	{
+		const uint8_t *value = data;
+		if (layout->timestamped)
+		{
+			samples->time[samples->count] = read32(value);
+			value += sizeof(uint32_t);
+		}
+
+		if (sizeof(int16_t) == layout->valueSize)
+		{
+			int16_t *const target = (int16_t*)samples->values + samples->count * layout->valueCount;
+			for (uint8_t i = 0; i < layout->valueCount; ++i, value += 2) target[i] = (int16_t)read16(value);
+		}
+		else
+		{
+			int32_t *const target = (int32_t*)samples->values + samples->count * layout->valueCount;
+			for (uint8_t i = 0; i < layout->valueCount; ++i, value += 4) target[i] = (int32_t)read32(value);
+		}
+
+		++samples->count;
+	}
+}
+
+/**
+ * @brief Keeps a frame in order of arrival
+ * @param[in] collector The collector instance
+ * @param[in] frame The frame
+ * @param[in] length The frame length
+ */
+static void keepFrame(frame_collector_t *const collector, const uint8_t *const frame, const size_t length)
+{
+	if (reserve((void**)&collector->frameBytes, &collector->frameBytesCapacity, collector->frameBytesCount + length, 1)
+		|| reserve((void**)&collector->frameEnds, &collector->frameCapacity, collector->frameCount + 1, sizeof(size_t)))
+	{
+		collector->outOfMemory = 1;
+		return;
+	}
+
+	memcpy(&collector->frameBytes[collector->frameBytesCount], frame, length);
+	collector->frameBytesCount += length;
+	collector->frameEnds[collector->frameCount++] = collector->frameBytesCount;
+}
+
+/**
+ * @brief Sorts a decoded frame into the sample arrays of its type
+ * @param[in] frame The frame
+ * @param[in] length The frame length
+ * @param[in] context The {@see frame_collector_t}
+ */
+static void collectFrame(const uint8_t *const frame, const size_t length, void *const context)
+{
+	frame_collector_t *const collector = (frame_collector_t*)context;
+	frame_samples_t *const samples = &collector->samples[frame[0]];
+
+	if (collector->keepFrames)
+	{
+		keepFrame(collector, frame, length);
+	}
+
+	const frame_layout_t *const layout = samples->layout;
+	if (NULL == layout)
+	{
+		++samples->frames;
+		return;
+	}
+
+	const size_t sampleSize = (layout->timestamped ? sizeof(uint32_t) : 0) + (size_t)layout->valueCount * layout->valueSize;
+	if (!layout->batch)
+	{
+		if (1 + sampleSize != length)
+		{
+			++samples->errors;
+			return;
+		}
+
+		++samples->frames;
+		appendSamples(collector, samples, &frame[1], 1, sampleSize);
+		return;
+	}
+
+	/* the batch layout of batch.c: type, sequence, count, size, samples, crc */
+	if (length < BATCH_HEADER_LENGTH + BATCH_TRAILER_LENGTH)
+	{
+		++samples->errors;
+		return;
+	}
+
+	const size_t count = frame[3];
+	const size_t payloadEnd = BATCH_HEADER_LENGTH + count * sampleSize;
+	if ((frame[4] != sampleSize) || (length != payloadEnd + BATCH_TRAILER_LENGTH)
+		|| (read16(&frame[payloadEnd]) != CRC16_Update(CRC16_INITIAL_VALUE, frame, payloadEnd)))
+	{
+		++samples->errors;
+		return;
+	}
+
+	/* count the batches lost in between by their sequence number */
+	const uint16_t sequence = read16(&frame[1]);
+	if (samples->started)
+	{
+		samples->dropped += (uint16_t)(sequence - samples->sequence - 1);
+	}
+	samples->started = 1;
+	samples->sequence = sequence;
+
+	++samples->frames;
+	appendSamples(collector, samples, &frame[BATCH_HEADER_LENGTH], count, sampleSize);
+}
+
+/**
+ * @brief Initializes a collector
+ * @param[in] collector The collector instance
+ * @param[in] framing The framing of the stream
+ * @param[in] keepFrames Nonzero to keep every frame, see {@see FrameCollector_Frame}
+ */
+void FrameCollector_Init(frame_collector_t *const collector, const frame_framing_t framing, const uint8_t keepFrames)
+{
+	memset(collector, 0, sizeof(*collector));
+	FrameDecoder_Init(&collector->decoder, framing);
+	collector->keepFrames = keepFrames;
+
+	for (int type = 0; type < FRAME_TYPE_COUNT; ++type)
+	{
+		collector->samples[type].layout = FrameCollector_Layout((uint8_t)type);
+	}
+}
+
+/**
+ * @brief Decodes a chunk of the received stream
+ * @param[in] collector The collector instance
+ * @param[in] bytes The received bytes
+ * @param[in] count The number of bytes
+ * @return The number of frames completed within this chunk
+ *
+ * The samples and frames are appended to those of the previous chunks until
+ * {@see FrameCollector_Clear}; frames may span chunks.
+ */
+uint32_t FrameCollector_Feed(frame_collector_t *const collector, const uint8_t *const bytes, const size_t count)
+{
+	return FrameDecoder_Feed(&collector->decoder, bytes, count, collectFrame, collector);
+}
+
+/**
+ * @brief Gets a kept frame
+ * @param[in] collector The collector instance
+ * @param[in] index The frame, less than frameCount
+ * @param[out] length The frame length
+ * @return The frame, starting with the type
+ */
+const uint8_t* FrameCollector_Frame(const frame_collector_t *const collector, const size_t index, size_t *const length)
+{
+	const size_t start = (0 == index) ? 0 : collector->frameEnds[index - 1];
+	*length = collector->frameEnds[index] - start;
+	return &collector->frameBytes[start];
+}
+
+/**
+ * @brief Forgets the collected samples and frames, but keeps the decoder state and the statistics
+ * @param[in] collector The collector instance
+ */
+void FrameCollector_Clear(frame_collector_t *const collector)
+{
+	for (int type = 0; type < FRAME_TYPE_COUNT; ++type)
+	{
+		collector->samples[type].count = 0;
+	}
+	collector->frameBytesCount = 0;
+	collector->frameCount = 0;
+	collector->outOfMemory = 0;
+}
+
+/**
+ * @brief Releases the memory of a collector
+ * @param[in] collector The collector instance
+ *
+ * The collector must be initialized again before further use.
+ */
+void FrameCollector_Free(frame_collector_t *const collector)
+{
+	for (int type = 0; type < FRAME_TYPE_COUNT; ++type)
+	{
+		free(collector->samples[type].time);
+		free(collector->samples[type].values);
+		collector->samples[type].time = NULL;
+		collector->samples[type].values = NULL;
+		collector->samples[type].count = 0;
+		collector->samples[type].capacity = 0;
+	}
+
+	free(collector->frameBytes);
+	free(collector->frameEnds);
+	collector->frameBytes = NULL;
+	collector->frameEnds = NULL;
+	collector->frameBytesCount = collector->frameBytesCapacity = 0;
+	collector->frameCount = collector->frameCapacity = 0;
+}
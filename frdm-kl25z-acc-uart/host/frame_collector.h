@@ -0,0 +1,123 @@
+/*
+ * frame_collector.h
+ *
+ * Decodes whole chunks of the serial stream into typed sample arrays per frame type
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef FRAME_COLLECTOR_H_
+#define FRAME_COLLECTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_decoder.h"
+
+/**
+ * @brief The number of frame types
+ */
+#define FRAME_TYPE_COUNT	(256)
+
+/**
+ * @brief The layout of the samples of a frame type
+ *
+ * Single frames carry one sample after the type byte. Batch frames carry the
+ * header, samples and CRC of batch.c; timestamped samples lead with the uint32
+ * capture time in microseconds.
+ */
+typedef struct {
+	uint8_t type;			/*< The frame type, see {@see output_mode_t} */
+	uint8_t batch;			/*< Nonzero for the batch frames of batch.c */
+	uint8_t timestamped;	/*< Nonzero if every sample leads with a timestamp */
+	uint8_t valueSize;		/*< The size of a value: 2 for int16, 4 for int32 (fix16) */
+	uint8_t valueCount;		/*< The number of values per sample */
+} frame_layout_t;
+
+/**
+ * @brief The samples of a frame type, decoded into host byte order
+ */
+typedef struct {
+	const frame_layout_t *layout;	/*< The layout; NULL for types without a known layout */
+	size_t count;					/*< The number of samples */
+	size_t capacity;				/*< The allocated samples */
+	uint32_t *time;					/*< The timestamps of timestamped layouts, otherwise NULL */
+	void *values;					/*< count*valueCount values of int16_t or int32_t */
+	uint32_t frames;				/*< The number of valid frames */
+	uint32_t errors;				/*< The frames with a bad length or checksum */
+	uint32_t dropped;				/*< The batches missing by sequence number */
+	uint16_t sequence;				/*< The sequence number of the last batch */
+	uint8_t started;				/*< Nonzero once a batch was seen */
+} frame_samples_t;
+
+/**
+ * @brief Collector state
+ *
+ * Besides the typed samples, the collector optionally keeps every frame in order
+ * of arrival, for frame types without a layout and for per-frame dispatch.
+ */
+typedef struct {
+	frame_decoder_t decoder;					/*< The stream decoder */
+	frame_samples_t samples[FRAME_TYPE_COUNT];	/*< The samples per frame type */
+	uint8_t keepFrames;							/*< Nonzero if the frames are kept */
+	uint8_t *frameBytes;						/*< The kept frames, back to back */
+	size_t frameBytesCount;						/*< The number of bytes of the kept frames */
+	size_t frameBytesCapacity;					/*< The allocated bytes */
+	size_t *frameEnds;							/*< The end offset of every kept frame */
+	size_t frameCount;							/*< The number of kept frames */
+	size_t frameCapacity;						/*< The allocated frame offsets */
+	uint8_t outOfMemory;						/*< Nonzero if samples or frames had to be discarded */
+} frame_collector_t;
+
+/**
+ * @brief Initializes a collector
+ * @param[in] collector The collector instance
+ * @param[in] framing The framing of the stream
+ * @param[in] keepFrames Nonzero to keep every frame, see {@see FrameCollector_Frame}
+ */
+void FrameCollector_Init(frame_collector_t *const collector, const frame_framing_t framing, const uint8_t keepFrames);
+
+/**
+ * @brief Decodes a chunk of the received stream
+ * @param[in] collector The collector instance
+ * @param[in] bytes The received bytes
+ * @param[in] count The number of bytes
+ * @return The number of frames completed within this chunk
+ *
+ * The samples and frames are appended to those of the previous chunks until
+ * {@see FrameCollector_Clear}; frames may span chunks.
+ */
+uint32_t FrameCollector_Feed(frame_collector_t *const collector, const uint8_t *const bytes, const size_t count);
+
+/**
+ * @brief Gets a kept frame
+ * @param[in] collector The collector instance
+ * @param[in] index The frame, less than frameCount
+ * @param[out] length The frame length
+ * @return The frame, starting with the type
+ */
+const uint8_t* FrameCollector_Frame(const frame_collector_t *const collector, const size_t index, size_t *const length);
+
+/**
+ * @brief Forgets the collected samples and frames, but keeps the decoder state and the statistics
+ * @param[in] collector The collector instance
+ */
+void FrameCollector_Clear(frame_collector_t *const collector);
+
+/**
+ * @brief Releases the memory of a collector
+ * @param[in] collector The collector instance
+ *
+ * The collector must be initialized again before further use.
+ */
+void FrameCollector_Free(frame_collector_t *const collector);
+
+/**
+ * @brief Gets the layout of a frame type
+ * @param[in] type The frame type
+ * @return The layout, NULL if the type has none
+ */
+const frame_layout_t* FrameCollector_Layout(const uint8_t type);
+
+#endif /* FRAME_COLLECTOR_H_ */
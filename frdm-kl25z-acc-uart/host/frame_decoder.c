@@ -0,0 +1,232 @@
+/*
+ * frame_decoder.c
+ *
+ * Host side decoder of the P2PPE and COBS framed serial stream
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include "frame_decoder.h"
+
+#define PREAMBLE_FIRST	0xDA /*< first preamble byte, see p2pprotocol.c */
+#define PREAMBLE_SECOND	0x7A /*< second preamble byte */
+#define SOH				0x01 /*< start of header */
+#define EOT				0x04 /*< end of transmission */
+#define ESC				0x1B /*< escape */
+#define ESC_XOR			0x42 /*< value the escaped data bytes are XORed with */
+
+/**
+ * @brief The P2PPE decoder states, as in {@see P2PPE_Decode}
+ */
+typedef enum {
+	DECODER_AWAIT_PREAMBLE	= 0,	/*< Searching for the preamble */
+	DECODER_AWAIT_SOH		= 1,	/*< Preamble found, expecting SOH */
+	DECODER_AWAIT_LENGTH	= 2,	/*< SOH found, expecting the length */
+	DECODER_READ_DATA		= 3,	/*< Reading the payload */
+	DECODER_AWAIT_EOT		= 4		/*< Payload complete, expecting EOT */
+} decoder_state_t;
+
+/**
+ * @brief Resets a frame decoder
+ * @param[in] decoder The decoder instance
+ * @param[in] framing The framing of the stream, see {@see IO_SetFraming}
+ */
+void FrameDecoder_Init(frame_decoder_t *const decoder, const frame_framing_t framing)
+{
+	decoder->framing = framing;
+	decoder->state = DECODER_AWAIT_PREAMBLE;
+	decoder->lastByte = 0;
+	decoder->escape = 0;
+	decoder->cobsCode = 0;
+	decoder->cobsRemaining = 0;
+	decoder->discard = 0;
+	decoder->length = 0;
+	decoder->count = 0;
+	decoder->frames = 0;
+	decoder->errors = 0;
+}
+
+/**
+ * @brief Feeds a byte into the P2PPE state machine
+ * @param[in] decoder The decoder instance
+ * @param[in] byte The received byte
+ * @return Nonzero if the byte completed a frame
+ */
+static inline uint8_t decodeEscaped(frame_decoder_t *const decoder, uint8_t byte)
+{
+	switch (decoder->state)
+	{
+		case DECODER_AWAIT_PREAMBLE:
+		{
+			if (PREAMBLE_FIRST == decoder->lastByte && PREAMBLE_SECOND == byte)
+			{
+				decoder->state = DECODER_AWAIT_SOH;
+			}
+			decoder->lastByte = byte;
+			break;
+		}
+		case DECODER_AWAIT_SOH:
+		{
+			decoder->state = (SOH == byte) ? DECODER_AWAIT_LENGTH : DECODER_AWAIT_PREAMBLE;
+			decoder->lastByte = 0;
+			break;
+		}
+		case DECODER_AWAIT_LENGTH:
+		{
+			if (0 == byte)
+			{
+				decoder->state = DECODER_AWAIT_PREAMBLE;
+				++decoder->errors;
+				break;
+			}
+
+			decoder->length = byte;
+			decoder->count = 0;
+			decoder->escape = 0;
+			decoder->state = DECODER_READ_DATA;
+			break;
+		}
+		case DECODER_READ_DATA:
+		{
+			if (ESC == byte)
+			{
+				decoder->escape = 1;
+				break;
+			}
+
+			/* an unescaped EOT within the payload means a byte was lost */
+			if (EOT == byte)
+			{
+				decoder->state = DECODER_AWAIT_PREAMBLE;
+				++decoder->errors;
+				break;
+			}
+
+			if (decoder->escape)
+			{
+				byte ^= ESC_XOR;
+				decoder->escape = 0;
+			}
+
+			decoder->data[decoder->count++] = byte;
+			if (decoder->count == decoder->length)
+			{
+				decoder->state = DECODER_AWAIT_EOT;
+			}
+			break;
+		}
+		case DECODER_AWAIT_EOT:
+		default:
+		{
+			decoder->state = DECODER_AWAIT_PREAMBLE;
+			decoder->lastByte = byte;
+			if (EOT == byte)
+			{
+				return 1;
+			}
+			++decoder->errors;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Feeds a byte into the COBS state machine
+ * @param[in] decoder The decoder instance
+ * @param[in] byte The received byte
+ * @return Nonzero if the byte completed a frame
+ */
+static inline uint8_t decodeCobs(frame_decoder_t *const decoder, const uint8_t byte)
+{
+	/* delimiter: the frame is complete if the last block was read entirely */
+	if (0 == byte)
+	{
+		const uint8_t complete = !decoder->discard && (0 != decoder->cobsCode) && (0 == decoder->cobsRemaining);
+		if ((0 != decoder->cobsCode) && !complete)
+		{
+			++decoder->errors;
+		}
+		decoder->cobsCode = 0;
+		decoder->cobsRemaining = 0;
+		decoder->discard = 0;
+		return complete;
+	}
+
+	if (decoder->discard) return 0;
+
+	/* block code */
+	if (0 == decoder->cobsRemaining)
+	{
+		if (0 == decoder->cobsCode)
+		{
+			/* first block of a frame */
+			decoder->count = 0;
+		}
+		else if (decoder->cobsCode < 0xFF)
+		{
+			/* the previous block ended in an encoded zero */
+			if (decoder->count >= FRAME_DECODER_MAX_LENGTH) goto overflow;
+			decoder->data[decoder->count++] = 0;
+		}
+		decoder->cobsCode = byte;
+		decoder->cobsRemaining = byte - 1;
+		return 0;
+	}
+
+	/* block data */
+	if (decoder->count >= FRAME_DECODER_MAX_LENGTH) goto overflow;
+	decoder->data[decoder->count++] = byte;
+	--decoder->cobsRemaining;
+	return 0;
+
+overflow:
+	/* skip the rest of the frame */
+	decoder->cobsCode = 0xFF;
+	decoder->discard = 1;
+	return 0;
+}
+
+/**
+ * @brief Decodes a chunk of the received stream
+ * @param[in] decoder The decoder instance
+ * @param[in] bytes The received bytes
+ * @param[in] count The number of bytes
+ * @param[in] handler Called once per completed frame
+ * @param[in] context Passed to the handler
+ * @return The number of frames completed within this chunk
+ *
+ * Frames may span chunks; the state is kept in the decoder.
+ */
+uint32_t FrameDecoder_Feed(frame_decoder_t *const decoder, const uint8_t *bytes, size_t count, const frame_handler_t handler, void *const context)
+{
+	uint32_t frames = 0;
+
+	if (FRAME_FRAMING_COBS == decoder->framing)
+	{
+		while (count-- > 0)
+		{
+			if (decodeCobs(decoder, *bytes++))
+			{
+				handler(decoder->data, decoder->count, context);
+				++frames;
+			}
+		}
+	}
+	else
+	{
+		while (count-- > 0)
+		{
+			if (decodeEscaped(decoder, *bytes++))
+			{
+				handler(decoder->data, decoder->count, context);
+				++frames;
+			}
+		}
+	}
+
+	decoder->frames += frames;
+	return frames;
+}
@@ -0,0 +1,82 @@
+/*
+ * frame_decoder.h
+ *
+ * Host side decoder of the P2PPE and COBS framed serial stream
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef FRAME_DECODER_H_
+#define FRAME_DECODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The framing of the stream, with the values of {@see io_framing_t}
+ *
+ * Repeated here so that the decoder builds without the firmware headers, e.g. as MEX file.
+ */
+typedef enum {
+	FRAME_FRAMING_ESCAPE	= 0x00,	/*! P2PPE framing with preamble, length and ESC/XOR stuffing */
+	FRAME_FRAMING_COBS		= 0x01	/*! Consistent Overhead Byte Stuffing with zero delimiter */
+} frame_framing_t;
+
+/**
+ * @brief The maximum frame length
+ *
+ * Covers the 255 byte P2PPE payload and a COBS frame of a full prefix and data.
+ */
+#define FRAME_DECODER_MAX_LENGTH	(512)
+
+/**
+ * @brief Frame decoder state
+ *
+ * Unlike {@see p2ppe_decoder_t}, the decoder accepts frames of any length the firmware
+ * sends and both framings of {@see frame_framing_t}.
+ */
+typedef struct {
+	frame_framing_t framing;	/*< The framing of the stream */
+	uint8_t state;			/*< The P2PPE decoder state */
+	uint8_t lastByte;		/*< The previous byte, used for preamble detection */
+	uint8_t escape;			/*< Nonzero if the previous data byte was an escape */
+	uint8_t cobsCode;		/*< The code of the current COBS block, zero between frames */
+	uint8_t cobsRemaining;	/*< The data bytes left in the current COBS block */
+	uint8_t discard;		/*< Nonzero if the current COBS frame is too long and skipped up to the delimiter */
+	uint16_t length;		/*< The announced P2PPE payload length */
+	uint16_t count;			/*< The number of payload bytes decoded so far */
+	uint32_t frames;		/*< The number of decoded frames */
+	uint32_t errors;		/*< The number of discarded frames */
+	uint8_t data[FRAME_DECODER_MAX_LENGTH];	/*< The decoded payload */
+} frame_decoder_t;
+
+/**
+ * @brief Receives a decoded frame
+ * @param[in] frame The payload, starting with the frame type
+ * @param[in] length The payload length
+ * @param[in] context The context given to {@see FrameDecoder_Feed}
+ */
+typedef void (*frame_handler_t)(const uint8_t *const frame, const size_t length, void *const context);
+
+/**
+ * @brief Resets a frame decoder
+ * @param[in] decoder The decoder instance
+ * @param[in] framing The framing of the stream, see {@see IO_SetFraming}
+ */
+void FrameDecoder_Init(frame_decoder_t *const decoder, const frame_framing_t framing);
+
+/**
+ * @brief Decodes a chunk of the received stream
+ * @param[in] decoder The decoder instance
+ * @param[in] bytes The received bytes
+ * @param[in] count The number of bytes
+ * @param[in] handler Called once per completed frame
+ * @param[in] context Passed to the handler
+ * @return The number of frames completed within this chunk
+ *
+ * Frames may span chunks; the state is kept in the decoder.
+ */
+uint32_t FrameDecoder_Feed(frame_decoder_t *const decoder, const uint8_t *bytes, size_t count, const frame_handler_t handler, void *const context);
+
+#endif /* FRAME_DECODER_H_ */
@@ -0,0 +1,462 @@
+/*
+ * fusion_accuracy.c
+ *
+ * Replays captures through one build variant of the fusion core and compares the
+ * orientation against the quaternions of a reference variant
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fixmath.h"
+#include "fixquat.h"
+
+#include "parameters.h"
+#include "replay.h"
+
+/**
+ * @brief The default time in seconds after the first sample that is excluded from the statistics
+ *
+ * The variants converge differently from the initial state; the budget applies to the tracking.
+ */
+#define ACCURACY_DEFAULT_WARMUP	(2.0)
+
+/**
+ * @brief The counted libfixmath functions
+ */
+typedef enum {
+	ACCURACY_OP_ADD = 0,		/*< fix16_add */
+	ACCURACY_OP_SUB = 1,		/*< fix16_sub */
+	ACCURACY_OP_MUL = 2,		/*< fix16_mul */
+	ACCURACY_OP_DIV = 3,		/*< fix16_div */
+	ACCURACY_OP_SQRT = 4,		/*< fix16_sqrt */
+	ACCURACY_OP_COUNT = 5		/*< The number of counted functions */
+} accuracy_op_t;
+
+/**
+ * @brief The libfixmath calls, counted while {@see accuracy_counting} is nonzero
+ */
+static uint64_t accuracy_ops[ACCURACY_OP_COUNT];
+
+/**
+ * @brief Nonzero while the libfixmath calls are counted
+ *
+ * The timed run does not count, so that the counters do not distort the times.
+ */
+static int accuracy_counting = 0;
+
+fix16_t __real_fix16_add(fix16_t a, fix16_t b);
+fix16_t __real_fix16_sub(fix16_t a, fix16_t b);
+fix16_t __real_fix16_mul(fix16_t a, fix16_t b);
+fix16_t __real_fix16_div(fix16_t a, fix16_t b);
+fix16_t __real_fix16_sqrt(fix16_t value);
+
+fix16_t __wrap_fix16_add(fix16_t a, fix16_t b) { accuracy_ops[ACCURACY_OP_ADD] += accuracy_counting; return __real_fix16_add(a, b); }
+fix16_t __wrap_fix16_sub(fix16_t a, fix16_t b) { accuracy_ops[ACCURACY_OP_SUB] += accuracy_counting; return __real_fix16_sub(a, b); }
+fix16_t __wrap_fix16_mul(fix16_t a, fix16_t b) { accuracy_ops[ACCURACY_OP_MUL] += accuracy_counting; return __real_fix16_mul(a, b); }
+fix16_t __wrap_fix16_div(fix16_t a, fix16_t b) { accuracy_ops[ACCURACY_OP_DIV] += accuracy_counting; return __real_fix16_div(a, b); }
+fix16_t __wrap_fix16_sqrt(fix16_t value) { accuracy_ops[ACCURACY_OP_SQRT] += accuracy_counting; return __real_fix16_sqrt(value); }
+
+/**
+ * @brief An orientation of the replay
+ */
+typedef struct {
+	int64_t time;			/*< The capture time in microseconds */
+	double q[4];			/*< The quaternion w, x, y, z */
+} accuracy_sample_t;
+
+/**
+ * @brief The orientations of a replay
+ */
+typedef struct {
+	accuracy_sample_t *samples;		/*< The orientations in capture order */
+	size_t count;					/*< The number of orientations */
+	size_t capacity;				/*< The allocated orientations */
+} accuracy_track_t;
+
+/**
+ * @brief Appends an orientation to a track
+ * @param[in] track The track
+ * @param[in] time The capture time in microseconds
+ * @param[in] q The quaternion w, x, y, z
+ * @return Zero on success
+ */
+static int accuracy_append(accuracy_track_t *const track, const int64_t time, const double q[4])
+{
+	if (track->count == track->capacity)
+	{
+		const size_t capacity = (0 == track->capacity) ? 4096 : 2 * track->capacity;
+		accuracy_sample_t *const samples = realloc(track->samples, capacity * sizeof(accuracy_sample_t));
+		if (NULL == samples) return 1;
+
+		track->samples = samples;
+		track->capacity = capacity;
+	}
+
+	accuracy_sample_t *const sample = &track->samples[track->count++];
+	sample->time = time;
+	memcpy(sample->q, q, sizeof(sample->q));
+	return 0;
+}
+
+/**
+ * @brief Records the orientation after every fused sample
+ * @param[in] time The capture time in microseconds
+ * @param[in] orientation The orientation
+ * @param[in] context The {@see accuracy_track_t}
+ */
+static void accuracy_record(const int64_t time, const qf16 *const orientation, void *const context)
+{
+	const double q[4] = {
+		fix16_to_dbl(orientation->a), fix16_to_dbl(orientation->b),
+		fix16_to_dbl(orientation->c), fix16_to_dbl(orientation->d)
+	};
+
+	/* an allocation failure shows as a sample count mismatch */
+	accuracy_append((accuracy_track_t*)context, time, q);
+}
+
+/**
+ * @brief Reads the quaternions of a reference run, as written by -o
+ * @param[out] track The track
+ * @param[in] path The file
+ * @return Zero on success
+ */
+static int accuracy_load(accuracy_track_t *const track, const char *const path)
+{
+	FILE *const file = fopen(path, "r");
+	if (NULL == file) return 1;
+
+	char line[256];
+	int result = 0;
+	while (0 == result && NULL != fgets(line, sizeof(line), file))
+	{
+		long long time;
+		double q[4];
+		if (5 != sscanf(line, "%lld,%lf,%lf,%lf,%lf", &time, &q[0], &q[1], &q[2], &q[3])) continue;
+		result = accuracy_append(track, (int64_t)time, q);
+	}
+
+	fclose(file);
+	return result;
+}
+
+/**
+ * @brief Multiplies two quaternions, as quaternionMul.m
+ * @param[out] c The product a*b
+ * @param[in] a The first quaternion w, x, y, z
+ * @param[in] b The second quaternion w, x, y, z
+ */
+static void accuracy_multiply(double c[4], const double a[4], const double b[4])
+{
+	c[0] = a[0] * b[0] - (a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+	c[1] = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+	c[2] = a[0] * b[2] + a[2] * b[0] + a[3] * b[1] - a[1] * b[3];
+	c[3] = a[0] * b[3] + a[3] * b[0] + a[1] * b[2] - a[2] * b[1];
+}
+
+/**
+ * @brief Converts a quaternion to roll, pitch and yaw, as quaternionToEuler.m
+ * @param[in] q The quaternion w, x, y, z
+ * @param[out] angles The roll, pitch and yaw in degrees
+ */
+static void accuracy_euler(const double q[4], double angles[3])
+{
+	const double qw = q[0], qx = q[1], qy = q[2], qz = q[3];
+
+	const double rotateXa0 = 2.0 * (qy * qz + qw * qx);
+	const double rotateXa1 = qw * qw - qx * qx - qy * qy + qz * qz;
+	const double rotateX = (0.0 != rotateXa0 && 0.0 != rotateXa1) ? atan2(rotateXa0, rotateXa1) : 0.0;
+
+	const double rotateYa0 = -2.0 * (qx * qz - qw * qy);
+	const double rotateY = (rotateYa0 >= 1.0) ? M_PI / 2.0 : ((rotateYa0 <= -1.0) ? -M_PI / 2.0 : asin(rotateYa0));
+
+	const double rotateZa0 = 2.0 * (qx * qy + qw * qz);
+	const double rotateZa1 = qw * qw + qx * qx - qy * qy - qz * qz;
+	const double rotateZ = (0.0 != rotateZa0 && 0.0 != rotateZa1) ? atan2(rotateZa0, rotateZa1) : 0.0;
+
+	angles[0] = rotateX * 180.0 / M_PI;
+	angles[1] = rotateY * 180.0 / M_PI;
+	angles[2] = rotateZ * 180.0 / M_PI;
+}
+
+/**
+ * @brief Calculates the rotation angle between two orientations
+ * @param[in] reference The reference quaternion w, x, y, z
+ * @param[in] q The compared quaternion w, x, y, z
+ * @return The angle of conj(reference)*q in degrees, in [0, 180]
+ *
+ * Both quaternions are normalized first, since the fixed point quaternions are only
+ * close to unit length; q and -q are the same orientation.
+ */
+static double accuracy_angle(const double reference[4], const double q[4])
+{
+	const double rn = sqrt(reference[0] * reference[0] + reference[1] * reference[1] + reference[2] * reference[2] + reference[3] * reference[3]);
+	const double qn = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	if (0.0 == rn || 0.0 == qn) return 180.0;
+
+	/* the conjugate, as quaternionConj.m */
+	const double conjugate[4] = { reference[0] / rn, -reference[1] / rn, -reference[2] / rn, -reference[3] / rn };
+	const double normalized[4] = { q[0] / qn, q[1] / qn, q[2] / qn, q[3] / qn };
+
+	double error[4];
+	accuracy_multiply(error, conjugate, normalized);
+
+	const double vector = sqrt(error[1] * error[1] + error[2] * error[2] + error[3] * error[3]);
+	return 2.0 * atan2(vector, fabs(error[0])) * 180.0 / M_PI;
+}
+
+/**
+ * @brief Wraps an angle difference into [-180, 180)
+ * @param[in] degrees The difference in degrees
+ * @return The wrapped difference
+ */
+static double accuracy_wrap(const double degrees)
+{
+	return degrees - 360.0 * floor((degrees + 180.0) / 360.0);
+}
+
+/**
+ * @brief Orders doubles ascending, for qsort
+ */
+static int accuracy_compare(const void *const a, const void *const b)
+{
+	const double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief The error statistics of a variant
+ */
+typedef struct {
+	size_t count;			/*< The number of compared orientations after the warm-up */
+	double mean;			/*< The mean angular error in degrees */
+	double rms;				/*< The root mean square angular error in degrees */
+	double p95;				/*< The 95th percentile of the angular error in degrees */
+	double max;				/*< The largest angular error in degrees */
+	double euler[3];		/*< The largest roll, pitch and yaw errors in degrees */
+} accuracy_errors_t;
+
+/**
+ * @brief Compares the orientations of a variant with the reference
+ * @param[out] errors The statistics
+ * @param[in] reference The reference orientations
+ * @param[in] track The orientations of the variant
+ * @param[in] warmup The time in seconds after the first sample that is skipped
+ * @return Zero on success, nonzero if the tracks do not stem from the same capture
+ *
+ * The euler angle errors skip orientations within a degree of the pitch singularity,
+ * where roll and yaw are not defined.
+ */
+static int accuracy_evaluate(accuracy_errors_t *const errors, const accuracy_track_t *const reference, const accuracy_track_t *const track, const double warmup)
+{
+	memset(errors, 0, sizeof(*errors));
+	if (reference->count != track->count) return 1;
+	if (0 == track->count) return 0;
+
+	double *const angles = malloc(track->count * sizeof(double));
+	if (NULL == angles) return 1;
+
+	const int64_t start = reference->samples[0].time + (int64_t)(warmup * 1e6);
+	double sum = 0, squares = 0;
+
+	for (size_t i = 0; i < track->count; ++i)
+	{
+		const accuracy_sample_t *const expected = &reference->samples[i];
+		const accuracy_sample_t *const actual = &track->samples[i];
+		if (expected->time != actual->time)
+		{
+			free(angles);
+			return 1;
+		}
+		if (actual->time < start) continue;
+
+		const double angle = accuracy_angle(expected->q, actual->q);
+		angles[errors->count++] = angle;
+		sum += angle;
+		squares += angle * angle;
+		if (angle > errors->max) errors->max = angle;
+
+		double e[3], a[3];
+		accuracy_euler(expected->q, e);
+		accuracy_euler(actual->q, a);
+		if (fabs(e[1]) > 89.0) continue;
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const double difference = fabs(accuracy_wrap(a[axis] - e[axis]));
+			if (difference > errors->euler[axis]) errors->euler[axis] = difference;
+		}
+	}
+
+	if (errors->count > 0)
+	{
+		errors->mean = sum / (double)errors->count;
+		errors->rms = sqrt(squares / (double)errors->count);
+
+		qsort(angles, errors->count, sizeof(double), accuracy_compare);
+		errors->p95 = angles[(size_t)(0.95 * (double)(errors->count - 1))];
+	}
+
+	free(angles);
+	return 0;
+}
+
+/**
+ * @brief Reads the monotonic clock
+ * @return The time in seconds
+ */
+static double accuracy_now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + 1e-9 * (double)now.tv_nsec;
+}
+
+/**
+ * @brief Prints the usage
+ * @param[in] program The program name
+ */
+static void accuracy_usage(const char *const program)
+{
+	fprintf(stderr, "usage: %s [-c] [-n name] [-w seconds] [-o out.csv] [-r reference.csv [-m max_deg] [-s rms_deg]] capture.bin\n", program);
+	fprintf(stderr, "  -c  the stream uses COBS framing\n");
+	fprintf(stderr, "  -n  the variant name printed in the report\n");
+	fprintf(stderr, "  -w  seconds after the first sample excluded from the statistics, default %.1f\n", ACCURACY_DEFAULT_WARMUP);
+	fprintf(stderr, "  -o  writes the quaternions as time_us,w,x,y,z\n");
+	fprintf(stderr, "  -r  compares against the quaternions of a reference variant\n");
+	fprintf(stderr, "  -m  the budget of the largest angular error in degrees\n");
+	fprintf(stderr, "  -s  the budget of the RMS angular error in degrees\n");
+}
+
+/**
+ * @brief Replays a capture through the variant this program was built as
+ * @param[in] argc The number of arguments
+ * @param[in] argv The arguments, see {@see accuracy_usage}
+ * @return EXIT_SUCCESS; 1 if an error exceeds its budget; 2 on bad arguments or inputs
+ *
+ * Prints one report line: the time and the libfixmath calls per fused sample, then the
+ * angular error against the reference (mean, RMS, 95th percentile, maximum) and the
+ * largest roll, pitch and yaw errors, all in degrees. The error math follows
+ * matlab/protocol2/test, so that the MATLAB scripts can serve as oracle for the CSV files.
+ */
+int main(int argc, char *argv[])
+{
+	frame_framing_t framing = FRAME_FRAMING_ESCAPE;
+	const char *name = "variant";
+	const char *outputPath = NULL;
+	const char *referencePath = NULL;
+	double warmup = ACCURACY_DEFAULT_WARMUP;
+	double maxBudget = INFINITY, rmsBudget = INFINITY;
+
+	int option;
+	while ((option = getopt(argc, argv, "cn:w:o:r:m:s:")) != -1)
+	{
+		switch (option)
+		{
+			case 'c': framing = FRAME_FRAMING_COBS; break;
+			case 'n': name = optarg; break;
+			case 'w': warmup = atof(optarg); break;
+			case 'o': outputPath = optarg; break;
+			case 'r': referencePath = optarg; break;
+			case 'm': maxBudget = atof(optarg); break;
+			case 's': rmsBudget = atof(optarg); break;
+			default:
+				accuracy_usage(argv[0]);
+				return 2;
+		}
+	}
+
+	if (optind + 1 != argc)
+	{
+		accuracy_usage(argv[0]);
+		return 2;
+	}
+
+	Parameters_Load();
+
+	replay_capture_t capture;
+	if (Replay_Load(&capture, argv[optind], framing))
+	{
+		fprintf(stderr, "%s: cannot read the capture\n", argv[optind]);
+		Replay_Free(&capture);
+		return 2;
+	}
+
+	/* the timed run without output and counters, then the recorded and counted run */
+	const double start = accuracy_now();
+	const size_t steps = Replay_Run(&capture, NULL, NULL, NULL);
+	const double elapsed = accuracy_now() - start;
+
+	accuracy_track_t track = { 0 };
+	accuracy_counting = 1;
+	Replay_Run(&capture, accuracy_record, &track, NULL);
+	accuracy_counting = 0;
+	Replay_Free(&capture);
+
+	const double perStep = (steps > 0) ? 1.0 / (double)steps : 0;
+	printf("%-16s %8zu steps %8.0f ns %7.1f mul %6.1f div %5.2f sqrt %7.1f add/sub",
+		name, steps, 1e9 * elapsed * perStep,
+		(double)accuracy_ops[ACCURACY_OP_MUL] * perStep, (double)accuracy_ops[ACCURACY_OP_DIV] * perStep,
+		(double)accuracy_ops[ACCURACY_OP_SQRT] * perStep,
+		(double)(accuracy_ops[ACCURACY_OP_ADD] + accuracy_ops[ACCURACY_OP_SUB]) * perStep);
+
+	int result = EXIT_SUCCESS;
+	if (NULL != outputPath)
+	{
+		FILE *const file = fopen(outputPath, "w");
+		if (NULL == file)
+		{
+			fprintf(stderr, "%s: cannot write the quaternions\n", outputPath);
+			result = 2;
+		}
+		else
+		{
+			for (size_t i = 0; i < track.count; ++i)
+			{
+				const accuracy_sample_t *const sample = &track.samples[i];
+				fprintf(file, "%lld,%.8f,%.8f,%.8f,%.8f\n", (long long)sample->time, sample->q[0], sample->q[1], sample->q[2], sample->q[3]);
+			}
+			fclose(file);
+		}
+	}
+
+	if (NULL != referencePath)
+	{
+		accuracy_track_t reference = { 0 };
+		accuracy_errors_t errors;
+
+		if (accuracy_load(&reference, referencePath) || accuracy_evaluate(&errors, &reference, &track, warmup))
+		{
+			printf("\n");
+			fprintf(stderr, "%s: not a reference of the same capture\n", referencePath);
+			result = 2;
+		}
+		else
+		{
+			const int exceeded = (errors.max > maxBudget) || (errors.rms > rmsBudget);
+			printf("  error mean %.4f rms %.4f p95 %.4f max %.4f, roll %.4f pitch %.4f yaw %.4f deg  %s\n",
+				errors.mean, errors.rms, errors.p95, errors.max, errors.euler[0], errors.euler[1], errors.euler[2],
+				exceeded ? "FAIL" : "ok");
+			if (exceeded && EXIT_SUCCESS == result) result = 1;
+		}
+
+		free(reference.samples);
+	}
+	else
+	{
+		printf("  reference\n");
+	}
+
+	free(track.samples);
+	return result;
+}
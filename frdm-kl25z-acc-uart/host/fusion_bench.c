@@ -0,0 +1,376 @@
+/*
+ * fusion_bench.c
+ *
+ * Host benchmark of the fusion core: time and fixed point operations per call
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "fixmath.h"
+#include "fixquat.h"
+#include "fixvector3d.h"
+
+#include "fusion/sensor_fusion.h"
+#include "parameters.h"
+
+/**
+ * @brief Counts the libfixmath calls per benchmarked function if nonzero
+ *
+ * Set by the Makefile for the fusion_bench_ops binary, which links with --wrap for
+ * every counted function. The counters distort the timing, so the plain binary
+ * reports the times.
+ */
+#ifndef BENCH_COUNT_OPS
+#define BENCH_COUNT_OPS 0
+#endif
+
+/**
+ * @brief The default number of fusion steps
+ */
+#define BENCH_DEFAULT_STEPS	(100000u)
+
+/**
+ * @brief The sensor sample interval in seconds
+ */
+#define BENCH_SAMPLE_PERIOD	(0.005f)
+
+/**
+ * @brief Every n-th step carries a magnetometer measurement
+ */
+#define BENCH_MAGNETOMETER_DIVIDER	(3u)
+
+/**
+ * @brief The benchmarked functions
+ */
+typedef enum {
+	BENCH_PREDICT = 0,			/*< fusion_predict */
+	BENCH_UPDATE = 1,			/*< fusion_update */
+	BENCH_FETCH_QUATERNION = 2,	/*< fusion_fetch_quaternion */
+	BENCH_COUNT = 3				/*< The number of benchmarked functions */
+} bench_function_t;
+
+/**
+ * @brief The names of the benchmarked functions
+ */
+static const char *const bench_names[BENCH_COUNT] = {
+	"fusion_predict",
+	"fusion_update",
+	"fusion_fetch_quaternion"
+};
+
+/**
+ * @brief The name of the benchmarked fusion engine, see {@see FUSION_ENGINE}
+ */
+#if FUSION_ENGINE == FUSION_ENGINE_MAHONY
+#define BENCH_ENGINE_NAME	"mahony"
+#else
+#define BENCH_ENGINE_NAME	"kalman"
+#endif
+
+/**
+ * @brief The counted libfixmath functions
+ */
+typedef enum {
+	BENCH_OP_ADD = 0,			/*< fix16_add */
+	BENCH_OP_SUB = 1,			/*< fix16_sub */
+	BENCH_OP_MUL = 2,			/*< fix16_mul */
+	BENCH_OP_DIV = 3,			/*< fix16_div */
+	BENCH_OP_SQRT = 4,			/*< fix16_sqrt */
+	BENCH_OP_COUNT = 5			/*< The number of counted functions */
+} bench_op_t;
+
+/**
+ * @brief The accumulated measurements of a benchmarked function
+ */
+typedef struct {
+	uint64_t calls;						/*< The number of calls */
+	uint64_t totalNs;					/*< The accumulated time in nanoseconds, without the clock overhead */
+	uint64_t minNs;						/*< The shortest call in nanoseconds */
+	uint64_t maxNs;						/*< The longest call in nanoseconds */
+	uint64_t ops[BENCH_OP_COUNT];		/*< The libfixmath calls */
+} bench_stats_t;
+
+/**
+ * @brief The measurements per function
+ */
+static bench_stats_t bench_stats[BENCH_COUNT];
+
+/**
+ * @brief The function being measured, or BENCH_COUNT outside of the measurements
+ */
+static bench_function_t bench_current = BENCH_COUNT;
+
+#if BENCH_COUNT_OPS
+
+/**
+ * @brief The names of the counted functions
+ */
+static const char *const bench_op_names[BENCH_OP_COUNT] = { "add", "sub", "mul", "div", "sqrt" };
+
+/**
+ * @brief Counts a libfixmath call of the current function
+ * @param[in] op The call
+ */
+static inline void bench_count(const bench_op_t op)
+{
+	if (BENCH_COUNT != bench_current)
+	{
+		++bench_stats[bench_current].ops[op];
+	}
+}
+
+fix16_t __real_fix16_add(fix16_t a, fix16_t b);
+fix16_t __real_fix16_sub(fix16_t a, fix16_t b);
+fix16_t __real_fix16_mul(fix16_t a, fix16_t b);
+fix16_t __real_fix16_div(fix16_t a, fix16_t b);
+fix16_t __real_fix16_sqrt(fix16_t value);
+
+fix16_t __wrap_fix16_add(fix16_t a, fix16_t b) { bench_count(BENCH_OP_ADD); return __real_fix16_add(a, b); }
+fix16_t __wrap_fix16_sub(fix16_t a, fix16_t b) { bench_count(BENCH_OP_SUB); return __real_fix16_sub(a, b); }
+fix16_t __wrap_fix16_mul(fix16_t a, fix16_t b) { bench_count(BENCH_OP_MUL); return __real_fix16_mul(a, b); }
+fix16_t __wrap_fix16_div(fix16_t a, fix16_t b) { bench_count(BENCH_OP_DIV); return __real_fix16_div(a, b); }
+fix16_t __wrap_fix16_sqrt(fix16_t value) { bench_count(BENCH_OP_SQRT); return __real_fix16_sqrt(value); }
+
+#endif
+
+/**
+ * @brief Reads the monotonic clock
+ * @return The time in nanoseconds
+ */
+static inline uint64_t bench_now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief The cost of a clock read in nanoseconds, subtracted from every measurement
+ */
+static uint64_t bench_overhead = 0;
+
+/**
+ * @brief Measures the cost of a clock read
+ *
+ * The shortest of many back to back reads, so that a preemption does not count.
+ */
+static void bench_calibrate()
+{
+	uint64_t best = UINT64_MAX;
+	for (int i = 0; i < 10000; ++i)
+	{
+		const uint64_t start = bench_now();
+		const uint64_t duration = bench_now() - start;
+		if (duration < best) best = duration;
+	}
+	bench_overhead = best;
+}
+
+/**
+ * @brief Marks the start of a measured call
+ * @param[in] function The function
+ * @return The start time
+ */
+static inline uint64_t bench_begin(const bench_function_t function)
+{
+	bench_current = function;
+	return bench_now();
+}
+
+/**
+ * @brief Marks the end of a measured call started with {@see bench_begin}
+ * @param[in] start The start time
+ */
+static inline void bench_end(const uint64_t start)
+{
+	const uint64_t end = bench_now();
+	bench_stats_t *const stats = &bench_stats[bench_current];
+	bench_current = BENCH_COUNT;
+
+	const uint64_t elapsed = end - start;
+	const uint64_t duration = (elapsed > bench_overhead) ? (elapsed - bench_overhead) : 0;
+	if ((0 == stats->calls) || (duration < stats->minNs)) stats->minNs = duration;
+	if (duration > stats->maxNs) stats->maxNs = duration;
+	stats->totalNs += duration;
+	++stats->calls;
+}
+
+/**
+ * @brief A synthetic sensor sample
+ */
+typedef struct {
+	v3d gyroscope;			/*< The angular velocity in rad/s */
+	v3d accelerometer;		/*< The specific force in g */
+	v3d magnetometer;		/*< The magnetic field in body coordinates, normalized */
+} bench_sample_t;
+
+/**
+ * @brief Generates a sample of a board that sways about all axes
+ * @param[in] t The time in seconds
+ * @param[out] sample The sample
+ *
+ * The angles are sinusoids with distinct periods; the accelerometer sees gravity and
+ * the magnetometer an inclined field, both rotated into the body frame, plus a small
+ * deterministic noise, so that the filter exercises all update paths.
+ */
+static void bench_generate(const float t, bench_sample_t *const sample)
+{
+	const float roll = 0.6f * sinf(0.9f * t);
+	const float pitch = 0.4f * sinf(0.7f * t + 1.0f);
+	const float yaw = 1.5f * sinf(0.3f * t);
+
+	const float droll = 0.6f * 0.9f * cosf(0.9f * t);
+	const float dpitch = 0.4f * 0.7f * cosf(0.7f * t + 1.0f);
+	const float dyaw = 1.5f * 0.3f * cosf(0.3f * t);
+
+	const float cr = cosf(roll), sr = sinf(roll);
+	const float cp = cosf(pitch), sp = sinf(pitch);
+	const float cy = cosf(yaw), sy = sinf(yaw);
+
+	// body rates from the Euler angle rates (ZYX)
+	const float wx = droll - sp * dyaw;
+	const float wy = cr * dpitch + sr * cp * dyaw;
+	const float wz = -sr * dpitch + cr * cp * dyaw;
+
+	// the rows of the world to body rotation
+	const float r[3][3] = {
+		{ cp * cy,                  cp * sy,                  -sp },
+		{ sr * sp * cy - cr * sy,   sr * sp * sy + cr * cy,   sr * cp },
+		{ cr * sp * cy + sr * sy,   cr * sp * sy - sr * cy,   cr * cp }
+	};
+
+	// gravity points up in the accelerometer frame; the field points north and down
+	const float g[3] = { 0, 0, 1 };
+	const float m[3] = { 0.5f, 0, 0.866f };
+
+	const float noise = 0.002f * sinf(97.0f * t);
+
+	sample->gyroscope.x = fix16_from_float(wx + noise);
+	sample->gyroscope.y = fix16_from_float(wy - noise);
+	sample->gyroscope.z = fix16_from_float(wz + noise);
+
+	sample->accelerometer.x = fix16_from_float(r[0][0] * g[0] + r[0][1] * g[1] + r[0][2] * g[2] + noise);
+	sample->accelerometer.y = fix16_from_float(r[1][0] * g[0] + r[1][1] * g[1] + r[1][2] * g[2] - noise);
+	sample->accelerometer.z = fix16_from_float(r[2][0] * g[0] + r[2][1] * g[1] + r[2][2] * g[2] + noise);
+
+	sample->magnetometer.x = fix16_from_float(r[0][0] * m[0] + r[0][1] * m[1] + r[0][2] * m[2] - noise);
+	sample->magnetometer.y = fix16_from_float(r[1][0] * m[0] + r[1][1] * m[1] + r[1][2] * m[2] + noise);
+	sample->magnetometer.z = fix16_from_float(r[2][0] * m[0] + r[2][1] * m[1] + r[2][2] * m[2] - noise);
+}
+
+/**
+ * @brief Prints the measurements
+ * @param[in] steps The number of fusion steps
+ * @param[in] orientation The final orientation, printed as a checksum of the run
+ */
+static void bench_report(const uint32_t steps, const qf16 *const orientation)
+{
+#if BENCH_COUNT_OPS
+	printf("%-24s %10s", "function", "calls");
+	for (int op = 0; op < BENCH_OP_COUNT; ++op)
+	{
+		printf(" %8s", bench_op_names[op]);
+	}
+	printf("   (libfixmath calls per call)\n");
+
+	for (int f = 0; f < BENCH_COUNT; ++f)
+	{
+		const bench_stats_t *const stats = &bench_stats[f];
+		const double calls = (stats->calls > 0) ? (double)stats->calls : 1.0;
+		printf("%-24s %10llu", bench_names[f], (unsigned long long)stats->calls);
+		for (int op = 0; op < BENCH_OP_COUNT; ++op)
+		{
+			printf(" %8.1f", (double)stats->ops[op] / calls);
+		}
+		printf("\n");
+	}
+#else
+	printf("%-24s %10s %10s %10s %10s   (ns per call, clock overhead %llu ns removed)\n",
+		"function", "calls", "mean", "min", "max", (unsigned long long)bench_overhead);
+
+	for (int f = 0; f < BENCH_COUNT; ++f)
+	{
+		const bench_stats_t *const stats = &bench_stats[f];
+		const double calls = (stats->calls > 0) ? (double)stats->calls : 1.0;
+		printf("%-24s %10llu %10.1f %10llu %10llu\n", bench_names[f],
+			(unsigned long long)stats->calls, (double)stats->totalNs / calls,
+			(unsigned long long)stats->minNs, (unsigned long long)stats->maxNs);
+	}
+#endif
+
+	printf("%u steps of the %s engine, final quaternion %.5f %.5f %.5f %.5f\n", (unsigned)steps, BENCH_ENGINE_NAME,
+		fix16_to_float(orientation->a), fix16_to_float(orientation->b),
+		fix16_to_float(orientation->c), fix16_to_float(orientation->d));
+}
+
+/**
+ * @brief Runs the fusion over a synthetic trajectory
+ * @param[in] argc The number of arguments
+ * @param[in] argv The arguments; the optional first one is the number of steps
+ * @return EXIT_SUCCESS
+ *
+ * The samples are generated ahead of the run, so that the measured loop only
+ * contains the fusion; the call sequence follows the main loop of the firmware.
+ */
+int main(int argc, char *argv[])
+{
+	const uint32_t steps = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : BENCH_DEFAULT_STEPS;
+	if (0 == steps)
+	{
+		fprintf(stderr, "usage: %s [steps]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	bench_sample_t *const samples = malloc(steps * sizeof(bench_sample_t));
+	if (NULL == samples)
+	{
+		fprintf(stderr, "out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	for (uint32_t i = 0; i < steps; ++i)
+	{
+		bench_generate((float)i * BENCH_SAMPLE_PERIOD, &samples[i]);
+	}
+
+	Parameters_Load();
+	fusion_initialize();
+	bench_calibrate();
+
+	const fix16_t deltaT = fix16_from_float(BENCH_SAMPLE_PERIOD);
+	qf16 orientation = { 0 };
+	for (uint32_t i = 0; i < steps; ++i)
+	{
+		const bench_sample_t *const sample = &samples[i];
+		uint64_t start;
+
+		fusion_set_gyroscope(&sample->gyroscope.x, &sample->gyroscope.y, &sample->gyroscope.z);
+		start = bench_begin(BENCH_PREDICT);
+		fusion_predict(deltaT);
+		bench_end(start);
+
+		fusion_set_accelerometer(&sample->accelerometer.x, &sample->accelerometer.y, &sample->accelerometer.z);
+		if (0 == (i % BENCH_MAGNETOMETER_DIVIDER))
+		{
+			fusion_set_magnetometer(&sample->magnetometer.x, &sample->magnetometer.y, &sample->magnetometer.z);
+		}
+		start = bench_begin(BENCH_UPDATE);
+		fusion_update(deltaT);
+		bench_end(start);
+
+		start = bench_begin(BENCH_FETCH_QUATERNION);
+		fusion_fetch_quaternion(&orientation);
+		bench_end(start);
+	}
+
+	bench_report(steps, &orientation);
+	free(samples);
+	return EXIT_SUCCESS;
+}
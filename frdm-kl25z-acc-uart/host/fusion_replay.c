@@ -0,0 +1,271 @@
+/*
+ * fusion_replay.c
+ *
+ * Replays raw sensor captures through the fusion core and prints the quaternions
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fixmath.h"
+#include "fixquat.h"
+
+#include "parameters.h"
+#include "replay.h"
+
+/**
+ * @brief The maximum number of values of a sweep
+ */
+#define REPLAY_MAX_SWEEP	(64)
+
+/**
+ * @brief A tunable fusion constant
+ */
+typedef struct {
+	const char *name;		/*< The name, as in sensor_fusion.c */
+	size_t offset;			/*< The offset in {@see fusion_parameters_t} */
+} replay_tunable_t;
+
+/**
+ * @brief The fusion constants that may be set or swept
+ */
+static const replay_tunable_t replay_tunables[] = {
+	{ "initial_r_axis",			offsetof(fusion_parameters_t, initial_r_axis) },
+	{ "initial_r_projection",	offsetof(fusion_parameters_t, initial_r_projection) },
+	{ "initial_r_gyro",			offsetof(fusion_parameters_t, initial_r_gyro) },
+	{ "q_axis",					offsetof(fusion_parameters_t, q_axis) },
+	{ "q_gyro",					offsetof(fusion_parameters_t, q_gyro) },
+	{ "alpha1",					offsetof(fusion_parameters_t, alpha1) },
+	{ "alpha2",					offsetof(fusion_parameters_t, alpha2) },
+};
+
+#define REPLAY_TUNABLE_COUNT	(sizeof(replay_tunables) / sizeof(replay_tunables[0]))
+
+/**
+ * @brief The output state of a run
+ */
+typedef struct {
+	FILE *file;			/*< The quaternion output */
+	unsigned run;		/*< The run number */
+} replay_printer_t;
+
+/**
+ * @brief Prints a quaternion
+ * @param[in] time The capture time in microseconds
+ * @param[in] orientation The orientation
+ * @param[in] context The {@see replay_printer_t}
+ */
+static void replay_print(const int64_t time, const qf16 *const orientation, void *const context)
+{
+	const replay_printer_t *const printer = (const replay_printer_t*)context;
+	fprintf(printer->file, "%u,%lld,%.6f,%.6f,%.6f,%.6f\n", printer->run, (long long)time,
+		fix16_to_float(orientation->a), fix16_to_float(orientation->b),
+		fix16_to_float(orientation->c), fix16_to_float(orientation->d));
+}
+
+/**
+ * @brief Looks up a fusion constant
+ * @param[in] name The name
+ * @param[in] length The length of the name
+ * @return The constant, NULL if unknown
+ */
+static const replay_tunable_t* replay_tunable(const char *const name, const size_t length)
+{
+	for (size_t i = 0; i < REPLAY_TUNABLE_COUNT; ++i)
+	{
+		if (strlen(replay_tunables[i].name) == length && 0 == strncmp(replay_tunables[i].name, name, length))
+		{
+			return &replay_tunables[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Gets the value of a fusion constant in use
+ * @param[in] tunable The constant
+ * @return The value within {@see parameters}
+ */
+static fix16_t* replay_value(const replay_tunable_t *const tunable)
+{
+	return (fix16_t*)((uint8_t*)&parameters.fusion + tunable->offset);
+}
+
+/**
+ * @brief Parses an assignment of the form name=value[,value...]
+ * @param[in] argument The argument
+ * @param[out] tunable The constant
+ * @param[out] values The values
+ * @param[in] capacity The maximum number of values
+ * @return The number of values, zero on error
+ */
+static size_t replay_parse(const char *const argument, const replay_tunable_t **const tunable, fix16_t *const values, const size_t capacity)
+{
+	const char *const equals = strchr(argument, '=');
+	if (NULL == equals) return 0;
+
+	*tunable = replay_tunable(argument, (size_t)(equals - argument));
+	if (NULL == *tunable) return 0;
+
+	size_t count = 0;
+	const char *cursor = equals + 1;
+	while (count < capacity)
+	{
+		char *end;
+		const double value = strtod(cursor, &end);
+		if (end == cursor) return 0;
+
+		values[count++] = fix16_from_dbl(value);
+		if ('\0' == *end) return count;
+		if (',' != *end) return 0;
+		cursor = end + 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Reads the monotonic clock
+ * @return The time in seconds
+ */
+static double replay_now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + 1e-9 * (double)now.tv_nsec;
+}
+
+/**
+ * @brief Prints the usage
+ * @param[in] program The program name
+ */
+static void replay_usage(const char *const program)
+{
+	fprintf(stderr, "usage: %s [-c] [-q] [-p name=value]... [-s name=value,value...] capture.bin\n", program);
+	fprintf(stderr, "  -c  the stream uses COBS framing\n");
+	fprintf(stderr, "  -q  print the run summaries only\n");
+	fprintf(stderr, "  -p  sets a fusion constant\n");
+	fprintf(stderr, "  -s  runs once per value of a fusion constant\n");
+	fprintf(stderr, "constants:");
+	for (size_t i = 0; i < REPLAY_TUNABLE_COUNT; ++i)
+	{
+		fprintf(stderr, " %s", replay_tunables[i].name);
+	}
+	fprintf(stderr, "\nThe quaternions are printed as run,time_us,a,b,c,d.\n");
+}
+
+/**
+ * @brief Replays a capture
+ * @param[in] argc The number of arguments
+ * @param[in] argv The arguments, see {@see replay_usage}
+ * @return EXIT_SUCCESS, or EXIT_FAILURE on bad arguments or an unreadable capture
+ *
+ * The capture is decoded once; every run starts from the compiled-in parameters
+ * with the -p constants and, for a sweep, one of the -s values applied.
+ */
+int main(int argc, char *argv[])
+{
+	frame_framing_t framing = FRAME_FRAMING_ESCAPE;
+	int quiet = 0;
+
+	Parameters_Load();
+
+	const replay_tunable_t *sweep = NULL;
+	fix16_t sweepValues[REPLAY_MAX_SWEEP];
+	size_t sweepCount = 0;
+
+	int option;
+	while ((option = getopt(argc, argv, "cqp:s:")) != -1)
+	{
+		const replay_tunable_t *tunable;
+		fix16_t value;
+
+		switch (option)
+		{
+			case 'c':
+				framing = FRAME_FRAMING_COBS;
+				break;
+			case 'q':
+				quiet = 1;
+				break;
+			case 'p':
+				if (1 != replay_parse(optarg, &tunable, &value, 1))
+				{
+					replay_usage(argv[0]);
+					return EXIT_FAILURE;
+				}
+				*replay_value(tunable) = value;
+				break;
+			case 's':
+				sweepCount = replay_parse(optarg, &sweep, sweepValues, REPLAY_MAX_SWEEP);
+				if (0 == sweepCount)
+				{
+					replay_usage(argv[0]);
+					return EXIT_FAILURE;
+				}
+				break;
+			default:
+				replay_usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (optind + 1 != argc)
+	{
+		replay_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	replay_capture_t capture;
+	if (Replay_Load(&capture, argv[optind], framing))
+	{
+		fprintf(stderr, "%s: cannot read the capture\n", argv[optind]);
+		Replay_Free(&capture);
+		return EXIT_FAILURE;
+	}
+
+	fprintf(stderr, "%u frames, %u framing errors, %u bad batches, %u/%u batches dropped\n",
+		(unsigned)capture.frames, (unsigned)capture.framingErrors, (unsigned)capture.crcErrors,
+		(unsigned)capture.droppedBatches[0], (unsigned)capture.droppedBatches[1]);
+	fprintf(stderr, "%zu MPU6050 and %zu HMC5883L samples\n", capture.mpu6050Count, capture.hmc5883lCount);
+
+	const double span = (capture.mpu6050Count > 1)
+		? 1e-6 * (double)(capture.mpu6050[capture.mpu6050Count - 1].time - capture.mpu6050[0].time)
+		: 0;
+
+	const size_t runs = (0 == sweepCount) ? 1 : sweepCount;
+	for (size_t run = 0; run < runs; ++run)
+	{
+		if (NULL != sweep)
+		{
+			*replay_value(sweep) = sweepValues[run];
+		}
+
+		replay_printer_t printer = { .file = stdout, .run = (unsigned)run };
+		qf16 orientation;
+
+		const double start = replay_now();
+		const size_t steps = Replay_Run(&capture, quiet ? NULL : replay_print, &printer, &orientation);
+		const double elapsed = replay_now() - start;
+
+		fprintf(stderr, "run %zu", run);
+		if (NULL != sweep)
+		{
+			fprintf(stderr, " (%s=%g)", sweep->name, fix16_to_dbl(sweepValues[run]));
+		}
+		fprintf(stderr, ": %zu steps over %.1f s in %.3f s (%.0fx real time), final quaternion %.5f %.5f %.5f %.5f\n",
+			steps, span, elapsed, (elapsed > 0) ? span / elapsed : 0,
+			fix16_to_float(orientation.a), fix16_to_float(orientation.b),
+			fix16_to_float(orientation.c), fix16_to_float(orientation.d));
+	}
+
+	Replay_Free(&capture);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,400 @@
+/*
+ * replay.c
+ *
+ * Replay of raw sensor captures through the fusion core
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "comm/batch.h"
+#include "comm/crc16.h"
+#include "fusion/accelerometer_merge.h"
+#include "fusion/magnetometer_calibration.h"
+#include "fusion/sensor_fusion.h"
+#include "fusion/sensor_prepare.h"
+#include "parameters.h"
+
+#include "frame_decoder.h"
+#include "replay.h"
+
+/**
+ * @brief The size of the chunks the stream is read in
+ */
+#define REPLAY_CHUNK_SIZE		(65536u)
+
+/**
+ * @brief The size of a captured MPU6050 sample: timestamp and seven words, see mpu6050_capture_t in main.c
+ */
+#define REPLAY_MPU6050_SAMPLE_SIZE	(4 + 7 * 2)
+
+/**
+ * @brief The size of a captured HMC5883L sample: timestamp and three words, see hmc5883l_capture_t in main.c
+ */
+#define REPLAY_HMC5883L_SAMPLE_SIZE	(4 + 3 * 2)
+
+/**
+ * @brief The upper bound of the fusion time differences in microseconds, as FUSION_MAX_DELTA_US in main.c
+ */
+#define REPLAY_MAX_DELTA_US		(500000)
+
+/**
+ * @brief The MPU6050 gyroscope scaling values, as configured by init_sensors.c
+ */
+static const fix16_t replay_gyroscope_scalers[] = { F16(131), F16(65.5), F16(32.8), F16(16.4) };
+
+/**
+ * @brief The HMC5883L scaling values, as configured by init_sensors.c
+ */
+static const int16_t replay_magnetometer_scalers[] = { 1370, 1090, 820, 660, 440, 390, 330, 230 };
+
+/**
+ * @brief The stream state while loading a capture
+ */
+typedef struct {
+	replay_capture_t *capture;		/*< The capture being filled */
+	size_t capacity[2];				/*< The allocated samples, MPU6050 and HMC5883L */
+	uint8_t started[2];				/*< Nonzero once a batch of the stream was seen */
+	uint16_t sequence[2];			/*< The last sequence number per stream */
+	uint8_t timeStarted;			/*< Nonzero once the time base is set */
+	uint32_t baseTimestamp;			/*< The raw timestamp of the first sample */
+	uint32_t lastTimestamp[2];		/*< The last raw timestamp per stream */
+	int64_t lastTime[2];			/*< The last unwrapped time per stream */
+	uint8_t sampleStarted[2];		/*< Nonzero once a sample of the stream was unwrapped */
+	uint8_t outOfMemory;			/*< Nonzero if a sample could not be stored */
+} replay_loader_t;
+
+/**
+ * @brief Reads a little endian word
+ * @param[in] data The data
+ * @return The word
+ */
+static inline uint16_t replay_read16(const uint8_t *const data)
+{
+	return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+/**
+ * @brief Reads a little endian longword
+ * @param[in] data The data
+ * @return The longword
+ */
+static inline uint32_t replay_read32(const uint8_t *const data)
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/**
+ * @brief Converts a capture timestamp into the unwrapped time of its stream
+ * @param[in] loader The loader
+ * @param[in] stream The stream, zero for the MPU6050
+ * @param[in] timestamp The timestamp in microseconds
+ * @return The time in microseconds relative to the first captured sample
+ *
+ * The 32 bit timestamps wrap after 71 minutes; consecutive samples of a stream
+ * are assumed to lie less than half of that apart.
+ */
+static int64_t replay_unwrap(replay_loader_t *const loader, const uint8_t stream, const uint32_t timestamp)
+{
+	if (!loader->timeStarted)
+	{
+		loader->timeStarted = 1;
+		loader->baseTimestamp = timestamp;
+	}
+
+	int64_t time;
+	if (loader->sampleStarted[stream])
+	{
+		time = loader->lastTime[stream] + (int32_t)(timestamp - loader->lastTimestamp[stream]);
+	}
+	else
+	{
+		time = (int32_t)(timestamp - loader->baseTimestamp);
+		loader->sampleStarted[stream] = 1;
+	}
+
+	loader->lastTimestamp[stream] = timestamp;
+	loader->lastTime[stream] = time;
+	return time;
+}
+
+/**
+ * @brief Makes room for the samples of a batch
+ * @param[inout] samples The sample array
+ * @param[in] count The number of stored samples
+ * @param[inout] capacity The allocated samples
+ * @param[in] additional The number of samples to add
+ * @param[in] size The size of a sample
+ * @return Zero on success
+ */
+static int replay_reserve(void **const samples, const size_t count, size_t *const capacity, const size_t additional, const size_t size)
+{
+	if (count + additional <= *capacity) return 0;
+
+	size_t grown = (0 == *capacity) ? 4096 : *capacity;
+	while (grown < count + additional) grown *= 2;
+
+	void *const reallocated = realloc(*samples, grown * size);
+	if (NULL == reallocated) return 1;
+
+	*samples = reallocated;
+	*capacity = grown;
+	return 0;
+}
+
+/**
+ * @brief Stores the samples of a capture batch frame
+ * @param[in] frame The frame
+ * @param[in] length The frame length
+ * @param[in] context The {@see replay_loader_t}
+ */
+static void replay_frame(const uint8_t *const frame, const size_t length, void *const context)
+{
+	replay_loader_t *const loader = (replay_loader_t*)context;
+	replay_capture_t *const capture = loader->capture;
+	++capture->frames;
+
+	const uint8_t type = frame[0];
+	if (REPLAY_MPU6050_TYPE != type && REPLAY_HMC5883L_TYPE != type) return;
+	const uint8_t stream = type - REPLAY_MPU6050_TYPE;
+
+	/* the batch layout of batch.c: type, sequence, count, size, samples, crc */
+	if (length < BATCH_HEADER_LENGTH + BATCH_TRAILER_LENGTH)
+	{
+		++capture->crcErrors;
+		return;
+	}
+
+	const size_t count = frame[3];
+	const size_t sampleSize = frame[4];
+	const size_t payloadEnd = BATCH_HEADER_LENGTH + count * sampleSize;
+	const size_t expectedSize = (0 == stream) ? REPLAY_MPU6050_SAMPLE_SIZE : REPLAY_HMC5883L_SAMPLE_SIZE;
+	if ((length != payloadEnd + BATCH_TRAILER_LENGTH) || (sampleSize != expectedSize)
+		|| (replay_read16(&frame[payloadEnd]) != CRC16_Update(CRC16_INITIAL_VALUE, frame, payloadEnd)))
+	{
+		++capture->crcErrors;
+		return;
+	}
+
+	/* count the batches lost in between by their sequence number */
+	const uint16_t sequence = replay_read16(&frame[1]);
+	if (loader->started[stream])
+	{
+		capture->droppedBatches[stream] += (uint16_t)(sequence - loader->sequence[stream] - 1);
+	}
+	loader->started[stream] = 1;
+	loader->sequence[stream] = sequence;
+
+	const uint8_t *sample = &frame[BATCH_HEADER_LENGTH];
+	if (0 == stream)
+	{
+		if (replay_reserve((void**)&capture->mpu6050, capture->mpu6050Count, &loader->capacity[0], count, sizeof(replay_mpu6050_sample_t)))
+		{
+			loader->outOfMemory = 1;
+			return;
+		}
+
+		for (size_t s = 0; s < count; ++s, sample += sampleSize)
+		{
+			replay_mpu6050_sample_t *const target = &capture->mpu6050[capture->mpu6050Count++];
+			target->time = replay_unwrap(loader, stream, replay_read32(sample));
+			for (int i = 0; i < 7; ++i) target->data[i] = (int16_t)replay_read16(&sample[4 + 2*i]);
+		}
+	}
+	else
+	{
+		if (replay_reserve((void**)&capture->hmc5883l, capture->hmc5883lCount, &loader->capacity[1], count, sizeof(replay_hmc5883l_sample_t)))
+		{
+			loader->outOfMemory = 1;
+			return;
+		}
+
+		for (size_t s = 0; s < count; ++s, sample += sampleSize)
+		{
+			replay_hmc5883l_sample_t *const target = &capture->hmc5883l[capture->hmc5883lCount++];
+			target->time = replay_unwrap(loader, stream, replay_read32(sample));
+			for (int i = 0; i < 3; ++i) target->xyz[i] = (int16_t)replay_read16(&sample[4 + 2*i]);
+		}
+	}
+}
+
+/**
+ * @brief Decodes a recorded serial stream
+ * @param[out] capture The capture; release with {@see Replay_Free}
+ * @param[in] path The file of the raw received bytes, see serial_capture.m; "-" reads stdin
+ * @param[in] framing The framing of the stream
+ * @return Zero on success, nonzero if the file could not be read
+ *
+ * Only the RAW_CAPTURE batches are kept; all other frames are skipped.
+ */
+int Replay_Load(replay_capture_t *const capture, const char *const path, const frame_framing_t framing)
+{
+	memset(capture, 0, sizeof(*capture));
+
+	FILE *const file = (0 == strcmp(path, "-")) ? stdin : fopen(path, "rb");
+	if (NULL == file) return 1;
+
+	uint8_t *const chunk = malloc(REPLAY_CHUNK_SIZE);
+	if (NULL == chunk)
+	{
+		if (stdin != file) fclose(file);
+		return 1;
+	}
+
+	static frame_decoder_t decoder;
+	FrameDecoder_Init(&decoder, framing);
+
+	replay_loader_t loader = { .capture = capture };
+	size_t count;
+	while ((count = fread(chunk, 1, REPLAY_CHUNK_SIZE, file)) > 0)
+	{
+		FrameDecoder_Feed(&decoder, chunk, count, replay_frame, &loader);
+	}
+
+	const int failed = ferror(file) || loader.outOfMemory;
+	capture->framingErrors = decoder.errors;
+
+	free(chunk);
+	if (stdin != file) fclose(file);
+	return failed;
+}
+
+/**
+ * @brief Releases a capture
+ * @param[in] capture The capture
+ */
+void Replay_Free(replay_capture_t *const capture)
+{
+	free(capture->mpu6050);
+	free(capture->hmc5883l);
+	memset(capture, 0, sizeof(*capture));
+}
+
+/**
+ * @brief Converts a capture time difference into the fusion time difference, as fusion_delta in main.c
+ * @param[in] microseconds The time difference in microseconds
+ * @return The time difference in seconds, bounded by {@see REPLAY_MAX_DELTA_US}
+ */
+static fix16_t replay_delta(const int64_t microseconds)
+{
+	if (microseconds <= 0) return 0;
+	const uint32_t bounded = (microseconds > REPLAY_MAX_DELTA_US) ? REPLAY_MAX_DELTA_US : (uint32_t)microseconds;
+
+	/* 4295/65536 approximates 65536/1000000 without a division */
+	return (fix16_t)((bounded * 4295u) >> 16);
+}
+
+/**
+ * @brief Advances the online magnetometer calibration and applies a converged fit, as the fusion step in main.c
+ * @param[in] sample The prepared magnetometer sample, or NULL for a step without one
+ */
+static void replay_calibrate(const v3d *const sample)
+{
+#if MAGNETOMETER_CALIBRATION_ONLINE
+	if (magnetometer_calibration_update(sample))
+	{
+		calibration_matrix_t correction;
+		if (magnetometer_calibration_fetch(&correction))
+		{
+			sensor_prepare_correct_hmc5883l(&correction);
+		}
+	}
+#else
+	(void)sample;
+#endif
+}
+
+/**
+ * @brief Runs the fusion over a capture
+ * @param[in] capture The capture
+ * @param[in] output Called after every fused MPU6050 sample; may be NULL
+ * @param[in] context Passed to the output
+ * @param[out] orientation The final orientation; may be NULL
+ * @return The number of fused MPU6050 samples
+ *
+ * The sensor preparation and the fusion are initialized from the current
+ * {@see parameters}, so that the tuning may be changed between runs. The samples
+ * are fed in capture time order with the time differences and the call sequence
+ * of the main loop.
+ */
+size_t Replay_Run(const replay_capture_t *const capture, const replay_output_t output, void *const context, qf16 *const orientation)
+{
+	/* the initialization sequence of main.c, with the scalers of the stored sensor configuration */
+	sensor_prepare_initialize(fix16_from_int(16384 >> parameters.sensors.mpu6050_accelerometer_full_scale),
+		replay_gyroscope_scalers[parameters.sensors.mpu6050_gyroscope_full_scale],
+		fix16_from_int(replay_magnetometer_scalers[parameters.sensors.hmc5883l_gain]));
+	accelerometer_merge_initialize();
+	magnetometer_calibration_initialize();
+	fusion_initialize();
+
+	const replay_mpu6050_sample_t *const mpu6050 = capture->mpu6050;
+	const replay_hmc5883l_sample_t *const hmc5883l = capture->hmc5883l;
+	const size_t mpu6050Count = capture->mpu6050Count;
+	const size_t hmc5883lCount = capture->hmc5883lCount;
+
+	/* the fusion starts at the first sample */
+	int64_t start = 0;
+	if (mpu6050Count > 0) start = mpu6050[0].time;
+	if (hmc5883lCount > 0 && (0 == mpu6050Count || hmc5883l[0].time < start)) start = hmc5883l[0].time;
+
+	int64_t last_predict_time = start;
+	int64_t last_accelerometer_time = start;
+	int64_t last_magnetometer_time = start;
+
+	qf16 current = { F16(1), 0, 0, 0 };
+	size_t m = 0, h = 0;
+	while (m < mpu6050Count || h < hmc5883lCount)
+	{
+		v3d prepared;
+
+		/* one sensor per iteration, in capture time order; the MPU6050 goes first on ties */
+		if (h < hmc5883lCount && (m >= mpu6050Count || hmc5883l[h].time < mpu6050[m].time))
+		{
+			const replay_hmc5883l_sample_t *const sample = &hmc5883l[h++];
+
+			sensor_prepare_hmc5883l_data(&prepared, sample->xyz[0], sample->xyz[1], sample->xyz[2]);
+			fusion_set_magnetometer_v3d(&prepared);
+			replay_calibrate(&prepared);
+
+			fusion_update_magnetometer(replay_delta(sample->time - last_magnetometer_time));
+			last_magnetometer_time = sample->time;
+			continue;
+		}
+
+		const replay_mpu6050_sample_t *const sample = &mpu6050[m++];
+		replay_calibrate(NULL);
+
+		sensor_prepare_mpu6050_accelerometer_data(&prepared, sample->data[0], sample->data[1], sample->data[2]);
+		accelerometer_merge(ACCELEROMETER_SOURCE_MPU6050, (uint32_t)sample->time, &prepared, &prepared);
+		fusion_set_accelerometer_v3d(&prepared);
+
+		sensor_prepare_mpu6050_gyroscope_data(&prepared, sample->data[3], sample->data[4], sample->data[5]);
+		fusion_set_gyroscope_v3d(&prepared);
+
+		/* predict at gyroscope rate, correct the attitude with every sample */
+		const fix16_t predict_deltaT = replay_delta(sample->time - last_predict_time);
+		last_predict_time = sample->time;
+		fusion_predict(predict_deltaT);
+
+		fusion_update_accelerometer(replay_delta(sample->time - last_accelerometer_time));
+		last_accelerometer_time = sample->time;
+
+		fusion_update_gyroscope(predict_deltaT);
+
+		if (NULL != output)
+		{
+			fusion_fetch_quaternion(&current);
+			output(sample->time, &current, context);
+		}
+	}
+
+	if (NULL != orientation)
+	{
+		fusion_fetch_quaternion(orientation);
+	}
+	return mpu6050Count;
+}
@@ -0,0 +1,99 @@
+/*
+ * replay.h
+ *
+ * Replay of raw sensor captures through the fusion core
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_decoder.h"
+#include "fixquat.h"
+
+/**
+ * @brief The frame type of the MPU6050 capture batches, see RAW_CAPTURE in main.c
+ */
+#define REPLAY_MPU6050_TYPE		(49)
+
+/**
+ * @brief The frame type of the HMC5883L capture batches
+ */
+#define REPLAY_HMC5883L_TYPE	(50)
+
+/**
+ * @brief A captured MPU6050 sample
+ */
+typedef struct {
+	int64_t time;			/*< The capture time in microseconds since the first sample, unwrapped */
+	int16_t data[7];		/*< The raw accelerometer, gyroscope and temperature data in {@see mpu6050_sensor_t} order */
+} replay_mpu6050_sample_t;
+
+/**
+ * @brief A captured HMC5883L sample
+ */
+typedef struct {
+	int64_t time;			/*< The capture time in microseconds since the first sample, unwrapped */
+	int16_t xyz[3];			/*< The raw magnetometer data in {@see hmc5883l_data_t} order */
+} replay_hmc5883l_sample_t;
+
+/**
+ * @brief A decoded capture
+ */
+typedef struct {
+	replay_mpu6050_sample_t *mpu6050;	/*< The MPU6050 samples in capture order */
+	size_t mpu6050Count;				/*< The number of MPU6050 samples */
+	replay_hmc5883l_sample_t *hmc5883l;	/*< The HMC5883L samples in capture order */
+	size_t hmc5883lCount;				/*< The number of HMC5883L samples */
+	uint32_t frames;					/*< The number of decoded frames of any type */
+	uint32_t framingErrors;				/*< The frames discarded by the decoder */
+	uint32_t crcErrors;					/*< The capture batches with a bad length or checksum */
+	uint32_t droppedBatches[2];			/*< The capture batches missing by sequence number, MPU6050 and HMC5883L */
+} replay_capture_t;
+
+/**
+ * @brief Receives the orientation after every fused MPU6050 sample
+ * @param[in] time The capture time of the sample, see {@see replay_mpu6050_sample_t}
+ * @param[in] orientation The orientation quaternion
+ * @param[in] context The context given to {@see Replay_Run}
+ */
+typedef void (*replay_output_t)(const int64_t time, const qf16 *const orientation, void *const context);
+
+/**
+ * @brief Decodes a recorded serial stream
+ * @param[out] capture The capture; release with {@see Replay_Free}
+ * @param[in] path The file of the raw received bytes, see serial_capture.m; "-" reads stdin
+ * @param[in] framing The framing of the stream
+ * @return Zero on success, nonzero if the file could not be read
+ *
+ * Only the RAW_CAPTURE batches are kept; all other frames are skipped.
+ */
+int Replay_Load(replay_capture_t *const capture, const char *const path, const frame_framing_t framing);
+
+/**
+ * @brief Releases a capture
+ * @param[in] capture The capture
+ */
+void Replay_Free(replay_capture_t *const capture);
+
+/**
+ * @brief Runs the fusion over a capture
+ * @param[in] capture The capture
+ * @param[in] output Called after every fused MPU6050 sample; may be NULL
+ * @param[in] context Passed to the output
+ * @param[out] orientation The final orientation; may be NULL
+ * @return The number of fused MPU6050 samples
+ *
+ * The sensor preparation and the fusion are initialized from the current
+ * {@see parameters}, so that the tuning may be changed between runs. The samples
+ * are fed in capture time order with the time differences and the call sequence
+ * of the main loop.
+ */
+size_t Replay_Run(const replay_capture_t *const capture, const replay_output_t output, void *const context, qf16 *const orientation);
+
+#endif /* REPLAY_H_ */
@@ -0,0 +1,17 @@
+function buildFrameDecode
+    % BUILDFRAMEDECODE Compiles the frameDecode MEX file from the host decoder sources.
+    %   serial_orientation3 uses frameDecode if it is on the path and falls
+    %   back to the per-byte protocolDecode otherwise.
+
+    here = fileparts(mfilename('fullpath'));
+    root = fullfile(here, '..', '..');
+
+    mex('-outdir', here, ...
+        ['-I' fullfile(root, 'host')], ...
+        ['-I' fullfile(root, 'Project_Headers')], ...
+        'CFLAGS=$CFLAGS -std=gnu99', ...
+        fullfile(here, 'frameDecode.c'), ...
+        fullfile(root, 'host', 'frame_collector.c'), ...
+        fullfile(root, 'host', 'frame_decoder.c'), ...
+        fullfile(root, 'Sources', 'comm', 'crc16.c'));
+end
@@ -0,0 +1,106 @@
+function sync = clockSync(s, count, baudRate)
+    % CLOCKSYNC Estimates the link latency and the device clock offset and drift.
+    %   sync = clockSync(s) sends 32 ping commands (27) over the open serial
+    %   port s and evaluates the four timestamps of each round trip: host
+    %   send, device frame end, device response, host receive.
+    %
+    %   sync.latency    one-way latency in seconds beyond the serialization
+    %                   of the frames, i.e. USB, driver and buffering delays
+    %   sync.roundTrip  round trips of all pings in seconds, NaN if lost
+    %   sync.offset     device time minus host time in seconds at host time 0
+    %   sync.drift      device clock drift relative to the host in s/s
+    %   sync.toDevice   converts host times in seconds to device times
+    %   sync.toHost     converts device times in seconds to host times
+    %
+    %   Host times are seconds since sync.reference (a tic value). Only the
+    %   quarter of the pings with the shortest round trip enters the fit,
+    %   which rejects responses that queued behind other frames. Frames that
+    %   arrive during the measurement are discarded.
+
+    if nargin < 2
+        count = 32;
+    end
+    if nargin < 3
+        baudRate = s.BaudRate;
+    end
+
+    global dataReady data
+    global ESC EOT
+    if isempty(EOT)
+        prepareProtocolDecode();
+    end
+
+    % 10 bits per byte on the wire
+    byteTime = 10 / baudRate;
+
+    reference = tic;
+    samples = nan(count, 4);
+    for k = 1:count
+        echo = uint32(k);
+        payload = [uint8(27), typecast(echo, 'uint8')];
+        requestBytes = 5 + numel(payload) + sum(payload == EOT | payload == ESC);
+
+        sent = toc(reference);
+        sendCommand(s, 27, typecast(echo, 'uint8'));
+
+        % wait up to a second for the response carrying our echo
+        while isnan(samples(k, 4)) && (toc(reference) < sent + 1)
+            available = s.BytesAvailable;
+            if available == 0
+                pause(0.0005);
+                continue;
+            end
+
+            bytes = fread(s, available, 'uint8');
+            received = toc(reference);
+            for b = 1:numel(bytes)
+                protocolDecode(bytes(b));
+                if ~dataReady
+                    continue;
+                end
+                dataReady = false;
+
+                if numel(data) < 15 || data(1) ~= 96 || data(2) ~= 27 || typecast(data(4:7), 'uint32') ~= echo
+                    continue;
+                end
+
+                times = double(typecast(data(8:15), 'uint32')) * 1e-6;
+                responseBytes = 5 + numel(data);
+                samples(k, :) = [sent + requestBytes*byteTime, times(1), times(2) + responseBytes*byteTime, received];
+            end
+        end
+    end
+
+    % the device counts microseconds in 32 bits and wraps after 71 minutes
+    valid = ~isnan(samples(:, 4));
+    device = reshape(samples(valid, 2:3)', [], 1);
+    device = device + (2^32 * 1e-6) * cumsum([0; diff(device) < -2^31 * 1e-6]);
+    samples(valid, 2:3) = reshape(device, 2, [])';
+
+    % NTP style: the residual round trip and the offset at the midpoint
+    roundTrip = (samples(:, 4) - samples(:, 1)) - (samples(:, 3) - samples(:, 2));
+    offset = ((samples(:, 2) - samples(:, 1)) + (samples(:, 3) - samples(:, 4))) / 2;
+    midpoint = (samples(:, 1) + samples(:, 4)) / 2;
+
+    sync.reference = reference;
+    sync.roundTrip = roundTrip;
+    if sum(valid) < 2
+        warning('clockSync: only %d of %d pings were answered', sum(valid), count);
+        sync.latency = NaN;
+        sync.offset = NaN;
+        sync.drift = NaN;
+    else
+        sorted = sort(roundTrip(valid));
+        best = valid & (roundTrip <= sorted(max(2, ceil(numel(sorted) / 4))));
+        fit = polyfit(midpoint(best), offset(best), 1);
+
+        sync.latency = median(roundTrip(best)) / 2;
+        sync.offset = fit(2);
+        sync.drift = fit(1);
+    end
+    sync.toDevice = @(t) t + sync.offset + sync.drift * t;
+    sync.toHost = @(t) (t - sync.offset) / (1 + sync.drift);
+
+    fprintf('link latency %.2f ms, clock offset %.6f s, drift %.1f ppm (%d of %d pings)\n', ...
+        sync.latency * 1e3, sync.offset, sync.drift * 1e6, sum(valid), count);
+end
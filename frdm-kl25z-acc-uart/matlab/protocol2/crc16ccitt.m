@@ -0,0 +1,17 @@
+function crc = crc16ccitt(bytes)
+    % CRC16CCITT Calculates the CRC-16/CCITT-FALSE of a byte vector.
+    %   Polynomial 0x1021, initial value 0xFFFF; matches CRC16_Update()
+    %   in the firmware.
+
+    crc = uint16(65535);
+    for b = 1:numel(bytes)
+        crc = bitxor(crc, bitshift(uint16(bytes(b)), 8));
+        for i = 1:8
+            if bitand(crc, uint16(32768))
+                crc = bitxor(bitshift(crc, 1), uint16(4129));
+            else
+                crc = bitshift(crc, 1);
+            end
+        end
+    end
+end
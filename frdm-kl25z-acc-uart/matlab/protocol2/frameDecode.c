@@ -0,0 +1,177 @@
+/*
+ * frameDecode.c
+ *
+ * MEX gateway of the host frame decoder, replacing the per-byte protocolDecode
+ *
+ *   frameDecode('reset')                   resets the decoder to P2PPE framing
+ *   frameDecode('reset', 'cobs')           resets the decoder to COBS framing
+ *   [frames, samples, status] = frameDecode(bytes)
+ *
+ * The bytes are any chunk of the received stream; frames may span chunks.
+ * frames is a cell array with one uint8 column per completed frame, starting
+ * with the type, as data after dataReady of protocolDecode. samples has the
+ * fields typeNN for every frame type with a fixed layout that was received,
+ * a valueCount x N int16 (Q1.14, raw) or int32 (fix16) matrix, and typeNNTime,
+ * the 1 x N uint32 capture times in microseconds of the timestamped batches.
+ * status holds the running frame, error and drop counts.
+ *
+ * Build with buildFrameDecode.m.
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: agent
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mex.h"
+
+#include "frame_collector.h"
+
+/**
+ * @brief The decoder state, kept between calls
+ */
+static frame_collector_t collector;
+
+/**
+ * @brief Nonzero once the collector is initialized
+ */
+static int initialized = 0;
+
+/**
+ * @brief Releases the collector when the MEX file is cleared
+ */
+static void release(void)
+{
+	FrameCollector_Free(&collector);
+	initialized = 0;
+}
+
+/**
+ * @brief Resets the decoder
+ * @param[in] framing The framing of the stream
+ */
+static void reset(const frame_framing_t framing)
+{
+	if (initialized)
+	{
+		FrameCollector_Free(&collector);
+	}
+
+	FrameCollector_Init(&collector, framing, 1);
+	initialized = 1;
+	mexAtExit(release);
+}
+
+/**
+ * @brief Creates the cell array of the kept frames
+ * @return The cell array
+ */
+static mxArray* createFrames(void)
+{
+	mxArray *const frames = mxCreateCellMatrix(1, collector.frameCount);
+	for (size_t f = 0; f < collector.frameCount; ++f)
+	{
+		size_t length;
+		const uint8_t *const frame = FrameCollector_Frame(&collector, f, &length);
+
+		mxArray *const column = mxCreateNumericMatrix(length, 1, mxUINT8_CLASS, mxREAL);
+		memcpy(mxGetData(column), frame, length);
+		mxSetCell(frames, f, column);
+	}
+	return frames;
+}
+
+/**
+ * @brief Creates the structure of the typed samples
+ * @return The structure
+ */
+static mxArray* createSamples(void)
+{
+	mxArray *const samples = mxCreateStructMatrix(1, 1, 0, NULL);
+	for (int type = 0; type < FRAME_TYPE_COUNT; ++type)
+	{
+		const frame_samples_t *const typed = &collector.samples[type];
+		if (NULL == typed->layout || 0 == typed->count) continue;
+
+		char name[16];
+		snprintf(name, sizeof(name), "type%d", type);
+
+		const mxClassID valueClass = (sizeof(int16_t) == typed->layout->valueSize) ? mxINT16_CLASS : mxINT32_CLASS;
+		mxArray *const values = mxCreateNumericMatrix(typed->layout->valueCount, typed->count, valueClass, mxREAL);
+		memcpy(mxGetData(values), typed->values, typed->count * typed->layout->valueCount * typed->layout->valueSize);
+		mxSetFieldByNumber(samples, 0, mxAddField(samples, name), values);
+
+		if (typed->layout->timestamped)
+		{
+			snprintf(name, sizeof(name), "type%dTime", type);
+
+			mxArray *const time = mxCreateNumericMatrix(1, typed->count, mxUINT32_CLASS, mxREAL);
+			memcpy(mxGetData(time), typed->time, typed->count * sizeof(uint32_t));
+			mxSetFieldByNumber(samples, 0, mxAddField(samples, name), time);
+		}
+	}
+	return samples;
+}
+
+/**
+ * @brief Creates the structure of the decoder statistics
+ * @return The structure
+ */
+static mxArray* createStatus(void)
+{
+	static const char *fields[] = { "frames", "framingErrors", "batchErrors", "droppedBatches", "outOfMemory" };
+	mxArray *const status = mxCreateStructMatrix(1, 1, sizeof(fields) / sizeof(fields[0]), fields);
+
+	double batchErrors = 0, droppedBatches = 0;
+	for (int type = 0; type < FRAME_TYPE_COUNT; ++type)
+	{
+		batchErrors += collector.samples[type].errors;
+		droppedBatches += collector.samples[type].dropped;
+	}
+
+	mxSetField(status, 0, "frames", mxCreateDoubleScalar(collector.decoder.frames));
+	mxSetField(status, 0, "framingErrors", mxCreateDoubleScalar(collector.decoder.errors));
+	mxSetField(status, 0, "batchErrors", mxCreateDoubleScalar(batchErrors));
+	mxSetField(status, 0, "droppedBatches", mxCreateDoubleScalar(droppedBatches));
+	mxSetField(status, 0, "outOfMemory", mxCreateLogicalScalar(collector.outOfMemory));
+	return status;
+}
+
+/**
+ * @brief The MEX entry point, see the file header
+ */
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (nrhs >= 1 && mxIsChar(prhs[0]))
+	{
+		char command[8], framing[8] = "escape";
+		mxGetString(prhs[0], command, sizeof(command));
+		if (nrhs >= 2) mxGetString(prhs[1], framing, sizeof(framing));
+
+		if (0 != strcmp(command, "reset"))
+		{
+			mexErrMsgIdAndTxt("frameDecode:command", "Unknown command '%s'.", command);
+		}
+
+		reset((0 == strcmp(framing, "cobs")) ? FRAME_FRAMING_COBS : FRAME_FRAMING_ESCAPE);
+		return;
+	}
+
+	if (1 != nrhs || !mxIsUint8(prhs[0]))
+	{
+		mexErrMsgIdAndTxt("frameDecode:bytes", "Expected a uint8 vector of received bytes.");
+	}
+
+	if (!initialized)
+	{
+		reset(FRAME_FRAMING_ESCAPE);
+	}
+
+	FrameCollector_Clear(&collector);
+	FrameCollector_Feed(&collector, (const uint8_t*)mxGetData(prhs[0]), mxGetNumberOfElements(prhs[0]));
+
+	plhs[0] = createFrames();
+	if (nlhs >= 2) plhs[1] = createSamples();
+	if (nlhs >= 3) plhs[2] = createStatus();
+}
@@ -0,0 +1,76 @@
+function errors = fusionAccuracy(folder, warmup)
+    % FUSIONACCURACY Cross-checks the host accuracy harness with the MATLAB quaternion math.
+    %   errors = fusionAccuracy() reads the quaternions that make accuracy
+    %   left in host/build/accuracy, compares every variant against
+    %   reference.csv using quaternionMul, quaternionConj and
+    %   quaternionToEuler, prints the statistics and plots the angular
+    %   error over time. warmup seconds (default 2) after the first sample
+    %   are excluded, as in fusion_accuracy.c.
+    %
+    %   errors is a struct with one field per variant: time (s), angle,
+    %   roll, pitch and yaw (deg).
+
+    here = fileparts(mfilename('fullpath'));
+    addpath(fullfile(here, 'test'));
+    if nargin < 1
+        folder = fullfile(here, '..', '..', 'host', 'build', 'accuracy');
+    end
+    if nargin < 2
+        warmup = 2;
+    end
+
+    reference = csvread(fullfile(folder, 'reference.csv'));
+    files = dir(fullfile(folder, '*.csv'));
+
+    errors = struct();
+    figure('Name', 'Fusion accuracy', 'NumberTitle', 'off');
+    hold on; grid on;
+    xlabel('time [s]'); ylabel('angular error [deg]');
+    legends = {};
+
+    for f = 1:numel(files)
+        [~, name] = fileparts(files(f).name);
+        if strcmp(name, 'reference')
+            continue;
+        end
+
+        variant = csvread(fullfile(folder, files(f).name));
+        if size(variant, 1) ~= size(reference, 1) || any(variant(:, 1) ~= reference(:, 1))
+            fprintf('%s: not from the same capture as the reference\n', name);
+            continue;
+        end
+
+        count = size(variant, 1);
+        time = (reference(:, 1) - reference(1, 1)) * 1e-6;
+        angle = zeros(count, 1);
+        euler = zeros(count, 3);
+        for i = 1:count
+            expected = reference(i, 2:5) / norm(reference(i, 2:5));
+            actual = variant(i, 2:5) / norm(variant(i, 2:5));
+
+            % the rotation between both orientations
+            difference = quaternionMul(quaternionConj(expected), actual);
+            angle(i) = 2 * atan2d(norm(difference(2:4)), abs(difference(1)));
+
+            [er, ep, ey] = quaternionToEuler(expected);
+            [ar, ap, ay] = quaternionToEuler(actual);
+            euler(i, :) = mod([ar ap ay] - [er ep ey] + 180, 360) - 180;
+            if abs(ep) > 89
+                euler(i, :) = NaN;
+            end
+        end
+
+        tracked = time >= warmup;
+        sorted = sort(angle(tracked));
+        fprintf('%-16s error mean %.4f rms %.4f p95 %.4f max %.4f, roll %.4f pitch %.4f yaw %.4f deg\n', ...
+            name, mean(sorted), sqrt(mean(sorted.^2)), sorted(floor(0.95*(numel(sorted)-1))+1), max(sorted), ...
+            max(abs(euler(tracked, :)), [], 1));
+
+        errors.(name) = struct('time', time, 'angle', angle, ...
+            'roll', euler(:, 1), 'pitch', euler(:, 2), 'yaw', euler(:, 3));
+        plot(time, angle);
+        legends{end+1} = strrep(name, '_', ' '); %#ok<AGROW>
+    end
+
+    legend(legends);
+end
@@ -5,36 +5,29 @@ function plotOrientation(DCM, an, mn)
     % coordinate system and DCM are actually the same
     coordinateSystem = DCM;
     
-    % prepare rotation matrices
-    R = DCM';
-
-    % prepare vertices
-    vertices = [ 0.75  0     0.02;
-                 0.25  0.5   0.02;
-                 0.25  0.25  0.02;
-                -0.75  0.25  0.02;
-                -0.75 -0.25  0.02;
-                 0.25 -0.25  0.02;
-                 0.25 -0.5   0.02;
-                 0.75  0     0.02
-                ];
-    N = size(vertices,1);
-    vertices = [vertices; vertices];
-    for vi=N+1:2*N
-        vertices(vi,:) = vertices(vi,:) + [0 0 -0.04];
+    % prepare vertices once, the arrow outline in two layers
+    persistent vertices N
+    if isempty(vertices)
+        vertices = [ 0.75  0     0.02;
+                     0.25  0.5   0.02;
+                     0.25  0.25  0.02;
+                    -0.75  0.25  0.02;
+                    -0.75 -0.25  0.02;
+                     0.25 -0.25  0.02;
+                     0.25 -0.5   0.02;
+                     0.75  0     0.02
+                    ];
+        N = size(vertices,1);
+        vertices = [vertices; bsxfun(@plus, vertices, [0 0 -0.04])];
     end
 
-    % transform vertices
-    for vi=1:size(vertices,1)
-        vx = vertices(vi,:);
-        v = R*vertices(vi,:)';
-        vertices(vi,:) = v';
-    end    
+    % transform vertices; each row v becomes (DCM'*v')' = v*DCM
+    transformed = vertices*DCM;
     
     % Set data and draw
     for p=0:3
-        set(orientationPlotHandle(p*2+1), 'XData', vertices(1:8,1), 'YData', vertices(1:8,2), 'ZData', vertices(1:8,3));
-        set(orientationPlotHandle(p*2+2), 'XData', vertices((N+1):2*N,1), 'YData', vertices((N+1):2*N,2), 'ZData', vertices((N+1):2*N,3));
+        set(orientationPlotHandle(p*2+1), 'XData', transformed(1:N,1), 'YData', transformed(1:N,2), 'ZData', transformed(1:N,3));
+        set(orientationPlotHandle(p*2+2), 'XData', transformed((N+1):2*N,1), 'YData', transformed((N+1):2*N,2), 'ZData', transformed((N+1):2*N,3));
     end
     
     % Set coordinate system
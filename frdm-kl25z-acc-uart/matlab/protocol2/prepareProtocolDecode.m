@@ -1,5 +1,10 @@
-function prepareProtocolDecode
-        
+function prepareProtocolDecode(framing)
+    % framing is either 'escape' (default, P2PPE) or 'cobs'
+    if nargin < 1
+        framing = 'escape';
+    end
+
+
     % Definitions
     global SOH EOT ESC ESC_XOR DA TA
     SOH     = uint8(1);
@@ -19,6 +24,12 @@ function prepareProtocolDecode
     global state
     state = 0;
     
+    % Framing selection, see COMMAND_SET_FRAMING
+    global useCobs cobsCode cobsRemaining
+    useCobs = strcmpi(framing, 'cobs');
+    cobsCode = 0;
+    cobsRemaining = 0;
+    
     % Decoding variables
     global dataLength data dataBytesRead escapeDetected dataReady lastByte
     lastByte = NaN;
@@ -5,6 +5,12 @@ function [availableData] = protocolDecode(byte)
 
     availableData = 0;
     
+    global useCobs
+    if useCobs
+        availableData = cobsDecode(byte);
+        return;
+    end
+    
     % Switch states
     switch state
         % Await preamble
@@ -72,4 +78,47 @@ function [availableData] = protocolDecode(byte)
                 disp('protocol error in state 6');
             end
     end
+end
+
+function [availableData] = cobsDecode(byte)
+    % Consistent Overhead Byte Stuffing; frames are terminated by a zero byte
+    global data dataReady dataBytesRead
+    global cobsCode cobsRemaining
+
+    availableData = 0;
+
+    % Delimiter: the frame is complete if the last block was read entirely
+    if byte == 0
+        if (cobsCode ~= 0) && (cobsRemaining == 0)
+            data = data(1:dataBytesRead);
+            dataReady = true;
+            availableData = dataBytesRead;
+        elseif cobsCode ~= 0
+            disp('protocol error: truncated COBS block');
+        end
+        cobsCode = 0;
+        cobsRemaining = 0;
+        return;
+    end
+
+    % Block code
+    if cobsRemaining == 0
+        if cobsCode == 0
+            % first block of a frame
+            data = zeros(512, 1, 'uint8');
+            dataBytesRead = 0;
+        elseif cobsCode < 255
+            % the previous block ended in an encoded zero
+            dataBytesRead = dataBytesRead + 1;
+            data(dataBytesRead) = 0;
+        end
+        cobsCode = byte;
+        cobsRemaining = byte - 1;
+        return;
+    end
+
+    % Block data
+    dataBytesRead = dataBytesRead + 1;
+    data(dataBytesRead) = byte;
+    cobsRemaining = cobsRemaining - 1;
 end
\ No newline at end of file
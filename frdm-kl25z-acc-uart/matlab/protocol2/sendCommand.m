@@ -0,0 +1,35 @@
+function sendCommand(s, command, args)
+    % SENDCOMMAND Sends a P2PPE framed command to the device.
+    %   sendCommand(s, 16, uint8(43))                     % output mode 43
+    %   sendCommand(s, 17, typecast(uint16(20), 'uint8')) % 20 ms period
+    %   sendCommand(s, 20, typecast(uint32(1000000), 'uint8')) % 1 Mbaud
+    %   sendCommand(s, 22, uint8(1))                      % COBS framing
+    %   sendCommand(s, 27, typecast(uint32(1), 'uint8'))  % ping, see clockSync
+    %
+    %   The device answers with a frame of type 96 carrying the command
+    %   and a status byte (0 = ok, 1 = unknown, 2 = invalid).
+
+    global SOH EOT ESC ESC_XOR DA TA
+    if isempty(SOH)
+        prepareProtocolDecode();
+    end
+
+    if nargin < 3
+        args = uint8([]);
+    end
+
+    payload = [uint8(command), reshape(uint8(args), 1, [])];
+    
+    % Escape the payload
+    encoded = uint8([]);
+    for b = payload
+        if b == EOT || b == ESC
+            encoded = [encoded, ESC, bitxor(b, ESC_XOR)]; %#ok<AGROW>
+        else
+            encoded = [encoded, b]; %#ok<AGROW>
+        end
+    end
+
+    frame = [DA, TA, SOH, uint8(numel(payload)), encoded, EOT];
+    fwrite(s, frame, 'uint8');
+end
@@ -0,0 +1,170 @@
+function serial_capture(duration, filename)
+    % SERIAL_CAPTURE Records timestamped raw sensor data.
+    %   serial_capture(60, 'flight.mat') switches the device to the raw
+    %   capture output mode (49), records for 60 seconds and saves
+    %
+    %   mpu      7xN int16 raw accelerometer xyz, gyroscope xyz, temperature
+    %   mpuTime  1xN uint32 capture timestamps in microseconds
+    %   hmc      3xN int16 raw magnetometer data
+    %   hmcTime  1xN uint32 capture timestamps in microseconds
+    %   stream   the raw received bytes, for replay through the C decoder
+    %
+    %   The raw bytes are also written next to it (here flight.bin), the
+    %   input of the host replay: host/build/fusion_replay flight.bin
+
+    if nargin < 1
+        duration = 60;
+    end
+    if nargin < 2
+        filename = 'capture.mat';
+    end
+
+    % Configuring port object
+    disp('Preparing serial port ...');
+    s = serial('COM3', ...
+        'FlowControl', 'none', ...
+        'BaudRate', 115200, ...
+        'DataBits', 8, ...
+        'Parity', 'none', ...
+        'StopBits', 1, ...
+        'TimeOut', 1, ...
+        'InputBufferSize', 4096, ...
+        'ReadAsyncMode', 'continuous', ...
+        'Terminator', 0 ...
+        );
+    cleanupHandler = onCleanup(@() cleanUp(s));
+
+    fopen(s);
+    sjobject = igetfield(s, 'jobject');
+
+    global dataReady data
+    prepareProtocolDecode();
+
+    % Use the compiled frame decoder if it was built, see buildFrameDecode
+    useFrameDecode = exist('frameDecode', 'file') == 3;
+    if useFrameDecode
+        frameDecode('reset');
+    end
+
+    % Switch to raw capture mode
+    sendCommand(s, 16, uint8(49));
+
+    mpu = zeros(7, 0, 'int16');
+    mpuTime = zeros(1, 0, 'uint32');
+    hmc = zeros(3, 0, 'int16');
+    hmcTime = zeros(1, 0, 'uint32');
+    stream = zeros(0, 1, 'uint8');
+
+    lastSequence = [NaN NaN];
+    drops = [0 0];
+    crcErrors = 0;
+    status = [];
+
+    captureTimer = tic;
+    while toc(captureTimer) < duration
+        out = fread(sjobject, 256, 0, 0);
+        bytes = typecast(out(1), 'uint8');
+        stream = [stream; bytes(:)]; %#ok<AGROW>
+
+        if useFrameDecode
+            % The compiled decoder checks and unpacks the batches itself
+            [~, typed, status] = frameDecode(bytes);
+            if isfield(typed, 'type49')
+                mpu = [mpu, typed.type49]; %#ok<AGROW>
+                mpuTime = [mpuTime, typed.type49Time]; %#ok<AGROW>
+            end
+            if isfield(typed, 'type50')
+                hmc = [hmc, typed.type50]; %#ok<AGROW>
+                hmcTime = [hmcTime, typed.type50Time]; %#ok<AGROW>
+            end
+            continue;
+        end
+
+        for byte = bytes(:)'
+            protocolDecode(byte);
+            if ~dataReady
+                continue;
+            end
+            dataReady = false;
+
+            type = data(1);
+            if type ~= 49 && type ~= 50
+                continue;
+            end
+
+            [samples, sequence, valid] = decodeCaptureBatch(data);
+            if ~valid
+                crcErrors = crcErrors + 1;
+                continue;
+            end
+
+            % Count dropped frames per stream using the sequence number
+            stream_index = double(type) - 48;
+            if ~isnan(lastSequence(stream_index))
+                drops(stream_index) = drops(stream_index) + ...
+                    mod(double(sequence) - lastSequence(stream_index) - 1, 65536);
+            end
+            lastSequence(stream_index) = double(sequence);
+
+            % Samples are a uint32 timestamp followed by int16 values
+            timestamps = typecast(reshape(samples(1:4, :), 1, []), 'uint32');
+            values = reshape(typecast(reshape(samples(5:end, :), 1, []), 'int16'), [], size(samples, 2));
+            if type == 49
+                mpu = [mpu, values]; %#ok<AGROW>
+                mpuTime = [mpuTime, timestamps]; %#ok<AGROW>
+            else
+                hmc = [hmc, values]; %#ok<AGROW>
+                hmcTime = [hmcTime, timestamps]; %#ok<AGROW>
+            end
+        end
+    end
+
+    fprintf('captured %d MPU6050 and %d HMC5883L samples\n', size(mpu, 2), size(hmc, 2));
+    if isempty(status)
+        fprintf('%d/%d batches dropped, %d CRC errors\n', drops(1), drops(2), crcErrors);
+    else
+        fprintf('%d batches dropped, %d CRC errors\n', status.droppedBatches, status.batchErrors);
+    end
+    save(filename, 'mpu', 'mpuTime', 'hmc', 'hmcTime', 'stream');
+
+    [folder, name] = fileparts(filename);
+    streamFile = fopen(fullfile(folder, [name '.bin']), 'w');
+    fwrite(streamFile, stream, 'uint8');
+    fclose(streamFile);
+
+    function [samples, sequence, valid] = decodeCaptureBatch(frame)
+        % Decodes a batch frame into a sampleSize x N byte matrix
+        samples = [];
+        sequence = uint16(0);
+
+        frameLength = numel(frame);
+        valid = frameLength >= 7;
+        if ~valid
+            return;
+        end
+
+        count = double(frame(4));
+        sampleSize = double(frame(5));
+        payloadEnd = 5 + count*sampleSize;
+        valid = (frameLength == payloadEnd + 2) && (sampleSize > 4);
+        if ~valid
+            return;
+        end
+
+        crc = typecast(frame(payloadEnd+1:payloadEnd+2), 'uint16');
+        valid = crc == crc16ccitt(frame(1:payloadEnd));
+        if ~valid
+            return;
+        end
+
+        sequence = typecast(frame(2:3), 'uint16');
+        samples = reshape(frame(6:payloadEnd), sampleSize, count);
+    end
+
+    function cleanUp(port)
+        disp('Cleaning up ...');
+        fclose(port);
+        delete(port);
+    end
+
+end
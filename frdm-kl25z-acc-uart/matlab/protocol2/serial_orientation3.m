@@ -3,6 +3,8 @@ function serial_orientation3
     %   define  
     %   global sensorDataCount accelBuffer gyroBuffer compassBuffer temperatureBuffer
     %   at the workspace after running this function to get the data.
+    %   The quaternions received while running are left in the workspace as
+    %   quaternionLog (4xN) and quaternionTime (receive times in seconds).
 
     close all; clear all; clc;
     
@@ -29,10 +31,10 @@ function serial_orientation3
         'Parity', 'none', ...
         'StopBits', 1, ...
         'TimeOut', 1, ...
-        'InputBufferSize', 1024, ...
+        'InputBufferSize', 65536, ...
         'ReadAsyncMode', 'continuous', ...
         'Terminator', 0, ...
-        'BytesAvailableFcnCount', 12, ...
+        'BytesAvailableFcnCount', 64, ...
         'BytesAvailableFcnMode', 'byte' ...
         );
     
@@ -50,98 +52,347 @@ function serial_orientation3
     % Definitions
     global dataReady data
     prepareProtocolDecode();
+    formats = traceFormats();
+    
+    % Use the compiled frame decoder if it was built, see buildFrameDecode
+    useFrameDecode = exist('frameDecode', 'file') == 3;
+    if useFrameDecode
+        frameDecode('reset');
+    end
+    
+    % Optionally switch the device to COBS framing (command 22); the
+    % acknowledgement is still P2PPE framed and is skipped by the decoder
+    useCobsFraming = false;
+    if useCobsFraming
+        sendCommand(s, 22, uint8(1));
+        prepareProtocolDecode('cobs');
+        if useFrameDecode
+            frameDecode('reset', 'cobs');
+        end
+    end
             
-    % Start timing for the graphics and data loop
-    graphicsTimer = tic;
+    % Start timing of the receive times
     dataTimer = tic;
     
-    % Reading the data
-    bulkSize = 80;
+    % Batch frame statistics
+    lastSequence = NaN;
+    batchDrops = 0;
+    batchCrcErrors = 0;
+    
+    % Circular log of the received quaternions and their receive times at the
+    % full rate; logCount is the total number of quaternions received so far
+    logLength = 8192;
+    quaternionLog = NaN(4, logLength);
+    timeLog = NaN(1, logLength);
+    logCount = 0;
+    
+    % Read and decode in the serial callback whenever enough bytes arrived,
+    % so that a slow redraw no longer lets the input buffer overflow
+    s.BytesAvailableFcn = @onBytesAvailable;
+    
+    % Render the latest orientation at a fixed frame rate; pause lets the
+    % queued serial callbacks run in between
+    frameRate = 60;
+    renderedCount = 0;
+    printTimer = tic;
     while true
+        graphicsTimer = tic;
+        
+        if logCount ~= renderedCount
+            renderedCount = logCount;
+            latest = quaternionLog(:, mod(logCount - 1, logLength) + 1);
+            
+            % Debugging
+            if toc(printTimer) > 0.5
+                [roll, pitch, yaw] = quaternionToEuler(latest);
+                fprintf('rpy: %+1.3f %+1.3f %+1.3f\n', roll, pitch, yaw);
+                printTimer = tic;
+            end
+            
+            % Quaternion to DCM
+            DCM = quaternionToRotation(latest);
+            
+            % plot the orientation
+            plotOrientation(DCM, [NaN NaN NaN], [NaN NaN NaN]);
+        end
+        
+        pause(max(1/frameRate - toc(graphicsTimer), 0.001));
+    end
+    
+    function onBytesAvailable(~, ~)
+        % Drains the serial input buffer and handles all completed frames
+        available = s.BytesAvailable;
+        if available == 0
+            return;
+        end
+        
         % Read bytes; A profiler run showed that fread(s, count) is
         % horribly slow mainly due to error string formattings even
         % if they are not required. Because of this, a more low-level
         % variant of the function is called.
-        out = fread(sjobject, bulkSize, 0, 0); % 0, 0 meaning unsigned int 8
-        bytes = typecast(out(1), 'uint8');     % unfortunately it is not unsigned
+        out = fread(sjobject, available, 0, 0); % 0, 0 meaning unsigned int 8
+        bytes = typecast(out(1), 'uint8');      % unfortunately it is not unsigned
+        
+        % Decode all frames of the chunk at once; protocolDecode on every
+        % single byte is the bottleneck at higher baud rates
+        if useFrameDecode
+            frames = frameDecode(bytes);
+        else
+            frames = decodeBytes(bytes);
+        end
         
-        byteIndices = 1:numel(bytes);
-        for b=byteIndices
-            byte = bytes(b);
+        timestamp = toc(dataTimer);
+        for f=1:numel(frames)
+            handleFrame(frames{f}, timestamp);
+        end
+    end
+    
+    function handleFrame(frame, timestamp)
+        % Reports the status frames and logs the quaternions of a frame;
+        % everything else that is not from the fused sensor is skipped
+        type = frame(1);
+        if type >= 1 && type <= 3
+            % Raw sensor stream, not used for display
+            return;
+        elseif type == 97
+            % Link status: transmit buffer overflows and dropped frames,
+            % samples lost by the mpu6050, hmc5883l and mma8451q queues
+            status = double(typecast(frame(2:min(end, 21)), 'uint32'));
+            if status(2) > 0
+                fprintf('link: %d overflows, %d frames dropped\n', status(1), status(2));
+            end
+            if numel(status) >= 5 && any(status(3:5) > 0)
+                fprintf('samples lost: mpu6050 %d, hmc5883l %d, mma8451q %d\n', status(3:5));
+            end
+            return;
+        elseif type == 98
+            % UART0 interrupt cycle counts: count, min, max, total for RX and TX
+            profile = reshape(double(typecast(frame(2:33), 'uint32')), 4, 2);
+            fprintf('uart irq cycles rx %d/%.1f/%d, tx %d/%.1f/%d (min/mean/max)\n', ...
+                profile(2,1), profile(4,1)/max(profile(1,1),1), profile(3,1), ...
+                profile(2,2), profile(4,2)/max(profile(1,2),1), profile(3,2));
+            return;
+        elseif type == 52
+            % Pipeline health: interval, step and sample counts, 5x10 log2 histograms
+            % in microseconds; bucket 1 is below 64 us, bucket k covers [2^(k+4), 2^(k+5))
+            interval = double(typecast(frame(2:5), 'uint32')) * 1e-6;
+            counts = double(typecast(frame(6:11), 'uint16'));
+            histograms = reshape(double(typecast(frame(12:111), 'uint16')), 10, 5);
+            bounds = 2.^(5:14);
+            names = {'sensor-fusion', 'fusion-wire', 'jitter', 'mpu6050', 'hmc5883l'};
+            fprintf('fusion %.1f Hz, mpu6050 %.1f Hz, hmc5883l %.1f Hz\n', counts / max(interval, 1e-6));
+            for h = 1:5
+                [~, mode] = max(histograms(:, h));
+                fprintf('  %s mostly below %d us\n', names{h}, 2*bounds(mode));
+            end
+            % Sensor health in driver registration order: expected period and
+            % longest gap in microseconds, fresh, stale reads, dropouts, recoveries
+            sensorCount = double(typecast(frame(112:113), 'uint16'));
+            for sensor = 1:sensorCount
+                report = frame(114+16*(sensor-1):113+16*sensor);
+                periods = double(typecast(report(1:8), 'uint32'));
+                tallies = double(typecast(report(9:16), 'uint16'));
+                fprintf('  sensor %d: %.1f of %.1f Hz, gap %.1f ms, %d stale, %d dropouts, %d recoveries\n', ...
+                    sensor-1, tallies(1) / max(interval, 1e-6), 1e6 / max(periods(1), 1), periods(2) * 1e-3, tallies(2:4));
+            end
+            % Fixed-point overflows after predict, accelerometer, magnetometer,
+            % gyroscope, sanitize and output, then covariance and state resets,
+            % behind the four sensor report slots; then the fusion steps with a
+            % frozen attitude during a gyroscope outage and two bytes of padding
+            if numel(frame) >= 195
+                overflows = double(typecast(frame(178:193), 'uint16'));
+                if any(overflows)
+                    fprintf('  fusion overflows %d/%d/%d/%d/%d/%d (predict/accel/magneto/gyro/sanitize/output), %d covariance, %d state resets\n', overflows);
+                end
+                staleSteps = double(typecast(frame(194:195), 'uint16'));
+                if staleSteps > 0
+                    fprintf('  no gyroscope and accelerometer data, output stale for %d steps\n', staleSteps);
+                end
+            end
+            return;
+        elseif type == 100
+            % Section timings: section, fusion engine, count, min, max, total cycles, log2 histogram
+            % bucket k counts durations of [2^k, 2^(k+1)) timer counts of 8 cycles each
+            sections = {'predict', 'update', 'mpu6050', 'hmc5883l', 'mma8451q', 'prepare', 'encode', 'uart rx', 'uart tx'};
+            engines = {'kalman', 'mahony'};
+            profile = double(typecast(frame(4:19), 'uint32'));
+            histogram = double(typecast(frame(20:51), 'uint16'));
+            [~, mode] = max(histogram);
+            fprintf('%s %s cycles %d/%.1f/%d (min/mean/max), mostly %d..%d\n', ...
+                engines{double(frame(3))+1}, sections{double(frame(2))+1}, ...
+                profile(2), profile(4)/max(profile(1),1), profile(3), 8*2^(mode-1), 8*2^mode);
+            return;
+        elseif type == 101
+            % Bring-up milestones in microseconds: parameters, sensors, loop, first sample, first quaternion, flags
+            milestones = double(typecast(frame(2:21), 'uint32')) * 1e-3;
+            flags = {'', ' (fast boot)'};
+            fprintf('boot%s: parameters %.1f ms, sensors %.1f ms, loop %.1f ms, first sample %.1f ms, first quaternion %.1f ms\n', ...
+                flags{bitand(double(frame(22)), 1)+1}, milestones);
+            return;
+        elseif type == 105
+            % Benchmark firmware report: version, count, prescaler shift, then 12 byte
+            % entries of kernel, variant, iterations, total cycles, min and max counts
+            kernels = {'fusion_predict', 'fusion_update', 'fusion_fetch_quaternion', ...
+                'prepare_mpu6050_acc', 'prepare_mpu6050_gyro', 'prepare_hmc5883l', 'prepare_mma8451q', ...
+                'p2ppe_encode', 'p2ppe_cobs_encode', 'ringbuffer_write', 'ringbuffer_read', ...
+                'ringbuffer_reserve_commit', 'ringbuffer_claim_release', ...
+                'i2c_mpu6050', 'i2c_hmc5883l', 'i2c_mma8451q'};
+            scale = 2^double(frame(4));
+            for e = 1:double(frame(3))
+                entry = frame(5+12*(e-1):4+12*e);
+                iterations = double(typecast(entry(3:4), 'uint16'));
+                total = double(typecast(entry(5:8), 'uint32'));
+                extremes = double(typecast(entry(9:12), 'uint16')) * scale;
+                variant = '';
+                if entry(2) > 0
+                    variant = sprintf(' @%d kHz', 10*double(entry(2)));
+                end
+                fprintf('bench %s%s: %d calls, cycles %d/%.1f/%d (min/mean/max)\n', ...
+                    kernels{double(entry(1))+1}, variant, iterations, ...
+                    extremes(1), total/max(iterations,1), extremes(2));
+            end
+            return;
+        elseif type == 104
+            % Trace message: ID and int32 arguments, formatted from trace.h
+            disp(traceMessage(frame, formats));
+            return;
+        elseif type == 45 || type == 51
+            % Batched quaternions: type, sequence, count, size, samples, crc
+            % type 51 samples lead with a uint32 capture time in microseconds
+            sampleWords = 4 + (type == 51);
+            [batch, sequence, valid] = decodeBatch(frame, sampleWords);
+            if ~valid
+                batchCrcErrors = batchCrcErrors + 1;
+                fprintf('batch CRC error (%d so far)\n', batchCrcErrors);
+                return;
+            end
             
-            % Attach byte to circular buffer
-            %byteCircBuf = [byteCircBuf(2:end), double(byte)];
-
-            % Decode the protocol
-            protocolDecode(byte);
-
-            % Decode data buffer
-            if dataReady
-                % Thanks, got it.
-                dataReady = false;
-                timestamp = toc(dataTimer);
-                
-                % Attach NaN byte to circular buffer to aid debugging
-                %byteCircBuf = [byteCircBuf(2:end), NaN];
-                
-                % Skip everything that is not from the fused sensor
-                type = data(1);
-                if type == 43
-                   
-                    % Decode  data
-                    scaling = (1/65535);
-                    
-                    quat = [
-                        double(typecast(data(2:5), 'int32'));
-                        double(typecast(data(6:9), 'int32'));
-                        double(typecast(data(10:13), 'int32'));
-                        double(typecast(data(14:17), 'int32'));
-                        ] * scaling;
-                elseif type == 42
-                    disp('Please buy the commercial version to enable this feature.');
-                    continue;
-                    
-                    % Decode  data
-                    scaling = (1/65535) * 180 / pi;
-                    
-                    rpy = [
-                        double(typecast(data(2:5), 'int32'));
-                        double(typecast(data(6:9), 'int32'));
-                        double(typecast(data(10:13), 'int32'));
-                        ] * scaling;
-                else
-                    disp('unknown sensor type');
-                    continue;
+            % Count dropped frames using the 16 bit sequence number
+            if ~isnan(lastSequence)
+                dropped = mod(double(sequence) - lastSequence - 1, 65536);
+                if dropped > 0
+                    batchDrops = batchDrops + dropped;
+                    fprintf('%d batch(es) dropped (%d so far)\n', dropped, batchDrops);
                 end
-                
-                % Render with 30 Hz
-                duration = toc(graphicsTimer);
-                if duration > 1/30                    
-
-                    % Debugging                                    
-                    [roll, pitch, yaw] = quaternionToEuler(quat);
-                    fprintf('rpy: %+1.3f %+1.3f %+1.3f\n', roll, pitch, yaw);
-                    
-                    % Quaternion to DCM
-                    DCM = quaternionToRotation(quat);
-                                
-                    % plot the orientation
-                    plotOrientation(DCM, [NaN NaN NaN], [NaN NaN NaN]);
-
-                    graphicsTimer = tic;
-                end;
             end
+            lastSequence = double(sequence);
+            
+            % Log every sample of the batch
+            scaling = (1/65535);
+            quat = double(batch(end-3:end, :)) * scaling;
+        elseif type == 43
+           
+            % Decode  data
+            scaling = (1/65535);
             
+            quat = [
+                double(typecast(frame(2:5), 'int32'));
+                double(typecast(frame(6:9), 'int32'));
+                double(typecast(frame(10:13), 'int32'));
+                double(typecast(frame(14:17), 'int32'));
+                ] * scaling;
+        elseif type == 46 || type == 47
+            % Decode Q1.14 quaternion (type 47 appends Q2.13 angles)
+            quat = double(typecast(frame(2:9), 'int16')) / 16384;
+        elseif type == 48
+            % Decode smallest-three quaternion
+            quat = decodeSmallestThree(typecast(frame(2:7), 'int16'));
+        elseif type == 42
+            disp('Please buy the commercial version to enable this feature.');
+            return;
+            
+            % Decode  data
+            scaling = (1/65535) * 180 / pi;
+            
+            rpy = [
+                double(typecast(frame(2:5), 'int32'));
+                double(typecast(frame(6:9), 'int32'));
+                double(typecast(frame(10:13), 'int32'));
+                ] * scaling;
+        else
+            disp('unknown sensor type');
+            return;
+        end
+        
+        % Append to the circular log, one column per quaternion
+        quat = reshape(quat, 4, []);
+        for q=1:size(quat, 2)
+            logCount = logCount + 1;
+            logIndex = mod(logCount - 1, logLength) + 1;
+            quaternionLog(:, logIndex) = quat(:, q);
+            timeLog(logIndex) = timestamp;
+        end
+    end
+    
+    function frames = decodeBytes(bytes)
+        % Per-byte fallback for frameDecode, collecting the completed frames
+        frames = {};
+        for b=1:numel(bytes)
+            protocolDecode(bytes(b));
+            if dataReady
+                dataReady = false;
+                frames{end+1} = data; %#ok<AGROW>
+            end
         end
     end
     
+    function [samples, sequence, valid] = decodeBatch(frame, sampleWords)
+        % Decodes a batch frame into a sampleWords x N matrix of int32 sample words
+        samples = [];
+        sequence = uint16(0);
+        
+        frameLength = numel(frame);
+        valid = frameLength >= 7;
+        if ~valid
+            return;
+        end
+        
+        count = double(frame(4));
+        sampleSize = double(frame(5));
+        payloadEnd = 5 + count*sampleSize;
+        valid = (frameLength == payloadEnd + 2) && (sampleSize == 4*sampleWords);
+        if ~valid
+            return;
+        end
+        
+        crc = typecast(frame(payloadEnd+1:payloadEnd+2), 'uint16');
+        valid = crc == crc16ccitt(frame(1:payloadEnd));
+        if ~valid
+            return;
+        end
+        
+        sequence = typecast(frame(2:3), 'uint16');
+        samples = reshape(typecast(frame(6:payloadEnd), 'int32'), sampleWords, count);
+    end
+
+    function quat = decodeSmallestThree(packed)
+        % Restores a quaternion from three Q1.15 values scaled by sqrt(2);
+        % the index of the dropped (positive) component is stored in the
+        % least significant bits of the first two values.
+        bits = bitand(typecast(packed, 'uint16'), uint16(1));
+        largest = double(bits(1)) + 2*double(bits(2)) + 1;
+        
+        others = double(packed(:)) / 32768 / sqrt(2);
+        quat = zeros(4, 1);
+        quat(setdiff(1:4, largest)) = others;
+        quat(largest) = sqrt(max(0, 1 - sum(others.^2)));
+    end
+
     function cleanUp()
         disp('Cleaning up ...');
         
         % Closing the port
+        s.BytesAvailableFcn = '';
         fclose(s);
         delete(s);
         clear s;
+        
+        % Leave the most recent logLength quaternions in time order
+        if exist('logCount', 'var') && logCount > 0
+            order = mod((logCount - min(logCount, logLength)):(logCount - 1), logLength) + 1;
+            assignin('base', 'quaternionLog', quaternionLog(:, order));
+            assignin('base', 'quaternionTime', timeLog(order));
+        end
     end
     
 end
\ No newline at end of file
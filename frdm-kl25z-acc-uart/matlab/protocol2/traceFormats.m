@@ -0,0 +1,25 @@
+function formats = traceFormats(headerFile)
+    % TRACEFORMATS Reads the trace message formats of the firmware.
+    %   formats = traceFormats() parses the TRACE_MESSAGES table of
+    %   Project_Headers/comm/trace.h and returns a containers.Map from
+    %   the message ID to its sprintf format string.
+
+    if nargin < 1
+        here = fileparts(mfilename('fullpath'));
+        headerFile = fullfile(here, '..', '..', 'Project_Headers', 'comm', 'trace.h');
+    end
+
+    source = fileread(headerFile);
+    entries = regexp(source, 'TRACE_MESSAGE\(\s*\w+\s*,\s*(0x[0-9A-Fa-f]+|\d+)\s*,\s*"([^"]*)"\s*\)', 'tokens');
+
+    formats = containers.Map('KeyType', 'double', 'ValueType', 'char');
+    for e = 1:numel(entries)
+        id = entries{e}{1};
+        if strncmpi(id, '0x', 2)
+            id = hex2dec(id(3:end));
+        else
+            id = str2double(id);
+        end
+        formats(id) = entries{e}{2};
+    end
+end
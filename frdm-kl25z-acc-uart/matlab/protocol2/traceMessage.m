@@ -0,0 +1,14 @@
+function message = traceMessage(frame, formats)
+    % TRACEMESSAGE Formats a trace frame (type 104).
+    %   The frame holds the type, the message ID and little endian int32
+    %   arguments; formats is the map returned by traceFormats().
+
+    id = double(frame(2));
+    args = double(typecast(frame(3:end - mod(numel(frame) - 2, 4)), 'int32'));
+
+    if isKey(formats, id)
+        message = sprintf(formats(id), args);
+    else
+        message = sprintf('trace 0x%02X:%s', id, sprintf(' %d', args));
+    end
+end
@@ -15,7 +15,7 @@ MACOS_FRAMEWORKS :=
 CFLAGS := -ggdb -fstack-usage -std=c99 -O3 -frename-registers  -fno-keep-static-consts -funsafe-loop-optimizations -fgcse-sm -fgcse-las -fgcse-after-reload -fipa-pta
 CXXFLAGS := -ggdb -fstack-usage -fno-exceptions -std=c99 -O3 -frename-registers  -fno-keep-static-consts -funsafe-loop-optimizations -fgcse-sm -fgcse-las -fgcse-after-reload -fipa-pta
 ASFLAGS := 
-LDFLAGS := -Wl,--gc-sections
+LDFLAGS := -Wl,--gc-sections -Wl,-Map=$(BINARYDIR)/$(basename $(TARGETNAME)).map -Wl,--print-memory-usage -Wl,--wrap=fix16_mul -Wl,--wrap=fix16_div -Wl,--wrap=fix16_sqrt
 COMMONFLAGS := 
 
 START_GROUP := -Wl,--start-group